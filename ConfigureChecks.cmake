@@ -59,6 +59,22 @@ if(CMAKE_SYSTEM_NAME STREQUAL "Linux")
 		}"
 		HAVE_LINUX_IF_BONDING_H
 	)
+	#
+	# dumpcap can capture through TPACKET_V3 rings itself (Linux 3.2
+	# and later).
+	#
+	check_c_source_compiles(
+		"#include <sys/socket.h>
+		#include <linux/if_packet.h>
+		int main(void)
+		{
+			struct tpacket_req3 req;
+			int version = TPACKET_V3;
+			req.tp_retire_blk_tov = 0;
+			return version + (int)req.tp_retire_blk_tov;
+		}"
+		HAVE_TPACKET_V3
+	)
 endif()
 
 #Functions
@@ -116,9 +132,12 @@ else()
 	#
 	check_include_file("alloca.h"    HAVE_ALLOCA_H)
 endif()
+check_function_exists("fopencookie"      HAVE_FOPENCOOKIE)
+check_function_exists("funopen"          HAVE_FUNOPEN)
 check_function_exists("getifaddrs"       HAVE_GETIFADDRS)
 check_function_exists("issetugid"        HAVE_ISSETUGID)
 check_function_exists("mkstemps"         HAVE_MKSTEMPS)
+check_function_exists("mmap"             HAVE_MMAP)
 check_function_exists("setresgid"        HAVE_SETRESGID)
 check_function_exists("setresuid"        HAVE_SETRESUID)
 check_function_exists("strptime"         HAVE_STRPTIME)
@@ -437,6 +437,10 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, inf
         argv = sync_pipe_add_arg(argv, &argc, "-w");
         argv = sync_pipe_add_arg(argv, &argc, capture_opts->save_file);
     }
+    if (capture_opts->shm_buffer_path) {
+        argv = sync_pipe_add_arg(argv, &argc, "--shm-buffer");
+        argv = sync_pipe_add_arg(argv, &argc, capture_opts->shm_buffer_path);
+    }
     for (i = 0; i < argc; i++) {
         g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_DEBUG, "argv[%d]: %s", i, argv[i]);
     }
@@ -50,6 +50,7 @@
 #include <stdarg.h>
 #include <locale.h>
 #include <errno.h>
+#include <fcntl.h>
 
 #ifdef HAVE_GETOPT_H
 #include <getopt.h>
@@ -60,6 +61,7 @@
 #include <wiretap/wtap.h>
 
 #include <ui/cmdarg_err.h>
+#include <ui/clopts_common.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/privileges.h>
 #include <cli_main.h>
@@ -145,6 +147,14 @@ static gboolean cap_order          = TRUE;  /* Report if packets are in chronolo
 
 static gboolean cap_file_hashes    = TRUE;  /* Calculate file hashes */
 
+/*
+ * None of the infos depend on the packet data, so files are read in
+ * wiretap's "header scan" mode, in which it can skip over the data of
+ * packets (in the file types that support that), unless --full-read is
+ * specified.
+ */
+static gboolean header_scan        = TRUE;
+
 // Strongest to weakest
 #define HASH_SIZE_SHA256 32
 #define HASH_SIZE_RMD160 20
@@ -153,14 +163,12 @@ static gboolean cap_file_hashes    = TRUE;  /* Calculate file hashes */
 #define HASH_STR_SIZE (65) /* Max hash size * 2 + '\0' */
 #define HASH_BUF_SIZE (1024 * 1024)
 
-
-static gchar file_sha256[HASH_STR_SIZE];
-static gchar file_rmd160[HASH_STR_SIZE];
-static gchar file_sha1[HASH_STR_SIZE];
-
-static guint num_ipv4_addresses;
-static guint num_ipv6_addresses;
-static guint num_decryption_secrets;
+/*
+ * Files can be processed by a pool of threads; the reports are still
+ * generated and printed, one file after another, by the main thread.
+ */
+static guint num_threads = 1;
+static GThreadPool *job_pool = NULL;
 
 /*
  * If we have at least two packets with time stamps, and they're not in
@@ -214,8 +222,73 @@ typedef struct _capture_info {
   GArray               *interface_packet_counts;  /* array of per_packet interface_id counts; one entry per file IDB */
   guint32               pkt_interface_id_unknown; /* counts if packet interface_id didn't match a known one */
   GArray               *idb_info_strings;         /* array of IDB info strings */
+
+  guint                 num_ipv4_addresses;
+  guint                 num_ipv6_addresses;
+  guint                 num_decryption_secrets;
+
+  gchar                 file_sha256[HASH_STR_SIZE];
+  gchar                 file_rmd160[HASH_STR_SIZE];
+  gchar                 file_sha1[HASH_STR_SIZE];
 } capture_info;
 
+/*
+ * A file to report on.  It's processed by process_cap_file(), possibly
+ * in another thread, and reported on, in order, by the main thread.
+ */
+typedef struct _capinfos_job {
+  const char           *filename;
+  capture_info          cf_info;                  /* cf_info.wth is open until reported on */
+  int                   status;                   /* 0, 1 (short read; reported anyway) or 2 */
+  GString              *errors;                   /* messages to print before the report */
+  gchar                *report;                   /* from the cache, or NULL */
+  gboolean              done;                     /* protected by job_mutex */
+  gboolean              stat_known;               /* size and mtime are valid */
+  gint64                size;
+  gint64                mtime;
+} capinfos_job;
+
+static GMutex job_mutex;
+static GCond job_done;
+
+/* The job being processed by the current thread, if any. */
+static GPrivate current_job = G_PRIVATE_INIT(NULL);
+
+/*
+ * Reports, keyed by file name, for files whose size and modification
+ * time haven't changed since they were last processed, read from and
+ * written back to the --cache file.  The file starts with a line that
+ * identifies the options that affect the reports, so that reports
+ * generated with other options aren't used.
+ */
+typedef struct _cache_entry {
+  gint64                size;
+  gint64                mtime;
+  gchar                *report;
+} cache_entry;
+
+#define CACHE_HEADER "# capinfos cache "
+
+static char *cache_file = NULL;
+static GHashTable *report_cache = NULL;
+
+/*
+ * The hashes are computed from the data wiretap reads from the file, as
+ * it reads it, so that the file doesn't have to be read twice; anything
+ * wiretap didn't read, or read before the hashing started, is read here.
+ */
+typedef struct _file_hasher {
+  const char           *filename;
+  gcry_md_hd_t          hd;
+  int                   fd;                       /* for reading the rest of the file, or -1 */
+  guint8               *buf;
+  gint64                pos;                      /* everything before this has been hashed */
+  gboolean              failed;
+} file_hasher;
+
+/* The report being generated by the main thread. */
+static GString *report = NULL;
+
 static char *decimal_point;
 
 static void
@@ -578,11 +651,21 @@ relative_time_string(nstime_t *timer, int tsprecision, capture_info *cf_info, gb
   return time_string_buf;
 }
 
+static void G_GNUC_PRINTF(1, 2)
+report_printf(const gchar *fmt, ...)
+{
+  va_list ap;
+
+  va_start(ap, fmt);
+  g_string_append_vprintf(report, fmt, ap);
+  va_end(ap);
+}
+
 static void print_value(const gchar *text_p1, gint width, const gchar *text_p2, double value) {
   if (value > 0.0)
-    printf("%s%.*f%s\n", text_p1, width, value, text_p2);
+    report_printf("%s%.*f%s\n", text_p1, width, value, text_p2);
   else
-    printf("%sn/a\n", text_p1);
+    report_printf("%sn/a\n", text_p1);
 }
 
 /* multi-line comments would conflict with the formatting that capinfos uses
@@ -612,7 +695,7 @@ show_option_string(const char *prefix, const char *option_str)
   if (option_str != NULL && option_str[0] != '\0') {
     str = g_strdup(option_str);
     string_replace_newlines(str);
-    printf("%s%s\n", prefix, str);
+    report_printf("%s%s\n", prefix, str);
     g_free(str);
   }
 }
@@ -627,122 +710,122 @@ print_stats(const gchar *filename, capture_info *cf_info)
   file_type_string = wtap_file_type_subtype_string(cf_info->file_type);
   file_encap_string = wtap_encap_description(cf_info->file_encap);
 
-  if (filename)           printf     ("File name:           %s\n", filename);
+  if (filename)           report_printf     ("File name:           %s\n", filename);
   if (cap_file_type) {
     const char *compression_type_description;
     compression_type_description = wtap_compression_type_description(cf_info->compression_type);
     if (compression_type_description == NULL)
-      printf     ("File type:           %s\n",
+      report_printf     ("File type:           %s\n",
         file_type_string);
     else
-      printf     ("File type:           %s (%s)\n",
+      report_printf     ("File type:           %s (%s)\n",
         file_type_string, compression_type_description);
   }
   if (cap_file_encap) {
-    printf      ("File encapsulation:  %s\n", file_encap_string);
+    report_printf      ("File encapsulation:  %s\n", file_encap_string);
     if (cf_info->file_encap == WTAP_ENCAP_PER_PACKET) {
       int i;
-      printf    ("Encapsulation in use by packets (# of pkts):\n");
+      report_printf    ("Encapsulation in use by packets (# of pkts):\n");
       for (i=0; i<WTAP_NUM_ENCAP_TYPES; i++) {
         if (cf_info->encap_counts[i] > 0)
-          printf("                     %s (%d)\n",
+          report_printf("                     %s (%d)\n",
                  wtap_encap_description(i), cf_info->encap_counts[i]);
       }
     }
   }
   if (cap_file_more_info) {
-    printf      ("File timestamp precision:  %s (%d)\n",
+    report_printf      ("File timestamp precision:  %s (%d)\n",
       wtap_tsprec_string(cf_info->file_tsprec), cf_info->file_tsprec);
   }
 
   if (cap_snaplen && cf_info->snap_set)
-    printf     ("Packet size limit:   file hdr: %u bytes\n", cf_info->snaplen);
+    report_printf     ("Packet size limit:   file hdr: %u bytes\n", cf_info->snaplen);
   else if (cap_snaplen && !cf_info->snap_set)
-    printf     ("Packet size limit:   file hdr: (not set)\n");
+    report_printf     ("Packet size limit:   file hdr: (not set)\n");
   if (cf_info->snaplen_max_inferred > 0) {
     if (cf_info->snaplen_min_inferred == cf_info->snaplen_max_inferred)
-      printf     ("Packet size limit:   inferred: %u bytes\n", cf_info->snaplen_min_inferred);
+      report_printf     ("Packet size limit:   inferred: %u bytes\n", cf_info->snaplen_min_inferred);
     else
-      printf     ("Packet size limit:   inferred: %u bytes - %u bytes (range)\n",
+      report_printf     ("Packet size limit:   inferred: %u bytes - %u bytes (range)\n",
           cf_info->snaplen_min_inferred, cf_info->snaplen_max_inferred);
   }
   if (cap_packet_count) {
-    printf     ("Number of packets:   ");
+    report_printf     ("Number of packets:   ");
     if (machine_readable) {
-      printf ("%u\n", cf_info->packet_count);
+      report_printf ("%u\n", cf_info->packet_count);
     } else {
       size_string = format_size(cf_info->packet_count, format_size_unit_none);
-      printf ("%s\n", size_string);
+      report_printf ("%s\n", size_string);
       g_free(size_string);
     }
   }
   if (cap_file_size) {
-    printf     ("File size:           ");
+    report_printf     ("File size:           ");
     if (machine_readable) {
-      printf     ("%" G_GINT64_MODIFIER "d bytes\n", cf_info->filesize);
+      report_printf     ("%" G_GINT64_MODIFIER "d bytes\n", cf_info->filesize);
     } else {
       size_string = format_size(cf_info->filesize, format_size_unit_bytes);
-      printf ("%s\n", size_string);
+      report_printf ("%s\n", size_string);
       g_free(size_string);
     }
   }
   if (cap_data_size) {
-    printf     ("Data size:           ");
+    report_printf     ("Data size:           ");
     if (machine_readable) {
-      printf     ("%" G_GINT64_MODIFIER "u bytes\n", cf_info->packet_bytes);
+      report_printf     ("%" G_GINT64_MODIFIER "u bytes\n", cf_info->packet_bytes);
     } else {
       size_string = format_size(cf_info->packet_bytes, format_size_unit_bytes);
-      printf ("%s\n", size_string);
+      report_printf ("%s\n", size_string);
       g_free(size_string);
     }
   }
   if (cf_info->times_known) {
     if (cap_duration) /* XXX - shorten to hh:mm:ss */
-                          printf("Capture duration:    %s\n", relative_time_string(&cf_info->duration, cf_info->duration_tsprec, cf_info, TRUE));
+                          report_printf("Capture duration:    %s\n", relative_time_string(&cf_info->duration, cf_info->duration_tsprec, cf_info, TRUE));
     if (cap_start_time)
-                          printf("First packet time:   %s\n", absolute_time_string(&cf_info->start_time, cf_info->start_time_tsprec, cf_info));
+                          report_printf("First packet time:   %s\n", absolute_time_string(&cf_info->start_time, cf_info->start_time_tsprec, cf_info));
     if (cap_end_time)
-                          printf("Last packet time:    %s\n", absolute_time_string(&cf_info->stop_time, cf_info->stop_time_tsprec, cf_info));
+                          report_printf("Last packet time:    %s\n", absolute_time_string(&cf_info->stop_time, cf_info->stop_time_tsprec, cf_info));
     if (cap_data_rate_byte) {
-                          printf("Data byte rate:      ");
+                          report_printf("Data byte rate:      ");
       if (machine_readable) {
         print_value("", 2, " bytes/sec",   cf_info->data_rate);
       } else {
         size_string = format_size((gint64)cf_info->data_rate, format_size_unit_bytes_s);
-        printf ("%s\n", size_string);
+        report_printf ("%s\n", size_string);
         g_free(size_string);
       }
     }
     if (cap_data_rate_bit) {
-                          printf("Data bit rate:       ");
+                          report_printf("Data bit rate:       ");
       if (machine_readable) {
         print_value("", 2, " bits/sec",    cf_info->data_rate*8);
       } else {
         size_string = format_size((gint64)(cf_info->data_rate*8), format_size_unit_bits_s);
-        printf ("%s\n", size_string);
+        report_printf ("%s\n", size_string);
         g_free(size_string);
       }
     }
   }
-  if (cap_packet_size)    printf("Average packet size: %.2f bytes\n",        cf_info->packet_size);
+  if (cap_packet_size)    report_printf("Average packet size: %.2f bytes\n",        cf_info->packet_size);
   if (cf_info->times_known) {
     if (cap_packet_rate) {
-                          printf("Average packet rate: ");
+                          report_printf("Average packet rate: ");
       if (machine_readable) {
         print_value("", 2, " packets/sec", cf_info->packet_rate);
       } else {
         size_string = format_size((gint64)cf_info->packet_rate, format_size_unit_packets_s);
-        printf ("%s\n", size_string);
+        report_printf ("%s\n", size_string);
         g_free(size_string);
       }
     }
   }
   if (cap_file_hashes) {
-    printf     ("SHA256:              %s\n", file_sha256);
-    printf     ("RIPEMD160:           %s\n", file_rmd160);
-    printf     ("SHA1:                %s\n", file_sha1);
+    report_printf     ("SHA256:              %s\n", cf_info->file_sha256);
+    report_printf     ("RIPEMD160:           %s\n", cf_info->file_rmd160);
+    report_printf     ("SHA1:                %s\n", cf_info->file_sha1);
   }
-  if (cap_order)          printf     ("Strict time order:   %s\n", order_string(cf_info->order));
+  if (cap_order)          report_printf     ("Strict time order:   %s\n", order_string(cf_info->order));
 
   gboolean has_multiple_sections = (wtap_file_get_num_shbs(cf_info->wth) > 1);
 
@@ -753,7 +836,7 @@ print_stats(const gchar *filename, capture_info *cf_info)
 
     // If we have more than one section, add headers for each section.
     if (has_multiple_sections)
-      printf("Section %u:\n\n", section_number);
+      report_printf("Section %u:\n\n", section_number);
 
     shb = wtap_file_get_shb(cf_info->wth, section_number);
     if (shb != NULL) {
@@ -779,28 +862,28 @@ print_stats(const gchar *filename, capture_info *cf_info)
       if (cap_file_idb && cf_info->num_interfaces != 0) {
         guint i;
         g_assert(cf_info->num_interfaces == cf_info->idb_info_strings->len);
-        printf     ("Number of interfaces in file: %u\n", cf_info->num_interfaces);
+        report_printf     ("Number of interfaces in file: %u\n", cf_info->num_interfaces);
         for (i = 0; i < cf_info->idb_info_strings->len; i++) {
           gchar *s = g_array_index(cf_info->idb_info_strings, gchar*, i);
           guint32 packet_count = 0;
           if (i < cf_info->interface_packet_counts->len)
             packet_count = g_array_index(cf_info->interface_packet_counts, guint32, i);
-          printf   ("Interface #%u info:\n", i);
-          printf   ("%s", s);
-          printf   ("                     Number of packets = %u\n", packet_count);
+          report_printf   ("Interface #%u info:\n", i);
+          report_printf   ("%s", s);
+          report_printf   ("                     Number of packets = %u\n", packet_count);
         }
       }
     }
 
     if (cap_file_nrb) {
-      if (num_ipv4_addresses != 0)
-        printf   ("Number of resolved IPv4 addresses in file: %u\n", num_ipv4_addresses);
-      if (num_ipv6_addresses != 0)
-        printf   ("Number of resolved IPv6 addresses in file: %u\n", num_ipv6_addresses);
+      if (cf_info->num_ipv4_addresses != 0)
+        report_printf   ("Number of resolved IPv4 addresses in file: %u\n", cf_info->num_ipv4_addresses);
+      if (cf_info->num_ipv6_addresses != 0)
+        report_printf   ("Number of resolved IPv6 addresses in file: %u\n", cf_info->num_ipv6_addresses);
     }
     if (cap_file_dsb) {
-      if (num_decryption_secrets != 0)
-        printf   ("Number of decryption secrets in file: %u\n", num_decryption_secrets);
+      if (cf_info->num_decryption_secrets != 0)
+        report_printf   ("Number of decryption secrets in file: %u\n", cf_info->num_decryption_secrets);
     }
   }
 }
@@ -808,13 +891,13 @@ print_stats(const gchar *filename, capture_info *cf_info)
 static void
 putsep(void)
 {
-  if (field_separator) putchar(field_separator);
+  if (field_separator) g_string_append_c(report, field_separator);
 }
 
 static void
 putquote(void)
 {
-  if (quote_char) putchar(quote_char);
+  if (quote_char) g_string_append_c(report, quote_char);
 }
 
 static void
@@ -822,7 +905,7 @@ print_stats_table_header_label(const gchar *label)
 {
   putsep();
   putquote();
-  printf("%s", label);
+  report_printf("%s", label);
   putquote();
 }
 
@@ -830,7 +913,7 @@ static void
 print_stats_table_header(void)
 {
   putquote();
-  printf("File name");
+  report_printf("File name");
   putquote();
 
   if (cap_file_type)      print_stats_table_header_label("File type");
@@ -862,7 +945,7 @@ print_stats_table_header(void)
   }
   if (cap_comment)        print_stats_table_header_label("Capture comment");
 
-  printf("\n");
+  report_printf("\n");
 }
 
 static void
@@ -876,14 +959,14 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
 
   if (filename) {
     putquote();
-    printf("%s", filename);
+    report_printf("%s", filename);
     putquote();
   }
 
   if (cap_file_type) {
     putsep();
     putquote();
-    printf("%s", file_type_string);
+    report_printf("%s", file_type_string);
     putquote();
   }
 
@@ -895,14 +978,14 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
   if (cap_file_encap) {
     putsep();
     putquote();
-    printf("%s", file_encap_string);
+    report_printf("%s", file_encap_string);
     putquote();
   }
 
   if (cap_file_more_info) {
     putsep();
     putquote();
-    printf("%s", wtap_tsprec_string(cf_info->file_tsprec));
+    report_printf("%s", wtap_tsprec_string(cf_info->file_tsprec));
     putquote();
   }
 
@@ -910,28 +993,28 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
     putsep();
     putquote();
     if (cf_info->snap_set)
-      printf("%u", cf_info->snaplen);
+      report_printf("%u", cf_info->snaplen);
     else
-      printf("(not set)");
+      report_printf("(not set)");
     putquote();
     if (cf_info->snaplen_max_inferred > 0) {
       putsep();
       putquote();
-      printf("%u", cf_info->snaplen_min_inferred);
+      report_printf("%u", cf_info->snaplen_min_inferred);
       putquote();
       putsep();
       putquote();
-      printf("%u", cf_info->snaplen_max_inferred);
+      report_printf("%u", cf_info->snaplen_max_inferred);
       putquote();
     }
     else {
       putsep();
       putquote();
-      printf("n/a");
+      report_printf("n/a");
       putquote();
       putsep();
       putquote();
-      printf("n/a");
+      report_printf("n/a");
       putquote();
     }
   }
@@ -939,42 +1022,42 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
   if (cap_packet_count) {
     putsep();
     putquote();
-    printf("%u", cf_info->packet_count);
+    report_printf("%u", cf_info->packet_count);
     putquote();
   }
 
   if (cap_file_size) {
     putsep();
     putquote();
-    printf("%" G_GINT64_MODIFIER "d", cf_info->filesize);
+    report_printf("%" G_GINT64_MODIFIER "d", cf_info->filesize);
     putquote();
   }
 
   if (cap_data_size) {
     putsep();
     putquote();
-    printf("%" G_GINT64_MODIFIER "u", cf_info->packet_bytes);
+    report_printf("%" G_GINT64_MODIFIER "u", cf_info->packet_bytes);
     putquote();
   }
 
   if (cap_duration) {
     putsep();
     putquote();
-    printf("%s", relative_time_string(&cf_info->duration, cf_info->duration_tsprec, cf_info, FALSE));
+    report_printf("%s", relative_time_string(&cf_info->duration, cf_info->duration_tsprec, cf_info, FALSE));
     putquote();
   }
 
   if (cap_start_time) {
     putsep();
     putquote();
-    printf("%s", absolute_time_string(&cf_info->start_time, cf_info->start_time_tsprec, cf_info));
+    report_printf("%s", absolute_time_string(&cf_info->start_time, cf_info->start_time_tsprec, cf_info));
     putquote();
   }
 
   if (cap_end_time) {
     putsep();
     putquote();
-    printf("%s", absolute_time_string(&cf_info->stop_time, cf_info->stop_time_tsprec, cf_info));
+    report_printf("%s", absolute_time_string(&cf_info->stop_time, cf_info->stop_time_tsprec, cf_info));
     putquote();
   }
 
@@ -982,9 +1065,9 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
     putsep();
     putquote();
     if (cf_info->times_known)
-      printf("%.2f", cf_info->data_rate);
+      report_printf("%.2f", cf_info->data_rate);
     else
-      printf("n/a");
+      report_printf("n/a");
     putquote();
   }
 
@@ -992,16 +1075,16 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
     putsep();
     putquote();
     if (cf_info->times_known)
-      printf("%.2f", cf_info->data_rate*8);
+      report_printf("%.2f", cf_info->data_rate*8);
     else
-      printf("n/a");
+      report_printf("n/a");
     putquote();
   }
 
   if (cap_packet_size) {
     putsep();
     putquote();
-    printf("%.2f", cf_info->packet_size);
+    report_printf("%.2f", cf_info->packet_size);
     putquote();
   }
 
@@ -1009,33 +1092,33 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
     putsep();
     putquote();
     if (cf_info->times_known)
-      printf("%.2f", cf_info->packet_rate);
+      report_printf("%.2f", cf_info->packet_rate);
     else
-      printf("n/a");
+      report_printf("n/a");
     putquote();
   }
 
   if (cap_file_hashes) {
     putsep();
     putquote();
-    printf("%s", file_sha256);
+    report_printf("%s", cf_info->file_sha256);
     putquote();
 
     putsep();
     putquote();
-    printf("%s", file_rmd160);
+    report_printf("%s", cf_info->file_rmd160);
     putquote();
 
     putsep();
     putquote();
-    printf("%s", file_sha1);
+    report_printf("%s", cf_info->file_sha1);
     putquote();
   }
 
   if (cap_order) {
     putsep();
     putquote();
-    printf("%s", order_string(cf_info->order));
+    report_printf("%s", order_string(cf_info->order));
     putquote();
   }
 
@@ -1046,7 +1129,7 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
 
     // If we have more than one section, add headers for each section.
     if (wtap_file_get_num_shbs(cf_info->wth) > 1)
-      printf("Section %u: \n", section_number);
+      report_printf("Section %u: \n", section_number);
 
     shb = wtap_file_get_shb(cf_info->wth, section_number);
     if (cap_file_more_info) {
@@ -1055,21 +1138,21 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
       putsep();
       putquote();
       if (wtap_block_get_string_option_value(shb, OPT_SHB_HARDWARE, &str) == WTAP_OPTTYPE_SUCCESS) {
-        printf("%s", str);
+        report_printf("%s", str);
       }
       putquote();
 
       putsep();
       putquote();
       if (wtap_block_get_string_option_value(shb, OPT_SHB_OS, &str) == WTAP_OPTTYPE_SUCCESS) {
-        printf("%s", str);
+        report_printf("%s", str);
       }
       putquote();
 
       putsep();
       putquote();
       if (wtap_block_get_string_option_value(shb, OPT_SHB_USERAPPL, &str) == WTAP_OPTTYPE_SUCCESS) {
-        printf("%s", str);
+        report_printf("%s", str);
       }
       putquote();
     }
@@ -1092,13 +1175,13 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
 
       // If we have more than one section, add headers for each section.
       if (wtap_file_get_num_shbs(cf_info->wth) > 1)
-        printf("Section %u: \n", section_number);
+        report_printf("Section %u: \n", section_number);
 
       for (i = 0; wtap_block_get_nth_string_option_value(shb, OPT_COMMENT, i, &opt_comment) == WTAP_OPTTYPE_SUCCESS; i++) {
         have_cap = TRUE;
         putsep();
         putquote();
-        printf("%s", opt_comment);
+        report_printf("%s", opt_comment);
         putquote();
       }
       if(!have_cap) {
@@ -1111,7 +1194,7 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
 
   }
 
-  printf("\n");
+  report_printf("\n");
 }
 
 static void
@@ -1139,26 +1222,140 @@ cleanup_capture_info(capture_info *cf_info)
 static void
 count_ipv4_address(const guint addr _U_, const gchar *name _U_)
 {
-  num_ipv4_addresses++;
+  capinfos_job *job = (capinfos_job *)g_private_get(&current_job);
+
+  job->cf_info.num_ipv4_addresses++;
 }
 
 static void
 count_ipv6_address(const void *addrp _U_, const gchar *name _U_)
 {
-  num_ipv6_addresses++;
+  capinfos_job *job = (capinfos_job *)g_private_get(&current_job);
+
+  job->cf_info.num_ipv6_addresses++;
 }
 
 static void
 count_decryption_secret(guint32 secrets_type _U_, const void *secrets _U_, guint size _U_)
 {
+  capinfos_job *job = (capinfos_job *)g_private_get(&current_job);
+
   /* XXX - count them based on the secrets type (which is an opaque code,
      not a small integer)? */
-  num_decryption_secrets++;
+  job->cf_info.num_decryption_secrets++;
+}
+
+static void
+hash_to_str(const unsigned char *hash, size_t length, char *str) {
+  int i;
+
+  for (i = 0; i < (int) length; i++) {
+    g_snprintf(str+(i*2), 3, "%02x", hash[i]);
+  }
+}
+
+/* Hash the file from hasher->pos up to end, or to the end of the file if
+   end is -1, reading it ourselves. */
+static void
+hasher_read_file(file_hasher *hasher, gint64 end)
+{
+  int bytes_read;
+  unsigned int to_read;
+
+  if (hasher->fd == -1) {
+    hasher->fd = ws_open(hasher->filename, O_RDONLY|O_BINARY, 0000);
+    if (hasher->fd == -1) {
+      hasher->failed = TRUE;
+      return;
+    }
+    hasher->buf = (guint8 *)g_malloc(HASH_BUF_SIZE);
+  }
+  if (ws_lseek64(hasher->fd, hasher->pos, SEEK_SET) == -1) {
+    hasher->failed = TRUE;
+    return;
+  }
+  while (end == -1 || hasher->pos < end) {
+    to_read = HASH_BUF_SIZE;
+    if (end != -1 && end - hasher->pos < HASH_BUF_SIZE)
+      to_read = (unsigned int)(end - hasher->pos);
+    bytes_read = (int)ws_read(hasher->fd, hasher->buf, to_read);
+    if (bytes_read < 0) {
+      hasher->failed = TRUE;
+      return;
+    }
+    if (bytes_read == 0)
+      break;
+    gcry_md_write(hasher->hd, hasher->buf, bytes_read);
+    hasher->pos += bytes_read;
+  }
+  if (end != -1 && hasher->pos < end) {
+    /* The file got shorter. */
+    hasher->failed = TRUE;
+  }
+}
+
+/* Called by wiretap with the data it reads from the file. */
+static void
+hasher_raw_data(gint64 offset, const guint8 *data, size_t len, void *user_data)
+{
+  file_hasher *hasher = (file_hasher *)user_data;
+  gint64 end = offset + (gint64)len;
+
+  if (hasher->failed || end <= hasher->pos)
+    return;
+  if (offset > hasher->pos) {
+    /* Wiretap skipped some of the file. */
+    hasher_read_file(hasher, offset);
+    if (hasher->failed)
+      return;
+  }
+  gcry_md_write(hasher->hd, data + (hasher->pos - offset), (size_t)(end - hasher->pos));
+  hasher->pos = end;
+}
+
+static void
+hasher_start(file_hasher *hasher, const char *filename, wtap *wth)
+{
+  hasher->filename = filename;
+  hasher->fd = -1;
+  hasher->buf = NULL;
+  hasher->pos = 0;
+  hasher->failed = FALSE;
+  if (gcry_md_open(&hasher->hd, GCRY_MD_SHA256, 0) != 0) {
+    hasher->hd = NULL;
+    hasher->failed = TRUE;
+    return;
+  }
+  gcry_md_enable(hasher->hd, GCRY_MD_RMD160);
+  gcry_md_enable(hasher->hd, GCRY_MD_SHA1);
+  wtap_set_cb_raw_data(wth, hasher_raw_data, hasher);
+}
+
+static void
+hasher_finish(file_hasher *hasher, capture_info *cf_info)
+{
+  wtap_set_cb_raw_data(cf_info->wth, NULL, NULL);
+
+  /* Hash whatever wiretap didn't read. */
+  if (!hasher->failed)
+    hasher_read_file(hasher, -1);
+  if (!hasher->failed) {
+    gcry_md_final(hasher->hd);
+    hash_to_str(gcry_md_read(hasher->hd, GCRY_MD_SHA256), HASH_SIZE_SHA256, cf_info->file_sha256);
+    hash_to_str(gcry_md_read(hasher->hd, GCRY_MD_RMD160), HASH_SIZE_RMD160, cf_info->file_rmd160);
+    hash_to_str(gcry_md_read(hasher->hd, GCRY_MD_SHA1), HASH_SIZE_SHA1, cf_info->file_sha1);
+  }
+  if (hasher->fd != -1)
+    ws_close(hasher->fd);
+  g_free(hasher->buf);
+  gcry_md_close(hasher->hd);
 }
 
 static int
-process_cap_file(const char *filename, gboolean need_separator)
+process_cap_file(capinfos_job *job)
 {
+  const char           *filename = job->filename;
+  capture_info         *cf_info = &job->cf_info;
   int                   status = 0;
   int                   err;
   gchar                *err_info;
@@ -1171,7 +1368,6 @@ process_cap_file(const char *filename, gboolean need_separator)
   guint32               snaplen_max_inferred =          0;
   wtap_rec              rec;
   Buffer                buf;
-  capture_info          cf_info;
   gboolean              have_times = TRUE;
   nstime_t              start_time;
   int                   start_time_tsprec;
@@ -1183,16 +1379,22 @@ process_cap_file(const char *filename, gboolean need_separator)
   order_t               order = IN_ORDER;
   guint                 i;
   wtapng_iface_descriptions_t *idb_info;
+  file_hasher           hasher;
+
+  g_strlcpy(cf_info->file_sha256, "<unknown>", HASH_STR_SIZE);
+  g_strlcpy(cf_info->file_rmd160, "<unknown>", HASH_STR_SIZE);
+  g_strlcpy(cf_info->file_sha1, "<unknown>", HASH_STR_SIZE);
 
-  cf_info.wth = wtap_open_offline(filename, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
-  if (!cf_info.wth) {
+  cf_info->wth = wtap_open_offline(filename, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
+  if (!cf_info->wth) {
     cfile_open_failure_message("capinfos", filename, err, err_info);
     return 2;
   }
 
-  if (need_separator && long_report) {
-    printf("\n");
-  }
+  wtap_set_header_scan(cf_info->wth, header_scan);
+
+  if (cap_file_hashes)
+    hasher_start(&hasher, filename, cf_info->wth);
 
   nstime_set_zero(&start_time);
   start_time_tsprec = WTAP_TSPREC_UNKNOWN;
@@ -1201,35 +1403,30 @@ process_cap_file(const char *filename, gboolean need_separator)
   nstime_set_zero(&cur_time);
   nstime_set_zero(&prev_time);
 
-  cf_info.encap_counts = g_new0(int,WTAP_NUM_ENCAP_TYPES);
+  cf_info->encap_counts = g_new0(int,WTAP_NUM_ENCAP_TYPES);
 
-  idb_info = wtap_file_get_idb_info(cf_info.wth);
+  idb_info = wtap_file_get_idb_info(cf_info->wth);
 
   g_assert(idb_info->interface_data != NULL);
 
-  cf_info.num_interfaces = idb_info->interface_data->len;
-  cf_info.interface_packet_counts  = g_array_sized_new(FALSE, TRUE, sizeof(guint32), cf_info.num_interfaces);
-  g_array_set_size(cf_info.interface_packet_counts, cf_info.num_interfaces);
-  cf_info.pkt_interface_id_unknown = 0;
+  cf_info->num_interfaces = idb_info->interface_data->len;
+  cf_info->interface_packet_counts  = g_array_sized_new(FALSE, TRUE, sizeof(guint32), cf_info->num_interfaces);
+  g_array_set_size(cf_info->interface_packet_counts, cf_info->num_interfaces);
+  cf_info->pkt_interface_id_unknown = 0;
 
   g_free(idb_info);
   idb_info = NULL;
 
   /* Register callbacks for new name<->address maps from the file and
      decryption secrets from the file. */
-  wtap_set_cb_new_ipv4(cf_info.wth, count_ipv4_address);
-  wtap_set_cb_new_ipv6(cf_info.wth, count_ipv6_address);
-  wtap_set_cb_new_secrets(cf_info.wth, count_decryption_secret);
-
-  /* Zero out the counters for the callbacks. */
-  num_ipv4_addresses = 0;
-  num_ipv6_addresses = 0;
-  num_decryption_secrets = 0;
+  wtap_set_cb_new_ipv4(cf_info->wth, count_ipv4_address);
+  wtap_set_cb_new_ipv6(cf_info->wth, count_ipv6_address);
+  wtap_set_cb_new_secrets(cf_info->wth, count_decryption_secret);
 
   /* Tally up data that we need to parse through the file to find */
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
-  while (wtap_read(cf_info.wth, &rec, &buf, &err, &err_info, &data_offset))  {
+  while (wtap_read(cf_info->wth, &rec, &buf, &err, &err_info, &data_offset))  {
     if (rec.presence_flags & WTAP_HAS_TS) {
       prev_time = cur_time;
       cur_time = rec.ts;
@@ -1274,45 +1471,45 @@ process_cap_file(const char *filename, gboolean need_separator)
 
       if ((rec.rec_header.packet_header.pkt_encap > 0) &&
           (rec.rec_header.packet_header.pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
-        cf_info.encap_counts[rec.rec_header.packet_header.pkt_encap] += 1;
+        cf_info->encap_counts[rec.rec_header.packet_header.pkt_encap] += 1;
       } else {
-        fprintf(stderr, "capinfos: Unknown packet encapsulation %d in frame %u of file \"%s\"\n",
-                rec.rec_header.packet_header.pkt_encap, packet, filename);
+        cmdarg_err("Unknown packet encapsulation %d in frame %u of file \"%s\"",
+                   rec.rec_header.packet_header.pkt_encap, packet, filename);
       }
 
       /* Packet interface_id info */
       if (rec.presence_flags & WTAP_HAS_INTERFACE_ID) {
-        /* cf_info.num_interfaces is size, not index, so it's one more than max index */
-        if (rec.rec_header.packet_header.interface_id >= cf_info.num_interfaces) {
+        /* cf_info->num_interfaces is size, not index, so it's one more than max index */
+        if (rec.rec_header.packet_header.interface_id >= cf_info->num_interfaces) {
           /*
            * OK, re-fetch the number of interfaces, as there might have
            * been an interface that was in the middle of packets, and
            * grow the array to be big enough for the new number of
            * interfaces.
            */
-          idb_info = wtap_file_get_idb_info(cf_info.wth);
+          idb_info = wtap_file_get_idb_info(cf_info->wth);
 
-          cf_info.num_interfaces = idb_info->interface_data->len;
-          g_array_set_size(cf_info.interface_packet_counts, cf_info.num_interfaces);
+          cf_info->num_interfaces = idb_info->interface_data->len;
+          g_array_set_size(cf_info->interface_packet_counts, cf_info->num_interfaces);
 
           g_free(idb_info);
           idb_info = NULL;
         }
-        if (rec.rec_header.packet_header.interface_id < cf_info.num_interfaces) {
-          g_array_index(cf_info.interface_packet_counts, guint32,
+        if (rec.rec_header.packet_header.interface_id < cf_info->num_interfaces) {
+          g_array_index(cf_info->interface_packet_counts, guint32,
                         rec.rec_header.packet_header.interface_id) += 1;
         }
         else {
-          cf_info.pkt_interface_id_unknown += 1;
+          cf_info->pkt_interface_id_unknown += 1;
         }
       }
       else {
         /* it's for interface_id 0 */
-        if (cf_info.num_interfaces != 0) {
-          g_array_index(cf_info.interface_packet_counts, guint32, 0) += 1;
+        if (cf_info->num_interfaces != 0) {
+          g_array_index(cf_info->interface_packet_counts, guint32, 0) += 1;
         }
         else {
-          cf_info.pkt_interface_id_unknown += 1;
+          cf_info->pkt_interface_id_unknown += 1;
         }
       }
     }
@@ -1321,117 +1518,321 @@ process_cap_file(const char *filename, gboolean need_separator)
   wtap_rec_cleanup(&rec);
   ws_buffer_free(&buf);
 
+  if (cap_file_hashes)
+    hasher_finish(&hasher, cf_info);
+
   /*
    * Get IDB info strings.
    * We do this at the end, so we can get information for all IDBs in
    * the file, even those that come after packet records.
    */
-  idb_info = wtap_file_get_idb_info(cf_info.wth);
+  idb_info = wtap_file_get_idb_info(cf_info->wth);
 
-  cf_info.idb_info_strings = g_array_sized_new(FALSE, FALSE, sizeof(gchar*), cf_info.num_interfaces);
-  cf_info.num_interfaces = idb_info->interface_data->len;
-  for (i = 0; i < cf_info.num_interfaces; i++) {
+  cf_info->idb_info_strings = g_array_sized_new(FALSE, FALSE, sizeof(gchar*), cf_info->num_interfaces);
+  cf_info->num_interfaces = idb_info->interface_data->len;
+  for (i = 0; i < cf_info->num_interfaces; i++) {
     const wtap_block_t if_descr = g_array_index(idb_info->interface_data, wtap_block_t, i);
     gchar *s = wtap_get_debug_if_descr(if_descr, 21, "\n");
-    g_array_append_val(cf_info.idb_info_strings, s);
+    g_array_append_val(cf_info->idb_info_strings, s);
   }
 
   g_free(idb_info);
   idb_info = NULL;
 
   if (err != 0) {
-    fprintf(stderr,
-        "capinfos: An error occurred after reading %u packets from \"%s\".\n",
+    cmdarg_err("An error occurred after reading %u packets from \"%s\".",
         packet, filename);
     cfile_read_failure_message("capinfos", filename, err, err_info);
     if (err == WTAP_ERR_SHORT_READ) {
         /* Don't give up completely with this one. */
         status = 1;
-        fprintf(stderr,
-          "  (will continue anyway, checksums might be incorrect)\n");
+        cmdarg_err_cont("  (will continue anyway, checksums might be incorrect)");
     } else {
-        cleanup_capture_info(&cf_info);
-        wtap_close(cf_info.wth);
+        cleanup_capture_info(cf_info);
+        wtap_close(cf_info->wth);
+        cf_info->wth = NULL;
         return 2;
     }
   }
 
   /* File size */
-  size = wtap_file_size(cf_info.wth, &err);
+  size = wtap_file_size(cf_info->wth, &err);
   if (size == -1) {
-    fprintf(stderr,
-        "capinfos: Can't get size of \"%s\": %s.\n",
+    cmdarg_err("Can't get size of \"%s\": %s.",
         filename, g_strerror(err));
-    cleanup_capture_info(&cf_info);
-    wtap_close(cf_info.wth);
+    cleanup_capture_info(cf_info);
+    wtap_close(cf_info->wth);
+    cf_info->wth = NULL;
     return 2;
   }
 
-  cf_info.filesize = size;
+  cf_info->filesize = size;
 
   /* File Type */
-  cf_info.file_type = wtap_file_type_subtype(cf_info.wth);
-  cf_info.compression_type = wtap_get_compression_type(cf_info.wth);
+  cf_info->file_type = wtap_file_type_subtype(cf_info->wth);
+  cf_info->compression_type = wtap_get_compression_type(cf_info->wth);
 
   /* File Encapsulation */
-  cf_info.file_encap = wtap_file_encap(cf_info.wth);
+  cf_info->file_encap = wtap_file_encap(cf_info->wth);
 
-  cf_info.file_tsprec = wtap_file_tsprec(cf_info.wth);
+  cf_info->file_tsprec = wtap_file_tsprec(cf_info->wth);
 
   /* Packet size limit (snaplen) */
-  cf_info.snaplen = wtap_snapshot_length(cf_info.wth);
-  if (cf_info.snaplen > 0)
-    cf_info.snap_set = TRUE;
+  cf_info->snaplen = wtap_snapshot_length(cf_info->wth);
+  if (cf_info->snaplen > 0)
+    cf_info->snap_set = TRUE;
   else
-    cf_info.snap_set = FALSE;
+    cf_info->snap_set = FALSE;
 
-  cf_info.snaplen_min_inferred = snaplen_min_inferred;
-  cf_info.snaplen_max_inferred = snaplen_max_inferred;
+  cf_info->snaplen_min_inferred = snaplen_min_inferred;
+  cf_info->snaplen_max_inferred = snaplen_max_inferred;
 
   /* # of packets */
-  cf_info.packet_count = packet;
+  cf_info->packet_count = packet;
 
   /* File Times */
-  cf_info.times_known = have_times;
-  cf_info.start_time = start_time;
-  cf_info.start_time_tsprec = start_time_tsprec;
-  cf_info.stop_time = stop_time;
-  cf_info.stop_time_tsprec = stop_time_tsprec;
-  nstime_delta(&cf_info.duration, &stop_time, &start_time);
+  cf_info->times_known = have_times;
+  cf_info->start_time = start_time;
+  cf_info->start_time_tsprec = start_time_tsprec;
+  cf_info->stop_time = stop_time;
+  cf_info->stop_time_tsprec = stop_time_tsprec;
+  nstime_delta(&cf_info->duration, &stop_time, &start_time);
   /* Duration precision is the higher of the start and stop time precisions. */
-  if (cf_info.stop_time_tsprec > cf_info.start_time_tsprec)
-    cf_info.duration_tsprec = cf_info.stop_time_tsprec;
+  if (cf_info->stop_time_tsprec > cf_info->start_time_tsprec)
+    cf_info->duration_tsprec = cf_info->stop_time_tsprec;
   else
-    cf_info.duration_tsprec = cf_info.start_time_tsprec;
-  cf_info.know_order = know_order;
-  cf_info.order = order;
+    cf_info->duration_tsprec = cf_info->start_time_tsprec;
+  cf_info->know_order = know_order;
+  cf_info->order = order;
 
   /* Number of packet bytes */
-  cf_info.packet_bytes = bytes;
+  cf_info->packet_bytes = bytes;
 
-  cf_info.data_rate   = 0.0;
-  cf_info.packet_rate = 0.0;
-  cf_info.packet_size = 0.0;
+  cf_info->data_rate   = 0.0;
+  cf_info->packet_rate = 0.0;
+  cf_info->packet_size = 0.0;
 
   if (packet > 0) {
     double delta_time = nstime_to_sec(&stop_time) - nstime_to_sec(&start_time);
     if (delta_time > 0.0) {
-      cf_info.data_rate   = (double)bytes  / delta_time; /* Data rate per second */
-      cf_info.packet_rate = (double)packet / delta_time; /* packet rate per second */
+      cf_info->data_rate   = (double)bytes  / delta_time; /* Data rate per second */
+      cf_info->packet_rate = (double)packet / delta_time; /* packet rate per second */
     }
-    cf_info.packet_size = (double)bytes / packet;                  /* Avg packet size      */
+    cf_info->packet_size = (double)bytes / packet;                  /* Avg packet size      */
   }
 
-  if (long_report) {
-    print_stats(filename, &cf_info);
-  } else {
-    print_stats_table(filename, &cf_info);
+  /* The report is generated, and the file closed, by the main thread. */
+  return status;
+}
+
+static void
+run_job(gpointer data, gpointer user_data _U_)
+{
+  capinfos_job *job = (capinfos_job *)data;
+
+  g_private_set(&current_job, job);
+  job->status = process_cap_file(job);
+  g_private_set(&current_job, NULL);
+
+  g_mutex_lock(&job_mutex);
+  job->done = TRUE;
+  g_cond_broadcast(&job_done);
+  g_mutex_unlock(&job_mutex);
+}
+
+static void
+free_cache_entry(gpointer data)
+{
+  cache_entry *entry = (cache_entry *)data;
+
+  g_free(entry->report);
+  g_free(entry);
+}
+
+/* Everything, other than the file, that the report for a file depends on. */
+static gchar *
+cache_signature(void)
+{
+  const gboolean flags[] = {
+    long_report, machine_readable, time_as_secs,
+    cap_file_type, cap_file_encap, cap_snaplen, cap_packet_count,
+    cap_file_size, cap_comment, cap_file_more_info, cap_file_idb,
+    cap_file_nrb, cap_file_dsb, cap_data_size, cap_duration,
+    cap_start_time, cap_end_time, cap_data_rate_byte, cap_data_rate_bit,
+    cap_packet_size, cap_packet_rate, cap_order, cap_file_hashes
+  };
+  const gchar *tz = g_getenv("TZ");
+  GString *signature = g_string_new(VERSION " ");
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS(flags); i++)
+    g_string_append_c(signature, flags[i] ? '1' : '0');
+  g_string_append_printf(signature, " %d %d %s %s", field_separator,
+                         quote_char, decimal_point, tz ? tz : "");
+  return g_string_free(signature, FALSE);
+}
+
+static void
+load_cache(void)
+{
+  gchar *contents, *header, **lines, **fields;
+  guint i;
+  cache_entry *entry;
+
+  report_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_cache_entry);
+
+  /* A missing or unreadable cache just means everything is processed. */
+  if (!g_file_get_contents(cache_file, &contents, NULL, NULL))
+    return;
+
+  header = cache_signature();
+  lines = g_strsplit(contents, "\n", -1);
+  g_free(contents);
+  if (lines[0] != NULL && g_str_has_prefix(lines[0], CACHE_HEADER) &&
+      strcmp(lines[0] + strlen(CACHE_HEADER), header) == 0) {
+    for (i = 1; lines[i] != NULL; i++) {
+      fields = g_strsplit(lines[i], "\t", 4);
+      if (g_strv_length(fields) == 4) {
+        entry = g_new(cache_entry, 1);
+        entry->size = g_ascii_strtoll(fields[0], NULL, 10);
+        entry->mtime = g_ascii_strtoll(fields[1], NULL, 10);
+        entry->report = g_strcompress(fields[3]);
+        g_hash_table_replace(report_cache, g_strcompress(fields[2]), entry);
+      }
+      g_strfreev(fields);
+    }
+  }
+  g_strfreev(lines);
+  g_free(header);
+}
+
+static void
+save_cache(void)
+{
+  gchar *tmp_file, *header, *path, *report_str;
+  FILE *fh;
+  GHashTableIter iter;
+  gpointer key, value;
+  cache_entry *entry;
+  gboolean ok;
+
+  tmp_file = g_strdup_printf("%s.tmp", cache_file);
+  fh = ws_fopen(tmp_file, "w");
+  if (fh == NULL) {
+    cmdarg_err("Can't write cache file \"%s\": %s.", tmp_file, g_strerror(errno));
+    g_free(tmp_file);
+    return;
+  }
+  header = cache_signature();
+  fprintf(fh, CACHE_HEADER "%s\n", header);
+  g_free(header);
+  g_hash_table_iter_init(&iter, report_cache);
+  while (g_hash_table_iter_next(&iter, &key, &value)) {
+    entry = (cache_entry *)value;
+    path = g_strescape((const gchar *)key, NULL);
+    report_str = g_strescape(entry->report, NULL);
+    fprintf(fh, "%" G_GINT64_MODIFIER "d\t%" G_GINT64_MODIFIER "d\t%s\t%s\n",
+            entry->size, entry->mtime, path, report_str);
+    g_free(path);
+    g_free(report_str);
   }
+  ok = !ferror(fh);
+  if (fclose(fh) != 0)
+    ok = FALSE;
+  /* Replace the old cache only once the new one is complete. */
+  if (!ok || ws_rename(tmp_file, cache_file) != 0) {
+    cmdarg_err("Can't write cache file \"%s\": %s.", cache_file, g_strerror(errno));
+    ws_unlink(tmp_file);
+  }
+  g_free(tmp_file);
+}
 
-  cleanup_capture_info(&cf_info);
-  wtap_close(cf_info.wth);
+/* Process the file, unless there's a report for it in the cache. */
+static void
+start_job(capinfos_job *job, const char *filename)
+{
+  ws_statb64 statb;
+  cache_entry *entry;
+
+  job->filename = filename;
+  if (report_cache != NULL && ws_stat64(filename, &statb) == 0) {
+    job->stat_known = TRUE;
+    job->size = (gint64)statb.st_size;
+    job->mtime = (gint64)statb.st_mtime;
+    entry = (cache_entry *)g_hash_table_lookup(report_cache, filename);
+    if (entry != NULL && entry->size == job->size && entry->mtime == job->mtime) {
+      job->report = g_strdup(entry->report);
+      job->done = TRUE;
+      return;
+    }
+  }
+  if (job_pool != NULL)
+    g_thread_pool_push(job_pool, job, NULL);
+  else
+    run_job(job, NULL);
+}
 
-  return status;
+/* Wait for the file to be processed, then print what's to be printed. */
+static int
+finish_job(capinfos_job *job, gboolean *need_separator)
+{
+  cache_entry *entry;
+
+  g_mutex_lock(&job_mutex);
+  while (!job->done)
+    g_cond_wait(&job_done, &job_mutex);
+  g_mutex_unlock(&job_mutex);
+
+  if (job->errors != NULL) {
+    fflush(stdout);
+    fputs(job->errors->str, stderr);
+  }
+  if (job->status == 2)
+    return job->status;
+
+  if (job->report == NULL) {
+    g_string_truncate(report, 0);
+    if (long_report)
+      print_stats(job->filename, &job->cf_info);
+    else
+      print_stats_table(job->filename, &job->cf_info);
+    job->report = g_strdup(report->str);
+  }
+
+  /* Either it succeeded or it got a "short read" but printed
+     information anyway.  Note that we need a blank line before
+     the next file's information, to separate it from the
+     previous file. */
+  if (*need_separator && long_report)
+    printf("\n");
+  fputs(job->report, stdout);
+  *need_separator = TRUE;
+
+  if (report_cache != NULL && job->status == 0 && job->stat_known) {
+    entry = g_new(cache_entry, 1);
+    entry->size = job->size;
+    entry->mtime = job->mtime;
+    entry->report = job->report;
+    job->report = NULL;
+    g_hash_table_replace(report_cache, g_strdup(job->filename), entry);
+  }
+  return job->status;
+}
+
+static void
+free_job(capinfos_job *job)
+{
+  if (job->cf_info.wth != NULL) {
+    cleanup_capture_info(&job->cf_info);
+    wtap_close(job->cf_info.wth);
+    job->cf_info.wth = NULL;
+  }
+  if (job->errors != NULL) {
+    g_string_free(job->errors, TRUE);
+    job->errors = NULL;
+  }
+  g_free(job->report);
+  job->report = NULL;
 }
 
 static void
@@ -1493,6 +1894,14 @@ print_usage(FILE *output)
   fprintf(output, "  -C cancel processing if file open fails (default is to continue)\n");
   fprintf(output, "  -A generate all infos (default)\n");
   fprintf(output, "  -K disable displaying the capture comment\n");
+  fprintf(output, "  --threads <n>\n");
+  fprintf(output, "     process up to <n> files at the same time (default 1)\n");
+  fprintf(output, "  --cache <file>\n");
+  fprintf(output, "     reuse the infos in <file> for files whose size and\n");
+  fprintf(output, "     modification time haven't changed, and save the infos there\n");
+  fprintf(output, "  --full-read\n");
+  fprintf(output, "     read the data of every packet, rather than skipping over\n");
+  fprintf(output, "     it where the file format allows\n");
   fprintf(output, "\n");
   fprintf(output, "Options are processed from left to right order with later options superseding\n");
   fprintf(output, "or adding to earlier options.\n");
@@ -1508,6 +1917,17 @@ print_usage(FILE *output)
 static void
 failure_warning_message(const char *msg_format, va_list ap)
 {
+  capinfos_job *job = (capinfos_job *)g_private_get(&current_job);
+
+  /* Messages about a file are printed along with its report. */
+  if (job != NULL) {
+    if (job->errors == NULL)
+      job->errors = g_string_new(NULL);
+    g_string_append(job->errors, "capinfos: ");
+    g_string_append_vprintf(job->errors, msg_format, ap);
+    g_string_append_c(job->errors, '\n');
+    return;
+  }
   fprintf(stderr, "capinfos: ");
   vfprintf(stderr, msg_format, ap);
   fprintf(stderr, "\n");
@@ -1519,19 +1939,19 @@ failure_warning_message(const char *msg_format, va_list ap)
 static void
 failure_message_cont(const char *msg_format, va_list ap)
 {
+  capinfos_job *job = (capinfos_job *)g_private_get(&current_job);
+
+  if (job != NULL) {
+    if (job->errors == NULL)
+      job->errors = g_string_new(NULL);
+    g_string_append_vprintf(job->errors, msg_format, ap);
+    g_string_append_c(job->errors, '\n');
+    return;
+  }
   vfprintf(stderr, msg_format, ap);
   fprintf(stderr, "\n");
 }
 
-static void
-hash_to_str(const unsigned char *hash, size_t length, char *str) {
-  int i;
-
-  for (i = 0; i < (int) length; i++) {
-    g_snprintf(str+(i*2), 3, "%02x", hash[i]);
-  }
-}
-
 int
 main(int argc, char *argv[])
 {
@@ -1539,17 +1959,26 @@ main(int argc, char *argv[])
   gboolean need_separator = FALSE;
   int    opt;
   int    overall_error_status = EXIT_SUCCESS;
+
+#define LONGOPT_THREADS              LONGOPT_BASE_APPLICATION+1
+#define LONGOPT_CACHE                LONGOPT_BASE_APPLICATION+2
+#define LONGOPT_FULL_READ            LONGOPT_BASE_APPLICATION+3
+
   static const struct option long_options[] = {
+      {"threads", required_argument, NULL, LONGOPT_THREADS},
+      {"cache", required_argument, NULL, LONGOPT_CACHE},
+      {"full-read", no_argument, NULL, LONGOPT_FULL_READ},
       {"help", no_argument, NULL, 'h'},
       {"version", no_argument, NULL, 'v'},
       {0, 0, 0, 0 }
   };
 
   int status = 0;
-  FILE  *fh;
-  char  *hash_buf = NULL;
-  gcry_md_hd_t hd = NULL;
-  size_t hash_bytes;
+  capinfos_job *jobs = NULL;
+  int    num_files = 0;
+  int    num_started = 0;
+  int    window;
+  int    i;
 
   /* Set the C-language locale to the native environment. */
   setlocale(LC_ALL, "");
@@ -1593,6 +2022,19 @@ main(int argc, char *argv[])
 
     switch (opt) {
 
+      case LONGOPT_THREADS:
+        num_threads = get_positive_int(optarg, "number of threads");
+        break;
+
+      case LONGOPT_CACHE:
+        g_free(cache_file);
+        cache_file = g_strdup(optarg);
+        break;
+
+      case LONGOPT_FULL_READ:
+        header_scan = FALSE;
+        break;
+
       case 't':
         if (report_all_infos) disable_all_infos();
         cap_file_type = TRUE;
@@ -1778,63 +2220,67 @@ main(int argc, char *argv[])
     goto exit;
   }
 
+  report = g_string_new(NULL);
+
   if (!long_report && table_report_header) {
     print_stats_table_header();
+    fputs(report->str, stdout);
   }
 
   if (cap_file_hashes) {
     gcry_check_version(NULL);
-    gcry_md_open(&hd, GCRY_MD_SHA256, 0);
-    if (hd) {
-      gcry_md_enable(hd, GCRY_MD_RMD160);
-      gcry_md_enable(hd, GCRY_MD_SHA1);
-    }
-    hash_buf = (char *)g_malloc(HASH_BUF_SIZE);
   }
 
-  overall_error_status = 0;
+  if (cache_file != NULL) {
+    load_cache();
+  }
 
-  for (opt = optind; opt < argc; opt++) {
+  if (num_threads > 1) {
+    job_pool = g_thread_pool_new(run_job, NULL, num_threads, TRUE, NULL);
+  }
 
-    g_strlcpy(file_sha256, "<unknown>", HASH_STR_SIZE);
-    g_strlcpy(file_rmd160, "<unknown>", HASH_STR_SIZE);
-    g_strlcpy(file_sha1, "<unknown>", HASH_STR_SIZE);
+  overall_error_status = 0;
 
-    if (cap_file_hashes) {
-      fh = ws_fopen(argv[opt], "rb");
-      if (fh && hd) {
-        while((hash_bytes = fread(hash_buf, 1, HASH_BUF_SIZE, fh)) > 0) {
-          gcry_md_write(hd, hash_buf, hash_bytes);
-        }
-        gcry_md_final(hd);
-        hash_to_str(gcry_md_read(hd, GCRY_MD_SHA256), HASH_SIZE_SHA256, file_sha256);
-        hash_to_str(gcry_md_read(hd, GCRY_MD_RMD160), HASH_SIZE_RMD160, file_rmd160);
-        hash_to_str(gcry_md_read(hd, GCRY_MD_SHA1), HASH_SIZE_SHA1, file_sha1);
-      }
-      if (fh) fclose(fh);
-      if (hd) gcry_md_reset(hd);
+  /*
+   * Keep only a few files per thread open, waiting to be reported on,
+   * so that a slow file doesn't leave lots of others open.
+   */
+  num_files = argc - optind;
+  jobs = g_new0(capinfos_job, num_files);
+  window = job_pool != NULL ? (int)num_threads * 4 : 1;
+  for (i = 0; i < num_files; i++) {
+    while (num_started < num_files && num_started < i + window) {
+      start_job(&jobs[num_started], argv[optind + num_started]);
+      num_started++;
     }
 
-    status = process_cap_file(argv[opt], need_separator);
+    status = finish_job(&jobs[i], &need_separator);
+    free_job(&jobs[i]);
     if (status) {
       /* Something failed.  It's been reported; remember that processing
          one file failed and, if -C was specified, stop. */
       overall_error_status = status;
       if (stop_after_failure)
-        goto exit;
-    }
-    if (status != 2) {
-      /* Either it succeeded or it got a "short read" but printed
-         information anyway.  Note that we need a blank line before
-         the next file's information, to separate it from the
-         previous file. */
-      need_separator = TRUE;
+        break;
     }
   }
 
 exit:
-  g_free(hash_buf);
-  gcry_md_close(hd);
+  if (job_pool != NULL) {
+    /* Don't start on any more files, but wait for those being processed. */
+    g_thread_pool_free(job_pool, TRUE, TRUE);
+    job_pool = NULL;
+  }
+  for (i = 0; i < num_started; i++)
+    free_job(&jobs[i]);
+  g_free(jobs);
+  if (report_cache != NULL) {
+    save_cache();
+    g_hash_table_destroy(report_cache);
+  }
+  g_free(cache_file);
+  if (report != NULL)
+    g_string_free(report, TRUE);
   wtap_cleanup();
   free_progdirs();
   return overall_error_status;
@@ -89,6 +89,7 @@ capture_opts_init(capture_options *capture_opts)
     capture_opts->save_file                       = NULL;
     capture_opts->group_read_access               = FALSE;
     capture_opts->use_pcapng                      = TRUE;             /* Save as pcapng by default */
+    capture_opts->shm_buffer_path                 = NULL;
     capture_opts->real_time_mode                  = TRUE;
     capture_opts->show_info                       = TRUE;
     capture_opts->restart                         = FALSE;
@@ -141,6 +142,7 @@ capture_opts_cleanup(capture_options *capture_opts)
         capture_opts->all_ifaces = NULL;
     }
     g_free(capture_opts->save_file);
+    g_free(capture_opts->shm_buffer_path);
 }
 
 /* log content of capture_opts */
@@ -273,6 +273,8 @@ typedef struct capture_options_tag {
     gchar             *save_file;             /**< the capture file name */
     gboolean           group_read_access;     /**< TRUE is group read permission needs to be set */
     gboolean           use_pcapng;            /**< TRUE if file format is pcapng */
+    gchar             *shm_buffer_path;       /**< if set, dumpcap also copies what it
+                                                   writes to this shared memory buffer */
 
     /* GUI related */
     gboolean           real_time_mode;        /**< Update list of packets in real time */
@@ -0,0 +1,320 @@
+/* capture-queue.c
+ * Single-producer, single-consumer queue of captured packets
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "caputils/capture-queue.h"
+
+/*
+ * Records are stored one after the other in segments of the buffer.  Each
+ * record starts with its length; a length of RECORD_NEXT means the rest of
+ * the segment is unused and the next record is at the start of the next
+ * segment, as it is if a record ends right at the end of a segment.
+ * Records are padded so that they all start on an 8-byte boundary.
+ */
+#define RECORD_HDR_LEN	8
+#define RECORD_ALIGN	8
+#define RECORD_NEXT	G_MAXUINT32
+#define RECORD_SPACE(len) \
+	(((len) + RECORD_HDR_LEN + RECORD_ALIGN - 1) & ~(gsize)(RECORD_ALIGN - 1))
+
+/* The segment size if there's no byte limit. */
+#define CAPTURE_QUEUE_SEGMENT_SIZE	(4 * 1024 * 1024)
+
+typedef struct _capture_queue_segment {
+	/* Set by the producer before it puts anything in the next segment. */
+	struct _capture_queue_segment *next;
+	guint8 *buf;
+} capture_queue_segment_t;
+
+/*
+ * Positions and counts only ever go up, and wrap around at 2^32; there are
+ * never more than CAPTURE_QUEUE_MAX_BYTES bytes in the queue, so the
+ * difference between two positions is right even after they've wrapped
+ * around.  The padding at the end of a segment counts as bytes in use.
+ *
+ * The fields each side writes are kept apart, so that the two threads
+ * don't keep taking the same cache line away from each other.
+ */
+struct _capture_queue {
+	guint seg_size;
+	guint byte_limit;
+	guint record_limit;
+	gsize max_record_len;
+
+	/*
+	 * A segment that the consumer is done with, for the producer to
+	 * use next; only the consumer sets it, and only the producer clears
+	 * it, so a queue that isn't growing doesn't allocate anything.
+	 */
+	gpointer spare;
+
+	/* Written by the producer. */
+	volatile gint head;		/* end of the committed records */
+	volatile gint records_in;
+	volatile gint drops;
+	capture_queue_segment_t *prod_seg;
+	guint prod_off;			/* in prod_seg */
+	guint prod_head;
+	guint prod_records;
+	capture_queue_segment_t *reserved_seg;
+	guint reserved_off;		/* end of the reserved record */
+	guint reserved_head;
+	guint reserved_bytes;		/* bytes in use once it's committed */
+	guint reserved_records;
+	guint peak_bytes;
+	guint peak_records;
+	guint8 pad[64];
+
+	/* Written by the consumer. */
+	volatile gint tail;		/* start of the first unreleased record */
+	volatile gint records_out;
+	capture_queue_segment_t *cons_seg;
+	guint cons_off;			/* in cons_seg */
+	guint cons_tail;
+	guint cons_next;		/* end of the peeked record */
+	guint cons_next_off;
+	guint cons_records;
+};
+
+static capture_queue_segment_t *
+capture_queue_segment_new(capture_queue_t *queue)
+{
+	capture_queue_segment_t *seg;
+
+	seg = (capture_queue_segment_t *)g_try_malloc(sizeof *seg);
+	if (seg == NULL)
+		return NULL;
+	seg->buf = (guint8 *)g_try_malloc(queue->seg_size);
+	if (seg->buf == NULL) {
+		g_free(seg);
+		return NULL;
+	}
+	seg->next = NULL;
+	return seg;
+}
+
+static void
+capture_queue_segment_free(capture_queue_segment_t *seg)
+{
+	g_free(seg->buf);
+	g_free(seg);
+}
+
+capture_queue_t *
+capture_queue_new(gsize byte_limit, guint record_limit, gsize max_record_len)
+{
+	capture_queue_t *queue;
+	gsize seg_size;
+
+	if (max_record_len > CAPTURE_QUEUE_MAX_BYTES / 4)
+		max_record_len = CAPTURE_QUEUE_MAX_BYTES / 4;
+	if (byte_limit > CAPTURE_QUEUE_MAX_BYTES)
+		byte_limit = CAPTURE_QUEUE_MAX_BYTES;
+
+	/*
+	 * With a byte limit, a few segments hold that much, so not much
+	 * more than that is ever allocated.  Every segment has room for
+	 * the biggest record even if it's reserved while the queue is just
+	 * under its byte limit.
+	 */
+	seg_size = byte_limit != 0 ? byte_limit / 4 : CAPTURE_QUEUE_SEGMENT_SIZE;
+	seg_size = MAX(seg_size, 2 * RECORD_SPACE(max_record_len));
+	seg_size = MAX(seg_size, 4096);
+	seg_size = (seg_size + RECORD_ALIGN - 1) & ~(gsize)(RECORD_ALIGN - 1);
+
+	queue = g_new0(capture_queue_t, 1);
+	queue->seg_size = (guint)seg_size;
+	queue->byte_limit = (guint)byte_limit;
+	queue->record_limit = record_limit;
+	queue->max_record_len = max_record_len;
+	queue->prod_seg = g_new0(capture_queue_segment_t, 1);
+	queue->prod_seg->buf = (guint8 *)g_malloc(seg_size);
+	queue->cons_seg = queue->prod_seg;
+	queue->reserved_seg = queue->prod_seg;
+	return queue;
+}
+
+void
+capture_queue_free(capture_queue_t *queue)
+{
+	capture_queue_segment_t *seg, *next;
+
+	if (queue == NULL)
+		return;
+	for (seg = queue->cons_seg; seg != NULL; seg = next) {
+		next = seg->next;
+		capture_queue_segment_free(seg);
+	}
+	if (queue->spare != NULL)
+		capture_queue_segment_free((capture_queue_segment_t *)queue->spare);
+	g_free(queue);
+}
+
+void *
+capture_queue_reserve(capture_queue_t *queue, gsize len)
+{
+	capture_queue_segment_t *seg = queue->prod_seg;
+	capture_queue_segment_t *next;
+	guint tail = (guint)g_atomic_int_get(&queue->tail);
+	guint used = queue->prod_head - tail;
+	guint records = queue->prod_records -
+	    (guint)g_atomic_int_get(&queue->records_out);
+	guint space, off = queue->prod_off, pad = 0;
+	gboolean next_seg;
+	guint32 rec_len;
+
+	if (len > queue->max_record_len ||
+	    (queue->byte_limit != 0 && used >= queue->byte_limit) ||
+	    (queue->record_limit != 0 && records >= queue->record_limit))
+		goto drop;
+
+	space = (guint)RECORD_SPACE(len);
+	next_seg = off + space > queue->seg_size;
+	if (next_seg)
+		pad = queue->seg_size - off;
+	if ((gsize)used + pad + space > CAPTURE_QUEUE_MAX_BYTES)
+		goto drop;
+
+	if (next_seg) {
+		/*
+		 * Move on to the next segment, unless an earlier reservation
+		 * that wasn't committed already set one up.
+		 */
+		if (seg->next == NULL) {
+			next = (capture_queue_segment_t *)g_atomic_pointer_get(&queue->spare);
+			if (next != NULL &&
+			    !g_atomic_pointer_compare_and_exchange(&queue->spare, next, NULL))
+				next = NULL;
+			if (next == NULL)
+				next = capture_queue_segment_new(queue);
+			if (next == NULL)
+				goto drop;
+			next->next = NULL;
+			seg->next = next;
+		}
+		if (off + RECORD_HDR_LEN <= queue->seg_size) {
+			rec_len = RECORD_NEXT;
+			memcpy(seg->buf + off, &rec_len, sizeof rec_len);
+		}
+		seg = seg->next;
+		off = 0;
+	}
+	rec_len = (guint32)len;
+	memcpy(seg->buf + off, &rec_len, sizeof rec_len);
+
+	queue->reserved_seg = seg;
+	queue->reserved_off = off + space;
+	queue->reserved_head = queue->prod_head + pad + space;
+	queue->reserved_bytes = used + pad + space;
+	queue->reserved_records = records + 1;
+	return seg->buf + off + RECORD_HDR_LEN;
+
+drop:
+	g_atomic_int_inc(&queue->drops);
+	return NULL;
+}
+
+void
+capture_queue_commit(capture_queue_t *queue)
+{
+	if (queue->reserved_head == queue->prod_head)
+		return;
+
+	queue->prod_seg = queue->reserved_seg;
+	queue->prod_off = queue->reserved_off;
+	queue->prod_head = queue->reserved_head;
+	queue->prod_records++;
+	g_atomic_int_set(&queue->records_in, (gint)queue->prod_records);
+	g_atomic_int_set(&queue->head, (gint)queue->prod_head);
+
+	if (queue->reserved_bytes > queue->peak_bytes)
+		queue->peak_bytes = queue->reserved_bytes;
+	if (queue->reserved_records > queue->peak_records)
+		queue->peak_records = queue->reserved_records;
+}
+
+void *
+capture_queue_peek(capture_queue_t *queue, gsize *len)
+{
+	guint head = (guint)g_atomic_int_get(&queue->head);
+	capture_queue_segment_t *seg = queue->cons_seg;
+	guint32 rec_len = 0;
+
+	if (queue->cons_tail == head)
+		return NULL;
+
+	if (queue->cons_off + RECORD_HDR_LEN <= queue->seg_size)
+		memcpy(&rec_len, seg->buf + queue->cons_off, sizeof rec_len);
+	if (queue->cons_off + RECORD_HDR_LEN > queue->seg_size ||
+	    rec_len == RECORD_NEXT) {
+		/*
+		 * The producer never ends with a move to the next segment,
+		 * so there's a record there, and it's done with this one.
+		 */
+		queue->cons_tail += queue->seg_size - queue->cons_off;
+		queue->cons_seg = seg->next;
+		queue->cons_off = 0;
+		if (!g_atomic_pointer_compare_and_exchange(&queue->spare, NULL, seg))
+			capture_queue_segment_free(seg);
+		seg = queue->cons_seg;
+		memcpy(&rec_len, seg->buf, sizeof rec_len);
+	}
+	queue->cons_next = queue->cons_tail + (guint)RECORD_SPACE(rec_len);
+	queue->cons_next_off = queue->cons_off + (guint)RECORD_SPACE(rec_len);
+	*len = rec_len;
+	return seg->buf + queue->cons_off + RECORD_HDR_LEN;
+}
+
+void
+capture_queue_release(capture_queue_t *queue)
+{
+	queue->cons_tail = queue->cons_next;
+	queue->cons_off = queue->cons_next_off;
+	queue->cons_records++;
+	g_atomic_int_set(&queue->records_out, (gint)queue->cons_records);
+	g_atomic_int_set(&queue->tail, (gint)queue->cons_tail);
+}
+
+gboolean
+capture_queue_is_empty(capture_queue_t *queue)
+{
+	return g_atomic_int_get(&queue->head) == g_atomic_int_get(&queue->tail);
+}
+
+void
+capture_queue_get_stats(capture_queue_t *queue, capture_queue_stats_t *stats)
+{
+	guint records_out = (guint)g_atomic_int_get(&queue->records_out);
+	guint tail = (guint)g_atomic_int_get(&queue->tail);
+
+	stats->records = (guint)g_atomic_int_get(&queue->records_in) - records_out;
+	stats->bytes = (guint)g_atomic_int_get(&queue->head) - tail;
+	stats->peak_records = queue->peak_records;
+	stats->peak_bytes = queue->peak_bytes;
+	stats->drops = (guint)g_atomic_int_get(&queue->drops);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,98 @@
+/* capture-queue.h
+ * Single-producer, single-consumer queue of captured packets
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CAPTURE_QUEUE_H__
+#define __CAPTURE_QUEUE_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A queue of variable-length records between one thread that reads
+ * packets from a capture source and the thread that writes them out.
+ *
+ * The records are stored one after the other in segments of a buffer.
+ * Segments the consumer is done with are reused, so unless the queue is
+ * growing, queueing a packet is a copy into the buffer and an atomic
+ * store, with no locking and no memory allocation.  If the queue is over
+ * its limits, or another segment can't be allocated, the record is
+ * dropped and counted.
+ */
+
+/* The most bytes a queue ever holds, with or without a byte limit. */
+#define CAPTURE_QUEUE_MAX_BYTES	(1U << 30)
+
+typedef struct _capture_queue capture_queue_t;
+
+typedef struct {
+	guint64 records;	/* records in the queue */
+	guint64 bytes;		/* bytes of the buffer in use */
+	guint64 peak_records;	/* most records ever in the queue */
+	guint64 peak_bytes;	/* most bytes of the buffer ever in use */
+	guint64 drops;		/* records that didn't fit */
+} capture_queue_stats_t;
+
+/*
+ * Create a queue that holds up to byte_limit bytes, or up to
+ * record_limit records, whichever comes first; 0 means no limit, other
+ * than CAPTURE_QUEUE_MAX_BYTES, to which a bigger byte_limit is cut down.
+ * As long as the queue is under its limits, a record of up to
+ * max_record_len bytes fits if there's memory for it.
+ */
+extern capture_queue_t *capture_queue_new(gsize byte_limit,
+    guint record_limit, gsize max_record_len);
+
+extern void capture_queue_free(capture_queue_t *queue);
+
+/*
+ * Producer: get room for a record of len bytes at the tail of the
+ * queue, or NULL if it doesn't fit.  The record isn't visible to the
+ * consumer until capture_queue_commit() is called.
+ */
+extern void *capture_queue_reserve(capture_queue_t *queue, gsize len);
+
+extern void capture_queue_commit(capture_queue_t *queue);
+
+/*
+ * Consumer: get the record at the head of the queue, without removing
+ * it, or NULL if the queue is empty.
+ */
+extern void *capture_queue_peek(capture_queue_t *queue, gsize *len);
+
+/* Consumer: remove the record returned by capture_queue_peek(). */
+extern void capture_queue_release(capture_queue_t *queue);
+
+/* Either side: TRUE if there's nothing for the consumer to read. */
+extern gboolean capture_queue_is_empty(capture_queue_t *queue);
+
+extern void capture_queue_get_stats(capture_queue_t *queue,
+    capture_queue_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAPTURE_QUEUE_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,521 @@
+/* capture-tpacket.c
+ * Capturing on Linux through TPACKET_V3 memory-mapped rings
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#if defined(HAVE_LIBPCAP) && defined(HAVE_TPACKET_V3)
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+
+#include <wsutil/pint.h>
+
+#include "caputils/capture-tpacket.h"
+
+/*
+ * Blocks are at least this big, so that the kernel hands over a good
+ * number of packets at a time, and there are at least this many of them.
+ */
+#define TPACKET_MIN_BLOCK_SIZE	(128 * 1024)
+#define TPACKET_MIN_BLOCKS	4
+
+/*
+ * No packet is bigger than this, even with segmentation offload, so
+ * there's no point making room for a bigger snapshot length.
+ */
+#define TPACKET_MAX_PACKET	65536
+
+#define VLAN_TAG_LEN	4
+
+/*
+ * struct sock_fprog; <linux/filter.h> can't be included along with
+ * libpcap's headers. A struct bpf_insn is laid out the same way as a
+ * struct sock_filter.
+ */
+struct tpacket_fprog {
+	unsigned short len;
+	struct bpf_insn *filter;
+};
+
+typedef struct {
+	int fd;
+	guint8 *map;
+	guint cur_block;
+	guint8 *vlan_buf;	/* for packets with their VLAN tag put back */
+	guint64 skipped;	/* outgoing copies of loopback packets */
+	guint64 kernel_packets;	/* running totals of the kernel's counters */
+	guint64 kernel_drops;
+	guint64 kernel_freezes;
+} tpacket_ring_t;
+
+struct _tpacket_capture {
+	int ifindex;
+	gboolean is_loopback;
+	int snaplen;
+	gboolean ts_nsec;
+	size_t block_size;
+	guint block_count;
+	guint num_rings;
+	tpacket_ring_t *rings;
+	gint break_loop;
+};
+
+static struct tpacket_block_desc *
+tpacket_current_block(tpacket_capture_t *tpc, tpacket_ring_t *ring)
+{
+	return (struct tpacket_block_desc *)(ring->map +
+	    ring->cur_block * tpc->block_size);
+}
+
+static gboolean
+tpacket_ring_open(tpacket_capture_t *tpc, tpacket_ring_t *ring,
+    int block_timeout, int *fanout_id, char *errmsg, size_t errmsg_len)
+{
+	static struct bpf_insn reject_all = BPF_STMT(BPF_RET|BPF_K, 0);
+	struct tpacket_fprog fprog = { 1, &reject_all };
+	int version = TPACKET_V3;
+	struct tpacket_req3 req;
+	struct sockaddr_ll sll;
+	void *map;
+	int fanout_arg;
+
+	/*
+	 * With a protocol of 0 nothing is received until the socket is
+	 * bound, and the filter then rejects everything until the real
+	 * one is attached, so that the ring doesn't start out with
+	 * packets that don't match it.
+	 */
+	ring->fd = socket(AF_PACKET, SOCK_RAW, 0);
+	if (ring->fd == -1) {
+		g_snprintf(errmsg, (gulong)errmsg_len,
+		    "Can't open a packet socket: %s", g_strerror(errno));
+		return FALSE;
+	}
+	if (setsockopt(ring->fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog,
+	    sizeof fprog) == -1 ||
+	    setsockopt(ring->fd, SOL_PACKET, PACKET_VERSION, &version,
+	    sizeof version) == -1) {
+		g_snprintf(errmsg, (gulong)errmsg_len,
+		    "Can't set up a TPACKET_V3 socket: %s", g_strerror(errno));
+		return FALSE;
+	}
+
+	/* For TPACKET_V3 only the block size limits the packet size. */
+	memset(&req, 0, sizeof req);
+	req.tp_block_size = (unsigned int)tpc->block_size;
+	req.tp_block_nr = tpc->block_count;
+	req.tp_frame_size = (unsigned int)tpc->block_size;
+	req.tp_frame_nr = tpc->block_count;
+	req.tp_retire_blk_tov = block_timeout;
+	if (setsockopt(ring->fd, SOL_PACKET, PACKET_RX_RING, &req,
+	    sizeof req) == -1) {
+		g_snprintf(errmsg, (gulong)errmsg_len,
+		    "Can't set up a capture ring of %u %u-byte blocks: %s",
+		    req.tp_block_nr, req.tp_block_size, g_strerror(errno));
+		return FALSE;
+	}
+	map = mmap(NULL, tpc->block_size * tpc->block_count,
+	    PROT_READ|PROT_WRITE, MAP_SHARED, ring->fd, 0);
+	if (map == MAP_FAILED) {
+		g_snprintf(errmsg, (gulong)errmsg_len,
+		    "Can't map the capture ring: %s", g_strerror(errno));
+		return FALSE;
+	}
+	ring->map = (guint8 *)map;
+
+	memset(&sll, 0, sizeof sll);
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons(ETH_P_ALL);
+	sll.sll_ifindex = tpc->ifindex;
+	if (bind(ring->fd, (struct sockaddr *)&sll, sizeof sll) == -1) {
+		g_snprintf(errmsg, (gulong)errmsg_len,
+		    "Can't bind a packet socket to the interface: %s",
+		    g_strerror(errno));
+		return FALSE;
+	}
+
+	if (tpc->num_rings > 1) {
+		/*
+		 * Spread the packets over the rings by flow, keeping the
+		 * fragments of a datagram together.
+		 */
+		fanout_arg = (PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG) << 16;
+#ifdef PACKET_FANOUT_FLAG_UNIQUEID
+		/* Have the kernel pick an ID that no other group is using. */
+		if (*fanout_id == -1)
+			fanout_arg |= PACKET_FANOUT_FLAG_UNIQUEID << 16;
+		else
+			fanout_arg |= *fanout_id;
+#else
+		if (*fanout_id == -1)
+			*fanout_id = getpid() & 0xffff;
+		fanout_arg |= *fanout_id;
+#endif
+		if (setsockopt(ring->fd, SOL_PACKET, PACKET_FANOUT, &fanout_arg,
+		    sizeof fanout_arg) == -1) {
+			g_snprintf(errmsg, (gulong)errmsg_len,
+			    "Can't add a packet socket to a fanout group: %s",
+			    g_strerror(errno));
+			return FALSE;
+		}
+#ifdef PACKET_FANOUT_FLAG_UNIQUEID
+		if (*fanout_id == -1) {
+			socklen_t len = sizeof fanout_arg;
+
+			if (getsockopt(ring->fd, SOL_PACKET, PACKET_FANOUT,
+			    &fanout_arg, &len) == -1) {
+				g_snprintf(errmsg, (gulong)errmsg_len,
+				    "Can't get the packet fanout group: %s",
+				    g_strerror(errno));
+				return FALSE;
+			}
+			*fanout_id = fanout_arg & 0xffff;
+		}
+#endif
+	}
+
+	ring->vlan_buf = (guint8 *)g_malloc(tpc->block_size + VLAN_TAG_LEN);
+	return TRUE;
+}
+
+tpacket_capture_t *
+tpacket_capture_open(const char *name, int snaplen, gboolean ts_nsec,
+    size_t buffer_size, guint num_rings, int block_timeout,
+    char *errmsg, size_t errmsg_len)
+{
+	tpacket_capture_t *tpc;
+	struct ifreq ifr;
+	size_t packet_size, page_size;
+	int fanout_id = -1;
+	guint i;
+
+	if (strlen(name) >= sizeof ifr.ifr_name) {
+		g_snprintf(errmsg, (gulong)errmsg_len,
+		    "The interface name \"%s\" is too long", name);
+		return NULL;
+	}
+
+	tpc = g_new0(tpacket_capture_t, 1);
+	tpc->snaplen = snaplen;
+	tpc->ts_nsec = ts_nsec;
+	tpc->num_rings = num_rings > 0 ? num_rings : 1;
+	tpc->rings = g_new0(tpacket_ring_t, tpc->num_rings);
+	for (i = 0; i < tpc->num_rings; i++)
+		tpc->rings[i].fd = -1;
+
+	/*
+	 * Each block has to be able to hold the biggest packet we'll keep,
+	 * along with the block and packet headers.
+	 */
+	packet_size = MIN((size_t)snaplen, TPACKET_MAX_PACKET);
+	packet_size += TPACKET_ALIGN(sizeof(struct tpacket_block_desc)) +
+	    TPACKET_ALIGN(TPACKET3_HDRLEN) + 16;
+	page_size = (size_t)sysconf(_SC_PAGESIZE);
+	tpc->block_size = MAX(TPACKET_MIN_BLOCK_SIZE, page_size);
+	while (tpc->block_size < packet_size)
+		tpc->block_size <<= 1;
+	tpc->block_count = (guint)MAX(buffer_size / tpc->block_size,
+	    TPACKET_MIN_BLOCKS);
+
+	/* Use the first socket to find out about the interface. */
+	tpc->rings[0].fd = socket(AF_PACKET, SOCK_RAW, 0);
+	if (tpc->rings[0].fd == -1) {
+		g_snprintf(errmsg, (gulong)errmsg_len,
+		    "Can't open a packet socket: %s", g_strerror(errno));
+		goto fail;
+	}
+	memset(&ifr, 0, sizeof ifr);
+	g_strlcpy(ifr.ifr_name, name, sizeof ifr.ifr_name);
+	if (ioctl(tpc->rings[0].fd, SIOCGIFINDEX, &ifr) == -1) {
+		g_snprintf(errmsg, (gulong)errmsg_len,
+		    "Can't get the index of interface %s: %s", name,
+		    g_strerror(errno));
+		goto fail;
+	}
+	tpc->ifindex = ifr.ifr_ifindex;
+	if (ioctl(tpc->rings[0].fd, SIOCGIFHWADDR, &ifr) == -1) {
+		g_snprintf(errmsg, (gulong)errmsg_len,
+		    "Can't get the hardware type of interface %s: %s", name,
+		    g_strerror(errno));
+		goto fail;
+	}
+	/*
+	 * We hand over packets as they are, which is only what libpcap
+	 * would do for Ethernet; everything else is left to libpcap.
+	 */
+	switch (ifr.ifr_hwaddr.sa_family) {
+
+	case ARPHRD_ETHER:
+		break;
+
+	case ARPHRD_LOOPBACK:
+		tpc->is_loopback = TRUE;
+		break;
+
+	default:
+		g_snprintf(errmsg, (gulong)errmsg_len,
+		    "Interface %s isn't an Ethernet or loopback device", name);
+		goto fail;
+	}
+	close(tpc->rings[0].fd);
+	tpc->rings[0].fd = -1;
+
+	for (i = 0; i < tpc->num_rings; i++) {
+		if (!tpacket_ring_open(tpc, &tpc->rings[i], block_timeout,
+		    &fanout_id, errmsg, errmsg_len))
+			goto fail;
+	}
+	return tpc;
+
+fail:
+	tpacket_capture_close(tpc);
+	return NULL;
+}
+
+gboolean
+tpacket_capture_setfilter(tpacket_capture_t *tpc, struct bpf_program *fcode,
+    char *errmsg, size_t errmsg_len)
+{
+	struct tpacket_fprog fprog;
+	guint i;
+	int dummy = 0;
+
+	if (fcode == NULL) {
+		/* Take away the filter that rejects everything. */
+		for (i = 0; i < tpc->num_rings; i++) {
+			if (setsockopt(tpc->rings[i].fd, SOL_SOCKET,
+			    SO_DETACH_FILTER, &dummy, sizeof dummy) == -1) {
+				g_snprintf(errmsg, (gulong)errmsg_len,
+				    "Can't remove the capture filter: %s",
+				    g_strerror(errno));
+				return FALSE;
+			}
+		}
+		return TRUE;
+	}
+
+	fprog.len = (unsigned short)fcode->bf_len;
+	fprog.filter = fcode->bf_insns;
+	for (i = 0; i < tpc->num_rings; i++) {
+		if (setsockopt(tpc->rings[i].fd, SOL_SOCKET, SO_ATTACH_FILTER,
+		    &fprog, sizeof fprog) == -1) {
+			g_snprintf(errmsg, (gulong)errmsg_len,
+			    "Can't attach the capture filter: %s",
+			    g_strerror(errno));
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+guint
+tpacket_capture_num_rings(const tpacket_capture_t *tpc)
+{
+	return tpc->num_rings;
+}
+
+/*
+ * The kernel takes VLAN tags out of the packets it hands over; put them
+ * back, as libpcap does.
+ */
+static const guint8 *
+tpacket_restore_vlan_tag(tpacket_ring_t *ring, const struct tpacket3_hdr *hdr,
+    const guint8 *data, struct pcap_pkthdr *pkthdr)
+{
+	guint16 tpid = ETH_P_8021Q;
+
+	if (hdr->hv1.tp_vlan_tci == 0 &&
+	    !(hdr->tp_status & TP_STATUS_VLAN_VALID))
+		return data;
+	if (pkthdr->caplen < 2 * ETH_ALEN)
+		return data;
+
+#ifdef TP_STATUS_VLAN_TPID_VALID
+	if (hdr->tp_status & TP_STATUS_VLAN_TPID_VALID)
+		tpid = hdr->hv1.tp_vlan_tpid;
+#endif
+	memcpy(ring->vlan_buf, data, 2 * ETH_ALEN);
+	phton16(ring->vlan_buf + 2 * ETH_ALEN, tpid);
+	phton16(ring->vlan_buf + 2 * ETH_ALEN + 2, (guint16)hdr->hv1.tp_vlan_tci);
+	memcpy(ring->vlan_buf + 2 * ETH_ALEN + VLAN_TAG_LEN,
+	    data + 2 * ETH_ALEN, pkthdr->caplen - 2 * ETH_ALEN);
+	pkthdr->caplen += VLAN_TAG_LEN;
+	pkthdr->len += VLAN_TAG_LEN;
+	return ring->vlan_buf;
+}
+
+static int
+tpacket_process_block(tpacket_capture_t *tpc, tpacket_ring_t *ring,
+    struct tpacket_block_desc *block, pcap_handler callback, u_char *user)
+{
+	const struct tpacket3_hdr *hdr;
+	const struct sockaddr_ll *sll;
+	const guint8 *data;
+	struct pcap_pkthdr pkthdr;
+	guint32 i;
+	int n = 0;
+
+	hdr = (const struct tpacket3_hdr *)((guint8 *)block +
+	    block->hdr.bh1.offset_to_first_pkt);
+	for (i = 0; i < block->hdr.bh1.num_pkts; i++,
+	    hdr = (const struct tpacket3_hdr *)((const guint8 *)hdr +
+	    hdr->tp_next_offset)) {
+		/*
+		 * On the loopback device every packet is seen both going
+		 * out and coming in; keep just one of them, as libpcap
+		 * does.
+		 */
+		sll = (const struct sockaddr_ll *)((const guint8 *)hdr +
+		    TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+		if (tpc->is_loopback && sll->sll_pkttype == PACKET_OUTGOING) {
+			ring->skipped++;
+			continue;
+		}
+
+		data = (const guint8 *)hdr + hdr->tp_mac;
+		pkthdr.caplen = hdr->tp_snaplen;
+		pkthdr.len = hdr->tp_len;
+		data = tpacket_restore_vlan_tag(ring, hdr, data, &pkthdr);
+		if (pkthdr.caplen > (bpf_u_int32)tpc->snaplen)
+			pkthdr.caplen = tpc->snaplen;
+		pkthdr.ts.tv_sec = hdr->tp_sec;
+		pkthdr.ts.tv_usec = tpc->ts_nsec ? hdr->tp_nsec :
+		    hdr->tp_nsec / 1000;
+		callback(user, &pkthdr, data);
+		n++;
+	}
+	return n;
+}
+
+int
+tpacket_capture_dispatch(tpacket_capture_t *tpc, guint ring_num, int timeout,
+    pcap_handler callback, u_char *user)
+{
+	tpacket_ring_t *ring = &tpc->rings[ring_num];
+	struct tpacket_block_desc *block;
+	struct pollfd pfd;
+	int err;
+	socklen_t len;
+	int n = 0;
+
+	block = tpacket_current_block(tpc, ring);
+	if (!(__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) &
+	    TP_STATUS_USER)) {
+		pfd.fd = ring->fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, timeout) == -1)
+			return errno == EINTR ? 0 : -1;
+		if (pfd.revents & (POLLERR|POLLHUP|POLLNVAL)) {
+			/* E.g., the interface went down. */
+			len = sizeof err;
+			if (getsockopt(ring->fd, SOL_SOCKET, SO_ERROR, &err,
+			    &len) == 0 && err != 0)
+				errno = err;
+			else
+				errno = ENETDOWN;
+			return -1;
+		}
+	}
+
+	/* Hand over every block that's ready, and give each one back. */
+	while (!g_atomic_int_get(&tpc->break_loop)) {
+		block = tpacket_current_block(tpc, ring);
+		if (!(__atomic_load_n(&block->hdr.bh1.block_status,
+		    __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+			break;
+		n += tpacket_process_block(tpc, ring, block, callback, user);
+		__atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL,
+		    __ATOMIC_RELEASE);
+		ring->cur_block = (ring->cur_block + 1) % tpc->block_count;
+	}
+	return n;
+}
+
+void
+tpacket_capture_breakloop(tpacket_capture_t *tpc)
+{
+	g_atomic_int_set(&tpc->break_loop, 1);
+}
+
+void
+tpacket_capture_ring_stats(tpacket_capture_t *tpc, guint ring_num,
+    tpacket_ring_stats_t *stats)
+{
+	tpacket_ring_t *ring = &tpc->rings[ring_num];
+	struct tpacket_stats_v3 kstats;
+	socklen_t len = sizeof kstats;
+
+	/* The kernel resets its counters whenever they're read. */
+	if (getsockopt(ring->fd, SOL_PACKET, PACKET_STATISTICS, &kstats,
+	    &len) == 0) {
+		ring->kernel_packets += kstats.tp_packets;
+		ring->kernel_drops += kstats.tp_drops;
+		ring->kernel_freezes += kstats.tp_freeze_q_cnt;
+	}
+	tpacket_ring_stats_compute(stats, ring->kernel_packets,
+	    ring->kernel_drops, ring->kernel_freezes, ring->skipped);
+}
+
+void
+tpacket_ring_stats_compute(tpacket_ring_stats_t *stats,
+    guint64 kernel_packets, guint64 kernel_drops, guint64 kernel_freezes,
+    guint64 skipped)
+{
+	/* Loopback packets are seen twice, but only one copy is kept. */
+	stats->received = kernel_packets - MIN(kernel_packets, skipped);
+	stats->drops = kernel_drops;
+	stats->captured = stats->received - MIN(stats->received, kernel_drops);
+	stats->freezes = kernel_freezes;
+}
+
+void
+tpacket_capture_close(tpacket_capture_t *tpc)
+{
+	guint i;
+
+	for (i = 0; i < tpc->num_rings; i++) {
+		if (tpc->rings[i].map != NULL)
+			munmap(tpc->rings[i].map,
+			    tpc->block_size * tpc->block_count);
+		if (tpc->rings[i].fd != -1)
+			close(tpc->rings[i].fd);
+		g_free(tpc->rings[i].vlan_buf);
+	}
+	g_free(tpc->rings);
+	g_free(tpc);
+}
+
+#endif /* HAVE_LIBPCAP && HAVE_TPACKET_V3 */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
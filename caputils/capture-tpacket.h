@@ -0,0 +1,117 @@
+/* capture-tpacket.h
+ * Capturing on Linux through TPACKET_V3 memory-mapped rings
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CAPTURE_TPACKET_H__
+#define __CAPTURE_TPACKET_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#if defined(HAVE_LIBPCAP) && defined(HAVE_TPACKET_V3)
+
+#include "wspcap.h"
+
+/*
+ * dumpcap can read packets from an Ethernet (or loopback) device itself,
+ * instead of through libpcap, using one or more AF_PACKET sockets with
+ * TPACKET_V3 rings. The kernel hands over whole blocks of packets at a
+ * time, which are passed to the callback one after the other and then
+ * returned to the kernel in one go.
+ *
+ * With more than one ring, the sockets are put in a PACKET_FANOUT group,
+ * which spreads the packets over the rings by flow, so that each ring can
+ * be read by its own thread.
+ *
+ * The device's pcap_t is still needed for the link-layer type, for
+ * compiling capture filters and for promiscuous or monitor mode.
+ */
+
+typedef struct _tpacket_capture tpacket_capture_t;
+
+typedef struct {
+	guint64 received;	/* packets that passed the filter, dropped or not */
+	guint64 captured;	/* packets that were put in the ring */
+	guint64 drops;		/* packets dropped because the ring was full */
+	guint64 freezes;	/* times the ring filled up */
+} tpacket_ring_stats_t;
+
+/*
+ * Open num_rings rings of about buffer_size bytes each on a device.
+ * Nothing is captured until a filter has been set.
+ *
+ * Returns NULL, with an error message in errmsg, if the device isn't one
+ * we can capture on this way.
+ */
+extern tpacket_capture_t *tpacket_capture_open(const char *name, int snaplen,
+    gboolean ts_nsec, size_t buffer_size, guint num_rings, int block_timeout,
+    char *errmsg, size_t errmsg_len);
+
+/*
+ * Attach a compiled capture filter, or none if fcode is NULL, to every
+ * ring, and start capturing.
+ */
+extern gboolean tpacket_capture_setfilter(tpacket_capture_t *tpc,
+    struct bpf_program *fcode, char *errmsg, size_t errmsg_len);
+
+extern guint tpacket_capture_num_rings(const tpacket_capture_t *tpc);
+
+/*
+ * Wait up to timeout milliseconds for the kernel to hand over a block on
+ * the given ring, then pass every packet in every block that's ready to
+ * callback, as pcap_dispatch() would.
+ *
+ * Returns the number of packets processed, 0 on timeout, or -1 on error,
+ * with errno set.
+ */
+extern int tpacket_capture_dispatch(tpacket_capture_t *tpc, guint ring,
+    int timeout, pcap_handler callback, u_char *user);
+
+/*
+ * Make every tpacket_capture_dispatch() call return once it's done with
+ * the block it's on.
+ */
+extern void tpacket_capture_breakloop(tpacket_capture_t *tpc);
+
+extern void tpacket_capture_ring_stats(tpacket_capture_t *tpc, guint ring,
+    tpacket_ring_stats_t *stats);
+
+/*
+ * Work out a ring's statistics from running totals of the kernel's
+ * counters. The kernel's packet count includes the dropped packets and
+ * the outgoing copies of loopback packets, "skipped" of which we threw
+ * away.
+ */
+extern void tpacket_ring_stats_compute(tpacket_ring_stats_t *stats,
+    guint64 kernel_packets, guint64 kernel_drops, guint64 kernel_freezes,
+    guint64 skipped);
+
+extern void tpacket_capture_close(tpacket_capture_t *tpc);
+
+#endif /* HAVE_LIBPCAP && HAVE_TPACKET_V3 */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAPTURE_TPACKET_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
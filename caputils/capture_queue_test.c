@@ -0,0 +1,293 @@
+/* capture_queue_test.c
+ * Tests of the queue of captured packets
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "caputils/capture-queue.h"
+
+/* Records are numbered, and record n is n % 1000 + 1 bytes of n % 251. */
+static gsize
+record_len(guint n)
+{
+    return n % 1000 + 1;
+}
+
+static gboolean
+push_record(capture_queue_t *queue, guint n)
+{
+    guint8 *rec = (guint8 *)capture_queue_reserve(queue, record_len(n));
+
+    if (rec == NULL)
+        return FALSE;
+    memset(rec, (int)(n % 251), record_len(n));
+    capture_queue_commit(queue);
+    return TRUE;
+}
+
+static void
+pop_record(capture_queue_t *queue, guint n)
+{
+    const guint8 *rec;
+    gsize len, i;
+
+    rec = (const guint8 *)capture_queue_peek(queue, &len);
+    g_assert_nonnull(rec);
+    g_assert_cmpuint(len, ==, record_len(n));
+    for (i = 0; i < len; i++)
+        g_assert_cmpuint(rec[i], ==, n % 251);
+    capture_queue_release(queue);
+}
+
+static void
+capture_queue_test_empty(void)
+{
+    capture_queue_t *queue = capture_queue_new(0, 0, 1000);
+    capture_queue_stats_t stats;
+    gsize len;
+
+    g_assert(capture_queue_is_empty(queue));
+    g_assert_null(capture_queue_peek(queue, &len));
+
+    /* Nothing's there until it's committed. */
+    g_assert_nonnull(capture_queue_reserve(queue, 10));
+    g_assert(capture_queue_is_empty(queue));
+    g_assert_null(capture_queue_peek(queue, &len));
+    capture_queue_commit(queue);
+    g_assert(!capture_queue_is_empty(queue));
+
+    /* Peeking again gets the same record. */
+    g_assert_nonnull(capture_queue_peek(queue, &len));
+    g_assert_cmpuint(len, ==, 10);
+    g_assert_nonnull(capture_queue_peek(queue, &len));
+    g_assert_cmpuint(len, ==, 10);
+    capture_queue_release(queue);
+    g_assert(capture_queue_is_empty(queue));
+
+    capture_queue_get_stats(queue, &stats);
+    g_assert_cmpuint(stats.records, ==, 0);
+    g_assert_cmpuint(stats.bytes, ==, 0);
+    g_assert_cmpuint(stats.peak_records, ==, 1);
+    g_assert_cmpuint(stats.drops, ==, 0);
+
+    capture_queue_free(queue);
+}
+
+/* Records keep going round, through the end of each segment into the
+   next one. */
+static void
+capture_queue_test_wraparound(void)
+{
+    capture_queue_t *queue = capture_queue_new(16 * 1024, 0, 1000);
+    capture_queue_stats_t stats;
+    guint in = 0, out = 0;
+
+    while (in < 100000) {
+        /* Keep a few records in the queue. */
+        while (push_record(queue, in)) {
+            in++;
+            if (in - out == 7)
+                break;
+        }
+        pop_record(queue, out++);
+    }
+    while (out < in)
+        pop_record(queue, out++);
+    g_assert(capture_queue_is_empty(queue));
+
+    capture_queue_get_stats(queue, &stats);
+    g_assert_cmpuint(stats.records, ==, 0);
+    g_assert_cmpuint(stats.bytes, ==, 0);
+    g_assert_cmpuint(stats.peak_records, ==, 7);
+    g_assert_cmpuint(stats.drops, ==, 0);
+
+    capture_queue_free(queue);
+}
+
+/* A record is dropped once the queue holds at least byte_limit bytes. */
+static void
+capture_queue_test_byte_limit(void)
+{
+    capture_queue_t *queue = capture_queue_new(16 * 1024, 0, 1000);
+    capture_queue_stats_t stats;
+    guint in = 0, out = 0;
+
+    while (push_record(queue, in))
+        in++;
+    capture_queue_get_stats(queue, &stats);
+    g_assert_cmpuint(stats.records, ==, in);
+    g_assert_cmpuint(stats.bytes, >=, 16 * 1024);
+    g_assert_cmpuint(stats.bytes, <, 16 * 1024 + 4096 + 1024);
+    g_assert_cmpuint(stats.drops, ==, 1);
+
+    g_assert(!push_record(queue, in));
+    g_assert(!push_record(queue, in));
+    capture_queue_get_stats(queue, &stats);
+    g_assert_cmpuint(stats.drops, ==, 3);
+
+    /* Once some records have been taken off, there's room again. */
+    while (stats.bytes >= 16 * 1024) {
+        pop_record(queue, out++);
+        capture_queue_get_stats(queue, &stats);
+    }
+    g_assert(push_record(queue, in++));
+    while (out < in)
+        pop_record(queue, out++);
+    g_assert(capture_queue_is_empty(queue));
+
+    /* A record that's too big is always dropped. */
+    g_assert_null(capture_queue_reserve(queue, 1001));
+    capture_queue_get_stats(queue, &stats);
+    g_assert_cmpuint(stats.drops, ==, 4);
+
+    capture_queue_free(queue);
+}
+
+static void
+capture_queue_test_record_limit(void)
+{
+    capture_queue_t *queue = capture_queue_new(0, 10, 1000);
+    capture_queue_stats_t stats;
+    guint n;
+
+    for (n = 0; n < 10; n++)
+        g_assert(push_record(queue, n));
+    g_assert(!push_record(queue, n));
+    pop_record(queue, 0);
+    g_assert(push_record(queue, 10));
+    for (n = 1; n <= 10; n++)
+        pop_record(queue, n);
+
+    capture_queue_get_stats(queue, &stats);
+    g_assert_cmpuint(stats.peak_records, ==, 10);
+    g_assert_cmpuint(stats.drops, ==, 1);
+
+    capture_queue_free(queue);
+}
+
+/* Without a byte limit, the queue grows as needed. */
+static void
+capture_queue_test_unlimited(void)
+{
+    capture_queue_t *queue = capture_queue_new(0, 0, 65536);
+    capture_queue_stats_t stats;
+    guint8 *rec;
+    gsize len;
+    guint n;
+
+    for (n = 0; n < 1200; n++) {
+        rec = (guint8 *)capture_queue_reserve(queue, 60000);
+        g_assert_nonnull(rec);
+        memset(rec, (int)(n % 251), 60000);
+        capture_queue_commit(queue);
+    }
+    capture_queue_get_stats(queue, &stats);
+    g_assert_cmpuint(stats.records, ==, 1200);
+    g_assert_cmpuint(stats.bytes, >, 64 * 1024 * 1024);
+    g_assert_cmpuint(stats.drops, ==, 0);
+
+    for (n = 0; n < 1200; n++) {
+        rec = (guint8 *)capture_queue_peek(queue, &len);
+        g_assert_nonnull(rec);
+        g_assert_cmpuint(len, ==, 60000);
+        g_assert_cmpuint(rec[0], ==, n % 251);
+        g_assert_cmpuint(rec[59999], ==, n % 251);
+        capture_queue_release(queue);
+    }
+    g_assert(capture_queue_is_empty(queue));
+
+    capture_queue_free(queue);
+}
+
+#define THREADED_RECORDS 200000
+
+static gpointer
+producer_thread(gpointer data)
+{
+    capture_queue_t *queue = (capture_queue_t *)data;
+    guint n;
+
+    for (n = 0; n < THREADED_RECORDS; n++) {
+        /* Drop records rather than wait, as dumpcap does. */
+        push_record(queue, n);
+    }
+    return NULL;
+}
+
+/* Whatever the consumer gets while the producer is adding to the queue is
+   intact and in order, and everything else was counted as dropped. */
+static void
+capture_queue_test_threaded(void)
+{
+    capture_queue_t *queue = capture_queue_new(64 * 1024, 0, 1000);
+    capture_queue_stats_t stats;
+    GThread *thread;
+    const guint8 *rec;
+    gsize len;
+    guint received = 0;
+    guint n = 0;
+    gboolean done = FALSE;
+
+    thread = g_thread_new("capture_queue producer", producer_thread, queue);
+    while (!done || !capture_queue_is_empty(queue)) {
+        if (!done && capture_queue_is_empty(queue)) {
+            capture_queue_get_stats(queue, &stats);
+            done = received + stats.drops == THREADED_RECORDS;
+            g_thread_yield();
+            continue;
+        }
+        rec = (const guint8 *)capture_queue_peek(queue, &len);
+        g_assert_nonnull(rec);
+        /* Skip over the numbers of the dropped records. */
+        while (record_len(n) != len || rec[0] != n % 251)
+            n++;
+        g_assert_cmpuint(rec[len - 1], ==, n % 251);
+        capture_queue_release(queue);
+        received++;
+        n++;
+    }
+    g_thread_join(thread);
+
+    capture_queue_get_stats(queue, &stats);
+    g_assert_cmpuint(received + stats.drops, ==, THREADED_RECORDS);
+    g_assert_cmpuint(n, <=, THREADED_RECORDS);
+
+    capture_queue_free(queue);
+}
+
+int
+main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/capture_queue/empty", capture_queue_test_empty);
+    g_test_add_func("/capture_queue/wraparound", capture_queue_test_wraparound);
+    g_test_add_func("/capture_queue/byte_limit", capture_queue_test_byte_limit);
+    g_test_add_func("/capture_queue/record_limit", capture_queue_test_record_limit);
+    g_test_add_func("/capture_queue/unlimited", capture_queue_test_unlimited);
+    g_test_add_func("/capture_queue/threaded", capture_queue_test_threaded);
+
+    return g_test_run();
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
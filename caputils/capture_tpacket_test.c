@@ -0,0 +1,92 @@
+/* capture_tpacket_test.c
+ * Tests of the TPACKET_V3 capture statistics
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "caputils/capture-tpacket.h"
+
+#if defined(HAVE_LIBPCAP) && defined(HAVE_TPACKET_V3)
+
+/* The kernel counts dropped packets as packets too. */
+static void
+capture_tpacket_test_drops(void)
+{
+    tpacket_ring_stats_t stats;
+
+    tpacket_ring_stats_compute(&stats, 1000, 0, 0, 0);
+    g_assert_cmpuint(stats.received, ==, 1000);
+    g_assert_cmpuint(stats.captured, ==, 1000);
+    g_assert_cmpuint(stats.drops, ==, 0);
+
+    tpacket_ring_stats_compute(&stats, 1000, 250, 3, 0);
+    g_assert_cmpuint(stats.received, ==, 1000);
+    g_assert_cmpuint(stats.captured, ==, 750);
+    g_assert_cmpuint(stats.drops, ==, 250);
+    g_assert_cmpuint(stats.freezes, ==, 3);
+    g_assert_cmpuint(stats.captured + stats.drops, ==, stats.received);
+
+    /* Everything was dropped. */
+    tpacket_ring_stats_compute(&stats, 40, 40, 1, 0);
+    g_assert_cmpuint(stats.received, ==, 40);
+    g_assert_cmpuint(stats.captured, ==, 0);
+}
+
+/* Each loopback packet is seen going out and coming in, and the outgoing
+   copy is thrown away. */
+static void
+capture_tpacket_test_loopback(void)
+{
+    tpacket_ring_stats_t stats;
+
+    tpacket_ring_stats_compute(&stats, 200, 0, 0, 100);
+    g_assert_cmpuint(stats.received, ==, 100);
+    g_assert_cmpuint(stats.captured, ==, 100);
+
+    tpacket_ring_stats_compute(&stats, 200, 20, 1, 90);
+    g_assert_cmpuint(stats.received, ==, 110);
+    g_assert_cmpuint(stats.captured, ==, 90);
+    g_assert_cmpuint(stats.drops, ==, 20);
+
+    /* The counters were read before the kernel had counted packets
+       that we've already seen. */
+    tpacket_ring_stats_compute(&stats, 10, 5, 0, 20);
+    g_assert_cmpuint(stats.received, ==, 0);
+    g_assert_cmpuint(stats.captured, ==, 0);
+}
+
+#endif /* HAVE_LIBPCAP && HAVE_TPACKET_V3 */
+
+int
+main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+#if defined(HAVE_LIBPCAP) && defined(HAVE_TPACKET_V3)
+    g_test_add_func("/capture_tpacket/drops", capture_tpacket_test_drops);
+    g_test_add_func("/capture_tpacket/loopback", capture_tpacket_test_loopback);
+#endif
+
+    return g_test_run();
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
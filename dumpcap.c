@@ -53,11 +53,14 @@
 #include "caputils/capture_ifinfo.h"
 #include "caputils/capture-pcap-util.h"
 #include "caputils/capture-pcap-util-int.h"
+#include "caputils/capture-queue.h"
+#include "caputils/capture-tpacket.h"
 #ifdef _WIN32
 #include "caputils/capture-wpcap.h"
 #endif /* _WIN32 */
 
 #include "writecap/pcapio.h"
+#include "writecap/async_writer.h"
 
 #ifndef _WIN32
 #include <sys/un.h>
@@ -81,6 +84,7 @@
 #include "wsutil/inet_addr.h"
 #include "wsutil/time_util.h"
 #include "wsutil/please_report_bug.h"
+#include "wsutil/shm_ring.h"
 
 #include "caputils/ws80211_utils.h"
 
@@ -111,11 +115,19 @@ FILE *debug_log;   /* for logging debug messages to  */
                    /*  is defined                    */
 #endif
 
-static GAsyncQueue *pcap_queue;
-static gint64 pcap_queue_bytes;
-static gint64 pcap_queue_packets;
+/*
+ * With threads, each thread reading a source queues its packets on a
+ * queue of its own, from which the main thread writes them out; the limits
+ * apply to each queue.  The main thread waits on writer_cond when all the
+ * queues are empty, and the readers only signal it when writer_waiting is
+ * set.
+ */
 static gint64 pcap_queue_byte_limit = 0;
 static gint64 pcap_queue_packet_limit = 0;
+static GPrivate producer_queue;     /* the queue of the thread we're in */
+static GMutex writer_mutex;
+static GCond writer_cond;
+static gint writer_waiting;
 
 static gboolean capture_child = FALSE; /* FALSE: standalone call, TRUE: this is an Wireshark capture child */
 #ifdef _WIN32
@@ -197,6 +209,12 @@ typedef struct _capture_src {
     int                          snaplen;
     int                          linktype;
     gboolean                     ts_nsec;                /**< TRUE if we're using nanosecond precision. */
+#ifdef HAVE_TPACKET_V3
+    tpacket_capture_t           *tpacket;                /**< Our own TPACKET_V3 rings, read instead of pcap_h, or NULL */
+    GThread                    **tpacket_tids;           /**< Threads reading the rings after the first one */
+#endif
+    capture_queue_t            **queues;                 /**< With threads, one queue per thread reading this source */
+    guint                        num_queues;
                                                          /**< capture pipe (unix only "input file") */
     gboolean                     from_cap_pipe;          /**< TRUE if we are capturing data from a capture pipe */
     gboolean                     from_cap_socket;        /**< TRUE if we're capturing from socket */
@@ -259,6 +277,8 @@ typedef struct _loop_data {
     FILE     *pdh;
     int       save_file_fd;
     char     *io_buffer;           /**< Our IO buffer if we increase the size from the standard size */
+    shm_ring_t *shm_ring;          /**< Shared memory copy of the output for our parent, if any */
+    async_writer_t *writer;        /**< Writes the output file(s) in a thread of its own, if not NULL */
     guint64   bytes_written;       /**< Bytes written for the current file. */
     /* autostop conditions */
     int       packets_written;     /**< Packets written for the current file. */
@@ -269,13 +289,15 @@ typedef struct _loop_data {
     int      interval_s;
 } loop_data;
 
+/*
+ * A packet or pcapng block in a queue; the data follows it.
+ */
 typedef struct _pcap_queue_element {
-    capture_src        *pcap_src;
     union {
         struct pcap_pkthdr  phdr;
         pcapng_block_header_t  bh;
     } u;
-    u_char             *pd;
+    guint64             ts;         /**< nanoseconds since the epoch, or 0 for pcapng blocks */
 } pcap_queue_element;
 
 /*
@@ -319,6 +341,14 @@ static gboolean need_timeout_workaround;
 
 #define WRITER_THREAD_TIMEOUT 100000 /* usecs */
 
+/*
+ * With --async-write, the output is copied into blocks of this size, which
+ * are written by a thread of their own; if all of them are waiting to be
+ * written, the capture waits as well.
+ */
+#define ASYNC_WRITE_BLOCK_SIZE (1024 * 1024)
+#define ASYNC_WRITE_NUM_BLOCKS 16
+
 static void
 console_log_handler(const char *log_domain, GLogLevelFlags log_level,
                     const char *message, gpointer user_data _U_);
@@ -327,6 +357,11 @@ console_log_handler(const char *log_domain, GLogLevelFlags log_level,
 static capture_options global_capture_opts;
 static gboolean quiet = FALSE;
 static gboolean use_threads = FALSE;
+#ifdef HAVE_TPACKET_V3
+static gboolean use_tpacket = FALSE;   /* read Ethernet devices through our own TPACKET_V3 rings */
+static guint tpacket_fanout = 1;       /* number of rings, each with its own thread, per device */
+#endif
+static gboolean async_write = FALSE;   /* write the output file(s) from a separate thread */
 static guint64 start_time;
 
 static void capture_loop_write_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
@@ -346,6 +381,10 @@ static void WS_NORETURN exit_main(int err);
 static void report_new_capture_file(const char *filename);
 static void report_packet_count(unsigned int packet_count);
 static void report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32 flushed, guint32 ps_ifdrop, gchar *name);
+static void report_queue_stats(capture_src *pcap_src, const gchar *name);
+#ifdef HAVE_TPACKET_V3
+static void report_tpacket_ring_stats(capture_src *pcap_src, const gchar *name);
+#endif
 static void report_capture_error(const char *error_msg, const char *secondary_error_msg);
 static void report_cfilter_error(capture_options *capture_opts, guint i, const char *errmsg);
 
@@ -425,12 +464,25 @@ print_usage(FILE *output)
     fprintf(output, "  --capture-comment <comment>\n");
     fprintf(output, "                           add a capture comment to the output file\n");
     fprintf(output, "                           (only for pcapng)\n");
+    fprintf(output, "  --shm-buffer <path>      also copy the output to a shared memory buffer\n");
+    fprintf(output, "                           created by the program reading the file\n");
+    if (async_writer_is_supported()) {
+        fprintf(output, "  --async-write            write the output file(s) from a separate thread,\n");
+        fprintf(output, "                           in large blocks\n");
+    }
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -N <packet_limit>        maximum number of packets buffered within dumpcap\n");
+    fprintf(output, "                           for each interface\n");
     fprintf(output, "  -C <byte_limit>          maximum number of bytes used for buffering packets\n");
-    fprintf(output, "                           within dumpcap\n");
+    fprintf(output, "                           within dumpcap for each interface\n");
     fprintf(output, "  -t                       use a separate thread per interface\n");
+#ifdef HAVE_TPACKET_V3
+    fprintf(output, "  --tpacket                read Ethernet interfaces through TPACKET_V3 rings\n");
+    fprintf(output, "                           rather than through libpcap\n");
+    fprintf(output, "  --fanout <N>             spread each interface's packets over N rings,\n");
+    fprintf(output, "                           each read by its own thread (implies --tpacket)\n");
+#endif
     fprintf(output, "  -q                       don't report packet capture counts\n");
     fprintf(output, "  -v, --version            print version information and exit\n");
     fprintf(output, "  -h, --help               display this help and exit\n");
@@ -2595,6 +2647,99 @@ pcapng_pipe_dispatch(loop_data *ld, capture_src *pcap_src, char *errmsg, size_t
     return -1;
 }
 
+#ifdef HAVE_TPACKET_V3
+/*
+ * Read an Ethernet device through our own TPACKET_V3 rings, rather than
+ * through libpcap, if we can.  The pcap_t stays open, as it's what put
+ * the device into promiscuous or monitor mode, and we still use it to
+ * compile capture filters.
+ */
+static void
+capture_loop_open_tpacket(capture_src *pcap_src, interface_options *interface_opts)
+{
+    char   errmsg[MSG_MAX_LENGTH+1];
+    size_t buffer_size;
+
+    if (pcap_src->linktype != DLT_EN10MB) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_WARNING,
+              "Not using TPACKET_V3 rings for %s: it isn't an Ethernet device",
+              interface_opts->name);
+        return;
+    }
+
+    buffer_size = interface_opts->buffer_size > 0 ?
+        (size_t)interface_opts->buffer_size * 1024 * 1024 : 2 * 1024 * 1024;
+    pcap_src->tpacket = tpacket_capture_open(interface_opts->name,
+        pcap_snapshot(pcap_src->pcap_h), pcap_src->ts_nsec, buffer_size,
+        tpacket_fanout, CAP_READ_TIMEOUT, errmsg, sizeof errmsg);
+    if (pcap_src->tpacket == NULL) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_WARNING,
+              "Not using TPACKET_V3 rings for %s: %s", interface_opts->name, errmsg);
+        return;
+    }
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+          "capture_loop_open_tpacket: %s, %u ring(s)", interface_opts->name,
+          tpacket_capture_num_rings(pcap_src->tpacket));
+}
+
+/*
+ * Put the capture filter, if any, on the rings, and make the pcap_t
+ * reject everything so that the kernel doesn't copy every packet twice.
+ * If that doesn't work, close the rings and go back to libpcap.
+ */
+static gboolean
+capture_loop_init_tpacket_filter(capture_src *pcap_src, const gchar *name,
+                                 struct bpf_program *fcode)
+{
+    static struct bpf_insn reject_all_insn = BPF_STMT(BPF_RET|BPF_K, 0);
+    struct bpf_program     reject_all = { 1, &reject_all_insn };
+    char                   errmsg[MSG_MAX_LENGTH+1];
+
+    if (!tpacket_capture_setfilter(pcap_src->tpacket, fcode, errmsg, sizeof errmsg)) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_WARNING,
+              "Not using TPACKET_V3 rings for %s: %s", name, errmsg);
+        tpacket_capture_close(pcap_src->tpacket);
+        pcap_src->tpacket = NULL;
+        return FALSE;
+    }
+    if (pcap_setfilter(pcap_src->pcap_h, &reject_all) < 0) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+              "capture_loop_init_tpacket_filter: can't quiet the pcap_t for %s: %s",
+              name, pcap_geterr(pcap_src->pcap_h));
+    }
+    return TRUE;
+}
+#endif
+
+/*
+ * Get the statistics for a capture device.  If we're reading it through
+ * our own rings, the pcap_t isn't seeing any packets, so use the rings'
+ * counts.
+ */
+static int
+capture_loop_get_stats(capture_src *pcap_src, struct pcap_stat *stats)
+{
+#ifdef HAVE_TPACKET_V3
+    tpacket_ring_stats_t ring_stats;
+    guint                ring;
+#endif
+
+    if (pcap_stats(pcap_src->pcap_h, stats) < 0)
+        return -1;
+#ifdef HAVE_TPACKET_V3
+    if (pcap_src->tpacket != NULL) {
+        stats->ps_recv = 0;
+        stats->ps_drop = 0;
+        for (ring = 0; ring < tpacket_capture_num_rings(pcap_src->tpacket); ring++) {
+            tpacket_capture_ring_stats(pcap_src->tpacket, ring, &ring_stats);
+            stats->ps_recv += (u_int)ring_stats.received;
+            stats->ps_drop += (u_int)ring_stats.drops;
+        }
+    }
+#endif
+    return 0;
+}
+
 /** Open the capture input file (pcap or capture pipe).
  *  Returns TRUE if it succeeds, FALSE otherwise. */
 static gboolean
@@ -2709,6 +2854,11 @@ capture_loop_open_input(capture_options *capture_opts, loop_data *ld,
                 return FALSE;
             }
             pcap_src->linktype = get_pcap_datalink(pcap_src->pcap_h, interface_opts->name);
+#ifdef HAVE_TPACKET_V3
+            if (use_tpacket) {
+                capture_loop_open_tpacket(pcap_src, interface_opts);
+            }
+#endif
         } else {
             /* We couldn't open "iface" as a network device. */
             /* Try to open it as a pipe */
@@ -2800,6 +2950,68 @@ capture_loop_open_input(capture_options *capture_opts, loop_data *ld,
     return TRUE;
 }
 
+/*
+ * Create the queues that the threads reading a source put its packets on:
+ * one, or, with TPACKET_V3 fanout, one per ring.
+ */
+static void
+capture_loop_create_queues(capture_src *pcap_src)
+{
+    gsize max_record_len;
+    guint i;
+
+    if (pcap_src->from_cap_pipe) {
+        /* We might not have read the pipe's header yet. */
+        max_record_len = MAX(pcap_src->cap_pipe_max_pkt_size, WTAP_MAX_PACKET_SIZE_STANDARD);
+    } else {
+        /* Leave room for a VLAN tag put back by the TPACKET_V3 code. */
+        max_record_len = pcap_snapshot(pcap_src->pcap_h) + 4;
+    }
+    /* Don't make the queue huge for the odd giant packet. */
+    max_record_len = MIN(max_record_len,
+                         MAX((gsize)pcap_queue_byte_limit, WTAP_MAX_PACKET_SIZE_STANDARD));
+
+    pcap_src->num_queues = 1;
+#ifdef HAVE_TPACKET_V3
+    if (pcap_src->tpacket != NULL)
+        pcap_src->num_queues = tpacket_capture_num_rings(pcap_src->tpacket);
+#endif
+    pcap_src->queues = g_new(capture_queue_t *, pcap_src->num_queues);
+    for (i = 0; i < pcap_src->num_queues; i++) {
+        pcap_src->queues[i] = capture_queue_new((gsize)pcap_queue_byte_limit,
+                                                (guint)pcap_queue_packet_limit,
+                                                sizeof(pcap_queue_element) + max_record_len);
+    }
+}
+
+static void
+capture_loop_free_queues(capture_src *pcap_src)
+{
+    guint i;
+
+    for (i = 0; i < pcap_src->num_queues; i++) {
+        capture_queue_free(pcap_src->queues[i]);
+    }
+    g_free(pcap_src->queues);
+    pcap_src->queues = NULL;
+    pcap_src->num_queues = 0;
+}
+
+/* Packets that didn't fit in a source's queues. */
+static guint32
+capture_loop_queue_drops(capture_src *pcap_src)
+{
+    capture_queue_stats_t queue_stats;
+    guint32               drops = 0;
+    guint                 i;
+
+    for (i = 0; i < pcap_src->num_queues; i++) {
+        capture_queue_get_stats(pcap_src->queues[i], &queue_stats);
+        drops += (guint32)queue_stats.drops;
+    }
+    return drops;
+}
+
 /* close the capture input file (pcap or capture pipe) */
 static void capture_loop_close_input(loop_data *ld)
 {
@@ -2810,6 +3022,7 @@ static void capture_loop_close_input(loop_data *ld)
 
     for (i = 0; i < ld->pcaps->len; i++) {
         pcap_src = g_array_index(ld->pcaps, capture_src *, i);
+        capture_loop_free_queues(pcap_src);
         /* Pipe, or capture device? */
         if (pcap_src->from_cap_pipe) {
             /* Pipe. If open, close the capture pipe "input file". */
@@ -2834,6 +3047,14 @@ static void capture_loop_close_input(loop_data *ld)
             }
         } else {
             /* Capture device.  If open, close the pcap_t. */
+#ifdef HAVE_TPACKET_V3
+            if (pcap_src->tpacket != NULL) {
+                tpacket_capture_close(pcap_src->tpacket);
+                pcap_src->tpacket = NULL;
+            }
+            g_free(pcap_src->tpacket_tids);
+            pcap_src->tpacket_tids = NULL;
+#endif
             if (pcap_src->pcap_h != NULL) {
                 g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_close_input: closing %p", (void *)pcap_src->pcap_h);
                 pcap_close(pcap_src->pcap_h);
@@ -2848,15 +3069,16 @@ static void capture_loop_close_input(loop_data *ld)
 
 /* init the capture filter */
 static initfilter_status_t
-capture_loop_init_filter(pcap_t *pcap_h, gboolean from_cap_pipe,
+capture_loop_init_filter(capture_src *pcap_src,
                          const gchar * name, const gchar * cfilter)
 {
+    pcap_t *pcap_h = pcap_src->pcap_h;
     struct bpf_program fcode;
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_init_filter: %s", cfilter);
 
     /* capture filters only work on real interfaces */
-    if (cfilter && !from_cap_pipe) {
+    if (cfilter && !pcap_src->from_cap_pipe) {
         /* A capture filter was specified; set it up. */
         if (!compile_capture_filter(name, pcap_h, &fcode, cfilter)) {
             /* Treat this specially - our caller might try to compile this
@@ -2864,6 +3086,15 @@ capture_loop_init_filter(pcap_t *pcap_h, gboolean from_cap_pipe,
                the display and capture filter syntaxes are different. */
             return INITFILTER_BAD_FILTER;
         }
+#ifdef HAVE_TPACKET_V3
+        if (pcap_src->tpacket != NULL &&
+            capture_loop_init_tpacket_filter(pcap_src, name, &fcode)) {
+#ifdef HAVE_PCAP_FREECODE
+            pcap_freecode(&fcode);
+#endif
+            return INITFILTER_NO_ERROR;
+        }
+#endif
         if (pcap_setfilter(pcap_h, &fcode) < 0) {
 #ifdef HAVE_PCAP_FREECODE
             pcap_freecode(&fcode);
@@ -2874,6 +3105,12 @@ capture_loop_init_filter(pcap_t *pcap_h, gboolean from_cap_pipe,
         pcap_freecode(&fcode);
 #endif
     }
+#ifdef HAVE_TPACKET_V3
+    else if (pcap_src->tpacket != NULL) {
+        /* The rings don't capture anything until they have a filter. */
+        capture_loop_init_tpacket_filter(pcap_src, name, NULL);
+    }
+#endif
 
     return INITFILTER_NO_ERROR;
 }
@@ -2991,6 +3228,98 @@ capture_loop_init_pcapng_output(capture_options *capture_opts, loop_data *ld)
     return successful;
 }
 
+/* copy what's written to the capture file to the shared memory buffer */
+static void
+capture_loop_shm_tee(const guint8 *data, size_t data_length, void *user_data)
+{
+    shm_ring_write((shm_ring_t *)user_data, data, data_length);
+}
+
+/* attach to the shared memory buffer our parent asked us to fill, if any */
+static void
+capture_loop_open_shm_ring(capture_options *capture_opts, loop_data *ld)
+{
+    int err;
+
+    if (capture_opts->shm_buffer_path == NULL || capture_opts->multi_files_on ||
+        capture_opts->output_to_pipe) {
+        return;
+    }
+
+    ld->shm_ring = shm_ring_open(capture_opts->shm_buffer_path, &err);
+    if (ld->shm_ring == NULL) {
+        /* Not fatal; our parent will just read everything from the file. */
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+              "capture_loop_open_shm_ring: can't open %s: %s",
+              capture_opts->shm_buffer_path, g_strerror(err));
+        return;
+    }
+    pcapio_set_tee(ld->pdh, capture_loop_shm_tee, ld->shm_ring);
+}
+
+static void
+capture_loop_close_shm_ring(loop_data *ld)
+{
+    if (ld->shm_ring == NULL) {
+        return;
+    }
+    shm_ring_commit(ld->shm_ring);
+    pcapio_set_tee(NULL, NULL, NULL);
+    shm_ring_close(ld->shm_ring);
+    ld->shm_ring = NULL;
+}
+
+/* flush the capture file and make what's been written to it visible in the
+   shared memory buffer as well */
+static void
+capture_loop_flush_output(loop_data *ld)
+{
+    int err;
+
+    fflush(ld->pdh);
+    if (ld->writer) {
+        /* An error will be reported by the next write. */
+        async_writer_flush(ld->writer, FALSE, &err);
+    }
+    if (ld->shm_ring) {
+        shm_ring_commit(ld->shm_ring);
+    }
+}
+
+/* flush the capture file and, if it's written from a separate thread, wait
+   until everything is in the file, so that our parent can read it */
+static void
+capture_loop_sync_output(loop_data *ld)
+{
+    int err;
+
+    capture_loop_flush_output(ld);
+    if (ld->writer) {
+        async_writer_flush(ld->writer, TRUE, &err);
+    }
+}
+
+/* wait for the writer thread, if any, to finish, and stop it */
+static gboolean
+capture_loop_free_writer(loop_data *ld, int *err)
+{
+    gboolean success;
+    async_writer_stats_t stats;
+
+    if (ld->writer == NULL)
+        return TRUE;
+
+    ringbuf_set_async_writer(NULL);
+    async_writer_get_stats(ld->writer, &stats);
+    success = async_writer_free(ld->writer, err);
+    ld->writer = NULL;
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+          "async writer: %" G_GINT64_MODIFIER "u blocks (%" G_GINT64_MODIFIER "u with O_DIRECT), "
+          "%" G_GINT64_MODIFIER "u bytes, %" G_GINT64_MODIFIER "u stalls",
+          stats.blocks, stats.direct_blocks, stats.bytes, stats.stalls);
+    return success;
+}
+
 /* set up to write to the already-opened capture output file/files */
 static gboolean
 capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *errmsg, int errmsg_len)
@@ -3006,9 +3335,22 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
         return FALSE;
     }
 
+    /* Writing to a pipe is done as soon as possible, so there's no point
+       in doing it from another thread in large blocks. */
+    if (async_write && !capture_opts->output_to_pipe) {
+        ld->writer = async_writer_new(ASYNC_WRITE_BLOCK_SIZE, ASYNC_WRITE_NUM_BLOCKS);
+    }
+
     /* Set up to write to the capture file. */
     if (capture_opts->multi_files_on) {
+        ringbuf_set_async_writer(ld->writer);
         ld->pdh = ringbuf_init_libpcap_fdopen(&err);
+    } else if (ld->writer) {
+        ld->pdh = async_writer_fdopen(ld->writer, ld->save_file_fd,
+                                      capture_opts->save_file, &err);
+        if (ld->pdh) {
+            capture_loop_open_shm_ring(capture_opts, ld);
+        }
     } else {
         ld->pdh = ws_fdopen(ld->save_file_fd, "wb");
         if (ld->pdh == NULL) {
@@ -3028,6 +3370,10 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
             ld->io_buffer = (char *)g_malloc(buffsize);
             setvbuf(ld->pdh, ld->io_buffer, _IOFBF, buffsize);
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_init_output: buffsize %zu", buffsize);
+
+            /* Attach before the file header is written, so that the buffer
+               holds the file from its first byte. */
+            capture_loop_open_shm_ring(capture_opts, ld);
         }
     }
     if (ld->pdh) {
@@ -3046,14 +3392,23 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
                                                 pcap_src->ts_nsec, &ld->bytes_written, &err);
         }
         if (!successful) {
+            capture_loop_close_shm_ring(ld);
             fclose(ld->pdh);
             ld->pdh = NULL;
+            /* The writer thread closes the file descriptor in its own
+               time, so our caller mustn't close it as well. */
+            if (ld->writer && !capture_opts->multi_files_on) {
+                ld->save_file_fd = -1;
+            }
             g_free(ld->io_buffer);
             ld->io_buffer = NULL;
         }
     }
 
     if (ld->pdh == NULL) {
+        int err_free;
+
+        capture_loop_free_writer(ld, &err_free);
         /* We couldn't set up to write to the capture file. */
         /* XXX - use cf_open_error_message from tshark instead? */
         if (err < 0) {
@@ -3081,11 +3436,19 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
     capture_src *pcap_src;
     guint64      end_time = create_timestamp();
     gboolean success;
+    int err;
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_close_output");
 
     if (capture_opts->multi_files_on) {
-        return ringbuf_libpcap_dump_close(&capture_opts->save_file, err_close);
+        success = ringbuf_libpcap_dump_close(&capture_opts->save_file, err_close);
+        if (!capture_loop_free_writer(ld, &err) && success) {
+            if (err_close != NULL) {
+                *err_close = err;
+            }
+            success = FALSE;
+        }
+        return success;
     } else {
         if (capture_opts->use_pcapng) {
             for (i = 0; i < global_ld.pcaps->len; i++) {
@@ -3094,9 +3457,9 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
                     guint64 isb_ifrecv, isb_ifdrop;
                     struct pcap_stat stats;
 
-                    if (pcap_stats(pcap_src->pcap_h, &stats) >= 0) {
+                    if (capture_loop_get_stats(pcap_src, &stats) >= 0) {
                         isb_ifrecv = pcap_src->received;
-                        isb_ifdrop = stats.ps_drop + pcap_src->dropped + pcap_src->flushed;
+                        isb_ifdrop = stats.ps_drop + pcap_src->dropped + capture_loop_queue_drops(pcap_src) + pcap_src->flushed;
                    } else {
                         isb_ifrecv = G_MAXUINT64;
                         isb_ifdrop = G_MAXUINT64;
@@ -3121,12 +3484,53 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
         } else {
             success = TRUE;
         }
+        if (!capture_loop_free_writer(ld, &err) && success) {
+            if (err_close != NULL) {
+                *err_close = err;
+            }
+            success = FALSE;
+        }
+        capture_loop_close_shm_ring(ld);
         g_free(ld->io_buffer);
         ld->io_buffer = NULL;
         return success;
     }
 }
 
+#ifdef HAVE_TPACKET_V3
+/* Process the blocks that are ready on one of a device's rings. */
+static int
+capture_loop_dispatch_tpacket(loop_data *ld, char *errmsg, int errmsg_len,
+                              capture_src *pcap_src, guint ring)
+{
+    int inpkts;
+
+    if (use_threads) {
+        inpkts = tpacket_capture_dispatch(pcap_src->tpacket, ring, CAP_READ_TIMEOUT,
+                                          capture_loop_queue_packet_cb, (u_char *)pcap_src);
+    } else {
+        inpkts = tpacket_capture_dispatch(pcap_src->tpacket, ring, CAP_READ_TIMEOUT,
+                                          capture_loop_write_packet_cb, (u_char *)pcap_src);
+    }
+    if (inpkts < 0) {
+        /* Only the first ring to fail reports it. */
+        if (ld->go) {
+            if (errno == ENETDOWN) {
+                report_capture_error("The network adapter on which the capture was being done "
+                                     "is no longer running; the capture has stopped.",
+                                     "");
+            } else {
+                g_snprintf(errmsg, errmsg_len, "Error while capturing packets: %s",
+                           g_strerror(errno));
+                report_capture_error(errmsg, please_report_bug());
+            }
+        }
+        ld->go = FALSE;
+    }
+    return inpkts;
+}
+#endif
+
 /* dispatch incoming packets (pcap or capture pipe)
  *
  * Waits for incoming packets to be available, and calls pcap_dispatch()
@@ -3185,6 +3589,13 @@ capture_loop_dispatch(loop_data *ld,
             }
         }
     }
+#ifdef HAVE_TPACKET_V3
+    else if (pcap_src->tpacket != NULL)
+    {
+        /* dispatch from our own rings */
+        capture_loop_dispatch_tpacket(ld, errmsg, errmsg_len, pcap_src, 0);
+    }
+#endif
     else
     {
         /* dispatch from pcap */
@@ -3572,7 +3983,7 @@ do_file_switch_or_stop(capture_options *capture_opts)
             if (global_ld.next_interval_time) {
                 global_ld.next_interval_time = get_next_time_interval(global_ld.interval_s);
             }
-            fflush(global_ld.pdh);
+            capture_loop_sync_output(&global_ld);
             if (!quiet)
                 report_packet_count(global_ld.inpkts_to_sync_pipe);
             global_ld.inpkts_to_sync_pipe = 0;
@@ -3598,6 +4009,7 @@ pcap_read_handler(void* arg)
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Started thread for interface %d.",
           pcap_src->interface_id);
+    g_private_set(&producer_queue, pcap_src->queues[0]);
 
     /* If this is a pipe input it might finish early. */
     while (global_ld.go && pcap_src->cap_pipe_err == PIPOK) {
@@ -3611,46 +4023,150 @@ pcap_read_handler(void* arg)
     return (NULL);
 }
 
-/* Try to pop an item off the packet queue and if it exists, write it */
+#ifdef HAVE_TPACKET_V3
+typedef struct {
+    capture_src *pcap_src;
+    guint        ring;
+} tpacket_reader_t;
+
+/* Read one of the extra rings of a device captured with fanout. */
+static void *
+tpacket_read_handler(void *arg)
+{
+    tpacket_reader_t *reader = (tpacket_reader_t *)arg;
+    char              errmsg[MSG_MAX_LENGTH+1];
+
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Started thread for ring %u of interface %d.",
+          reader->ring, reader->pcap_src->interface_id);
+    g_private_set(&producer_queue, reader->pcap_src->queues[reader->ring]);
+
+    while (global_ld.go) {
+        capture_loop_dispatch_tpacket(&global_ld, errmsg, sizeof(errmsg),
+                                      reader->pcap_src, reader->ring);
+    }
+
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Stopped thread for ring %u of interface %d.",
+          reader->ring, reader->pcap_src->interface_id);
+    g_free(reader);
+    g_thread_exit(NULL);
+    return (NULL);
+}
+
+/* pcap_read_handler reads the first ring; start a thread for each of the others. */
+static void
+capture_loop_start_tpacket_threads(capture_src *pcap_src)
+{
+    guint             num_rings = tpacket_capture_num_rings(pcap_src->tpacket);
+    guint             ring;
+    tpacket_reader_t *reader;
+
+    if (num_rings < 2)
+        return;
+    pcap_src->tpacket_tids = g_new0(GThread *, num_rings);
+    for (ring = 1; ring < num_rings; ring++) {
+        reader = g_new(tpacket_reader_t, 1);
+        reader->pcap_src = pcap_src;
+        reader->ring = ring;
+        pcap_src->tpacket_tids[ring] = g_thread_new("Capture ring read", tpacket_read_handler, reader);
+    }
+}
+#endif
+
+static gboolean
+capture_loop_queues_empty(void)
+{
+    capture_src *pcap_src;
+    guint        i, j;
+
+    for (i = 0; i < global_ld.pcaps->len; i++) {
+        pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+        for (j = 0; j < pcap_src->num_queues; j++) {
+            if (!capture_queue_is_empty(pcap_src->queues[j]))
+                return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* Wait up to WRITER_THREAD_TIMEOUT for a packet to be queued. */
+static void
+capture_loop_wait_for_packets(void)
+{
+    gint64 end_time = g_get_monotonic_time() + WRITER_THREAD_TIMEOUT;
+
+    g_mutex_lock(&writer_mutex);
+    g_atomic_int_set(&writer_waiting, 1);
+    /* Look again, now that the readers know to wake us up. */
+    if (capture_loop_queues_empty()) {
+        g_cond_wait_until(&writer_cond, &writer_mutex, end_time);
+    }
+    g_atomic_int_set(&writer_waiting, 0);
+    g_mutex_unlock(&writer_mutex);
+}
+
+/* Wake up the main thread if it's waiting for packets to be queued. */
+static void
+capture_loop_wake_writer(void)
+{
+    if (g_atomic_int_get(&writer_waiting)) {
+        g_mutex_lock(&writer_mutex);
+        g_cond_signal(&writer_cond);
+        g_mutex_unlock(&writer_mutex);
+    }
+}
+
+/*
+ * Write the oldest of the packets at the heads of the queues, so that
+ * packets from different sources are written in time stamp order as far
+ * as possible.  If all the queues are empty, wait for a while (unless
+ * we're flushing them at the end of the capture) and return FALSE.
+ */
 static gboolean
 capture_loop_dequeue_packet(void) {
+    capture_src        *pcap_src;
+    capture_src        *oldest_src = NULL;
+    capture_queue_t    *oldest_queue = NULL;
     pcap_queue_element *queue_element;
+    pcap_queue_element *oldest = NULL;
+    gsize               len;
+    guint               i, j;
 
-    g_async_queue_lock(pcap_queue);
-    queue_element = (pcap_queue_element *)g_async_queue_timeout_pop_unlocked(pcap_queue, WRITER_THREAD_TIMEOUT);
-    if (queue_element) {
-        if (queue_element->pcap_src->from_pcapng) {
-            pcap_queue_bytes -= queue_element->u.bh.block_total_length;
-        } else {
-            pcap_queue_bytes -= queue_element->u.phdr.caplen;
+    for (i = 0; i < global_ld.pcaps->len; i++) {
+        pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+        for (j = 0; j < pcap_src->num_queues; j++) {
+            queue_element = (pcap_queue_element *)capture_queue_peek(pcap_src->queues[j], &len);
+            if (queue_element != NULL &&
+                (oldest == NULL || queue_element->ts < oldest->ts)) {
+                oldest = queue_element;
+                oldest_src = pcap_src;
+                oldest_queue = pcap_src->queues[j];
+            }
         }
-        pcap_queue_packets -= 1;
     }
-    g_async_queue_unlock(pcap_queue);
-    if (queue_element) {
-        if (queue_element->pcap_src->from_pcapng) {
-            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                  "Dequeued a block of type 0x%08x of length %d captured on interface %d.",
-                  queue_element->u.bh.block_type, queue_element->u.bh.block_total_length,
-                  queue_element->pcap_src->interface_id);
+    if (oldest == NULL) {
+        if (global_ld.go) {
+            capture_loop_wait_for_packets();
+        }
+        return FALSE;
+    }
 
-            capture_loop_write_pcapng_cb(queue_element->pcap_src,
-                                        &queue_element->u.bh,
-                                        queue_element->pd);
-        } else {
-            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                "Dequeued a packet of length %d captured on interface %d.",
-                queue_element->u.phdr.caplen, queue_element->pcap_src->interface_id);
+    if (oldest_src->from_pcapng) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+              "Dequeued a block of type 0x%08x of length %d captured on interface %d.",
+              oldest->u.bh.block_type, oldest->u.bh.block_total_length,
+              oldest_src->interface_id);
 
-            capture_loop_write_packet_cb((u_char *) queue_element->pcap_src,
-                                        &queue_element->u.phdr,
-                                        queue_element->pd);
-        }
-        g_free(queue_element->pd);
-        g_free(queue_element);
-        return TRUE;
+        capture_loop_write_pcapng_cb(oldest_src, &oldest->u.bh, (u_char *)(oldest + 1));
+    } else {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+              "Dequeued a packet of length %d captured on interface %d.",
+              oldest->u.phdr.caplen, oldest_src->interface_id);
+
+        capture_loop_write_packet_cb((u_char *) oldest_src, &oldest->u.phdr,
+                                     (u_char *)(oldest + 1));
     }
-    return FALSE;
+    capture_queue_release(oldest_queue);
+    return TRUE;
 }
 
 /* Do the low-level work of a capture.
@@ -3689,6 +4205,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     global_ld.pdh                 = NULL;
     global_ld.save_file_fd        = -1;
     global_ld.io_buffer           = NULL;
+    global_ld.writer              = NULL;
     global_ld.file_count          = 0;
     global_ld.file_duration_timer = NULL;
     global_ld.next_interval_time  = 0;
@@ -3714,7 +4231,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
          * is NULL. This might be a bug in WPCap. Therefore we provide an empty
          * string.
          */
-        switch (capture_loop_init_filter(pcap_src->pcap_h, pcap_src->from_cap_pipe,
+        switch (capture_loop_init_filter(pcap_src,
                                          interface_opts->name,
                                          interface_opts->cfilter?interface_opts->cfilter:"")) {
 
@@ -3762,7 +4279,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
            message to our parent so that they'll open the capture file and
            update its windows to indicate that we have a live capture in
            progress. */
-        fflush(global_ld.pdh);
+        capture_loop_sync_output(&global_ld);
         report_new_capture_file(capture_opts->save_file);
     }
 
@@ -3799,13 +4316,16 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     /* WOW, everything is prepared! */
     /* please fasten your seat belts, we will enter now the actual capture loop */
     if (use_threads) {
-        pcap_queue = g_async_queue_new();
-        pcap_queue_bytes = 0;
-        pcap_queue_packets = 0;
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+            capture_loop_create_queues(pcap_src);
             /* XXX - Add an interface name here? */
             pcap_src->tid = g_thread_new("Capture read", pcap_read_handler, pcap_src);
+#ifdef HAVE_TPACKET_V3
+            if (pcap_src->tpacket != NULL) {
+                capture_loop_start_tpacket_threads(pcap_src);
+            }
+#endif
         }
     }
     while (global_ld.go) {
@@ -3857,7 +4377,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             global_ld.inpkts_to_sync_pipe += inpkts;
 
             if (capture_opts->output_to_pipe) {
-                fflush(global_ld.pdh);
+                capture_loop_flush_output(&global_ld);
             }
         } /* inpkts */
 
@@ -3887,7 +4407,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             /* Let the parent process know. */
             if (global_ld.inpkts_to_sync_pipe) {
                 /* do sync here */
-                fflush(global_ld.pdh);
+                capture_loop_sync_output(&global_ld);
 
                 /* Send our parent a message saying we've written out
                    "global_ld.inpkts_to_sync_pipe" packets to the capture file. */
@@ -3928,6 +4448,15 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Waiting for thread of interface %u...",
                   pcap_src->interface_id);
             g_thread_join(pcap_src->tid);
+#ifdef HAVE_TPACKET_V3
+            if (pcap_src->tpacket_tids != NULL) {
+                guint ring;
+
+                for (ring = 1; ring < tpacket_capture_num_rings(pcap_src->tpacket); ring++) {
+                    g_thread_join(pcap_src->tpacket_tids[ring]);
+                }
+            }
+#endif
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Thread of interface %u terminated.",
                   pcap_src->interface_id);
         }
@@ -3938,7 +4467,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             }
             global_ld.inpkts_to_sync_pipe += 1;
             if (capture_opts->output_to_pipe) {
-                fflush(global_ld.pdh);
+                capture_loop_flush_output(&global_ld);
             }
         }
     }
@@ -4058,7 +4587,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
         if (pcap_src->pcap_h != NULL) {
             g_assert(!pcap_src->from_cap_pipe);
             /* Get the capture statistics, so we know how many packets were dropped. */
-            if (pcap_stats(pcap_src->pcap_h, stats) >= 0) {
+            if (capture_loop_get_stats(pcap_src, stats) >= 0) {
                 *stats_known = TRUE;
                 /* Let the parent process know. */
                 pcap_dropped += stats->ps_drop;
@@ -4069,7 +4598,16 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
                 report_capture_error(errmsg, please_report_bug());
             }
         }
-        report_packet_drops(received, pcap_dropped, pcap_src->dropped, pcap_src->flushed, stats->ps_ifdrop, interface_opts->display_name);
+        report_packet_drops(received, pcap_dropped, pcap_src->dropped + capture_loop_queue_drops(pcap_src),
+                            pcap_src->flushed, stats->ps_ifdrop, interface_opts->display_name);
+        if (pcap_src->num_queues > 0) {
+            report_queue_stats(pcap_src, interface_opts->display_name);
+        }
+#ifdef HAVE_TPACKET_V3
+        if (pcap_src->tpacket != NULL) {
+            report_tpacket_ring_stats(pcap_src, interface_opts->display_name);
+        }
+#endif
     }
 
     /* close the input file (pcap or capture pipe) */
@@ -4121,6 +4659,10 @@ capture_loop_stop(void)
         pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
         if (pcap_src->pcap_h != NULL)
             pcap_breakloop(pcap_src->pcap_h);
+#ifdef HAVE_TPACKET_V3
+        if (pcap_src->tpacket != NULL)
+            tpacket_capture_breakloop(pcap_src->tpacket);
+#endif
     }
     global_ld.go = FALSE;
 }
@@ -4193,7 +4735,7 @@ capture_loop_wrote_one_packet(capture_src *pcap_src) {
 
     /* check -c NUM / -a packets:NUM */
     if (global_capture_opts.has_autostop_packets && global_ld.packets_captured >= global_capture_opts.autostop_packets) {
-        fflush(global_ld.pdh);
+        capture_loop_flush_output(&global_ld);
         global_ld.go = FALSE;
         return;
     }
@@ -4257,7 +4799,7 @@ capture_loop_write_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t
                                        bh->block_total_length,
                                        &global_ld.bytes_written, &err);
 
-        fflush(global_ld.pdh);
+        capture_loop_flush_output(&global_ld);
         if (!successful) {
             global_ld.go = FALSE;
             global_ld.err = err;
@@ -4336,8 +4878,8 @@ capture_loop_queue_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
                              const u_char *pd)
 {
     capture_src        *pcap_src = (capture_src *) (void *) pcap_src_p;
+    capture_queue_t    *queue = (capture_queue_t *)g_private_get(&producer_queue);
     pcap_queue_element *queue_element;
-    gboolean            limit_reached;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -4347,57 +4889,29 @@ capture_loop_queue_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
         return;
     }
 
-    queue_element = (pcap_queue_element *)g_malloc(sizeof(pcap_queue_element));
+    /* If the queue is full, the queue counts the drop. */
+    queue_element = (pcap_queue_element *)capture_queue_reserve(queue,
+        sizeof(pcap_queue_element) + phdr->caplen);
     if (queue_element == NULL) {
-       pcap_src->dropped++;
-       return;
-    }
-    queue_element->pcap_src = pcap_src;
-    queue_element->u.phdr = *phdr;
-    queue_element->pd = (u_char *)g_malloc(phdr->caplen);
-    if (queue_element->pd == NULL) {
-        pcap_src->dropped++;
-        g_free(queue_element);
-        return;
-    }
-    memcpy(queue_element->pd, pd, phdr->caplen);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = FALSE;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += phdr->caplen;
-        pcap_queue_packets += 1;
-    } else {
-        limit_reached = TRUE;
-    }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
-        pcap_src->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
               "Dropped a packet of length %d captured on interface %u.",
               phdr->caplen, pcap_src->interface_id);
-    } else {
-        pcap_src->received++;
-        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-              "Queued a packet of length %d captured on interface %u.",
-              phdr->caplen, pcap_src->interface_id);
+        return;
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
-    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-          "Queue size is now %" G_GINT64_MODIFIER "d bytes (%" G_GINT64_MODIFIER "d packets)",
-          pcap_queue_bytes, pcap_queue_packets);
+    queue_element->u.phdr = *phdr;
+    queue_element->ts = (guint64)phdr->ts.tv_sec * 1000000000 +
+        (pcap_src->ts_nsec ? (guint64)phdr->ts.tv_usec : (guint64)phdr->ts.tv_usec * 1000);
+    memcpy(queue_element + 1, pd, phdr->caplen);
+    capture_queue_commit(queue);
+    capture_loop_wake_writer();
 }
 
 /* one pcapng block was captured, queue it */
 static void
 capture_loop_queue_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t *bh, u_char *pd)
 {
+    capture_queue_t    *queue = (capture_queue_t *)g_private_get(&producer_queue);
     pcap_queue_element *queue_element;
-    gboolean            limit_reached;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -4407,49 +4921,21 @@ capture_loop_queue_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t
         return;
     }
 
-    queue_element = (pcap_queue_element *)g_malloc(sizeof(pcap_queue_element));
+    queue_element = (pcap_queue_element *)capture_queue_reserve(queue,
+        sizeof(pcap_queue_element) + bh->block_total_length);
     if (queue_element == NULL) {
-       pcap_src->dropped++;
-       return;
-    }
-    queue_element->pcap_src = pcap_src;
-    queue_element->u.bh = *bh;
-    queue_element->pd = (u_char *)g_malloc(bh->block_total_length);
-    if (queue_element->pd == NULL) {
-        pcap_src->dropped++;
-        g_free(queue_element);
-        return;
-    }
-    memcpy(queue_element->pd, pd, bh->block_total_length);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = FALSE;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += bh->block_total_length;
-        pcap_queue_packets += 1;
-    } else {
-        limit_reached = TRUE;
-    }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
-        pcap_src->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
               "Dropped a packet of length %d captured on interface %u.",
               bh->block_total_length, pcap_src->interface_id);
-    } else {
-        pcap_src->received++;
-        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-              "Queued a block of type 0x%08x of length %d captured on interface %u.",
-              bh->block_type, bh->block_total_length, pcap_src->interface_id);
+        return;
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
-    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-          "Queue size is now %" G_GINT64_MODIFIER "d bytes (%" G_GINT64_MODIFIER "d packets)",
-          pcap_queue_bytes, pcap_queue_packets);
+    queue_element->u.bh = *bh;
+    /* Blocks from a pcapng source go out as soon as they're at the head
+       of their queue. */
+    queue_element->ts = 0;
+    memcpy(queue_element + 1, pd, bh->block_total_length);
+    capture_queue_commit(queue);
+    capture_loop_wake_writer();
 }
 
 static int
@@ -4527,6 +5013,11 @@ get_dumpcap_runtime_info(GString *str)
     get_runtime_caplibs_version(str);
 }
 
+#define LONGOPT_SHM_BUFFER LONGOPT_BASE_APPLICATION+1
+#define LONGOPT_TPACKET    LONGOPT_BASE_APPLICATION+2
+#define LONGOPT_FANOUT     LONGOPT_BASE_APPLICATION+3
+#define LONGOPT_ASYNC_WRITE LONGOPT_BASE_APPLICATION+4
+
 /* And now our feature presentation... [ fade to music ] */
 int
 main(int argc, char *argv[])
@@ -4537,6 +5028,12 @@ main(int argc, char *argv[])
         {"help", no_argument, NULL, 'h'},
         {"version", no_argument, NULL, 'v'},
         LONGOPT_CAPTURE_COMMON
+        {"shm-buffer", required_argument, NULL, LONGOPT_SHM_BUFFER},
+        {"async-write", no_argument, NULL, LONGOPT_ASYNC_WRITE},
+#ifdef HAVE_TPACKET_V3
+        {"tpacket", no_argument, NULL, LONGOPT_TPACKET},
+        {"fanout", required_argument, NULL, LONGOPT_FANOUT},
+#endif
         {0, 0, 0, 0 }
     };
 
@@ -4946,6 +5443,30 @@ main(int argc, char *argv[])
         case LONGOPT_LIST_TSTAMP_TYPES:
                 caps_queries |= CAPS_QUERY_TIMESTAMP_TYPES;
         break;
+        case LONGOPT_SHM_BUFFER:
+            g_free(global_capture_opts.shm_buffer_path);
+            global_capture_opts.shm_buffer_path = g_strdup(optarg);
+            break;
+        case LONGOPT_ASYNC_WRITE:
+            if (!async_writer_is_supported()) {
+                cmdarg_err("--async-write isn't supported on this platform.");
+                exit_main(1);
+            }
+            async_write = TRUE;
+            break;
+#ifdef HAVE_TPACKET_V3
+        case LONGOPT_TPACKET:
+            use_tpacket = TRUE;
+            break;
+        case LONGOPT_FANOUT:
+            tpacket_fanout = get_positive_int(optarg, "fanout");
+            use_tpacket = TRUE;
+            /* The rings after the first one are read by threads of their own,
+               so their packets have to go through the packet queue. */
+            if (tpacket_fanout > 1)
+                use_threads = TRUE;
+            break;
+#endif
         case 'd':        /* Print BPF code for capture filter and exit */
             if (!print_bpf_code) {
                 print_bpf_code = TRUE;
@@ -5007,6 +5528,12 @@ main(int argc, char *argv[])
     if ((pcap_queue_byte_limit > 0) || (pcap_queue_packet_limit > 0)) {
         use_threads = TRUE;
     }
+    if (pcap_queue_byte_limit > CAPTURE_QUEUE_MAX_BYTES) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_WARNING,
+              "A queue can't hold more than %u bytes; using that as the byte limit.",
+              CAPTURE_QUEUE_MAX_BYTES);
+        pcap_queue_byte_limit = CAPTURE_QUEUE_MAX_BYTES;
+    }
     if ((pcap_queue_byte_limit == 0) && (pcap_queue_packet_limit == 0)) {
         /* Use some default if the user hasn't specified some */
         /* XXX: Are these defaults good enough? */
@@ -5475,6 +6002,58 @@ report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32
     }
 }
 
+/*
+ * Report how full the queues of a source got.  This only goes to stderr
+ * if some packets didn't fit, as a hint to raise the -C or -N limit.
+ */
+static void
+report_queue_stats(capture_src *pcap_src, const gchar *name)
+{
+    capture_queue_stats_t queue_stats;
+    guint                 i;
+
+    for (i = 0; i < pcap_src->num_queues; i++) {
+        capture_queue_get_stats(pcap_src->queues[i], &queue_stats);
+        if (capture_child || queue_stats.drops == 0) {
+            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+                "Queue %u of interface '%s': at most %" G_GINT64_MODIFIER "u packets/%" G_GINT64_MODIFIER "u bytes queued, %" G_GINT64_MODIFIER "u dropped",
+                i, name, queue_stats.peak_records, queue_stats.peak_bytes, queue_stats.drops);
+        } else {
+            fprintf(stderr,
+                "Queue %u of interface '%s': at most %" G_GINT64_MODIFIER "u packets/%" G_GINT64_MODIFIER "u bytes queued, %" G_GINT64_MODIFIER "u dropped\n",
+                i, name, queue_stats.peak_records, queue_stats.peak_bytes, queue_stats.drops);
+            /* stderr could be line buffered */
+            fflush(stderr);
+        }
+    }
+}
+
+#ifdef HAVE_TPACKET_V3
+static void
+report_tpacket_ring_stats(capture_src *pcap_src, const gchar *name)
+{
+    tpacket_ring_stats_t ring_stats;
+    guint                num_rings = tpacket_capture_num_rings(pcap_src->tpacket);
+    guint                ring;
+
+    for (ring = 0; ring < num_rings; ring++) {
+        tpacket_capture_ring_stats(pcap_src->tpacket, ring, &ring_stats);
+        if (capture_child || num_rings < 2) {
+            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+                "Packets captured/dropped on ring %u of interface '%s': %" G_GINT64_MODIFIER "u/%" G_GINT64_MODIFIER "u (ring full %" G_GINT64_MODIFIER "u times)",
+                ring, name, ring_stats.captured, ring_stats.drops, ring_stats.freezes);
+        } else {
+            fprintf(stderr,
+                "Packets captured/dropped on ring %u of interface '%s': %" G_GINT64_MODIFIER "u/%" G_GINT64_MODIFIER "u (ring full %" G_GINT64_MODIFIER "u times)\n",
+                ring, name, ring_stats.captured, ring_stats.drops, ring_stats.freezes);
+        }
+    }
+    if (!capture_child) {
+        /* stderr could be line buffered */
+        fflush(stderr);
+    }
+}
+#endif
 
 /************************************************************************************************/
 /* signal_pipe handling */
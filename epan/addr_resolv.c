@@ -106,30 +106,7 @@
 #define ENAME_ENTERPRISES "enterprises.tsv"
 
 #define HASHETHSIZE      2048
-#define HASHHOSTSIZE     2048
 #define HASHIPXNETSIZE    256
-#define SUBNETLENGTHSIZE   32  /*1-32 inc.*/
-
-/* hash table used for IPv4 lookup */
-
-#define HASH_IPV4_ADDRESS(addr) (g_htonl(addr) & (HASHHOSTSIZE - 1))
-
-
-typedef struct sub_net_hashipv4 {
-    guint             addr;
-    /* XXX: No longer needed?*/
-    guint8            flags;          /* B0 dummy_entry, B1 resolve, B2 If the address is used in the trace */
-    struct sub_net_hashipv4   *next;
-    gchar             name[MAXNAMELEN];
-} sub_net_hashipv4_t;
-
-/* Array of entries of subnets of different lengths */
-typedef struct {
-    gsize        mask_length;      /*1-32*/
-    guint32      mask;             /* e.g. 255.255.255.*/
-    sub_net_hashipv4_t** subnet_addresses; /* Hash table of subnet addresses */
-} subnet_length_entry_t;
-
 
 /* hash table used for IPX network lookup */
 
@@ -224,8 +201,10 @@ static wmem_map_t *eth_hashtable = NULL;
 static wmem_map_t *serv_port_hashtable = NULL;
 static GHashTable *enterprises_hashtable = NULL;
 
-static subnet_length_entry_t subnet_length_entries[SUBNETLENGTHSIZE]; /* Ordered array of entries */
-static gboolean have_subnet_entry = FALSE;
+/* Longest-prefix-match trees of subnet names, keyed by address in network
+ * byte order. NULL until the first subnet of that family is read. */
+static wmem_prefix_tree_t *subnet_ipv4_tree = NULL;
+static wmem_prefix_tree_t *subnet_ipv6_tree = NULL;
 
 static gboolean new_resolved_objects = FALSE;
 
@@ -619,6 +598,8 @@ fgetline(char *buf, int size, FILE *fp)
  */
 static subnet_entry_t subnet_lookup(const guint32 addr);
 static void subnet_entry_set(guint32 subnet_addr, const guint8 mask_length, const gchar* name);
+static const gchar *subnet6_lookup(const ws_in6_addr *addr, guint *mask_length);
+static void subnet6_entry_set(const ws_in6_addr *subnet_addr, const guint8 mask_length, const gchar* name);
 
 
 static void
@@ -999,13 +980,45 @@ fill_dummy_ip4(const guint addr, hashipv4_t* volatile tp)
 }
 
 
-/* Fill in an IP6 structure with the string form of the address.
+/* Fill in an IP6 structure with info from subnets file or just with the
+ * string form of the address.
  */
 static void
 fill_dummy_ip6(hashipv6_t* volatile tp)
 {
+    const gchar *subnet_name;
+    guint mask_length;
+
     /* Overwrite if we get async DNS reply */
-    g_strlcpy(tp->name, tp->ip6, MAXNAMELEN);
+
+    /* Do we have a subnet for this address? */
+    subnet_name = subnet6_lookup((const ws_in6_addr *)tp->addr, &mask_length);
+    if (subnet_name != NULL) {
+        /* Print name, then the address with the subnet prefix cleared,
+         * which normally starts with "::" */
+        ws_in6_addr host_addr;
+        gchar buffer[WS_INET6_ADDRSTRLEN];
+        guint i;
+
+        if (mask_length == 128) {
+            g_strlcpy(tp->name, subnet_name, MAXNAMELEN);
+            return;
+        }
+
+        memcpy(host_addr.bytes, tp->addr, sizeof host_addr.bytes);
+        for (i = 0; i < mask_length / 8; i++) {
+            host_addr.bytes[i] = 0;
+        }
+        if (mask_length % 8) {
+            host_addr.bytes[i] &= 0xFF >> (mask_length % 8);
+        }
+        ip6_to_str_buf(&host_addr, buffer, WS_INET6_ADDRSTRLEN);
+
+        g_snprintf(tp->name, MAXNAMELEN, "%s%s%s", subnet_name,
+                   buffer[0] == ':' ? "" : ":", buffer);
+    } else {
+        g_strlcpy(tp->name, tp->ip6, MAXNAMELEN);
+    }
 }
 
 static void
@@ -2427,15 +2440,13 @@ get_addrinfo_list(void)
  * <line> = <comment> | <entry> | <whitespace>
  * <comment> = <whitespace>#<any>
  * <entry> = <subnet_definition> <whitespace> <subnet_name> [<comment>|<whitespace><any>]
- * <subnet_definition> = <ipv4_address> / <subnet_mask_length>
- * <ipv4_address> is a full address; it will be masked to get the subnet-ID.
- * <subnet_mask_length> is a decimal 1-31
+ * <subnet_definition> = <ip_address> / <subnet_mask_length>
+ * <ip_address> is a full IPv4 or IPv6 address; it will be masked to get the subnet-ID.
+ * <subnet_mask_length> is a decimal 1-32 for IPv4 or 1-128 for IPv6
  * <subnet_name> is a string containing no whitespace.
  * <whitespace> = (space | tab)+
  * Any malformed entries are ignored.
  * Any trailing data after the subnet_name is ignored.
- *
- * XXX Support IPv6
  */
 static gboolean
 read_subnets_file (const char *subnetspath)
@@ -2443,7 +2454,8 @@ read_subnets_file (const char *subnetspath)
     FILE *hf;
     char line[MAX_LINELEN];
     gchar *cp, *cp2;
-    guint32 host_addr; /* IPv4 ONLY */
+    guint32 host_addr;
+    ws_in6_addr host_addr6;
     guint8 mask_length;
 
     if ((hf = ws_fopen(subnetspath, "r")) == NULL)
@@ -2457,7 +2469,7 @@ read_subnets_file (const char *subnetspath)
             continue; /* no tokens in the line */
 
 
-        /* Expected format is <IP4 address>/<subnet length> */
+        /* Expected format is <IP address>/<subnet length> */
         cp2 = strchr(cp, '/');
         if (NULL == cp2) {
             /* No length */
@@ -2466,19 +2478,26 @@ read_subnets_file (const char *subnetspath)
         *cp2 = '\0'; /* Cut token */
         ++cp2    ;
 
-        /* Check if this is a valid IPv4 address */
-        if (!str_to_ip(cp, &host_addr)) {
-            continue; /* no */
-        }
+        /* Check if this is a valid IPv4 or IPv6 address */
+        if (str_to_ip(cp, &host_addr)) {
+            if (!ws_strtou8(cp2, NULL, &mask_length) || mask_length == 0 || mask_length > 32) {
+                continue; /* invalid mask length */
+            }
 
-        if (!ws_strtou8(cp2, NULL, &mask_length) || mask_length == 0 || mask_length > 32) {
-            continue; /* invalid mask length */
-        }
+            if ((cp = strtok(NULL, " \t")) == NULL)
+                continue; /* no subnet name */
 
-        if ((cp = strtok(NULL, " \t")) == NULL)
-            continue; /* no subnet name */
+            subnet_entry_set(host_addr, mask_length, cp);
+        } else if (str_to_ip6(cp, &host_addr6)) {
+            if (!ws_strtou8(cp2, NULL, &mask_length) || mask_length == 0 || mask_length > 128) {
+                continue; /* invalid mask length */
+            }
+
+            if ((cp = strtok(NULL, " \t")) == NULL)
+                continue; /* no subnet name */
 
-        subnet_entry_set(host_addr, mask_length, cp);
+            subnet6_entry_set(&host_addr6, mask_length, cp);
+        }
     }
 
     fclose(hf);
@@ -2489,40 +2508,16 @@ static subnet_entry_t
 subnet_lookup(const guint32 addr)
 {
     subnet_entry_t subnet_entry;
-    guint32 i;
-
-    /* Search mask lengths linearly, longest first */
-
-    i = SUBNETLENGTHSIZE;
-    while(have_subnet_entry && i > 0) {
-        guint32 masked_addr;
-        subnet_length_entry_t* length_entry;
-
-        /* Note that we run from 31 (length 32)  to 0 (length 1)  */
-        --i;
-        g_assert(i < SUBNETLENGTHSIZE);
-
-
-        length_entry = &subnet_length_entries[i];
-
-        if (NULL != length_entry->subnet_addresses) {
-            sub_net_hashipv4_t * tp;
-            guint32 hash_idx;
-
-            masked_addr = addr & length_entry->mask;
-            hash_idx = HASH_IPV4_ADDRESS(masked_addr);
-
-            tp = length_entry->subnet_addresses[hash_idx];
-            while(tp != NULL && tp->addr != masked_addr) {
-                tp = tp->next;
-            }
-
-            if (NULL != tp) {
-                subnet_entry.mask = length_entry->mask;
-                subnet_entry.mask_length = i + 1; /* Length is offset + 1 */
-                subnet_entry.name = tp->name;
-                return subnet_entry;
-            }
+    guint mask_length;
+
+    if (subnet_ipv4_tree != NULL) {
+        /* addr is in network byte order, as are the tree keys */
+        subnet_entry.name = (const gchar *)wmem_prefix_tree_lookup(subnet_ipv4_tree,
+                (const guint8 *)&addr, &mask_length);
+        if (subnet_entry.name != NULL) {
+            subnet_entry.mask = g_htonl(ip_get_subnet_mask(mask_length));
+            subnet_entry.mask_length = mask_length;
+            return subnet_entry;
         }
     }
 
@@ -2535,64 +2530,58 @@ subnet_lookup(const guint32 addr)
 
 /* Add a subnet-definition - name pair to the set.
  * The definition is taken by masking the address passed in with the mask of the
- * given length.
+ * given length. The first definition read for a subnet wins.
  */
 static void
 subnet_entry_set(guint32 subnet_addr, const guint8 mask_length, const gchar* name)
 {
-    subnet_length_entry_t* entry;
-    sub_net_hashipv4_t * tp;
-    gsize hash_idx;
-
     g_assert(mask_length > 0 && mask_length <= 32);
 
-    entry = &subnet_length_entries[mask_length - 1];
+    if (subnet_ipv4_tree == NULL) {
+        subnet_ipv4_tree = wmem_prefix_tree_new(wmem_epan_scope(), 32);
+    }
 
-    subnet_addr &= entry->mask;
+    if (wmem_prefix_tree_lookup_exact(subnet_ipv4_tree, (const guint8 *)&subnet_addr, mask_length) != NULL) {
+        return; /* XXX provide warning that an address was repeated? */
+    }
 
-    hash_idx = HASH_IPV4_ADDRESS(subnet_addr);
+    wmem_prefix_tree_insert(subnet_ipv4_tree, (const guint8 *)&subnet_addr, mask_length,
+            wmem_strndup(wmem_epan_scope(), name, MAXNAMELEN - 1));
+}
 
-    if (NULL == entry->subnet_addresses) {
-        entry->subnet_addresses = (sub_net_hashipv4_t**)wmem_alloc0(wmem_epan_scope(), sizeof(sub_net_hashipv4_t*) * HASHHOSTSIZE);
+/* Returns the name of the longest IPv6 subnet containing addr, or NULL. */
+static const gchar *
+subnet6_lookup(const ws_in6_addr *addr, guint *mask_length)
+{
+    if (subnet_ipv6_tree == NULL) {
+        return NULL;
     }
 
-    if (NULL != (tp = entry->subnet_addresses[hash_idx])) {
-        sub_net_hashipv4_t * new_tp;
+    return (const gchar *)wmem_prefix_tree_lookup(subnet_ipv6_tree, addr->bytes, mask_length);
+}
 
-        while (tp->next) {
-            if (tp->addr == subnet_addr) {
-                return; /* XXX provide warning that an address was repeated? */
-            } else {
-                tp = tp->next;
-            }
-        }
+/* IPv6 counterpart of subnet_entry_set(). */
+static void
+subnet6_entry_set(const ws_in6_addr *subnet_addr, const guint8 mask_length, const gchar* name)
+{
+    g_assert(mask_length > 0 && mask_length <= 128);
 
-        new_tp = wmem_new(wmem_epan_scope(), sub_net_hashipv4_t);
-        tp->next = new_tp;
-        tp = new_tp;
-    } else {
-        tp = entry->subnet_addresses[hash_idx] = wmem_new(wmem_epan_scope(), sub_net_hashipv4_t);
+    if (subnet_ipv6_tree == NULL) {
+        subnet_ipv6_tree = wmem_prefix_tree_new(wmem_epan_scope(), 128);
+    }
+
+    if (wmem_prefix_tree_lookup_exact(subnet_ipv6_tree, subnet_addr->bytes, mask_length) != NULL) {
+        return;
     }
 
-    tp->next = NULL;
-    tp->addr = subnet_addr;
-    g_strlcpy(tp->name, name, MAXNAMELEN); /* This is longer than subnet names can actually be */
-    have_subnet_entry = TRUE;
+    wmem_prefix_tree_insert(subnet_ipv6_tree, subnet_addr->bytes, mask_length,
+            wmem_strndup(wmem_epan_scope(), name, MAXNAMELEN - 1));
 }
 
 static void
 subnet_name_lookup_init(void)
 {
     gchar* subnetspath;
-    guint32 i;
-
-    for(i = 0; i < SUBNETLENGTHSIZE; ++i) {
-        guint32 length = i + 1;
-
-        subnet_length_entries[i].subnet_addresses  = NULL;
-        subnet_length_entries[i].mask_length  = length;
-        subnet_length_entries[i].mask = g_htonl(ip_get_subnet_mask(length));
-    }
 
     /* Check profile directory before personal configuration */
     subnetspath = get_persconffile_path(ENAME_SUBNETS, TRUE);
@@ -3129,9 +3118,6 @@ host_name_lookup_init(void)
 static void
 host_name_lookup_cleanup(void)
 {
-    guint32 i, j;
-    sub_net_hashipv4_t *entry, *next_entry;
-
     _host_name_lookup_cleanup();
 
     ipxnet_hash_table = NULL;
@@ -3139,21 +3125,15 @@ host_name_lookup_cleanup(void)
     ipv6_hash_table = NULL;
     ss7pc_hash_table = NULL;
 
-    for(i = 0; i < SUBNETLENGTHSIZE; ++i) {
-        if (subnet_length_entries[i].subnet_addresses != NULL) {
-            for (j = 0; j < HASHHOSTSIZE; j++) {
-                for (entry = subnet_length_entries[i].subnet_addresses[j];
-                     entry != NULL; entry = next_entry) {
-                    next_entry = entry->next;
-                    wmem_free(wmem_epan_scope(), entry);
-                }
-            }
-            wmem_free(wmem_epan_scope(), subnet_length_entries[i].subnet_addresses);
-            subnet_length_entries[i].subnet_addresses = NULL;
-        }
+    if (subnet_ipv4_tree != NULL) {
+        wmem_prefix_tree_destroy(subnet_ipv4_tree, TRUE);
+        subnet_ipv4_tree = NULL;
+    }
+    if (subnet_ipv6_tree != NULL) {
+        wmem_prefix_tree_destroy(subnet_ipv6_tree, TRUE);
+        subnet_ipv6_tree = NULL;
     }
 
-    have_subnet_entry = FALSE;
     new_resolved_objects = FALSE;
 }
 
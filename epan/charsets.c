@@ -10,6 +10,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib.h>
 
 #include <epan/proto.h>
@@ -17,6 +19,7 @@
 
 #include <wsutil/pint.h>
 #include <wsutil/unicode-utils.h>
+#include <wsutil/ws_strscan.h>
 
 #include "charsets.h"
 
@@ -54,6 +57,73 @@
  * the code pages don't all work (do *any* work?).
  */
 
+/*
+ * Given a wmem scope, a pointer, and a length, treat the string of bytes
+ * referred to by the pointer and length as a string of one octet per
+ * character, in which octets with the high-order bit clear are ASCII,
+ * and return a pointer to a UTF-8 string, allocated using the wmem scope.
+ *
+ * Octets with the high-order bit set are converted to the Unicode code
+ * point with the same value if latin1 is TRUE, and to the Unicode
+ * REPLACEMENT CHARACTER otherwise.
+ *
+ * Most strings in packets are all ASCII, so this copies runs of ASCII
+ * at a time, rather than appending octets one by one to a wmem_strbuf.
+ */
+static guint8 *
+get_ascii_or_8859_1_string(wmem_allocator_t *scope, const guint8 *ptr,
+                           gint length, gboolean latin1)
+{
+    const guint8 *p, *end;
+    guint8 *strbuf, *out;
+    size_t span, num_high = 0;
+
+    if (length < 0)
+        length = 0;
+    end = ptr + length;
+
+    /* Count the octets that take more than one byte in UTF-8. */
+    for (p = ptr; (span = ws_ascii_span(p, end - p)) < (size_t)(end - p); p += span + 1)
+        num_high++;
+
+    strbuf = (guint8 *)wmem_alloc(scope, length + num_high * (latin1 ? 1 : 2) + 1);
+    if (num_high == 0) {
+        memcpy(strbuf, ptr, length);
+        strbuf[length] = '\0';
+        return strbuf;
+    }
+
+    out = strbuf;
+    p = ptr;
+    for (;;) {
+        span = ws_ascii_span(p, end - p);
+        memcpy(out, p, span);
+        out += span;
+        p += span;
+        if (p == end)
+            break;
+        if (latin1) {
+            /*
+             * Note: we assume here that the code points
+             * 0x80-0x9F are used for C1 control characters,
+             * and thus have the same value as the corresponding
+             * Unicode code points.
+             */
+            *out++ = 0xC0 | (*p >> 6);
+            *out++ = 0x80 | (*p & 0x3F);
+        } else {
+            /* UTF-8 for UNREPL */
+            *out++ = 0xEF;
+            *out++ = 0xBF;
+            *out++ = 0xBD;
+        }
+        p++;
+    }
+    *out = '\0';
+
+    return strbuf;
+}
+
 /*
  * Given a wmem scope, a pointer, and a length, treat the string of bytes
  * referred to by the pointer and length as an ASCII string, with all bytes
@@ -66,22 +136,7 @@
 guint8 *
 get_ascii_string(wmem_allocator_t *scope, const guint8 *ptr, gint length)
 {
-    wmem_strbuf_t *str;
-
-    str = wmem_strbuf_sized_new(scope, length+1, 0);
-
-    while (length > 0) {
-        guint8 ch = *ptr;
-
-        if (ch < 0x80)
-            wmem_strbuf_append_c(str, ch);
-        else
-            wmem_strbuf_append_unichar(str, UNREPL);
-        ptr++;
-        length--;
-    }
-
-    return (guint8 *) wmem_strbuf_finalize(str);
+    return get_ascii_or_8859_1_string(scope, ptr, length, FALSE);
 }
 
 /*
@@ -145,29 +200,7 @@ get_iso_646_string(wmem_allocator_t *scope, const guint8 *ptr, gint length, cons
 guint8 *
 get_8859_1_string(wmem_allocator_t *scope, const guint8 *ptr, gint length)
 {
-    wmem_strbuf_t *str;
-
-    str = wmem_strbuf_sized_new(scope, length+1, 0);
-
-    while (length > 0) {
-        guint8 ch = *ptr;
-
-        if (ch < 0x80)
-            wmem_strbuf_append_c(str, ch);
-        else {
-            /*
-             * Note: we assume here that the code points
-             * 0x80-0x9F are used for C1 control characters,
-             * and thus have the same value as the corresponding
-             * Unicode code points.
-             */
-            wmem_strbuf_append_unichar(str, ch);
-        }
-        ptr++;
-        length--;
-    }
-
-    return (guint8 *) wmem_strbuf_finalize(str);
+    return get_ascii_or_8859_1_string(scope, ptr, length, TRUE);
 }
 
 /*
@@ -0,0 +1,389 @@
+/* charsets_test.c
+ * Tests of the string scanning routines and the ASCII and ISO 8859-1
+ * string getters, at each SIMD level, and a benchmark of them
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "charsets.h"
+#include "exceptions.h"
+#include "tvbuff.h"
+#include <wsutil/ws_mempbrk.h>
+#include <wsutil/ws_strscan.h>
+
+/* Run the benchmark with "charsets_test -m perf". */
+#define BENCH_BUF_LEN   (64 * 1024)
+#define BENCH_ROUNDS    2000
+
+#define TEST_BUF_LEN    200
+
+/*
+ * Run a test at each level the CPU supports, so that the portable
+ * routines are tested even where there's SIMD.
+ */
+static void
+foreach_level(void (*test)(void))
+{
+    ws_strscan_level_e best, level;
+
+    best = ws_strscan_set_level(WS_STRSCAN_AVX2);
+    for (level = WS_STRSCAN_PORTABLE; level <= best; level++) {
+        if (ws_strscan_set_level(level) != level)
+            continue;
+        test();
+    }
+    ws_strscan_set_level(best);
+}
+
+/* A mostly printable buffer, with a high-bit octet now and then. */
+static void
+fill_random(guint8 *buf, size_t len, gint32 high_one_in)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        if (g_test_rand_int_range(0, high_one_in) == 0)
+            buf[i] = (guint8)g_test_rand_int_range(0x80, 0x100);
+        else
+            buf[i] = (guint8)g_test_rand_int_range(0x09, 0x7f);
+    }
+}
+
+static size_t
+ref_ascii_span(const guint8 *buf, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len && buf[i] < 0x80; i++)
+        ;
+    return i;
+}
+
+static const guint8 *
+ref_memchr_any(const guint8 *buf, size_t len, const guint8 *needles, guint num_needles)
+{
+    size_t i;
+    guint j;
+
+    for (i = 0; i < len; i++) {
+        for (j = 0; j < num_needles; j++) {
+            if (buf[i] == needles[j])
+                return buf + i;
+        }
+    }
+    return NULL;
+}
+
+static void
+check_ascii_span(void)
+{
+    guint8 buf[TEST_BUF_LEN];
+    size_t off, len;
+    int i;
+
+    for (i = 0; i < 10000; i++) {
+        fill_random(buf, sizeof buf, 64);
+        off = g_test_rand_int_range(0, 32);
+        len = g_test_rand_int_range(0, TEST_BUF_LEN - 32);
+        g_assert_cmpuint(ws_ascii_span(buf + off, len), ==, ref_ascii_span(buf + off, len));
+    }
+
+    /* All ASCII, and the high-bit octet in every position. */
+    memset(buf, 'a', sizeof buf);
+    g_assert_cmpuint(ws_ascii_span(buf, sizeof buf), ==, sizeof buf);
+    for (len = 0; len < 70; len++) {
+        buf[len] = 0xe9;
+        g_assert_cmpuint(ws_ascii_span(buf, sizeof buf), ==, len);
+        buf[len] = 'a';
+    }
+    g_assert_cmpuint(ws_ascii_span(buf, 0), ==, 0);
+}
+
+static void
+check_memchr_any(void)
+{
+    static const guint8 needles[] = { '\r', '\n', '"', ' ' };
+    guint8 buf[TEST_BUF_LEN];
+    size_t off, len;
+    guint num_needles;
+    int i;
+
+    for (i = 0; i < 10000; i++) {
+        fill_random(buf, sizeof buf, 64);
+        off = g_test_rand_int_range(0, 32);
+        len = g_test_rand_int_range(0, TEST_BUF_LEN - 32);
+        num_needles = g_test_rand_int_range(1, WS_MEMCHR_ANY_MAX + 1);
+        g_assert(ws_memchr_any(buf + off, len, needles, num_needles) ==
+                 ref_memchr_any(buf + off, len, needles, num_needles));
+    }
+
+    /* A needle that's a high-bit octet. */
+    memset(buf, 'a', sizeof buf);
+    buf[100] = 0xff;
+    g_assert(ws_memchr_any(buf, sizeof buf, (const guint8 *)"\r\xff", 2) == buf + 100);
+    g_assert(ws_memchr_any(buf, 100, (const guint8 *)"\r\xff", 2) == NULL);
+}
+
+static void
+charsets_test_ascii_span(void)
+{
+    foreach_level(check_ascii_span);
+}
+
+static void
+charsets_test_memchr_any(void)
+{
+    foreach_level(check_memchr_any);
+}
+
+static void
+check_mempbrk(void)
+{
+    ws_mempbrk_pattern crlf, many;
+    const guint8 *haystack = (const guint8 *)"GET / HTTP/1.1\r\nHost: example.com\r\n\r\n";
+    size_t len = strlen((const char *)haystack);
+    guchar found = 0;
+
+    memset(&crlf, 0, sizeof crlf);
+    ws_mempbrk_compile(&crlf, "\r\n");
+    g_assert(ws_mempbrk_exec(haystack, len, &crlf, &found) == haystack + 14);
+    g_assert_cmpint(found, ==, '\r');
+    g_assert(ws_mempbrk_exec(haystack, 14, &crlf, &found) == NULL);
+
+    /* More needles than are compared one by one. */
+    memset(&many, 0, sizeof many);
+    ws_mempbrk_compile(&many, "xyz:\n");
+    g_assert(ws_mempbrk_exec(haystack, len, &many, &found) == haystack + 15);
+    g_assert_cmpint(found, ==, '\n');
+}
+
+static void
+charsets_test_mempbrk(void)
+{
+    foreach_level(check_mempbrk);
+}
+
+static void
+check_get_string(void)
+{
+    static const guint8 mixed[] = "caf\xe9 \x80\xff!";
+    guint8 *str;
+
+    str = get_ascii_string(NULL, (const guint8 *)"", 0);
+    g_assert_cmpstr((char *)str, ==, "");
+    g_free(str);
+
+    str = get_ascii_string(NULL, (const guint8 *)"plain ASCII text", 16);
+    g_assert_cmpstr((char *)str, ==, "plain ASCII text");
+    g_free(str);
+
+    str = get_ascii_string(NULL, mixed, sizeof mixed - 1);
+    g_assert_cmpstr((char *)str, ==, "caf\xef\xbf\xbd \xef\xbf\xbd\xef\xbf\xbd!");
+    g_free(str);
+
+    str = get_8859_1_string(NULL, mixed, sizeof mixed - 1);
+    g_assert_cmpstr((char *)str, ==, "caf\xc3\xa9 \xc2\x80\xc3\xbf!");
+    g_free(str);
+
+    /* Embedded NULs are copied too. */
+    str = get_8859_1_string(NULL, (const guint8 *)"a\0b", 3);
+    g_assert(memcmp(str, "a\0b", 4) == 0);
+    g_free(str);
+}
+
+static void
+check_get_string_random(void)
+{
+    guint8 buf[TEST_BUF_LEN];
+    GString *expected;
+    guint8 *str;
+    size_t len, i;
+    int n;
+
+    expected = g_string_new(NULL);
+    for (n = 0; n < 2000; n++) {
+        fill_random(buf, sizeof buf, 16);
+        len = g_test_rand_int_range(0, TEST_BUF_LEN);
+
+        g_string_truncate(expected, 0);
+        for (i = 0; i < len; i++)
+            g_string_append_unichar(expected, buf[i]);
+        str = get_8859_1_string(NULL, buf, (gint)len);
+        g_assert_cmpstr((char *)str, ==, expected->str);
+        g_free(str);
+
+        g_string_truncate(expected, 0);
+        for (i = 0; i < len; i++)
+            g_string_append_unichar(expected, buf[i] < 0x80 ? buf[i] : 0xFFFD);
+        str = get_ascii_string(NULL, buf, (gint)len);
+        g_assert_cmpstr((char *)str, ==, expected->str);
+        g_free(str);
+    }
+    g_string_free(expected, TRUE);
+}
+
+static void
+charsets_test_get_string(void)
+{
+    foreach_level(check_get_string);
+    foreach_level(check_get_string_random);
+}
+
+static void
+check_find_line_end(void)
+{
+    static const char text[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain; charset=utf-8\r\n"
+        "\r\n"
+        "no terminator";
+    tvbuff_t *tvb;
+    gint next_offset, linelen;
+
+    tvb = tvb_new_real_data((const guint8 *)text, sizeof text - 1, sizeof text - 1);
+
+    linelen = tvb_find_line_end(tvb, 0, -1, &next_offset, FALSE);
+    g_assert_cmpint(linelen, ==, 15);
+    g_assert_cmpint(next_offset, ==, 17);
+
+    linelen = tvb_find_line_end(tvb, next_offset, -1, &next_offset, FALSE);
+    g_assert_cmpint(linelen, ==, 39);
+    g_assert_cmpint(next_offset, ==, 58);
+
+    linelen = tvb_find_line_end(tvb, next_offset, -1, &next_offset, FALSE);
+    g_assert_cmpint(linelen, ==, 0);
+    g_assert_cmpint(next_offset, ==, 60);
+
+    g_assert_cmpint(tvb_find_line_end(tvb, next_offset, -1, NULL, TRUE), ==, -1);
+    linelen = tvb_find_line_end(tvb, next_offset, -1, &next_offset, FALSE);
+    g_assert_cmpint(linelen, ==, 13);
+    g_assert_cmpint(next_offset, ==, 73);
+
+    tvb_free(tvb);
+}
+
+static void
+charsets_test_find_line_end(void)
+{
+    foreach_level(check_find_line_end);
+}
+
+/*
+ * Time the routines at each level on a buffer of HTTP-like text, with a
+ * line end every 40 octets on average and, for the string getters, a
+ * high-bit octet every 4096.
+ */
+static void
+bench_level(void)
+{
+    static const guint8 crlf[] = { '\r', '\n' };
+    guint8 *buf;
+    GTimer *timer;
+    gdouble span_s, memchr_s, ascii_s, latin1_s;
+    const guint8 *p, *end;
+    guint8 *str;
+    size_t i;
+    int round;
+    guint64 sink = 0;
+
+    buf = (guint8 *)g_malloc(BENCH_BUF_LEN);
+    fill_random(buf, BENCH_BUF_LEN, 4096);
+    for (i = 0; i < BENCH_BUF_LEN; i++) {
+        if (buf[i] == '\r' || buf[i] == '\n')
+            buf[i] = ' ';
+        if (g_test_rand_int_range(0, 40) == 0)
+            buf[i] = '\n';
+    }
+    end = buf + BENCH_BUF_LEN;
+    timer = g_timer_new();
+
+    g_timer_start(timer);
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        for (p = buf; p < end; p += ws_ascii_span(p, end - p) + 1)
+            sink++;
+    }
+    span_s = g_timer_elapsed(timer, NULL);
+
+    g_timer_start(timer);
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        for (p = buf; (p = ws_memchr_any(p, end - p, crlf, 2)) != NULL; p++)
+            sink++;
+    }
+    memchr_s = g_timer_elapsed(timer, NULL);
+
+    g_timer_start(timer);
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        str = get_ascii_string(NULL, buf, BENCH_BUF_LEN);
+        sink += str[0];
+        g_free(str);
+    }
+    ascii_s = g_timer_elapsed(timer, NULL);
+
+    g_timer_start(timer);
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        str = get_8859_1_string(NULL, buf, BENCH_BUF_LEN);
+        sink += str[0];
+        g_free(str);
+    }
+    latin1_s = g_timer_elapsed(timer, NULL);
+
+#define MBPS(s) ((gdouble)BENCH_BUF_LEN * BENCH_ROUNDS / (s) / 1e6)
+    g_test_minimized_result(span_s, "%-8s ASCII span %7.0f MB/s, CR/LF search %7.0f MB/s, "
+            "ASCII string %7.0f MB/s, 8859-1 string %7.0f MB/s (%" G_GUINT64_FORMAT ")",
+            ws_strscan_level_name(ws_strscan_get_level()),
+            MBPS(span_s), MBPS(memchr_s), MBPS(ascii_s), MBPS(latin1_s), sink);
+#undef MBPS
+
+    g_timer_destroy(timer);
+    g_free(buf);
+}
+
+static void
+charsets_test_bench(void)
+{
+    foreach_level(bench_level);
+}
+
+int
+main(int argc, char **argv)
+{
+    int result;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/charsets/strscan/ascii_span", charsets_test_ascii_span);
+    g_test_add_func("/charsets/strscan/memchr_any", charsets_test_memchr_any);
+    g_test_add_func("/charsets/strscan/mempbrk", charsets_test_mempbrk);
+    g_test_add_func("/charsets/get_string", charsets_test_get_string);
+    g_test_add_func("/charsets/tvb_find_line_end", charsets_test_find_line_end);
+    if (g_test_perf())
+        g_test_add_func("/charsets/bench", charsets_test_bench);
+
+    except_init();
+    result = g_test_run();
+    except_deinit();
+
+    return result;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
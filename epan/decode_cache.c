@@ -0,0 +1,170 @@
+/* decode_cache.c
+ * Cache of decoded (decompressed, decrypted, ...) data, so that it doesn't
+ * have to be decoded again when a packet is dissected again
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/crc32.h>
+
+#include "prefs.h"
+#include "decode_cache.h"
+
+typedef struct {
+    decode_cache_key_t key;
+    GList lru_link;         /* in decode_cache_lru, most recently used first */
+    guint8 *data;
+    guint len;
+} decode_cache_entry_t;
+
+static GHashTable *decode_cache_table = NULL;   /* key -> decode_cache_entry_t */
+static GQueue decode_cache_lru = G_QUEUE_INIT;
+static decode_cache_stats_t decode_cache_stats;
+
+static guint
+decode_cache_hash(gconstpointer k)
+{
+    const decode_cache_key_t *key = (const decode_cache_key_t *)k;
+
+    return key->frame ^ (key->encoded_crc * 31) ^ ((guint)key->proto << 16) ^
+        (guint)key->offset ^ ((guint)key->layer << 24);
+}
+
+static gboolean
+decode_cache_equal(gconstpointer k1, gconstpointer k2)
+{
+    const decode_cache_key_t *key1 = (const decode_cache_key_t *)k1;
+    const decode_cache_key_t *key2 = (const decode_cache_key_t *)k2;
+
+    return key1->frame == key2->frame && key1->proto == key2->proto &&
+        key1->offset == key2->offset && key1->layer == key2->layer &&
+        key1->encoded_len == key2->encoded_len &&
+        key1->encoded_crc == key2->encoded_crc;
+}
+
+static void
+decode_cache_remove(decode_cache_entry_t *entry)
+{
+    g_queue_unlink(&decode_cache_lru, &entry->lru_link);
+    g_hash_table_remove(decode_cache_table, &entry->key);
+    decode_cache_stats.bytes -= entry->len;
+    decode_cache_stats.entries--;
+    g_free(entry->data);
+    g_free(entry);
+}
+
+void
+decode_cache_key_init(decode_cache_key_t *key, int proto, packet_info *pinfo,
+    tvbuff_t *encoded)
+{
+    guint len = tvb_captured_length(encoded);
+
+    memset(key, 0, sizeof *key);
+    key->frame = pinfo->num;
+    key->proto = proto;
+    key->offset = tvb_raw_offset(encoded);
+    key->layer = pinfo->curr_layer_num;
+    key->encoded_len = len;
+    key->encoded_crc = crc32c_calculate_no_swap(tvb_get_ptr(encoded, 0, len), len, CRC32C_PRELOAD);
+}
+
+tvbuff_t *
+decode_cache_get(tvbuff_t *parent, const decode_cache_key_t *key)
+{
+    decode_cache_entry_t *entry;
+    tvbuff_t *tvb;
+    guint8 *data;
+
+    if (decode_cache_table == NULL ||
+        (entry = (decode_cache_entry_t *)g_hash_table_lookup(decode_cache_table, key)) == NULL) {
+        decode_cache_stats.misses++;
+        return NULL;
+    }
+    decode_cache_stats.hits++;
+
+    g_queue_unlink(&decode_cache_lru, &entry->lru_link);
+    g_queue_push_head_link(&decode_cache_lru, &entry->lru_link);
+
+    /*
+     * Hand out a copy, as the entry may be dropped while the packet is
+     * still being dissected.
+     */
+    data = (guint8 *)g_memdup(entry->data, entry->len);
+    tvb = tvb_new_child_real_data(parent, data, entry->len, entry->len);
+    tvb_set_free_cb(tvb, g_free);
+    return tvb;
+}
+
+void
+decode_cache_put(const decode_cache_key_t *key, tvbuff_t *decoded)
+{
+    gsize limit = (gsize)prefs.decode_cache_size * 1024 * 1024;
+    decode_cache_entry_t *entry;
+    guint len = tvb_captured_length(decoded);
+
+    /* A size of 0 turns the cache off. */
+    if (limit == 0 || len > limit)
+        return;
+
+    if (decode_cache_table == NULL)
+        decode_cache_table = g_hash_table_new(decode_cache_hash, decode_cache_equal);
+    else if ((entry = (decode_cache_entry_t *)g_hash_table_lookup(decode_cache_table, key)) != NULL)
+        decode_cache_remove(entry);
+
+    while (decode_cache_stats.bytes + len > limit && decode_cache_lru.tail != NULL) {
+        decode_cache_remove((decode_cache_entry_t *)decode_cache_lru.tail->data);
+        decode_cache_stats.evictions++;
+    }
+
+    entry = g_new(decode_cache_entry_t, 1);
+    entry->key = *key;
+    entry->lru_link.data = entry;
+    entry->lru_link.prev = entry->lru_link.next = NULL;
+    entry->data = (guint8 *)tvb_memdup(NULL, decoded, 0, len);
+    entry->len = len;
+    g_queue_push_head_link(&decode_cache_lru, &entry->lru_link);
+    g_hash_table_insert(decode_cache_table, &entry->key, entry);
+    decode_cache_stats.bytes += len;
+    decode_cache_stats.entries++;
+}
+
+void
+decode_cache_get_stats(decode_cache_stats_t *stats)
+{
+    *stats = decode_cache_stats;
+}
+
+void
+decode_cache_cleanup(void)
+{
+    while (decode_cache_lru.head != NULL)
+        decode_cache_remove((decode_cache_entry_t *)decode_cache_lru.head->data);
+    if (decode_cache_table != NULL) {
+        g_hash_table_destroy(decode_cache_table);
+        decode_cache_table = NULL;
+    }
+    memset(&decode_cache_stats, 0, sizeof decode_cache_stats);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,92 @@
+/* decode_cache.h
+ * Cache of decoded (decompressed, decrypted, ...) data, so that it doesn't
+ * have to be decoded again when a packet is dissected again
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __DECODE_CACHE_H__
+#define __DECODE_CACHE_H__
+
+#include <glib.h>
+#include <epan/tvbuff.h>
+#include <epan/packet_info.h>
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * The data decoded from a piece of a frame is cached under the frame
+ * number, protocol, layer and offset of the encoded data, along with its
+ * length and a checksum, so that different data that happens to be at
+ * the same place, such as two reassembled PDUs, doesn't get mixed up.
+ *
+ * The cache holds at most prefs.decode_cache_size megabytes; the least
+ * recently used data is dropped to make room. It's emptied when the
+ * capture file is closed.
+ */
+typedef struct _decode_cache_key_t {
+    guint32 frame;
+    gint    proto;
+    gint    offset;
+    guint32 encoded_len;
+    guint32 encoded_crc;
+    guint8  layer;
+} decode_cache_key_t;
+
+typedef struct _decode_cache_stats_t {
+    guint64 hits;
+    guint64 misses;
+    guint64 evictions;
+    guint   entries;
+    gsize   bytes;
+} decode_cache_stats_t;
+
+/** Fill in the key of the data decoded from encoded, by protocol proto
+ * at pinfo's current layer.
+ */
+WS_DLL_PUBLIC void decode_cache_key_init(decode_cache_key_t *key, int proto,
+    packet_info *pinfo, tvbuff_t *encoded);
+
+/** Return a new child tvbuff of parent with the data that was cached
+ * under key, or NULL if there isn't any.
+ */
+WS_DLL_PUBLIC tvbuff_t *decode_cache_get(tvbuff_t *parent, const decode_cache_key_t *key);
+
+/** Cache the contents of decoded under key. */
+WS_DLL_PUBLIC void decode_cache_put(const decode_cache_key_t *key, tvbuff_t *decoded);
+
+/** Get the number of hits, misses and evictions since the capture file
+ * was opened, and what the cache holds now.
+ */
+WS_DLL_PUBLIC void decode_cache_get_stats(decode_cache_stats_t *stats);
+
+/** Empty the cache and reset its statistics; called when a capture file
+ * is closed.
+ */
+extern void decode_cache_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __DECODE_CACHE_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,185 @@
+/* decode_cache_test.c
+ * Tests of the cache of decoded data
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "decode_cache.h"
+#include "exceptions.h"
+#include "prefs.h"
+#include "tvbuff.h"
+
+#define PROTO_TEST  42
+#define DATA_LEN    (400 * 1024)
+
+static guint8 encoded_bufs[4][16];
+static guint8 *decoded_bufs[4];
+
+/* Cache decoded_bufs[i] as what encoded_bufs[i] in frame i decodes to. */
+static void
+put_frame(guint i)
+{
+    packet_info pinfo;
+    decode_cache_key_t key;
+    tvbuff_t *encoded, *decoded;
+
+    memset(&pinfo, 0, sizeof pinfo);
+    pinfo.num = i;
+    encoded = tvb_new_real_data(encoded_bufs[i], sizeof encoded_bufs[i], sizeof encoded_bufs[i]);
+    decoded = tvb_new_real_data(decoded_bufs[i], DATA_LEN, DATA_LEN);
+    decode_cache_key_init(&key, PROTO_TEST, &pinfo, encoded);
+    decode_cache_put(&key, decoded);
+    tvb_free(decoded);
+    tvb_free(encoded);
+}
+
+/* Return TRUE if frame i is cached, checking what's cached if it is. */
+static gboolean
+get_frame(guint i)
+{
+    packet_info pinfo;
+    decode_cache_key_t key;
+    tvbuff_t *encoded, *decoded;
+    gboolean found;
+
+    memset(&pinfo, 0, sizeof pinfo);
+    pinfo.num = i;
+    encoded = tvb_new_real_data(encoded_bufs[i], sizeof encoded_bufs[i], sizeof encoded_bufs[i]);
+    decode_cache_key_init(&key, PROTO_TEST, &pinfo, encoded);
+    decoded = decode_cache_get(encoded, &key);
+    found = decoded != NULL;
+    if (found) {
+        g_assert_cmpuint(tvb_captured_length(decoded), ==, DATA_LEN);
+        g_assert(tvb_memeql(decoded, 0, decoded_bufs[i], DATA_LEN) == 0);
+    }
+    tvb_free_chain(encoded);
+    return found;
+}
+
+static void
+decode_cache_test_hit_miss(void)
+{
+    decode_cache_stats_t stats;
+    guint8 saved;
+
+    prefs.decode_cache_size = 4;
+
+    g_assert(!get_frame(0));
+    put_frame(0);
+    g_assert(get_frame(0));
+
+    /* The same place with different contents isn't a hit. */
+    saved = encoded_bufs[0][3];
+    encoded_bufs[0][3] ^= 0xff;
+    g_assert(!get_frame(0));
+    encoded_bufs[0][3] = saved;
+
+    decode_cache_get_stats(&stats);
+    g_assert_cmpuint(stats.hits, ==, 1);
+    g_assert_cmpuint(stats.misses, ==, 2);
+    g_assert_cmpuint(stats.entries, ==, 1);
+    g_assert_cmpuint(stats.bytes, ==, DATA_LEN);
+
+    decode_cache_cleanup();
+    decode_cache_get_stats(&stats);
+    g_assert_cmpuint(stats.entries, ==, 0);
+    g_assert_cmpuint(stats.hits, ==, 0);
+    g_assert(!get_frame(0));
+    decode_cache_cleanup();
+}
+
+static void
+decode_cache_test_lru(void)
+{
+    decode_cache_stats_t stats;
+
+    /* Room for two entries. */
+    prefs.decode_cache_size = 1;
+
+    put_frame(0);
+    put_frame(1);
+    g_assert(get_frame(0));     /* so 1 is now the least recently used */
+    put_frame(2);
+
+    g_assert(get_frame(0));
+    g_assert(!get_frame(1));
+    g_assert(get_frame(2));
+
+    decode_cache_get_stats(&stats);
+    g_assert_cmpuint(stats.evictions, ==, 1);
+    g_assert_cmpuint(stats.entries, ==, 2);
+
+    /* Putting the same key again replaces the entry. */
+    put_frame(2);
+    decode_cache_get_stats(&stats);
+    g_assert_cmpuint(stats.entries, ==, 2);
+    g_assert_cmpuint(stats.bytes, ==, 2 * DATA_LEN);
+
+    decode_cache_cleanup();
+}
+
+static void
+decode_cache_test_disabled(void)
+{
+    decode_cache_stats_t stats;
+
+    prefs.decode_cache_size = 0;
+
+    put_frame(3);
+    g_assert(!get_frame(3));
+    decode_cache_get_stats(&stats);
+    g_assert_cmpuint(stats.entries, ==, 0);
+
+    decode_cache_cleanup();
+}
+
+int
+main(int argc, char **argv)
+{
+    int result;
+    guint i, j;
+
+    g_test_init(&argc, &argv, NULL);
+
+    for (i = 0; i < G_N_ELEMENTS(decoded_bufs); i++) {
+        for (j = 0; j < sizeof encoded_bufs[i]; j++)
+            encoded_bufs[i][j] = (guint8)(i * 16 + j);
+        decoded_bufs[i] = (guint8 *)g_malloc(DATA_LEN);
+        memset(decoded_bufs[i], 'a' + i, DATA_LEN);
+    }
+
+    g_test_add_func("/decode_cache/hit_miss", decode_cache_test_hit_miss);
+    g_test_add_func("/decode_cache/lru", decode_cache_test_lru);
+    g_test_add_func("/decode_cache/disabled", decode_cache_test_disabled);
+
+    except_init();
+    result = g_test_run();
+    except_deinit();
+
+    for (i = 0; i < G_N_ELEMENTS(decoded_bufs); i++)
+        g_free(decoded_bufs[i]);
+
+    return result;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
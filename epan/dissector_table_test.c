@@ -0,0 +1,251 @@
+/* dissector_table_test.c
+ * Uint dissector table tests and a lookup benchmark
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <glib.h>
+
+#include "epan.h"
+#include "packet.h"
+#include <wiretap/wtap.h>
+
+/* Run the benchmark with "dissector_table_test -m perf". */
+#define BENCH_LOOKUPS   (16 * 1024 * 1024)
+#define BENCH_KEYS      4096
+
+static dissector_handle_t handle_a;
+static dissector_handle_t handle_b;
+
+static int
+dissect_dummy(tvbuff_t *tvb _U_, packet_info *pinfo _U_, proto_tree *tree _U_, void *data _U_)
+{
+    return 0;
+}
+
+static dissector_table_t
+new_table(const char *name, ftenum_t type)
+{
+    dissector_table_t table;
+
+    table = find_dissector_table(name);
+    if (table == NULL)
+        table = register_dissector_table(name, name, -1, type, BASE_DEC);
+    return table;
+}
+
+static void
+dissector_table_test_add_lookup(void)
+{
+    dissector_table_t table = new_table("test.add", FT_UINT16);
+
+    g_assert(dissector_get_uint_handle(table, 80) == NULL);
+
+    dissector_add_uint("test.add", 0, handle_a);
+    dissector_add_uint("test.add", 80, handle_a);
+    dissector_add_uint("test.add", 255, handle_b);
+    dissector_add_uint("test.add", 256, handle_b);
+    dissector_add_uint("test.add", 65535, handle_a);
+
+    g_assert(dissector_get_uint_handle(table, 0) == handle_a);
+    g_assert(dissector_get_uint_handle(table, 80) == handle_a);
+    g_assert(dissector_get_uint_handle(table, 81) == NULL);
+    g_assert(dissector_get_uint_handle(table, 255) == handle_b);
+    g_assert(dissector_get_uint_handle(table, 256) == handle_b);
+    g_assert(dissector_get_uint_handle(table, 257) == NULL);
+    g_assert(dissector_get_uint_handle(table, 65535) == handle_a);
+    g_assert(dissector_get_uint_handle(table, 65536) == NULL);
+
+    /* Adding again replaces the entry. */
+    dissector_add_uint("test.add", 80, handle_b);
+    g_assert(dissector_get_uint_handle(table, 80) == handle_b);
+
+    dissector_delete_uint("test.add", 80, handle_b);
+    g_assert(dissector_get_uint_handle(table, 80) == NULL);
+    g_assert(dissector_get_uint_handle(table, 255) == handle_b);
+}
+
+static void
+dissector_table_test_large_keys(void)
+{
+    dissector_table_t table = new_table("test.large", FT_UINT32);
+
+    dissector_add_uint("test.large", 65536, handle_a);
+    dissector_add_uint("test.large", 0x12345678, handle_b);
+    dissector_add_uint("test.large", G_MAXUINT32, handle_a);
+    g_assert(dissector_get_uint_handle(table, 0) == NULL);
+    g_assert(dissector_get_uint_handle(table, 65536) == handle_a);
+    g_assert(dissector_get_uint_handle(table, 0x12345678) == handle_b);
+    g_assert(dissector_get_uint_handle(table, G_MAXUINT32) == handle_a);
+
+    /* Small keys in a table that already has large ones. */
+    dissector_add_uint("test.large", 1, handle_b);
+    g_assert(dissector_get_uint_handle(table, 1) == handle_b);
+    g_assert(dissector_get_uint_handle(table, 65536) == handle_a);
+
+    dissector_delete_uint("test.large", 0x12345678, handle_b);
+    g_assert(dissector_get_uint_handle(table, 0x12345678) == NULL);
+    g_assert(dissector_get_uint_handle(table, 1) == handle_b);
+}
+
+static void
+dissector_table_test_change_reset(void)
+{
+    dissector_table_t table = new_table("test.change", FT_UINT8);
+
+    dissector_add_uint("test.change", 17, handle_a);
+
+    /* Changing an entry keeps its initial handle. */
+    dissector_change_uint("test.change", 17, handle_b);
+    g_assert(dissector_get_uint_handle(table, 17) == handle_b);
+    dissector_reset_uint("test.change", 17);
+    g_assert(dissector_get_uint_handle(table, 17) == handle_a);
+
+    /* Entries created by a change go away on reset. */
+    dissector_change_uint("test.change", 6, handle_b);
+    g_assert(dissector_get_uint_handle(table, 6) == handle_b);
+    dissector_reset_uint("test.change", 6);
+    g_assert(dissector_get_uint_handle(table, 6) == NULL);
+
+    /* A change to no handle doesn't create an entry. */
+    dissector_change_uint("test.change", 7, NULL);
+    g_assert(dissector_get_uint_handle(table, 7) == NULL);
+}
+
+static void
+dissector_table_test_delete_all(void)
+{
+    dissector_table_t table = new_table("test.delete_all", FT_UINT16);
+    dissector_handle_t handle_c;
+    int proto_c;
+
+    /* dissector_delete_all() matches handles by protocol. */
+    proto_c = proto_register_protocol("Dissector table test", "DTT", "dtt");
+    handle_c = create_dissector_handle(dissect_dummy, proto_c);
+
+    dissector_add_uint("test.delete_all", 1, handle_c);
+    dissector_add_uint("test.delete_all", 1000, handle_c);
+    dissector_add_uint("test.delete_all", 70000, handle_c);
+    dissector_add_uint("test.delete_all", 2, handle_a);
+
+    dissector_delete_all("test.delete_all", handle_c);
+    g_assert(dissector_get_uint_handle(table, 1) == NULL);
+    g_assert(dissector_get_uint_handle(table, 1000) == NULL);
+    g_assert(dissector_get_uint_handle(table, 70000) == NULL);
+    g_assert(dissector_get_uint_handle(table, 2) == handle_a);
+}
+
+static void
+copy_table_entry(const gchar *table_name _U_, ftenum_t selector_type _U_,
+        gpointer key, gpointer value, gpointer user_data)
+{
+    g_hash_table_insert((GHashTable *)user_data, key, value);
+}
+
+/*
+ * Look up random keys in one of the real tables, and in a plain
+ * GHashTable with the same keys, which is how dissector tables used
+ * to be looked up.
+ */
+static void
+bench_table(const char *name, guint32 max_key)
+{
+    dissector_table_t table = find_dissector_table(name);
+    GHashTable *hash;
+    guint32 *keys;
+    GTimer *timer;
+    gdouble table_ns, hash_ns;
+    guint hits, i;
+
+    g_assert(table != NULL);
+    hash = g_hash_table_new(g_direct_hash, g_direct_equal);
+    dissector_table_foreach(name, copy_table_entry, hash);
+
+    keys = g_new(guint32, BENCH_KEYS);
+    for (i = 0; i < BENCH_KEYS; i++)
+        keys[i] = g_test_rand_int_range(0, max_key + 1);
+
+    timer = g_timer_new();
+
+    hits = 0;
+    g_timer_start(timer);
+    for (i = 0; i < BENCH_LOOKUPS; i++) {
+        if (dissector_get_uint_handle(table, keys[i % BENCH_KEYS]) != NULL)
+            hits++;
+    }
+    table_ns = g_timer_elapsed(timer, NULL) * 1e9 / BENCH_LOOKUPS;
+
+    g_timer_start(timer);
+    for (i = 0; i < BENCH_LOOKUPS; i++) {
+        if (g_hash_table_lookup(hash, GUINT_TO_POINTER(keys[i % BENCH_KEYS])) != NULL)
+            hits--;
+    }
+    hash_ns = g_timer_elapsed(timer, NULL) * 1e9 / BENCH_LOOKUPS;
+
+    /* Both must have found the same entries. */
+    g_assert(hits == 0);
+
+    g_test_minimized_result(table_ns, "%-10s %5u entries: %5.1f ns per lookup, %5.1f ns hashed",
+            name, g_hash_table_size(hash), table_ns, hash_ns);
+
+    g_timer_destroy(timer);
+    g_free(keys);
+    g_hash_table_destroy(hash);
+}
+
+static void
+dissector_table_test_bench(void)
+{
+    bench_table("ethertype", 0xffff);
+    bench_table("ip.proto", 0xff);
+    bench_table("tcp.port", 0xffff);
+    bench_table("udp.port", 0xffff);
+}
+
+int
+main(int argc, char **argv)
+{
+    int result;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/dissector_table/uint/add_lookup", dissector_table_test_add_lookup);
+    g_test_add_func("/dissector_table/uint/large_keys", dissector_table_test_large_keys);
+    g_test_add_func("/dissector_table/uint/change_reset", dissector_table_test_change_reset);
+    g_test_add_func("/dissector_table/uint/delete_all", dissector_table_test_delete_all);
+    if (g_test_perf())
+        g_test_add_func("/dissector_table/uint/bench", dissector_table_test_bench);
+
+    wtap_init(FALSE);
+    if (!epan_init(NULL, NULL, FALSE))
+        return 2;
+    handle_a = create_dissector_handle(dissect_dummy, -1);
+    handle_b = create_dissector_handle(dissect_dummy, -1);
+
+    result = g_test_run();
+
+    epan_cleanup();
+    wtap_cleanup();
+
+    return result;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -441,7 +441,7 @@ dcm_eo_packet(void *tapdata, packet_info *pinfo, epan_dissect_t *edt _U_,
            Still, the values will be freed when the export Object window is closed.
            Therefore, strings and buffers must be copied
         */
-        entry = g_new(export_object_entry_t, 1);
+        entry = g_new0(export_object_entry_t, 1);
 
         entry->pkt_num = pinfo->num;
         entry->hostname = eo_info->hostname;
@@ -33,6 +33,7 @@
 #include <epan/req_resp_hdrs.h>
 #include <epan/proto_data.h>
 #include <epan/export_object.h>
+#include <epan/decode_cache.h>
 
 #include "packet-http.h"
 #include "packet-tcp.h"
@@ -351,7 +352,7 @@ http_eo_packet(void *tapdata, packet_info *pinfo, epan_dissect_t *edt _U_, const
 	if(eo_info) { /* We have data waiting for us */
 		/* These values will be freed when the Export Object window
 		 * is closed. */
-		entry = g_new(export_object_entry_t, 1);
+		entry = g_new0(export_object_entry_t, 1);
 
 		entry->pkt_num = pinfo->num;
 		entry->hostname = g_strdup(eo_info->hostname);
@@ -1727,28 +1728,48 @@ dissect_http_message(tvbuff_t *tvb, int offset, packet_info *pinfo,
 			tvbuff_t *uncomp_tvb = NULL;
 			proto_item *e_ti = NULL;
 			proto_tree *e_tree = NULL;
+			gboolean is_deflate = FALSE;
+			gboolean is_brotli = FALSE;
+			decode_cache_key_t cache_key;
 
 #ifdef HAVE_ZLIB
-			if (http_decompress_body &&
+			is_deflate = http_decompress_body &&
 			    (g_ascii_strcasecmp(headers.content_encoding, "gzip") == 0 ||
 			     g_ascii_strcasecmp(headers.content_encoding, "deflate") == 0 ||
 			     g_ascii_strcasecmp(headers.content_encoding, "x-gzip") == 0 ||
-			     g_ascii_strcasecmp(headers.content_encoding, "x-deflate") == 0))
-			{
-				uncomp_tvb = tvb_child_uncompress(tvb, next_tvb, 0,
-				    tvb_captured_length(next_tvb));
-			}
+			     g_ascii_strcasecmp(headers.content_encoding, "x-deflate") == 0);
 #endif
 
 #ifdef HAVE_BROTLI
-			if (http_decompress_body &&
-			    g_ascii_strcasecmp(headers.content_encoding, "br") == 0)
-			{
-				uncomp_tvb = tvb_child_uncompress_brotli(tvb, next_tvb, 0,
-				    tvb_captured_length(next_tvb));
-			}
+			is_brotli = http_decompress_body &&
+			    g_ascii_strcasecmp(headers.content_encoding, "br") == 0;
 #endif
 
+			if (is_deflate || is_brotli) {
+				/*
+				 * Decompressing a big body again each time
+				 * the packet is dissected is slow, so use
+				 * what we got last time, if it's cached.
+				 */
+				decode_cache_key_init(&cache_key, proto_http,
+				    pinfo, next_tvb);
+				uncomp_tvb = decode_cache_get(tvb, &cache_key);
+				if (uncomp_tvb == NULL) {
+#ifdef HAVE_ZLIB
+					if (is_deflate)
+						uncomp_tvb = tvb_child_uncompress(tvb, next_tvb, 0,
+						    tvb_captured_length(next_tvb));
+#endif
+#ifdef HAVE_BROTLI
+					if (is_brotli)
+						uncomp_tvb = tvb_child_uncompress_brotli(tvb, next_tvb, 0,
+						    tvb_captured_length(next_tvb));
+#endif
+					if (uncomp_tvb != NULL)
+						decode_cache_put(&cache_key, uncomp_tvb);
+				}
+			}
+
 			/*
 			 * Add the encoded entity to the protocol tree
 			 */
@@ -7716,6 +7716,11 @@ proto_register_rtcp(void)
 void
 proto_reg_handoff_rtcp(void)
 {
+    /* Version 2, and a packet type from 192 to 207. */
+    static const heur_prefilter_t rtcp_prefilter = {
+        0, 0, 2, { 0x80, 0xC0 }, { 0xC0, 0xF0 }
+    };
+
     /*
      * Register this dissector as one that can be selected by a
      * UDP port number.
@@ -7725,6 +7730,8 @@ proto_reg_handoff_rtcp(void)
 
     heur_dissector_add( "udp", dissect_rtcp_heur_udp, "RTCP over UDP", "rtcp_udp", proto_rtcp, HEURISTIC_ENABLE);
     heur_dissector_add("stun", dissect_rtcp_heur, "RTCP over TURN", "rtcp_stun", proto_rtcp, HEURISTIC_ENABLE);
+    heur_dissector_set_prefilter("rtcp_udp", &rtcp_prefilter);
+    heur_dissector_set_prefilter("rtcp_stun", &rtcp_prefilter);
 }
 
 /*
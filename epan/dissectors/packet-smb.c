@@ -1283,9 +1283,11 @@ smb_eo_packet(void *tapdata, packet_info *pinfo, epan_dissect_t *edt _U_, const
 
 	if (active_row == -1) { /* This is a new-tracked file */
 		/* Construct the entry in the list of active files */
-		entry = g_new(export_object_entry_t, 1);
+		entry = g_new0(export_object_entry_t, 1);
 		entry->payload_data = NULL;
 		entry->payload_len = 0;
+		/* Later chunks are added to the entry after it's in the list */
+		entry->payload_growing = TRUE;
 		new_file = (active_file *)g_malloc(sizeof(active_file));
 		new_file->tid = incoming_file.tid;
 		new_file->uid = incoming_file.uid;
@@ -972,94 +972,112 @@ typedef struct tcp_follow_tap_data
 } tcp_follow_tap_data_t;
 
 /*
- * Tries to apply segments from fragments list to the reconstructed payload.
- * Fragments that can be appended to the end of the payload will be applied (and
- * removed from the list). Fragments that should have been received (according
- * to the ack number) will also be appended to the payload (preceded by some
- * dummy data to mark packet loss if any).
- *
- * Returns TRUE if one fragment has been applied or FALSE if no more fragments
- * can be added the the payload (there might still be unacked fragments with
- * missing segments before them).
+ * Out-of-order segments waiting to be added to a followed stream are kept in
+ * follow_info->fragments[], ordered by their offset in the stream (and by
+ * frame number for segments at the same offset), so the first one tells
+ * whether the next segment has arrived or how large the gap before it is.
  */
-static gboolean
-check_follow_fragments(follow_info_t *follow_info, gboolean is_server, guint32 acknowledged, guint32 packet_num)
+typedef struct tcp_follow_fragment
 {
-    GList *fragment_entry;
-    follow_record_t *fragment, *follow_record;
-    guint32 lowest_seq = 0;
-    gchar *dummy_str;
-
-    fragment_entry = g_list_first(follow_info->fragments[is_server]);
-    if (fragment_entry == NULL)
-        return FALSE;
-
-    fragment = (follow_record_t*)fragment_entry->data;
-    lowest_seq = fragment->seq;
-
-    for (; fragment_entry != NULL; fragment_entry = g_list_next(fragment_entry))
-    {
-        fragment = (follow_record_t*)fragment_entry->data;
-
-        if( GT_SEQ(lowest_seq, fragment->seq) ) {
-            lowest_seq = fragment->seq;
-        }
+    guint64 pos;    /* stream offset, see follow_info_t.seq_pos */
+    follow_record_t *record;
+} tcp_follow_fragment_t;
 
-        if( LT_SEQ(fragment->seq, follow_info->seq[is_server]) ) {
-            guint32 newseq;
-            /* this sequence number seems dated, but
-               check the end to make sure it has no more
-               info than we have already seen */
-            newseq = fragment->seq + fragment->data->len;
-            if( GT_SEQ(newseq, follow_info->seq[is_server]) ) {
-                guint32 new_pos;
-
-                /* this one has more than we have seen. let's get the
-                   payload that we have not seen. This happens when
-                   part of this frame has been retransmitted */
-
-                new_pos = follow_info->seq[is_server] - fragment->seq;
+static gint
+tcp_follow_fragment_cmp(gconstpointer a, gconstpointer b, gpointer user_data _U_)
+{
+    const tcp_follow_fragment_t *fa = (const tcp_follow_fragment_t *)a;
+    const tcp_follow_fragment_t *fb = (const tcp_follow_fragment_t *)b;
+
+    if (fa->pos != fb->pos)
+        return fa->pos < fb->pos ? -1 : 1;
+    if (fa->record->packet_num != fb->record->packet_num)
+        return fa->record->packet_num < fb->record->packet_num ? -1 : 1;
+    /* The same segment more than once in a frame; keep all of them. */
+    if (fa != fb)
+        return (gsize)fa < (gsize)fb ? -1 : 1;
+    return 0;
+}
 
-                if ( fragment->data->len > new_pos ) {
-                    guint32 new_frag_size = fragment->data->len - new_pos;
+static void
+tcp_follow_record_free(follow_record_t *follow_record)
+{
+    g_byte_array_free(follow_record->data, TRUE);
+    g_free(follow_record);
+}
 
-                    follow_record = g_new0(follow_record_t,1);
+static void
+tcp_follow_fragment_free(gpointer data)
+{
+    tcp_follow_fragment_t *fragment = (tcp_follow_fragment_t *)data;
 
-                    follow_record->is_server = is_server;
-                    follow_record->packet_num = fragment->packet_num;
-                    follow_record->seq = follow_info->seq[is_server] + new_frag_size;
+    tcp_follow_record_free(fragment->record);
+    g_free(fragment);
+}
 
-                    follow_record->data = g_byte_array_append(g_byte_array_new(),
-                                                              fragment->data->data + new_pos,
-                                                              new_frag_size);
+static gboolean
+tcp_follow_fragment_first(gpointer key _U_, gpointer value, gpointer data)
+{
+    *(tcp_follow_fragment_t **)data = (tcp_follow_fragment_t *)value;
+    return TRUE;
+}
 
-                    follow_info->payload = g_list_prepend(follow_info->payload, follow_record);
-                }
+static void
+follow_advance_seq(follow_info_t *follow_info, gboolean is_server, guint32 len)
+{
+    follow_info->seq[is_server] += len;
+    follow_info->seq_pos[is_server] += len;
+}
 
-                follow_info->seq[is_server] += (fragment->data->len - new_pos);
-            }
+/*
+ * Tries to apply the first segment from the fragments tree to the
+ * reconstructed payload. If it can be appended to the end of the payload,
+ * it is applied (and removed from the tree). If it should have been received
+ * (according to the ack number), it is preceded by some dummy data to mark
+ * packet loss.
+ *
+ * Returns TRUE if a fragment has been applied or FALSE if no more fragments
+ * can be added the the payload (there might still be unacked fragments with
+ * missing segments before them).
+ */
+static gboolean
+check_follow_fragments(follow_info_t *follow_info, gboolean is_server, guint32 acknowledged, guint32 packet_num)
+{
+    GTree *fragments = follow_info->fragments[is_server];
+    tcp_follow_fragment_t *fragment = NULL;
+    follow_record_t *follow_record;
+    guint32 lowest_seq;
+    guint64 seen;
+    gchar *dummy_str;
 
-            /* Remove the fragment from the list as the "new" part of it
-             * has been processed or its data has been seen already in
-             * another packet. */
-            g_byte_array_free(fragment->data, TRUE);
-            g_free(fragment);
-            follow_info->fragments[is_server] = g_list_delete_link(follow_info->fragments[is_server], fragment_entry);
-            return TRUE;
-        }
+    if (fragments == NULL)
+        return FALSE;
 
-        if( EQ_SEQ(fragment->seq, follow_info->seq[is_server]) ) {
-            /* this fragment fits the stream */
-            if( fragment->data->len > 0 ) {
-                follow_info->payload = g_list_prepend(follow_info->payload, fragment);
-            }
+    g_tree_foreach(fragments, tcp_follow_fragment_first, &fragment);
+    if (fragment == NULL)
+        return FALSE;
 
-            follow_info->seq[is_server] += fragment->data->len;
-            follow_info->fragments[is_server] = g_list_delete_link(follow_info->fragments[is_server], fragment_entry);
-            return TRUE;
+    if (fragment->pos <= follow_info->seq_pos[is_server]) {
+        /* This fragment fits the stream, or it was (partly) retransmitted and
+         * we have seen its beginning already. Add what we have not seen yet,
+         * reusing the fragment's data. */
+        follow_record = fragment->record;
+        seen = follow_info->seq_pos[is_server] - fragment->pos;
+        g_tree_steal(fragments, fragment);
+        g_free(fragment);
+
+        if (follow_record->data->len > seen) {
+            g_byte_array_remove_range(follow_record->data, 0, (guint)seen);
+            follow_record->seq = follow_info->seq[is_server];
+            follow_advance_seq(follow_info, is_server, follow_record->data->len);
+            follow_info->payload = g_list_prepend(follow_info->payload, follow_record);
+        } else {
+            tcp_follow_record_free(follow_record);
         }
+        return TRUE;
     }
 
+    lowest_seq = fragment->record->seq;
     if( GT_SEQ(acknowledged, lowest_seq) ) {
         /* There are frames missing in the capture file that were seen
          * by the receiving host. Add dummy stream chunk with the data
@@ -1079,7 +1097,7 @@ check_follow_fragments(follow_info_t *follow_info, gboolean is_server, guint32 a
         follow_record->packet_num = packet_num;
         follow_record->seq = lowest_seq;
 
-        follow_info->seq[is_server] = lowest_seq;
+        follow_advance_seq(follow_info, is_server, lowest_seq - follow_info->seq[is_server]);
         follow_info->payload = g_list_prepend(follow_info->payload, follow_record);
         return TRUE;
     }
@@ -1092,6 +1110,7 @@ follow_tcp_tap_listener(void *tapdata, packet_info *pinfo,
                       epan_dissect_t *edt _U_, const void *data)
 {
     follow_record_t *follow_record;
+    tcp_follow_fragment_t *fragment;
     follow_info_t *follow_info = (follow_info_t *)tapdata;
     const tcp_follow_tap_data_t *follow_data = (const tcp_follow_tap_data_t *)data;
     gboolean is_server;
@@ -1161,13 +1180,13 @@ follow_tcp_tap_listener(void *tapdata, packet_info *pinfo,
     follow_record->is_server = is_server;
     follow_record->packet_num = pinfo->fd->num;
     follow_record->seq = sequence;  /* start of fragment, used by check_follow_fragments. */
-    follow_record->data = g_byte_array_append(g_byte_array_new(),
+    follow_record->data = g_byte_array_append(g_byte_array_sized_new(data_length),
                                               tvb_get_ptr(follow_data->tvb, data_offset, data_length),
                                               data_length);
 
     if (EQ_SEQ(sequence, follow_info->seq[is_server])) {
         /* The segment overlaps or extends the previous end of stream. */
-        follow_info->seq[is_server] += length;
+        follow_advance_seq(follow_info, is_server, length);
         follow_info->bytes_written[is_server] += follow_record->data->len;
         follow_info->payload = g_list_prepend(follow_info->payload, follow_record);
 
@@ -1175,7 +1194,14 @@ follow_tcp_tap_listener(void *tapdata, packet_info *pinfo,
         while(check_follow_fragments(follow_info, is_server, 0, pinfo->fd->num));
     } else {
         /* Out of order packet (more preceding segments are expected). */
-        follow_info->fragments[is_server] = g_list_append(follow_info->fragments[is_server], follow_record);
+        fragment = g_new(tcp_follow_fragment_t, 1);
+        fragment->pos = follow_info->seq_pos[is_server] + (sequence - follow_info->seq[is_server]);
+        fragment->record = follow_record;
+        if (follow_info->fragments[is_server] == NULL) {
+            follow_info->fragments[is_server] = g_tree_new_full(tcp_follow_fragment_cmp, NULL,
+                                                                NULL, tcp_follow_fragment_free);
+        }
+        g_tree_insert(follow_info->fragments[is_server], fragment, fragment);
     }
     return TAP_PACKET_DONT_REDRAW;
 }
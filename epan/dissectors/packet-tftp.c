@@ -207,7 +207,7 @@ tftp_eo_packet(void *tapdata, packet_info *pinfo, epan_dissect_t *edt _U_, const
   export_object_entry_t *entry;
 
   /* These values will be freed when the Export Object window is closed. */
-  entry = g_new(export_object_entry_t, 1);
+  entry = g_new0(export_object_entry_t, 1);
 
   /* Remember which frame had the last block of the file */
   entry->pkt_num = pinfo->num;
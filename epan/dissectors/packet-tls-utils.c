@@ -3265,7 +3265,8 @@ ssl_decrypt_pre_master_secret(SslDecryptSession *ssl_session,
 
 static gboolean
 ssl_restore_master_key(SslDecryptSession *ssl, const char *label,
-                       gboolean is_pre_master, GHashTable *ht, StringInfo *key);
+                       gboolean is_pre_master, const ssl_master_key_map_t *mk_map,
+                       GHashTable *ht, StringInfo *key);
 
 gboolean
 ssl_generate_pre_master_secret(SslDecryptSession *ssl_session,
@@ -3293,7 +3294,7 @@ ssl_generate_pre_master_secret(SslDecryptSession *ssl_session,
 
     /* check to see if the PMS was provided to us*/
     if (ssl_restore_master_key(ssl_session, "Unencrypted pre-master secret", TRUE,
-           mk_map->pms, &ssl_session->client_random)) {
+           mk_map, mk_map->pms, &ssl_session->client_random)) {
         return TRUE;
     }
 
@@ -3403,7 +3404,7 @@ ssl_generate_pre_master_secret(SslDecryptSession *ssl_session,
          * ssl key logfile stores only the first 8 bytes, so truncate it */
         encrypted_pre_master.data_len = 8;
         if (ssl_restore_master_key(ssl_session, "Encrypted pre-master secret",
-            TRUE, mk_map->pre_master, &encrypted_pre_master))
+            TRUE, mk_map, mk_map->pre_master, &encrypted_pre_master))
             return TRUE;
     }
     return FALSE;
@@ -4911,6 +4912,10 @@ ssl_get_record_info(tvbuff_t *parent_tvb, int proto, packet_info *pinfo, gint re
 }
 /* Links SSL records with the real packet data. }}} */
 
+static tls_keylog_index_t *tls_keylog_index_new(void);
+static void tls_keylog_index_reset(tls_keylog_index_t *idx);
+static void tls_keylog_index_free(tls_keylog_index_t *idx);
+
 /* initialize/reset per capture state data (ssl sessions cache). {{{ */
 void
 ssl_common_init(ssl_master_key_map_t *mk_map,
@@ -4928,6 +4933,9 @@ ssl_common_init(ssl_master_key_map_t *mk_map,
     mk_map->tls13_server_appdata = g_hash_table_new(ssl_hash, ssl_equal);
     mk_map->tls13_early_exporter = g_hash_table_new(ssl_hash, ssl_equal);
     mk_map->tls13_exporter = g_hash_table_new(ssl_hash, ssl_equal);
+    if (!mk_map->keylog_index) {
+        mk_map->keylog_index = tls_keylog_index_new();
+    }
     ssl_data_alloc(decrypted_data, 32);
     ssl_data_alloc(compressed_data, 32);
 }
@@ -4953,11 +4961,33 @@ ssl_common_cleanup(ssl_master_key_map_t *mk_map, FILE **ssl_keylog_file,
     g_free(compressed_data->data);
 
     /* close the previous keylog file now that the cache are cleared, this
-     * allows the cache to be filled with the full keylog file contents. */
+     * allows the cache to be filled with the full keylog file contents.
+     * An indexed keylog file is kept open; the lines read after it was
+     * indexed are indexed the next time it's used. */
+    if (*ssl_keylog_file) {
+        if (mk_map->keylog_index && mk_map->keylog_index->mapped) {
+            mk_map->keylog_index->needs_update = TRUE;
+        } else {
+            fclose(*ssl_keylog_file);
+            *ssl_keylog_file = NULL;
+            if (mk_map->keylog_index) {
+                tls_keylog_index_reset(mk_map->keylog_index);
+            }
+        }
+    }
+}
+
+void
+ssl_common_shutdown(ssl_master_key_map_t *mk_map, FILE **ssl_keylog_file)
+{
     if (*ssl_keylog_file) {
         fclose(*ssl_keylog_file);
         *ssl_keylog_file = NULL;
     }
+    if (mk_map->keylog_index) {
+        tls_keylog_index_free(mk_map->keylog_index);
+        mk_map->keylog_index = NULL;
+    }
 }
 /* }}} */
 
@@ -5092,7 +5122,8 @@ ssl_save_master_key(const char *label, GHashTable *ht, StringInfo *key,
 /** restore a (pre-)master secret given some key in the cache */
 static gboolean
 ssl_restore_master_key(SslDecryptSession *ssl, const char *label,
-                       gboolean is_pre_master, GHashTable *ht, StringInfo *key)
+                       gboolean is_pre_master, const ssl_master_key_map_t *mk_map,
+                       GHashTable *ht, StringInfo *key)
 {
     StringInfo *ms;
 
@@ -5102,7 +5133,7 @@ ssl_restore_master_key(SslDecryptSession *ssl, const char *label,
         return FALSE;
     }
 
-    ms = (StringInfo *)g_hash_table_lookup(ht, key);
+    ms = tls_keylog_lookup(mk_map, ht, key);
     if (!ms) {
         ssl_debug_printf("%s can't find %smaster secret by %s\n", G_STRFUNC,
                          is_pre_master ? "pre-" : "", label);
@@ -5158,12 +5189,12 @@ ssl_finalize_decryption(SslDecryptSession *ssl, ssl_master_key_map_t *mk_map)
      * (an earlier packet in the capture or key logfile). */
     if (!(ssl->state & (SSL_MASTER_SECRET | SSL_PRE_MASTER_SECRET)) &&
         !ssl_restore_master_key(ssl, "Session ID", FALSE,
-                                mk_map->session, &ssl->session_id) &&
+                                mk_map, mk_map->session, &ssl->session_id) &&
         (!ssl->session.is_session_resumed ||
          !ssl_restore_master_key(ssl, "Session Ticket", FALSE,
-                                 mk_map->tickets, &ssl->session_ticket)) &&
+                                 mk_map, mk_map->tickets, &ssl->session_ticket)) &&
         !ssl_restore_master_key(ssl, "Client Random", FALSE,
-                                mk_map->crandom, &ssl->client_random)) {
+                                mk_map, mk_map->crandom, &ssl->client_random)) {
         if (ssl->cipher_suite->enc != ENC_NULL) {
             /* how unfortunate, the master secret could not be found */
             ssl_debug_printf("  Cannot find master secret\n");
@@ -5242,7 +5273,7 @@ tls13_load_secret(SslDecryptSession *ssl, ssl_master_key_map_t *mk_map,
     ssl_debug_printf("%s transitioning to new key, old state 0x%02x\n", G_STRFUNC, ssl->state);
     ssl->state &= ~(SSL_MASTER_SECRET | SSL_PRE_MASTER_SECRET | SSL_HAVE_SESSION_KEY);
 
-    StringInfo *secret = (StringInfo *)g_hash_table_lookup(key_map, &ssl->client_random);
+    StringInfo *secret = tls_keylog_lookup(mk_map, key_map, &ssl->client_random);
     if (!secret) {
         ssl_debug_printf("%s Cannot find %s, decryption impossible\n", G_STRFUNC, label);
         /* Disable decryption, the keys are invalid. */
@@ -5534,6 +5565,295 @@ tls_keylog_process_lines(const ssl_master_key_map_t *mk_map, const guint8 *data,
     }
 }
 
+/*
+ * Keylog files of busy servers can have millions of lines, so rather than
+ * parsing all of them, the keylog file is mapped and indexed: every line is
+ * entered under a hash of the map it's for and its key (Client Random,
+ * Session ID, ...), and the lines of a key are only parsed when the key is
+ * looked up and isn't in the map yet. Lines that are appended to the file
+ * while it's being used are parsed as they're read, and indexed the next
+ * time a capture file is opened.
+ */
+struct tls_keylog_index {
+    GMappedFile *mapped;    /* The keylog file, as it was last indexed. */
+    guint64 indexed_len;    /* The lines before this offset are indexed. */
+    GArray *entries;        /* tls_keylog_entry_t, sorted by hash and offset. */
+    gboolean needs_update;  /* The rest of the file must be indexed before reading it. */
+};
+
+typedef struct {
+    guint64 hash;           /* See tls_keylog_hash(). */
+    guint64 offset;         /* Of the line in the keylog file. */
+} tls_keylog_entry_t;
+
+/* The first word of the lines. The lines of each label go to their own map,
+ * see tls_keylog_lookup(), and "RSA Session-ID:" lines to the one after
+ * them. */
+static const char *tls_keylog_labels[] = {
+    "RSA",
+    "PMS_CLIENT_RANDOM",
+    "CLIENT_RANDOM",
+    "CLIENT_EARLY_TRAFFIC_SECRET",
+    "CLIENT_HANDSHAKE_TRAFFIC_SECRET",
+    "SERVER_HANDSHAKE_TRAFFIC_SECRET",
+    "CLIENT_TRAFFIC_SECRET_0",
+    "SERVER_TRAFFIC_SECRET_0",
+    "EARLY_EXPORTER_SECRET",
+    "EXPORTER_SECRET",
+};
+#define TLS_KEYLOG_SESSION_MAP  G_N_ELEMENTS(tls_keylog_labels)
+
+/* FNV-1a of the key, starting from the map it's in. */
+static guint64
+tls_keylog_hash(guint map, const guint8 *key, guint key_len)
+{
+    guint64 hash = G_GUINT64_CONSTANT(14695981039346656037) ^ map;
+
+    for (guint i = 0; i < key_len; i++) {
+        hash ^= key[i];
+        hash *= G_GUINT64_CONSTANT(1099511628211);
+    }
+    return hash;
+}
+
+/* Get the hash of the line from line to eol, if it has a key. Whether it's
+ * well-formed is checked when it's parsed by tls_keylog_process_lines(). */
+static gboolean
+tls_keylog_hash_line(const char *line, const char *eol, guint64 *hash)
+{
+    const char *hex = (const char *)memchr(line, ' ', eol - line);
+    gsize label_len;
+    guint8 key[256];
+    guint key_len = 0;
+    guint map;
+
+    if (!hex) {
+        return FALSE;
+    }
+    label_len = hex - line;
+    hex++;
+    if (label_len > 5 && memcmp(line, "QUIC_", 5) == 0) {
+        line += 5;
+        label_len -= 5;
+    }
+    for (map = 0; map < G_N_ELEMENTS(tls_keylog_labels); map++) {
+        if (strlen(tls_keylog_labels[map]) == label_len &&
+            memcmp(tls_keylog_labels[map], line, label_len) == 0) {
+            break;
+        }
+    }
+    if (map == G_N_ELEMENTS(tls_keylog_labels)) {
+        return FALSE;
+    }
+    if (map == 0 && eol - hex > 11 && memcmp(hex, "Session-ID:", 11) == 0) {
+        map = TLS_KEYLOG_SESSION_MAP;
+        hex += 11;
+    }
+
+    for (; hex + 1 < eol && key_len < sizeof(key); hex += 2) {
+        int hi = ws_xton(hex[0]);
+        int lo = ws_xton(hex[1]);
+        if (hi < 0 || lo < 0) {
+            break;
+        }
+        key[key_len++] = (guint8)(hi << 4 | lo);
+    }
+    if (key_len == 0) {
+        return FALSE;
+    }
+    *hash = tls_keylog_hash(map, key, key_len);
+    return TRUE;
+}
+
+static gint
+tls_keylog_entry_cmp(gconstpointer a, gconstpointer b)
+{
+    const tls_keylog_entry_t *entry_a = (const tls_keylog_entry_t *)a;
+    const tls_keylog_entry_t *entry_b = (const tls_keylog_entry_t *)b;
+
+    if (entry_a->hash != entry_b->hash) {
+        return entry_a->hash < entry_b->hash ? -1 : 1;
+    }
+    if (entry_a->offset != entry_b->offset) {
+        return entry_a->offset < entry_b->offset ? -1 : 1;
+    }
+    return 0;
+}
+
+/* Sort the entries after the first sorted_count ones, which are sorted, and
+ * merge them in. */
+static void
+tls_keylog_sort_entries(GArray *entries, guint sorted_count)
+{
+    tls_keylog_entry_t *e = (tls_keylog_entry_t *)(void *)entries->data;
+    tls_keylog_entry_t *merged;
+    guint count = entries->len;
+    guint i = 0, j = sorted_count, k = 0;
+
+    if (count == sorted_count) {
+        return;
+    }
+    qsort(e + sorted_count, count - sorted_count, sizeof(*e), tls_keylog_entry_cmp);
+    if (sorted_count == 0 || tls_keylog_entry_cmp(&e[sorted_count - 1], &e[sorted_count]) <= 0) {
+        return;
+    }
+
+    merged = g_new(tls_keylog_entry_t, count);
+    while (i < sorted_count && j < count) {
+        merged[k++] = tls_keylog_entry_cmp(&e[i], &e[j]) <= 0 ? e[i++] : e[j++];
+    }
+    while (i < sorted_count) {
+        merged[k++] = e[i++];
+    }
+    while (j < count) {
+        merged[k++] = e[j++];
+    }
+    memcpy(e, merged, count * sizeof(*e));
+    g_free(merged);
+}
+
+static tls_keylog_index_t *
+tls_keylog_index_new(void)
+{
+    tls_keylog_index_t *idx = g_new0(tls_keylog_index_t, 1);
+
+    idx->entries = g_array_new(FALSE, FALSE, sizeof(tls_keylog_entry_t));
+    idx->needs_update = TRUE;
+    return idx;
+}
+
+static void
+tls_keylog_index_reset(tls_keylog_index_t *idx)
+{
+    if (idx->mapped) {
+        g_mapped_file_unref(idx->mapped);
+        idx->mapped = NULL;
+    }
+    idx->indexed_len = 0;
+    g_array_set_size(idx->entries, 0);
+    idx->needs_update = TRUE;
+}
+
+static void
+tls_keylog_index_free(tls_keylog_index_t *idx)
+{
+    tls_keylog_index_reset(idx);
+    g_array_free(idx->entries, TRUE);
+    g_free(idx);
+}
+
+/* Index the complete lines that were added to the keylog file since it was
+ * last indexed. Returns FALSE if the file can't be mapped, in which case it's
+ * read line by line as before. */
+static gboolean
+tls_keylog_index_update(tls_keylog_index_t *idx, FILE *keylog_file)
+{
+    GError *err = NULL;
+    GMappedFile *mapped;
+    const char *data, *line, *end;
+    guint sorted_count = idx->entries->len;
+
+    idx->needs_update = FALSE;
+    mapped = g_mapped_file_new_from_fd(ws_fileno(keylog_file), FALSE, &err);
+    if (!mapped) {
+        ssl_debug_printf("%s can't map the keylog file: %s\n", G_STRFUNC, err->message);
+        g_error_free(err);
+        return idx->mapped != NULL;
+    }
+    if (g_mapped_file_get_length(mapped) <= idx->indexed_len) {
+        g_mapped_file_unref(mapped);
+        return idx->mapped != NULL;
+    }
+    data = g_mapped_file_get_contents(mapped);
+    end = data + g_mapped_file_get_length(mapped);
+    /* The last line may still be being written. */
+    while (end > data + idx->indexed_len && end[-1] != '\n') {
+        end--;
+    }
+
+    for (line = data + idx->indexed_len; line < end; ) {
+        const char *eol = (const char *)memchr(line, '\n', end - line);
+        tls_keylog_entry_t entry;
+
+        entry.offset = line - data;
+        if (tls_keylog_hash_line(line, eol, &entry.hash)) {
+            g_array_append_val(idx->entries, entry);
+        }
+        line = eol + 1;
+    }
+    tls_keylog_sort_entries(idx->entries, sorted_count);
+
+    if (idx->mapped) {
+        g_mapped_file_unref(idx->mapped);
+    }
+    idx->mapped = mapped;
+    idx->indexed_len = end - data;
+    ssl_debug_printf("%s indexed %u keys in %" G_GUINT64_FORMAT " bytes of the keylog file\n",
+                     G_STRFUNC, idx->entries->len, idx->indexed_len);
+    return TRUE;
+}
+
+StringInfo *
+tls_keylog_lookup(const ssl_master_key_map_t *mk_map, GHashTable *ht, const StringInfo *key)
+{
+    /* In the order of tls_keylog_labels. */
+    GHashTable *maps[] = {
+        mk_map->pre_master,
+        mk_map->pms,
+        mk_map->crandom,
+        mk_map->tls13_client_early,
+        mk_map->tls13_client_handshake,
+        mk_map->tls13_server_handshake,
+        mk_map->tls13_client_appdata,
+        mk_map->tls13_server_appdata,
+        mk_map->tls13_early_exporter,
+        mk_map->tls13_exporter,
+        mk_map->session,
+    };
+    tls_keylog_index_t *idx = mk_map->keylog_index;
+    StringInfo *secret = (StringInfo *)g_hash_table_lookup(ht, key);
+    const tls_keylog_entry_t *e;
+    const char *data;
+    guint64 hash;
+    guint map, i, lo, hi;
+
+    G_STATIC_ASSERT(G_N_ELEMENTS(maps) == TLS_KEYLOG_SESSION_MAP + 1);
+
+    if (secret || !idx || !idx->mapped || key->data_len == 0) {
+        return secret;
+    }
+
+    for (map = 0; map < G_N_ELEMENTS(maps) && maps[map] != ht; map++)
+        ;
+    if (map == G_N_ELEMENTS(maps)) {
+        /* Not a map of keylog secrets, e.g. the session tickets. */
+        return NULL;
+    }
+    hash = tls_keylog_hash(map, key->data, key->data_len);
+
+    e = (const tls_keylog_entry_t *)(void *)idx->entries->data;
+    lo = 0;
+    hi = idx->entries->len;
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+        if (e[mid].hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    /* Parse the lines with this hash in the order they're in the file, so
+     * that the last secret for a key wins, as when all lines are parsed. */
+    data = g_mapped_file_get_contents(idx->mapped);
+    for (i = lo; i < idx->entries->len && e[i].hash == hash; i++) {
+        const char *line = data + e[i].offset;
+        const char *eol = (const char *)memchr(line, '\n', (gsize)(idx->indexed_len - e[i].offset));
+        tls_keylog_process_lines(mk_map, (const guint8 *)line, (guint)(eol - line));
+    }
+    return (StringInfo *)g_hash_table_lookup(ht, key);
+}
+
 void
 ssl_load_keyfile(const gchar *tls_keylog_filename, FILE **keylog_file,
                  const ssl_master_key_map_t *mk_map)
@@ -5557,6 +5877,9 @@ ssl_load_keyfile(const gchar *tls_keylog_filename, FILE **keylog_file,
         ssl_debug_printf("%s file got deleted, trying to re-open\n", G_STRFUNC);
         fclose(*keylog_file);
         *keylog_file = NULL;
+        if (mk_map->keylog_index) {
+            tls_keylog_index_reset(mk_map->keylog_index);
+        }
     }
 
     if (*keylog_file == NULL) {
@@ -5567,6 +5890,12 @@ ssl_load_keyfile(const gchar *tls_keylog_filename, FILE **keylog_file,
         }
     }
 
+    /* Index what wasn't indexed yet, and only read what comes after it. */
+    if (mk_map->keylog_index && mk_map->keylog_index->needs_update &&
+        tls_keylog_index_update(mk_map->keylog_index, *keylog_file)) {
+        ws_fseek64(*keylog_file, (gint64)mk_map->keylog_index->indexed_len, SEEK_SET);
+    }
+
     for (;;) {
         char buf[1110], *line;
         line = fgets(buf, sizeof(buf), *keylog_file);
@@ -5578,6 +5907,9 @@ ssl_load_keyfile(const gchar *tls_keylog_filename, FILE **keylog_file,
                 ssl_debug_printf("%s Error while reading key log file, closing it!\n", G_STRFUNC);
                 fclose(*keylog_file);
                 *keylog_file = NULL;
+                if (mk_map->keylog_index) {
+                    tls_keylog_index_reset(mk_map->keylog_index);
+                }
             }
             break;
         }
@@ -486,6 +486,8 @@ typedef struct ssl_common_options {
     const gchar        *keylog_filename;
 } ssl_common_options_t;
 
+typedef struct tls_keylog_index tls_keylog_index_t;
+
 /** Map from something to a (pre-)master secret */
 typedef struct {
     GHashTable *session;    /* Session ID (1-32 bytes) to master secret. */
@@ -503,6 +505,10 @@ typedef struct {
     GHashTable *tls13_server_appdata;
     GHashTable *tls13_early_exporter;
     GHashTable *tls13_exporter;
+
+    /* Where the secrets of the keylog file are, so that they're only parsed
+     * when they're looked up. Kept between capture files. */
+    tls_keylog_index_t *keylog_index;
 } ssl_master_key_map_t;
 
 gint ssl_get_keyex_alg(gint cipher);
@@ -676,6 +682,9 @@ ssl_common_init(ssl_master_key_map_t *master_key_map,
 extern void
 ssl_common_cleanup(ssl_master_key_map_t *master_key_map, FILE **ssl_keylog_file,
                    StringInfo *decrypted_data, StringInfo *compressed_data);
+/* release the keylog file and its index, on exit */
+extern void
+ssl_common_shutdown(ssl_master_key_map_t *master_key_map, FILE **ssl_keylog_file);
 
 /**
  * Access to the keys in the TLS dissector, for use by the DTLS dissector.
@@ -694,6 +703,11 @@ extern void
 ssl_load_keyfile(const gchar *ssl_keylog_filename, FILE **keylog_file,
                  const ssl_master_key_map_t *mk_map);
 
+/* Look up the secret for key in one of the maps of mk_map, parsing the
+ * matching lines of the keylog file if it hasn't been looked up before. */
+extern StringInfo *
+tls_keylog_lookup(const ssl_master_key_map_t *mk_map, GHashTable *ht, const StringInfo *key);
+
 #ifdef HAVE_LIBGNUTLS
 /* parse ssl related preferences (private keys and ports association strings) */
 extern void
@@ -326,6 +326,12 @@ ssl_cleanup(void)
     ssl_crandom_hash = NULL;
 }
 
+static void
+ssl_shutdown(void)
+{
+    ssl_common_shutdown(&ssl_master_key_map, &ssl_keylog_file);
+}
+
 ssl_master_key_map_t *
 tls_get_master_key_map(gboolean load_secrets)
 {
@@ -3868,7 +3874,7 @@ tls13_get_quic_secret(packet_info *pinfo, gboolean is_from_server, int type, gui
         g_assert_not_reached();
     }
 
-    StringInfo *secret = (StringInfo *)g_hash_table_lookup(key_map, &ssl->client_random);
+    StringInfo *secret = tls_keylog_lookup(&ssl_master_key_map, key_map, &ssl->client_random);
     if (!secret || secret->data_len < secret_min_len || secret->data_len > secret_max_len) {
         ssl_debug_printf("%s Cannot find QUIC %s of size %d..%d, found bad size %d!\n",
                          G_STRFUNC, label, secret_min_len, secret_max_len, secret ? secret->data_len : 0);
@@ -3981,7 +3987,7 @@ tls13_exporter(packet_info *pinfo, gboolean is_early,
     ssl_load_keyfile(ssl_options.keylog_filename, &ssl_keylog_file, &ssl_master_key_map);
     key_map = is_early ? ssl_master_key_map.tls13_early_exporter
                        : ssl_master_key_map.tls13_exporter;
-    secret = (StringInfo *)g_hash_table_lookup(key_map, &ssl_session->client_random);
+    secret = tls_keylog_lookup(&ssl_master_key_map, key_map, &ssl_session->client_random);
     if (!secret) {
         return FALSE;
     }
@@ -4557,6 +4563,7 @@ proto_register_tls(void)
 
     register_init_routine(ssl_init);
     register_cleanup_routine(ssl_cleanup);
+    register_shutdown_routine(ssl_shutdown);
     reassembly_table_register(&ssl_reassembly_table,
                           &addresses_ports_reassembly_table_functions);
     reassembly_table_register(&tls_hs_reassembly_table,
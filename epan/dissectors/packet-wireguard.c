@@ -1961,8 +1961,14 @@ proto_register_wg(void)
 void
 proto_reg_handoff_wg(void)
 {
+    /* A message type from 1 to 4, and at least a transport data header. */
+    static const heur_prefilter_t wg_prefilter = {
+        32, 0, 1, { 0x00 }, { 0xF8 }
+    };
+
     dissector_add_uint_with_preference("udp.port", 0, wg_handle);
     heur_dissector_add("udp", dissect_wg_heur, "WireGuard", "wg", proto_wg, HEURISTIC_ENABLE);
+    heur_dissector_set_prefilter("wg", &wg_prefilter);
 
 #ifdef WG_DECRYPTION_SUPPORTED
     ip_handle = find_dissector("ip");
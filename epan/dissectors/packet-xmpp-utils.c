@@ -763,7 +763,7 @@ proto_item_get_text(proto_item *item)
     if(fi==NULL)
         return NULL;
 
-    if (fi->rep == NULL)
+    if (proto_item_get_rep(fi) == NULL)
         return NULL;
 
 
@@ -57,6 +57,7 @@
 #include "stats_tree.h"
 #include "secrets.h"
 #include "funnel.h"
+#include "register-int.h"
 #include <dtd.h>
 
 #ifdef HAVE_PLUGINS
@@ -107,6 +108,40 @@ plugins_t *libwireshark_plugins = NULL;
 static GSList *epan_plugins = NULL;
 #endif
 
+/* Startup profile, filled in by epan_init if epan_enable_startup_profile
+ * was called. */
+typedef struct {
+	const char *name;
+	gint64 usecs;
+} startup_phase_t;
+
+static GArray *startup_phases = NULL;
+static gint64 startup_phase_start;
+
+static void
+startup_phase_begin(void)
+{
+	if (startup_phases)
+		startup_phase_start = g_get_monotonic_time();
+}
+
+/* Record the time since the previous call (or startup_phase_begin) */
+static void
+startup_phase_end(const char *name)
+{
+	startup_phase_t phase;
+	gint64 now;
+
+	if (!startup_phases)
+		return;
+
+	now = g_get_monotonic_time();
+	phase.name = name;
+	phase.usecs = now - startup_phase_start;
+	g_array_append_val(startup_phases, phase);
+	startup_phase_start = now;
+}
+
 const gchar*
 epan_get_version(void) {
 	return VERSION;
@@ -219,6 +254,8 @@ epan_init(register_cb cb, gpointer client_data, gboolean load_plugins)
 	 * GLib 2.24, multiple invocations are allowed. Check for an earlier
 	 * invocation just in case.
 	 */
+	startup_phase_begin();
+
 	/* initialize memory allocation subsystem */
 	wmem_init();
 
@@ -227,6 +264,7 @@ epan_init(register_cb cb, gpointer client_data, gboolean load_plugins)
 
 	/* initialize name resolution (addr_resolv.c) */
 	addr_resolv_init();
+	startup_phase_end("name resolution");
 
 	except_init();
 
@@ -235,6 +273,7 @@ epan_init(register_cb cb, gpointer client_data, gboolean load_plugins)
 		libwireshark_plugins = plugins_init(WS_PLUGIN_EPAN);
 #endif
 	}
+	startup_phase_end("plugin loading");
 
 	/* initialize libgcrypt (beware, it won't be thread-safe) */
 	gcry_check_version(NULL);
@@ -255,6 +294,7 @@ epan_init(register_cb cb, gpointer client_data, gboolean load_plugins)
 	// We might receive a SIGPIPE due to maxmind_db.
 	signal(SIGPIPE, SIG_IGN);
 #endif
+	startup_phase_end("crypto and XML libraries");
 
 	TRY {
 		tap_init();
@@ -268,18 +308,23 @@ epan_init(register_cb cb, gpointer client_data, gboolean load_plugins)
 #ifdef HAVE_PLUGINS
 		g_slist_foreach(epan_plugins, epan_plugin_init, NULL);
 #endif
+		startup_phase_end("core subsystems");
 		proto_init(epan_plugin_register_all_procotols, epan_plugin_register_all_handoffs, cb, client_data);
 #ifdef HAVE_PLUGINS
 		g_slist_foreach(epan_plugins, epan_plugin_register_all_tap_listeners, NULL);
 #endif
+		startup_phase_end("protocol registration and handoffs");
 		packet_cache_proto_handles();
 		dfilter_init();
+		startup_phase_end("display filter engine");
 		final_registration_all_protocols();
 		print_cache_field_handles();
 		expert_packet_init();
 		export_pdu_init();
+		startup_phase_end("final registration");
 #ifdef HAVE_LUA
 		wslua_init(cb, client_data);
+		startup_phase_end("Lua plugins");
 #endif
 	}
 	CATCH(DissectorError) {
@@ -304,6 +349,40 @@ epan_init(register_cb cb, gpointer client_data, gboolean load_plugins)
 	return status;
 }
 
+void
+epan_enable_startup_profile(void)
+{
+	if (!startup_phases)
+		startup_phases = g_array_new(FALSE, FALSE, sizeof(startup_phase_t));
+	register_enable_profile();
+}
+
+void
+epan_set_only_protocols(const char *protocols)
+{
+	register_set_only_protocols(protocols);
+}
+
+void
+epan_write_startup_profile(FILE *fh)
+{
+	gint64 total = 0;
+	guint i;
+
+	if (!startup_phases)
+		return;
+
+	fprintf(fh, "epan_init:\n");
+	for (i = 0; i < startup_phases->len; i++) {
+		startup_phase_t *phase = &g_array_index(startup_phases, startup_phase_t, i);
+		fprintf(fh, "  %10.3f ms  %s\n", phase->usecs / 1000.0, phase->name);
+		total += phase->usecs;
+	}
+	fprintf(fh, "  %10.3f ms  total\n", total / 1000.0);
+	fprintf(fh, "Protocol registration and handoffs:\n");
+	register_write_profile(fh, 20);
+}
+
 /*
  * Load all settings, from the current profile, that affect libwireshark.
  */
@@ -518,6 +597,7 @@ epan_dissect_init(epan_dissect_t *edt, epan_t *session, const gboolean create_pr
 	}
 
 	edt->tvb = NULL;
+	edt->tap_queue = NULL;
 
 #ifdef HAVE_PLUGINS
 	g_slist_foreach(epan_plugins, epan_plugin_dissect_init, edt);
@@ -572,6 +652,20 @@ epan_dissect_fake_protocols(epan_dissect_t *edt, const gboolean fake_protocols)
 		proto_tree_set_fake_protocols(edt->tree, fake_protocols);
 }
 
+void
+epan_dissect_set_selective(epan_dissect_t *edt, const gboolean selective)
+{
+	if (edt && edt->tree)
+		proto_tree_set_selective(edt->tree, selective);
+}
+
+void
+epan_dissect_keep_protocol(epan_dissect_t *edt, const int proto_id)
+{
+	if (edt && edt->tree)
+		proto_tree_keep_protocol(edt->tree, proto_id);
+}
+
 void
 epan_dissect_run(epan_dissect_t *edt, int file_type_subtype,
 	wtap_rec *rec, tvbuff_t *tvb, frame_data *fd,
@@ -652,6 +746,8 @@ epan_dissect_cleanup(epan_dissect_t* edt)
 		proto_tree_free(edt->tree);
 	}
 
+	tap_queue_free(edt);
+
 	if (pinfo_pool_cache == NULL) {
 		wmem_free_all(edt->pi.pool);
 		pinfo_pool_cache = edt->pi.pool;
@@ -14,6 +14,7 @@
 extern "C" {
 #endif /* __cplusplus */
 
+#include <stdio.h>
 #include <glib.h>
 #include <epan/tvbuff.h>
 #include <epan/prefs.h>
@@ -108,6 +109,27 @@ Ref2 for further edits - delete when done
 WS_DLL_PUBLIC
 gboolean epan_init(register_cb cb, void *client_data, gboolean load_plugins);
 
+/**
+ * Only register the named built-in dissectors (a comma-separated list of
+ * the names used by their proto_register_XXX and proto_reg_handoff_XXX
+ * routines) instead of all of them. Must be called before epan_init.
+ */
+WS_DLL_PUBLIC
+void epan_set_only_protocols(const char *protocols);
+
+/**
+ * Record how long each part of epan_init takes, including each dissector
+ * registration and handoff routine. Must be called before epan_init.
+ */
+WS_DLL_PUBLIC
+void epan_enable_startup_profile(void);
+
+/**
+ * Write the startup times recorded by epan_init.
+ */
+WS_DLL_PUBLIC
+void epan_write_startup_profile(FILE *fh);
+
 /**
  * Load all settings, from the current profile, that affect epan.
  */
@@ -199,6 +221,19 @@ WS_DLL_PUBLIC
 void
 epan_dissect_fake_protocols(epan_dissect_t *edt, const gboolean fake_protocols);
 
+/** Indicate whether we should only dissect up to the protocols whose
+ * fields/protocols have been primed, and stop there.
+ * See proto_tree_set_selective(). */
+WS_DLL_PUBLIC
+void
+epan_dissect_set_selective(epan_dissect_t *edt, const gboolean selective);
+
+/** Never skip a protocol when dissecting selectively; used for protocols
+ * that keep state, such as reassembly, across packets. */
+WS_DLL_PUBLIC
+void
+epan_dissect_keep_protocol(epan_dissect_t *edt, const int proto_id);
+
 /** run a single packet dissection */
 WS_DLL_PUBLIC
 void
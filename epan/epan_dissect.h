@@ -30,6 +30,7 @@ struct epan_dissect {
 	tvbuff_t	*tvb;
 	proto_tree	*tree;
 	packet_info	pi;
+	struct _tap_queue_t *tap_queue;	/* taps queued for this packet */
 };
 
 #ifdef __cplusplus
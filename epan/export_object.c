@@ -12,6 +12,9 @@
 
 #include <string.h>
 
+#include <wsutil/file_util.h>
+#include <wsutil/tempfile.h>
+
 #include "proto.h"
 #include "packet_info.h"
 #include "export_object.h"
@@ -25,6 +28,20 @@ struct register_eo {
 
 static wmem_tree_t *registered_eo_tables = NULL;
 
+/*
+ * Payloads that eo_keep_entry() moves out of memory are appended to one
+ * temporary file, which is removed when the last entry in it is freed.
+ */
+static gint64 eo_memory_limit = EO_DEFAULT_MEMORY_LIMIT;
+static gint64 eo_memory_used = 0;
+static int eo_spill_fd = -1;
+static gchar *eo_spill_path = NULL;
+static gint64 eo_spill_len = 0;
+static guint eo_spill_entries = 0;
+
+/* The most we hand to ws_read() or ws_write() at once; see eo_save_entry(). */
+#define EO_MAX_IO   0x40000000
+
 int
 register_export_object(const int proto_id, tap_packet_cb export_packet_func, export_object_gui_reset_cb reset_cb)
 {
@@ -146,8 +163,103 @@ eo_ct2ext(const char *content_type)
     return content_type;
 }
 
+void eo_set_memory_limit(gint64 limit)
+{
+    eo_memory_limit = limit;
+}
+
+static gboolean
+eo_spill_payload(export_object_entry_t *entry)
+{
+    const guint8 *ptr = entry->payload_data;
+    gint64 bytes_left = entry->payload_len;
+    ssize_t bytes_written;
+
+    if (eo_spill_fd == -1) {
+        eo_spill_fd = create_tempfile(&eo_spill_path, "wireshark_eo", NULL, NULL);
+        if (eo_spill_fd == -1)
+            return FALSE;
+        eo_spill_len = 0;
+    }
+
+    /* If an earlier write failed part way, this overwrites what it wrote. */
+    if (ws_lseek64(eo_spill_fd, eo_spill_len, SEEK_SET) == -1)
+        return FALSE;
+    while (bytes_left != 0) {
+        bytes_written = ws_write(eo_spill_fd, ptr,
+            bytes_left > EO_MAX_IO ? EO_MAX_IO : (unsigned int)bytes_left);
+        if (bytes_written <= 0)
+            return FALSE;
+        bytes_left -= bytes_written;
+        ptr += bytes_written;
+    }
+
+    entry->payload_store = EO_PAYLOAD_ON_DISK;
+    entry->payload_offset = eo_spill_len;
+    g_free(entry->payload_data);
+    entry->payload_data = NULL;
+    eo_spill_len += entry->payload_len;
+    eo_spill_entries++;
+    return TRUE;
+}
+
+void eo_keep_entry(export_object_entry_t *entry)
+{
+    if (entry->payload_growing || entry->payload_store != EO_PAYLOAD_UNTRACKED ||
+        entry->payload_data == NULL)
+        return;
+
+    /* If it can't be written out, keep it in memory after all. */
+    if (eo_memory_limit > 0 && eo_memory_used + entry->payload_len > eo_memory_limit &&
+        eo_spill_payload(entry))
+        return;
+
+    entry->payload_store = EO_PAYLOAD_IN_MEMORY;
+    eo_memory_used += entry->payload_len;
+}
+
+gssize eo_entry_read(const export_object_entry_t *entry, gint64 offset,
+                     void *buf, gsize len)
+{
+    if (offset < 0 || offset >= entry->payload_len)
+        return 0;
+    if ((gint64)len > entry->payload_len - offset)
+        len = (gsize)(entry->payload_len - offset);
+    if (len > EO_MAX_IO)
+        len = EO_MAX_IO;
+
+    if (entry->payload_store != EO_PAYLOAD_ON_DISK) {
+        memcpy(buf, entry->payload_data + offset, len);
+        return (gssize)len;
+    }
+
+    if (ws_lseek64(eo_spill_fd, entry->payload_offset + offset, SEEK_SET) == -1)
+        return -1;
+    return ws_read(eo_spill_fd, buf, (unsigned int)len);
+}
+
 void eo_free_entry(export_object_entry_t *entry)
 {
+    switch (entry->payload_store) {
+
+    case EO_PAYLOAD_IN_MEMORY:
+        eo_memory_used -= entry->payload_len;
+        break;
+
+    case EO_PAYLOAD_ON_DISK:
+        if (--eo_spill_entries == 0) {
+            ws_close(eo_spill_fd);
+            ws_unlink(eo_spill_path);
+            g_free(eo_spill_path);
+            eo_spill_fd = -1;
+            eo_spill_path = NULL;
+        }
+        break;
+
+    default:
+        break;
+    }
+
     g_free(entry->hostname);
     g_free(entry->content_type);
     g_free(entry->filename);
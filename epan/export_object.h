@@ -18,6 +18,15 @@
 extern "C" {
 #endif /* __cplusplus */
 
+/** Where the payload of an export object entry is; see eo_keep_entry(). */
+typedef enum {
+    EO_PAYLOAD_UNTRACKED = 0,   /**< in payload_data, not counted against the memory limit */
+    EO_PAYLOAD_IN_MEMORY,       /**< in payload_data, counted against the memory limit */
+    EO_PAYLOAD_ON_DISK          /**< in the temporary file, at payload_offset */
+} eo_payload_store_e;
+
+/* Dissectors must allocate these with g_new0(), so that the fields
+   they don't set are zero. */
 typedef struct _export_object_entry_t {
     guint32 pkt_num;
     gchar *hostname;
@@ -26,15 +35,22 @@ typedef struct _export_object_entry_t {
     /* We need to store a 64 bit integer to hold a file length
       (was guint payload_len;)
 
-      XXX - we store the entire object in the program's address space,
-      so the *real* maximum object size is size_t; if we were to export
-      objects by going through all of the packets containing data from
-      the object, one packet at a time, and write the object incrementally,
-      we could support objects that don't fit into the address space. */
+      XXX - the dissector builds the entire object in the program's
+      address space, so the *real* maximum object size is size_t; once
+      the object is complete, eo_keep_entry() may move it to disk. */
     gint64 payload_len;
-    guint8 *payload_data;
+    guint8 *payload_data;   /* NULL if the payload is on disk */
+    /* TRUE if the dissector may add to the payload after having added
+       the entry, so that it can't be saved or moved to disk until the
+       tap has been drawn. */
+    gboolean payload_growing;
+    eo_payload_store_e payload_store;
+    gint64 payload_offset;
 } export_object_entry_t;
 
+/** Default for eo_set_memory_limit(). */
+#define EO_DEFAULT_MEMORY_LIMIT       (G_GINT64_CONSTANT(256) * 1024 * 1024)
+
 /** Maximum file name size for the file to which we save an object.
     This is the file name size, not the path name size; we impose
     the limit so that the file doesn't have a ridiculously long
@@ -128,6 +144,34 @@ WS_DLL_PUBLIC GString *eo_massage_str(const gchar *in_str, gsize maxlen, int dup
  */
 WS_DLL_PUBLIC const char *eo_ct2ext(const char *content_type);
 
+/** Set how many bytes of object payloads eo_keep_entry() keeps in memory
+ * before it starts moving them to a temporary file; 0 means no limit.
+ *
+ * @param limit the limit in bytes
+ */
+WS_DLL_PUBLIC void eo_set_memory_limit(gint64 limit);
+
+/** Called by a GUI when it adds an entry to its list, to keep its payload
+ * in memory if that's within the limit, or otherwise move it to the
+ * temporary file shared by all entries. Entries whose payload is still
+ * growing are left as they are.
+ *
+ * @param entry export_object_entry_t structure being added
+ */
+WS_DLL_PUBLIC void eo_keep_entry(export_object_entry_t *entry);
+
+/** Read part of the payload of an entry, wherever it is.
+ *
+ * @param entry export_object_entry_t structure to read from
+ * @param offset offset in the payload
+ * @param buf buffer to read into
+ * @param len size of buf
+ * @return number of bytes read, 0 at the end of the payload, or -1 on
+ *  error with errno set
+ */
+WS_DLL_PUBLIC gssize eo_entry_read(const export_object_entry_t *entry, gint64 offset,
+                                   void *buf, gsize len);
+
 /** Free the contents of export_object_entry_t structure
  *
  * @param entry export_object_entry_t structure to be freed
@@ -0,0 +1,296 @@
+/* export_object_test.c
+ * Tests of export object payloads that are kept in memory up to a limit,
+ * and moved to a temporary file past it
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdarg.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "export_object.h"
+#include <wsutil/report_message.h>
+#include "ui/export_object_ui.h"
+
+/* Bigger than the buffer eo_save_entry() copies from disk with. */
+#define BIG_PAYLOAD_LEN (3 * 1024 * 1024 + 5)
+
+static gchar *tmp_dir;
+static guint failures;
+
+/* The byte at each offset of the nth payload. */
+static guint8
+payload_byte(guint n, gint64 offset)
+{
+    return (guint8)(n * 31 + offset * 7 + offset / 251);
+}
+
+static export_object_entry_t *
+new_entry(guint n, gint64 len)
+{
+    export_object_entry_t *entry = g_new0(export_object_entry_t, 1);
+    gint64 i;
+
+    entry->pkt_num = n;
+    entry->filename = g_strdup_printf("object%u", n);
+    entry->payload_len = len;
+    entry->payload_data = (guint8 *)g_malloc((gsize)len);
+    for (i = 0; i < len; i++)
+        entry->payload_data[i] = payload_byte(n, i);
+    return entry;
+}
+
+static void
+check_payload(const guint8 *buf, guint n, gint64 offset, gsize len)
+{
+    gsize i;
+
+    for (i = 0; i < len; i++)
+        g_assert_cmpuint(buf[i], ==, payload_byte(n, offset + i));
+}
+
+/* Read the whole payload with eo_entry_read(), a piece at a time. */
+static void
+check_entry(const export_object_entry_t *entry, guint n)
+{
+    guint8 buf[100];
+    gint64 offset = 0;
+    gssize len;
+
+    while (offset < entry->payload_len) {
+        len = eo_entry_read(entry, offset, buf, sizeof buf);
+        g_assert_cmpint(len, >, 0);
+        check_payload(buf, n, offset, (gsize)len);
+        offset += len;
+    }
+    g_assert_cmpint(offset, ==, entry->payload_len);
+    g_assert_cmpint(eo_entry_read(entry, offset, buf, sizeof buf), ==, 0);
+}
+
+/* Save the entry with eo_save_entry(), and read the file back. */
+static void
+check_saved(export_object_entry_t *entry, guint n)
+{
+    gchar *path = g_build_filename(tmp_dir, entry->filename, NULL);
+    gchar *contents;
+    gsize len;
+
+    eo_save_entry(path, entry);
+    g_assert_cmpuint(failures, ==, 0);
+    g_assert(g_file_get_contents(path, &contents, &len, NULL));
+    g_assert_cmpuint(len, ==, entry->payload_len);
+    check_payload((const guint8 *)contents, n, 0, len);
+    g_free(contents);
+    g_unlink(path);
+    g_free(path);
+}
+
+static void
+export_object_test_memory_limit(void)
+{
+    export_object_entry_t *entry1, *entry2, *entry3, *entry4;
+
+    eo_set_memory_limit(100);
+
+    /* Kept in memory while they fit. */
+    entry1 = new_entry(1, 60);
+    eo_keep_entry(entry1);
+    g_assert_cmpint(entry1->payload_store, ==, EO_PAYLOAD_IN_MEMORY);
+    g_assert_nonnull(entry1->payload_data);
+
+    /* Moved to disk when they don't. */
+    entry2 = new_entry(2, 60);
+    eo_keep_entry(entry2);
+    g_assert_cmpint(entry2->payload_store, ==, EO_PAYLOAD_ON_DISK);
+    g_assert_null(entry2->payload_data);
+    g_assert_cmpint(entry2->payload_offset, ==, 0);
+
+    /* Smaller ones can still fit. */
+    entry3 = new_entry(3, 40);
+    eo_keep_entry(entry3);
+    g_assert_cmpint(entry3->payload_store, ==, EO_PAYLOAD_IN_MEMORY);
+
+    /* Payloads on disk follow each other in the same file. */
+    entry4 = new_entry(4, 1);
+    eo_keep_entry(entry4);
+    g_assert_cmpint(entry4->payload_store, ==, EO_PAYLOAD_ON_DISK);
+    g_assert_cmpint(entry4->payload_offset, ==, 60);
+
+    check_entry(entry1, 1);
+    check_entry(entry2, 2);
+    check_entry(entry3, 3);
+    check_entry(entry4, 4);
+    check_saved(entry1, 1);
+    check_saved(entry2, 2);
+    check_saved(entry4, 4);
+
+    /* Freeing an entry in memory makes room. */
+    eo_free_entry(entry1);
+    entry1 = new_entry(5, 60);
+    eo_keep_entry(entry1);
+    g_assert_cmpint(entry1->payload_store, ==, EO_PAYLOAD_IN_MEMORY);
+    check_entry(entry1, 5);
+
+    /* Once the entries on disk are freed, the next one starts a new
+       file. */
+    eo_free_entry(entry2);
+    check_entry(entry4, 4);
+    eo_free_entry(entry4);
+    entry2 = new_entry(6, 10);
+    eo_keep_entry(entry2);
+    g_assert_cmpint(entry2->payload_store, ==, EO_PAYLOAD_ON_DISK);
+    g_assert_cmpint(entry2->payload_offset, ==, 0);
+    check_entry(entry2, 6);
+    check_saved(entry2, 6);
+
+    eo_free_entry(entry1);
+    eo_free_entry(entry2);
+    eo_free_entry(entry3);
+    eo_set_memory_limit(EO_DEFAULT_MEMORY_LIMIT);
+}
+
+/* A payload on disk that's bigger than what eo_save_entry() copies at
+   once. */
+static void
+export_object_test_big(void)
+{
+    export_object_entry_t *entry;
+    guint8 buf[16];
+
+    eo_set_memory_limit(100);
+    entry = new_entry(7, BIG_PAYLOAD_LEN);
+    eo_keep_entry(entry);
+    g_assert_cmpint(entry->payload_store, ==, EO_PAYLOAD_ON_DISK);
+
+    /* Reads are cut at the end of the payload. */
+    g_assert_cmpint(eo_entry_read(entry, BIG_PAYLOAD_LEN - 3, buf, sizeof buf), ==, 3);
+    check_payload(buf, 7, BIG_PAYLOAD_LEN - 3, 3);
+    g_assert_cmpint(eo_entry_read(entry, BIG_PAYLOAD_LEN, buf, sizeof buf), ==, 0);
+    g_assert_cmpint(eo_entry_read(entry, -1, buf, sizeof buf), ==, 0);
+
+    check_saved(entry, 7);
+    eo_free_entry(entry);
+
+    /* Without a limit, everything stays in memory. */
+    eo_set_memory_limit(0);
+    entry = new_entry(8, BIG_PAYLOAD_LEN);
+    eo_keep_entry(entry);
+    g_assert_cmpint(entry->payload_store, ==, EO_PAYLOAD_IN_MEMORY);
+    check_saved(entry, 8);
+    eo_free_entry(entry);
+
+    eo_set_memory_limit(EO_DEFAULT_MEMORY_LIMIT);
+}
+
+/* Entries that are still growing, or have nothing in them, are left
+   alone. */
+static void
+export_object_test_untracked(void)
+{
+    export_object_entry_t *entry;
+
+    eo_set_memory_limit(1);
+
+    entry = new_entry(9, 50);
+    entry->payload_growing = TRUE;
+    eo_keep_entry(entry);
+    g_assert_cmpint(entry->payload_store, ==, EO_PAYLOAD_UNTRACKED);
+    g_assert_nonnull(entry->payload_data);
+    check_entry(entry, 9);
+    check_saved(entry, 9);
+    eo_free_entry(entry);
+
+    entry = g_new0(export_object_entry_t, 1);
+    entry->filename = g_strdup("empty");
+    eo_keep_entry(entry);
+    g_assert_cmpint(entry->payload_store, ==, EO_PAYLOAD_UNTRACKED);
+    check_saved(entry, 0);
+    eo_free_entry(entry);
+
+    eo_set_memory_limit(EO_DEFAULT_MEMORY_LIMIT);
+}
+
+/* An existing file isn't overwritten. */
+static void
+export_object_test_save_exists(void)
+{
+    export_object_entry_t *entry = new_entry(10, 20);
+    gchar *path = g_build_filename(tmp_dir, entry->filename, NULL);
+    gchar *contents;
+
+    g_assert(g_file_set_contents(path, "old", -1, NULL));
+    eo_save_entry(path, entry);
+    g_assert_cmpuint(failures, ==, 1);
+    g_assert(g_file_get_contents(path, &contents, NULL, NULL));
+    g_assert_cmpstr(contents, ==, "old");
+    failures = 0;
+
+    g_free(contents);
+    g_unlink(path);
+    g_free(path);
+    eo_free_entry(entry);
+}
+
+static void
+count_failure(const char *msg_format _U_, va_list ap _U_)
+{
+    failures++;
+}
+
+static void
+count_open_failure(const char *filename _U_, int err _U_, gboolean for_writing _U_)
+{
+    failures++;
+}
+
+static void
+count_read_write_failure(const char *filename _U_, int err _U_)
+{
+    failures++;
+}
+
+int
+main(int argc, char **argv)
+{
+    int result;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/export_object/memory_limit", export_object_test_memory_limit);
+    g_test_add_func("/export_object/big", export_object_test_big);
+    g_test_add_func("/export_object/untracked", export_object_test_untracked);
+    g_test_add_func("/export_object/save_exists", export_object_test_save_exists);
+
+    init_report_message(count_failure, count_failure, count_open_failure,
+                        count_read_write_failure, count_read_write_failure);
+    tmp_dir = g_dir_make_tmp("export_object_test_XXXXXX", NULL);
+    g_assert_nonnull(tmp_dir);
+
+    result = g_test_run();
+
+    g_rmdir(tmp_dir);
+    g_free(tmp_dir);
+
+    return result;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -134,6 +134,7 @@ follow_reset_stream(follow_info_t* info)
     info->server_ip.len = 0;
     info->fragments[0] = info->fragments[1] = NULL;
     info->seq[0] = info->seq[1] = 0;
+    info->seq_pos[0] = info->seq_pos[1] = 0;
 }
 
 void
@@ -154,20 +155,10 @@ follow_info_free(follow_info_t* follow_info)
     g_list_free(follow_info->payload);
 
     //Only TCP stream uses fragments
-    for (cur = follow_info->fragments[0]; cur; cur = g_list_next(cur)) {
-        follow_record = (follow_record_t *)cur->data;
-        if(follow_record->data) {
-            g_byte_array_free(follow_record->data, TRUE);
-        }
-        g_free(follow_record);
-    }
-    for (cur = follow_info->fragments[1]; cur; cur = g_list_next(cur)) {
-        follow_record = (follow_record_t *)cur->data;
-        if(follow_record->data) {
-            g_byte_array_free(follow_record->data, TRUE);
-        }
-        g_free(follow_record);
-    }
+    if (follow_info->fragments[0])
+        g_tree_destroy(follow_info->fragments[0]);
+    if (follow_info->fragments[1])
+        g_tree_destroy(follow_info->fragments[1]);
 
     free_address(&follow_info->client_ip);
     free_address(&follow_info->server_ip);
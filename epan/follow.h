@@ -90,7 +90,8 @@ typedef struct _follow_info {
     GList           *payload;   /* "follow_record_t" entries, in reverse order. */
     guint           bytes_written[2]; /* Index with FROM_CLIENT or FROM_SERVER for readability. */
     guint32         seq[2]; /* TCP only */
-    GList           *fragments[2]; /* TCP only */
+    guint64         seq_pos[2]; /* TCP only: stream offset of seq[], so that fragments stay ordered across sequence number wraparound */
+    GTree           *fragments[2]; /* TCP only: out-of-order segments, ordered by stream offset */
     guint           client_port;
     guint           server_port;
     address         client_ip;
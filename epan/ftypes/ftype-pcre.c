@@ -18,6 +18,22 @@
 #include <glib.h>
 #include <string.h>
 
+struct _fvalue_regex_t {
+    GRegex *re;
+    /* An ASCII string, in lower case, that every match must contain
+     * (ignoring case), or NULL if none was found in the pattern. Subjects
+     * that don't contain it are rejected without running the regex. */
+    gchar  *literal;
+    gsize   literal_len;
+    /* Whether the literal has a letter that a caseless UTF-8 pattern also
+     * matches to a non-ASCII character: "k" to U+212A KELVIN SIGN and "s"
+     * to U+017F LATIN SMALL LETTER LONG S. */
+    gboolean literal_folds_non_ascii;
+};
+
+/* Shorter literals don't rule out enough subjects to be worth the scan. */
+#define REGEX_MIN_LITERAL_LEN 2
+
 static void
 gregex_fvalue_new(fvalue_t *fv)
 {
@@ -28,11 +44,227 @@ static void
 gregex_fvalue_free(fvalue_t *fv)
 {
     if (fv->value.re) {
-        g_regex_unref(fv->value.re);
+        g_regex_unref(fv->value.re->re);
+        g_free(fv->value.re->literal);
+        g_free(fv->value.re);
         fv->value.re = NULL;
     }
 }
 
+/*
+ * Find the longest run of literal characters that is outside of any group
+ * or character class and isn't made optional by a quantifier, and so must
+ * appear in every subject that the pattern matches.
+ *
+ * This errs on the side of not finding anything: alternation, option
+ * settings and \Q...\E quoting, which can change how the rest of the
+ * pattern is read, mean that no literal is used at all. The scan stops at
+ * any escape other than escaped punctuation, as the length of character
+ * codes, back references and the like (\x41, \012, \cA, \k<n>, \g{-1}...)
+ * would have to be parsed to know where the literal characters resume.
+ * Non-ASCII bytes end a run, as their case folding depends on the
+ * character tables rather than on g_ascii_tolower().
+ */
+static void
+regex_find_literal(const char *pattern, GString *best)
+{
+    GString *run = g_string_new(NULL);
+    const char *p = pattern;
+    int depth = 0;
+    gboolean last_in_run = FALSE;
+    char c;
+
+    g_string_truncate(best, 0);
+
+    if (strchr(pattern, '|') != NULL) {
+        goto give_up;
+    }
+
+    while ((c = *p) != '\0') {
+        switch (c) {
+
+        case '\\':
+            c = p[1];
+            if (c == '\0' || c == 'Q') {
+                goto give_up;
+            }
+            if (!g_ascii_ispunct(c)) {
+                /* A character type, back reference, assertion or
+                 * character code. */
+                goto done;
+            }
+            p += 2;
+            /* An escaped metacharacter stands for itself. */
+            if (depth == 0) {
+                g_string_append_c(run, g_ascii_tolower(c));
+                last_in_run = TRUE;
+            }
+            continue;
+
+        case '[':
+            /* Skip the character class, allowing for a leading "]" or
+             * "^]", escapes and POSIX classes such as [:alpha:]. */
+            p++;
+            if (*p == '^') {
+                p++;
+            }
+            if (*p == ']') {
+                p++;
+            }
+            while (*p != '\0' && *p != ']') {
+                if (*p == '\\' && p[1] != '\0') {
+                    p += 2;
+                } else if (*p == '[' && p[1] == ':') {
+                    const char *end = strstr(p + 2, ":]");
+                    p = end ? end + 2 : p + 1;
+                } else {
+                    p++;
+                }
+            }
+            if (*p == ']') {
+                p++;
+            }
+            break;
+
+        case '(':
+            if (p[1] == '?' && (g_ascii_isalpha(p[2]) || p[2] == '-' ||
+                        p[2] == '#' || p[2] == '^' || p[2] == ')')) {
+                /* Options, comments and named groups */
+                goto give_up;
+            }
+            depth++;
+            p++;
+            break;
+
+        case ')':
+            depth--;
+            p++;
+            break;
+
+        case '?':
+        case '*':
+        case '{':
+            /* The preceding character might not be there at all. */
+            if (last_in_run) {
+                g_string_truncate(run, run->len - 1);
+            }
+            if (c == '{') {
+                const char *end = strchr(p, '}');
+                p = end ? end + 1 : p + 1;
+            } else {
+                p++;
+            }
+            break;
+
+        case '+':
+        case '.':
+        case '^':
+        case '$':
+            p++;
+            break;
+
+        default:
+            if ((guchar)c >= 0x80) {
+                p++;
+                break;
+            }
+            if (depth == 0) {
+                g_string_append_c(run, g_ascii_tolower(c));
+                last_in_run = TRUE;
+            }
+            p++;
+            continue;
+        }
+
+        /* Anything else ends the run of literal characters. */
+        if (run->len > best->len) {
+            g_string_assign(best, run->str);
+        }
+        g_string_truncate(run, 0);
+        last_in_run = FALSE;
+    }
+
+done:
+    if (run->len > best->len) {
+        g_string_assign(best, run->str);
+    }
+    g_string_free(run, TRUE);
+    return;
+
+give_up:
+    g_string_truncate(best, 0);
+    g_string_free(run, TRUE);
+}
+
+static gboolean
+regex_literal_found(const fvalue_regex_t *regex, const guint8 *subject, gsize len)
+{
+    const guint8 *literal = (const guint8 *)regex->literal;
+    guint8 first_lower = literal[0];
+    guint8 first_upper = g_ascii_toupper(literal[0]);
+    const guint8 *p, *last;
+    gsize i;
+
+    if (len < regex->literal_len) {
+        return FALSE;
+    }
+
+    last = subject + len - regex->literal_len;
+    for (p = subject; p <= last; p++) {
+        if (*p != first_lower && *p != first_upper) {
+            continue;
+        }
+        for (i = 1; i < regex->literal_len; i++) {
+            if (g_ascii_tolower(p[i]) != literal[i]) {
+                break;
+            }
+        }
+        if (i == regex->literal_len) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static gboolean
+regex_has_non_ascii(const guint8 *subject, gsize len)
+{
+    gsize i;
+
+    for (i = 0; i < len; i++) {
+        if (subject[i] >= 0x80) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+gboolean
+fvalue_regex_matches(const fvalue_t *fv_re, const char *subject, gsize len)
+{
+    const fvalue_regex_t *regex = fv_re->value.re;
+
+    if (!regex) {
+        return FALSE;
+    }
+    if (regex->literal && !regex_literal_found(regex, (const guint8 *)subject, len)) {
+        /* A pattern that starts with (*UTF8) might still match it. */
+        if (!regex->literal_folds_non_ascii ||
+                !regex_has_non_ascii((const guint8 *)subject, len)) {
+            return FALSE;
+        }
+    }
+    return g_regex_match_full(
+            regex->re,          /* Compiled PCRE */
+            subject,            /* The data to check for the pattern... */
+            (gssize)len,        /* ... and its length */
+            0,                  /* Start offset within data */
+            (GRegexMatchFlags)0,    /* GRegexMatchFlags */
+            NULL,               /* We are not interested in the match information */
+            NULL                /* We don't want error information */
+            );
+}
+
 /* Generate a FT_PCRE from a parsed string pattern.
  * On failure, if err_msg is non-null, set *err_msg to point to a
  * g_malloc()ed error message. */
@@ -40,6 +272,8 @@ static gboolean
 val_from_string(fvalue_t *fv, const char *pattern, gchar **err_msg)
 {
     GError *regex_error = NULL;
+    GRegex *re;
+    GString *literal;
     GRegexCompileFlags cflags = (GRegexCompileFlags)(G_REGEX_CASELESS | G_REGEX_OPTIMIZE);
 
     /*
@@ -56,7 +290,7 @@ val_from_string(fvalue_t *fv, const char *pattern, gchar **err_msg)
     /* Free up the old value, if we have one */
     gregex_fvalue_free(fv);
 
-    fv->value.re = g_regex_new(
+    re = g_regex_new(
             pattern,            /* pattern */
             cflags,             /* Compile options */
             (GRegexMatchFlags)0,                  /* Match options */
@@ -68,11 +302,26 @@ val_from_string(fvalue_t *fv, const char *pattern, gchar **err_msg)
             *err_msg = g_strdup(regex_error->message);
         }
         g_error_free(regex_error);
-        if (fv->value.re) {
-            g_regex_unref(fv->value.re);
+        if (re) {
+            g_regex_unref(re);
         }
         return FALSE;
     }
+
+    fv->value.re = g_new0(fvalue_regex_t, 1);
+    fv->value.re->re = re;
+
+    /* The literal is compared ignoring case, which relies on the pattern
+     * being compiled with G_REGEX_CASELESS as above. */
+    literal = g_string_new(NULL);
+    regex_find_literal(pattern, literal);
+    if (literal->len >= REGEX_MIN_LITERAL_LEN) {
+        fv->value.re->literal_len = literal->len;
+        fv->value.re->literal_folds_non_ascii = strpbrk(literal->str, "ks") != NULL;
+        fv->value.re->literal = g_string_free(literal, FALSE);
+    } else {
+        g_string_free(literal, TRUE);
+    }
     return TRUE;
 }
 
@@ -91,14 +340,14 @@ static int
 gregex_repr_len(fvalue_t *fv, ftrepr_t rtype, int field_display _U_)
 {
     g_assert(rtype == FTREPR_DFILTER);
-    return (int)strlen(g_regex_get_pattern(fv->value.re));
+    return (int)strlen(g_regex_get_pattern(fv->value.re->re));
 }
 
 static void
 gregex_to_repr(fvalue_t *fv, ftrepr_t rtype, int field_display _U_, char *buf, unsigned int size)
 {
     g_assert(rtype == FTREPR_DFILTER);
-    g_strlcpy(buf, g_regex_get_pattern(fv->value.re), size);
+    g_strlcpy(buf, g_regex_get_pattern(fv->value.re->re), size);
 }
 
 /* BEHOLD - value contains the string representation of the regular expression,
@@ -115,7 +364,7 @@ gregex_fvalue_set(fvalue_t *fv, const char *value)
 static gpointer
 gregex_fvalue_get(fvalue_t *fv)
 {
-    return fv->value.re;
+    return fv->value.re ? fv->value.re->re : NULL;
 }
 
 void
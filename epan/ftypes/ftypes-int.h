@@ -34,6 +34,11 @@ void ftype_register_time(void);
 void ftype_register_tvbuff(void);
 void ftype_register_pcre(void);
 
+/* Returns TRUE if the compiled FT_PCRE pattern in fv_re matches the first
+ * len bytes of subject. */
+gboolean
+fvalue_regex_matches(const fvalue_t *fv_re, const char *subject, gsize len);
+
 typedef void (*FvalueNewFunc)(fvalue_t*);
 typedef void (*FvalueFreeFunc)(fvalue_t*);
 
@@ -0,0 +1,461 @@
+/* heur_dissector_test.c
+ * Tests of heuristic dissector prefilters and of the dissectors remembered
+ * for conversations
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "epan.h"
+#include "epan_dissect.h"
+#include "frame_data.h"
+#include "packet.h"
+#include "prefs.h"
+#include <wiretap/wtap.h>
+#include <wsutil/pint.h>
+
+#define MAX_FRAME_LEN   512
+
+#define IP_PROTO_UDP    17
+#define IP_PROTO_TEST   253     /* RFC 3692 experimentation */
+#define UDP_PORT_VXLAN  4789
+
+static const guint8 host_1[] = { 192, 0, 2, 1 };
+static const guint8 host_2[] = { 192, 0, 2, 2 };
+static const guint8 host_3[] = { 198, 51, 100, 3 };
+static const guint8 host_4[] = { 198, 51, 100, 4 };
+
+static epan_t *session;
+static epan_dissect_t *edt;
+static guint32 frame_count;
+static int proto_heurtest = -1;
+
+static gboolean
+payload_is(tvbuff_t *tvb, const char *str)
+{
+    return tvb_strneql(tvb, 0, str, strlen(str)) == 0;
+}
+
+static gboolean
+dissect_test_a(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree _U_, void *data _U_)
+{
+    return payload_is(tvb, "TEST-A");
+}
+
+static gboolean
+dissect_test_b(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree _U_, void *data _U_)
+{
+    return payload_is(tvb, "TEST-B");
+}
+
+static gboolean
+dissect_test_ip(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree _U_, void *data _U_)
+{
+    return payload_is(tvb, "TEST-IP");
+}
+
+static const nstime_t *
+get_frame_ts(struct packet_provider_data *prov _U_, guint32 frame_num _U_)
+{
+    static nstime_t empty;
+
+    return &empty;
+}
+
+static void
+new_session(void)
+{
+    static const struct packet_provider_funcs funcs = {
+        get_frame_ts,
+        NULL,
+        NULL,
+        NULL
+    };
+
+    session = epan_new(NULL, &funcs);
+    edt = epan_dissect_new(session, FALSE, FALSE);
+}
+
+static void
+free_session(void)
+{
+    epan_dissect_free(edt);
+    epan_free(session);
+}
+
+/* Dissect the first caplen bytes of a frame of len bytes. */
+static void
+dissect_frame(const guint8 *buf, guint caplen, guint len)
+{
+    wtap_rec rec;
+    frame_data fd;
+
+    memset(&rec, 0, sizeof rec);
+    rec.rec_type = REC_TYPE_PACKET;
+    rec.presence_flags = WTAP_HAS_TS | WTAP_HAS_CAP_LEN;
+    rec.rec_header.packet_header.caplen = caplen;
+    rec.rec_header.packet_header.len = len;
+    rec.rec_header.packet_header.pkt_encap = WTAP_ENCAP_ETHERNET;
+
+    frame_data_init(&fd, ++frame_count, &rec, 0, 0);
+    epan_dissect_run(edt, WTAP_FILE_TYPE_SUBTYPE_UNKNOWN, &rec,
+            tvb_new_real_data(buf, caplen, len), &fd, NULL);
+    frame_data_destroy(&fd);
+    epan_dissect_reset(edt);
+}
+
+/* An Ethernet frame with an IPv4 packet; returns its length. */
+static guint
+put_ipv4(guint8 *buf, const guint8 *src, const guint8 *dst, guint8 proto,
+        const guint8 *payload, guint payload_len)
+{
+    static const guint8 eth_header[] = {
+        0x00, 0x00, 0x5e, 0x00, 0x53, 0x01,
+        0x00, 0x00, 0x5e, 0x00, 0x53, 0x02,
+        0x08, 0x00
+    };
+    guint8 *ip = buf + sizeof eth_header;
+    guint32 sum = 0;
+    guint i;
+
+    g_assert(sizeof eth_header + 20 + payload_len <= MAX_FRAME_LEN);
+    memcpy(buf, eth_header, sizeof eth_header);
+    memset(ip, 0, 20);
+    ip[0] = 0x45;
+    phton16(ip + 2, 20 + payload_len);
+    ip[8] = 64;
+    ip[9] = proto;
+    memcpy(ip + 12, src, 4);
+    memcpy(ip + 16, dst, 4);
+    for (i = 0; i < 20; i += 2)
+        sum += pntoh16(ip + i);
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    phton16(ip + 10, ~sum & 0xffff);
+    memcpy(ip + 20, payload, payload_len);
+    return sizeof eth_header + 20 + payload_len;
+}
+
+static guint
+put_udp(guint8 *buf, const guint8 *src, const guint8 *dst, guint16 sport,
+        guint16 dport, const guint8 *payload, guint payload_len)
+{
+    guint8 udp[MAX_FRAME_LEN];
+
+    g_assert(8 + payload_len <= sizeof udp);
+    phton16(udp, sport);
+    phton16(udp + 2, dport);
+    phton16(udp + 4, 8 + payload_len);
+    phton16(udp + 6, 0);
+    memcpy(udp + 8, payload, payload_len);
+    return put_ipv4(buf, src, dst, IP_PROTO_UDP, udp, 8 + payload_len);
+}
+
+static void
+dissect_udp(const guint8 *src, const guint8 *dst, guint16 sport, guint16 dport,
+        const guint8 *payload, guint payload_len)
+{
+    guint8 buf[MAX_FRAME_LEN];
+    guint len = put_udp(buf, src, dst, sport, dport, payload, payload_len);
+
+    dissect_frame(buf, len, len);
+}
+
+static void
+dissect_udp_str(const guint8 *src, const guint8 *dst, guint16 sport, guint16 dport,
+        const char *payload)
+{
+    dissect_udp(src, dst, sport, dport, (const guint8 *)payload, (guint)strlen(payload));
+}
+
+/* An IPv4 packet in a VXLAN tunnel, whose inner IPv4 layer carries a
+   protocol that only the "ip" heuristics are tried with. */
+static void
+dissect_vxlan(const guint8 *outer_src, const guint8 *outer_dst, guint16 sport,
+        const guint8 *inner_src, const guint8 *inner_dst, const char *payload)
+{
+    guint8 vxlan[MAX_FRAME_LEN];
+    guint8 buf[MAX_FRAME_LEN];
+    guint inner_len, len;
+
+    memset(vxlan, 0, 8);
+    vxlan[0] = 0x08;        /* the VNI is valid */
+    vxlan[6] = 0x01;        /* VNI 1 */
+    inner_len = put_ipv4(vxlan + 8, inner_src, inner_dst, IP_PROTO_TEST,
+            (const guint8 *)payload, (guint)strlen(payload));
+    len = put_udp(buf, outer_src, outer_dst, sport, UDP_PORT_VXLAN, vxlan, 8 + inner_len);
+    dissect_frame(buf, len, len);
+}
+
+/* Enable the test heuristics, and also the one named by user_data, if
+   any, so that nothing else can take the test packets. */
+static void
+enable_only(const gchar *table_name _U_, struct heur_dtbl_entry *entry, gpointer user_data)
+{
+    const char *name = (const char *)user_data;
+
+    entry->enabled = g_str_has_prefix(entry->short_name, "heurtest_") ||
+        (name != NULL && strcmp(entry->short_name, name) == 0);
+}
+
+static heur_dtbl_entry_t *
+find_entry(const char *short_name)
+{
+    heur_dtbl_entry_t *entry = find_heur_dissector_by_unique_short_name(short_name);
+
+    g_assert_nonnull(entry);
+    return entry;
+}
+
+static void
+get_stats(const char *list_name, heur_dissector_list_stats_t *stats)
+{
+    heur_dissector_list_get_stats(find_heur_dissector_list(list_name), stats);
+}
+
+static void
+heur_dissector_test_prefilter_rtcp(void)
+{
+    /* A receiver report without report blocks. */
+    static const guint8 rtcp_rr[] = {
+        0x80, 0xc9, 0x00, 0x01, 0x12, 0x34, 0x56, 0x78
+    };
+    /* RTP, payload type 96. */
+    static const guint8 rtp[] = {
+        0x80, 0x60, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+        0x12, 0x34, 0x56, 0x78
+    };
+    heur_dtbl_entry_t *entry = find_entry("rtcp_udp");
+    guint8 buf[MAX_FRAME_LEN];
+    guint64 calls, accepts, rejects;
+    guint len;
+
+    g_assert_nonnull(entry->prefilter);
+    heur_dissector_table_foreach("udp", enable_only, (gpointer)"rtcp_udp");
+    calls = entry->calls;
+    accepts = entry->accepts;
+    rejects = entry->prefilter_rejects;
+
+    dissect_udp(host_1, host_2, 40000, 40001, rtcp_rr, sizeof rtcp_rr);
+    g_assert_cmpuint(entry->calls, ==, calls + 1);
+    g_assert_cmpuint(entry->accepts, ==, accepts + 1);
+    g_assert_cmpuint(entry->prefilter_rejects, ==, rejects);
+
+    /* Not RTCP, so the dissector isn't called. */
+    dissect_udp(host_1, host_2, 40002, 40003, rtp, sizeof rtp);
+    dissect_udp_str(host_1, host_2, 40004, 40005, "not RTCP");
+    g_assert_cmpuint(entry->calls, ==, calls + 1);
+    g_assert_cmpuint(entry->prefilter_rejects, ==, rejects + 2);
+
+    /* Only the first byte of the signature was captured, so the
+       dissector is called to decide for itself. */
+    len = put_udp(buf, host_1, host_2, 40006, 40007, rtcp_rr, sizeof rtcp_rr);
+    dissect_frame(buf, len - (sizeof rtcp_rr - 1), len);
+    g_assert_cmpuint(entry->calls, ==, calls + 2);
+    g_assert_cmpuint(entry->prefilter_rejects, ==, rejects + 2);
+
+    heur_dissector_table_foreach("udp", enable_only, NULL);
+}
+
+static void
+heur_dissector_test_prefilter_wireguard(void)
+{
+    guint8 message[148];
+    heur_dtbl_entry_t *entry = find_entry("wg");
+    guint64 calls, accepts, rejects;
+
+    g_assert_nonnull(entry->prefilter);
+    heur_dissector_table_foreach("udp", enable_only, (gpointer)"wg");
+    calls = entry->calls;
+    accepts = entry->accepts;
+    rejects = entry->prefilter_rejects;
+
+    /* A handshake initiation. */
+    memset(message, 0, sizeof message);
+    message[0] = 1;
+    dissect_udp(host_1, host_2, 40010, 40011, message, sizeof message);
+    g_assert_cmpuint(entry->calls, ==, calls + 1);
+    g_assert_cmpuint(entry->accepts, ==, accepts + 1);
+    g_assert_cmpuint(entry->prefilter_rejects, ==, rejects);
+
+    /* Too short for any message. */
+    dissect_udp(host_1, host_2, 40012, 40013, message, 16);
+    /* Not a message type. */
+    message[0] = 0x45;
+    dissect_udp(host_1, host_2, 40014, 40015, message, sizeof message);
+    g_assert_cmpuint(entry->calls, ==, calls + 1);
+    g_assert_cmpuint(entry->prefilter_rejects, ==, rejects + 2);
+
+    /* A message type the prefilter lets through, but the dissector
+       doesn't accept. */
+    message[0] = 7;
+    dissect_udp(host_1, host_2, 40016, 40017, message, sizeof message);
+    g_assert_cmpuint(entry->calls, ==, calls + 2);
+    g_assert_cmpuint(entry->accepts, ==, accepts + 1);
+
+    heur_dissector_table_foreach("udp", enable_only, NULL);
+}
+
+static void
+heur_dissector_test_memo(void)
+{
+    heur_dissector_list_stats_t start, stats;
+    heur_dtbl_entry_t *entry_a = find_entry("heurtest_a");
+    heur_dtbl_entry_t *entry_b = find_entry("heurtest_b");
+    guint64 a_calls = entry_a->calls;
+
+    heur_dissector_table_foreach("udp", enable_only, NULL);
+    get_stats("udp", &start);
+
+    /* The list is walked for the first packet of a conversation. */
+    dissect_udp_str(host_1, host_2, 41000, 41001, "TEST-A 1");
+    get_stats("udp", &stats);
+    g_assert_cmpuint(stats.tries, ==, start.tries + 1);
+    g_assert_cmpuint(stats.walks, ==, start.walks + 1);
+    g_assert_cmpuint(stats.memo_hits, ==, start.memo_hits);
+    g_assert_cmpuint(stats.memo_misses, ==, start.memo_misses);
+
+    /* The dissector that recognized it is tried first for the others,
+       in either direction. */
+    dissect_udp_str(host_1, host_2, 41000, 41001, "TEST-A 2");
+    dissect_udp_str(host_2, host_1, 41001, 41000, "TEST-A 3");
+    get_stats("udp", &stats);
+    g_assert_cmpuint(stats.tries, ==, start.tries + 3);
+    g_assert_cmpuint(stats.walks, ==, start.walks + 1);
+    g_assert_cmpuint(stats.memo_hits, ==, start.memo_hits + 2);
+    g_assert_cmpuint(entry_a->calls, ==, a_calls + 3);
+
+    /* If it rejects a packet, the list is walked, but what's remembered
+       doesn't change. */
+    dissect_udp_str(host_1, host_2, 41000, 41001, "TEST-B 4");
+    dissect_udp_str(host_1, host_2, 41000, 41001, "TEST-A 5");
+    get_stats("udp", &stats);
+    g_assert_cmpuint(stats.walks, ==, start.walks + 2);
+    g_assert_cmpuint(stats.memo_hits, ==, start.memo_hits + 3);
+    g_assert_cmpuint(stats.memo_misses, ==, start.memo_misses + 1);
+
+    /* Other conversations have their own. */
+    dissect_udp_str(host_1, host_2, 41002, 41001, "TEST-B 6");
+    dissect_udp_str(host_1, host_2, 41002, 41001, "TEST-B 7");
+    get_stats("udp", &stats);
+    g_assert_cmpuint(stats.walks, ==, start.walks + 3);
+    g_assert_cmpuint(stats.memo_hits, ==, start.memo_hits + 4);
+
+    /* A disabled dissector isn't tried first. */
+    entry_b->enabled = FALSE;
+    dissect_udp_str(host_1, host_2, 41002, 41001, "TEST-B 8");
+    entry_b->enabled = TRUE;
+    get_stats("udp", &stats);
+    g_assert_cmpuint(stats.walks, ==, start.walks + 4);
+    g_assert_cmpuint(stats.memo_hits, ==, start.memo_hits + 4);
+    g_assert_cmpuint(stats.memo_misses, ==, start.memo_misses + 1);
+
+    /* Removing a dissector forgets the conversations it recognized. */
+    heur_dissector_delete("udp", dissect_test_a, proto_heurtest);
+    heur_dissector_add("udp", dissect_test_a, "Test A over UDP", "heurtest_a",
+            proto_heurtest, HEURISTIC_ENABLE);
+    entry_a = find_entry("heurtest_a");
+    dissect_udp_str(host_1, host_2, 41000, 41001, "TEST-A 9");
+    get_stats("udp", &stats);
+    g_assert_cmpuint(stats.walks, ==, start.walks + 5);
+    g_assert_cmpuint(stats.memo_hits, ==, start.memo_hits + 4);
+    g_assert_cmpuint(entry_a->accepts, ==, 1);
+
+    /* And so does starting on another file. */
+    free_session();
+    new_session();
+    dissect_udp_str(host_1, host_2, 41002, 41001, "TEST-B 10");
+    get_stats("udp", &stats);
+    g_assert_cmpuint(stats.tries, ==, start.tries + 10);
+    g_assert_cmpuint(stats.walks, ==, start.walks + 6);
+    g_assert_cmpuint(stats.memo_hits, ==, start.memo_hits + 4);
+    g_assert_cmpuint(stats.memo_misses, ==, start.memo_misses + 1);
+}
+
+/* In a tunnel, the "ip" heuristics see the inner addresses with the outer
+   ports, so no dissector is remembered for them. */
+static void
+heur_dissector_test_memo_tunnel(void)
+{
+    heur_dissector_list_stats_t start, stats;
+    heur_dtbl_entry_t *entry = find_entry("heurtest_ip");
+    guint64 accepts = entry->accepts;
+
+    heur_dissector_table_foreach("udp", enable_only, NULL);
+    heur_dissector_table_foreach("ip", enable_only, NULL);
+    get_stats("ip", &start);
+
+    /* The outer and inner addresses are the same, so the addresses and
+       ports are those of a conversation the outer UDP layer set up. */
+    dissect_vxlan(host_1, host_2, 42000, host_1, host_2, "TEST-IP 1");
+    dissect_vxlan(host_1, host_2, 42000, host_1, host_2, "TEST-IP 2");
+    dissect_vxlan(host_3, host_4, 42000, host_1, host_2, "TEST-IP 3");
+    get_stats("ip", &stats);
+    g_assert_cmpuint(entry->accepts, ==, accepts + 3);
+    g_assert_cmpuint(stats.tries, ==, start.tries + 3);
+    g_assert_cmpuint(stats.walks, ==, start.walks + 3);
+    g_assert_cmpuint(stats.memo_hits, ==, start.memo_hits);
+    g_assert_cmpuint(stats.memo_misses, ==, start.memo_misses);
+}
+
+int
+main(int argc, char **argv)
+{
+    char try_heuristic_first[] = "udp.try_heuristic_first:TRUE";
+    char *errmsg = NULL;
+    int result;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/heur_dissector/prefilter/rtcp", heur_dissector_test_prefilter_rtcp);
+    g_test_add_func("/heur_dissector/prefilter/wireguard", heur_dissector_test_prefilter_wireguard);
+    g_test_add_func("/heur_dissector/memo", heur_dissector_test_memo);
+    g_test_add_func("/heur_dissector/memo/tunnel", heur_dissector_test_memo_tunnel);
+
+    wtap_init(FALSE);
+    if (!epan_init(NULL, NULL, FALSE))
+        return 2;
+
+    proto_heurtest = proto_register_protocol("Heuristic dissector test", "HEURTEST", "heurtest");
+    heur_dissector_add("udp", dissect_test_a, "Test A over UDP", "heurtest_a",
+            proto_heurtest, HEURISTIC_ENABLE);
+    heur_dissector_add("udp", dissect_test_b, "Test B over UDP", "heurtest_b",
+            proto_heurtest, HEURISTIC_ENABLE);
+    heur_dissector_add("ip", dissect_test_ip, "Test over IP", "heurtest_ip",
+            proto_heurtest, HEURISTIC_ENABLE);
+
+    /* So that the test ports don't matter. */
+    if (prefs_set_pref(try_heuristic_first, &errmsg) != PREFS_SET_OK)
+        return 2;
+    prefs_apply_all();
+
+    new_session();
+    result = g_test_run();
+    free_session();
+
+    epan_cleanup();
+    wtap_cleanup();
+
+    return result;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,479 @@
+/* label_fmt_test.c
+ * Tests of item labels that are rendered when they're asked for, and a
+ * benchmark of adding items with formatted labels
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <glib.h>
+
+#include "epan.h"
+#include "epan_dissect.h"
+#include "frame_data.h"
+#include "packet.h"
+#include "proto.h"
+#include <wiretap/wtap.h>
+
+/* Run the benchmark with "label_fmt_test -m perf". */
+#define BENCH_ITEMS     20000
+#define BENCH_FRAMES    50
+
+static epan_t *session;
+static epan_dissect_t *edt;
+static guint32 frame_count;
+
+static int proto_label_fmt_test = -1;
+static int hf_text = -1;
+static int hf_value = -1;
+static int hf_bits = -1;
+
+/* What the test dissector does with its tree. */
+static void (*current_test)(tvbuff_t *tvb, proto_tree *tree);
+static guint tests_run;
+
+static char long_string[ITEM_LABEL_LENGTH + 50];
+static const char unterminated[4] = { 'w', 'x', 'y', 'z' };
+static const char *null_string = NULL;
+
+static int
+dissect_label_fmt_test(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree, void *data _U_)
+{
+    g_assert_nonnull(tree);
+    current_test(tvb, tree);
+    tests_run++;
+    return tvb_captured_length(tvb);
+}
+
+static const nstime_t *
+get_frame_ts(struct packet_provider_data *prov _U_, guint32 frame_num _U_)
+{
+    static nstime_t empty;
+
+    return &empty;
+}
+
+/* Call test with a visible tree. */
+static void
+run_in_tree(void (*test)(tvbuff_t *tvb, proto_tree *tree))
+{
+    static const guint8 buf[] = { 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    guint runs = tests_run;
+    wtap_rec rec;
+    frame_data fd;
+
+    memset(&rec, 0, sizeof rec);
+    rec.rec_type = REC_TYPE_PACKET;
+    rec.presence_flags = WTAP_HAS_TS | WTAP_HAS_CAP_LEN;
+    rec.rec_header.packet_header.caplen = sizeof buf;
+    rec.rec_header.packet_header.len = sizeof buf;
+    rec.rec_header.packet_header.pkt_encap = WTAP_ENCAP_USER0;
+
+    current_test = test;
+    frame_data_init(&fd, ++frame_count, &rec, 0, 0);
+    epan_dissect_run(edt, WTAP_FILE_TYPE_SUBTYPE_UNKNOWN, &rec,
+            tvb_new_real_data(buf, sizeof buf, sizeof buf), &fd, NULL);
+    frame_data_destroy(&fd);
+    epan_dissect_reset(edt);
+    g_assert_cmpuint(tests_run, ==, runs + 1);
+}
+
+/* Mark an expected label as truncated, the way proto.c does. */
+static void
+mark_truncated(char *expected)
+{
+    char label[ITEM_LABEL_LENGTH];
+
+    g_strlcpy(label, expected, sizeof label);
+    /* The label is cut before its last character. */
+    g_snprintf(expected, ITEM_LABEL_LENGTH - 1, " [truncated]%s", label);
+}
+
+/* The label of an item hasn't been rendered, and renders as expected. */
+static void
+check_deferred(proto_item *ti, const char *expected)
+{
+    field_info *fi = PITEM_FINFO(ti);
+
+    g_assert_nonnull(fi);
+    g_assert_null(fi->rep);
+    g_assert_nonnull(fi->rep_fmt);
+    g_assert_cmpstr(proto_item_get_rep(fi)->representation, ==, expected);
+    g_assert_null(fi->rep_fmt);
+    /* Asking again gets the same label. */
+    g_assert_cmpstr(proto_item_get_rep(fi)->representation, ==, expected);
+}
+
+/* The label of an item was rendered right away. */
+static void
+check_rendered(proto_item *ti, const char *expected)
+{
+    field_info *fi = PITEM_FINFO(ti);
+
+    g_assert_nonnull(fi);
+    g_assert_nonnull(fi->rep);
+    g_assert_null(fi->rep_fmt);
+    g_assert_cmpstr(proto_item_get_rep(fi)->representation, ==, expected);
+}
+
+/*
+ * Each format, with its arguments, is given to each of the ways of setting
+ * a label, and what's rendered is compared with what g_snprintf() gives,
+ * which is what the label used to be.
+ */
+#define FOR_EACH_FORMAT(CHECK) \
+    CHECK("plain text"); \
+    CHECK("100%% sure, %%d"); \
+    CHECK("%d %i %u %o %x %X", -42, 42, 42u, 8, 255, 255); \
+    CHECK("%ld %lu %lx", -123456789L, 123456789UL, 0xdeadbeefUL); \
+    CHECK("%lld %llu %" G_GINT64_MODIFIER "x", (long long)-1234567890123LL, \
+            (unsigned long long)1234567890123ULL, G_GUINT64_CONSTANT(0x123456789abcdef)); \
+    CHECK("%zu %zd %jd %td", (size_t)12345, (gssize)-12345, (intmax_t)-99, (ptrdiff_t)77); \
+    CHECK("%hd %hhu", 70000, 300); \
+    CHECK("%c%c%c", 'a', 'b', 'c'); \
+    CHECK("%f %.3e %g %G %a %lf", 3.14159, 12345.678, 0.0001, 1e20, 1.5, 2.5); \
+    CHECK("[%-8d] [%+d] [% d] [%#x] [%#o] [%08.3f] [%'d]", 5, 5, 5, 255, 8, 3.14159, 1234567); \
+    CHECK("[%*d] [%-*d] [%.*f] [%*.*s] [%.*s]", 6, 42, 6, 42, 2, 2.71828, 8, 3, "abcdef", -1, "neg"); \
+    CHECK("%s and %s", "one", "two"); \
+    CHECK("[%.3s] [%10s] [%-10s] [%s]", "abcdef", "right", "left", ""); \
+    CHECK("[%.4s] [%.2s]", unterminated, unterminated); \
+    CHECK("%s", null_string); \
+    CHECK("%p", (void *)&long_string); \
+    CHECK("%s", long_string); \
+    CHECK("%d %s", 42, long_string); \
+    CHECK("%s%s", long_string, long_string); \
+    CHECK("%.10s|%.300s|%d", long_string, long_string, 7); \
+    CHECK("%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d", 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16)
+
+#define CHECK_SET(...) \
+    do { \
+        char expected[ITEM_LABEL_LENGTH]; \
+        if (g_snprintf(expected, ITEM_LABEL_LENGTH, __VA_ARGS__) >= ITEM_LABEL_LENGTH) \
+            mark_truncated(expected); \
+        check_deferred(proto_tree_add_none_format(tree, hf_text, tvb, 0, 0, __VA_ARGS__), \
+                expected); \
+    } while (0)
+
+#define CHECK_SET_TEXT(...) \
+    do { \
+        char expected[ITEM_LABEL_LENGTH]; \
+        proto_item *ti = proto_tree_add_item(tree, hf_value, tvb, 0, 1, ENC_BIG_ENDIAN); \
+        if (g_snprintf(expected, ITEM_LABEL_LENGTH, __VA_ARGS__) >= ITEM_LABEL_LENGTH) \
+            mark_truncated(expected); \
+        proto_item_set_text(ti, __VA_ARGS__); \
+        check_deferred(ti, expected); \
+    } while (0)
+
+#define CHECK_SET_VALUE(...) \
+    do { \
+        char expected[ITEM_LABEL_LENGTH]; \
+        int n = g_snprintf(expected, ITEM_LABEL_LENGTH, "Value: "); \
+        n += g_snprintf(expected + n, ITEM_LABEL_LENGTH - n, __VA_ARGS__); \
+        if (n >= ITEM_LABEL_LENGTH) \
+            mark_truncated(expected); \
+        check_deferred(proto_tree_add_uint_format_value(tree, hf_value, tvb, 0, 1, 5, \
+                __VA_ARGS__), expected); \
+    } while (0)
+
+#define CHECK_SET_VALUE_BITS(...) \
+    do { \
+        char expected[ITEM_LABEL_LENGTH]; \
+        int n = g_snprintf(expected, ITEM_LABEL_LENGTH, ".... 0101 = Bits: "); \
+        n += g_snprintf(expected + n, ITEM_LABEL_LENGTH - n, __VA_ARGS__); \
+        if (n >= ITEM_LABEL_LENGTH) \
+            mark_truncated(expected); \
+        check_deferred(proto_tree_add_uint_format_value(tree, hf_bits, tvb, 0, 1, 5, \
+                __VA_ARGS__), expected); \
+    } while (0)
+
+#define CHECK_APPEND(...) \
+    do { \
+        char expected[ITEM_LABEL_LENGTH]; \
+        proto_item *ti = proto_tree_add_item(tree, hf_value, tvb, 0, 1, ENC_BIG_ENDIAN); \
+        gsize n = g_strlcpy(expected, "Value: 5", ITEM_LABEL_LENGTH); \
+        g_snprintf(expected + n, (gulong)(ITEM_LABEL_LENGTH - n), __VA_ARGS__); \
+        proto_item_append_text(ti, __VA_ARGS__); \
+        check_deferred(ti, expected); \
+    } while (0)
+
+#define CHECK_PREPEND(...) \
+    do { \
+        char expected[ITEM_LABEL_LENGTH]; \
+        proto_item *ti = proto_tree_add_item(tree, hf_value, tvb, 0, 1, ENC_BIG_ENDIAN); \
+        g_snprintf(expected, ITEM_LABEL_LENGTH, __VA_ARGS__); \
+        g_strlcat(expected, "Value: 5", ITEM_LABEL_LENGTH); \
+        proto_item_prepend_text(ti, __VA_ARGS__); \
+        check_deferred(ti, expected); \
+    } while (0)
+
+static void
+test_set(tvbuff_t *tvb, proto_tree *tree)
+{
+    FOR_EACH_FORMAT(CHECK_SET);
+}
+
+static void
+test_set_text(tvbuff_t *tvb, proto_tree *tree)
+{
+    FOR_EACH_FORMAT(CHECK_SET_TEXT);
+}
+
+static void
+test_set_value(tvbuff_t *tvb, proto_tree *tree)
+{
+    FOR_EACH_FORMAT(CHECK_SET_VALUE);
+    FOR_EACH_FORMAT(CHECK_SET_VALUE_BITS);
+}
+
+static void
+test_append(tvbuff_t *tvb, proto_tree *tree)
+{
+    FOR_EACH_FORMAT(CHECK_APPEND);
+}
+
+static void
+test_prepend(tvbuff_t *tvb, proto_tree *tree)
+{
+    FOR_EACH_FORMAT(CHECK_PREPEND);
+}
+
+/* Several formats for the same item are rendered in order. */
+static void
+test_combined(tvbuff_t *tvb, proto_tree *tree)
+{
+    proto_item *ti;
+    char expected[ITEM_LABEL_LENGTH];
+
+    ti = proto_tree_add_item(tree, hf_value, tvb, 0, 1, ENC_BIG_ENDIAN);
+    proto_item_append_text(ti, ", %s", "appended");
+    proto_item_prepend_text(ti, "%d: ", 1);
+    proto_item_append_text(ti, " (%u)", 2u);
+    check_deferred(ti, "1: Value: 5, appended (2)");
+
+    /* Setting the text replaces what was there. */
+    ti = proto_tree_add_item(tree, hf_value, tvb, 0, 1, ENC_BIG_ENDIAN);
+    proto_item_append_text(ti, ", %s", "dropped");
+    proto_item_set_text(ti, "Set %s", "text");
+    proto_item_append_text(ti, " %d", 3);
+    check_deferred(ti, "Set text 3");
+
+    /* What's prepended and appended to a truncated label. */
+    ti = proto_tree_add_none_format(tree, hf_text, tvb, 0, 0, "%s", long_string);
+    proto_item_prepend_text(ti, "%s", "pre ");
+    proto_item_append_text(ti, "%s", " post");
+    g_snprintf(expected, ITEM_LABEL_LENGTH, "%s", long_string);
+    mark_truncated(expected);
+    {
+        char label[ITEM_LABEL_LENGTH];
+
+        g_strlcpy(label, expected, sizeof label);
+        g_snprintf(expected, ITEM_LABEL_LENGTH, "pre %s", label);
+    }
+    check_deferred(ti, expected);
+
+    /* Once the label has been rendered, more text is added right away. */
+    ti = proto_tree_add_uint_format_value(tree, hf_value, tvb, 0, 1, 5, "%s", "five");
+    g_assert_cmpstr(proto_item_get_rep(PITEM_FINFO(ti))->representation, ==, "Value: five");
+    proto_item_append_text(ti, " (%d)", 5);
+    check_rendered(ti, "Value: five (5)");
+    proto_item_prepend_text(ti, "%s", "The ");
+    check_rendered(ti, "The Value: five (5)");
+}
+
+/* Formats that can't be captured are rendered right away, as before. */
+static void
+test_not_captured(tvbuff_t *tvb, proto_tree *tree)
+{
+    char expected[ITEM_LABEL_LENGTH];
+
+    g_snprintf(expected, sizeof expected, "%2$s %1$s", "world", "hello");
+    check_rendered(proto_tree_add_none_format(tree, hf_text, tvb, 0, 0,
+            "%2$s %1$s", "world", "hello"), expected);
+
+    g_snprintf(expected, sizeof expected, "%Lf", (long double)1.5);
+    check_rendered(proto_tree_add_none_format(tree, hf_text, tvb, 0, 0,
+            "%Lf", (long double)1.5), expected);
+
+    /* One argument too many. */
+    g_snprintf(expected, sizeof expected, "Value: %d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d",
+            1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17);
+    check_rendered(proto_tree_add_uint_format_value(tree, hf_value, tvb, 0, 1, 5,
+            "%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d",
+            1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17), expected);
+}
+
+/*
+ * Adding items with formatted values, and adding them and then getting
+ * their labels, which costs about what adding them did before labels were
+ * rendered when they're asked for.
+ */
+static gdouble bench_added_ns, bench_rendered_ns;
+
+static void
+bench_tree(tvbuff_t *tvb, proto_tree *tree)
+{
+    GTimer *timer = g_timer_new();
+    proto_item *ti;
+    guint i;
+
+    g_timer_start(timer);
+    for (i = 0; i < BENCH_ITEMS; i++) {
+        proto_tree_add_uint_format_value(tree, hf_value, tvb, 0, 1, 5,
+                "%u (%s, 0x%08x)", i, "Some value", i);
+    }
+    bench_added_ns += g_timer_elapsed(timer, NULL) * 1e9 / BENCH_ITEMS;
+
+    g_timer_start(timer);
+    for (i = 0; i < BENCH_ITEMS; i++) {
+        ti = proto_tree_add_uint_format_value(tree, hf_value, tvb, 0, 1, 5,
+                "%u (%s, 0x%08x)", i, "Some value", i);
+        proto_item_get_rep(PITEM_FINFO(ti));
+    }
+    bench_rendered_ns += g_timer_elapsed(timer, NULL) * 1e9 / BENCH_ITEMS;
+
+    g_timer_destroy(timer);
+}
+
+static void
+label_fmt_test_bench(void)
+{
+    guint i;
+
+    bench_added_ns = bench_rendered_ns = 0;
+    for (i = 0; i < BENCH_FRAMES; i++)
+        run_in_tree(bench_tree);
+    bench_added_ns /= BENCH_FRAMES;
+    bench_rendered_ns /= BENCH_FRAMES;
+
+    g_test_minimized_result(bench_added_ns,
+            "%5.1f ns per item added, %5.1f ns per item added and rendered",
+            bench_added_ns, bench_rendered_ns);
+}
+
+static void
+label_fmt_test_set(void)
+{
+    run_in_tree(test_set);
+}
+
+static void
+label_fmt_test_set_text(void)
+{
+    run_in_tree(test_set_text);
+}
+
+static void
+label_fmt_test_set_value(void)
+{
+    run_in_tree(test_set_value);
+}
+
+static void
+label_fmt_test_append(void)
+{
+    run_in_tree(test_append);
+}
+
+static void
+label_fmt_test_prepend(void)
+{
+    run_in_tree(test_prepend);
+}
+
+static void
+label_fmt_test_combined(void)
+{
+    run_in_tree(test_combined);
+}
+
+static void
+label_fmt_test_not_captured(void)
+{
+    run_in_tree(test_not_captured);
+}
+
+static void
+register_label_fmt_test(void)
+{
+    static hf_register_info hf[] = {
+        { &hf_text,
+          { "Text", "label_fmt_test.text", FT_NONE, BASE_NONE,
+            NULL, 0x0, NULL, HFILL }},
+        { &hf_value,
+          { "Value", "label_fmt_test.value", FT_UINT8, BASE_DEC,
+            NULL, 0x0, NULL, HFILL }},
+        { &hf_bits,
+          { "Bits", "label_fmt_test.bits", FT_UINT8, BASE_DEC,
+            NULL, 0x0F, NULL, HFILL }},
+    };
+
+    proto_label_fmt_test = proto_register_protocol("Label format test", "LABEL_FMT_TEST", "label_fmt_test");
+    proto_register_field_array(proto_label_fmt_test, hf, G_N_ELEMENTS(hf));
+    dissector_add_uint("wtap_encap", WTAP_ENCAP_USER0,
+            create_dissector_handle(dissect_label_fmt_test, proto_label_fmt_test));
+}
+
+int
+main(int argc, char **argv)
+{
+    static const struct packet_provider_funcs funcs = {
+        get_frame_ts,
+        NULL,
+        NULL,
+        NULL
+    };
+    int result;
+
+    g_test_init(&argc, &argv, NULL);
+
+    memset(long_string, 'x', sizeof long_string - 1);
+    long_string[sizeof long_string - 1] = '\0';
+
+    g_test_add_func("/label_fmt/set", label_fmt_test_set);
+    g_test_add_func("/label_fmt/set_text", label_fmt_test_set_text);
+    g_test_add_func("/label_fmt/set_value", label_fmt_test_set_value);
+    g_test_add_func("/label_fmt/append", label_fmt_test_append);
+    g_test_add_func("/label_fmt/prepend", label_fmt_test_prepend);
+    g_test_add_func("/label_fmt/combined", label_fmt_test_combined);
+    g_test_add_func("/label_fmt/not_captured", label_fmt_test_not_captured);
+    if (g_test_perf())
+        g_test_add_func("/label_fmt/bench", label_fmt_test_bench);
+
+    wtap_init(FALSE);
+    if (!epan_init(NULL, NULL, FALSE))
+        return 2;
+    register_label_fmt_test();
+
+    session = epan_new(NULL, &funcs);
+    edt = epan_dissect_new(session, TRUE, TRUE);
+
+    result = g_test_run();
+
+    epan_dissect_free(edt);
+    epan_free(session);
+    epan_cleanup();
+    wtap_cleanup();
+
+    return result;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -26,6 +26,7 @@ static mmdb_lookup_t mmdb_not_found;
 #include <epan/wmem/wmem.h>
 
 #include <epan/addr_resolv.h>
+#include <epan/maxmind_db_reader.h>
 #include <epan/uat.h>
 #include <epan/prefs.h>
 
@@ -35,6 +36,11 @@ static mmdb_lookup_t mmdb_not_found;
 #include <wsutil/ws_pipe.h>
 #include <wsutil/strtoi.h>
 
+// Databases are normally read in-process by maxmind_db_reader.c, which
+// lets us answer lookups synchronously. If any database can't be read that
+// way we fall back to the mmdbresolve child process below, whose results
+// arrive asynchronously via maxmind_db_lookup_process.
+//
 // To do:
 // - Add RBL lookups? Along with the "is this a spammer" information that most RBL databases
 //   provide, you can also fetch AS information: https://www.team-cymru.com/IP-ASN-mapping.html
@@ -97,6 +103,7 @@ static uat_t *maxmind_db_paths_uat;
 UAT_DIRECTORYNAME_CB_DEF(maxmind_mod, path, maxmind_db_path_t)
 
 static GPtrArray *mmdb_file_arr; // .mmdb files
+static GPtrArray *mmdb_reader_arr; // mmdb_reader_t *, parallel to mmdb_file_arr
 
 #if 0
 #define MMDB_DEBUG(...) { \
@@ -152,6 +159,132 @@ static void init_lookup(mmdb_lookup_t *lookup) {
     *lookup = empty_lookup;
 }
 
+// Keys used by the in-process reader. These match the ones mmdbresolve
+// prints.
+static const char * const co_iso_key[]     = {"country", "iso_code", NULL};
+static const char * const co_name_key[]    = {"country", "names", "en", NULL};
+static const char * const ci_name_key[]    = {"city", "names", "en", NULL};
+static const char * const asn_o_key[]      = {"autonomous_system_organization", NULL};
+static const char * const asn_key[]        = {"autonomous_system_number", NULL};
+static const char * const l_lat_key[]      = {"location", "latitude", NULL};
+static const char * const l_lon_key[]      = {"location", "longitude", NULL};
+static const char * const l_accuracy_key[] = {"location", "accuracy_radius", NULL};
+
+static const char *chunkify_string_len(const char *str, guint32 len) {
+    char *key = g_strndup(str, len);
+    const char *chunk_string = chunkify_string(key);
+    g_free(key);
+    return chunk_string;
+}
+
+static gboolean mmdb_readers_valid(void) {
+    return mmdb_reader_arr && mmdb_reader_arr->len > 0;
+}
+
+/**
+ * Look up an address in each in-process database. As with mmdbresolve,
+ * values from later databases override earlier ones.
+ * Main thread only.
+ */
+static mmdb_lookup_t *mmdb_lookup_sync(const guint8 *addr, guint addr_bits) {
+    mmdb_lookup_t lookup;
+
+    init_lookup(&lookup);
+
+    for (guint i = 0; i < mmdb_reader_arr->len; i++) {
+        const mmdb_reader_t *reader = (const mmdb_reader_t *) g_ptr_array_index(mmdb_reader_arr, i);
+        guint32 entry;
+        const char *str;
+        guint32 str_len;
+        guint64 uint_val;
+        double dbl_val;
+
+        if (!mmdb_reader_lookup(reader, addr, addr_bits, &entry)) {
+            continue;
+        }
+
+        if (mmdb_reader_get_string(reader, entry, co_iso_key, &str, &str_len)) {
+            lookup.found = TRUE;
+            lookup.country_iso = chunkify_string_len(str, str_len);
+        }
+        if (mmdb_reader_get_string(reader, entry, co_name_key, &str, &str_len)) {
+            lookup.found = TRUE;
+            lookup.country = chunkify_string_len(str, str_len);
+        }
+        if (mmdb_reader_get_string(reader, entry, ci_name_key, &str, &str_len)) {
+            lookup.found = TRUE;
+            lookup.city = chunkify_string_len(str, str_len);
+        }
+        if (mmdb_reader_get_string(reader, entry, asn_o_key, &str, &str_len)) {
+            lookup.found = TRUE;
+            lookup.as_org = chunkify_string_len(str, str_len);
+        }
+        if (mmdb_reader_get_uint(reader, entry, asn_key, &uint_val) && uint_val <= G_MAXUINT32) {
+            lookup.found = TRUE;
+            lookup.as_number = (guint32) uint_val;
+        }
+        if (mmdb_reader_get_double(reader, entry, l_lat_key, &dbl_val)) {
+            lookup.found = TRUE;
+            lookup.latitude = dbl_val;
+        }
+        if (mmdb_reader_get_double(reader, entry, l_lon_key, &dbl_val)) {
+            lookup.found = TRUE;
+            lookup.longitude = dbl_val;
+        }
+        if (mmdb_reader_get_uint(reader, entry, l_accuracy_key, &uint_val) && uint_val <= G_MAXUINT16) {
+            lookup.found = TRUE;
+            lookup.accuracy = (guint16) uint_val;
+        }
+    }
+
+    if (!lookup.found) {
+        return &mmdb_not_found;
+    }
+
+    return (mmdb_lookup_t *) wmem_memdup(wmem_epan_scope(), &lookup, sizeof(lookup));
+}
+
+/**
+ * Close our in-process databases.
+ */
+static void mmdb_readers_close(void) {
+    if (!mmdb_reader_arr) {
+        return;
+    }
+
+    for (guint i = 0; i < mmdb_reader_arr->len; i++) {
+        mmdb_reader_close((mmdb_reader_t *) g_ptr_array_index(mmdb_reader_arr, i));
+    }
+    g_ptr_array_free(mmdb_reader_arr, TRUE);
+    mmdb_reader_arr = NULL;
+}
+
+/**
+ * Open each database in-process. Returns FALSE, with nothing opened, if
+ * any of them can't be read.
+ */
+static gboolean mmdb_readers_open(void) {
+    mmdb_readers_close();
+
+    mmdb_reader_arr = g_ptr_array_new();
+    for (guint i = 0; i < mmdb_file_arr->len; i++) {
+        const char *path = (const char *) g_ptr_array_index(mmdb_file_arr, i);
+        char *err_info = NULL;
+        mmdb_reader_t *reader = mmdb_reader_open(path, &err_info);
+
+        if (!reader) {
+            MMDB_DEBUG("can't read %s in-process: %s", path, err_info);
+            g_free(err_info);
+            mmdb_readers_close();
+            return FALSE;
+        }
+        MMDB_DEBUG("opened %s (%s)", path, mmdb_reader_database_type(reader));
+        g_ptr_array_add(mmdb_reader_arr, reader);
+    }
+
+    return TRUE;
+}
+
 static gboolean mmdbr_pipe_valid(void) {
     g_rw_lock_reader_lock(&mmdbr_pipe_mtx);
     gboolean pipe_valid = ws_pipe_valid(&mmdbr_pipe);
@@ -451,6 +584,10 @@ static void mmdb_resolve_start(void) {
         return;
     }
 
+    if (mmdb_readers_open()) {
+        return;
+    }
+
     GPtrArray *args = g_ptr_array_new();
     char *mmdbresolve = g_strdup_printf("%s%c%s", get_progfile_dir(), G_DIR_SEPARATOR, "mmdbresolve");
     g_ptr_array_add(args, mmdbresolve);
@@ -527,6 +664,7 @@ static void maxmind_db_cleanup(void) {
     guint i;
 
     mmdb_resolve_stop();
+    mmdb_readers_close();
 
     /* If we have old data, clear out the whole thing
      * and start again. TODO: Just update the ones that
@@ -604,6 +742,7 @@ maxmind_db_pref_init(module_t *nameres)
 void maxmind_db_pref_cleanup(void)
 {
     mmdb_resolve_stop();
+    mmdb_readers_close();
 }
 
 /**
@@ -656,6 +795,12 @@ maxmind_db_lookup_ipv4(const ws_in4_addr *addr) {
     mmdb_lookup_t *result = (mmdb_lookup_t *) wmem_map_lookup(mmdb_ipv4_map, GUINT_TO_POINTER(*addr));
 
     if (!result) {
+        if (mmdb_readers_valid()) {
+            result = mmdb_lookup_sync((const guint8 *) addr, 32);
+            wmem_map_insert(mmdb_ipv4_map, GUINT_TO_POINTER(*addr), result);
+            return result;
+        }
+
         result = &mmdb_not_found;
         wmem_map_insert(mmdb_ipv4_map, GUINT_TO_POINTER(*addr), result);
 
@@ -675,6 +820,12 @@ maxmind_db_lookup_ipv6(const ws_in6_addr *addr) {
     mmdb_lookup_t * result = (mmdb_lookup_t *) wmem_map_lookup(mmdb_ipv6_map, addr->bytes);
 
     if (!result) {
+        if (mmdb_readers_valid()) {
+            result = mmdb_lookup_sync(addr->bytes, 128);
+            wmem_map_insert(mmdb_ipv6_map, chunkify_v6_addr(addr), result);
+            return result;
+        }
+
         result = &mmdb_not_found;
         wmem_map_insert(mmdb_ipv6_map, chunkify_v6_addr(addr), result);
 
@@ -0,0 +1,528 @@
+/* maxmind_db_reader.c
+ * Read-only, in-process reader for MaxMind DB (.mmdb) files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/pint.h>
+
+#include "maxmind_db_reader.h"
+
+/* https://maxmind.github.io/MaxMind-DB/ */
+
+#define MMDB_METADATA_MARKER        "\xAB\xCD\xEFMaxMind.com"
+#define MMDB_METADATA_MARKER_LEN    (sizeof(MMDB_METADATA_MARKER) - 1)
+#define MMDB_METADATA_MAX_SIZE      (128 * 1024)
+#define MMDB_DATA_SECTION_SEPARATOR 16
+#define MMDB_MAX_NESTING            32
+
+/* Data field types */
+#define MMDB_TYPE_EXTENDED  0
+#define MMDB_TYPE_POINTER   1
+#define MMDB_TYPE_UTF8      2
+#define MMDB_TYPE_DOUBLE    3
+#define MMDB_TYPE_BYTES     4
+#define MMDB_TYPE_UINT16    5
+#define MMDB_TYPE_UINT32    6
+#define MMDB_TYPE_MAP       7
+#define MMDB_TYPE_INT32     8
+#define MMDB_TYPE_UINT64    9
+#define MMDB_TYPE_UINT128   10
+#define MMDB_TYPE_ARRAY     11
+#define MMDB_TYPE_CONTAINER 12
+#define MMDB_TYPE_END       13
+#define MMDB_TYPE_BOOLEAN   14
+#define MMDB_TYPE_FLOAT     15
+
+typedef struct {
+    const guint8 *p;
+    gsize len;
+} mmdb_section_t;
+
+/* A decoded field header. For pointers, size holds the target offset. */
+typedef struct {
+    guint type;
+    guint32 size;
+    gsize payload;      /* offset of the first byte after the header */
+} mmdb_field_t;
+
+struct _mmdb_reader_t {
+    GMappedFile *mapped;
+    const guint8 *tree;
+    guint32 node_count;
+    guint record_size;      /* bits per record: 24, 28 or 32 */
+    guint node_bytes;
+    guint ip_version;
+    guint32 ipv4_start_node;
+    mmdb_section_t data;
+    char *database_type;
+};
+
+static gboolean
+mmdb_read_header(const mmdb_section_t *sect, gsize off, mmdb_field_t *field)
+{
+    guint8 ctrl;
+    guint32 size;
+    guint ptr_len;
+
+    if (off >= sect->len) {
+        return FALSE;
+    }
+    ctrl = sect->p[off++];
+    field->type = ctrl >> 5;
+
+    if (field->type == MMDB_TYPE_POINTER) {
+        ptr_len = ((ctrl >> 3) & 0x3) + 1;
+        if (sect->len - off < ptr_len) {
+            return FALSE;
+        }
+        switch (ptr_len) {
+        case 1:
+            field->size = ((ctrl & 0x7) << 8) | sect->p[off];
+            break;
+        case 2:
+            field->size = (((ctrl & 0x7) << 16) | pntoh16(sect->p + off)) + 2048;
+            break;
+        case 3:
+            field->size = (((guint32)(ctrl & 0x7) << 24) | pntoh24(sect->p + off)) + 526336;
+            break;
+        default:
+            field->size = pntoh32(sect->p + off);
+            break;
+        }
+        field->payload = off + ptr_len;
+        return TRUE;
+    }
+
+    if (field->type == MMDB_TYPE_EXTENDED) {
+        if (off >= sect->len || sect->p[off] == 0) {
+            return FALSE;
+        }
+        field->type = 7 + sect->p[off++];
+    }
+
+    size = ctrl & 0x1f;
+    if (size >= 29) {
+        guint size_len = size - 28;
+        if (sect->len - off < size_len) {
+            return FALSE;
+        }
+        switch (size_len) {
+        case 1:
+            size = 29 + sect->p[off];
+            break;
+        case 2:
+            size = 285 + pntoh16(sect->p + off);
+            break;
+        default:
+            size = 65821 + pntoh24(sect->p + off);
+            break;
+        }
+        off += size_len;
+    }
+
+    field->size = size;
+    field->payload = off;
+    return TRUE;
+}
+
+/* Decode the field at off, following a pointer if there is one. */
+static gboolean
+mmdb_deref(const mmdb_section_t *sect, gsize off, mmdb_field_t *field)
+{
+    if (!mmdb_read_header(sect, off, field)) {
+        return FALSE;
+    }
+    if (field->type == MMDB_TYPE_POINTER) {
+        /* Pointers to pointers are not allowed by the spec. */
+        if (!mmdb_read_header(sect, field->size, field) || field->type == MMDB_TYPE_POINTER) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* Return the offset just past the field at off. Pointed-to data is not
+ * part of the field. */
+static gboolean
+mmdb_skip(const mmdb_section_t *sect, gsize off, gsize *next, guint depth)
+{
+    mmdb_field_t field;
+    guint64 count, i;
+    gsize cur;
+
+    if (depth > MMDB_MAX_NESTING || !mmdb_read_header(sect, off, &field)) {
+        return FALSE;
+    }
+
+    switch (field.type) {
+    case MMDB_TYPE_POINTER:
+    case MMDB_TYPE_BOOLEAN:
+        *next = field.payload;
+        return TRUE;
+    case MMDB_TYPE_UTF8:
+    case MMDB_TYPE_DOUBLE:
+    case MMDB_TYPE_BYTES:
+    case MMDB_TYPE_UINT16:
+    case MMDB_TYPE_UINT32:
+    case MMDB_TYPE_INT32:
+    case MMDB_TYPE_UINT64:
+    case MMDB_TYPE_UINT128:
+    case MMDB_TYPE_FLOAT:
+        if (sect->len - field.payload < field.size) {
+            return FALSE;
+        }
+        *next = field.payload + field.size;
+        return TRUE;
+    case MMDB_TYPE_MAP:
+    case MMDB_TYPE_ARRAY:
+        count = field.type == MMDB_TYPE_MAP ? (guint64)field.size * 2 : field.size;
+        cur = field.payload;
+        for (i = 0; i < count; i++) {
+            if (!mmdb_skip(sect, cur, &cur, depth + 1)) {
+                return FALSE;
+            }
+        }
+        *next = cur;
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+/* Follow a NULL-terminated list of map keys starting at the field at off. */
+static gboolean
+mmdb_get_path(const mmdb_section_t *sect, gsize off, const char * const *path,
+        mmdb_field_t *field)
+{
+    for (; *path; path++) {
+        size_t key_len = strlen(*path);
+        gsize cur;
+        guint32 i;
+        gboolean found = FALSE;
+
+        if (!mmdb_deref(sect, off, field) || field->type != MMDB_TYPE_MAP) {
+            return FALSE;
+        }
+
+        cur = field->payload;
+        for (i = 0; i < field->size; i++) {
+            mmdb_field_t key;
+            gsize value_off;
+
+            if (!mmdb_deref(sect, cur, &key) || key.type != MMDB_TYPE_UTF8 ||
+                    sect->len - key.payload < key.size ||
+                    !mmdb_skip(sect, cur, &value_off, 0)) {
+                return FALSE;
+            }
+            if (key.size == key_len && memcmp(sect->p + key.payload, *path, key_len) == 0) {
+                off = value_off;
+                found = TRUE;
+                break;
+            }
+            if (!mmdb_skip(sect, value_off, &cur, 0)) {
+                return FALSE;
+            }
+        }
+        if (!found) {
+            return FALSE;
+        }
+    }
+
+    return mmdb_deref(sect, off, field);
+}
+
+static gboolean
+mmdb_field_to_uint(const mmdb_section_t *sect, const mmdb_field_t *field, guint64 *val)
+{
+    guint32 i;
+
+    switch (field->type) {
+    case MMDB_TYPE_UINT16:
+        if (field->size > 2) {
+            return FALSE;
+        }
+        break;
+    case MMDB_TYPE_UINT32:
+    case MMDB_TYPE_INT32:
+        if (field->size > 4) {
+            return FALSE;
+        }
+        break;
+    case MMDB_TYPE_UINT64:
+        if (field->size > 8) {
+            return FALSE;
+        }
+        break;
+    default:
+        return FALSE;
+    }
+    if (sect->len - field->payload < field->size) {
+        return FALSE;
+    }
+
+    /* A 4 byte int32 with the top bit set is negative (shorter ones are
+     * positive), and has no unsigned value. */
+    if (field->type == MMDB_TYPE_INT32 && field->size == 4 &&
+            (sect->p[field->payload] & 0x80)) {
+        return FALSE;
+    }
+
+    *val = 0;
+    for (i = 0; i < field->size; i++) {
+        *val = (*val << 8) | sect->p[field->payload + i];
+    }
+    return TRUE;
+}
+
+static gboolean
+mmdb_field_to_double(const mmdb_section_t *sect, const mmdb_field_t *field, double *val)
+{
+    if (sect->len - field->payload < field->size) {
+        return FALSE;
+    }
+
+    if (field->type == MMDB_TYPE_DOUBLE && field->size == 8) {
+        guint64 bits = pntoh64(sect->p + field->payload);
+        memcpy(val, &bits, sizeof(*val));
+        return TRUE;
+    }
+    if (field->type == MMDB_TYPE_FLOAT && field->size == 4) {
+        guint32 bits = pntoh32(sect->p + field->payload);
+        float fval;
+        memcpy(&fval, &bits, sizeof(fval));
+        *val = fval;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static guint32
+mmdb_read_record(const mmdb_reader_t *reader, guint32 node, guint bit)
+{
+    const guint8 *p = reader->tree + (gsize)node * reader->node_bytes;
+
+    switch (reader->record_size) {
+    case 24:
+        return pntoh24(p + bit * 3);
+    case 28:
+        if (bit == 0) {
+            return ((guint32)(p[3] & 0xF0) << 20) | pntoh24(p);
+        }
+        return ((guint32)(p[3] & 0x0F) << 24) | pntoh24(p + 4);
+    default:
+        return pntoh32(p + bit * 4);
+    }
+}
+
+mmdb_reader_t *
+mmdb_reader_open(const char *path, char **err_info)
+{
+    static const char * const node_count_key[] = { "node_count", NULL };
+    static const char * const record_size_key[] = { "record_size", NULL };
+    static const char * const ip_version_key[] = { "ip_version", NULL };
+    static const char * const database_type_key[] = { "database_type", NULL };
+    GMappedFile *mapped;
+    GError *err = NULL;
+    const guint8 *base;
+    gsize size, search_start, off;
+    gsize tree_size;
+    mmdb_section_t meta;
+    mmdb_field_t field;
+    guint64 node_count, record_size, ip_version;
+    mmdb_reader_t *reader;
+    guint32 node;
+    guint i;
+
+    mapped = g_mapped_file_new(path, FALSE, &err);
+    if (!mapped) {
+        if (err_info) {
+            *err_info = g_strdup(err->message);
+        }
+        g_error_free(err);
+        return NULL;
+    }
+
+    base = (const guint8 *)g_mapped_file_get_contents(mapped);
+    size = g_mapped_file_get_length(mapped);
+
+    /* The metadata follows the last marker in the file. */
+    meta.p = NULL;
+    meta.len = 0;
+    search_start = size > MMDB_METADATA_MAX_SIZE ? size - MMDB_METADATA_MAX_SIZE : 0;
+    for (off = size >= MMDB_METADATA_MARKER_LEN ? size - MMDB_METADATA_MARKER_LEN + 1 : 0;
+            off > search_start; off--) {
+        if (memcmp(base + off - 1, MMDB_METADATA_MARKER, MMDB_METADATA_MARKER_LEN) == 0) {
+            meta.p = base + off - 1 + MMDB_METADATA_MARKER_LEN;
+            meta.len = size - (off - 1 + MMDB_METADATA_MARKER_LEN);
+            break;
+        }
+    }
+    if (!meta.p) {
+        if (err_info) {
+            *err_info = g_strdup("metadata not found");
+        }
+        g_mapped_file_unref(mapped);
+        return NULL;
+    }
+
+    if (!mmdb_get_path(&meta, 0, node_count_key, &field) || !mmdb_field_to_uint(&meta, &field, &node_count) ||
+            !mmdb_get_path(&meta, 0, record_size_key, &field) || !mmdb_field_to_uint(&meta, &field, &record_size) ||
+            !mmdb_get_path(&meta, 0, ip_version_key, &field) || !mmdb_field_to_uint(&meta, &field, &ip_version) ||
+            (record_size != 24 && record_size != 28 && record_size != 32) ||
+            (ip_version != 4 && ip_version != 6) ||
+            node_count == 0 || node_count > G_MAXUINT32) {
+        if (err_info) {
+            *err_info = g_strdup("invalid metadata");
+        }
+        g_mapped_file_unref(mapped);
+        return NULL;
+    }
+
+    tree_size = (gsize)node_count * (gsize)(record_size / 4);
+    if (tree_size / (record_size / 4) != node_count ||
+            tree_size + MMDB_DATA_SECTION_SEPARATOR > (gsize)(meta.p - MMDB_METADATA_MARKER_LEN - base)) {
+        if (err_info) {
+            *err_info = g_strdup("search tree is larger than the file");
+        }
+        g_mapped_file_unref(mapped);
+        return NULL;
+    }
+
+    reader = g_new0(mmdb_reader_t, 1);
+    reader->mapped = mapped;
+    reader->tree = base;
+    reader->node_count = (guint32)node_count;
+    reader->record_size = (guint)record_size;
+    reader->node_bytes = (guint)record_size / 4;
+    reader->ip_version = (guint)ip_version;
+    reader->data.p = base + tree_size + MMDB_DATA_SECTION_SEPARATOR;
+    reader->data.len = (gsize)(meta.p - MMDB_METADATA_MARKER_LEN - reader->data.p);
+
+    if (mmdb_get_path(&meta, 0, database_type_key, &field) && field.type == MMDB_TYPE_UTF8 &&
+            meta.len - field.payload >= field.size) {
+        reader->database_type = g_strndup((const char *)meta.p + field.payload, field.size);
+    } else {
+        reader->database_type = g_strdup("");
+    }
+
+    /* IPv4 addresses live under ::/96 in IPv6 databases. */
+    node = 0;
+    if (reader->ip_version == 6) {
+        for (i = 0; i < 96 && node < reader->node_count; i++) {
+            node = mmdb_read_record(reader, node, 0);
+        }
+    }
+    reader->ipv4_start_node = node;
+
+    return reader;
+}
+
+void
+mmdb_reader_close(mmdb_reader_t *reader)
+{
+    if (!reader) {
+        return;
+    }
+    g_mapped_file_unref(reader->mapped);
+    g_free(reader->database_type);
+    g_free(reader);
+}
+
+const char *
+mmdb_reader_database_type(const mmdb_reader_t *reader)
+{
+    return reader->database_type;
+}
+
+gboolean
+mmdb_reader_lookup(const mmdb_reader_t *reader, const guint8 *addr,
+        guint addr_bits, guint32 *entry)
+{
+    guint32 node;
+    guint i;
+
+    if (addr_bits == 32) {
+        node = reader->ipv4_start_node;
+    } else if (reader->ip_version == 6) {
+        node = 0;
+    } else {
+        return FALSE;
+    }
+
+    for (i = 0; i < addr_bits && node < reader->node_count; i++) {
+        node = mmdb_read_record(reader, node, (addr[i >> 3] >> (7 - (i & 7))) & 1);
+    }
+
+    if (node <= reader->node_count) {
+        /* Either empty or a malformed tree that is deeper than the address. */
+        return FALSE;
+    }
+
+    node -= reader->node_count;
+    if (node < MMDB_DATA_SECTION_SEPARATOR || node - MMDB_DATA_SECTION_SEPARATOR >= reader->data.len) {
+        return FALSE;
+    }
+
+    *entry = node - MMDB_DATA_SECTION_SEPARATOR;
+    return TRUE;
+}
+
+gboolean
+mmdb_reader_get_string(const mmdb_reader_t *reader, guint32 entry,
+        const char * const *path, const char **str, guint32 *len)
+{
+    mmdb_field_t field;
+
+    if (!mmdb_get_path(&reader->data, entry, path, &field) || field.type != MMDB_TYPE_UTF8 ||
+            reader->data.len - field.payload < field.size) {
+        return FALSE;
+    }
+
+    *str = (const char *)reader->data.p + field.payload;
+    *len = field.size;
+    return TRUE;
+}
+
+gboolean
+mmdb_reader_get_uint(const mmdb_reader_t *reader, guint32 entry,
+        const char * const *path, guint64 *val)
+{
+    mmdb_field_t field;
+
+    return mmdb_get_path(&reader->data, entry, path, &field) &&
+        mmdb_field_to_uint(&reader->data, &field, val);
+}
+
+gboolean
+mmdb_reader_get_double(const mmdb_reader_t *reader, guint32 entry,
+        const char * const *path, double *val)
+{
+    mmdb_field_t field;
+
+    return mmdb_get_path(&reader->data, entry, path, &field) &&
+        mmdb_field_to_double(&reader->data, &field, val);
+}
+
+/*
+ * Editor modelines
+ *
+ * Local Variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * ex: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
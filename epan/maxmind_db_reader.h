@@ -0,0 +1,93 @@
+/* maxmind_db_reader.h
+ * Read-only, in-process reader for MaxMind DB (.mmdb) files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __MAXMIND_DB_READER_H__
+#define __MAXMIND_DB_READER_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * This is an independent implementation of the MaxMind DB file format
+ * specification (https://maxmind.github.io/MaxMind-DB/). It does not use
+ * libmaxminddb, whose license does not allow it to be linked into
+ * libwireshark; mmdbresolve is still used if a database can't be read here.
+ *
+ * The database is mapped read-only and never modified, so lookups can be
+ * made from any thread once the reader has been opened.
+ */
+
+typedef struct _mmdb_reader_t mmdb_reader_t;
+
+/**
+ * Map a database file and validate its metadata.
+ *
+ * @param path Path to the .mmdb file.
+ * @param err_info Set to a g_malloc'ed error message on failure. May be NULL.
+ * @return A new reader, or NULL on failure.
+ */
+mmdb_reader_t *mmdb_reader_open(const char *path, char **err_info);
+
+/** Unmap the database and free the reader. */
+void mmdb_reader_close(mmdb_reader_t *reader);
+
+/** The "database_type" metadata value, e.g. "GeoLite2-City". */
+const char *mmdb_reader_database_type(const mmdb_reader_t *reader);
+
+/**
+ * Find the data record for an address.
+ *
+ * @param reader The database.
+ * @param addr The address in network byte order.
+ * @param addr_bits 32 for IPv4 or 128 for IPv6.
+ * @param entry Set to the offset of the record in the data section.
+ * @return TRUE if the database has a record for the address.
+ */
+gboolean mmdb_reader_lookup(const mmdb_reader_t *reader, const guint8 *addr,
+        guint addr_bits, guint32 *entry);
+
+/**
+ * Fetch a string from a record by following a NULL-terminated path of map
+ * keys, e.g. { "country", "iso_code", NULL }. The string points into the
+ * mapped file and is not NUL-terminated.
+ */
+gboolean mmdb_reader_get_string(const mmdb_reader_t *reader, guint32 entry,
+        const char * const *path, const char **str, guint32 *len);
+
+/** Fetch an unsigned integer value from a record. Signed (int32) values
+ * are accepted if they aren't negative. */
+gboolean mmdb_reader_get_uint(const mmdb_reader_t *reader, guint32 entry,
+        const char * const *path, guint64 *val);
+
+/** Fetch a double or float value from a record. */
+gboolean mmdb_reader_get_double(const mmdb_reader_t *reader, guint32 entry,
+        const char * const *path, double *val);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __MAXMIND_DB_READER_H__ */
+
+/*
+ * Editor modelines
+ *
+ * Local Variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * ex: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
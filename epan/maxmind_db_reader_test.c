@@ -0,0 +1,238 @@
+/* maxmind_db_reader_test.c
+ * Tests of the MaxMind DB reader
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * Run with the path of test/maxmind/wireshark-test.mmdb, which is written
+ * by test/maxmind/make-test-mmdb.py.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <wsutil/file_util.h>
+#include <wsutil/inet_addr.h>
+
+#include "maxmind_db_reader.h"
+
+static const char *mmdb_path;
+
+static const char * const country_key[] = { "country", "iso_code", NULL };
+static const char * const city_key[] = { "city", "names", "en", NULL };
+static const char * const latitude_key[] = { "location", "latitude", NULL };
+static const char * const longitude_key[] = { "location", "longitude", NULL };
+static const char * const accuracy_key[] = { "location", "accuracy_radius", NULL };
+static const char * const asn_key[] = { "autonomous_system_number", NULL };
+static const char * const org_key[] = { "autonomous_system_organization", NULL };
+static const char * const negative_key[] = { "test_negative", NULL };
+static const char * const positive_key[] = { "test_positive", NULL };
+static const char * const missing_key[] = { "city", "names", "de", NULL };
+
+static mmdb_reader_t *
+open_test_db(void)
+{
+    char *err_info = NULL;
+    mmdb_reader_t *reader = mmdb_reader_open(mmdb_path, &err_info);
+
+    g_assert_null(err_info);
+    g_assert_nonnull(reader);
+    return reader;
+}
+
+static gboolean
+lookup(const mmdb_reader_t *reader, const char *addr_str, guint32 *entry)
+{
+    ws_in4_addr addr4;
+    ws_in6_addr addr6;
+
+    if (strchr(addr_str, ':')) {
+        g_assert(ws_inet_pton6(addr_str, &addr6));
+        return mmdb_reader_lookup(reader, addr6.bytes, 128, entry);
+    }
+    g_assert(ws_inet_pton4(addr_str, &addr4));
+    return mmdb_reader_lookup(reader, (const guint8 *)&addr4, 32, entry);
+}
+
+static void
+assert_string(const mmdb_reader_t *reader, guint32 entry,
+        const char * const *path, const char *expected)
+{
+    const char *str;
+    guint32 len;
+
+    g_assert(mmdb_reader_get_string(reader, entry, path, &str, &len));
+    g_assert_cmpuint(len, ==, strlen(expected));
+    g_assert(memcmp(str, expected, len) == 0);
+}
+
+static void
+maxmind_db_reader_test_metadata(void)
+{
+    mmdb_reader_t *reader = open_test_db();
+
+    g_assert_cmpstr(mmdb_reader_database_type(reader), ==, "Wireshark-Test");
+    mmdb_reader_close(reader);
+}
+
+static void
+maxmind_db_reader_test_ipv4(void)
+{
+    mmdb_reader_t *reader = open_test_db();
+    guint32 entry;
+    guint64 uint_val;
+    double double_val;
+
+    g_assert(lookup(reader, "192.0.2.55", &entry));
+    assert_string(reader, entry, city_key, "Testville");
+    /* The country is a pointer to a map shared with other records. */
+    assert_string(reader, entry, country_key, "US");
+    assert_string(reader, entry, org_key, "Example AS");
+
+    g_assert(mmdb_reader_get_uint(reader, entry, asn_key, &uint_val));
+    g_assert_cmpuint(uint_val, ==, 64496);
+    g_assert(mmdb_reader_get_uint(reader, entry, accuracy_key, &uint_val));
+    g_assert_cmpuint(uint_val, ==, 20);
+    g_assert(mmdb_reader_get_double(reader, entry, latitude_key, &double_val));
+    g_assert_cmpfloat(double_val, ==, 37.5);
+    g_assert(mmdb_reader_get_double(reader, entry, longitude_key, &double_val));
+    g_assert_cmpfloat(double_val, ==, -122.25);
+
+    /* Wrong types and missing keys. */
+    g_assert(!mmdb_reader_get_uint(reader, entry, city_key, &uint_val));
+    g_assert(!mmdb_reader_get_double(reader, entry, asn_key, &double_val));
+    g_assert(!mmdb_reader_get_string(reader, entry, missing_key, NULL, NULL));
+
+    g_assert(lookup(reader, "198.51.100.1", &entry));
+    assert_string(reader, entry, city_key, "Pointerville");
+    assert_string(reader, entry, country_key, "US");
+    g_assert(!mmdb_reader_get_double(reader, entry, latitude_key, &double_val));
+
+    /* Just outside the networks in the database. */
+    g_assert(!lookup(reader, "198.51.100.128", &entry));
+    g_assert(!lookup(reader, "192.0.3.0", &entry));
+    g_assert(!lookup(reader, "10.0.0.1", &entry));
+
+    mmdb_reader_close(reader);
+}
+
+static void
+maxmind_db_reader_test_ipv6(void)
+{
+    mmdb_reader_t *reader = open_test_db();
+    guint32 entry;
+    double double_val;
+
+    g_assert(lookup(reader, "2001:db8::1", &entry));
+    assert_string(reader, entry, country_key, "DE");
+    /* A float. */
+    g_assert(mmdb_reader_get_double(reader, entry, latitude_key, &double_val));
+    g_assert_cmpfloat(double_val, ==, 52.5);
+    g_assert(mmdb_reader_get_double(reader, entry, longitude_key, &double_val));
+    g_assert_cmpfloat(double_val, ==, 13.375);
+
+    g_assert(lookup(reader, "2001:db8:ffff:ffff::1", &entry));
+    g_assert(!lookup(reader, "2001:db9::1", &entry));
+    g_assert(!lookup(reader, "::1", &entry));
+
+    /* IPv4 networks are under ::/96. */
+    g_assert(lookup(reader, "::192.0.2.1", &entry));
+    assert_string(reader, entry, city_key, "Testville");
+
+    mmdb_reader_close(reader);
+}
+
+static void
+maxmind_db_reader_test_int32(void)
+{
+    mmdb_reader_t *reader = open_test_db();
+    guint32 entry;
+    guint64 uint_val;
+
+    g_assert(lookup(reader, "192.0.2.1", &entry));
+    g_assert(mmdb_reader_get_uint(reader, entry, positive_key, &uint_val));
+    g_assert_cmpuint(uint_val, ==, 7);
+    /* Negative values aren't turned into huge unsigned ones. */
+    g_assert(!mmdb_reader_get_uint(reader, entry, negative_key, &uint_val));
+
+    mmdb_reader_close(reader);
+}
+
+static void
+maxmind_db_reader_test_bad_files(void)
+{
+    char *err_info = NULL;
+    char *path;
+    gchar *contents;
+    gsize len;
+    int fd;
+
+    g_assert_null(mmdb_reader_open("/nonexistent/wireshark-test.mmdb", &err_info));
+    g_assert_nonnull(err_info);
+    g_free(err_info);
+    err_info = NULL;
+
+    fd = g_file_open_tmp("mmdb_test_XXXXXX", &path, NULL);
+    g_assert(fd >= 0);
+    ws_close(fd);
+
+    /* Not a database at all. */
+    g_assert(g_file_set_contents(path, "not a MaxMind DB", -1, NULL));
+    g_assert_null(mmdb_reader_open(path, &err_info));
+    g_assert_cmpstr(err_info, ==, "metadata not found");
+    g_free(err_info);
+    err_info = NULL;
+
+    /* The search tree is cut off, the metadata claims more nodes than
+     * there is room for. */
+    g_assert(g_file_get_contents(mmdb_path, &contents, &len, NULL));
+    g_assert(g_file_set_contents(path, contents + 512, len - 512, NULL));
+    g_assert_null(mmdb_reader_open(path, &err_info));
+    g_assert_cmpstr(err_info, ==, "search tree is larger than the file");
+    g_free(err_info);
+
+    g_free(contents);
+    g_unlink(path);
+    g_free(path);
+}
+
+int
+main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    if (argc < 2) {
+        g_printerr("Usage: %s <path to wireshark-test.mmdb>\n", argv[0]);
+        return 1;
+    }
+    mmdb_path = argv[1];
+
+    g_test_add_func("/maxmind_db_reader/metadata", maxmind_db_reader_test_metadata);
+    g_test_add_func("/maxmind_db_reader/ipv4", maxmind_db_reader_test_ipv4);
+    g_test_add_func("/maxmind_db_reader/ipv6", maxmind_db_reader_test_ipv6);
+    g_test_add_func("/maxmind_db_reader/int32", maxmind_db_reader_test_int32);
+    g_test_add_func("/maxmind_db_reader/bad_files", maxmind_db_reader_test_bad_files);
+
+    return g_test_run();
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
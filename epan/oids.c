@@ -13,9 +13,11 @@
 #include "config.h"
 
 #include <glib.h>
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <wsutil/file_util.h>
 #include <wsutil/report_message.h>
 
 #include "wmem/wmem.h"
@@ -34,6 +36,7 @@ static gboolean smi_init_done = FALSE;
 static gboolean oids_init_done = FALSE;
 static gboolean load_smi_modules = FALSE;
 static gboolean suppress_smi_errors = FALSE;
+static gboolean use_mib_cache = TRUE;
 #endif
 
 #define D(level,args) do if (debuglevel >= level) { ws_debug_printf args; ws_debug_printf("\n"); fflush(stdout); } while(0)
@@ -515,6 +518,537 @@ static void restart_needed_warning(void) {
 		report_failure("Wireshark needs to be restarted for these changes to take effect");
 }
 
+/*
+ * Add a node of a module to the OID tree, and the fields for its value and
+ * its index to hfa. Takes over blurb and enums (a value_string array).
+ */
+static void add_mib_node(wmem_array_t* hfa, const char* name, oid_kind_t kind,
+			 const oid_value_type_t* typedata, oid_key_t* key,
+			 guint oidlen, guint32* oid, char* blurb, GArray* enums) {
+	oid_info_t* oid_data = add_oid(name, kind, typedata, key, oidlen, oid);
+	char *sub;
+	guint i;
+
+	sub = oid_subid2string(NULL, oid, oidlen);
+	D(4,("\t\tNode: kind=%d oid=%s name=%s ",
+		 oid_data->kind, sub, oid_data->name));
+	wmem_free(NULL, sub);
+
+	if ( typedata && oid_data->value_hfid == -2 ) {
+		hf_register_info hf;
+		char *hf_name;
+
+		hf_name = g_strdup(oid_data->name);
+		/* Don't allow duplicate blurb/name */
+		if (blurb && strcmp(blurb, hf_name) == 0) {
+			g_free(blurb);
+			blurb = NULL;
+		}
+
+		hf.p_id                     = &(oid_data->value_hfid);
+		hf.hfinfo.name              = hf_name;
+		hf.hfinfo.abbrev            = alnumerize(oid_data->name);
+		hf.hfinfo.type              = typedata->ft_type;
+		hf.hfinfo.display           = typedata->display;
+		hf.hfinfo.strings           = NULL;
+		hf.hfinfo.bitmask           = 0;
+		hf.hfinfo.blurb             = blurb;
+		/* HFILL */
+		HFILL_INIT(hf);
+
+		oid_data->value_hfid = -1;
+
+		if ( IS_ENUMABLE(hf.hfinfo.type) && enums ) {
+			hf.hfinfo.strings = g_array_free(enums, FALSE);
+			enums = NULL;
+		}
+
+		wmem_array_append_one(hfa,hf);
+	} else {
+		g_free(blurb);
+	}
+
+	if (enums) {
+		for (i = 0; i < enums->len; i++)
+			g_free((char*)g_array_index(enums, value_string, i).strptr);
+		g_array_free(enums, TRUE);
+	}
+
+	if ((key = oid_data->key)) {
+		for(; key; key = key->next) {
+			D(5,("\t\t\tIndex: name=%s subids=%u key_type=%d",
+				 key->name, key->num_subids, key->key_type ));
+
+			if (key->hfid == -2) {
+				hf_register_info hf;
+
+				hf.p_id                     = &(key->hfid);
+				hf.hfinfo.name              = key->name;
+				hf.hfinfo.abbrev            = alnumerize(key->name);
+				hf.hfinfo.type              = key->ft_type;
+				hf.hfinfo.display           = key->display;
+				hf.hfinfo.strings           = NULL;
+				hf.hfinfo.bitmask           = 0;
+				hf.hfinfo.blurb             = NULL;
+				/* HFILL */
+				HFILL_INIT(hf);
+
+				wmem_array_append_one(hfa,hf);
+				key->hfid = -1;
+			}
+		}
+	}
+}
+
+/*
+ * Loading the modules through libsmi is slow, so the nodes that
+ * register_mibs() gets out of them are saved in a cache file, and are
+ * taken from there on the next start as long as the modules, the files
+ * they were loaded from and the versions of Wireshark and libsmi are
+ * the same. A module added to a directory in the SMI path could be
+ * found before the one that was loaded, so the directories mustn't have
+ * changed either. Everything is in host byte order:
+ *
+ *   MIB_CACHE_MAGIC, guint32 MIB_CACHE_VERSION, signature (string),
+ *   SHA-256 of the rest of the file (string),
+ *   guint32 number of directories, per directory:
+ *     path (string), gint64 mtime (-1 if it isn't there),
+ *   guint32 number of files, per file:
+ *     path (string), gint64 size, gint64 mtime, SHA-256 (string),
+ *   guint32 number of nodes, per node:
+ *     guint32 kind, gint32 type (index in mib_types, -1 for none),
+ *     guint32 number of subids, the subids, name (string), blurb (string),
+ *     guint32 number of enum values, per value: gint32 value, name (string),
+ *     guint32 number of keys, per key: name (string), guint32 num_subids,
+ *     guint32 key_type, guint32 ft_type, gint32 display
+ *
+ * A string is a guint32 length followed by that many bytes, or
+ * G_MAXUINT32 for NULL.
+ */
+#define MIB_CACHE_NAME "smi_cache"
+#define MIB_CACHE_MAGIC "WSMIBC\r\n"
+#define MIB_CACHE_MAGIC_LEN 8
+#define MIB_CACHE_VERSION 2
+
+/* The types get_typedata() can return, as saved in the cache. */
+static const oid_value_type_t* const mib_types[] = {
+	&integer_type, &bytes_type, &oid_type, &ipv4_type, &counter32_type,
+	&unsigned32_type, &timeticks_type, &nsap_type, &counter64_type,
+	&ipv6_type, &float_type, &double_type, &ether_type, &string_type,
+	&date_and_time_type, &unknown_type
+};
+
+typedef struct _mib_cache_t {
+	GByteArray* dirs;
+	guint32 num_dirs;
+	GByteArray* files;
+	guint32 num_files;
+	GByteArray* nodes;
+	guint32 num_nodes;
+} mib_cache_t;
+
+typedef struct _mib_cache_reader_t {
+	const guint8* p;
+	const guint8* end;
+	gboolean ok;
+} mib_cache_reader_t;
+
+static void mib_cache_put_uint(GByteArray* buf, guint32 val) {
+	g_byte_array_append(buf, (const guint8*)&val, sizeof val);
+}
+
+static void mib_cache_put_int64(GByteArray* buf, gint64 val) {
+	g_byte_array_append(buf, (const guint8*)&val, sizeof val);
+}
+
+static void mib_cache_put_string(GByteArray* buf, const char* str) {
+	if (!str) {
+		mib_cache_put_uint(buf, G_MAXUINT32);
+		return;
+	}
+	mib_cache_put_uint(buf, (guint32)strlen(str));
+	g_byte_array_append(buf, (const guint8*)str, (guint)strlen(str));
+}
+
+static const guint8* mib_cache_get_bytes(mib_cache_reader_t* r, gsize len) {
+	const guint8* p = r->p;
+
+	if (!r->ok || (gsize)(r->end - r->p) < len) {
+		r->ok = FALSE;
+		return NULL;
+	}
+	r->p += len;
+	return p;
+}
+
+static guint32 mib_cache_get_uint(mib_cache_reader_t* r) {
+	const guint8* p = mib_cache_get_bytes(r, sizeof(guint32));
+	guint32 val = 0;
+
+	if (p) memcpy(&val, p, sizeof val);
+	return val;
+}
+
+static gint64 mib_cache_get_int64(mib_cache_reader_t* r) {
+	const guint8* p = mib_cache_get_bytes(r, sizeof(gint64));
+	gint64 val = 0;
+
+	if (p) memcpy(&val, p, sizeof val);
+	return val;
+}
+
+/* Returns a g_malloc()ed string, or NULL. */
+static char* mib_cache_get_string(mib_cache_reader_t* r) {
+	guint32 len = mib_cache_get_uint(r);
+	const guint8* p;
+
+	if (len == G_MAXUINT32) return NULL;
+	p = mib_cache_get_bytes(r, len);
+	return p ? g_strndup((const char*)p, len) : NULL;
+}
+
+static gchar* mib_cache_signature(const char* path_str) {
+	GString* sig = g_string_new(VERSION " " SMI_VERSION_STRING "\n");
+	guint i;
+
+	g_string_append_printf(sig, "%s\n", path_str);
+	for (i = 0; i < num_smi_modules; i++) {
+		if (smi_modules[i].name)
+			g_string_append_printf(sig, "%s\n", smi_modules[i].name);
+	}
+	return g_string_free(sig, FALSE);
+}
+
+static gchar* mib_file_hash(const char* path) {
+	gchar* contents;
+	gsize len;
+	gchar* hash;
+
+	if (!g_file_get_contents(path, &contents, &len, NULL))
+		return NULL;
+	hash = g_compute_checksum_for_data(G_CHECKSUM_SHA256, (const guchar*)contents, len);
+	g_free(contents);
+	return hash;
+}
+
+static gint64 mib_dir_mtime(const char* path) {
+	ws_statb64 st;
+
+	if (ws_stat64(path, &st) != 0 || !S_ISDIR(st.st_mode))
+		return -1;
+	return (gint64)st.st_mtime;
+}
+
+/* Record the directories in the SMI path as they are before the modules
+ * are looked for in them. */
+static void mib_cache_add_dirs(mib_cache_t* cache, const char* path_str) {
+	gchar** dirs = g_strsplit(path_str, G_SEARCHPATH_SEPARATOR_S, -1);
+	guint i;
+
+	for (i = 0; dirs[i]; i++) {
+		if (!*dirs[i])
+			continue;
+		mib_cache_put_string(cache->dirs, dirs[i]);
+		mib_cache_put_int64(cache->dirs, mib_dir_mtime(dirs[i]));
+		cache->num_dirs++;
+	}
+	g_strfreev(dirs);
+}
+
+static void mib_cache_add_file(mib_cache_t* cache, const char* path) {
+	ws_statb64 st;
+	gchar* hash;
+
+	if (ws_stat64(path, &st) != 0 || !(hash = mib_file_hash(path))) {
+		/* We couldn't check it next time. */
+		g_byte_array_free(cache->files, TRUE);
+		cache->files = NULL;
+		return;
+	}
+	mib_cache_put_string(cache->files, path);
+	mib_cache_put_int64(cache->files, (gint64)st.st_size);
+	mib_cache_put_int64(cache->files, (gint64)st.st_mtime);
+	mib_cache_put_string(cache->files, hash);
+	cache->num_files++;
+	g_free(hash);
+}
+
+static void mib_cache_add_node(mib_cache_t* cache, const char* name, oid_kind_t kind,
+			       const oid_value_type_t* typedata, oid_key_t* key,
+			       guint oidlen, guint32* oid, const char* blurb, GArray* enums) {
+	GByteArray* buf = cache->nodes;
+	gint32 type = -1;
+	guint32 num_keys = 0;
+	guint i;
+	oid_key_t* k;
+
+	for (i = 0; i < G_N_ELEMENTS(mib_types); i++) {
+		if (mib_types[i] == typedata) {
+			type = i;
+			break;
+		}
+	}
+	mib_cache_put_uint(buf, kind);
+	mib_cache_put_uint(buf, (guint32)type);
+	mib_cache_put_uint(buf, oidlen);
+	g_byte_array_append(buf, (const guint8*)oid, oidlen * (guint)sizeof(guint32));
+	mib_cache_put_string(buf, name);
+	mib_cache_put_string(buf, blurb);
+
+	mib_cache_put_uint(buf, enums ? enums->len : 0);
+	for (i = 0; enums && i < enums->len; i++) {
+		value_string* val = &g_array_index(enums, value_string, i);
+		mib_cache_put_uint(buf, val->value);
+		mib_cache_put_string(buf, val->strptr);
+	}
+
+	for (k = key; k; k = k->next) num_keys++;
+	mib_cache_put_uint(buf, num_keys);
+	for (k = key; k; k = k->next) {
+		mib_cache_put_string(buf, k->name);
+		mib_cache_put_uint(buf, k->num_subids);
+		mib_cache_put_uint(buf, k->key_type);
+		mib_cache_put_uint(buf, k->ft_type);
+		mib_cache_put_uint(buf, (guint32)k->display);
+	}
+	cache->num_nodes++;
+}
+
+static void mib_cache_write(mib_cache_t* cache, const char* path_str) {
+	GByteArray* body = g_byte_array_new();
+	gchar *pf_dir_path = NULL;
+	gchar *cache_path, *tmp_path, *sig, *hash;
+	guint32 version = MIB_CACHE_VERSION;
+	FILE* fh;
+	gboolean ok;
+
+	if (create_persconffile_dir(&pf_dir_path) == -1) {
+		D(1,("Can't create directory for the SMI cache %s: %s", pf_dir_path, g_strerror(errno)));
+		g_free(pf_dir_path);
+		g_byte_array_free(body, TRUE);
+		return;
+	}
+
+	mib_cache_put_uint(body, cache->num_dirs);
+	g_byte_array_append(body, cache->dirs->data, cache->dirs->len);
+	mib_cache_put_uint(body, cache->num_files);
+	g_byte_array_append(body, cache->files->data, cache->files->len);
+	mib_cache_put_uint(body, cache->num_nodes);
+	g_byte_array_append(body, cache->nodes->data, cache->nodes->len);
+	hash = g_compute_checksum_for_data(G_CHECKSUM_SHA256, body->data, body->len);
+	sig = mib_cache_signature(path_str);
+
+	cache_path = get_persconffile_path(MIB_CACHE_NAME, TRUE);
+	tmp_path = g_strdup_printf("%s.tmp", cache_path);
+	fh = ws_fopen(tmp_path, "wb");
+	if (fh) {
+		GByteArray* header = g_byte_array_new();
+
+		g_byte_array_append(header, (const guint8*)MIB_CACHE_MAGIC, MIB_CACHE_MAGIC_LEN);
+		mib_cache_put_uint(header, version);
+		mib_cache_put_string(header, sig);
+		mib_cache_put_string(header, hash);
+		ok = fwrite(header->data, 1, header->len, fh) == header->len &&
+		     fwrite(body->data, 1, body->len, fh) == body->len;
+		if (fclose(fh) != 0)
+			ok = FALSE;
+		/* Replace the old cache only once the new one is complete. */
+		if (!ok || ws_rename(tmp_path, cache_path) != 0) {
+			D(1,("Can't write the SMI cache %s: %s", cache_path, g_strerror(errno)));
+			ws_unlink(tmp_path);
+		} else {
+			D(1,("Wrote %u nodes to the SMI cache %s", cache->num_nodes, cache_path));
+		}
+		g_byte_array_free(header, TRUE);
+	}
+
+	g_free(tmp_path);
+	g_free(cache_path);
+	g_free(sig);
+	g_free(hash);
+	g_byte_array_free(body, TRUE);
+}
+
+/* Check that nothing has been added to or removed from the directories
+ * in the SMI path. */
+static gboolean mib_cache_check_dirs(mib_cache_reader_t* r) {
+	guint32 num_dirs = mib_cache_get_uint(r);
+	guint32 i;
+
+	for (i = 0; i < num_dirs && r->ok; i++) {
+		char* path = mib_cache_get_string(r);
+		gint64 mtime = mib_cache_get_int64(r);
+		gboolean same = path && mib_dir_mtime(path) == mtime;
+
+		if (!same)
+			D(1,("SMI cache is out of date: %s has changed", path ? path : "?"));
+		g_free(path);
+		if (!same)
+			return FALSE;
+	}
+	return r->ok;
+}
+
+/* Check that the files the modules were loaded from haven't changed. */
+static gboolean mib_cache_check_files(mib_cache_reader_t* r) {
+	guint32 num_files = mib_cache_get_uint(r);
+	guint32 i;
+
+	for (i = 0; i < num_files && r->ok; i++) {
+		char* path = mib_cache_get_string(r);
+		gint64 size = mib_cache_get_int64(r);
+		gint64 mtime = mib_cache_get_int64(r);
+		char* hash = mib_cache_get_string(r);
+		ws_statb64 st;
+		gboolean same = FALSE;
+
+		if (path && hash && ws_stat64(path, &st) == 0) {
+			if ((gint64)st.st_size == size && (gint64)st.st_mtime == mtime) {
+				same = TRUE;
+			} else if ((gint64)st.st_size == size) {
+				/* Touched, but maybe not changed. */
+				gchar* file_hash = mib_file_hash(path);
+				same = file_hash && g_str_equal(file_hash, hash);
+				g_free(file_hash);
+			}
+		}
+		if (!same)
+			D(1,("SMI cache is out of date: %s has changed", path ? path : "?"));
+		g_free(path);
+		g_free(hash);
+		if (!same)
+			return FALSE;
+	}
+	return r->ok;
+}
+
+static void mib_cache_read_nodes(mib_cache_reader_t* r, wmem_array_t* hfa) {
+	guint32 num_nodes = mib_cache_get_uint(r);
+	guint32 i, j;
+
+	for (i = 0; i < num_nodes && r->ok; i++) {
+		oid_kind_t kind = (oid_kind_t)mib_cache_get_uint(r);
+		gint32 type = (gint32)mib_cache_get_uint(r);
+		guint32 oidlen = mib_cache_get_uint(r);
+		const guint8* oid_bytes = mib_cache_get_bytes(r, (gsize)oidlen * sizeof(guint32));
+		guint32* oid;
+		char* name = mib_cache_get_string(r);
+		char* blurb = mib_cache_get_string(r);
+		guint32 num_enums = mib_cache_get_uint(r);
+		GArray* enums = NULL;
+		guint32 num_keys;
+		oid_key_t *key = NULL, *kl = NULL;
+
+		if (num_enums) {
+			enums = g_array_new(TRUE,TRUE,sizeof(value_string));
+			for (j = 0; j < num_enums && r->ok; j++) {
+				value_string val;
+				val.value  = mib_cache_get_uint(r);
+				val.strptr = mib_cache_get_string(r);
+				g_array_append_val(enums,val);
+			}
+		}
+
+		num_keys = mib_cache_get_uint(r);
+		for (j = 0; j < num_keys && r->ok; j++) {
+			oid_key_t* k = g_new(oid_key_t,1);
+
+			k->name = mib_cache_get_string(r);
+			k->hfid = -2;
+			k->num_subids = mib_cache_get_uint(r);
+			k->key_type = (oid_key_type_t)mib_cache_get_uint(r);
+			k->ft_type = (enum ftenum)mib_cache_get_uint(r);
+			k->display = (int)mib_cache_get_uint(r);
+			k->next = NULL;
+
+			if (!key) key = k;
+			if (kl) kl->next = k;
+			kl = k;
+		}
+
+		/* The contents were checksummed, so this "can't happen". */
+		if (!r->ok || !name || oidlen == 0 || type < -1 || type >= (gint32)G_N_ELEMENTS(mib_types)) {
+			D(1,("SMI cache is broken at node %u", i));
+			r->ok = FALSE;
+			g_free(name);
+			g_free(blurb);
+			if (enums) {
+				for (j = 0; j < enums->len; j++)
+					g_free((char*)g_array_index(enums, value_string, j).strptr);
+				g_array_free(enums, TRUE);
+			}
+			for (; key; key = kl) {
+				kl = key->next;
+				g_free(key->name);
+				g_free(key);
+			}
+			return;
+		}
+
+		oid = (guint32*)g_memdup(oid_bytes, oidlen * (guint)sizeof(guint32));
+		add_mib_node(hfa, name, kind, type >= 0 ? mib_types[type] : NULL, key,
+			     oidlen, oid, blurb, enums);
+		g_free(oid);
+		g_free(name);
+	}
+}
+
+/* Add the nodes from the cache, if it's there and up to date. */
+static gboolean mib_cache_load(wmem_array_t* hfa, const char* path_str) {
+	gchar* cache_path;
+	GMappedFile* mapped;
+	mib_cache_reader_t r;
+	gchar *sig, *cache_sig, *hash, *cache_hash = NULL;
+	gboolean ok = FALSE;
+
+	if (!use_mib_cache)
+		return FALSE;
+
+	cache_path = get_persconffile_path(MIB_CACHE_NAME, TRUE);
+	mapped = g_mapped_file_new(cache_path, FALSE, NULL);
+	if (!mapped) {
+		D(1,("No SMI cache %s", cache_path));
+		g_free(cache_path);
+		return FALSE;
+	}
+
+	r.p = (const guint8*)g_mapped_file_get_contents(mapped);
+	r.end = r.p + g_mapped_file_get_length(mapped);
+	r.ok = TRUE;
+
+	sig = mib_cache_signature(path_str);
+	if (r.p == NULL || r.end - r.p < MIB_CACHE_MAGIC_LEN ||
+	    memcmp(mib_cache_get_bytes(&r, MIB_CACHE_MAGIC_LEN), MIB_CACHE_MAGIC, MIB_CACHE_MAGIC_LEN) != 0 ||
+	    mib_cache_get_uint(&r) != MIB_CACHE_VERSION) {
+		D(1,("SMI cache %s is not in a format we know", cache_path));
+	} else if (!(cache_sig = mib_cache_get_string(&r)) || !g_str_equal(cache_sig, sig)) {
+		D(1,("SMI cache %s is for other modules or another version", cache_path));
+		g_free(cache_sig);
+	} else {
+		g_free(cache_sig);
+		cache_hash = mib_cache_get_string(&r);
+		hash = r.ok ? g_compute_checksum_for_data(G_CHECKSUM_SHA256, r.p, r.end - r.p) : NULL;
+		if (!cache_hash || !hash || !g_str_equal(cache_hash, hash)) {
+			D(1,("SMI cache %s is corrupt", cache_path));
+		} else if (mib_cache_check_dirs(&r) && mib_cache_check_files(&r)) {
+			mib_cache_read_nodes(&r, hfa);
+			/*
+			 * If that failed after all we have added some nodes
+			 * already; we're left with those.
+			 */
+			ok = TRUE;
+			D(1,("Loaded the SMI modules from the cache %s", cache_path));
+		}
+		g_free(hash);
+		g_free(cache_hash);
+	}
+
+	g_free(sig);
+	g_mapped_file_unref(mapped);
+	g_free(cache_path);
+	return ok;
+}
+
 static void register_mibs(void) {
 	SmiModule *smiModule;
 	SmiNode *smiNode;
@@ -523,6 +1057,7 @@ static void register_mibs(void) {
 	wmem_array_t* hfa;
 	GArray* etta;
 	gchar* path_str;
+	mib_cache_t cache = { NULL, 0, NULL, 0, NULL, 0 };
 
 	if (!load_smi_modules) {
 		D(1,("OID resolution not enabled"));
@@ -542,14 +1077,26 @@ static void register_mibs(void) {
 	smiInit(NULL);
 	smi_init_done = TRUE;
 
-	smi_errors = g_string_new("");
-	smiSetErrorHandler(smi_error_handler);
-
 	path_str = oid_get_default_mib_path();
 	D(1,("SMI Path: '%s'",path_str));
 
+	/* Even if nothing's loaded, oid_get_default_mib_path() gets the
+	 * user's paths from libsmi once we're done. */
 	smiSetPath(path_str);
 
+	if (mib_cache_load(hfa, path_str)) {
+		g_free(path_str);
+		goto done;
+	}
+
+	if (use_mib_cache) {
+		cache.dirs = g_byte_array_new();
+		mib_cache_add_dirs(&cache, path_str);
+	}
+
+	smi_errors = g_string_new("");
+	smiSetErrorHandler(smi_error_handler);
+
 	for(i=0;i<num_smi_modules;i++) {
 		if (!smi_modules[i].name) continue;
 
@@ -573,9 +1120,12 @@ static void register_mibs(void) {
 					   "installing them.\n" , smi_errors->str , path_str);
 		}
 		D(1,("Errors while loading:\n%s\n",smi_errors->str));
+	} else if (use_mib_cache) {
+		/* Don't cache modules with errors, so that they're reported again. */
+		cache.files = g_byte_array_new();
+		cache.nodes = g_byte_array_new();
 	}
 
-	g_free(path_str);
 	g_string_free(smi_errors,TRUE);
 
 	for (smiModule = smiGetFirstModule();
@@ -596,8 +1146,16 @@ static void register_mibs(void) {
 					"See details at: https://bugs.debian.org/560325\n",
 					 smiModule->name, smiModule->conformance);
 			}
+			if (cache.nodes) {
+				g_byte_array_free(cache.nodes, TRUE);
+				cache.nodes = NULL;
+			}
 			continue;
 		}
+
+		if (cache.files && smiModule->path)
+			mib_cache_add_file(&cache, smiModule->path);
+
 		for (smiNode = smiGetFirstNode(smiModule, SMI_NODEKIND_ANY);
 			 smiNode;
 			 smiNode = smiGetNextNode(smiNode, SMI_NODEKIND_ANY)) {
@@ -606,126 +1164,52 @@ static void register_mibs(void) {
 			const oid_value_type_t* typedata =  get_typedata(smiType);
 			oid_key_t* key;
 			oid_kind_t kind = smikind(smiNode,&key);
-			char *sub;
 			char *oid = smiRenderOID(smiNode->oidlen, smiNode->oid, SMI_RENDER_QUALIFIED);
-			oid_info_t* oid_data = add_oid(oid,
-						       kind,
-						       typedata,
-						       key,
-						       smiNode->oidlen,
-						       smiNode->oid);
-			smi_free (oid);
+			char *blurb = NULL;
+			GArray* enums = NULL;
 
-			sub = oid_subid2string(NULL, smiNode->oid, smiNode->oidlen);
-			D(4,("\t\tNode: kind=%d oid=%s name=%s ",
-				 oid_data->kind, sub, oid_data->name));
-			wmem_free(NULL, sub);
-
-			if ( typedata && oid_data->value_hfid == -2 ) {
+			if (typedata) {
 				SmiNamedNumber* smiEnum;
-				hf_register_info hf;
-				char *name;
-				char *blurb;
-
-				name = g_strdup(oid_data->name);
-				blurb = smiRenderOID(smiNode->oidlen, smiNode->oid, SMI_RENDER_ALL);
-				/* Don't allow duplicate blurb/name */
-				if (strcmp(blurb, name) == 0) {
-					smi_free(blurb);
-					blurb = NULL;
-				}
-
-				hf.p_id                     = &(oid_data->value_hfid);
-				hf.hfinfo.name              = name;
-				hf.hfinfo.abbrev            = alnumerize(oid_data->name);
-				hf.hfinfo.type              = typedata->ft_type;
-				hf.hfinfo.display           = typedata->display;
-				hf.hfinfo.strings           = NULL;
-				hf.hfinfo.bitmask           = 0;
-				hf.hfinfo.blurb             = blurb;
-				/* HFILL */
-				HFILL_INIT(hf);
+				char *smi_blurb = smiRenderOID(smiNode->oidlen, smiNode->oid, SMI_RENDER_ALL);
 
-				oid_data->value_hfid = -1;
+				blurb = g_strdup(smi_blurb);
+				smi_free(smi_blurb);
 
-				if ( IS_ENUMABLE(hf.hfinfo.type) && (smiEnum = smiGetFirstNamedNumber(smiType))) {
-					GArray* vals = g_array_new(TRUE,TRUE,sizeof(value_string));
-
-					for(;smiEnum; smiEnum = smiGetNextNamedNumber(smiEnum)) {
+				if ( IS_ENUMABLE(typedata->ft_type) ) {
+					for(smiEnum = smiGetFirstNamedNumber(smiType); smiEnum; smiEnum = smiGetNextNamedNumber(smiEnum)) {
 						if (smiEnum->name) {
 							value_string val;
+							if (!enums)
+								enums = g_array_new(TRUE,TRUE,sizeof(value_string));
 							val.value  = (guint32)smiEnum->value.value.integer32;
 							val.strptr = g_strdup(smiEnum->name);
-							g_array_append_val(vals,val);
+							g_array_append_val(enums,val);
 						}
 					}
-
-					hf.hfinfo.strings = g_array_free(vals, FALSE);
 				}
-#if 0 /* packet-snmp does not handle bits yet */
-			} else if (smiType->basetype == SMI_BASETYPE_BITS && ( smiEnum = smiGetFirstNamedNumber(smiType) )) {
-				guint n = 0;
-				oid_bits_info_t* bits = g_malloc(sizeof(oid_bits_info_t));
-				gint* ettp = &(bits->ett);
-
-				bits->num = 0;
-				bits->ett = -1;
-
-				g_array_append_val(etta,ettp);
-
-				for(;smiEnum; smiEnum = smiGetNextNamedNumber(smiEnum), bits->num++);
-
-				bits->data = g_malloc(sizeof(struct _oid_bit_t)*bits->num);
-
-				for(smiEnum = smiGetFirstNamedNumber(smiType),n=0;
-					smiEnum;
-					smiEnum = smiGetNextNamedNumber(smiEnum),n++) {
-					guint mask = 1 << (smiEnum->value.value.integer32 % 8);
-					char* base = alnumerize(oid_data->name);
-					char* ext = alnumerize(smiEnum->name);
-					hf_register_info hf2 = { &(bits->data[n].hfid), { NULL, NULL, FT_UINT8, BASE_HEX, NULL, mask, NULL, HFILL }};
-
-					bits->data[n].hfid = -1;
-					bits->data[n].offset = smiEnum->value.value.integer32 / 8;
-
-					hf2.hfinfo.name = g_strconcat("%s:%s",oid_data->name, ":", smiEnum->name, NULL);
-					hf2.hfinfo.abbrev = g_strconcat(base, ".", ext, NULL);
-
-					g_free(base);
-					g_free(ext);
-					g_array_append_val(hfa,hf2);
-				}
-#endif /* packet-snmp does not use this yet */
-				wmem_array_append_one(hfa,hf);
 			}
 
-			if ((key = oid_data->key)) {
-				for(; key; key = key->next) {
-					D(5,("\t\t\tIndex: name=%s subids=%u key_type=%d",
-						 key->name, key->num_subids, key->key_type ));
-
-					if (key->hfid == -2) {
-						hf_register_info hf;
-
-						hf.p_id                     = &(key->hfid);
-						hf.hfinfo.name              = key->name;
-						hf.hfinfo.abbrev            = alnumerize(key->name);
-						hf.hfinfo.type              = key->ft_type;
-						hf.hfinfo.display           = key->display;
-						hf.hfinfo.strings           = NULL;
-						hf.hfinfo.bitmask           = 0;
-						hf.hfinfo.blurb             = NULL;
-						/* HFILL */
-						HFILL_INIT(hf);
-
-						wmem_array_append_one(hfa,hf);
-						key->hfid = -1;
-					}
-				}
-			}
+			if (cache.files && cache.nodes)
+				mib_cache_add_node(&cache, oid, kind, typedata, key,
+						   smiNode->oidlen, smiNode->oid, blurb, enums);
+
+			add_mib_node(hfa, oid, kind, typedata, key,
+				     smiNode->oidlen, smiNode->oid, blurb, enums);
+			smi_free (oid);
 		}
 	}
 
+	if (cache.files && cache.nodes)
+		mib_cache_write(&cache, path_str);
+	if (cache.dirs)
+		g_byte_array_free(cache.dirs, TRUE);
+	if (cache.files)
+		g_byte_array_free(cache.files, TRUE);
+	if (cache.nodes)
+		g_byte_array_free(cache.nodes, TRUE);
+	g_free(path_str);
+
+done:
 	proto_mibs = proto_register_protocol("MIBs", "MIBS", "mibs");
 
 	proto_register_field_array(proto_mibs, (hf_register_info*)wmem_array_get_raw(hfa), wmem_array_get_count(hfa));
@@ -764,6 +1248,13 @@ void oid_pref_init(module_t *nameres)
                                   " If unsure, set to false.",
                                   &suppress_smi_errors);
 
+    prefs_register_bool_preference(nameres, "cache_smi_modules",
+                                  "Cache SMI modules",
+                                  "Save what is found in the MIB and PIB modules in a cache"
+                                  " file, and use that at startup while the modules are"
+                                  " unchanged, which is much faster than loading them.",
+                                  &use_mib_cache);
+
     smi_paths_uat = uat_new("SMI Paths",
                             sizeof(smi_module_t),
                             "smi_paths",
@@ -831,6 +1322,10 @@ void oid_pref_init(module_t *nameres)
                             "Suppress SMI errors: N/A",
                             "Support for OID resolution was not compiled into this version of Wireshark");
 
+    prefs_register_static_text_preference(nameres, "cache_smi_modules_static",
+                            "Cache SMI modules: N/A",
+                            "Support for OID resolution was not compiled into this version of Wireshark");
+
     prefs_register_static_text_preference(nameres, "smi_module_path",
                             "SMI (MIB and PIB) modules and paths: N/A",
                             "Support for OID resolution was not compiled into this version of Wireshark");
@@ -28,12 +28,15 @@
 #include "addr_resolv.h"
 #include "tvbuff.h"
 #include "epan_dissect.h"
+#include "conversation.h"
+#include "register-int.h"
 
 #include "wmem/wmem.h"
 
 #include <epan/exceptions.h>
 #include <epan/reassemble.h>
 #include <epan/stream.h>
+#include <epan/decode_cache.h>
 #include <epan/expert.h>
 #include <epan/prefs.h>
 #include <epan/range.h>
@@ -46,6 +49,24 @@ static dissector_handle_t frame_handle = NULL;
 static dissector_handle_t file_handle = NULL;
 static dissector_handle_t data_handle = NULL;
 
+/*
+ * The protocols whose layers set the addresses and the ports that
+ * conversations are found with, and which of the two each one sets.
+ */
+static const struct {
+	const char *filter_name;
+	gboolean    sets_ports;
+} conv_layer_protos[] = {
+	{ "ip",      FALSE },
+	{ "ipv6",    FALSE },
+	{ "tcp",     TRUE },
+	{ "udp",     TRUE },
+	{ "udplite", TRUE },
+	{ "sctp",    TRUE },
+	{ "dccp",    TRUE },
+};
+static int conv_layer_proto_ids[G_N_ELEMENTS(conv_layer_protos)];
+
 /**
  * A data source.
  * Has a tvbuff and a name.
@@ -79,9 +100,24 @@ struct data_source {
  *
  * "protocol" is the protocol associated with the dissector table. Used
  * for determining dependencies.
+ *
+ * "index" is, for uint tables, a two-level array of the entries in
+ * "hash_table" with patterns below DTBL_INDEX_LIMIT, so that looking
+ * those up (Ethertypes, IP protocols, TCP and UDP ports, ...) doesn't
+ * hash.  It's indexed by the upper bits of the pattern and points to
+ * pages indexed by the lower bits; both it and the pages are allocated
+ * when first needed.  It must be kept in sync with "hash_table", so
+ * entries are added and removed with uint_dtbl_insert() and
+ * uint_dtbl_remove().
  */
+#define DTBL_INDEX_PAGE_BITS	8
+#define DTBL_INDEX_PAGE_SIZE	(1U << DTBL_INDEX_PAGE_BITS)
+#define DTBL_INDEX_NUM_PAGES	256
+#define DTBL_INDEX_LIMIT	(DTBL_INDEX_NUM_PAGES * DTBL_INDEX_PAGE_SIZE)
+
 struct dissector_table {
 	GHashTable	*hash_table;
+	dtbl_entry_t	***index;
 	GSList		*dissector_handles;
 	const char	*ui_name;
 	ftenum_t	type;
@@ -151,12 +187,33 @@ destroy_depend_dissector_list(void *data)
 	g_slice_free(struct depend_dissector_list, dissector_list);
 }
 
+/*
+ * The dissectors of a heuristics dissector list, in order, with their
+ * prefilters laid out so that they can all be checked in one go.
+ * Entries without a prefilter have a length of 0 and a mask of 0, so
+ * they always pass.
+ */
+typedef struct heur_prefilters {
+	guint		count;
+	guint		sig_end;	/* packet bytes the signatures need */
+	gboolean	any;		/* FALSE if no entry has a prefilter */
+	heur_dtbl_entry_t **entries;
+	guint32		*min_length;
+	guint32		*sig_offset;
+	guint32		*sig_end_of;	/* sig_offset + sig_len of each entry */
+	guint64		*sig_value;
+	guint64		*sig_mask;
+} heur_prefilters_t;
+
 /*
  * A heuristics dissector list.
  */
 struct heur_dissector_list {
 	protocol_t	*protocol;
 	GSList		*dissectors;
+	heur_prefilters_t *prefilters;	/* NULL until needed, or after a change */
+	wmem_map_t	*conv_dissectors;	/* conversation_t * -> heur_dtbl_entry_t * */
+	heur_dissector_list_stats_t stats;
 };
 
 static GHashTable *heur_dissector_lists = NULL;
@@ -170,9 +227,27 @@ destroy_heuristic_dissector_entry(gpointer data)
 	heur_dtbl_entry_t *hdtbl_entry = (heur_dtbl_entry_t *)data;
 	g_free(hdtbl_entry->list_name);
 	g_free(hdtbl_entry->short_name);
+	g_free(hdtbl_entry->prefilter);
 	g_slice_free(heur_dtbl_entry_t, data);
 }
 
+static void
+free_heur_prefilters(heur_dissector_list_t sub_dissectors)
+{
+	heur_prefilters_t *pf = sub_dissectors->prefilters;
+
+	if (pf == NULL)
+		return;
+	g_free(pf->entries);
+	g_free(pf->min_length);
+	g_free(pf->sig_offset);
+	g_free(pf->sig_end_of);
+	g_free(pf->sig_value);
+	g_free(pf->sig_mask);
+	g_free(pf);
+	sub_dissectors->prefilters = NULL;
+}
+
 static void
 destroy_heuristic_dissector_list(void *data)
 {
@@ -180,14 +255,29 @@ destroy_heuristic_dissector_list(void *data)
 	GSList **list = &(dissector_list->dissectors);
 
 	g_slist_free_full(*list, destroy_heuristic_dissector_entry);
+	free_heur_prefilters(dissector_list);
 	g_slice_free(struct heur_dissector_list, dissector_list);
 }
 
+static void
+free_dtbl_index(dissector_table_t sub_dissectors)
+{
+	guint i;
+
+	if (sub_dissectors->index == NULL)
+		return;
+	for (i = 0; i < DTBL_INDEX_NUM_PAGES; i++)
+		g_free(sub_dissectors->index[i]);
+	g_free(sub_dissectors->index);
+	sub_dissectors->index = NULL;
+}
+
 static void
 destroy_dissector_table(void *data)
 {
 	struct dissector_table *table = (struct dissector_table *)data;
 
+	free_dtbl_index(table);
 	g_hash_table_destroy(table->hash_table);
 	g_slist_free(table->dissector_handles);
 	g_slice_free(struct dissector_table, data);
@@ -217,6 +307,8 @@ packet_init(void)
 void
 packet_cache_proto_handles(void)
 {
+	guint i;
+
 	frame_handle = find_dissector("frame");
 	g_assert(frame_handle != NULL);
 
@@ -228,6 +320,9 @@ packet_cache_proto_handles(void)
 
 	proto_malformed = proto_get_id_by_filter_name("_ws.malformed");
 	g_assert(proto_malformed != -1);
+
+	for (i = 0; i < G_N_ELEMENTS(conv_layer_protos); i++)
+		conv_layer_proto_ids[i] = proto_get_id_by_filter_name(conv_layer_protos[i].filter_name);
 }
 
 /* List of routines that are called before we make a pass through a capture file
@@ -343,6 +438,9 @@ cleanup_dissection(void)
 	/* Cleanup the stream-handling tables */
 	stream_cleanup();
 
+	/* Drop the data decoded from this file */
+	decode_cache_cleanup();
+
 	/* Cleanup the expert infos */
 	expert_packet_cleanup();
 
@@ -752,6 +850,7 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 	int          len;
 	guint        saved_layers_len = 0;
 	int          saved_tree_count = tree ? tree->tree_data->count : 0;
+	guint32      saved_selection = 0;
 
 	if (handle->protocol != NULL &&
 	    !proto_is_protocol_enabled(handle->protocol)) {
@@ -761,6 +860,16 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 		return 0;
 	}
 
+	if (handle->protocol != NULL && !proto_is_pino(handle->protocol) &&
+	    !proto_tree_selective_enter(tree, proto_get_id(handle->protocol), &saved_selection)) {
+		/*
+		 * We're only dissecting up to the protocols whose fields
+		 * are wanted, and we've got there; claim the data without
+		 * looking at it.
+		 */
+		return tvb_reported_length(tvb);
+	}
+
 	saved_proto = pinfo->current_proto;
 	saved_can_desegment = pinfo->can_desegment;
 	saved_layers_len = wmem_list_count(pinfo->layers);
@@ -804,6 +913,10 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 		 */
 		len = call_dissector_through_handle(handle, tvb, pinfo, tree, data);
 	}
+	if (len == 0 && handle->protocol != NULL && !proto_is_pino(handle->protocol)) {
+		/* It didn't get to its protocol after all. */
+		proto_tree_selective_restore(tree, saved_selection);
+	}
 	if (handle->protocol != NULL && !proto_is_pino(handle->protocol) && add_proto_name &&
 		(len == 0 || (tree && saved_tree_count == tree->tree_data->count))) {
 		/*
@@ -961,10 +1074,127 @@ find_dissector_table(const char *name)
 	return dissector_table;
 }
 
+/*
+ * Find a dissector table that a protocol adds itself to. If only some
+ * protocols are registered, the one that owns the table might not be yet.
+ */
+static dissector_table_t
+find_dissector_table_to_add_to(const char *name)
+{
+	dissector_table_t sub_dissectors = find_dissector_table(name);
+
+	if (sub_dissectors == NULL && register_dependency(name, FALSE))
+		sub_dissectors = find_dissector_table(name);
+	return sub_dissectors;
+}
+
+/*
+ * A dissector table or heuristic list that a protocol adds itself to
+ * doesn't exist. That's a bug, unless only some protocols were registered
+ * and the one the table belongs to isn't one of them; nothing looks in the
+ * table then, so there's nothing to add to.
+ */
+static void
+report_missing_table(const char *name, const char *proto_name)
+{
+	if (register_owner_skipped(name))
+		return;
+
+	fprintf(stderr, "OOPS: dissector table \"%s\" doesn't exist\n",
+	    name);
+	if (proto_name != NULL) {
+		fprintf(stderr, "Protocol being registered is \"%s\"\n",
+		    proto_name);
+	}
+	if (wireshark_abort_on_dissector_bug)
+		abort();
+}
+
+/* Set the index slot for a uint pattern; entry may be NULL. */
+static void
+set_dtbl_index(dissector_table_t sub_dissectors, const guint32 pattern,
+	       dtbl_entry_t *entry)
+{
+	dtbl_entry_t **page;
+
+	if (pattern >= DTBL_INDEX_LIMIT)
+		return;
+
+	if (sub_dissectors->index == NULL) {
+		if (entry == NULL)
+			return;
+		sub_dissectors->index = g_new0(dtbl_entry_t **, DTBL_INDEX_NUM_PAGES);
+	}
+	page = sub_dissectors->index[pattern >> DTBL_INDEX_PAGE_BITS];
+	if (page == NULL) {
+		if (entry == NULL)
+			return;
+		page = g_new0(dtbl_entry_t *, DTBL_INDEX_PAGE_SIZE);
+		sub_dissectors->index[pattern >> DTBL_INDEX_PAGE_BITS] = page;
+	}
+	page[pattern & (DTBL_INDEX_PAGE_SIZE - 1)] = entry;
+}
+
+/* Add an entry to a uint dissector table, replacing any old one. */
+static void
+uint_dtbl_insert(dissector_table_t sub_dissectors, const guint32 pattern,
+		 dtbl_entry_t *dtbl_entry)
+{
+	g_hash_table_insert(sub_dissectors->hash_table,
+			     GUINT_TO_POINTER(pattern), (gpointer)dtbl_entry);
+	set_dtbl_index(sub_dissectors, pattern, dtbl_entry);
+}
+
+/* Remove (and free) an entry from a uint dissector table. */
+static void
+uint_dtbl_remove(dissector_table_t sub_dissectors, const guint32 pattern)
+{
+	set_dtbl_index(sub_dissectors, pattern, NULL);
+	g_hash_table_remove(sub_dissectors->hash_table,
+			    GUINT_TO_POINTER(pattern));
+}
+
+static void
+rebuild_dtbl_index_func(gpointer key, gpointer value, gpointer user_data)
+{
+	set_dtbl_index((dissector_table_t)user_data, GPOINTER_TO_UINT(key),
+		       (dtbl_entry_t *)value);
+}
+
+/*
+ * Remove entries from a dissector table with g_hash_table_foreach_remove();
+ * if it's a uint table with an index, the index is rebuilt afterwards.
+ * That's slow, but this is only done when dissectors are deregistered.
+ */
+static void
+dtbl_foreach_remove(dissector_table_t sub_dissectors, GHRFunc func,
+		    gpointer user_data)
+{
+	if (g_hash_table_foreach_remove(sub_dissectors->hash_table, func, user_data) == 0)
+		return;
+	if (sub_dissectors->index != NULL) {
+		free_dtbl_index(sub_dissectors);
+		g_hash_table_foreach(sub_dissectors->hash_table,
+				     rebuild_dtbl_index_func, sub_dissectors);
+	}
+}
+
 /* Find an entry in a uint dissector table. */
 static dtbl_entry_t *
 find_uint_dtbl_entry(dissector_table_t sub_dissectors, const guint32 pattern)
 {
+	if (pattern < DTBL_INDEX_LIMIT && sub_dissectors->index != NULL) {
+		dtbl_entry_t **page;
+
+		/*
+		 * Every entry with a pattern this small is in the
+		 * index, so we don't need to hash it.  Only tables
+		 * that have had uint entries added have an index.
+		 */
+		page = sub_dissectors->index[pattern >> DTBL_INDEX_PAGE_BITS];
+		return page != NULL ? page[pattern & (DTBL_INDEX_PAGE_SIZE - 1)] : NULL;
+	}
+
 	switch (sub_dissectors->type) {
 
 	case FT_UINT8:
@@ -1021,7 +1251,7 @@ dissector_add_uint(const char *name, const guint32 pattern, dissector_handle_t h
 	dissector_table_t  sub_dissectors;
 	dtbl_entry_t      *dtbl_entry;
 
-	sub_dissectors = find_dissector_table(name);
+	sub_dissectors = find_dissector_table_to_add_to(name);
 
 	/*
 	 * Make sure the handle and the dissector table exist.
@@ -1034,12 +1264,7 @@ dissector_add_uint(const char *name, const guint32 pattern, dissector_handle_t h
 		return;
 	}
 	if (sub_dissectors == NULL) {
-		fprintf(stderr, "OOPS: dissector table \"%s\" doesn't exist\n",
-		    name);
-		fprintf(stderr, "Protocol being registered is \"%s\"\n",
-		    proto_get_protocol_long_name(handle->protocol));
-		if (wireshark_abort_on_dissector_bug)
-			abort();
+		report_missing_table(name, proto_get_protocol_long_name(handle->protocol));
 		return;
 	}
 
@@ -1071,8 +1296,7 @@ dissector_add_uint(const char *name, const guint32 pattern, dissector_handle_t h
 	dtbl_entry->initial = dtbl_entry->current;
 
 	/* do the table insertion */
-	g_hash_table_insert(sub_dissectors->hash_table,
-			     GUINT_TO_POINTER(pattern), (gpointer)dtbl_entry);
+	uint_dtbl_insert(sub_dissectors, pattern, dtbl_entry);
 
 	/*
 	 * Now, if this table supports "Decode As", add this handle
@@ -1118,9 +1342,14 @@ dissector_add_preference(const char *name, dissector_handle_t handle, guint init
 	guint* uint_var;
 	module_t *module;
 	gchar *description, *title;
-	dissector_table_t  pref_dissector_table = find_dissector_table(name);
+	dissector_table_t  pref_dissector_table = find_dissector_table_to_add_to(name);
 	int proto_id = proto_get_id(handle->protocol);
 
+	if (pref_dissector_table == NULL) {
+		/* dissector_add_uint reports it */
+		return;
+	}
+
 	uint_var = wmem_new(wmem_epan_scope(), guint);
 	*uint_var = init_value;
 
@@ -1153,10 +1382,15 @@ void dissector_add_uint_range_with_preference(const char *name, const char* rang
 	range_t** range;
 	module_t *module;
 	gchar *description, *title;
-	dissector_table_t  pref_dissector_table = find_dissector_table(name);
+	dissector_table_t  pref_dissector_table = find_dissector_table_to_add_to(name);
 	int proto_id = proto_get_id(handle->protocol);
 	guint32 max_value = 0;
 
+	if (pref_dissector_table == NULL) {
+		report_missing_table(name, proto_get_protocol_long_name(handle->protocol));
+		return;
+	}
+
 	/* If a dissector is added for Decode As only, it's dissector
 		table value would default to 0.
 		Set up a preference value with that information
@@ -1220,7 +1454,9 @@ dissector_delete_uint(const char *name, const guint32 pattern,
 	dissector_table_t sub_dissectors = find_dissector_table(name);
 	dtbl_entry_t *dtbl_entry;
 
-	/* sanity check */
+	/* sanity check; see report_missing_table */
+	if (sub_dissectors == NULL && register_owner_skipped(name))
+		return;
 	g_assert(sub_dissectors);
 
 	/*
@@ -1232,8 +1468,7 @@ dissector_delete_uint(const char *name, const guint32 pattern,
 		/*
 		 * Found - remove it.
 		 */
-		g_hash_table_remove(sub_dissectors->hash_table,
-				    GUINT_TO_POINTER(pattern));
+		uint_dtbl_remove(sub_dissectors, pattern);
 	}
 }
 
@@ -1272,9 +1507,12 @@ dissector_delete_all_check (gpointer key _U_, gpointer value, gpointer user_data
 void dissector_delete_all(const char *name, dissector_handle_t handle)
 {
 	dissector_table_t sub_dissectors = find_dissector_table(name);
+
+	if (sub_dissectors == NULL && register_owner_skipped(name))
+		return;
 	g_assert (sub_dissectors);
 
-	g_hash_table_foreach_remove (sub_dissectors->hash_table, dissector_delete_all_check, handle);
+	dtbl_foreach_remove(sub_dissectors, dissector_delete_all_check, handle);
 }
 
 static void
@@ -1283,7 +1521,7 @@ dissector_delete_from_table(gpointer key _U_, gpointer value, gpointer user_data
 	dissector_table_t sub_dissectors = (dissector_table_t) value;
 	g_assert (sub_dissectors);
 
-	g_hash_table_foreach_remove(sub_dissectors->hash_table, dissector_delete_all_check, user_data);
+	dtbl_foreach_remove(sub_dissectors, dissector_delete_all_check, user_data);
 	sub_dissectors->dissector_handles = g_slist_remove(sub_dissectors->dissector_handles, user_data);
 }
 
@@ -1327,8 +1565,7 @@ dissector_change_uint(const char *name, const guint32 pattern, dissector_handle_
 	dtbl_entry->current = handle;
 
 	/* do the table insertion */
-	g_hash_table_insert(sub_dissectors->hash_table,
-			     GUINT_TO_POINTER(pattern), (gpointer)dtbl_entry);
+	uint_dtbl_insert(sub_dissectors, pattern, dtbl_entry);
 }
 
 /* Reset an entry in a uint dissector table to its initial value. */
@@ -1355,8 +1592,7 @@ dissector_reset_uint(const char *name, const guint32 pattern)
 	if (dtbl_entry->initial != NULL) {
 		dtbl_entry->current = dtbl_entry->initial;
 	} else {
-		g_hash_table_remove(sub_dissectors->hash_table,
-				    GUINT_TO_POINTER(pattern));
+		uint_dtbl_remove(sub_dissectors, pattern);
 	}
 }
 
@@ -1502,7 +1738,7 @@ void
 dissector_add_string(const char *name, const gchar *pattern,
 		     dissector_handle_t handle)
 {
-	dissector_table_t  sub_dissectors = find_dissector_table(name);
+	dissector_table_t  sub_dissectors = find_dissector_table_to_add_to(name);
 	dtbl_entry_t      *dtbl_entry;
 	char *key;
 
@@ -1517,12 +1753,7 @@ dissector_add_string(const char *name, const gchar *pattern,
 		return;
 	}
 	if (sub_dissectors == NULL) {
-		fprintf(stderr, "OOPS: dissector table \"%s\" doesn't exist\n",
-		    name);
-		fprintf(stderr, "Protocol being registered is \"%s\"\n",
-		    proto_get_protocol_long_name(handle->protocol));
-		if (wireshark_abort_on_dissector_bug)
-			abort();
+		report_missing_table(name, proto_get_protocol_long_name(handle->protocol));
 		return;
 	}
 
@@ -1583,7 +1814,9 @@ dissector_delete_string(const char *name, const gchar *pattern,
 	dissector_table_t  sub_dissectors = find_dissector_table(name);
 	dtbl_entry_t      *dtbl_entry;
 
-	/* sanity check */
+	/* sanity check; see report_missing_table */
+	if (sub_dissectors == NULL && register_owner_skipped(name))
+		return;
 	g_assert(sub_dissectors);
 
 	/*
@@ -1765,7 +1998,7 @@ dissector_get_default_string_handle(const char *name, const gchar *string)
 /* Add an entry to a "custom" dissector table. */
 void dissector_add_custom_table_handle(const char *name, void *pattern, dissector_handle_t handle)
 {
-	dissector_table_t  sub_dissectors = find_dissector_table(name);
+	dissector_table_t  sub_dissectors = find_dissector_table_to_add_to(name);
 	dtbl_entry_t      *dtbl_entry;
 
 	/*
@@ -1779,12 +2012,7 @@ void dissector_add_custom_table_handle(const char *name, void *pattern, dissecto
 		return;
 	}
 	if (sub_dissectors == NULL) {
-		fprintf(stderr, "OOPS: dissector table \"%s\" doesn't exist\n",
-		    name);
-		fprintf(stderr, "Protocol being registered is \"%s\"\n",
-		    proto_get_protocol_long_name(handle->protocol));
-		if (wireshark_abort_on_dissector_bug)
-			abort();
+		report_missing_table(name, proto_get_protocol_long_name(handle->protocol));
 		return;
 	}
 
@@ -1822,7 +2050,7 @@ void dissector_add_guid(const char *name, guid_key* guid_val, dissector_handle_t
 	dissector_table_t  sub_dissectors;
 	dtbl_entry_t      *dtbl_entry;
 
-	sub_dissectors = find_dissector_table(name);
+	sub_dissectors = find_dissector_table_to_add_to(name);
 
 	/*
 	 * Make sure the handle and the dissector table exist.
@@ -1835,12 +2063,7 @@ void dissector_add_guid(const char *name, guid_key* guid_val, dissector_handle_t
 		return;
 	}
 	if (sub_dissectors == NULL) {
-		fprintf(stderr, "OOPS: dissector table \"%s\" doesn't exist\n",
-		    name);
-		fprintf(stderr, "Protocol being registered is \"%s\"\n",
-		    proto_get_protocol_long_name(handle->protocol));
-		if (wireshark_abort_on_dissector_bug)
-			abort();
+		report_missing_table(name, proto_get_protocol_long_name(handle->protocol));
 		return;
 	}
 
@@ -2013,7 +2236,7 @@ dissector_compare_filter_name(gconstpointer dissector_a, gconstpointer dissector
 void
 dissector_add_for_decode_as(const char *name, dissector_handle_t handle)
 {
-	dissector_table_t  sub_dissectors = find_dissector_table(name);
+	dissector_table_t  sub_dissectors = find_dissector_table_to_add_to(name);
 	GSList            *entry;
 	dissector_handle_t dup_handle;
 
@@ -2021,12 +2244,7 @@ dissector_add_for_decode_as(const char *name, dissector_handle_t handle)
 	 * Make sure the dissector table exists.
 	 */
 	if (sub_dissectors == NULL) {
-		fprintf(stderr, "OOPS: dissector table \"%s\" doesn't exist\n",
-		    name);
-		fprintf(stderr, "Protocol being registered is \"%s\"\n",
-		    proto_get_protocol_long_name(handle->protocol));
-		if (wireshark_abort_on_dissector_bug)
-			abort();
+		report_missing_table(name, proto_get_protocol_long_name(handle->protocol));
 		return;
 	}
 
@@ -2488,6 +2706,7 @@ register_dissector_table(const char *name, const char *ui_name, const int proto,
 		g_error("The dissector table %s (%s) is registering an unsupported type - are you using a buggy plugin?", name, ui_name);
 		g_assert_not_reached();
 	}
+	sub_dissectors->index = NULL;
 	sub_dissectors->dissector_handles = NULL;
 	sub_dissectors->ui_name = ui_name;
 	sub_dissectors->type    = type;
@@ -2517,6 +2736,7 @@ dissector_table_t register_custom_dissector_table(const char *name,
 							       &g_free,
 							       &g_free);
 
+	sub_dissectors->index = NULL;
 	sub_dissectors->dissector_handles = NULL;
 	sub_dissectors->ui_name = ui_name;
 	sub_dissectors->type    = FT_BYTES; /* Consider key a "blob" of data, no need to really create new type */
@@ -2638,19 +2858,14 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const char *dis
 	guint                  i, list_size;
 	GSList                *list_entry;
 
+	if (sub_dissectors == NULL && register_dependency(name, FALSE))
+		sub_dissectors = find_heur_dissector_list(name);
+
 	/*
 	 * Make sure the dissector table exists.
 	 */
 	if (sub_dissectors == NULL) {
-		fprintf(stderr, "OOPS: dissector table \"%s\" doesn't exist\n",
-		    name);
-		proto_name = proto_get_protocol_name(proto);
-		if (proto_name != NULL) {
-			fprintf(stderr, "Protocol being registered is \"%s\"\n",
-			    proto_name);
-		}
-		if (wireshark_abort_on_dissector_bug)
-			abort();
+		report_missing_table(name, proto_get_protocol_name(proto));
 		return;
 	}
 
@@ -2683,7 +2898,7 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const char *dis
 			" This might be caused by an inappropriate plugin or a development error.", internal_name);
 	}
 
-	hdtbl_entry = g_slice_new(heur_dtbl_entry_t);
+	hdtbl_entry = g_slice_new0(heur_dtbl_entry_t);
 	hdtbl_entry->dissector = dissector;
 	hdtbl_entry->protocol  = find_protocol_by_id(proto);
 	hdtbl_entry->display_name = display_name;
@@ -2696,6 +2911,7 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const char *dis
 
 	sub_dissectors->dissectors = g_slist_prepend(sub_dissectors->dissectors,
 	    (gpointer)hdtbl_entry);
+	free_heur_prefilters(sub_dissectors);
 
 	/* XXX - could be optimized to pass hdtbl_entry directly */
 	proto_add_heuristic_dissector(hdtbl_entry->protocol, hdtbl_entry->short_name);
@@ -2718,6 +2934,38 @@ find_matching_heur_dissector(gconstpointer a, gconstpointer b) {
 		(hdtbl_entry_a->protocol == hdtbl_entry_b->protocol) ? 0 : 1;
 }
 
+typedef struct heur_conv_search {
+	const heur_dtbl_entry_t *hdtbl_entry;
+	GSList *convs;
+} heur_conv_search_t;
+
+static void
+find_heur_dissector_convs(gpointer key, gpointer value, gpointer user_data)
+{
+	heur_conv_search_t *search = (heur_conv_search_t *)user_data;
+
+	if (value == search->hdtbl_entry)
+		search->convs = g_slist_prepend(search->convs, key);
+}
+
+/* Forget the conversations that remember a dissector that's being removed. */
+static void
+forget_heur_dissector_convs(heur_dissector_list_t sub_dissectors, const heur_dtbl_entry_t *hdtbl_entry)
+{
+	heur_conv_search_t search;
+	GSList *conv;
+
+	if (sub_dissectors->conv_dissectors == NULL)
+		return;
+
+	search.hdtbl_entry = hdtbl_entry;
+	search.convs = NULL;
+	wmem_map_foreach(sub_dissectors->conv_dissectors, find_heur_dissector_convs, &search);
+	for (conv = search.convs; conv != NULL; conv = g_slist_next(conv))
+		wmem_map_remove(sub_dissectors->conv_dissectors, conv->data);
+	g_slist_free(search.convs);
+}
+
 void
 heur_dissector_delete(const char *name, heur_dissector_t dissector, const int proto) {
 	heur_dissector_list_t  sub_dissectors = find_heur_dissector_list(name);
@@ -2738,10 +2986,212 @@ heur_dissector_delete(const char *name, heur_dissector_t dissector, const int pr
 		g_free(found_hdtbl_entry->list_name);
 		g_hash_table_remove(heuristic_short_names, found_hdtbl_entry->short_name);
 		g_free(found_hdtbl_entry->short_name);
+		g_free(found_hdtbl_entry->prefilter);
+		forget_heur_dissector_convs(sub_dissectors, found_hdtbl_entry);
 		g_slice_free(heur_dtbl_entry_t, found_entry->data);
 		sub_dissectors->dissectors = g_slist_delete_link(sub_dissectors->dissectors,
 		    found_entry);
+		free_heur_prefilters(sub_dissectors);
+	}
+}
+
+void
+heur_dissector_set_prefilter(const char *internal_name, const heur_prefilter_t *prefilter)
+{
+	heur_dtbl_entry_t *hdtbl_entry = find_heur_dissector_by_unique_short_name(internal_name);
+
+	if (hdtbl_entry == NULL) {
+		/* Its list might not exist; see report_missing_table. */
+		if (register_owner_skipped(internal_name))
+			return;
+		fprintf(stderr, "OOPS: heuristic dissector \"%s\" doesn't exist\n",
+		    internal_name);
+		if (wireshark_abort_on_dissector_bug)
+			abort();
+		return;
+	}
+	DISSECTOR_ASSERT(prefilter->sig_len <= HEUR_PREFILTER_MAX_SIG_LEN);
+	DISSECTOR_ASSERT(prefilter->sig_offset + prefilter->sig_len <= HEUR_PREFILTER_MAX_END);
+
+	g_free(hdtbl_entry->prefilter);
+	hdtbl_entry->prefilter = (heur_prefilter_t *)g_memdup(prefilter, sizeof(*prefilter));
+	free_heur_prefilters(find_heur_dissector_list(hdtbl_entry->list_name));
+}
+
+void
+heur_dissector_list_get_stats(heur_dissector_list_t sub_dissectors,
+    heur_dissector_list_stats_t *stats)
+{
+	*stats = sub_dissectors->stats;
+}
+
+/*
+ * Lay out the prefilters of a list's dissectors in arrays, in the order
+ * in which the dissectors are tried.
+ */
+static heur_prefilters_t *
+build_heur_prefilters(heur_dissector_list_t sub_dissectors)
+{
+	heur_prefilters_t *pf = g_new0(heur_prefilters_t, 1);
+	heur_dtbl_entry_t *hdtbl_entry;
+	heur_prefilter_t  *prefilter;
+	GSList            *entry;
+	guint              i;
+
+	pf->count = g_slist_length(sub_dissectors->dissectors);
+	pf->entries = g_new(heur_dtbl_entry_t *, pf->count);
+	pf->min_length = g_new0(guint32, pf->count);
+	pf->sig_offset = g_new0(guint32, pf->count);
+	pf->sig_end_of = g_new0(guint32, pf->count);
+	pf->sig_value = g_new0(guint64, pf->count);
+	pf->sig_mask = g_new0(guint64, pf->count);
+
+	for (entry = sub_dissectors->dissectors, i = 0; entry != NULL;
+	    entry = g_slist_next(entry), i++) {
+		hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
+		pf->entries[i] = hdtbl_entry;
+		prefilter = hdtbl_entry->prefilter;
+		if (prefilter == NULL)
+			continue;
+
+		pf->any = TRUE;
+		pf->min_length[i] = prefilter->min_length;
+		if (prefilter->sig_len != 0) {
+			/* Both are compared the way they're in memory, so the
+			   byte order doesn't matter. */
+			memcpy(&pf->sig_value[i], prefilter->sig_value, prefilter->sig_len);
+			memcpy(&pf->sig_mask[i], prefilter->sig_mask, prefilter->sig_len);
+			pf->sig_value[i] &= pf->sig_mask[i];
+			pf->sig_offset[i] = prefilter->sig_offset;
+			pf->sig_end_of[i] = prefilter->sig_offset + prefilter->sig_len;
+			pf->sig_end = MAX(pf->sig_end, pf->sig_end_of[i]);
+		}
+	}
+	return pf;
+}
+
+/*
+ * Check the prefilters of all of a list's dissectors against a packet,
+ * setting pass[i] to whether the i-th dissector should be called.
+ * This is a single loop without branches over the arrays, so it's
+ * cheaper than calling even one dissector that rejects the packet.
+ */
+static void
+check_heur_prefilters(const heur_prefilters_t *pf, tvbuff_t *tvb, guint8 *pass)
+{
+	guint8  head[HEUR_PREFILTER_MAX_END + sizeof(guint64)];
+	guint   reported = tvb_reported_length(tvb);
+	guint   avail = MIN(tvb_captured_length(tvb), pf->sig_end);
+	guint64 word;
+	guint   i;
+
+	memset(head, 0, sizeof(head));
+	if (avail != 0)
+		tvb_memcpy(tvb, head, 0, avail);
+	for (i = 0; i < pf->count; i++) {
+		memcpy(&word, head + pf->sig_offset[i], sizeof(word));
+		pass[i] = (reported >= pf->min_length[i]) &
+		    ((pf->sig_end_of[i] > avail) | ((word & pf->sig_mask[i]) == pf->sig_value[i]));
+	}
+}
+
+/*
+ * Return TRUE if the addresses and the ports of a packet were set by the
+ * same network and transport layers, that is, if the innermost of those
+ * layers is a transport layer.  Inside a tunnel, the inner network layer
+ * replaces the addresses but keeps the ports of the outer transport
+ * layer until an inner transport layer sets its own, and a conversation
+ * found with that mix belongs to neither flow.
+ */
+static gboolean
+conv_layers_match(packet_info *pinfo)
+{
+	wmem_list_frame_t *frame;
+	int                proto_id;
+	guint              i;
+
+	for (frame = wmem_list_tail(pinfo->layers); frame != NULL;
+	    frame = wmem_list_frame_prev(frame)) {
+		proto_id = GPOINTER_TO_INT(wmem_list_frame_data(frame));
+		for (i = 0; i < G_N_ELEMENTS(conv_layer_protos); i++) {
+			if (conv_layer_proto_ids[i] == proto_id)
+				return conv_layer_protos[i].sets_ports;
+		}
 	}
+	return FALSE;
+}
+
+static gboolean
+heur_dissector_is_enabled(const heur_dtbl_entry_t *hdtbl_entry)
+{
+	return hdtbl_entry->protocol == NULL ||
+		(proto_is_protocol_enabled(hdtbl_entry->protocol) && hdtbl_entry->enabled);
+}
+
+/*
+ * Call one of the dissectors of a heuristics list; returns what it
+ * returned.
+ */
+static int
+call_heur_dissector_entry(heur_dtbl_entry_t *hdtbl_entry, tvbuff_t *tvb,
+    packet_info *pinfo, proto_tree *tree, void *data, guint saved_layers_len,
+    int saved_tree_count)
+{
+	int proto_id;
+	int len;
+	guint32 saved_selection = 0;
+
+	if (hdtbl_entry->protocol != NULL) {
+		proto_id = proto_get_id(hdtbl_entry->protocol);
+		if (!proto_tree_selective_enter(tree, proto_id, &saved_selection)) {
+			/*
+			 * Not a protocol we need; let the caller fall back
+			 * to whatever it does with data nobody recognized.
+			 */
+			return 0;
+		}
+		/* do NOT change this behavior - wslua uses the protocol short name set here in order
+		   to determine which Lua-based heurisitc dissector to call */
+		pinfo->current_proto =
+			proto_get_protocol_short_name(hdtbl_entry->protocol);
+
+		/*
+		 * Add the protocol name to the layers; we'll remove it
+		 * if the dissector fails.
+		 */
+		pinfo->curr_layer_num++;
+		wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_id));
+	}
+
+	pinfo->heur_list_name = hdtbl_entry->list_name;
+
+	hdtbl_entry->calls++;
+	len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+	if (len == 0 && hdtbl_entry->protocol != NULL)
+		proto_tree_selective_restore(tree, saved_selection);
+	if (hdtbl_entry->protocol != NULL &&
+		(len == 0 || (tree && saved_tree_count == tree->tree_data->count))) {
+		/*
+		 * We added a protocol layer above. The dissector
+		 * didn't accept the packet or it didn't add any
+		 * items to the tree so remove it from the list.
+		 */
+		while (wmem_list_count(pinfo->layers) > saved_layers_len) {
+			if (len == 0) {
+				/*
+				 * Only reduce the layer number if the dissector
+				 * rejected the data. Since tree can be NULL on
+				 * the first pass, we cannot check it or it will
+				 * break dissectors that rely on a stable value.
+				 */
+				pinfo->curr_layer_num--;
+			}
+			wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
+		}
+	}
+	if (len)
+		hdtbl_entry->accepts++;
+	return len;
 }
 
 gboolean
@@ -2751,12 +3201,14 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	gboolean           status;
 	const char        *saved_curr_proto;
 	const char        *saved_heur_list_name;
-	GSList            *entry;
 	guint16            saved_can_desegment;
 	guint              saved_layers_len = 0;
 	heur_dtbl_entry_t *hdtbl_entry;
-	int                proto_id;
-	int                len;
+	heur_dtbl_entry_t *conv_entry = NULL;
+	heur_prefilters_t *pf;
+	conversation_t    *conv = NULL;
+	guint8            *pass = NULL;
+	guint              i;
 	int                saved_tree_count = tree ? tree->tree_data->count : 0;
 
 	/* can_desegment is set to 2 by anyone which offers this api/service.
@@ -2781,63 +3233,83 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 
 	DISSECTOR_ASSERT(saved_layers_len < PINFO_LAYER_MAX_RECURSION_DEPTH);
 
-	for (entry = sub_dissectors->dissectors; entry != NULL;
-	    entry = g_slist_next(entry)) {
-		/* XXX - why set this now and above? */
-		pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
-		hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
+	sub_dissectors->stats.tries++;
+	if (sub_dissectors->prefilters == NULL)
+		sub_dissectors->prefilters = build_heur_prefilters(sub_dissectors);
+	pf = sub_dissectors->prefilters;
+	if (pf->any) {
+		pass = (guint8 *)wmem_alloc(wmem_packet_scope(), pf->count);
+		check_heur_prefilters(pf, tvb, pass);
+	}
 
-		if (hdtbl_entry->protocol != NULL &&
-			(!proto_is_protocol_enabled(hdtbl_entry->protocol)||(hdtbl_entry->enabled==FALSE))) {
-			/*
-			 * No - don't try this dissector.
-			 */
-			continue;
+	/*
+	 * If a dissector in this list has recognized an earlier packet of
+	 * this conversation, try it first.  Without ports, the
+	 * "conversation" would be everything between two hosts, which is
+	 * too broad for that, and if the addresses and ports are from
+	 * different layers, it isn't a conversation at all.
+	 */
+	if (pinfo->ptype != PT_NONE && conv_layers_match(pinfo)) {
+		if (sub_dissectors->conv_dissectors == NULL)
+			sub_dissectors->conv_dissectors = wmem_map_new_autoreset(wmem_epan_scope(),
+			    wmem_file_scope(), g_direct_hash, g_direct_equal);
+		conv = find_conversation_pinfo(pinfo, 0);
+		if (conv != NULL)
+			conv_entry = (heur_dtbl_entry_t *)wmem_map_lookup(sub_dissectors->conv_dissectors, conv);
+	}
+	if (conv_entry != NULL && heur_dissector_is_enabled(conv_entry)) {
+		gboolean passed = TRUE;
+
+		if (pass != NULL) {
+			for (i = 0; i < pf->count && pf->entries[i] != conv_entry; i++)
+				;
+			passed = i == pf->count || pass[i];
 		}
+		if (passed && call_heur_dissector_entry(conv_entry, tvb, pinfo, tree, data,
+		    saved_layers_len, saved_tree_count)) {
+			sub_dissectors->stats.memo_hits++;
+			*heur_dtbl_entry = conv_entry;
+			status = TRUE;
+		} else {
+			sub_dissectors->stats.memo_misses++;
+		}
+	}
 
-		if (hdtbl_entry->protocol != NULL) {
-			proto_id = proto_get_id(hdtbl_entry->protocol);
-			/* do NOT change this behavior - wslua uses the protocol short name set here in order
-			   to determine which Lua-based heurisitc dissector to call */
-			pinfo->current_proto =
-				proto_get_protocol_short_name(hdtbl_entry->protocol);
+	if (!status) {
+		sub_dissectors->stats.walks++;
+		for (i = 0; i < pf->count; i++) {
+			/* XXX - why set this now and above? */
+			pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
+			hdtbl_entry = pf->entries[i];
 
-			/*
-			 * Add the protocol name to the layers; we'll remove it
-			 * if the dissector fails.
-			 */
-			pinfo->curr_layer_num++;
-			wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_id));
-		}
+			if (hdtbl_entry == conv_entry || !heur_dissector_is_enabled(hdtbl_entry)) {
+				/*
+				 * No - don't try this dissector.
+				 */
+				continue;
+			}
 
-		pinfo->heur_list_name = hdtbl_entry->list_name;
+			if (pass != NULL && !pass[i]) {
+				hdtbl_entry->prefilter_rejects++;
+				sub_dissectors->stats.prefilter_rejects++;
+				continue;
+			}
 
-		len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
-		if (hdtbl_entry->protocol != NULL &&
-			(len == 0 || (tree && saved_tree_count == tree->tree_data->count))) {
-			/*
-			 * We added a protocol layer above. The dissector
-			 * didn't accept the packet or it didn't add any
-			 * items to the tree so remove it from the list.
-			 */
-			while (wmem_list_count(pinfo->layers) > saved_layers_len) {
-				if (len == 0) {
-					/*
-					 * Only reduce the layer number if the dissector
-					 * rejected the data. Since tree can be NULL on
-					 * the first pass, we cannot check it or it will
-					 * break dissectors that rely on a stable value.
-					 */
-					pinfo->curr_layer_num--;
-				}
-				wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
+			if (call_heur_dissector_entry(hdtbl_entry, tvb, pinfo, tree, data,
+			    saved_layers_len, saved_tree_count)) {
+				*heur_dtbl_entry = hdtbl_entry;
+				status = TRUE;
+				/*
+				 * Only the first dissector to recognize the
+				 * conversation is remembered, so that
+				 * dissecting the packets again gives the same
+				 * results.
+				 */
+				if (conv != NULL && conv_entry == NULL)
+					wmem_map_insert(sub_dissectors->conv_dissectors, conv, hdtbl_entry);
+				break;
 			}
 		}
-		if (len) {
-			*heur_dtbl_entry = hdtbl_entry;
-			status = TRUE;
-			break;
-		}
 	}
 
 	pinfo->current_proto = saved_curr_proto;
@@ -2994,6 +3466,9 @@ register_heur_dissector_list(const char *name, const int proto)
 	sub_dissectors = g_slice_new(struct heur_dissector_list);
 	sub_dissectors->protocol  = find_protocol_by_id(proto);
 	sub_dissectors->dissectors = NULL;	/* initially empty */
+	sub_dissectors->prefilters = NULL;
+	sub_dissectors->conv_dissectors = NULL;
+	memset(&sub_dissectors->stats, 0, sizeof(sub_dissectors->stats));
 	g_hash_table_insert(heur_dissector_lists, (gpointer)name,
 			    (gpointer) sub_dissectors);
 	return sub_dissectors;
@@ -3064,13 +3539,18 @@ get_dissector_names(void)
 dissector_handle_t
 find_dissector(const char *name)
 {
-	return (dissector_handle_t)g_hash_table_lookup(registered_dissectors, name);
+	dissector_handle_t handle = (dissector_handle_t)g_hash_table_lookup(registered_dissectors, name);
+
+	/* If only some protocols are registered, make sure this one is. */
+	if (register_dependency(name, TRUE) && handle == NULL)
+		handle = (dissector_handle_t)g_hash_table_lookup(registered_dissectors, name);
+	return handle;
 }
 
 /** Find a dissector by name and add parent protocol as a depedency*/
 dissector_handle_t find_dissector_add_dependency(const char *name, const int parent_proto)
 {
-	dissector_handle_t handle = (dissector_handle_t)g_hash_table_lookup(registered_dissectors, name);
+	dissector_handle_t handle = find_dissector(name);
 	if ((handle != NULL) && (parent_proto > 0))
 	{
 		register_depend_dissector(proto_get_protocol_short_name(find_protocol_by_id(parent_proto)), dissector_handle_get_short_name(handle));
@@ -3584,11 +4064,16 @@ void
 call_all_postdissectors(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree)
 {
 	guint i;
+	gboolean was_suspended;
 
+	/* Postdissectors work on what the other layers added, so they
+	   are never skipped by selective dissection. */
+	was_suspended = proto_tree_selective_suspend(tree, TRUE);
 	for (i = 0; i < postdissectors->len; i++) {
 		call_dissector_only(POSTDISSECTORS(i).handle,
 				    tvb, pinfo, tree, NULL);
 	}
+	proto_tree_selective_suspend(tree, was_suspended);
 }
 
 gboolean
@@ -432,6 +432,25 @@ struct heur_dissector_list;
 typedef struct heur_dissector_list *heur_dissector_list_t;
 
 
+/** The most bytes a heuristic prefilter's signature can span; see
+ *  heur_dissector_set_prefilter(). */
+#define HEUR_PREFILTER_MAX_END		64
+#define HEUR_PREFILTER_MAX_SIG_LEN	8
+
+/** A cheap test that a packet must pass before a heuristic dissector is
+ *  called with it: the packet's reported length must be at least
+ *  min_length, and the sig_len bytes at sig_offset, ANDed with
+ *  sig_mask, must be equal to sig_value.  If not all of the signature
+ *  bytes were captured, only the length is checked.
+ */
+typedef struct heur_prefilter {
+	guint min_length;
+	guint sig_offset;
+	guint sig_len;
+	guint8 sig_value[HEUR_PREFILTER_MAX_SIG_LEN];
+	guint8 sig_mask[HEUR_PREFILTER_MAX_SIG_LEN];
+} heur_prefilter_t;
+
 typedef struct heur_dtbl_entry {
 	heur_dissector_t dissector;
 	protocol_t *protocol; /* this entry's protocol */
@@ -439,8 +458,21 @@ typedef struct heur_dtbl_entry {
 	const gchar *display_name;     /* the string used to present heuristic to user */
 	gchar *short_name;     /* string used for "internal" use to uniquely identify heuristic */
 	gboolean enabled;
+	heur_prefilter_t *prefilter;	/* NULL if the dissector is always called */
+	guint64 calls;        /* times the dissector was called */
+	guint64 accepts;      /* times it recognized the packet */
+	guint64 prefilter_rejects;	/* times it wasn't called because of the prefilter */
 } heur_dtbl_entry_t;
 
+/** Counts of what dissector_try_heuristic() did with a list. */
+typedef struct heur_dissector_list_stats {
+	guint64 tries;        /* calls to dissector_try_heuristic() */
+	guint64 walks;        /* times the list was walked */
+	guint64 memo_hits;    /* the conversation's dissector recognized the packet */
+	guint64 memo_misses;  /* the conversation's dissector didn't */
+	guint64 prefilter_rejects;	/* dissectors not called because of their prefilters */
+} heur_dissector_list_stats_t;
+
 /** A protocol uses this function to register a heuristic sub-dissector list.
  *  Call this in the parent dissectors proto_register function.
  *
@@ -484,6 +516,11 @@ WS_DLL_PUBLIC gboolean has_heur_dissector_list(const gchar *name);
  *  until we find one that recognizes the protocol.
  *  Call this while the parent dissector running.
  *
+ *  The first dissector that recognizes a packet of a conversation is
+ *  remembered, and tried first for the conversation's later packets;
+ *  the rest of the list is only tried if it doesn't recognize them.
+ *  Dissectors whose prefilters a packet doesn't pass aren't called.
+ *
  * @param sub_dissectors the sub-dissector list
  * @param tvb the tvbuff with the (remaining) packet data
  * @param pinfo the packet info of this packet (additional info)
@@ -522,6 +559,25 @@ WS_DLL_PUBLIC heur_dtbl_entry_t* find_heur_dissector_by_unique_short_name(const
 WS_DLL_PUBLIC void heur_dissector_add(const char *name, heur_dissector_t dissector,
     const char *display_name, const char *internal_name, const int proto, heuristic_enable_e enable);
 
+/** Set the prefilter of a heuristic dissector, which must have been added
+ *  with heur_dissector_add().  The signature must end within the first
+ *  HEUR_PREFILTER_MAX_END bytes of the packet.
+ *  Call this in the proto_handoff function of the sub-dissector.
+ *
+ * @param internal_name the name the dissector was added with, e.g. "rtcp_udp"
+ * @param prefilter the test; it is copied
+ */
+WS_DLL_PUBLIC void heur_dissector_set_prefilter(const char *internal_name,
+    const heur_prefilter_t *prefilter);
+
+/** Get the counts of what dissector_try_heuristic() did with a list.
+ *
+ * @param sub_dissectors the sub-dissector list
+ * @param stats filled in with the counts
+ */
+WS_DLL_PUBLIC void heur_dissector_list_get_stats(heur_dissector_list_t sub_dissectors,
+    heur_dissector_list_stats_t *stats);
+
 /** Remove a sub-dissector from a heuristic dissector list.
  *  Call this in the prefs_reinit function of the sub-dissector.
  *
@@ -3681,6 +3681,14 @@ prefs_register_modules(void)
                                    "Currently only ICMP and ICMPv6 use this preference to add VLAN ID to conversation tracking",
                                    &prefs.strict_conversation_tracking_heuristics);
 
+    prefs_register_uint_preference(protocols_module, "decoded_data_cache_size",
+                                   "Decoded data cache size (MB)",
+                                   "How many megabytes of decompressed or otherwise decoded data to keep, "
+                                   "so that it needn't be decoded again when packets are dissected again. "
+                                   "0 turns the cache off.",
+                                   10,
+                                   &prefs.decode_cache_size);
+
     /* Obsolete preferences
      * These "modules" were reorganized/renamed to correspond to their GUI
      * configuration screen within the preferences dialog
@@ -4176,6 +4184,7 @@ pre_init_prefs(void)
 
 /* set the default values for the tap/statistics dialog box */
     prefs.tap_update_interval    = TAP_UPDATE_DEFAULT_INTERVAL;
+    prefs.decode_cache_size      = DECODE_CACHE_DEFAULT_SIZE;
     prefs.st_enable_burstinfo = TRUE;
     prefs.st_burst_showcount = FALSE;
     prefs.st_burst_resolution = ST_DEF_BURSTRES;
@@ -29,6 +29,7 @@ extern "C" {
 
 #define MAX_VAL_LEN  1024
 
+#define DECODE_CACHE_DEFAULT_SIZE 64
 #define TAP_UPDATE_DEFAULT_INTERVAL 3000
 #define ST_DEF_BURSTRES 5
 #define ST_DEF_BURSTLEN 100
@@ -203,6 +204,7 @@ typedef struct _e_prefs {
   gboolean     enable_incomplete_dissectors_check;
   gboolean     incomplete_dissectors_check_debug;
   gboolean     strict_conversation_tracking_heuristics;
+  guint        decode_cache_size;   /* MB of decoded data to keep; see decode_cache.h */
   gboolean     filter_expressions_old;  /* TRUE if old filter expressions preferences were loaded. */
   gboolean     gui_update_enabled;
   software_update_channel_e gui_update_channel;
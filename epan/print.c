@@ -178,7 +178,7 @@ proto_tree_print_node(proto_node *node, gpointer data)
         return;
 
     /* was a free format label produced? */
-    if (fi->rep) {
+    if (proto_item_get_rep(fi)) {
         label_ptr = fi->rep->representation;
     }
     else { /* no, make a generic label */
@@ -454,7 +454,7 @@ proto_tree_write_node_pdml(proto_node *node, gpointer data)
     /* Text label. It's printed as a field with no name. */
     if (fi->hfinfo->id == hf_text_only) {
         /* Get the text */
-        if (fi->rep) {
+        if (proto_item_get_rep(fi)) {
             label_ptr = fi->rep->representation;
         } else {
             label_ptr = "";
@@ -518,7 +518,7 @@ proto_tree_write_node_pdml(proto_node *node, gpointer data)
         print_escaped_xml(pdata->fh, fi->hfinfo->name);
 #endif
 
-        if (fi->rep) {
+        if (proto_item_get_rep(fi)) {
             fputs("\" showname=\"", pdata->fh);
             print_escaped_xml(pdata->fh, fi->rep->representation);
         } else {
@@ -991,7 +991,7 @@ write_json_proto_node_no_value(proto_node *node, write_json_data *pdata)
     field_info *fi = node->finfo;
 
     if (fi->hfinfo->type == FT_PROTOCOL) {
-        if (fi->rep) {
+        if (proto_item_get_rep(fi)) {
             json_dumper_value_string(pdata->dumper, fi->rep->representation);
         } else {
             gchar label_str[ITEM_LABEL_LENGTH];
@@ -1080,7 +1080,7 @@ proto_node_to_json_key(proto_node *node)
     // Check if node has abbreviated name.
     if (node->finfo->hfinfo->id != hf_text_only) {
         json_key = node->finfo->hfinfo->abbrev;
-    } else if (node->finfo->rep != NULL) {
+    } else if (proto_item_get_rep(node->finfo) != NULL) {
         json_key = node->finfo->rep->representation;
     } else {
         json_key = "";
@@ -1265,13 +1265,13 @@ ek_write_field_value(field_info *fi, write_json_data* pdata)
     char time_string[sizeof("YYYY-MM-DDTHH:MM:SS")];
 
     /* Text label */
-    if (fi->hfinfo->id == hf_text_only && fi->rep) {
+    if (fi->hfinfo->id == hf_text_only && proto_item_get_rep(fi)) {
         json_dumper_value_string(pdata->dumper, fi->rep->representation);
     } else {
         /* show, value, and unmaskedvalue attributes */
         switch(fi->hfinfo->type) {
         case FT_PROTOCOL:
-            if (fi->rep) {
+            if (proto_item_get_rep(fi)) {
                 json_dumper_value_string(pdata->dumper, fi->rep->representation);
             }
             else {
@@ -2089,6 +2089,26 @@ output_fields_valid(output_fields_t *fields)
     return invalid_fields;
 }
 
+/*
+ * Returns a new array with the ids of the fields and protocols, leaving
+ * out the columns, e.g. for priming an epan_dissect_t with them.
+ */
+GArray *
+output_fields_hfids(output_fields_t *fields)
+{
+    GArray            *hfids = g_array_new(FALSE, FALSE, sizeof(int));
+    header_field_info *hfinfo;
+    guint              i;
+
+    for (i = 0; fields->fields != NULL && i < fields->fields->len; i++) {
+        hfinfo = proto_registrar_get_byname((const gchar *)g_ptr_array_index(fields->fields, i));
+        if (hfinfo != NULL)
+            g_array_append_val(hfids, hfinfo->id);
+    }
+
+    return hfids;
+}
+
 gboolean output_fields_set_option(output_fields_t *info, gchar *option)
 {
     const gchar *option_name;
@@ -2533,7 +2553,7 @@ gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt)
     if (fi->hfinfo->id == hf_text_only) {
         /* Text label.
          * Get the text */
-        if (fi->rep) {
+        if (proto_item_get_rep(fi)) {
             return g_strdup(fi->rep->representation);
         }
         else {
@@ -2553,7 +2573,7 @@ gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt)
         {
         case FT_PROTOCOL:
             /* Print out the full details for the protocol. */
-            if (fi->rep) {
+            if (proto_item_get_rep(fi)) {
                 return g_strdup(fi->rep->representation);
             } else {
                 /* Just print out the protocol abbreviation */
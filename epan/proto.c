@@ -747,6 +747,77 @@ free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
 	g_ptr_array_free(ptrs, TRUE);
 }
 
+/*
+ * In selective mode, the protocols that the fields primed for the current
+ * packet belong to, and which of them have been reached.  A dissector of
+ * any other protocol is skipped once all of them have been reached.
+ */
+#define PROTO_SELECTION_MAX	32
+
+struct _proto_selection_t {
+	gboolean    suspended;	/* TRUE while e.g. postdissectors run */
+	gboolean    unbounded;	/* a primed field needs every layer */
+	guint       num_needed;
+	int         needed[PROTO_SELECTION_MAX];
+	guint32     all;	/* one bit per needed protocol */
+	guint32     seen;	/* ... set once it has been reached */
+	GHashTable *kept;	/* protocols that are never skipped */
+};
+
+static void
+proto_selection_reset(struct _proto_selection_t *sel)
+{
+	sel->suspended = FALSE;
+	sel->unbounded = FALSE;
+	sel->num_needed = 0;
+	sel->all = 0;
+	sel->seen = 0;
+}
+
+static void
+proto_selection_free(struct _proto_selection_t *sel)
+{
+	if (sel == NULL)
+		return;
+	if (sel->kept)
+		g_hash_table_destroy(sel->kept);
+	g_free(sel);
+}
+
+static void
+proto_selection_add(struct _proto_selection_t *sel, header_field_info *hfinfo)
+{
+	header_field_info *proto_hfinfo;
+	int                proto_id;
+	guint              i;
+
+	proto_id = hfinfo->parent == -1 ? hfinfo->id : hfinfo->parent;
+	PROTO_REGISTRAR_GET_NTH(proto_id, proto_hfinfo);
+
+	/*
+	 * The _ws pseudo-protocols (expert info, malformed packets, ...)
+	 * can be added by any layer, and frame.protocols lists all of
+	 * them, so neither can be tied to a layer to stop at.
+	 */
+	if (g_str_has_prefix(proto_hfinfo->abbrev, "_ws.") ||
+	    strcmp(hfinfo->abbrev, "frame.protocols") == 0) {
+		sel->unbounded = TRUE;
+		return;
+	}
+
+	for (i = 0; i < sel->num_needed; i++) {
+		if (sel->needed[i] == proto_id)
+			return;
+	}
+	if (sel->num_needed == PROTO_SELECTION_MAX) {
+		sel->unbounded = TRUE;
+		return;
+	}
+	sel->needed[sel->num_needed] = proto_id;
+	sel->all |= 1U << sel->num_needed;
+	sel->num_needed++;
+}
+
 static void
 proto_tree_free_node(proto_node *node, gpointer data _U_)
 {
@@ -777,6 +848,10 @@ proto_tree_reset(proto_tree *tree)
 	/* Reset track of the number of children */
 	tree_data->count = 0;
 
+	/* The needed protocols are primed again for the next packet */
+	if (tree_data->selection)
+		proto_selection_reset(tree_data->selection);
+
 	PROTO_NODE_INIT(tree);
 }
 
@@ -798,6 +873,8 @@ proto_tree_free(proto_tree *tree)
 		g_hash_table_destroy(tree_data->interesting_hfids);
 	}
 
+	proto_selection_free(tree_data->selection);
+
 	g_slice_free(tree_data_t, tree_data);
 
 	g_slice_free(proto_tree, tree);
@@ -823,6 +900,78 @@ proto_tree_set_fake_protocols(proto_tree *tree, gboolean fake_protocols)
 	PTREE_DATA(tree)->fake_protocols = fake_protocols;
 }
 
+void
+proto_tree_set_selective(proto_tree *tree, gboolean selective)
+{
+	tree_data_t *tree_data = PTREE_DATA(tree);
+
+	if (selective) {
+		if (tree_data->selection == NULL)
+			tree_data->selection = g_new0(struct _proto_selection_t, 1);
+	} else {
+		proto_selection_free(tree_data->selection);
+		tree_data->selection = NULL;
+	}
+}
+
+void
+proto_tree_keep_protocol(proto_tree *tree, const int proto_id)
+{
+	struct _proto_selection_t *sel = PTREE_DATA(tree)->selection;
+
+	if (sel == NULL)
+		return;
+	if (sel->kept == NULL)
+		sel->kept = g_hash_table_new(g_direct_hash, g_direct_equal);
+	g_hash_table_add(sel->kept, GINT_TO_POINTER(proto_id));
+}
+
+gboolean
+proto_tree_selective_enter(proto_tree *tree, const int proto_id, guint32 *saved)
+{
+	struct _proto_selection_t *sel;
+	guint i;
+
+	*saved = 0;
+	if (tree == NULL || (sel = PTREE_DATA(tree)->selection) == NULL ||
+	    sel->num_needed == 0)
+		return TRUE;
+
+	*saved = sel->seen;
+	for (i = 0; i < sel->num_needed; i++) {
+		if (sel->needed[i] == proto_id) {
+			sel->seen |= 1U << i;
+			return TRUE;
+		}
+	}
+
+	/* Not needed itself; skip it if the needed ones are all done. */
+	if (sel->suspended || sel->unbounded || sel->seen != sel->all)
+		return TRUE;
+	return sel->kept != NULL &&
+	    g_hash_table_contains(sel->kept, GINT_TO_POINTER(proto_id));
+}
+
+void
+proto_tree_selective_restore(proto_tree *tree, guint32 saved)
+{
+	if (tree != NULL && PTREE_DATA(tree)->selection != NULL)
+		PTREE_DATA(tree)->selection->seen = saved;
+}
+
+gboolean
+proto_tree_selective_suspend(proto_tree *tree, gboolean suspend)
+{
+	struct _proto_selection_t *sel;
+	gboolean old_suspended;
+
+	if (tree == NULL || (sel = PTREE_DATA(tree)->selection) == NULL)
+		return FALSE;
+	old_suspended = sel->suspended;
+	sel->suspended = suspend;
+	return old_suspended;
+}
+
 /* Assume dissector set only its protocol fields.
    This function is called by dissectors and allows the speeding up of filtering
    in wireshark; if this function returns FALSE it is safe to reset tree to NULL
@@ -6071,6 +6220,7 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 		FI_SET_FLAG(fi, FI_HIDDEN);
 	fvalue_init(&fi->value, fi->hfinfo->type);
 	fi->rep        = NULL;
+	fi->rep_fmt    = NULL;
 
 	/* add the data source tvbuff */
 	fi->ds_tvb = tvb ? tvb_get_ds_tvb(tvb) : NULL;
@@ -6081,6 +6231,509 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 	return fi;
 }
 
+/*
+ * Labels set with a printf-style format - by proto_tree_add_XXX_format(),
+ * proto_tree_add_XXX_format_value(), proto_item_set_text(),
+ * proto_item_append_text() and proto_item_prepend_text() - aren't
+ * rendered when they're set.  The format and a copy of its arguments
+ * are added to a list of label_fmt_t's hanging off the field_info, and
+ * the list is only rendered into fi->rep when the label is asked for
+ * with proto_item_get_rep().  Trees are often built only to be filtered,
+ * or to have field values or a few labels taken from them, and then most
+ * of the formatting is never looked at.
+ *
+ * Strings are copied, at most ITEM_LABEL_LENGTH bytes of them, as they
+ * may not outlive the call.  Formats with conversions we don't know how
+ * to capture, with positional arguments or with too many arguments are
+ * rendered right away, as before.
+ */
+#define LABEL_FMT_MAX_ARGS	16
+#define LABEL_FMT_MAX_SPEC	32
+
+typedef enum {
+	LABEL_FMT_SET,		/* the label is the format */
+	LABEL_FMT_SET_VALUE,	/* the label is "name: " and the format */
+	LABEL_FMT_DEFAULT,	/* the label is the proto_item_fill_label() one */
+	LABEL_FMT_APPEND,	/* append the format to the label */
+	LABEL_FMT_PREPEND	/* prepend the format to the label */
+} label_fmt_op_t;
+
+typedef enum {
+	LABEL_ARG_INT,
+	LABEL_ARG_LONG,
+	LABEL_ARG_LLONG,
+	LABEL_ARG_SIZE,
+	LABEL_ARG_INTMAX,
+	LABEL_ARG_PTRDIFF,
+	LABEL_ARG_DOUBLE,
+	LABEL_ARG_STRING,
+	LABEL_ARG_POINTER
+} label_arg_type_t;
+
+typedef union {
+	int		 i;
+	long		 l;
+	gint64		 ll;
+	gssize		 z;
+	intmax_t	 j;
+	ptrdiff_t	 t;
+	double		 d;
+	const char	*s;
+	const void	*p;
+} label_arg_t;
+
+/* One conversion in a format. */
+typedef struct {
+	const char	*start;		/* the '%' */
+	const char	*end;		/* just past the conversion character */
+	guint		 stars;		/* number of '*' width and precision arguments */
+	gboolean	 star_precision;	/* the precision is the last of them */
+	int		 precision;	/* the precision, or -1 */
+	label_arg_type_t type;
+} label_conv_t;
+
+struct _item_label_fmt_t {
+	struct _item_label_fmt_t *next;
+	wmem_allocator_t	*pool;
+	label_fmt_op_t		 op;
+	const char		*format;
+	label_arg_t		*args;
+};
+
+/*
+ * Find the next conversion in a format.  Returns 1 if there's one,
+ * 0 at the end of the format, and -1 if it's one we can't capture.
+ */
+static int
+label_fmt_next_conv(const char *p, label_conv_t *conv)
+{
+	enum { LEN_NONE, LEN_L, LEN_LL, LEN_Z, LEN_J, LEN_T } len = LEN_NONE;
+
+	for (;;) {
+		p = strchr(p, '%');
+		if (p == NULL)
+			return 0;
+		if (p[1] != '%')
+			break;
+		p += 2;
+	}
+
+	conv->start = p++;
+	conv->stars = 0;
+	conv->star_precision = FALSE;
+	conv->precision = -1;
+
+	/* Flags. */
+	while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0' || *p == '\'')
+		p++;
+
+	/* Width. */
+	if (*p == '*') {
+		conv->stars++;
+		p++;
+	} else {
+		while (g_ascii_isdigit(*p))
+			p++;
+	}
+	if (*p == '$')
+		return -1;
+
+	/* Precision. */
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			conv->stars++;
+			conv->star_precision = TRUE;
+			p++;
+		} else {
+			conv->precision = 0;
+			while (g_ascii_isdigit(*p)) {
+				if (conv->precision < ITEM_LABEL_LENGTH)
+					conv->precision = conv->precision * 10 + (*p - '0');
+				p++;
+			}
+		}
+	}
+
+	/* Length modifier. */
+	switch (*p) {
+
+	case 'h':
+		p++;
+		if (*p == 'h')
+			p++;
+		break;
+
+	case 'l':
+		p++;
+		if (*p == 'l') {
+			p++;
+			len = LEN_LL;
+		} else
+			len = LEN_L;
+		break;
+
+	case 'q':
+		p++;
+		len = LEN_LL;
+		break;
+
+	case 'z':
+		p++;
+		len = LEN_Z;
+		break;
+
+	case 'j':
+		p++;
+		len = LEN_J;
+		break;
+
+	case 't':
+		p++;
+		len = LEN_T;
+		break;
+
+	case 'I':
+		/* G_GINT64_MODIFIER on Windows */
+		if (p[1] != '6' || p[2] != '4')
+			return -1;
+		p += 3;
+		len = LEN_LL;
+		break;
+	}
+
+	switch (*p) {
+
+	case 'd':
+	case 'i':
+	case 'u':
+	case 'o':
+	case 'x':
+	case 'X':
+		switch (len) {
+		case LEN_NONE:	conv->type = LABEL_ARG_INT; break;
+		case LEN_L:	conv->type = LABEL_ARG_LONG; break;
+		case LEN_LL:	conv->type = LABEL_ARG_LLONG; break;
+		case LEN_Z:	conv->type = LABEL_ARG_SIZE; break;
+		case LEN_J:	conv->type = LABEL_ARG_INTMAX; break;
+		case LEN_T:	conv->type = LABEL_ARG_PTRDIFF; break;
+		}
+		break;
+
+	case 'c':
+		if (len != LEN_NONE)
+			return -1;
+		conv->type = LABEL_ARG_INT;
+		break;
+
+	case 'e':
+	case 'E':
+	case 'f':
+	case 'F':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A':
+		if (len != LEN_NONE && len != LEN_L)
+			return -1;
+		conv->type = LABEL_ARG_DOUBLE;
+		break;
+
+	case 's':
+		if (len != LEN_NONE)
+			return -1;
+		conv->type = LABEL_ARG_STRING;
+		break;
+
+	case 'p':
+		if (len != LEN_NONE)
+			return -1;
+		conv->type = LABEL_ARG_POINTER;
+		break;
+
+	default:
+		return -1;
+	}
+
+	conv->end = p + 1;
+	if (conv->end - conv->start >= LABEL_FMT_MAX_SPEC)
+		return -1;
+	return 1;
+}
+
+/*
+ * Capture a format and its arguments.  Returns NULL if they have to be
+ * rendered right away; ap isn't used up either way.
+ */
+static item_label_fmt_t *
+label_fmt_new(wmem_allocator_t *pool, label_fmt_op_t op, const char *format,
+	      va_list ap)
+{
+	label_arg_t	  args[LABEL_FMT_MAX_ARGS];
+	gsize		  str_lens[LABEL_FMT_MAX_ARGS];
+	label_conv_t	  conv;
+	item_label_fmt_t *lf;
+	va_list		  aq;
+	const char	 *p = format;
+	gsize		  format_len, strings_len = 0, limit, n;
+	guint		  nargs = 0, i;
+	char		 *buf;
+	int		  r;
+
+	G_VA_COPY(aq, ap);
+	while ((r = label_fmt_next_conv(p, &conv)) == 1) {
+		if (nargs + conv.stars + 1 > LABEL_FMT_MAX_ARGS) {
+			r = -1;
+			break;
+		}
+		for (i = 0; i < conv.stars; i++) {
+			str_lens[nargs] = 0;
+			args[nargs++].i = va_arg(aq, int);
+		}
+		if (conv.star_precision)
+			conv.precision = args[nargs - 1].i < 0 ? -1 : args[nargs - 1].i;
+
+		str_lens[nargs] = 0;
+		switch (conv.type) {
+		case LABEL_ARG_INT:	args[nargs].i = va_arg(aq, int); break;
+		case LABEL_ARG_LONG:	args[nargs].l = va_arg(aq, long); break;
+		case LABEL_ARG_LLONG:	args[nargs].ll = va_arg(aq, gint64); break;
+		case LABEL_ARG_SIZE:	args[nargs].z = va_arg(aq, gssize); break;
+		case LABEL_ARG_INTMAX:	args[nargs].j = va_arg(aq, intmax_t); break;
+		case LABEL_ARG_PTRDIFF:	args[nargs].t = va_arg(aq, ptrdiff_t); break;
+		case LABEL_ARG_DOUBLE:	args[nargs].d = va_arg(aq, double); break;
+		case LABEL_ARG_POINTER:	args[nargs].p = va_arg(aq, const void *); break;
+
+		case LABEL_ARG_STRING:
+			args[nargs].s = va_arg(aq, const char *);
+			if (args[nargs].s != NULL) {
+				/*
+				 * Nothing past the precision, if any, or
+				 * past what fits in a label can show up,
+				 * and the string may not be terminated
+				 * before the precision.
+				 */
+				limit = ITEM_LABEL_LENGTH;
+				if (conv.precision >= 0 && (gsize)conv.precision < limit)
+					limit = conv.precision;
+				for (n = 0; n < limit && args[nargs].s[n] != '\0'; n++)
+					;
+				str_lens[nargs] = n + 1;
+				strings_len += n + 1;
+			}
+			break;
+		}
+		nargs++;
+		p = conv.end;
+	}
+	va_end(aq);
+
+	if (r < 0)
+		return NULL;
+
+	format_len = strlen(format) + 1;
+	lf = wmem_new(pool, item_label_fmt_t);
+	lf->next = NULL;
+	lf->pool = pool;
+	lf->op = op;
+	lf->args = nargs ? (label_arg_t *)wmem_memdup(pool, args, nargs * sizeof(label_arg_t)) : NULL;
+	buf = (char *)wmem_alloc(pool, format_len + strings_len);
+	memcpy(buf, format, format_len);
+	lf->format = buf;
+	buf += format_len;
+	for (i = 0; i < nargs; i++) {
+		if (str_lens[i] != 0) {
+			memcpy(buf, lf->args[i].s, str_lens[i] - 1);
+			buf[str_lens[i] - 1] = '\0';
+			lf->args[i].s = buf;
+			buf += str_lens[i];
+		}
+	}
+	return lf;
+}
+
+/*
+ * Render a captured format into label_str, which has room for size
+ * bytes; returns the length the result would have had if there'd been
+ * room for all of it, like g_snprintf().
+ */
+#define LABEL_FMT_SNPRINTF(val) \
+	(conv.stars == 0 ? g_snprintf(out, (gulong)room, spec, val) : \
+	 conv.stars == 1 ? g_snprintf(out, (gulong)room, spec, args[0].i, val) : \
+	 g_snprintf(out, (gulong)room, spec, args[0].i, args[1].i, val))
+
+static int
+label_fmt_render(const item_label_fmt_t *lf, char *label_str, gsize size)
+{
+	const label_arg_t *args = lf->args;
+	const char	  *p = lf->format;
+	label_conv_t	   conv;
+	char		   spec[LABEL_FMT_MAX_SPEC];
+	char		  *out;
+	gsize		   len = 0, room;
+	int		   ret;
+
+	for (;;) {
+		gboolean more = label_fmt_next_conv(p, &conv) == 1;
+		const char *lit_end = more ? conv.start : p + strlen(p);
+
+		/* The text up to the conversion, with "%%" turned into '%'. */
+		while (p < lit_end) {
+			if (len + 1 < size)
+				label_str[len] = *p;
+			len++;
+			p += (p[0] == '%' && p[1] == '%') ? 2 : 1;
+		}
+		if (!more)
+			break;
+
+		memcpy(spec, conv.start, conv.end - conv.start);
+		spec[conv.end - conv.start] = '\0';
+		out = label_str + MIN(len, size - 1);
+		room = size - MIN(len, size - 1);
+
+		switch (conv.type) {
+		case LABEL_ARG_INT:	ret = LABEL_FMT_SNPRINTF(args[conv.stars].i); break;
+		case LABEL_ARG_LONG:	ret = LABEL_FMT_SNPRINTF(args[conv.stars].l); break;
+		case LABEL_ARG_LLONG:	ret = LABEL_FMT_SNPRINTF(args[conv.stars].ll); break;
+		case LABEL_ARG_SIZE:	ret = LABEL_FMT_SNPRINTF(args[conv.stars].z); break;
+		case LABEL_ARG_INTMAX:	ret = LABEL_FMT_SNPRINTF(args[conv.stars].j); break;
+		case LABEL_ARG_PTRDIFF:	ret = LABEL_FMT_SNPRINTF(args[conv.stars].t); break;
+		case LABEL_ARG_DOUBLE:	ret = LABEL_FMT_SNPRINTF(args[conv.stars].d); break;
+		case LABEL_ARG_STRING:	ret = LABEL_FMT_SNPRINTF(args[conv.stars].s); break;
+		case LABEL_ARG_POINTER:	ret = LABEL_FMT_SNPRINTF(args[conv.stars].p); break;
+		default:		ret = 0; break;
+		}
+		if (ret > 0)
+			len += ret;
+		args += conv.stars + 1;
+		p = conv.end;
+	}
+	label_str[MIN(len, size - 1)] = '\0';
+	return (int)MIN(len, G_MAXINT);
+}
+
+/*
+ * Put the bitfield, if any, and the field name at the start of a label
+ * set with proto_tree_add_XXX_format_value(); returns their length.
+ */
+static int
+label_fill_value_prefix(field_info *fi, char *label_str)
+{
+	header_field_info *hf = fi->hfinfo;
+	int		   ret = 0;
+
+	if (hf->bitmask && (hf->type == FT_BOOLEAN || IS_FT_UINT(hf->type))) {
+		guint64 val;
+		char *p;
+
+		if (IS_FT_UINT32(hf->type))
+			val = fvalue_get_uinteger(&fi->value);
+		else
+			val = fvalue_get_uinteger64(&fi->value);
+
+		val <<= hfinfo_bitshift(hf);
+
+		p = decode_bitfield_value(label_str, val, hf->bitmask, hfinfo_container_bitwidth(hf));
+		ret = (int) (p - label_str);
+	}
+
+	/* put in the hf name */
+	ret += g_snprintf(label_str + ret, ITEM_LABEL_LENGTH - ret, "%s: ", hf->name);
+	return ret;
+}
+
+/* Render the captured formats of an item into fi->rep. */
+static void
+label_fmt_render_all(field_info *fi)
+{
+	item_label_fmt_t *lf = fi->rep_fmt;
+	char		 *label_str;
+	char		  representation[ITEM_LABEL_LENGTH];
+	size_t		  curlen;
+	int		  ret;
+
+	fi->rep_fmt = NULL;
+	ITEM_LABEL_NEW(lf->pool, fi->rep);
+	label_str = fi->rep->representation;
+	label_str[0] = '\0';
+
+	for (; lf != NULL; lf = lf->next) {
+		switch (lf->op) {
+
+		case LABEL_FMT_SET:
+			if (label_fmt_render(lf, label_str, ITEM_LABEL_LENGTH) >= ITEM_LABEL_LENGTH) {
+				/* Uh oh, we don't have enough room.  Tell the user
+				 * that the field is truncated.
+				 */
+				LABEL_MARK_TRUNCATED_START(label_str);
+			}
+			break;
+
+		case LABEL_FMT_SET_VALUE:
+			ret = label_fill_value_prefix(fi, label_str);
+			/* If possible, Put in the value of the string */
+			if (ret < ITEM_LABEL_LENGTH)
+				ret += label_fmt_render(lf, label_str + ret, ITEM_LABEL_LENGTH - ret);
+			if (ret >= ITEM_LABEL_LENGTH) {
+				/* Uh oh, we don't have enough room.  Tell the user
+				 * that the field is truncated.
+				 */
+				LABEL_MARK_TRUNCATED_START(label_str);
+			}
+			break;
+
+		case LABEL_FMT_DEFAULT:
+			proto_item_fill_label(fi, label_str);
+			break;
+
+		case LABEL_FMT_APPEND:
+			curlen = strlen(label_str);
+			if (ITEM_LABEL_LENGTH > curlen)
+				label_fmt_render(lf, label_str + curlen, ITEM_LABEL_LENGTH - curlen);
+			break;
+
+		case LABEL_FMT_PREPEND:
+			g_strlcpy(representation, label_str, ITEM_LABEL_LENGTH);
+			label_fmt_render(lf, label_str, ITEM_LABEL_LENGTH);
+			g_strlcat(label_str, representation, ITEM_LABEL_LENGTH);
+			break;
+		}
+	}
+}
+
+/* Add a captured format to the end of the formats of an item. */
+static void
+label_fmt_add(field_info *fi, item_label_fmt_t *lf)
+{
+	item_label_fmt_t **tail = &fi->rep_fmt;
+
+	while (*tail != NULL)
+		tail = &(*tail)->next;
+	*tail = lf;
+}
+
+/* A "format" for the default representation. */
+static item_label_fmt_t *
+label_fmt_default(wmem_allocator_t *pool)
+{
+	item_label_fmt_t *lf = wmem_new0(pool, item_label_fmt_t);
+
+	lf->pool = pool;
+	lf->op = LABEL_FMT_DEFAULT;
+	return lf;
+}
+
+item_label_t *
+proto_item_get_rep(field_info *fi)
+{
+	if (fi == NULL)
+		return NULL;
+	if (fi->rep_fmt != NULL)
+		label_fmt_render_all(fi);
+	return fi->rep;
+}
+
 /* If the protocol tree is to be visible, set the representation of a
    proto_tree entry with the name of the field for the item and with
    the value formatted with the supplied printf-style format and
@@ -6093,32 +6746,17 @@ proto_tree_set_representation_value(proto_item *pi, const char *format, va_list
 	/* If the tree (GUI) or item isn't visible it's pointless for us to generate the protocol
 	 * items string representation */
 	if (PTREE_DATA(pi)->visible && !proto_item_is_hidden(pi)) {
-		int               ret = 0;
+		int               ret;
 		field_info        *fi = PITEM_FINFO(pi);
-		header_field_info *hf;
 
 		DISSECTOR_ASSERT(fi);
 
-		hf = fi->hfinfo;
+		fi->rep_fmt = label_fmt_new(PNODE_POOL(pi), LABEL_FMT_SET_VALUE, format, ap);
+		if (fi->rep_fmt != NULL)
+			return;
 
 		ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
-		if (hf->bitmask && (hf->type == FT_BOOLEAN || IS_FT_UINT(hf->type))) {
-			guint64 val;
-			char *p;
-
-			if (IS_FT_UINT32(hf->type))
-				val = fvalue_get_uinteger(&fi->value);
-			else
-				val = fvalue_get_uinteger64(&fi->value);
-
-			val <<= hfinfo_bitshift(hf);
-
-			p = decode_bitfield_value(fi->rep->representation, val, hf->bitmask, hfinfo_container_bitwidth(hf));
-			ret = (int) (p - fi->rep->representation);
-		}
-
-		/* put in the hf name */
-		ret += g_snprintf(fi->rep->representation + ret, ITEM_LABEL_LENGTH - ret, "%s: ", hf->name);
+		ret = label_fill_value_prefix(fi, fi->rep->representation);
 
 		/* If possible, Put in the value of the string */
 		if (ret < ITEM_LABEL_LENGTH) {
@@ -6146,6 +6784,10 @@ proto_tree_set_representation(proto_item *pi, const char *format, va_list ap)
 	DISSECTOR_ASSERT(fi);
 
 	if (!proto_item_is_hidden(pi)) {
+		fi->rep_fmt = label_fmt_new(PNODE_POOL(pi), LABEL_FMT_SET, format, ap);
+		if (fi->rep_fmt != NULL)
+			return;
+
 		ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
 		ret = g_vsnprintf(fi->rep->representation, ITEM_LABEL_LENGTH,
 				  format, ap);
@@ -6676,6 +7318,7 @@ proto_item_set_text(proto_item *pi, const char *format, ...)
 		ITEM_LABEL_FREE(PNODE_POOL(pi), fi->rep);
 		fi->rep = NULL;
 	}
+	fi->rep_fmt = NULL;
 
 	va_start(ap, format);
 	proto_tree_set_representation(pi, format, ap);
@@ -6687,6 +7330,7 @@ void
 proto_item_append_text(proto_item *pi, const char *format, ...)
 {
 	field_info *fi = NULL;
+	item_label_fmt_t *lf;
 	size_t      curlen;
 	va_list     ap;
 
@@ -6698,11 +7342,27 @@ proto_item_append_text(proto_item *pi, const char *format, ...)
 	}
 
 	if (!proto_item_is_hidden(pi)) {
+		if (fi->rep == NULL) {
+			/*
+			 * Defer it, after the default representation
+			 * if we don't already have one.
+			 */
+			va_start(ap, format);
+			lf = label_fmt_new(PNODE_POOL(pi), LABEL_FMT_APPEND, format, ap);
+			va_end(ap);
+			if (lf != NULL) {
+				if (fi->rep_fmt == NULL)
+					label_fmt_add(fi, label_fmt_default(PNODE_POOL(pi)));
+				label_fmt_add(fi, lf);
+				return;
+			}
+		}
+
 		/*
 		 * If we don't already have a representation,
 		 * generate the default representation.
 		 */
-		if (fi->rep == NULL) {
+		if (proto_item_get_rep(fi) == NULL) {
 			ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
 			proto_item_fill_label(fi, fi->rep->representation);
 		}
@@ -6722,6 +7382,7 @@ void
 proto_item_prepend_text(proto_item *pi, const char *format, ...)
 {
 	field_info *fi = NULL;
+	item_label_fmt_t *lf;
 	char        representation[ITEM_LABEL_LENGTH];
 	va_list     ap;
 
@@ -6733,11 +7394,27 @@ proto_item_prepend_text(proto_item *pi, const char *format, ...)
 	}
 
 	if (!proto_item_is_hidden(pi)) {
+		if (fi->rep == NULL) {
+			/*
+			 * Defer it, after the default representation
+			 * if we don't already have one.
+			 */
+			va_start(ap, format);
+			lf = label_fmt_new(PNODE_POOL(pi), LABEL_FMT_PREPEND, format, ap);
+			va_end(ap);
+			if (lf != NULL) {
+				if (fi->rep_fmt == NULL)
+					label_fmt_add(fi, label_fmt_default(PNODE_POOL(pi)));
+				label_fmt_add(fi, lf);
+				return;
+			}
+		}
+
 		/*
 		 * If we don't already have a representation,
 		 * generate the default representation.
 		 */
-		if (fi->rep == NULL) {
+		if (proto_item_get_rep(fi) == NULL) {
 			ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
 			proto_item_fill_label(fi, representation);
 		} else
@@ -6863,6 +7540,9 @@ proto_tree_create_root(packet_info *pinfo)
 	/* Keep track of the number of children */
 	pnode->tree_data->count = 0;
 
+	/* Dissect everything unless asked not to */
+	pnode->tree_data->selection = NULL;
+
 	return (proto_tree *)pnode;
 }
 
@@ -6870,11 +7550,15 @@ proto_tree_create_root(packet_info *pinfo)
 /* "prime" a proto_tree with a single hfid that a dfilter
  * is interested in. */
 void
-proto_tree_prime_with_hfid(proto_tree *tree _U_, const gint hfid)
+proto_tree_prime_with_hfid(proto_tree *tree, const gint hfid)
 {
 	header_field_info *hfinfo;
 
 	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
+	/* in selective mode, remember which layer has to be reached */
+	if (tree != NULL && PTREE_DATA(tree)->selection != NULL)
+		proto_selection_add(PTREE_DATA(tree)->selection, hfinfo);
+
 	/* this field is referenced by a filter so increase the refcount.
 	   also increase the refcount for the parent, i.e the protocol.
 	*/
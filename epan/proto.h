@@ -749,6 +749,8 @@ typedef struct _item_label_t {
 } item_label_t;
 
 /** Contains the field information for the proto_item. */
+typedef struct _item_label_fmt_t item_label_fmt_t;
+
 typedef struct field_info {
     header_field_info   *hfinfo;          /**< pointer to registered field information */
     gint                 start;           /**< current start of data in field_info.ds_tvb */
@@ -757,7 +759,8 @@ typedef struct field_info {
     gint                 appendix_length; /**< length of appendix data */
     gint                 tree_type;       /**< one of ETT_ or -1 */
     guint32              flags;           /**< bitfield like FI_GENERATED, ... */
-    item_label_t        *rep;             /**< string for GUI tree */
+    item_label_t        *rep;             /**< string for GUI tree; use proto_item_get_rep() */
+    item_label_fmt_t    *rep_fmt;         /**< formats of the string, if not rendered yet */
     tvbuff_t            *ds_tvb;          /**< data source tvbuff */
     fvalue_t             value;
 } field_info;
@@ -832,6 +835,7 @@ typedef struct {
     gboolean             fake_protocols;
     gint                 count;
     struct _packet_info *pinfo;
+    struct _proto_selection_t *selection;
 } tree_data_t;
 
 /** Each proto_tree, proto_item is one of these. */
@@ -1146,6 +1150,45 @@ proto_tree_set_fake_protocols(proto_tree *tree, gboolean fake_protocols);
 extern void
 proto_tree_prime_with_hfid(proto_tree *tree, const int hfid);
 
+/** Set whether only the protocols that the primed fields belong to, and
+ the layers below them, should be dissected. Once every such protocol has
+ been reached in a packet, the dissectors of other protocols are not
+ called. Nothing is skipped for a packet if no field has been primed.
+ @param tree the tree to be set
+ @param selective TRUE to stop dissecting below the needed protocols */
+extern void
+proto_tree_set_selective(proto_tree *tree, gboolean selective);
+
+/** Always dissect a protocol in selective mode, for instance because it
+ keeps state, such as reassembly, that a needed protocol relies on.
+ @param tree the tree to be set
+ @param proto_id the protocol to keep */
+extern void
+proto_tree_keep_protocol(proto_tree *tree, const int proto_id);
+
+/** Called before the dissector of a protocol is called. Returns FALSE if
+ the protocol is not needed in selective mode, in which case the dissector
+ should not be called; otherwise marks the protocol as reached.
+ @param tree the tree the dissector adds to, may be NULL
+ @param proto_id the protocol of the dissector
+ @param saved where to save the state for proto_tree_selective_restore()
+ @return FALSE if the dissector can be skipped */
+extern gboolean
+proto_tree_selective_enter(proto_tree *tree, const int proto_id, guint32 *saved);
+
+/** Undo a proto_tree_selective_enter() if the dissector rejected the data.
+ @param tree the tree passed to proto_tree_selective_enter()
+ @param saved the state it saved */
+extern void
+proto_tree_selective_restore(proto_tree *tree, guint32 saved);
+
+/** Suspend or resume selective dissection, e.g. while postdissectors run.
+ @param tree the tree to be set
+ @param suspend TRUE to dissect everything for now
+ @return the old value */
+extern gboolean
+proto_tree_selective_suspend(proto_tree *tree, gboolean suspend);
+
 /** Get a parent item of a subtree.
  @param tree the tree to get the parent from
  @return parent item */
@@ -2346,6 +2389,14 @@ proto_tree_add_debug_text(proto_tree *tree, const char *format,
 WS_DLL_PUBLIC void
 proto_item_fill_label(field_info *fi, gchar *label_str);
 
+/** Get the string set for an item with a format, rendering it first if
+ that hasn't been done yet.
+ @param fi the item to get the string of
+ @return the string, or NULL if none was set, in which case
+ proto_item_fill_label() gives the item's label */
+WS_DLL_PUBLIC item_label_t *
+proto_item_get_rep(field_info *fi);
+
 /** Register a new protocol.
  @param name the full name of the new protocol
  @param short_name abbreviated name of the new protocol
@@ -11,6 +11,8 @@
 #ifndef __REGISTER_INT_H__
 #define __REGISTER_INT_H__
 
+#include <stdio.h>
+
 #include "register.h"
 
 #ifdef __cplusplus
@@ -19,7 +21,8 @@ extern "C" {
 
 /** Call each dissector's protocol registration routine.
  *
- * Each routine is called in alphabetical order from a worker thread.
+ * Each routine is called in alphabetical order, from a worker thread if
+ * cb is non-NULL so that progress can be reported.
  * Registration routines might call any number of routines which are not
  * thread safe, such as wmem_alloc. Callbacks should handle themselves
  * accordingly.
@@ -32,7 +35,7 @@ void register_all_protocols(register_cb cb, gpointer client_data);
 
 /** Call each dissector's protocol handoff routine.
  *
- * Each routine is called from a worker thread. Registration routines
+ * Each routine is called from a worker thread if cb is non-NULL. Registration routines
  * might call any number of routines which are not thread safe, such as
  * wmem_alloc. Callbacks should handle themselves accordingly.
  *
@@ -42,8 +45,53 @@ void register_all_protocols(register_cb cb, gpointer client_data);
  */
 void register_all_protocol_handoffs(register_cb cb, gpointer client_data);
 
+/** Only call the registration and handoff routines of the named protocols,
+ * plus the few that libwireshark needs itself and those that register the
+ * dissector handles they look up (see register_dependency). Must be called
+ * before register_all_protocols and may be called more than once.
+ *
+ * @param protocols Comma-separated list of names, matched against the
+ * XXX in "proto_register_XXX" and "proto_reg_handoff_XXX".
+ */
+void register_set_only_protocols(const char *protocols);
+
+/** Whether the protocol that a handle, table or heuristic list belongs to
+ * was left out by register_set_only_protocols, in which case it's no bug
+ * that it doesn't exist. Names that can't be matched to a protocol count
+ * as left out too.
+ *
+ * @param name The name of the handle, table or list.
+ * @return TRUE if only some protocols are registered and its protocol
+ * isn't one of them.
+ */
+gboolean register_owner_skipped(const char *name);
+
+/** Called when a registration or handoff routine looks up a dissector
+ * handle, or adds to a dissector table or heuristic list. If only some
+ * protocols are being registered, the protocol the name belongs to is
+ * registered now if it wasn't already, so that the table or handle exists.
+ * If handoff is TRUE, because the handle is going to be called, its handoff
+ * routine is called along with the others as well, so that it gets the
+ * dissectors it calls in turn.
+ *
+ * @param name The name of the handle, table or list.
+ * @param handoff Whether to call the protocol's handoff routine too.
+ * @return TRUE if a protocol was registered.
+ */
+gboolean register_dependency(const char *name, gboolean handoff);
+
 gulong register_count(void);
 
+/** Record how long each registration and handoff routine takes. Must be
+ * called before register_all_protocols.
+ */
+void register_enable_profile(void);
+
+/** Write the routine totals and the max_entries slowest routines recorded
+ * since register_enable_profile was called.
+ */
+void register_write_profile(FILE *fh, guint max_entries);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -11,6 +11,10 @@
 #include "register-int.h"
 #include "ws_attributes.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <glib.h>
 #include "epan/dissectors/dissectors.h"
 
@@ -22,19 +26,192 @@ static GAsyncQueue *register_cb_done_q;
 
 #define CB_WAIT_TIME (150 * 1000) // microseconds
 
+// Per-routine run times in microseconds, indexed like dissector_reg_proto
+// and dissector_reg_handoff. Only allocated when profiling is enabled.
+static gint64 *reg_proto_usecs;
+static gint64 *reg_handoff_usecs;
+
+// If non-NULL, only the routines for these protocol names are called.
+static GHashTable *only_protocols;
+
+// Which routines have been called, indexed like dissector_reg_proto and
+// dissector_reg_handoff. Only allocated when only_protocols is set, since
+// protocols can then be added to it while the routines are being called.
+static gboolean *reg_proto_done;
+static gboolean *reg_handoff_done;
+
+// TRUE while the built-in registration or handoff routines are being called.
+static gboolean registering;
+
+// Maps lower case protocol names to their index in dissector_reg_proto plus 1,
+// for register_dependency.
+static GHashTable *reg_proto_by_name;
+
+// Routines that libwireshark itself depends on; see packet_cache_proto_handles.
+static const char *required_protocols[] = { "frame", "file", "data", NULL };
+
+#define PROTO_REGISTER_PREFIX "proto_register_"
+#define PROTO_REG_HANDOFF_PREFIX "proto_reg_handoff_"
+
 static void set_cb_name(const char *proto) {
     g_mutex_lock(&cur_cb_name_mtx);
     cur_cb_name = proto;
     g_mutex_unlock(&cur_cb_name_mtx);
 }
 
+static gboolean
+reg_routine_wanted(const char *cb_name, const char *prefix)
+{
+    size_t prefix_len = strlen(prefix);
+
+    if (!only_protocols) {
+        return TRUE;
+    }
+    if (strncmp(cb_name, prefix, prefix_len) != 0) {
+        return TRUE;
+    }
+    return g_hash_table_contains(only_protocols, cb_name + prefix_len);
+}
+
+static void
+call_reg_routine(const dissector_reg_t *reg, gulong i, gint64 *usecs, gboolean *done, gboolean show_progress)
+{
+    gint64 start_time = 0;
+
+    if (done) {
+        done[i] = TRUE;
+    }
+    if (show_progress) {
+        set_cb_name(reg[i].cb_name);
+    }
+    if (usecs) {
+        start_time = g_get_monotonic_time();
+    }
+    reg[i].cb_func();
+    if (usecs) {
+        usecs[i] = g_get_monotonic_time() - start_time;
+    }
+}
+
+static void
+call_reg_routines(const dissector_reg_t *reg, gulong count, const char *prefix, gint64 *usecs, gboolean *done, gboolean show_progress)
+{
+    gboolean called;
+
+    registering = TRUE;
+    do {
+        /*
+         * A routine can add a protocol to only_protocols (see
+         * register_dependency), so go round again for those that come
+         * before it.
+         */
+        called = FALSE;
+        for (gulong i = 0; i < count; i++) {
+            if ((done && done[i]) || !reg_routine_wanted(reg[i].cb_name, prefix)) {
+                continue;
+            }
+            call_reg_routine(reg, i, usecs, done, show_progress);
+            called = TRUE;
+        }
+    } while (done && called);
+    registering = FALSE;
+}
+
+static gboolean
+find_reg_proto(const char *name, size_t name_len, gulong *idx)
+{
+    gchar *key;
+    gpointer value;
+
+    if (!reg_proto_by_name) {
+        size_t prefix_len = strlen(PROTO_REGISTER_PREFIX);
+
+        reg_proto_by_name = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        for (gulong i = 0; i < dissector_reg_proto_count; i++) {
+            g_hash_table_insert(reg_proto_by_name,
+                    g_ascii_strdown(dissector_reg_proto[i].cb_name + prefix_len, -1),
+                    GSIZE_TO_POINTER(i + 1));
+        }
+    }
+
+    key = g_ascii_strdown(name, (gssize)name_len);
+    value = g_hash_table_lookup(reg_proto_by_name, key);
+    g_free(key);
+    if (!value) {
+        return FALSE;
+    }
+    *idx = (gulong)GPOINTER_TO_SIZE(value) - 1;
+    return TRUE;
+}
+
+static gboolean
+find_owner(const char *name, gulong *idx)
+{
+    size_t name_len;
+
+    /*
+     * Handles, tables and heuristic lists are almost always named after
+     * their protocol, or are "<protocol>.<something>" or
+     * "<protocol>_<something>".
+     */
+    name_len = strlen(name);
+    if (find_reg_proto(name, name_len, idx)) {
+        return TRUE;
+    }
+    name_len = strcspn(name, "._-");
+    return name[name_len] != '\0' && find_reg_proto(name, name_len, idx);
+}
+
+gboolean register_dependency(const char *name, gboolean handoff)
+{
+    size_t prefix_len = strlen(PROTO_REGISTER_PREFIX);
+    gboolean registered = FALSE;
+    gulong idx;
+
+    if (!only_protocols || !registering) {
+        return FALSE;
+    }
+
+    if (!find_owner(name, &idx)) {
+        return FALSE;
+    }
+
+    if (!reg_proto_done[idx]) {
+        call_reg_routine(dissector_reg_proto, idx, reg_proto_usecs, reg_proto_done, FALSE);
+        registered = TRUE;
+    }
+    if (handoff) {
+        /* Its handoff routine is picked up by call_reg_routines. */
+        const char *proto_name = dissector_reg_proto[idx].cb_name + prefix_len;
+
+        if (!g_hash_table_contains(only_protocols, proto_name)) {
+            g_hash_table_add(only_protocols, g_strdup(proto_name));
+        }
+    }
+    return registered;
+}
+
+gboolean register_owner_skipped(const char *name)
+{
+    gulong idx;
+
+    if (!only_protocols) {
+        return FALSE;
+    }
+    /*
+     * If we can't tell whose it is, give it the benefit of the doubt;
+     * a startup with every protocol still reports it if it's missing.
+     */
+    if (!find_owner(name, &idx)) {
+        return TRUE;
+    }
+    return !reg_proto_done[idx];
+}
+
 static void *
 register_all_protocols_worker(void *arg _U_)
 {
-    for (gulong i = 0; i < dissector_reg_proto_count; i++) {
-        set_cb_name(dissector_reg_proto[i].cb_name);
-        dissector_reg_proto[i].cb_func();
-    }
+    call_reg_routines(dissector_reg_proto, dissector_reg_proto_count, PROTO_REGISTER_PREFIX, reg_proto_usecs, reg_proto_done, TRUE);
 
     g_async_queue_push(register_cb_done_q, GINT_TO_POINTER(TRUE));
     return NULL;
@@ -44,10 +221,16 @@ void
 register_all_protocols(register_cb cb, gpointer cb_data)
 {
     const char *cb_name;
-    register_cb_done_q = g_async_queue_new();
     gboolean called_back = FALSE;
     GThread *rapw_thread;
 
+    /* The worker thread only exists so that we can report progress. */
+    if (!cb) {
+        call_reg_routines(dissector_reg_proto, dissector_reg_proto_count, PROTO_REGISTER_PREFIX, reg_proto_usecs, reg_proto_done, FALSE);
+        return;
+    }
+
+    register_cb_done_q = g_async_queue_new();
     rapw_thread = g_thread_new("register_all_protocols_worker", &register_all_protocols_worker, NULL);
     while (!g_async_queue_timeout_pop(register_cb_done_q, CB_WAIT_TIME)) {
         g_mutex_lock(&cur_cb_name_mtx);
@@ -67,10 +250,7 @@ register_all_protocols(register_cb cb, gpointer cb_data)
 static void *
 register_all_protocol_handoffs_worker(void *arg _U_)
 {
-    for (gulong i = 0; i < dissector_reg_handoff_count; i++) {
-        set_cb_name(dissector_reg_handoff[i].cb_name);
-        dissector_reg_handoff[i].cb_func();
-    }
+    call_reg_routines(dissector_reg_handoff, dissector_reg_handoff_count, PROTO_REG_HANDOFF_PREFIX, reg_handoff_usecs, reg_handoff_done, TRUE);
 
     g_async_queue_push(register_cb_done_q, GINT_TO_POINTER(TRUE));
     return NULL;
@@ -84,6 +264,11 @@ register_all_protocol_handoffs(register_cb cb, gpointer cb_data)
     gboolean called_back = FALSE;
     GThread *raphw_thread;
 
+    if (!cb) {
+        call_reg_routines(dissector_reg_handoff, dissector_reg_handoff_count, PROTO_REG_HANDOFF_PREFIX, reg_handoff_usecs, reg_handoff_done, FALSE);
+        return;
+    }
+
     raphw_thread = g_thread_new("register_all_protocol_handoffs_worker", &register_all_protocol_handoffs_worker, NULL);
     while (!g_async_queue_timeout_pop(register_cb_done_q, CB_WAIT_TIME)) {
         g_mutex_lock(&cur_cb_name_mtx);
@@ -101,11 +286,93 @@ register_all_protocol_handoffs(register_cb cb, gpointer cb_data)
     g_async_queue_unref(register_cb_done_q);
 }
 
+void register_set_only_protocols(const char *protocols)
+{
+    gchar **names;
+    guint i;
+
+    if (!only_protocols) {
+        only_protocols = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        reg_proto_done = g_new0(gboolean, dissector_reg_proto_count);
+        reg_handoff_done = g_new0(gboolean, dissector_reg_handoff_count);
+        for (i = 0; required_protocols[i]; i++) {
+            g_hash_table_add(only_protocols, g_strdup(required_protocols[i]));
+        }
+    }
+
+    names = g_strsplit(protocols, ",", -1);
+    for (i = 0; names[i]; i++) {
+        g_strstrip(names[i]);
+        if (names[i][0] != '\0') {
+            g_hash_table_add(only_protocols, g_ascii_strdown(names[i], -1));
+        }
+    }
+    g_strfreev(names);
+}
+
 gulong register_count(void)
 {
     return dissector_reg_proto_count + dissector_reg_handoff_count;
 }
 
+void register_enable_profile(void)
+{
+    if (!reg_proto_usecs) {
+        reg_proto_usecs = g_new0(gint64, dissector_reg_proto_count);
+        reg_handoff_usecs = g_new0(gint64, dissector_reg_handoff_count);
+    }
+}
+
+typedef struct {
+    const char *cb_name;
+    gint64 usecs;
+} reg_profile_entry_t;
+
+static int
+reg_profile_entry_compare(const void *a, const void *b)
+{
+    gint64 ua = ((const reg_profile_entry_t *)a)->usecs;
+    gint64 ub = ((const reg_profile_entry_t *)b)->usecs;
+
+    return ua < ub ? 1 : (ua > ub ? -1 : 0);
+}
+
+void register_write_profile(FILE *fh, guint max_entries)
+{
+    gulong count = dissector_reg_proto_count + dissector_reg_handoff_count;
+    reg_profile_entry_t *entries;
+    gint64 proto_total = 0, handoff_total = 0;
+    gulong i;
+
+    if (!reg_proto_usecs) {
+        return;
+    }
+
+    entries = g_new(reg_profile_entry_t, count);
+    for (i = 0; i < dissector_reg_proto_count; i++) {
+        entries[i].cb_name = dissector_reg_proto[i].cb_name;
+        entries[i].usecs = reg_proto_usecs[i];
+        proto_total += reg_proto_usecs[i];
+    }
+    for (i = 0; i < dissector_reg_handoff_count; i++) {
+        entries[dissector_reg_proto_count + i].cb_name = dissector_reg_handoff[i].cb_name;
+        entries[dissector_reg_proto_count + i].usecs = reg_handoff_usecs[i];
+        handoff_total += reg_handoff_usecs[i];
+    }
+    qsort(entries, count, sizeof(reg_profile_entry_t), reg_profile_entry_compare);
+
+    fprintf(fh, "  %10.3f ms  %lu built-in registration routines\n",
+            proto_total / 1000.0, dissector_reg_proto_count);
+    fprintf(fh, "  %10.3f ms  %lu built-in handoff routines\n",
+            handoff_total / 1000.0, dissector_reg_handoff_count);
+    fprintf(fh, "  Slowest routines:\n");
+    for (i = 0; i < count && i < max_entries; i++) {
+        fprintf(fh, "  %10.3f ms  %s\n", entries[i].usecs / 1000.0, entries[i].cb_name);
+    }
+
+    g_free(entries);
+}
+
 /*
  * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
  *
@@ -167,6 +167,7 @@ sequence_analysis_info_new(void)
     /* SEQ_ANALYSIS_DEBUG("adding new item"); */
     sainfo->items = g_queue_new();
     sainfo->ht= g_hash_table_new(g_direct_hash, g_direct_equal);
+    sainfo->display_index = g_ptr_array_new();
     return sainfo;
 }
 
@@ -180,6 +181,7 @@ void sequence_analysis_info_free(seq_analysis_info_t *sainfo)
     g_queue_free(sainfo->items);
     if (sainfo->ht != NULL)
         g_hash_table_destroy(sainfo->ht);
+    g_ptr_array_free(sainfo->display_index, TRUE);
 
     g_free(sainfo);
 }
@@ -218,6 +220,10 @@ sequence_analysis_list_sort(seq_analysis_info_t *sainfo)
 {
     if (!sainfo) return;
     g_queue_sort(sainfo->items, sequence_analysis_sort_compare, NULL);
+
+    /* The index is in the old order. */
+    g_ptr_array_set_size(sainfo->display_index, 0);
+    sainfo->last_node_item = NULL;
 }
 
 void
@@ -262,33 +268,50 @@ static guint add_or_get_node(seq_analysis_info_t *sainfo, address *node) {
     }
 }
 
-struct sainfo_counter {
-    seq_analysis_info_t *sainfo;
-    int num_items;
-};
-
-static void sequence_analysis_get_nodes_item_proc(gpointer data, gpointer user_data)
+/* Get the nodes from the list */
+/****************************************************************************/
+int
+sequence_analysis_get_nodes(seq_analysis_info_t *sainfo)
 {
-    seq_analysis_item_t *gai = (seq_analysis_item_t *)data;
-    struct sainfo_counter *sc = (struct sainfo_counter *)user_data;
-    if (gai->display) {
-        (sc->num_items)++;
-        gai->src_node = add_or_get_node(sc->sainfo, &(gai->src_addr));
-        gai->dst_node = add_or_get_node(sc->sainfo, &(gai->dst_addr));
-    }
+    g_ptr_array_set_size(sainfo->display_index, 0);
+    sainfo->last_node_item = NULL;
+
+    return sequence_analysis_get_new_nodes(sainfo);
 }
 
-/* Get the nodes from the list */
+/* Get the nodes from the items added to the list since the last time */
 /****************************************************************************/
 int
-sequence_analysis_get_nodes(seq_analysis_info_t *sainfo)
+sequence_analysis_get_new_nodes(seq_analysis_info_t *sainfo)
 {
-    struct sainfo_counter sc = {sainfo, 0};
+    GList *list;
+    seq_analysis_item_t *gai;
 
-    /* Fill the node array */
-    g_queue_foreach(sainfo->items, sequence_analysis_get_nodes_item_proc, &sc);
+    if (sainfo->last_node_item != NULL)
+        list = g_list_next(sainfo->last_node_item);
+    else
+        list = g_queue_peek_head_link(sainfo->items);
+
+    /* Fill the node array and the index */
+    for (; list; list = g_list_next(list)) {
+        gai = (seq_analysis_item_t *)list->data;
+        if (gai->display) {
+            gai->src_node = add_or_get_node(sainfo, &(gai->src_addr));
+            gai->dst_node = add_or_get_node(sainfo, &(gai->dst_addr));
+            g_ptr_array_add(sainfo->display_index, gai);
+        }
+        sainfo->last_node_item = list;
+    }
 
-    return sc.num_items;
+    return sainfo->display_index->len;
+}
+
+seq_analysis_item_t *
+sequence_analysis_get_display_item(seq_analysis_info_t *sainfo, guint idx)
+{
+    if (idx >= sainfo->display_index->len)
+        return NULL;
+    return (seq_analysis_item_t *)g_ptr_array_index(sainfo->display_index, idx);
 }
 
 /* Free the node address list */
@@ -302,6 +325,9 @@ sequence_analysis_free_nodes(seq_analysis_info_t *sainfo)
         free_address(&sainfo->nodes[i]);
     }
     sainfo->num_nodes = 0;
+
+    g_ptr_array_set_size(sainfo->display_index, 0);
+    sainfo->last_node_item = NULL;
 }
 
 /* Writing analysis to file */
@@ -63,6 +63,8 @@ typedef struct _seq_analysis_info {
     GHashTable *ht;          /**< hash table of seq_analysis_info_t */
     address nodes[MAX_NUM_NODES]; /**< horizontal node list */
     guint32 num_nodes;       /**< actual number of nodes */
+    GPtrArray  *display_index;  /**< the displayed items, in list order */
+    GList      *last_node_item; /**< last item in the list whose nodes were looked up */
 } seq_analysis_info_t;
 
 /** Structure for information about a registered sequence analysis function */
@@ -174,13 +176,31 @@ WS_DLL_PUBLIC void sequence_analysis_list_sort(seq_analysis_info_t *sainfo);
  */
 WS_DLL_PUBLIC void sequence_analysis_list_free(seq_analysis_info_t *sainfo);
 
-/** Fill in the node address list
+/** Fill in the node address list, and the index of the displayed items
  *
  * @param sainfo Sequence analysis information.
  * @return The number of transaction items (not nodes) processed.
  */
 WS_DLL_PUBLIC int sequence_analysis_get_nodes(seq_analysis_info_t *sainfo);
 
+/** Add the nodes and displayed items of the items that were appended to
+ * the list since the last call to this function or to
+ * sequence_analysis_get_nodes, e.g. while the tap is still running.
+ * Items must only have been added at the tail of the list in the meantime.
+ *
+ * @param sainfo Sequence analysis information.
+ * @return The total number of displayed items.
+ */
+WS_DLL_PUBLIC int sequence_analysis_get_new_nodes(seq_analysis_info_t *sainfo);
+
+/** Get a displayed item by its position in the diagram.
+ *
+ * @param sainfo Sequence analysis information.
+ * @param idx Position of the item, from 0.
+ * @return The item, or NULL if idx is out of range.
+ */
+WS_DLL_PUBLIC seq_analysis_item_t *sequence_analysis_get_display_item(seq_analysis_info_t *sainfo, guint idx);
+
 /** Free the node address list
  *
  * @param sainfo Sequence analysis information.
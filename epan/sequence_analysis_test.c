@@ -0,0 +1,211 @@
+/* sequence_analysis_test.c
+ * Tests of the nodes and displayed items of a sequence analysis
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "sequence_analysis.h"
+
+/* Hosts are 10.0.0.<host>. */
+static seq_analysis_item_t *
+add_item(seq_analysis_info_t *sainfo, guint32 frame_number, guint8 src,
+         guint8 dst, gboolean display)
+{
+    seq_analysis_item_t *item = g_new0(seq_analysis_item_t, 1);
+    address addr;
+    guint32 ip;
+
+    item->frame_number = frame_number;
+    ip = g_htonl(0x0a000000 | src);
+    set_address(&addr, AT_IPv4, 4, &ip);
+    copy_address(&item->src_addr, &addr);
+    ip = g_htonl(0x0a000000 | dst);
+    set_address(&addr, AT_IPv4, 4, &ip);
+    copy_address(&item->dst_addr, &addr);
+    item->display = display;
+    item->src_node = G_MAXUINT;
+    item->dst_node = G_MAXUINT;
+    g_queue_push_tail(sainfo->items, item);
+    return item;
+}
+
+static guint8
+node_host(seq_analysis_info_t *sainfo, guint node)
+{
+    g_assert_cmpuint(node, <, sainfo->num_nodes);
+    return ((const guint8 *)sainfo->nodes[node].data)[3];
+}
+
+static void
+check_display_item(seq_analysis_info_t *sainfo, guint idx, guint32 frame_number)
+{
+    seq_analysis_item_t *item = sequence_analysis_get_display_item(sainfo, idx);
+
+    g_assert_nonnull(item);
+    g_assert_cmpuint(item->frame_number, ==, frame_number);
+}
+
+/* Items added after the nodes were looked up are added to the end of the
+   index, and the ones before them aren't looked at again. */
+static void
+sequence_analysis_test_append(void)
+{
+    seq_analysis_info_t *sainfo = sequence_analysis_info_new();
+    seq_analysis_item_t *item;
+
+    g_assert_cmpint(sequence_analysis_get_nodes(sainfo), ==, 0);
+    g_assert_cmpint(sequence_analysis_get_new_nodes(sainfo), ==, 0);
+
+    add_item(sainfo, 1, 1, 2, TRUE);
+    add_item(sainfo, 2, 2, 3, TRUE);
+    item = add_item(sainfo, 3, 1, 2, TRUE);
+    g_assert_cmpint(sequence_analysis_get_nodes(sainfo), ==, 3);
+    g_assert_cmpuint(sainfo->num_nodes, ==, 3);
+    g_assert_cmpuint(node_host(sainfo, 0), ==, 1);
+    g_assert_cmpuint(node_host(sainfo, 1), ==, 2);
+    g_assert_cmpuint(node_host(sainfo, 2), ==, 3);
+    g_assert_cmpuint(item->src_node, ==, 0);
+    g_assert_cmpuint(item->dst_node, ==, 1);
+
+    /* Nothing new. */
+    g_assert_cmpint(sequence_analysis_get_new_nodes(sainfo), ==, 3);
+    g_assert_cmpuint(sainfo->num_nodes, ==, 3);
+
+    item = add_item(sainfo, 4, 3, 4, TRUE);
+    add_item(sainfo, 5, 4, 1, TRUE);
+    g_assert_cmpint(sequence_analysis_get_new_nodes(sainfo), ==, 5);
+    g_assert_cmpuint(sainfo->num_nodes, ==, 4);
+    g_assert_cmpuint(node_host(sainfo, 3), ==, 4);
+    g_assert_cmpuint(item->src_node, ==, 2);
+    g_assert_cmpuint(item->dst_node, ==, 3);
+    check_display_item(sainfo, 0, 1);
+    check_display_item(sainfo, 2, 3);
+    check_display_item(sainfo, 3, 4);
+    check_display_item(sainfo, 4, 5);
+    g_assert_null(sequence_analysis_get_display_item(sainfo, 5));
+
+    /* Looking them all up again gives the same result. */
+    g_assert_cmpint(sequence_analysis_get_nodes(sainfo), ==, 5);
+    g_assert_cmpuint(sainfo->num_nodes, ==, 4);
+    check_display_item(sainfo, 4, 5);
+    g_assert_null(sequence_analysis_get_display_item(sainfo, 5));
+
+    sequence_analysis_info_free(sainfo);
+}
+
+/* Items that aren't displayed get no nodes and aren't in the index. */
+static void
+sequence_analysis_test_hidden(void)
+{
+    seq_analysis_info_t *sainfo = sequence_analysis_info_new();
+    seq_analysis_item_t *hidden;
+
+    add_item(sainfo, 1, 1, 2, TRUE);
+    hidden = add_item(sainfo, 2, 5, 6, FALSE);
+    add_item(sainfo, 3, 2, 1, TRUE);
+    g_assert_cmpint(sequence_analysis_get_nodes(sainfo), ==, 2);
+    g_assert_cmpuint(sainfo->num_nodes, ==, 2);
+    g_assert_cmpuint(hidden->src_node, ==, G_MAXUINT);
+    g_assert_cmpuint(hidden->dst_node, ==, G_MAXUINT);
+    check_display_item(sainfo, 0, 1);
+    check_display_item(sainfo, 1, 3);
+
+    /* The same goes for the ones that are added later, including one
+       that comes last. */
+    add_item(sainfo, 4, 7, 8, FALSE);
+    add_item(sainfo, 5, 2, 3, TRUE);
+    hidden = add_item(sainfo, 6, 9, 1, FALSE);
+    g_assert_cmpint(sequence_analysis_get_new_nodes(sainfo), ==, 3);
+    g_assert_cmpuint(sainfo->num_nodes, ==, 3);
+    g_assert_cmpuint(node_host(sainfo, 2), ==, 3);
+    g_assert_cmpuint(hidden->src_node, ==, G_MAXUINT);
+    check_display_item(sainfo, 2, 5);
+    g_assert_null(sequence_analysis_get_display_item(sainfo, 3));
+
+    /* And they're not looked at again. */
+    add_item(sainfo, 7, 3, 1, TRUE);
+    g_assert_cmpint(sequence_analysis_get_new_nodes(sainfo), ==, 4);
+    g_assert_cmpuint(sainfo->num_nodes, ==, 3);
+    check_display_item(sainfo, 3, 7);
+
+    sequence_analysis_info_free(sainfo);
+}
+
+/* Sorting the list, freeing the nodes or freeing the list starts the
+   index over. */
+static void
+sequence_analysis_test_reset(void)
+{
+    seq_analysis_info_t *sainfo = sequence_analysis_info_new();
+
+    add_item(sainfo, 3, 3, 1, TRUE);
+    add_item(sainfo, 1, 1, 2, TRUE);
+    add_item(sainfo, 2, 2, 3, FALSE);
+    g_assert_cmpint(sequence_analysis_get_nodes(sainfo), ==, 2);
+    check_display_item(sainfo, 0, 3);
+    check_display_item(sainfo, 1, 1);
+
+    sequence_analysis_list_sort(sainfo);
+    g_assert_null(sequence_analysis_get_display_item(sainfo, 0));
+    g_assert_cmpint(sequence_analysis_get_new_nodes(sainfo), ==, 2);
+    check_display_item(sainfo, 0, 1);
+    check_display_item(sainfo, 1, 3);
+    g_assert_null(sequence_analysis_get_display_item(sainfo, 2));
+    /* The nodes stay in the order they were first seen in. */
+    g_assert_cmpuint(sainfo->num_nodes, ==, 3);
+    g_assert_cmpuint(node_host(sainfo, 0), ==, 3);
+
+    sequence_analysis_free_nodes(sainfo);
+    g_assert_cmpuint(sainfo->num_nodes, ==, 0);
+    g_assert_null(sequence_analysis_get_display_item(sainfo, 0));
+    g_assert_cmpint(sequence_analysis_get_new_nodes(sainfo), ==, 2);
+    g_assert_cmpuint(sainfo->num_nodes, ==, 3);
+    g_assert_cmpuint(node_host(sainfo, 0), ==, 1);
+    g_assert_cmpuint(node_host(sainfo, 1), ==, 2);
+    g_assert_cmpuint(node_host(sainfo, 2), ==, 3);
+    check_display_item(sainfo, 0, 1);
+
+    /* Nothing is left of the freed items. */
+    sequence_analysis_list_free(sainfo);
+    g_assert_cmpuint(sainfo->num_nodes, ==, 0);
+    g_assert_cmpint(sequence_analysis_get_new_nodes(sainfo), ==, 0);
+    add_item(sainfo, 10, 4, 5, TRUE);
+    g_assert_cmpint(sequence_analysis_get_new_nodes(sainfo), ==, 1);
+    g_assert_cmpuint(node_host(sainfo, 0), ==, 4);
+    check_display_item(sainfo, 0, 10);
+
+    sequence_analysis_info_free(sainfo);
+}
+
+int
+main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/sequence_analysis/append", sequence_analysis_test_append);
+    g_test_add_func("/sequence_analysis/hidden", sequence_analysis_test_hidden);
+    g_test_add_func("/sequence_analysis/reset", sequence_analysis_test_reset);
+
+    return g_test_run();
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -23,11 +23,10 @@
 #include <glib.h>
 
 #include <epan/packet_info.h>
+#include <epan/epan_dissect.h>
 #include <epan/dfilter/dfilter.h>
 #include <epan/tap.h>
 
-static gboolean tapping_is_active=FALSE;
-
 typedef struct _tap_dissector_t {
 	struct _tap_dissector_t *next;
 	char *name;
@@ -35,11 +34,10 @@ typedef struct _tap_dissector_t {
 static tap_dissector_t *tap_dissector_list=NULL;
 
 /*
- * This is the list of free and used packets queued for a tap.
- * It is implemented here explicitly instead of using GLib objects
- * in order to be as fast as possible as we need to build and tear down the
- * queued list at least once for each packet we see and thus we must be able
- * to build and tear it down as fast as possible.
+ * This is the list of packets queued for the taps while a packet is being
+ * dissected. Each epan_dissect_t has its own, so that packets can be
+ * dissected with taps in more than one thread; the array is kept from one
+ * packet to the next, so that it's only allocated when it has to grow.
  *
  * XXX - some fields in packet_info get overwritten in the dissection
  * process, such as the addresses and the "this is an error packet" flag.
@@ -72,9 +70,18 @@ typedef struct _tap_packet_t {
 
 #define TAP_PACKET_IS_ERROR_PACKET	0x00000001	/* packet being queued is an error packet */
 
-#define TAP_PACKET_QUEUE_LEN 5000
-static tap_packet_t tap_packet_array[TAP_PACKET_QUEUE_LEN];
-static guint tap_packet_index;
+typedef struct _tap_queue_t {
+	GArray *packets;		/* tap_packet_t's queued for this packet */
+	struct _tap_queue_t *outer;	/* queue this one is nested in, if any */
+	tap_worker_t *worker;		/* where to keep per-thread tap state */
+	gboolean active;		/* between tap_queue_init() and tap_push_tapped_queue() */
+} tap_queue_t;
+
+/*
+ * The queue of the packet being dissected in this thread, if it's
+ * being dissected with taps.
+ */
+static GPrivate current_tap_queue;
 
 typedef struct _tap_listener_t {
 	struct _tap_listener_t *next;
@@ -89,10 +96,31 @@ typedef struct _tap_listener_t {
 	tap_packet_cb packet;
 	tap_draw_cb draw;
 	tap_finish_cb finish;
+	tap_partial_new_cb partial_new;
+	tap_merge_cb merge;
 } tap_listener_t;
 
 static tap_listener_t *tap_listener_queue=NULL;
 
+/*
+ * The listeners for each tap, in the same order as in tap_listener_queue,
+ * indexed by tap id, so that a queued packet is only handed to its own
+ * listeners. This is rebuilt when a listener is added or removed.
+ */
+static GPtrArray *tap_listener_index=NULL;
+
+/* The per-thread state of each mergeable listener. */
+typedef struct {
+	void *partial;		/* the partial state from partial_new() */
+	dfilter_t *code;	/* this thread's copy of the listener's filter */
+	gboolean needs_redraw;
+	gboolean failed;
+} tap_worker_slot_t;
+
+struct _tap_worker_t {
+	GHashTable *slots;	/* tap_listener_t * -> tap_worker_slot_t * */
+};
+
 #ifdef HAVE_PLUGINS
 static GSList *tap_plugins = NULL;
 
@@ -131,7 +159,58 @@ register_all_plugin_tap_listeners(void)
 void
 tap_init(void)
 {
-	tap_packet_index=0;
+	/* Nothing to do; the queues belong to the epan_dissect_t's. */
+}
+
+static void
+rebuild_tap_listener_index(void)
+{
+	tap_listener_t *tl;
+	GPtrArray *listeners;
+	guint i;
+
+	if(tap_listener_index){
+		for(i=0;i<tap_listener_index->len;i++){
+			listeners=(GPtrArray *)g_ptr_array_index(tap_listener_index, i);
+			if(listeners){
+				g_ptr_array_free(listeners, TRUE);
+			}
+		}
+		g_ptr_array_set_size(tap_listener_index, 0);
+	} else {
+		tap_listener_index=g_ptr_array_new();
+	}
+
+	for(tl=tap_listener_queue;tl;tl=tl->next){
+		if((guint)tl->tap_id>=tap_listener_index->len){
+			g_ptr_array_set_size(tap_listener_index, tl->tap_id+1);
+		}
+		listeners=(GPtrArray *)g_ptr_array_index(tap_listener_index, tl->tap_id);
+		if(!listeners){
+			listeners=g_ptr_array_new();
+			g_ptr_array_index(tap_listener_index, tl->tap_id)=listeners;
+		}
+		g_ptr_array_add(listeners, tl);
+	}
+}
+
+static inline GPtrArray *
+listeners_for_tap(int tap_id)
+{
+	if(!tap_listener_index || tap_id<=0 || (guint)tap_id>=tap_listener_index->len){
+		return NULL;
+	}
+	return (GPtrArray *)g_ptr_array_index(tap_listener_index, tap_id);
+}
+
+static tap_queue_t *
+get_tap_queue(epan_dissect_t *edt)
+{
+	if(!edt->tap_queue){
+		edt->tap_queue=g_new0(tap_queue_t, 1);
+		edt->tap_queue->packets=g_array_sized_new(FALSE, FALSE, sizeof(tap_packet_t), 32);
+	}
+	return edt->tap_queue;
 }
 
 /* **********************************************************************
@@ -209,28 +288,21 @@ register_tap(const char *name)
 void
 tap_queue_packet(int tap_id, packet_info *pinfo, const void *tap_specific_data)
 {
-	tap_packet_t *tpt;
+	tap_queue_t *queue;
+	tap_packet_t tpt;
 
-	if(!tapping_is_active){
-		return;
-	}
-	/*
-	 * XXX - should we allocate this with an ep_allocator,
-	 * rather than having a fixed maximum number of entries?
-	 */
-	if(tap_packet_index >= TAP_PACKET_QUEUE_LEN){
-		g_warning("Too many taps queued");
+	queue=(tap_queue_t *)g_private_get(&current_tap_queue);
+	if(!queue){
 		return;
 	}
 
-	tpt=&tap_packet_array[tap_packet_index];
-	tpt->tap_id=tap_id;
-	tpt->flags = 0;
+	tpt.tap_id=tap_id;
+	tpt.flags = 0;
 	if (pinfo->flags.in_error_pkt)
-		tpt->flags |= TAP_PACKET_IS_ERROR_PACKET;
-	tpt->pinfo=pinfo;
-	tpt->tap_specific_data=tap_specific_data;
-	tap_packet_index++;
+		tpt.flags |= TAP_PACKET_IS_ERROR_PACKET;
+	tpt.pinfo=pinfo;
+	tpt.tap_specific_data=tap_specific_data;
+	g_array_append_val(queue->packets, tpt);
 }
 
 
@@ -261,104 +333,159 @@ void tap_build_interesting (epan_dissect_t *edt)
 
 /* This function is used to delete/initialize the tap queue and prime an
    epan_dissect_t with all the filters for tap listeners.
-   To free the tap queue, we just prepend the used queue to the free queue.
+   The queue becomes the one this thread's dissectors queue packets to
+   until tap_push_tapped_queue() is called.
 */
 void
 tap_queue_init(epan_dissect_t *edt)
 {
+	tap_queue_t *queue;
+
 	/* nothing to do, just return */
 	if(!tap_listener_queue){
 		return;
 	}
 
-	tapping_is_active=TRUE;
-
-	tap_packet_index=0;
+	queue=get_tap_queue(edt);
+	if(queue->active){
+		return;
+	}
+	g_array_set_size(queue->packets, 0);
+	queue->outer=(tap_queue_t *)g_private_get(&current_tap_queue);
+	queue->active=TRUE;
+	g_private_set(&current_tap_queue, queue);
 
 	tap_build_interesting (edt);
 }
 
+/* Hand one queued packet to one listener, using the listener's per-thread
+   state if it has any and the edt has a worker.
+*/
+static void
+tap_call_listener(tap_listener_t *tl, const tap_packet_t *tp,
+		  epan_dissect_t *edt, tap_worker_t *worker)
+{
+	tap_worker_slot_t *slot;
+	void *tapdata=tl->tapdata;
+	dfilter_t *code=tl->code;
+	gboolean *needs_redraw=&tl->needs_redraw;
+	gboolean *failed=&tl->failed;
+	tap_packet_status status;
+	gchar *err_msg;
+
+	/* Don't tap the packet if it's an "error packet"
+	 * unless the listener has requested that we do so.
+	 */
+	if ((tp->flags & TAP_PACKET_IS_ERROR_PACKET) && !(tl->flags & TL_REQUIRES_ERROR_PACKETS)){
+		return;
+	}
+	if(!tl->packet){
+		/* There isn't a per-packet routine for this tap. */
+		return;
+	}
+
+	if(worker && tl->partial_new){
+		slot=(tap_worker_slot_t *)g_hash_table_lookup(worker->slots, tl);
+		if(!slot){
+			/* Filters keep state while they run, so each
+			 * thread needs its own copy.
+			 */
+			slot=g_new0(tap_worker_slot_t, 1);
+			slot->partial=tl->partial_new(tl->tapdata);
+			if(tl->fstring && !dfilter_compile(tl->fstring, &slot->code, &err_msg)){
+				g_free(err_msg);
+				slot->failed=TRUE;
+			}
+			g_hash_table_insert(worker->slots, tl, slot);
+		}
+		tapdata=slot->partial;
+		code=slot->code;
+		needs_redraw=&slot->needs_redraw;
+		failed=&slot->failed;
+	}
+
+	if(*failed){
+		/* A previous call failed, meaning "stop running this
+		 * tap", so don't call the packet routine.
+		 */
+		return;
+	}
+
+	/* If we have a filter, see if the packet passes. */
+	if(code){
+		if (!dfilter_apply_edt(code, edt)){
+			/* The packet didn't pass the filter. */
+			return;
+		}
+	}
+
+	/* So call the per-packet routine. */
+	status = tl->packet(tapdata, tp->pinfo, edt, tp->tap_specific_data);
+
+	switch (status) {
+
+	case TAP_PACKET_DONT_REDRAW:
+		break;
+
+	case TAP_PACKET_REDRAW:
+		*needs_redraw=TRUE;
+		break;
+
+	case TAP_PACKET_FAILED:
+		*failed=TRUE;
+		break;
+	}
+}
+
 /* this function is called after a packet has been fully dissected to push the tapped
    data to all extensions that has callbacks registered.
 */
 void
 tap_push_tapped_queue(epan_dissect_t *edt)
 {
+	tap_queue_t *queue=edt->tap_queue;
 	tap_packet_t *tp;
-	tap_listener_t *tl;
-	guint i;
+	GPtrArray *listeners;
+	guint i, j;
 
 	/* nothing to do, just return */
-	if(!tapping_is_active){
+	if(!queue || !queue->active){
 		return;
 	}
 
-	tapping_is_active=FALSE;
+	queue->active=FALSE;
+	g_private_set(&current_tap_queue, queue->outer);
+	queue->outer=NULL;
 
-	/* nothing to do, just return */
-	if(!tap_packet_index){
-		return;
+	/* loop over all queued packets and call the callback of each
+	   listener to that packet's tap whose filter the packet matches. */
+	for(i=0;i<queue->packets->len;i++){
+		tp=&g_array_index(queue->packets, tap_packet_t, i);
+		listeners=listeners_for_tap(tp->tap_id);
+		if(!listeners){
+			continue;
+		}
+		for(j=0;j<listeners->len;j++){
+			tap_call_listener((tap_listener_t *)g_ptr_array_index(listeners, j),
+					  tp, edt, queue->worker);
+		}
 	}
+}
 
-	/* loop over all tap listeners and call the listener callback
-	   for all packets that match the filter. */
-	for(i=0;i<tap_packet_index;i++){
-		for(tl=tap_listener_queue;tl;tl=tl->next){
-			tp=&tap_packet_array[i];
-			/* Don't tap the packet if it's an "error packet"
-			 * unless the listener has requested that we do so.
-			 */
-			if (!(tp->flags & TAP_PACKET_IS_ERROR_PACKET) || (tl->flags & TL_REQUIRES_ERROR_PACKETS))
-			{
-				if(tp->tap_id==tl->tap_id){
-					if(!tl->packet){
-						/* There isn't a per-packet
-						 * routine for this tap.
-						 */
-						continue;
-					}
-					if(tl->failed){
-						/* A previous call failed,
-						 * meaning "stop running this
-						 * tap", so don't call the
-						 * packet routine.
-						 */
-						continue;
-					}
-
-					/* If we have a filter, see if the
-					 * packet passes.
-					 */
-					if(tl->code){
-						if (!dfilter_apply_edt(tl->code, edt)){
-							/* The packet didn't
-							 * pass the filter. */
-							continue;
-						}
-					}
-
-					/* So call the per-packet routine. */
-					tap_packet_status status;
-
-					status = tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data);
-
-					switch (status) {
-
-					case TAP_PACKET_DONT_REDRAW:
-						break;
-
-					case TAP_PACKET_REDRAW:
-						tl->needs_redraw=TRUE;
-						break;
-
-					case TAP_PACKET_FAILED:
-						tl->failed=TRUE;
-						break;
-					}
-				}
-			}
-		}
+void
+tap_queue_free(epan_dissect_t *edt)
+{
+	tap_queue_t *queue=edt->tap_queue;
+
+	if(!queue){
+		return;
 	}
+	if(queue->active){
+		g_private_set(&current_tap_queue, queue->outer);
+	}
+	g_array_free(queue->packets, TRUE);
+	g_free(queue);
+	edt->tap_queue=NULL;
 }
 
 
@@ -379,22 +506,19 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 const void *
 fetch_tapped_data(int tap_id, int idx)
 {
+	tap_queue_t *queue;
 	tap_packet_t *tp;
 	guint i;
 
 	/* nothing to do, just return */
-	if(!tapping_is_active){
-		return NULL;
-	}
-
-	/* nothing to do, just return */
-	if(!tap_packet_index){
+	queue=(tap_queue_t *)g_private_get(&current_tap_queue);
+	if(!queue){
 		return NULL;
 	}
 
 	/* loop over all tapped packets and return the one with index idx */
-	for(i=0;i<tap_packet_index;i++){
-		tp=&tap_packet_array[i];
+	for(i=0;i<queue->packets->len;i++){
+		tp=&g_array_index(queue->packets, tap_packet_t, i);
 		if(tp->tap_id==tap_id){
 			if(!idx--){
 				return tp->tap_specific_data;
@@ -554,10 +678,28 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	tl->next=tap_listener_queue;
 
 	tap_listener_queue=tl;
+	rebuild_tap_listener_index();
 
 	return NULL;
 }
 
+/* this function lets a tap listener keep per-thread state
+ */
+gboolean
+set_tap_merge(void *tapdata, tap_partial_new_cb partial_new, tap_merge_cb merge)
+{
+	tap_listener_t *tl;
+
+	for(tl=tap_listener_queue;tl;tl=tl->next){
+		if(tl->tapdata==tapdata){
+			tl->partial_new=partial_new;
+			tl->merge=merge;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 /* this function sets a new dfilter to a tap listener
  */
 GString *
@@ -666,6 +808,7 @@ remove_tap_listener(void *tapdata)
 			return;
 		}
 	}
+	rebuild_tap_listener_index();
 	free_tap_listener(tl);
 }
 
@@ -693,16 +836,7 @@ tap_listeners_require_dissection(void)
 gboolean
 have_tap_listener(int tap_id)
 {
-	tap_listener_t *tap_queue = tap_listener_queue;
-
-	while(tap_queue) {
-		if(tap_queue->tap_id == tap_id)
-			return TRUE;
-
-		tap_queue = tap_queue->next;
-	}
-
-	return FALSE;
+	return listeners_for_tap(tap_id) != NULL;
 }
 
 /*
@@ -737,6 +871,72 @@ union_of_tap_listener_flags(void)
 	return flags;
 }
 
+/*
+ * Return TRUE if every tap listener with a per-packet routine can keep
+ * per-thread state, FALSE otherwise.
+ */
+gboolean
+tap_listeners_can_merge(void)
+{
+	tap_listener_t *tl;
+
+	for(tl=tap_listener_queue;tl;tl=tl->next){
+		if(tl->packet && !tl->partial_new)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+tap_worker_t *
+tap_worker_new(void)
+{
+	tap_worker_t *worker;
+
+	worker=g_new(tap_worker_t, 1);
+	worker->slots=g_hash_table_new(g_direct_hash, g_direct_equal);
+	return worker;
+}
+
+void
+tap_worker_attach(epan_dissect_t *edt, tap_worker_t *worker)
+{
+	get_tap_queue(edt)->worker=worker;
+}
+
+void
+tap_worker_merge(tap_worker_t *worker)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	tap_listener_t *tl;
+	tap_worker_slot_t *slot;
+
+	g_hash_table_iter_init(&iter, worker->slots);
+	while(g_hash_table_iter_next(&iter, &key, &value)){
+		tl=(tap_listener_t *)key;
+		slot=(tap_worker_slot_t *)value;
+		tl->merge(tl->tapdata, slot->partial);
+		if(slot->needs_redraw)
+			tl->needs_redraw=TRUE;
+		if(slot->failed)
+			tl->failed=TRUE;
+		dfilter_free(slot->code);
+		g_free(slot);
+		g_hash_table_iter_remove(&iter);
+	}
+}
+
+void
+tap_worker_free(tap_worker_t *worker)
+{
+	if(!worker)
+		return;
+
+	tap_worker_merge(worker);
+	g_hash_table_destroy(worker->slots);
+	g_free(worker);
+}
+
 void tap_cleanup(void)
 {
 	tap_listener_t *elem_lq;
@@ -749,6 +949,10 @@ void tap_cleanup(void)
 		head_lq = head_lq->next;
 		free_tap_listener(elem_lq);
 	}
+	tap_listener_queue = NULL;
+	rebuild_tap_listener_index();
+	g_ptr_array_free(tap_listener_index, TRUE);
+	tap_listener_index = NULL;
 
 	while(head_dl){
 		elem_dl = head_dl;
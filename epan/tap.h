@@ -35,6 +35,11 @@ typedef void (*tap_reset_cb)(void *tapdata);
 typedef tap_packet_status (*tap_packet_cb)(void *tapdata, packet_info *pinfo, epan_dissect_t *edt, const void *data);
 typedef void (*tap_draw_cb)(void *tapdata);
 typedef void (*tap_finish_cb)(void *tapdata);
+typedef void *(*tap_partial_new_cb)(void *tapdata);
+typedef void (*tap_merge_cb)(void *tapdata, void *partial);
+
+/** Per-thread state of the tap listeners; see set_tap_merge(). */
+typedef struct _tap_worker_t tap_worker_t;
 
 /**
  * Flags to indicate what a tap listener's packet routine requires.
@@ -117,7 +122,8 @@ WS_DLL_PUBLIC void tap_build_interesting(epan_dissect_t *edt);
 
 /** This function is used to delete/initialize the tap queue and prime an
  *  epan_dissect_t with all the filters for tap listeners.
- *  To free the tap queue, we just prepend the used queue to the free queue.
+ *  The queue belongs to the epan_dissect_t, and is where packets are queued
+ *  in this thread until tap_push_tapped_queue() is called.
  */
 extern void tap_queue_init(epan_dissect_t *edt);
 
@@ -127,6 +133,9 @@ extern void tap_queue_init(epan_dissect_t *edt);
 
 extern void tap_push_tapped_queue(epan_dissect_t *edt);
 
+/** Free the tap queue of an epan_dissect_t. */
+extern void tap_queue_free(epan_dissect_t *edt);
+
 /** This function is called after a packet has been fully dissected to push the tapped
  *  data to all extensions that has callbacks registered.
  */
@@ -223,6 +232,50 @@ WS_DLL_PUBLIC GString *register_tap_listener(const char *tapname, void *tapdata,
     tap_packet_cb tap_packet, tap_draw_cb tap_draw,
     tap_finish_cb tap_finish) G_GNUC_WARN_UNUSED_RESULT;
 
+/** This function lets a tap listener's statistics be computed in more than
+ * one thread at once and then combined. It returns FALSE if there's no
+ * listener with that tapdata.
+ *
+ * @param tapdata     The listener's instance identifier.
+ * @param partial_new void *(*partial_new)(void *tapdata)
+ *                    Returns a new, empty piece of state that the listener's
+ *                    packet routine can be handed instead of tapdata. It's
+ *                    called in a thread the first time that thread has a
+ *                    packet for the listener.
+ * @param merge       void (*merge)(void *tapdata, void *partial)
+ *                    Adds what was gathered in partial to tapdata and frees
+ *                    partial. It's called from tap_worker_merge(), in the
+ *                    thread that calls that.
+ *
+ * To use it, give each dissection thread a tap_worker_t, attach it to the
+ * thread's epan_dissect_t with tap_worker_attach(), and merge the workers
+ * with tap_worker_merge() before drawing. Listeners must not be added,
+ * removed or refiltered while a worker has unmerged state.
+ */
+WS_DLL_PUBLIC gboolean set_tap_merge(void *tapdata, tap_partial_new_cb partial_new,
+    tap_merge_cb merge);
+
+/** Return TRUE if every tap listener with a per-packet routine can keep
+ * per-thread state, i.e. if packets can be dissected with taps in more
+ * than one thread; listeners that can't are called with their own tapdata
+ * even if the epan_dissect_t has a worker.
+ */
+WS_DLL_PUBLIC gboolean tap_listeners_can_merge(void);
+
+/** Create the per-thread state of the tap listeners for one thread. */
+WS_DLL_PUBLIC tap_worker_t *tap_worker_new(void);
+
+/** Have the taps of packets dissected with edt use worker's state. */
+WS_DLL_PUBLIC void tap_worker_attach(epan_dissect_t *edt, tap_worker_t *worker);
+
+/** Merge the state gathered by worker into the tap listeners, and start
+ * worker over. The dissection thread must not be using worker meanwhile.
+ */
+WS_DLL_PUBLIC void tap_worker_merge(tap_worker_t *worker);
+
+/** Merge what's left in worker, then free it. */
+WS_DLL_PUBLIC void tap_worker_free(tap_worker_t *worker);
+
 /** This function sets a new dfilter to a tap listener */
 WS_DLL_PUBLIC GString *set_tap_dfilter(void *tapdata, const char *fstring);
 
@@ -0,0 +1,397 @@
+/* tap_test.c
+ * Tests of the tap listener index, the tap queues of each epan_dissect_t,
+ * and tap listeners with per-thread state
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "epan.h"
+#include "epan_dissect.h"
+#include "frame_data.h"
+#include "packet.h"
+#include "tap.h"
+#include <wiretap/wtap.h>
+#include <wsutil/pint.h>
+
+/* More than the 5000 taps the queue used to be limited to. */
+#define MANY_TAPS       6000
+#define THREAD_FRAMES   1000
+
+static epan_t *session;
+static guint32 frame_count;
+
+static int proto_tap_test = -1;
+static int hf_count = -1;
+static int tap_test_tap = -1;
+
+/* What fetch_tapped_data() returned in the test dissector. */
+static const void *fetched_first;
+static const void *fetched_past_end;
+
+/* The order in which listeners were called, by name. */
+static GString *call_log;
+
+/* Dissection isn't thread-safe, so threads take turns. */
+static GMutex dissect_lock;
+
+typedef struct {
+    const char *name;
+    GThread *thread;    /* the thread that owns partial state */
+    guint packets;
+    guint64 total;
+    guint draws;
+} tap_sum_t;
+
+/* A frame is a count, and the test tap is queued with 1 to count. */
+static int
+dissect_tap_test(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data _U_)
+{
+    guint count = tvb_get_ntohs(tvb, 0);
+    guint i;
+
+    proto_tree_add_item(tree, hf_count, tvb, 0, 2, ENC_BIG_ENDIAN);
+    for (i = 1; i <= count; i++)
+        tap_queue_packet(tap_test_tap, pinfo, GUINT_TO_POINTER(i));
+    fetched_first = fetch_tapped_data(tap_test_tap, 0);
+    fetched_past_end = fetch_tapped_data(tap_test_tap, count);
+    return tvb_captured_length(tvb);
+}
+
+static const nstime_t *
+get_frame_ts(struct packet_provider_data *prov _U_, guint32 frame_num _U_)
+{
+    static nstime_t empty;
+
+    return &empty;
+}
+
+static void
+dissect_count(epan_dissect_t *edt, guint16 count, gboolean with_taps)
+{
+    guint8 buf[8];
+    wtap_rec rec;
+    frame_data fd;
+    tvbuff_t *tvb;
+
+    memset(buf, 0, sizeof buf);
+    phton16(buf, count);
+    memset(&rec, 0, sizeof rec);
+    rec.rec_type = REC_TYPE_PACKET;
+    rec.presence_flags = WTAP_HAS_TS | WTAP_HAS_CAP_LEN;
+    rec.rec_header.packet_header.caplen = sizeof buf;
+    rec.rec_header.packet_header.len = sizeof buf;
+    rec.rec_header.packet_header.pkt_encap = WTAP_ENCAP_USER0;
+
+    frame_data_init(&fd, ++frame_count, &rec, 0, 0);
+    tvb = tvb_new_real_data(buf, sizeof buf, sizeof buf);
+    if (with_taps)
+        epan_dissect_run_with_taps(edt, WTAP_FILE_TYPE_SUBTYPE_UNKNOWN, &rec, tvb, &fd, NULL);
+    else
+        epan_dissect_run(edt, WTAP_FILE_TYPE_SUBTYPE_UNKNOWN, &rec, tvb, &fd, NULL);
+    frame_data_destroy(&fd);
+    epan_dissect_reset(edt);
+}
+
+static tap_packet_status
+sum_packet(void *tapdata, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const void *data)
+{
+    tap_sum_t *sum = (tap_sum_t *)tapdata;
+
+    if (sum->thread != NULL)
+        g_assert(sum->thread == g_thread_self());
+    sum->packets++;
+    sum->total += GPOINTER_TO_UINT(data);
+    if (call_log != NULL)
+        g_string_append(call_log, sum->name);
+    return TAP_PACKET_REDRAW;
+}
+
+static void
+sum_draw(void *tapdata)
+{
+    ((tap_sum_t *)tapdata)->draws++;
+}
+
+static void *
+sum_partial_new(void *tapdata)
+{
+    tap_sum_t *partial = g_new0(tap_sum_t, 1);
+
+    partial->name = ((tap_sum_t *)tapdata)->name;
+    partial->thread = g_thread_self();
+    return partial;
+}
+
+static void
+sum_merge(void *tapdata, void *partial)
+{
+    tap_sum_t *sum = (tap_sum_t *)tapdata;
+    tap_sum_t *part = (tap_sum_t *)partial;
+
+    sum->packets += part->packets;
+    sum->total += part->total;
+    g_free(part);
+}
+
+static void
+add_listener(const char *tapname, tap_sum_t *sum, const char *fstring)
+{
+    GString *error_string;
+
+    error_string = register_tap_listener(tapname, sum, fstring, TL_REQUIRES_NOTHING,
+            NULL, sum_packet, sum_draw, NULL);
+    g_assert_null(error_string);
+}
+
+/* Each queued packet goes to its own tap's listeners, in the order in which
+   they're listed, whatever is added and removed. */
+static void
+tap_test_index(void)
+{
+    tap_sum_t a = { "a", NULL, 0, 0, 0 };
+    tap_sum_t b = { "b", NULL, 0, 0, 0 };
+    tap_sum_t f = { "f", NULL, 0, 0, 0 };
+    int frame_tap = find_tap_id("frame");
+    epan_dissect_t *edt = epan_dissect_new(session, FALSE, FALSE);
+
+    g_assert_cmpint(frame_tap, >, 0);
+    g_assert(!have_tap_listener(tap_test_tap));
+    g_assert(!have_tap_listener(frame_tap));
+    g_assert(!have_tap_listener(1000));
+
+    add_listener("tap_test", &a, NULL);
+    add_listener("frame", &f, NULL);
+    add_listener("tap_test", &b, NULL);
+    g_assert(have_tap_listener(tap_test_tap));
+    g_assert(have_tap_listener(frame_tap));
+    g_assert(!have_tap_listener(1000));
+
+    /* The listeners are listed newest first, and the frame tap is queued
+       after the frame's contents have been dissected. */
+    call_log = g_string_new("");
+    dissect_count(edt, 2, TRUE);
+    g_assert_cmpstr(call_log->str, ==, "babaf");
+    g_assert_cmpuint(a.packets, ==, 2);
+    g_assert_cmpuint(a.total, ==, 3);
+    g_assert_cmpuint(b.packets, ==, 2);
+    g_assert_cmpuint(f.packets, ==, 1);
+
+    remove_tap_listener(&b);
+    g_string_truncate(call_log, 0);
+    dissect_count(edt, 1, TRUE);
+    g_assert_cmpstr(call_log->str, ==, "af");
+
+    /* A tap whose last listener is gone has none, while others still do. */
+    remove_tap_listener(&a);
+    g_assert(!have_tap_listener(tap_test_tap));
+    g_assert(have_tap_listener(frame_tap));
+    g_string_truncate(call_log, 0);
+    dissect_count(edt, 3, TRUE);
+    g_assert_cmpstr(call_log->str, ==, "f");
+
+    remove_tap_listener(&f);
+    g_assert(!have_tap_listener(frame_tap));
+    g_string_truncate(call_log, 0);
+    dissect_count(edt, 3, TRUE);
+    g_assert_cmpstr(call_log->str, ==, "");
+    g_assert_cmpuint(a.packets, ==, 3);
+    g_assert_cmpuint(b.packets, ==, 2);
+    g_assert_cmpuint(f.packets, ==, 3);
+
+    g_string_free(call_log, TRUE);
+    call_log = NULL;
+    epan_dissect_free(edt);
+}
+
+/* Taps are queued to the epan_dissect_t being dissected with taps, however
+   many there are, and not while dissecting without them. */
+static void
+tap_test_queue(void)
+{
+    tap_sum_t a = { "a", NULL, 0, 0, 0 };
+    epan_dissect_t *edt = epan_dissect_new(session, FALSE, FALSE);
+    epan_dissect_t *edt2 = epan_dissect_new(session, FALSE, FALSE);
+
+    add_listener("tap_test", &a, NULL);
+
+    dissect_count(edt, MANY_TAPS, TRUE);
+    g_assert_cmpuint(a.packets, ==, MANY_TAPS);
+    g_assert_cmpuint(a.total, ==, (guint64)MANY_TAPS * (MANY_TAPS + 1) / 2);
+    g_assert(fetched_first == GUINT_TO_POINTER(1));
+    g_assert_null(fetched_past_end);
+
+    /* Once the taps have been pushed, nothing is queued any more. */
+    g_assert_null(fetch_tapped_data(tap_test_tap, 0));
+    dissect_count(edt2, 3, FALSE);
+    g_assert_null(fetched_first);
+    g_assert_cmpuint(a.packets, ==, MANY_TAPS);
+
+    /* Another epan_dissect_t has its own queue, and the first one's queue
+       is kept for its next packet. */
+    dissect_count(edt2, 3, TRUE);
+    g_assert(fetched_first == GUINT_TO_POINTER(1));
+    g_assert_cmpuint(a.packets, ==, MANY_TAPS + 3);
+    dissect_count(edt, 2, TRUE);
+    g_assert_cmpuint(a.packets, ==, MANY_TAPS + 5);
+    g_assert_cmpuint(a.total, ==, (guint64)MANY_TAPS * (MANY_TAPS + 1) / 2 + 6 + 3);
+
+    remove_tap_listener(&a);
+    epan_dissect_free(edt2);
+    epan_dissect_free(edt);
+}
+
+typedef struct {
+    epan_dissect_t *edt;
+    tap_worker_t *worker;
+} worker_thread_t;
+
+static gpointer
+worker_thread(gpointer data)
+{
+    worker_thread_t *wt = (worker_thread_t *)data;
+    guint n;
+
+    for (n = 0; n < THREAD_FRAMES; n++) {
+        g_mutex_lock(&dissect_lock);
+        dissect_count(wt->edt, n % 5 + 1, TRUE);
+        g_mutex_unlock(&dissect_lock);
+    }
+    return NULL;
+}
+
+/* Two threads gather their own state, with their own copies of the filter,
+   and it's only added to the listener's when each worker is merged. */
+static void
+tap_test_merge(void)
+{
+    tap_sum_t sum = { "s", NULL, 0, 0, 0 };
+    tap_sum_t plain = { "p", NULL, 0, 0, 0 };
+    worker_thread_t wt[2];
+    GThread *thread[2];
+    /* Each thread has THREAD_FRAMES / 5 frames with each count from 1 to
+       5, and the filter lets through those with 1 to 3. */
+    guint packets = THREAD_FRAMES / 5 * (1 + 2 + 3);
+    guint64 total = THREAD_FRAMES / 5 * (1 + 3 + 6);
+    guint i;
+
+    add_listener("tap_test", &sum, "tap_test.count <= 3");
+    g_assert(!set_tap_merge(&plain, sum_partial_new, sum_merge));
+    g_assert(set_tap_merge(&sum, sum_partial_new, sum_merge));
+    g_assert(tap_listeners_can_merge());
+    add_listener("frame", &plain, NULL);
+    g_assert(!tap_listeners_can_merge());
+    remove_tap_listener(&plain);
+    g_assert(tap_listeners_can_merge());
+
+    draw_tap_listeners(FALSE);
+    sum.draws = 0;
+
+    for (i = 0; i < 2; i++) {
+        wt[i].edt = epan_dissect_new(session, TRUE, FALSE);
+        wt[i].worker = tap_worker_new();
+        tap_worker_attach(wt[i].edt, wt[i].worker);
+    }
+    for (i = 0; i < 2; i++)
+        thread[i] = g_thread_new("tap worker", worker_thread, &wt[i]);
+    for (i = 0; i < 2; i++)
+        g_thread_join(thread[i]);
+
+    g_assert_cmpuint(sum.packets, ==, 0);
+    draw_tap_listeners(FALSE);
+    g_assert_cmpuint(sum.draws, ==, 0);
+
+    tap_worker_merge(wt[0].worker);
+    g_assert_cmpuint(sum.packets, ==, packets);
+    g_assert_cmpuint(sum.total, ==, total);
+    draw_tap_listeners(FALSE);
+    g_assert_cmpuint(sum.draws, ==, 1);
+
+    tap_worker_merge(wt[1].worker);
+    tap_worker_merge(wt[1].worker);
+    g_assert_cmpuint(sum.packets, ==, 2 * packets);
+    g_assert_cmpuint(sum.total, ==, 2 * total);
+
+    /* A merged worker starts over, in whichever thread uses it next, and
+       what's left is merged when it's freed. */
+    dissect_count(wt[0].edt, 2, TRUE);
+    dissect_count(wt[0].edt, 4, TRUE);
+    g_assert_cmpuint(sum.packets, ==, 2 * packets);
+    for (i = 0; i < 2; i++) {
+        epan_dissect_free(wt[i].edt);
+        tap_worker_free(wt[i].worker);
+    }
+    g_assert_cmpuint(sum.packets, ==, 2 * packets + 2);
+    g_assert_cmpuint(sum.total, ==, 2 * total + 3);
+
+    remove_tap_listener(&sum);
+}
+
+static void
+register_tap_test(void)
+{
+    static hf_register_info hf[] = {
+        { &hf_count,
+          { "Count", "tap_test.count", FT_UINT16, BASE_DEC,
+            NULL, 0x0, NULL, HFILL }},
+    };
+
+    proto_tap_test = proto_register_protocol("Tap test", "TAP_TEST", "tap_test");
+    proto_register_field_array(proto_tap_test, hf, G_N_ELEMENTS(hf));
+    dissector_add_uint("wtap_encap", WTAP_ENCAP_USER0,
+            create_dissector_handle(dissect_tap_test, proto_tap_test));
+    tap_test_tap = register_tap("tap_test");
+}
+
+int
+main(int argc, char **argv)
+{
+    static const struct packet_provider_funcs funcs = {
+        get_frame_ts,
+        NULL,
+        NULL,
+        NULL
+    };
+    int result;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/tap/index", tap_test_index);
+    g_test_add_func("/tap/queue", tap_test_queue);
+    g_test_add_func("/tap/merge", tap_test_merge);
+
+    wtap_init(FALSE);
+    if (!epan_init(NULL, NULL, FALSE))
+        return 2;
+    register_tap_test();
+
+    session = epan_new(NULL, &funcs);
+    result = g_test_run();
+    epan_free(session);
+
+    epan_cleanup();
+    wtap_cleanup();
+
+    return result;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
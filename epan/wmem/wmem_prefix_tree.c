@@ -0,0 +1,314 @@
+/* wmem_prefix_tree.c
+ * Wireshark Memory Manager Prefix Tree
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "wmem_core.h"
+#include "wmem_prefix_tree.h"
+
+#include <wsutil/bits_ctz.h>
+
+#define WMEM_PREFIX_TREE_MAX_BITS 128
+
+/* A key is held as a 128-bit big-endian number split across two 64-bit
+ * halves, with the first key bit in the most significant bit of hi. Keys
+ * shorter than 128 bits are left-aligned and zero-padded. */
+typedef struct {
+    guint64 hi;
+    guint64 lo;
+} wmem_prefix_key_t;
+
+typedef struct _wmem_prefix_tree_node_t {
+    wmem_prefix_key_t prefix;   /* masked to len bits */
+    guint             len;
+    gboolean          has_data;
+    void             *data;
+    struct _wmem_prefix_tree_node_t *child[2];
+} wmem_prefix_tree_node_t;
+
+struct _wmem_prefix_tree_t {
+    wmem_allocator_t        *allocator;
+    wmem_prefix_tree_node_t *root;
+    guint                    key_bits;
+    guint                    count;
+};
+
+static inline void
+prefix_key_mask(wmem_prefix_key_t *key, guint len)
+{
+    if (len == 0) {
+        key->hi = 0;
+        key->lo = 0;
+    } else if (len <= 64) {
+        key->hi &= G_GUINT64_CONSTANT(0xFFFFFFFFFFFFFFFF) << (64 - len);
+        key->lo = 0;
+    } else {
+        key->lo &= G_GUINT64_CONSTANT(0xFFFFFFFFFFFFFFFF) << (128 - len);
+    }
+}
+
+static inline void
+prefix_key_from_bytes(const wmem_prefix_tree_t *tree, const guint8 *bytes,
+        wmem_prefix_key_t *key)
+{
+    guint nbytes = (tree->key_bits + 7) / 8;
+    guint i;
+
+    key->hi = 0;
+    key->lo = 0;
+    for (i = 0; i < nbytes; i++) {
+        if (i < 8) {
+            key->hi |= (guint64)bytes[i] << (56 - 8 * i);
+        } else {
+            key->lo |= (guint64)bytes[i] << (56 - 8 * (i - 8));
+        }
+    }
+    prefix_key_mask(key, tree->key_bits);
+}
+
+/* Returns bit n (0 being the most significant) of the key. */
+static inline guint
+prefix_key_bit(const wmem_prefix_key_t *key, guint n)
+{
+    if (n < 64) {
+        return (guint)(key->hi >> (63 - n)) & 1;
+    }
+    return (guint)(key->lo >> (127 - n)) & 1;
+}
+
+/* Returns the number of leading bits that a and b have in common, capped at
+ * max_len. */
+static inline guint
+prefix_key_common_len(const wmem_prefix_key_t *a, const wmem_prefix_key_t *b,
+        guint max_len)
+{
+    guint64 diff;
+    guint   common;
+
+    if ((diff = a->hi ^ b->hi) != 0) {
+        common = 63 - ws_ilog2(diff);
+    } else if ((diff = a->lo ^ b->lo) != 0) {
+        common = 64 + (63 - ws_ilog2(diff));
+    } else {
+        common = WMEM_PREFIX_TREE_MAX_BITS;
+    }
+
+    return MIN(common, max_len);
+}
+
+/* Returns TRUE if the first len bits of key are equal to prefix, which must
+ * already be masked to len bits. */
+static inline gboolean
+prefix_key_matches(const wmem_prefix_key_t *key,
+        const wmem_prefix_key_t *prefix, guint len)
+{
+    wmem_prefix_key_t masked = *key;
+
+    prefix_key_mask(&masked, len);
+    return masked.hi == prefix->hi && masked.lo == prefix->lo;
+}
+
+static wmem_prefix_tree_node_t *
+prefix_tree_new_node(wmem_prefix_tree_t *tree, const wmem_prefix_key_t *key,
+        guint len)
+{
+    wmem_prefix_tree_node_t *node;
+
+    node = wmem_new0(tree->allocator, wmem_prefix_tree_node_t);
+    node->prefix = *key;
+    prefix_key_mask(&node->prefix, len);
+    node->len = len;
+
+    return node;
+}
+
+wmem_prefix_tree_t *
+wmem_prefix_tree_new(wmem_allocator_t *allocator, guint key_bits)
+{
+    wmem_prefix_tree_t *tree;
+
+    g_assert(key_bits > 0 && key_bits <= WMEM_PREFIX_TREE_MAX_BITS);
+
+    tree = wmem_new0(allocator, wmem_prefix_tree_t);
+    tree->allocator = allocator;
+    tree->key_bits  = key_bits;
+
+    return tree;
+}
+
+static void
+free_prefix_tree_node(wmem_allocator_t *allocator,
+        wmem_prefix_tree_node_t *node, gboolean free_values)
+{
+    if (node == NULL) {
+        return;
+    }
+
+    free_prefix_tree_node(allocator, node->child[0], free_values);
+    free_prefix_tree_node(allocator, node->child[1], free_values);
+
+    if (free_values && node->has_data) {
+        wmem_free(allocator, node->data);
+    }
+    wmem_free(allocator, node);
+}
+
+void
+wmem_prefix_tree_destroy(wmem_prefix_tree_t *tree, gboolean free_values)
+{
+    free_prefix_tree_node(tree->allocator, tree->root, free_values);
+    wmem_free(tree->allocator, tree);
+}
+
+gboolean
+wmem_prefix_tree_is_empty(const wmem_prefix_tree_t *tree)
+{
+    return tree->count == 0;
+}
+
+guint
+wmem_prefix_tree_count(const wmem_prefix_tree_t *tree)
+{
+    return tree->count;
+}
+
+void
+wmem_prefix_tree_insert(wmem_prefix_tree_t *tree, const guint8 *key,
+        guint prefix_len, void *data)
+{
+    wmem_prefix_tree_node_t **link, *node, *new_node, *branch;
+    wmem_prefix_key_t k;
+    guint common;
+
+    g_assert(prefix_len <= tree->key_bits);
+
+    prefix_key_from_bytes(tree, key, &k);
+    prefix_key_mask(&k, prefix_len);
+
+    link = &tree->root;
+    while ((node = *link) != NULL) {
+        common = prefix_key_common_len(&k, &node->prefix,
+                MIN(prefix_len, node->len));
+
+        if (common < node->len) {
+            /* The new prefix diverges from this node (or ends) part way
+             * along its compressed path, so the path has to be split. */
+            new_node = prefix_tree_new_node(tree, &k, prefix_len);
+            new_node->has_data = TRUE;
+            new_node->data = data;
+            tree->count++;
+
+            if (common == prefix_len) {
+                /* The new prefix is a proper prefix of this node. */
+                new_node->child[prefix_key_bit(&node->prefix, prefix_len)] = node;
+                *link = new_node;
+            } else {
+                branch = prefix_tree_new_node(tree, &k, common);
+                branch->child[prefix_key_bit(&k, common)] = new_node;
+                branch->child[prefix_key_bit(&node->prefix, common)] = node;
+                *link = branch;
+            }
+            return;
+        }
+
+        if (node->len == prefix_len) {
+            if (!node->has_data) {
+                node->has_data = TRUE;
+                tree->count++;
+            }
+            node->data = data;
+            return;
+        }
+
+        link = &node->child[prefix_key_bit(&k, node->len)];
+    }
+
+    new_node = prefix_tree_new_node(tree, &k, prefix_len);
+    new_node->has_data = TRUE;
+    new_node->data = data;
+    tree->count++;
+    *link = new_node;
+}
+
+void *
+wmem_prefix_tree_lookup_exact(const wmem_prefix_tree_t *tree,
+        const guint8 *key, guint prefix_len)
+{
+    const wmem_prefix_tree_node_t *node;
+    wmem_prefix_key_t k;
+
+    if (prefix_len > tree->key_bits) {
+        return NULL;
+    }
+
+    prefix_key_from_bytes(tree, key, &k);
+    prefix_key_mask(&k, prefix_len);
+
+    node = tree->root;
+    while (node != NULL && node->len <= prefix_len) {
+        if (!prefix_key_matches(&k, &node->prefix, node->len)) {
+            return NULL;
+        }
+        if (node->len == prefix_len) {
+            return node->has_data ? node->data : NULL;
+        }
+        node = node->child[prefix_key_bit(&k, node->len)];
+    }
+
+    return NULL;
+}
+
+void *
+wmem_prefix_tree_lookup(const wmem_prefix_tree_t *tree, const guint8 *key,
+        guint *prefix_len)
+{
+    const wmem_prefix_tree_node_t *node, *best = NULL;
+    wmem_prefix_key_t k;
+
+    prefix_key_from_bytes(tree, key, &k);
+
+    node = tree->root;
+    while (node != NULL) {
+        if (!prefix_key_matches(&k, &node->prefix, node->len)) {
+            break;
+        }
+        if (node->has_data) {
+            best = node;
+        }
+        if (node->len >= tree->key_bits) {
+            break;
+        }
+        node = node->child[prefix_key_bit(&k, node->len)];
+    }
+
+    if (best == NULL) {
+        return NULL;
+    }
+
+    if (prefix_len) {
+        *prefix_len = best->len;
+    }
+    return best->data;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,106 @@
+/* wmem_prefix_tree.h
+ * Definitions for the Wireshark Memory Manager Prefix Tree
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WMEM_PREFIX_TREE_H__
+#define __WMEM_PREFIX_TREE_H__
+
+#include "wmem_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @addtogroup wmem
+ *  @{
+ *    @defgroup wmem-prefix-tree Prefix Tree
+ *
+ *    A path-compressed binary radix tree (PATRICIA trie) for longest-prefix
+ *    matching of fixed-width keys such as IPv4 or IPv6 addresses. Keys are
+ *    passed as byte arrays in network byte order and may be up to 128 bits
+ *    wide. Chains of single-child nodes are collapsed, so a lookup visits at
+ *    most one node per distinct branching bit in the stored set rather than
+ *    one per key bit, and each visit is a pair of 64-bit masked compares.
+ *
+ *    @{
+ */
+
+struct _wmem_prefix_tree_t;
+typedef struct _wmem_prefix_tree_t wmem_prefix_tree_t;
+
+/** Creates a prefix tree for keys that are key_bits wide (1-128) in the
+ * given allocator scope. When the scope is emptied, the tree is fully
+ * destroyed. */
+WS_DLL_PUBLIC
+wmem_prefix_tree_t *
+wmem_prefix_tree_new(wmem_allocator_t *allocator, guint key_bits)
+G_GNUC_MALLOC;
+
+/** Cleanup memory used by tree.  Intended for NULL scope allocated trees */
+WS_DLL_PUBLIC
+void
+wmem_prefix_tree_destroy(wmem_prefix_tree_t *tree, gboolean free_values);
+
+/** Returns true if the tree has no prefixes stored in it. */
+WS_DLL_PUBLIC
+gboolean
+wmem_prefix_tree_is_empty(const wmem_prefix_tree_t *tree);
+
+/** Returns the number of prefixes stored in the tree. */
+WS_DLL_PUBLIC
+guint
+wmem_prefix_tree_count(const wmem_prefix_tree_t *tree);
+
+/** Inserts data for the prefix made of the first prefix_len bits of key.
+ * Bits beyond prefix_len are ignored, so the key does not need to be masked
+ * by the caller. A prefix_len of 0 stores a default entry that matches every
+ * key. If the prefix already exists, its data is overwritten.
+ */
+WS_DLL_PUBLIC
+void
+wmem_prefix_tree_insert(wmem_prefix_tree_t *tree, const guint8 *key,
+        guint prefix_len, void *data);
+
+/** Returns the data stored for exactly the given prefix, or NULL if there is
+ * no such prefix in the tree. */
+WS_DLL_PUBLIC
+void *
+wmem_prefix_tree_lookup_exact(const wmem_prefix_tree_t *tree,
+        const guint8 *key, guint prefix_len);
+
+/** Returns the data of the longest stored prefix that matches the full-width
+ * key, or NULL if no prefix matches. If prefix_len is not NULL, it is set to
+ * the length of the matching prefix.
+ */
+WS_DLL_PUBLIC
+void *
+wmem_prefix_tree_lookup(const wmem_prefix_tree_t *tree, const guint8 *key,
+        guint *prefix_len);
+
+/**   @}
+ *  @} */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WMEM_PREFIX_TREE_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
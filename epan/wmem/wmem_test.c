@@ -1322,6 +1322,191 @@ wmem_test_tree(void)
     wmem_destroy_allocator(allocator);
 }
 
+/* Returns the length of the longest prefix in the first count entries of
+ * prefixes/lens that matches addr, or -1 if none match. */
+static int
+wmem_test_prefix_tree_brute_force(const guint32 *prefixes, const guint *lens,
+        int count, guint32 addr)
+{
+    int i, best = -1;
+
+    for (i = 0; i < count; i++) {
+        guint32 mask = lens[i] ? G_MAXUINT32 << (32 - lens[i]) : 0;
+        if ((addr & mask) == prefixes[i] && (int)lens[i] > best) {
+            best = lens[i];
+        }
+    }
+
+    return best;
+}
+
+static void
+wmem_test_prefix_tree_key32(guint32 addr, guint8 *key)
+{
+    key[0] = (guint8)(addr >> 24);
+    key[1] = (guint8)(addr >> 16);
+    key[2] = (guint8)(addr >> 8);
+    key[3] = (guint8)addr;
+}
+
+static void
+wmem_test_prefix_tree(void)
+{
+#define WMEM_PREFIX_TREE_TEST_COUNT 1000
+    wmem_allocator_t   *allocator;
+    wmem_prefix_tree_t *tree;
+    guint32             prefixes[WMEM_PREFIX_TREE_TEST_COUNT];
+    guint               lens[WMEM_PREFIX_TREE_TEST_COUNT];
+    guint8              key[16];
+    guint               len;
+    int                 i, best;
+
+    allocator = wmem_allocator_new(WMEM_ALLOCATOR_STRICT);
+
+    tree = wmem_prefix_tree_new(allocator, 32);
+    g_assert(tree);
+    g_assert(wmem_prefix_tree_is_empty(tree));
+
+    wmem_test_prefix_tree_key32(0x0A000001, key);
+    g_assert(wmem_prefix_tree_lookup(tree, key, NULL) == NULL);
+
+    /* nested prefixes, inserted shortest and longest first */
+    wmem_test_prefix_tree_key32(0x0A000000, key);
+    wmem_prefix_tree_insert(tree, key, 8, GINT_TO_POINTER(8));
+    wmem_test_prefix_tree_key32(0x0A010203, key);
+    wmem_prefix_tree_insert(tree, key, 32, GINT_TO_POINTER(32));
+    wmem_test_prefix_tree_key32(0x0A01FFFF, key); /* host bits are ignored */
+    wmem_prefix_tree_insert(tree, key, 16, GINT_TO_POINTER(16));
+    g_assert(wmem_prefix_tree_count(tree) == 3);
+
+    wmem_test_prefix_tree_key32(0x0A010203, key);
+    g_assert(wmem_prefix_tree_lookup(tree, key, &len) == GINT_TO_POINTER(32));
+    g_assert(len == 32);
+    wmem_test_prefix_tree_key32(0x0A010204, key);
+    g_assert(wmem_prefix_tree_lookup(tree, key, &len) == GINT_TO_POINTER(16));
+    g_assert(len == 16);
+    wmem_test_prefix_tree_key32(0x0A020304, key);
+    g_assert(wmem_prefix_tree_lookup(tree, key, &len) == GINT_TO_POINTER(8));
+    g_assert(len == 8);
+    wmem_test_prefix_tree_key32(0x0B000000, key);
+    g_assert(wmem_prefix_tree_lookup(tree, key, NULL) == NULL);
+
+    wmem_test_prefix_tree_key32(0x0A010000, key);
+    g_assert(wmem_prefix_tree_lookup_exact(tree, key, 16) == GINT_TO_POINTER(16));
+    g_assert(wmem_prefix_tree_lookup_exact(tree, key, 17) == NULL);
+
+    /* overwrite, then add a default entry */
+    wmem_prefix_tree_insert(tree, key, 16, GINT_TO_POINTER(17));
+    g_assert(wmem_prefix_tree_count(tree) == 3);
+    g_assert(wmem_prefix_tree_lookup_exact(tree, key, 16) == GINT_TO_POINTER(17));
+    wmem_prefix_tree_insert(tree, key, 0, GINT_TO_POINTER(100));
+    wmem_test_prefix_tree_key32(0x0B000000, key);
+    g_assert(wmem_prefix_tree_lookup(tree, key, &len) == GINT_TO_POINTER(100));
+    g_assert(len == 0);
+
+    wmem_free_all(allocator);
+
+    /* compare random prefixes against a linear scan */
+    tree = wmem_prefix_tree_new(allocator, 32);
+    for (i = 0; i < WMEM_PREFIX_TREE_TEST_COUNT; i++) {
+        /* keep the first octet small so that prefixes overlap */
+        guint32 addr = (g_test_rand_int_range(0, 4) << 24) |
+                       (g_test_rand_int() & 0x00FFFFFF);
+        lens[i] = g_test_rand_int_range(1, 33);
+        prefixes[i] = addr & (G_MAXUINT32 << (32 - lens[i]));
+        wmem_test_prefix_tree_key32(addr, key);
+        wmem_prefix_tree_insert(tree, key, lens[i], GINT_TO_POINTER(i + 1));
+    }
+    for (i = 0; i < CONTAINER_ITERS; i++) {
+        guint32 addr;
+        void   *data;
+
+        if (i % 2) {
+            /* an address inside a known prefix */
+            addr = prefixes[g_test_rand_int_range(0, WMEM_PREFIX_TREE_TEST_COUNT)] |
+                   (g_test_rand_int() & 0xFF);
+        } else {
+            addr = (g_test_rand_int_range(0, 5) << 24) |
+                   (g_test_rand_int() & 0x00FFFFFF);
+        }
+        best = wmem_test_prefix_tree_brute_force(prefixes, lens,
+                WMEM_PREFIX_TREE_TEST_COUNT, addr);
+        wmem_test_prefix_tree_key32(addr, key);
+        data = wmem_prefix_tree_lookup(tree, key, &len);
+        if (best < 0) {
+            g_assert(data == NULL);
+        } else {
+            g_assert(data != NULL);
+            g_assert_cmpuint(len, ==, best);
+        }
+    }
+
+    wmem_free_all(allocator);
+
+    /* 128-bit keys */
+    tree = wmem_prefix_tree_new(allocator, 128);
+    memset(key, 0, sizeof key);
+    key[0] = 0x20; key[1] = 0x01; key[2] = 0x0d; key[3] = 0xb8;
+    wmem_prefix_tree_insert(tree, key, 32, GINT_TO_POINTER(32));
+    key[15] = 0x01;
+    wmem_prefix_tree_insert(tree, key, 127, GINT_TO_POINTER(127));
+    g_assert(wmem_prefix_tree_lookup(tree, key, &len) == GINT_TO_POINTER(127));
+    g_assert(len == 127);
+    key[15] = 0x02;
+    g_assert(wmem_prefix_tree_lookup(tree, key, &len) == GINT_TO_POINTER(32));
+    g_assert(len == 32);
+    key[3] = 0xb9;
+    g_assert(wmem_prefix_tree_lookup(tree, key, NULL) == NULL);
+
+    wmem_destroy_allocator(allocator);
+}
+
+/* NOTE: You have to run "wmem_test --verbose" to see results. */
+static void
+wmem_test_prefix_tree_perf(void)
+{
+#define PREFIX_COUNT (200 * 1000)
+#define LOOKUP_COUNT (1 * 1000 * 1000)
+    wmem_allocator_t   *allocator;
+    wmem_prefix_tree_t *tree;
+    guint8             *addrs;
+    guint8              key[4];
+    guint               len, found = 0;
+    int                 i;
+    double              start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+
+    allocator = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
+    tree = wmem_prefix_tree_new(allocator, 32);
+
+    RESOURCE_USAGE_START;
+    for (i = 0; i < PREFIX_COUNT; i++) {
+        wmem_test_prefix_tree_key32(g_test_rand_int(), key);
+        wmem_prefix_tree_insert(tree, key, g_test_rand_int_range(8, 33), GINT_TO_POINTER(i + 1));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "wmem_prefix_tree_insert %d IPv4 prefixes: u %.3f ms s %.3f ms", PREFIX_COUNT, utime_ms, stime_ms);
+
+    addrs = (guint8 *)g_malloc(LOOKUP_COUNT * 4);
+    for (i = 0; i < LOOKUP_COUNT; i++) {
+        wmem_test_prefix_tree_key32(g_test_rand_int(), &addrs[i * 4]);
+    }
+
+    RESOURCE_USAGE_START;
+    for (i = 0; i < LOOKUP_COUNT; i++) {
+        if (wmem_prefix_tree_lookup(tree, &addrs[i * 4], &len)) {
+            found++;
+        }
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "wmem_prefix_tree_lookup %d random IPv4 addresses (%u matched): u %.3f ms s %.3f ms",
+        LOOKUP_COUNT, found, utime_ms, stime_ms);
+
+    g_free(addrs);
+    wmem_destroy_allocator(allocator);
+}
+
 
 /* to be used as userdata in the callback wmem_test_itree_check_overlap_cb*/
 typedef struct wmem_test_itree_user_data {
@@ -1445,6 +1630,7 @@ main(int argc, char **argv)
 
     if (!g_test_perf ()) {
         g_test_add_func("/wmem/utils/stringperf", wmem_test_stringperf);
+        g_test_add_func("/wmem/datastruct/prefix_tree_perf", wmem_test_prefix_tree_perf);
     }
 
     g_test_add_func("/wmem/datastruct/array",  wmem_test_array);
@@ -1455,6 +1641,7 @@ main(int argc, char **argv)
     g_test_add_func("/wmem/datastruct/strbuf", wmem_test_strbuf);
     g_test_add_func("/wmem/datastruct/tree",   wmem_test_tree);
     g_test_add_func("/wmem/datastruct/itree",  wmem_test_itree);
+    g_test_add_func("/wmem/datastruct/ptree",  wmem_test_prefix_tree);
 
     ret = g_test_run();
 
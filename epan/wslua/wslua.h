@@ -230,6 +230,13 @@ struct _wslua_field_info {
     gboolean expired;
 };
 
+struct _wslua_field_list {
+    struct _wslua_header_field_info *fields;
+    guint count;
+    int values_ref;     /* table reused for the first value of each field */
+    int all_ref;        /* table of tables reused for all values of each field */
+};
+
 typedef void (*tap_extractor_t)(lua_State*,const void*);
 
 struct _wslua_tap {
@@ -240,6 +247,7 @@ struct _wslua_tap {
     int packet_ref;
     int draw_ref;
     int reset_ref;
+    int fields_ref;
     gboolean all_fields;
 };
 
@@ -330,6 +338,7 @@ typedef gint64 Int64;
 typedef guint64 UInt64;
 typedef struct _wslua_header_field_info* Field;
 typedef struct _wslua_field_info* FieldInfo;
+typedef struct _wslua_field_list* FieldList;
 typedef struct _wslua_tap* Listener;
 typedef struct _wslua_tw* TextWindow;
 typedef struct _wslua_progdlg* ProgDlg;
@@ -163,7 +163,7 @@ WSLUA_METAMETHOD FieldInfo__call(lua_State* L) {
                 return 1;
             }
         case FT_NONE:
-                if (fi->ws_fi->length > 0 && fi->ws_fi->rep) {
+                if (fi->ws_fi->length > 0 && proto_item_get_rep(fi->ws_fi)) {
                     /* it has a length, but calling fvalue_get() on an FT_NONE asserts,
                        so get the label instead (it's a FT_NONE, so a label is what it basically is) */
                     lua_pushstring(L, fi->ws_fi->rep->representation);
@@ -241,7 +241,7 @@ static int FieldInfo_get_display(lua_State* L) {
     gchar        *label_ptr;
     gchar        *value_ptr;
 
-    if (!fi->ws_fi->rep) {
+    if (!proto_item_get_rep(fi->ws_fi)) {
         label_ptr = label_str;
         proto_item_fill_label(fi->ws_fi, label_str);
     } else
@@ -801,6 +801,252 @@ int Field_register(lua_State* L) {
     return 0;
 }
 
+WSLUA_CLASS_DEFINE(FieldList,FAIL_ON_NULL("FieldList"));
+/*
+   A set of Field extractors whose values are obtained all at once. Like a `Field`, a `FieldList`
+   can only be created *outside* of the callback functions of dissectors, post-dissectors,
+   heuristic-dissectors, and taps.
+
+   Calling a `FieldList` inside a callback does not create any `FieldInfo` objects: the values
+   are stored as plain Lua values in tables that are reused for every packet, so reading many
+   fields per packet does not leave garbage for the Lua garbage collector to clean up.
+
+   @since 3.3.0
+ */
+
+/* Push the value of a field as a plain Lua value. */
+static void push_field_value(lua_State* L, field_info* fi) {
+    enum ftenum type = fi->hfinfo->type;
+
+    if (type == FT_BOOLEAN) {
+        lua_pushboolean(L, fvalue_get_uinteger64(&fi->value) != 0);
+    } else if (IS_FT_UINT32(type)) {
+        lua_pushnumber(L, (lua_Number)fvalue_get_uinteger(&fi->value));
+    } else if (IS_FT_INT32(type)) {
+        lua_pushnumber(L, (lua_Number)fvalue_get_sinteger(&fi->value));
+    } else if (IS_FT_UINT64(type)) {
+        lua_pushnumber(L, (lua_Number)fvalue_get_uinteger64(&fi->value));
+    } else if (IS_FT_INT64(type)) {
+        lua_pushnumber(L, (lua_Number)fvalue_get_sinteger64(&fi->value));
+    } else if (type == FT_FLOAT || type == FT_DOUBLE) {
+        lua_pushnumber(L, (lua_Number)fvalue_get_floating(&fi->value));
+    } else if (IS_FT_TIME(type)) {
+        const nstime_t *ts = (const nstime_t *)fvalue_get(&fi->value);
+        lua_pushnumber(L, (lua_Number)ts->secs + (lua_Number)ts->nsecs / 1000000000.0);
+    } else if (IS_FT_STRING(type) || type == FT_UINT_STRING) {
+        lua_pushstring(L, (const gchar *)fvalue_get(&fi->value));
+    } else if (type == FT_NONE || type == FT_PROTOCOL) {
+        lua_pushboolean(L, TRUE);
+    } else {
+        /* Addresses, byte strings, GUIDs, OIDs etc. are returned as they are displayed. */
+        gchar* repr = fvalue_to_string_repr(NULL, &fi->value, FTREPR_DISPLAY, fi->hfinfo->display);
+        if (repr) {
+            lua_pushstring(L, repr);
+            wmem_free(NULL, repr);
+        } else {
+            lua_pushboolean(L, TRUE);
+        }
+    }
+}
+
+WSLUA_CONSTRUCTOR FieldList_new(lua_State *L) {
+    /*
+       Create a FieldList of Field extractors.
+       */
+#define WSLUA_ARG_FieldList_new_FIELDNAMES 1 /* An array table of the filter names of the fields (e.g. `{ "ip.src", "tcp.port" }`). */
+    FieldList fl;
+    const gchar* name;
+    guint count = 0;
+    guint i;
+
+    luaL_checktype(L,WSLUA_ARG_FieldList_new_FIELDNAMES,LUA_TTABLE);
+
+    if (!wanted_fields) {
+        WSLUA_ERROR(FieldList_new,"A FieldList must be defined before Taps or Dissectors get called");
+        return 0;
+    }
+
+    /* Check all the names first, so that nothing is allocated if one is bad. */
+    for (;;) {
+        lua_rawgeti(L,WSLUA_ARG_FieldList_new_FIELDNAMES,count + 1);
+        if (lua_isnil(L,-1)) {
+            lua_pop(L,1);
+            break;
+        }
+        name = lua_tostring(L,-1);
+        if (!name || (!proto_registrar_get_byname(name) && !wslua_is_field_available(L, name))) {
+            WSLUA_ARG_ERROR(FieldList_new,FIELDNAMES,"must contain the names of existing fields");
+            return 0;
+        }
+        lua_pop(L,1);
+        count++;
+    }
+
+    fl = (FieldList)g_new0(struct _wslua_field_list, 1);
+    fl->fields = g_new0(struct _wslua_header_field_info, count);
+    fl->count = count;
+
+    lua_createtable(L,count,0);
+    fl->values_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    lua_createtable(L,count,0);
+    for (i = 0; i < count; i++) {
+        lua_rawgeti(L,WSLUA_ARG_FieldList_new_FIELDNAMES,i + 1);
+        fl->fields[i].name = g_strdup(lua_tostring(L,-1));
+        lua_pop(L,1);
+        g_ptr_array_add(wanted_fields, &fl->fields[i]);
+
+        lua_newtable(L);
+        lua_rawseti(L,-2,i + 1);
+    }
+    fl->all_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    pushFieldList(L,fl);
+    WSLUA_RETURN(1); /* The list of field extractors */
+}
+
+WSLUA_METAMETHOD FieldList__call(lua_State* L) {
+    /*
+       Obtain the values of the fields. The returned table has the value of the first occurrence of
+       each field at the index of its name in `FieldList.new()`, or `nil` if the field isn't in the
+       packet. Integers, floating point numbers and times (in seconds) are numbers, booleans are
+       booleans, strings are strings, protocols and fields without a value are `true`, and any other
+       value is the string it is displayed as. 64-bit integers lose precision above 2^53.
+
+       The same table is returned, with new values, for every call; copy any value that has to be
+       kept for later.
+       */
+    FieldList fl = checkFieldList(L,1);
+    header_field_info* in;
+    GPtrArray* found;
+    guint i;
+
+    if (! lua_pinfo ) {
+        WSLUA_ERROR(FieldList__call,"Fields cannot be used outside dissectors or taps");
+        return 0;
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, fl->values_ref);
+
+    for (i = 0; i < fl->count; i++) {
+        found = NULL;
+        for (in = fl->fields[i].hfi; in; in = (in->same_name_prev_id != -1) ? proto_registrar_get_nth(in->same_name_prev_id) : NULL) {
+            found = proto_get_finfo_ptr_array(lua_tree->tree, in->id);
+            if (found && found->len > 0)
+                break;
+        }
+
+        if (found && found->len > 0) {
+            push_field_value(L, (field_info *) g_ptr_array_index(found,0));
+        } else {
+            lua_pushnil(L);
+        }
+        lua_rawseti(L,-2,i + 1);
+    }
+
+    WSLUA_RETURN(1); /* The table of the values of the fields */
+}
+
+WSLUA_METHOD FieldList_all(lua_State* L) {
+    /*
+       Obtain the values of every occurrence of the fields. The returned table has, at the index of
+       each field's name in `FieldList.new()`, an array table of its values (converted as for
+       `FieldList()`), which is empty if the field isn't in the packet.
+
+       The same tables are returned, with new values, for every call; copy any value that has to
+       be kept for later.
+       */
+    FieldList fl = checkFieldList(L,1);
+    header_field_info* in;
+    GPtrArray* found;
+    guint i, j, n;
+
+    if (! lua_pinfo ) {
+        WSLUA_ERROR(FieldList_all,"Fields cannot be used outside dissectors or taps");
+        return 0;
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, fl->all_ref);
+
+    for (i = 0; i < fl->count; i++) {
+        lua_rawgeti(L,-1,i + 1);
+        n = 0;
+
+        for (in = fl->fields[i].hfi; in; in = (in->same_name_prev_id != -1) ? proto_registrar_get_nth(in->same_name_prev_id) : NULL) {
+            found = proto_get_finfo_ptr_array(lua_tree->tree, in->id);
+            if (found) {
+                for (j = 0; j < found->len; j++) {
+                    push_field_value(L, (field_info *) g_ptr_array_index(found,j));
+                    lua_rawseti(L,-2,++n);
+                }
+            }
+        }
+
+        /* Clear what is left over from the previous packet. */
+        for (;;) {
+            lua_rawgeti(L,-1,++n);
+            if (lua_isnil(L,-1)) {
+                lua_pop(L,1);
+                break;
+            }
+            lua_pop(L,1);
+            lua_pushnil(L);
+            lua_rawseti(L,-2,n);
+        }
+
+        lua_pop(L,1);
+    }
+
+    WSLUA_RETURN(1); /* The table of the arrays of values of the fields */
+}
+
+WSLUA_METAMETHOD FieldList__len(lua_State* L) {
+    /* The number of fields in the FieldList. */
+    FieldList fl = checkFieldList(L,1);
+
+    lua_pushnumber(L,fl->count);
+    return 1;
+}
+
+static int FieldList__gc(lua_State* L) {
+    FieldList fl = toFieldList(L,1);
+    guint i;
+
+    if (!fl) return 0;
+
+    for (i = 0; i < fl->count; i++) {
+        // As for Field__gc, don't leave dangling pointers behind if this
+        // goes out of scope before lua_prime_all_fields is called.
+        if (wanted_fields) {
+            g_ptr_array_remove_fast(wanted_fields, &fl->fields[i]);
+        }
+        g_free(fl->fields[i].name);
+    }
+
+    luaL_unref(L, LUA_REGISTRYINDEX, fl->values_ref);
+    luaL_unref(L, LUA_REGISTRYINDEX, fl->all_ref);
+    g_free(fl->fields);
+    g_free(fl);
+    return 0;
+}
+
+WSLUA_METHODS FieldList_methods[] = {
+    WSLUA_CLASS_FNREG(FieldList,new),
+    WSLUA_CLASS_FNREG(FieldList,all),
+    { NULL, NULL }
+};
+
+WSLUA_META FieldList_meta[] = {
+    WSLUA_CLASS_MTREG(FieldList,call),
+    WSLUA_CLASS_MTREG(FieldList,len),
+    { NULL, NULL }
+};
+
+int FieldList_register(lua_State* L) {
+    WSLUA_REGISTER_CLASS(FieldList);
+    return 0;
+}
+
 int wslua_deregister_fields(lua_State* L _U_) {
     if (wslua_dfilter) {
         dfilter_free(wslua_dfilter);
@@ -178,7 +178,7 @@ static void lua_tap_draw(void *tapdata) {
 /* TODO: we should probably use a Lua table here */
 static GPtrArray *listeners = NULL;
 
-static void deregister_Listener (lua_State* L _U_, Listener tap) {
+static void deregister_Listener (lua_State* L, Listener tap) {
     if (tap->all_fields) {
         epan_set_always_visible(FALSE);
         tap->all_fields = FALSE;
@@ -186,6 +186,8 @@ static void deregister_Listener (lua_State* L _U_, Listener tap) {
 
     remove_tap_listener(tap);
 
+    luaL_unref(L, LUA_REGISTRYINDEX, tap->fields_ref);
+
     g_free(tap->filter);
     g_free(tap->name);
     g_free(tap);
@@ -204,13 +206,30 @@ WSLUA_CONSTRUCTOR Listener_new(lua_State* L) {
     Whether to generate all fields.
     The default is `false`.
     Note: This impacts performance. */
+#define WSLUA_OPTARG_Listener_new_FIELDS 4 /*
+    A `FieldList` with the fields that the `tap.packet` function reads (since 3.3.0).
+    If given, and `allfields` is not `true`, the tap doesn't require the whole protocol tree,
+    only those fields.
+    Note: Without it, the tap requires the whole protocol tree, which impacts performance. */
 
     const gchar* tap_type = luaL_optstring(L,WSLUA_OPTARG_Listener_new_TAP,"frame");
     const gchar* filter = luaL_optstring(L,WSLUA_OPTARG_Listener_new_FILTER,NULL);
     const gboolean all_fields = wslua_optbool(L, WSLUA_OPTARG_Listener_new_ALLFIELDS, FALSE);
+    guint flags = TL_REQUIRES_PROTO_TREE;
     Listener tap;
     GString* error;
 
+    if (!lua_isnoneornil(L, WSLUA_OPTARG_Listener_new_FIELDS)) {
+        /*
+         * The fields of a FieldList are wanted by the fake tap set up by
+         * lua_prime_all_fields(), which gets the protocol tree created and
+         * primed with them, so this tap doesn't need the tree itself.
+         */
+        checkFieldList(L, WSLUA_OPTARG_Listener_new_FIELDS);
+        if (!all_fields)
+            flags = 0;
+    }
+
     tap = (Listener)g_malloc(sizeof(struct _wslua_tap));
 
     tap->name = g_strdup(tap_type);
@@ -220,16 +239,14 @@ WSLUA_CONSTRUCTOR Listener_new(lua_State* L) {
     tap->packet_ref = LUA_NOREF;
     tap->draw_ref = LUA_NOREF;
     tap->reset_ref = LUA_NOREF;
+    tap->fields_ref = LUA_NOREF;
     tap->all_fields = all_fields;
 
     /*
-     * XXX - do all Lua taps require the protocol tree?  If not, it might
-     * be useful to have a way to indicate whether any do.
-     *
      * XXX - do any Lua taps require the columns?  If so, we either need
      * to request them for this tap, or do so if any Lua taps require them.
      */
-    error = register_tap_listener(tap_type, tap, tap->filter, TL_REQUIRES_PROTO_TREE, lua_tap_reset, lua_tap_packet, lua_tap_draw, NULL);
+    error = register_tap_listener(tap_type, tap, tap->filter, flags, lua_tap_reset, lua_tap_packet, lua_tap_draw, NULL);
 
     if (error) {
         g_free(tap->filter);
@@ -245,6 +262,15 @@ WSLUA_CONSTRUCTOR Listener_new(lua_State* L) {
         epan_set_always_visible(TRUE);
     }
 
+    /*
+     * Keep the FieldList for as long as the tap is there; if it were
+     * collected, its fields would no longer be wanted.
+     */
+    if (!lua_isnoneornil(L, WSLUA_OPTARG_Listener_new_FIELDS)) {
+        lua_pushvalue(L, WSLUA_OPTARG_Listener_new_FIELDS);
+        tap->fields_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+
     g_ptr_array_add(listeners, tap);
 
     pushListener(L,tap);
@@ -598,7 +598,7 @@ static int TreeItem_get_text(lua_State* L) {
     if (ti->item) {
         field_info *fi = PITEM_FINFO(ti->item);
 
-        if (!fi->rep) {
+        if (!proto_item_get_rep(fi)) {
             label_ptr = label_str;
             proto_item_fill_label(fi, label_str);
         } else
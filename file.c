@@ -3105,7 +3105,7 @@ match_subtree_text(proto_node *node, gpointer data)
     return;
 
   /* was a free format label produced? */
-  if (fi->rep) {
+  if (proto_item_get_rep(fi)) {
     label_ptr = fi->rep->representation;
   } else {
     /* no, make a generic label */
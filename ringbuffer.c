@@ -63,6 +63,7 @@ typedef struct _ringbuf_data {
   FILE         *pdh;
   char         *io_buffer;              /**< The IO buffer used to write to the file */
   gboolean      group_read_access;   /**< TRUE if files need to be opened with group read access */
+  async_writer_t *writer;            /**< Writes the files in the background, if not NULL */
 } ringbuf_data;
 
 static ringbuf_data rb_data;
@@ -81,7 +82,10 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
   if (rfile->name != NULL) {
     if (rb_data.unlimited == FALSE) {
       /* remove old file (if any, so ignore error) */
-      ws_unlink(rfile->name);
+      if (rb_data.writer != NULL)
+        async_writer_unlink(rb_data.writer, rfile->name);
+      else
+        ws_unlink(rfile->name);
     }
     g_free(rfile->name);
   }
@@ -106,8 +110,13 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
     return -1;
   }
 
-  rb_data.fd = ws_open(rfile->name, O_RDWR|O_BINARY|O_TRUNC|O_CREAT,
-                            rb_data.group_read_access ? 0640 : 0600);
+  /* use the file the writer created in advance, if there is one */
+  rb_data.fd = -1;
+  if (rb_data.writer != NULL)
+    rb_data.fd = async_writer_take_spare(rb_data.writer, rfile->name, err);
+  if (rb_data.fd == -1)
+    rb_data.fd = ws_open(rfile->name, O_RDWR|O_BINARY|O_TRUNC|O_CREAT,
+                              rb_data.group_read_access ? 0640 : 0600);
 
   if (rb_data.fd == -1 && err != NULL) {
     *err = errno;
@@ -135,6 +144,7 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
   rb_data.pdh = NULL;
   rb_data.io_buffer = NULL;
   rb_data.group_read_access = group_read_access;
+  rb_data.writer = NULL;
 
   /* just to be sure ... */
   if (num_files <= RINGBUFFER_MAX_NUM_FILES) {
@@ -220,12 +230,50 @@ const gchar *ringbuf_current_filename(void)
   return rb_data.files[rb_data.curr_file_num % rb_data.num_files].name;
 }
 
+/*
+ * Write the files through an async writer from now on (or stop doing so,
+ * if writer is NULL); this must be done before the current file is opened
+ * with ringbuf_init_libpcap_fdopen().
+ */
+void
+ringbuf_set_async_writer(async_writer_t *writer)
+{
+  if (rb_data.writer != NULL)
+    async_writer_drop_spare(rb_data.writer);
+  rb_data.writer = writer;
+}
+
+/*
+ * Have the writer create the file that ringbuf_open_file() will rename to
+ * the name of the next file, so that it doesn't have to wait for the file
+ * system to create it when switching files.
+ */
+static void
+ringbuf_create_spare_file(void)
+{
+  gchar *spare_name;
+
+  spare_name = g_strconcat(rb_data.fprefix, "_spare", rb_data.fsuffix, NULL);
+  async_writer_create_spare(rb_data.writer, spare_name,
+                            rb_data.group_read_access ? 0640 : 0600);
+  g_free(spare_name);
+}
+
 /*
  * Calls ws_fdopen() for the current ringbuffer file
  */
 FILE *
 ringbuf_init_libpcap_fdopen(int *err)
 {
+  if (rb_data.writer != NULL) {
+    /* the writer does its own buffering, and closes the file itself */
+    rb_data.pdh = async_writer_fdopen(rb_data.writer, rb_data.fd,
+                                      ringbuf_current_filename(), err);
+    if (rb_data.pdh != NULL)
+      ringbuf_create_spare_file();
+    return rb_data.pdh;
+  }
+
   rb_data.pdh = ws_fdopen(rb_data.fd, "wb");
   if (rb_data.pdh == NULL) {
     if (err != NULL) {
@@ -265,7 +313,8 @@ ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd, int *err)
     if (err != NULL) {
       *err = errno;
     }
-    ws_close(rb_data.fd);  /* XXX - the above should have closed this already */
+    if (rb_data.writer == NULL)
+      ws_close(rb_data.fd);  /* XXX - the above should have closed this already */
     rb_data.pdh = NULL;    /* it's still closed, we just got an error while closing */
     rb_data.fd = -1;
     g_free(rb_data.io_buffer);
@@ -312,7 +361,8 @@ ringbuf_libpcap_dump_close(gchar **save_file, int *err)
       if (err != NULL) {
         *err = errno;
       }
-      ws_close(rb_data.fd);
+      if (rb_data.writer == NULL)
+        ws_close(rb_data.fd);
       ret_val = FALSE;
     }
     rb_data.pdh = NULL;
@@ -321,6 +371,8 @@ ringbuf_libpcap_dump_close(gchar **save_file, int *err)
     rb_data.io_buffer = NULL;
 
   }
+  if (rb_data.writer != NULL)
+    async_writer_drop_spare(rb_data.writer);
 
   /* set the save file name to the current file */
   *save_file = rb_data.files[rb_data.curr_file_num % rb_data.num_files].name;
@@ -365,11 +417,13 @@ ringbuf_error_cleanup(void)
 
   /* try to close via wtap */
   if (rb_data.pdh != NULL) {
-    if (fclose(rb_data.pdh) == 0) {
+    if (fclose(rb_data.pdh) == 0 || rb_data.writer != NULL) {
       rb_data.fd = -1;
     }
     rb_data.pdh = NULL;
   }
+  if (rb_data.writer != NULL)
+    async_writer_drop_spare(rb_data.writer);
 
   /* close directly if still open */
   if (rb_data.fd != -1) {
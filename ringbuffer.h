@@ -13,6 +13,7 @@
 
 #include <stdio.h>
 #include "wiretap/wtap.h"
+#include "writecap/async_writer.h"
 
 #define RINGBUFFER_UNLIMITED_FILES 0
 /* Minimum number of ringbuffer files */
@@ -26,6 +27,7 @@
 int ringbuf_init(const char *capture_name, guint num_files, gboolean group_read_access);
 gboolean ringbuf_is_initialized(void);
 const gchar *ringbuf_current_filename(void);
+void ringbuf_set_async_writer(async_writer_t *writer);
 FILE *ringbuf_init_libpcap_fdopen(int *err);
 gboolean ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd,
                              int *err);
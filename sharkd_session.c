@@ -2060,6 +2060,7 @@ sharkd_eo_object_list_add_entry(void *gui_data, export_object_entry_t *entry)
 {
 	struct sharkd_export_object_list *object_list = (struct sharkd_export_object_list *) gui_data;
 
+	eo_keep_entry(entry);
 	object_list->entries = g_slist_append(object_list->entries, entry);
 }
 
@@ -2638,7 +2639,7 @@ sharkd_session_process_frame_cb_tree(epan_dissect_t *edt, proto_tree *tree, tvbu
 
 		json_dumper_begin_object(&dumper);
 
-		if (!finfo->rep)
+		if (!proto_item_get_rep(finfo))
 		{
 			char label_str[ITEM_LABEL_LENGTH];
 
@@ -4064,13 +4065,32 @@ sharkd_session_process_download(char *buf, const jsmntok_t *tokens, int count)
 		{
 			const char *mime     = (eo_entry->content_type) ? eo_entry->content_type : "application/octet-stream";
 			const char *filename = (eo_entry->filename) ? eo_entry->filename : tok_token;
+			guint8 *data = eo_entry->payload_data;
+			gint64 offset = 0;
+			gssize len;
+
+			/* Bring it back into memory if it was moved to disk. */
+			if (!data && eo_entry->payload_len)
+			{
+				data = (guint8 *) g_malloc((gsize) eo_entry->payload_len);
+				while (offset < eo_entry->payload_len && (len = eo_entry_read(eo_entry, offset, data + offset, (gsize) (eo_entry->payload_len - offset))) > 0)
+					offset += len;
+				if (offset < eo_entry->payload_len)
+				{
+					g_free(data);
+					return;
+				}
+			}
 
 			json_dumper_begin_object(&dumper);
 			sharkd_json_value_string("file", filename);
 			sharkd_json_value_string("mime", mime);
-			sharkd_json_value_base64("data", eo_entry->payload_data, (size_t) eo_entry->payload_len);
+			sharkd_json_value_base64("data", data, (size_t) eo_entry->payload_len);
 			json_dumper_end_object(&dumper);
 			json_dumper_finish(&dumper);
+
+			if (data != eo_entry->payload_data)
+				g_free(data);
 		}
 	}
 	else if (!strcmp(tok_token, "ssl-secrets"))
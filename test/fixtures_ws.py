@@ -183,6 +183,7 @@ def features(cmd_tshark, make_env):
         have_gnutls='with GnuTLS' in tshark_v,
         have_pkcs11='and PKCS #11 support' in tshark_v,
         have_brotli='with brotli' in tshark_v,
+        have_libsmi='with SMI' in tshark_v,
     )
 
 
@@ -196,6 +197,7 @@ def dirs():
         config_dir=os.path.join(this_dir, 'config'),
         key_dir=os.path.join(this_dir, 'keys'),
         lua_dir=os.path.join(this_dir, 'lua'),
+        maxmind_dir=os.path.join(this_dir, 'maxmind'),
         tools_dir=os.path.join(this_dir, '..', 'tools'),
     )
 
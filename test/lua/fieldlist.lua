@@ -0,0 +1,188 @@
+-- test script for wslua FieldList functions
+-- use with dhcp.pcap in test/captures directory
+--
+-- It's also a benchmark of FieldList against Field extractors: give it the
+-- number of times to read the fields of every packet, e.g.
+--   tshark -r dhcp.pcap -X lua_script:fieldlist.lua -X lua_script1:20000
+
+
+------------- helper funcs ------------
+local packet_count = 0
+local function incPktCount(name)
+    packet_count = packet_count + 1
+end
+
+local function testing(...)
+    print("---- Testing "..tostring(...).." for packet #"..packet_count.." ----")
+end
+
+local function test(name, ...)
+    io.stdout:write("test "..name.."-"..packet_count.."...")
+    if (...) == true then
+        io.stdout:write("passed\n")
+    else
+        io.stdout:write("failed!\n")
+        error(name.." test failed!")
+    end
+end
+
+-- the following are so we can use pcall (which needs a function to call)
+local function makeFieldList(names)
+    local foo = FieldList.new(names)
+    return true
+end
+
+local function getValues(fieldlist)
+    local foo = fieldlist()
+    return true
+end
+
+--------------------------
+
+local rounds = tonumber(({...})[1]) or 0
+
+testing("FieldList")
+
+test("FieldList.new-0",pcall(makeFieldList,{ "ip.src", "udp.port" }))
+test("FieldList.new-1",pcall(makeFieldList,{}))
+test("FieldList.new-2",not pcall(makeFieldList,{ "ip.src", "FooBARhowdy" }))
+test("FieldList.new-3",not pcall(makeFieldList,"ip.src"))
+test("FieldList.new-4",not pcall(makeFieldList))
+
+local names = {
+    "frame.number",         -- 1
+    "frame.time_relative",  -- 2
+    "eth.src",              -- 3
+    "ip.src",               -- 4
+    "ip.ttl",               -- 5
+    "ip.flags.df",          -- 6
+    "udp.srcport",          -- 7
+    "udp.port",             -- 8
+    "dhcp",                 -- 9
+    "dhcp.hw.mac_addr",     -- 10
+    "dhcp.option.type",     -- 11
+    "tcp.port",             -- 12
+}
+local fields = {}
+for i, name in ipairs(names) do
+    fields[i] = Field.new(name)
+end
+
+local fieldlist = FieldList.new(names)
+
+test("FieldList.len-1", #fieldlist == #names)
+
+-- make sure can't get values outside tap
+test("FieldList__call-1",not pcall(getValues,fieldlist))
+
+test("Listener.new-1",not pcall(Listener.new,"frame",nil,false,"ip.src"))
+
+local tap = Listener.new("frame", nil, false, fieldlist)
+
+-- A tap keeps its FieldList, even if the script doesn't.
+local weak = setmetatable({}, { __mode = "v" })
+weak.fieldlist = FieldList.new({ "udp.srcport" })
+Listener.new("frame", nil, false, weak.fieldlist)
+collectgarbage("collect")
+test("Listener.new-2", weak.fieldlist ~= nil)
+
+local first_values, first_all
+local field_time, fieldlist_time = 0, 0
+local field_garbage, fieldlist_garbage = 0, 0
+
+local function benchmark()
+    local start, kbytes
+
+    collectgarbage("collect")
+    collectgarbage("stop")
+    kbytes = collectgarbage("count")
+    start = os.clock()
+    for _ = 1, rounds do
+        for i = 1, #fields do
+            local finfo = fields[i]()
+            local value = finfo and finfo.value
+        end
+    end
+    field_time = field_time + os.clock() - start
+    field_garbage = field_garbage + collectgarbage("count") - kbytes
+    collectgarbage("restart")
+
+    collectgarbage("collect")
+    collectgarbage("stop")
+    kbytes = collectgarbage("count")
+    start = os.clock()
+    for _ = 1, rounds do
+        local values = fieldlist()
+        for i = 1, #fields do
+            local value = values[i]
+        end
+    end
+    fieldlist_time = fieldlist_time + os.clock() - start
+    fieldlist_garbage = fieldlist_garbage + collectgarbage("count") - kbytes
+    collectgarbage("restart")
+end
+
+--------------------------
+
+function tap.packet(pinfo,tvb)
+    incPktCount()
+
+    testing("FieldList")
+
+    test("FieldList.new-5",not pcall(makeFieldList,{ "ip.src" }))
+
+    local values = fieldlist()
+    first_values = first_values or values
+    test("FieldList__call-2", rawequal(values, first_values))
+
+    test("FieldList__call-3", values[1] == fields[1]().value)
+    test("FieldList__call-4", values[1] == pinfo.number)
+    test("FieldList__call-5", math.abs(values[2] - fields[2]().value:tonumber()) < 0.000001)
+    test("FieldList__call-6", values[3] == tostring(fields[3]()))
+    test("FieldList__call-7", values[4] == tostring(fields[4]()))
+    test("FieldList__call-8", values[5] == fields[5]().value)
+    test("FieldList__call-9", values[6] == fields[6]().value)
+    test("FieldList__call-10", type(values[6]) == "boolean")
+    test("FieldList__call-11", values[7] == fields[7]().value)
+    test("FieldList__call-12", values[8] == fields[8]().value)
+    test("FieldList__call-13", values[9] == true)
+    test("FieldList__call-14", values[10] == tostring(fields[10]()))
+    test("FieldList__call-15", values[11] == fields[11]().value)
+    test("FieldList__call-16", values[12] == nil)
+
+    local all = fieldlist:all()
+    first_all = first_all or all
+    test("FieldList.all-1", rawequal(all, first_all))
+
+    local options = { fields[11]() }
+    test("FieldList.all-2", #all[11] == #options)
+    local same = true
+    for i, finfo in ipairs(options) do
+        same = same and all[11][i] == finfo.value
+    end
+    test("FieldList.all-3", same)
+
+    local ports = { fields[8]() }
+    test("FieldList.all-4", #all[8] == 2 and #ports == 2)
+    test("FieldList.all-5", all[8][1] == ports[1].value and all[8][2] == ports[2].value)
+    test("FieldList.all-6", #all[12] == 0)
+
+    test("Listener.new-3", weak.fieldlist()[1] == fields[7]().value)
+
+    if rounds > 0 then
+        benchmark()
+    end
+
+    if packet_count == 4 then
+        print("\n-----------------------------\n")
+        print("All tests passed!\n\n")
+    end
+
+end
+
+function tap.draw()
+    if rounds > 0 then
+        print(string.format("Field:     %.3f s, %.0f kB of garbage", field_time, field_garbage))
+        print(string.format("FieldList: %.3f s, %.0f kB of garbage", fieldlist_time, fieldlist_garbage))
+    end
+end
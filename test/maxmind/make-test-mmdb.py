@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+#
+# Wireshark tests
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+'''Writes the small MaxMind DB used by maxmind_db_reader_test.
+
+Usage: make-test-mmdb.py [output file]
+
+The database is an IPv6 database with 28 bit records, so IPv4 networks
+live under ::/96. It uses the data types the reader handles: maps, arrays,
+pointers, strings, doubles, floats and integers, including a negative
+int32.
+'''
+
+import ipaddress
+import struct
+import sys
+
+RECORD_SIZE = 28
+METADATA_MARKER = b'\xab\xcd\xefMaxMind.com'
+
+
+class Pointer:
+    def __init__(self, offset):
+        self.offset = offset
+
+
+class Float:
+    def __init__(self, value):
+        self.value = value
+
+
+class Int32:
+    def __init__(self, value):
+        self.value = value
+
+
+class UInt16:
+    def __init__(self, value):
+        self.value = value
+
+
+class UInt64:
+    def __init__(self, value):
+        self.value = value
+
+
+def control(type_num, size):
+    if type_num > 7:
+        first, extended = 0, bytes([type_num - 7])
+    else:
+        first, extended = type_num << 5, b''
+    if size < 29:
+        return bytes([first | size]) + extended
+    if size < 285:
+        return bytes([first | 29]) + extended + bytes([size - 29])
+    if size < 65821:
+        return bytes([first | 30]) + extended + struct.pack('>H', size - 285)
+    return bytes([first | 31]) + extended + (size - 65821).to_bytes(3, 'big')
+
+
+def uint_bytes(value, max_len):
+    data = value.to_bytes(max_len, 'big').lstrip(b'\0')
+    return data
+
+
+def encode(value):
+    if isinstance(value, Pointer):
+        assert value.offset < 2048
+        return bytes([(1 << 5) | (value.offset >> 8), value.offset & 0xff])
+    if isinstance(value, str):
+        data = value.encode('utf-8')
+        return control(2, len(data)) + data
+    if isinstance(value, float):
+        return control(3, 8) + struct.pack('>d', value)
+    if isinstance(value, UInt16):
+        data = uint_bytes(value.value, 2)
+        return control(5, len(data)) + data
+    if isinstance(value, int):
+        data = uint_bytes(value, 4)
+        return control(6, len(data)) + data
+    if isinstance(value, dict):
+        data = control(7, len(value))
+        for key, item in value.items():
+            data += encode(key) + encode(item)
+        return data
+    if isinstance(value, Int32):
+        if value.value < 0:
+            data = struct.pack('>i', value.value)
+        else:
+            data = uint_bytes(value.value, 4)
+        return control(8, len(data)) + data
+    if isinstance(value, UInt64):
+        data = uint_bytes(value.value, 8)
+        return control(9, len(data)) + data
+    if isinstance(value, list):
+        data = control(11, len(value))
+        for item in value:
+            data += encode(item)
+        return data
+    if isinstance(value, Float):
+        return control(15, 4) + struct.pack('>f', value.value)
+    raise TypeError(value)
+
+
+def make_database():
+    data = b''
+
+    def add(value):
+        nonlocal data
+        offset = len(data)
+        data += encode(value)
+        return offset
+
+    us = add({'iso_code': 'US', 'names': {'en': 'United States'}})
+    testville = add({
+        'city': {'names': {'en': 'Testville'}},
+        'country': Pointer(us),
+        'location': {
+            'latitude': 37.5,
+            'longitude': -122.25,
+            'accuracy_radius': UInt16(20),
+            'time_zone': 'America/Los_Angeles',
+        },
+        'autonomous_system_number': 64496,
+        'autonomous_system_organization': 'Example AS',
+        'test_negative': Int32(-5),
+        'test_positive': Int32(7),
+    })
+    pointerville = add({
+        'city': {'names': {'en': 'Pointerville'}},
+        'country': Pointer(us),
+    })
+    berlin = add({
+        'country': {'iso_code': 'DE', 'names': {'en': 'Germany'}},
+        'location': {'latitude': Float(52.5), 'longitude': 13.375},
+    })
+
+    networks = [
+        (ipaddress.ip_network('192.0.2.0/24'), testville),
+        (ipaddress.ip_network('198.51.100.0/25'), pointerville),
+        (ipaddress.ip_network('2001:db8::/32'), berlin),
+    ]
+
+    # A binary trie over 128 bit addresses; IPv4 networks go under ::/96.
+    root = [None, None]
+    for network, offset in networks:
+        if network.version == 4:
+            bits = int(network.network_address) & 0xffffffff
+            prefix_len = 96 + network.prefixlen
+        else:
+            bits = int(network.network_address)
+            prefix_len = network.prefixlen
+        node = root
+        for i in range(prefix_len - 1):
+            bit = (bits >> (127 - i)) & 1
+            if node[bit] is None:
+                node[bit] = [None, None]
+            node = node[bit]
+        node[(bits >> (128 - prefix_len)) & 1] = ('data', offset)
+
+    nodes = []
+    queue = [root]
+    while queue:
+        node = queue.pop(0)
+        nodes.append(node)
+        for child in node:
+            if isinstance(child, list):
+                queue.append(child)
+    numbers = {id(node): i for i, node in enumerate(nodes)}
+    node_count = len(nodes)
+
+    def record(child):
+        if child is None:
+            return node_count
+        if isinstance(child, list):
+            return numbers[id(child)]
+        return node_count + 16 + child[1]
+
+    tree = b''
+    for node in nodes:
+        left, right = record(node[0]), record(node[1])
+        tree += (left & 0xffffff).to_bytes(3, 'big')
+        tree += bytes([((left >> 20) & 0xf0) | ((right >> 24) & 0x0f)])
+        tree += (right & 0xffffff).to_bytes(3, 'big')
+
+    metadata = encode({
+        'node_count': node_count,
+        'record_size': UInt16(RECORD_SIZE),
+        'ip_version': UInt16(6),
+        'database_type': 'Wireshark-Test',
+        'languages': ['en'],
+        'binary_format_major_version': UInt16(2),
+        'binary_format_minor_version': UInt16(0),
+        'build_epoch': UInt64(1577836800),
+        'description': {'en': 'Wireshark maxmind_db_reader_test database'},
+    })
+
+    return tree + b'\0' * 16 + data + METADATA_MARKER + metadata
+
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else 'wireshark-test.mmdb'
+    with open(path, 'wb') as f:
+        f.write(make_database())
+
+
+if __name__ == '__main__':
+    main()
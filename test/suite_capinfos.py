@@ -0,0 +1,158 @@
+#
+# -*- coding: utf-8 -*-
+# Wireshark tests
+# By Gerald Combs <gerald@wireshark.org>
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+'''Capinfos tests'''
+
+import hashlib
+import os
+import shutil
+import struct
+import subprocesstest
+import fixtures
+
+capinfos_files = (
+    'dhcp.pcap',
+    'dhcp.pcapng',
+    'dhcp-nanosecond.pcapng',
+    'dhe1.pcapng.gz',
+    'dns+icmp.pcapng.gz',
+    'http.pcap',
+    'many_interfaces.pcapng.1',
+    'empty.pcap',
+    'sample_control4_2012-03-24.pcap',
+    'snakeoil-dtls.pcap',
+)
+
+header_scan_files = (
+    'dhcp.pcapng',
+    'dhcp-nanosecond.pcapng',
+    'dmgr.pcapng',
+    'dns+icmp.pcapng.gz',
+    'http2-brotli.pcapng',
+    'many_interfaces.pcapng.1',
+    'many_interfaces.pcapng.2',
+    'sample_control4_2012-03-24.pcap',
+)
+
+
+def write_pcapng(filename, num_packets=200, truncate=0):
+    '''Writes a pcapng file with Ethernet packets of all sizes up to
+    jumbograms, some with comments, so that reading it skips over small
+    and large amounts of packet data. If truncate is not zero, that many
+    bytes are cut off the end of the file.'''
+    def block(block_type, body):
+        body += b'\0' * (-len(body) % 4)
+        length = 12 + len(body)
+        return struct.pack('<II', block_type, length) + body + struct.pack('<I', length)
+
+    def option(code, value):
+        return struct.pack('<HH', code, len(value)) + value + b'\0' * (-len(value) % 4)
+
+    data = block(0x0A0D0D0A, struct.pack('<IHHq', 0x1A2B3C4D, 1, 0, -1))
+    data += block(1, struct.pack('<HHI', 1, 0, 0))
+    for i in range(num_packets):
+        pkt_len = (i * 7919) % 20000 + 14
+        cap_len = min(pkt_len, 16000)
+        ts = 1500000000 * 1000000 + i * 1234567
+        body = struct.pack('<IIIII', 0, ts >> 32, ts & 0xffffffff, cap_len, pkt_len)
+        body += bytes(j % 256 for j in range(cap_len))
+        body += b'\0' * (-cap_len % 4)
+        if i % 3 == 0:
+            body += option(1, 'packet {}'.format(i).encode()) + option(0, b'')
+        data += block(6, body)
+    if truncate:
+        data = data[:-truncate]
+    with open(filename, 'wb') as f:
+        f.write(data)
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_capinfos(subprocesstest.SubprocessTestCase):
+    def test_capinfos_threads(self, cmd_capinfos, capture_file):
+        '''Files processed in parallel are reported on in order'''
+        files = [capture_file(f) for f in capinfos_files] * 3
+        for report_args in (('-T',), ('-T', '-m', '-Q'), ()):
+            proc = self.assertRun((cmd_capinfos,) + report_args + tuple(files))
+            sequential = proc.stdout_str
+            proc = self.assertRun((cmd_capinfos, '--threads', '4') + report_args + tuple(files))
+            self.assertEqual(proc.stdout_str, sequential)
+
+    def test_capinfos_hashes(self, cmd_capinfos, capture_file):
+        '''Hashes computed while reading the file match the file's hashes'''
+        algorithms = [('SHA256', 'sha256'), ('SHA1', 'sha1')]
+        if 'ripemd160' in hashlib.algorithms_available:
+            algorithms.append(('RIPEMD160', 'ripemd160'))
+        for cap_file in capinfos_files:
+            cap_file = capture_file(cap_file)
+            with open(cap_file, 'rb') as f:
+                contents = f.read()
+            proc = self.assertRun((cmd_capinfos, '-H', cap_file))
+            for name, algorithm in algorithms:
+                digest = hashlib.new(algorithm, contents).hexdigest()
+                self.assertIn('{}:'.format(name).ljust(21) + digest, proc.stdout_str,
+                    '{} of {}'.format(name, cap_file))
+
+    def test_capinfos_cache(self, cmd_capinfos, capture_file):
+        '''Unchanged files are reported on from the cache'''
+        cap_file = self.filename_from_id('capinfos.pcap')
+        cache_file = self.filename_from_id('capinfos.cache')
+        shutil.copyfile(capture_file('dhcp.pcap'), cap_file)
+        capinfos_cmd = (cmd_capinfos, '-c', '--cache', cache_file, cap_file)
+
+        proc = self.assertRun(capinfos_cmd)
+        self.assertIn('Number of packets:   4\n', proc.stdout_str)
+        self.assertTrue(os.path.isfile(cache_file))
+
+        # Doctor the cached report, to see whether it's used.
+        with open(cache_file) as f:
+            cache = f.read()
+        self.assertIn('Number of packets:   4\\n', cache)
+        with open(cache_file, 'w') as f:
+            f.write(cache.replace('Number of packets:   4\\n', 'Number of packets:   42\\n'))
+        proc = self.assertRun(capinfos_cmd)
+        self.assertIn('Number of packets:   42\n', proc.stdout_str)
+
+        # Other options don't use the same cache.
+        proc = self.assertRun((cmd_capinfos, '-c', '-M', '--cache', cache_file, cap_file))
+        self.assertIn('Number of packets:   4\n', proc.stdout_str)
+
+        # A file that's been modified is read again.
+        proc = self.assertRun(capinfos_cmd)
+        self.assertIn('Number of packets:   4\n', proc.stdout_str)
+        with open(cache_file) as f:
+            cache = f.read()
+        with open(cache_file, 'w') as f:
+            f.write(cache.replace('Number of packets:   4\\n', 'Number of packets:   42\\n'))
+        mtime = os.stat(cap_file).st_mtime
+        os.utime(cap_file, (mtime + 10, mtime + 10))
+        proc = self.assertRun(capinfos_cmd)
+        self.assertIn('Number of packets:   4\n', proc.stdout_str)
+
+    def test_capinfos_header_scan(self, cmd_capinfos, capture_file):
+        '''Skipping packet data gives the same infos as reading it'''
+        files = [capture_file(f) for f in header_scan_files]
+        files.append(self.filename_from_id('capinfos.pcapng'))
+        write_pcapng(files[-1])
+        for report_args in (('-T', '-c', '-a', '-e', '-u', '-i'), ('-M',), ('-T', '-S')):
+            proc = self.assertRun((cmd_capinfos,) + report_args + tuple(files))
+            header_scan = proc.stdout_str
+            proc = self.assertRun((cmd_capinfos, '--full-read') + report_args + tuple(files))
+            self.assertEqual(header_scan, proc.stdout_str)
+        proc = self.assertRun((cmd_capinfos, '-c', files[-1]))
+        self.assertIn('Number of packets:   200\n', proc.stdout_str)
+
+    def test_capinfos_header_scan_truncated(self, cmd_capinfos):
+        '''A cut-off packet is noticed when skipping packet data'''
+        cap_file = self.filename_from_id('capinfos.pcapng')
+        for truncate in (4, 100, 10000):
+            write_pcapng(cap_file, truncate=truncate)
+            proc = self.assertRun((cmd_capinfos, '-c', '-d', cap_file), expected_return=1)
+            header_scan = proc.stdout_str
+            self.assertIn('Number of packets:   199\n', header_scan)
+            proc = self.assertRun((cmd_capinfos, '--full-read', '-c', '-d', cap_file), expected_return=1)
+            self.assertEqual(header_scan, proc.stdout_str)
@@ -119,6 +119,28 @@ def check_capture_10_packets(capture_interface, cmd_dumpcap, traffic_generator):
     return check_capture_10_packets_real
 
 
+@fixtures.fixture
+def cmd_dumpcap_tpacket(cmd_dumpcap):
+    '''Dumpcap, if it can capture through its own TPACKET_V3 rings.'''
+    proc = subprocess.Popen((cmd_dumpcap, '-h'), stdout=subprocess.PIPE,
+                            stderr=subprocess.PIPE, universal_newlines=True)
+    outs, errs = proc.communicate()
+    if '--tpacket' not in outs:
+        fixtures.skip('Dumpcap was built without TPACKET_V3 support.')
+    return cmd_dumpcap
+
+
+@fixtures.fixture
+def cmd_dumpcap_async_write(cmd_dumpcap):
+    '''Dumpcap, if it can write its output from a separate thread.'''
+    proc = subprocess.Popen((cmd_dumpcap, '-h'), stdout=subprocess.PIPE,
+                            stderr=subprocess.PIPE, universal_newlines=True)
+    outs, errs = proc.communicate()
+    if '--async-write' not in outs:
+        fixtures.skip('Dumpcap was built without async write support.')
+    return cmd_dumpcap
+
+
 @fixtures.fixture
 def check_capture_fifo(cmd_dumpcap):
     if sys.platform == 'win32':
@@ -177,6 +199,36 @@ def check_capture_stdin(cmd_dumpcap):
     return check_capture_stdin_real
 
 
+@fixtures.fixture
+def check_capture_shm_buffer(cmd_tshark):
+    proc = subprocess.Popen((cmd_tshark, '-h'), stdout=subprocess.PIPE,
+                            stderr=subprocess.PIPE, universal_newlines=True)
+    outs, errs = proc.communicate()
+    if '--shm-buffer' not in outs or sys.platform == 'win32':
+        fixtures.skip('TShark can\'t read captured packets from shared memory.')
+
+    def check_capture_shm_buffer_real(self):
+        testout_file = self.filename_from_id(testout_pcap)
+        slow_dhcp_cmd = subprocesstest.cat_dhcp_command('slow')
+        capture_cmd = capture_command(cmd_tshark,
+            '-i', '-',
+            '--shm-buffer', '1',
+            '-P',
+            '-w', testout_file,
+            '-a', 'duration:{}'.format(capture_duration),
+            shell=True
+        )
+        capture_proc = self.assertRun(slow_dhcp_cmd + ' | ' + capture_cmd, shell=True)
+        self.assertTrue(os.path.isfile(testout_file))
+        self.checkPacketCount(8)
+        # Everything came from the buffer, so there's nothing to report.
+        self.assertFalse(self.grepOutput('Shared memory buffer', proc=capture_proc))
+        # What was read from the buffer is what was written to the file.
+        read_proc = self.assertRun((cmd_tshark, '-r', testout_file))
+        self.assertEqual(capture_proc.stdout_str, read_proc.stdout_str)
+    return check_capture_shm_buffer_real
+
+
 @fixtures.fixture
 def check_capture_read_filter(capture_interface, traffic_generator):
     start_traffic, cfilter = traffic_generator
@@ -262,7 +314,7 @@ def check_dumpcap_autostop_stdin(cmd_dumpcap):
 
 @fixtures.fixture
 def check_dumpcap_ringbuffer_stdin(cmd_dumpcap):
-    def check_dumpcap_ringbuffer_stdin_real(self, packets=None, filesize=None):
+    def check_dumpcap_ringbuffer_stdin_real(self, packets=None, filesize=None, cmd=None):
         # Similar to check_capture_stdin.
         rb_unique = 'dhcp_rb_' + uuid.uuid4().hex[:6] # Random ID
         testout_file = '{}.{}.pcapng'.format(self.id(), rb_unique)
@@ -278,7 +330,9 @@ def check_dumpcap_ringbuffer_stdin(cmd_dumpcap):
         elif filesize is not None:
             condition = 'filesize:{}'.format(filesize)
 
-        capture_cmd = ' '.join((cmd_dumpcap,
+        if cmd is None:
+            cmd = (cmd_dumpcap,)
+        capture_cmd = ' '.join(cmd + (
             '-i', '-',
             '-w', testout_file,
             '-a', 'files:2',
@@ -520,6 +574,10 @@ class case_tshark_capture(subprocesstest.SubprocessTestCase):
         '''Capture truncated packets using TShark'''
         check_capture_snapshot_len(self, cmd=cmd_tshark)
 
+    def test_tshark_capture_shm_buffer(self, check_capture_shm_buffer):
+        '''Capture from stdin, reading the packets through shared memory, using TShark'''
+        check_capture_shm_buffer(self)
+
 
 @fixtures.mark_usefixtures('base_env')
 @fixtures.uses_fixtures
@@ -544,6 +602,18 @@ class case_dumpcap_capture(subprocesstest.SubprocessTestCase):
         '''Capture truncated packets using Dumpcap'''
         check_capture_snapshot_len(self, cmd=cmd_dumpcap)
 
+    def test_dumpcap_capture_10_packets_tpacket(self, cmd_dumpcap_tpacket, check_capture_10_packets):
+        '''Capture 10 packets through TPACKET_V3 rings using Dumpcap'''
+        check_capture_10_packets(self, cmd=(cmd_dumpcap_tpacket, '--tpacket'))
+
+    def test_dumpcap_capture_10_packets_fanout(self, cmd_dumpcap_tpacket, check_capture_10_packets):
+        '''Capture 10 packets through two fanout rings using Dumpcap'''
+        check_capture_10_packets(self, cmd=(cmd_dumpcap_tpacket, '--fanout', '2'))
+
+    def test_dumpcap_capture_snapshot_len_tpacket(self, check_capture_snapshot_len, cmd_dumpcap_tpacket):
+        '''Capture truncated packets through TPACKET_V3 rings using Dumpcap'''
+        check_capture_snapshot_len(self, cmd=(cmd_dumpcap_tpacket, '--tpacket'))
+
 
 @fixtures.mark_usefixtures('base_env')
 @fixtures.uses_fixtures
@@ -570,6 +640,14 @@ class case_dumpcap_ringbuffer(subprocesstest.SubprocessTestCase):
         '''Capture from stdin using Dumpcap and write multiple files until we reach a packet limit'''
         check_dumpcap_ringbuffer_stdin(self, packets=47) # Last prime before 50. Arbitrary.
 
+    def test_dumpcap_ringbuffer_filesize_async(self, check_dumpcap_ringbuffer_stdin, cmd_dumpcap_async_write):
+        '''Capture from stdin using Dumpcap and write multiple files from the writer thread until we reach a file size limit'''
+        check_dumpcap_ringbuffer_stdin(self, filesize=15, cmd=(cmd_dumpcap_async_write, '--async-write'))
+
+    def test_dumpcap_ringbuffer_packets_async(self, check_dumpcap_ringbuffer_stdin, cmd_dumpcap_async_write):
+        '''Capture from stdin using Dumpcap and write multiple files from the writer thread until we reach a packet limit'''
+        check_dumpcap_ringbuffer_stdin(self, packets=47, cmd=(cmd_dumpcap_async_write, '--async-write'))
+
 
 @fixtures.mark_usefixtures('base_env')
 @fixtures.uses_fixtures
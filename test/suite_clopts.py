@@ -211,6 +211,58 @@ class case_tshark_dump_glossaries(subprocesstest.SubprocessTestCase):
         self.assertEqual([unicode_env.pluginsdir], pluginsdir)
 
 
+@fixtures.uses_fixtures
+class case_tshark_startup_clopts(subprocesstest.SubprocessTestCase):
+    def run_fields(self, cmd_tshark, capture_file, env, options):
+        proc = self.assertRun((cmd_tshark, '-r', capture_file) + options, env=env)
+        self.assertEqual(self.countOutput('OOPS', count_stdout=False, count_stderr=True), 0)
+        return proc.stdout_str
+
+    def test_tshark_only_protocols(self, cmd_tshark, capture_file, base_env):
+        '''--only-protocols dissects the listed stack like a full startup'''
+        env = base_env
+        env['WIRESHARK_ABORT_ON_DISSECTOR_BUG'] = '1'
+        options = ('-Y', 'http', '-T', 'fields', '-e', 'ip.src', '-e', 'tcp.srcport', '-e', 'http.request.uri')
+        expected = self.run_fields(cmd_tshark, capture_file('http.pcap'), env, options)
+        self.assertIn('/v4/iuident.cab', expected)
+        # The ethertype table and handle that eth and ip use belong to an
+        # unlisted protocol.
+        actual = self.run_fields(cmd_tshark, capture_file('http.pcap'), env,
+            ('--only-protocols', 'eth,ip,tcp,http') + options)
+        self.assertEqual(actual, expected)
+
+    def test_tshark_only_protocols_table_owner_after(self, cmd_tshark, capture_file, base_env):
+        '''--only-protocols where a listed protocol adds to a table that is only pulled in later'''
+        env = base_env
+        env['WIRESHARK_ABORT_ON_DISSECTOR_BUG'] = '1'
+        options = ('-Y', 'arp', '-T', 'fields', '-e', 'arp.opcode')
+        expected = self.run_fields(cmd_tshark, capture_file('arp.pcap'), env, options)
+        self.assertNotEqual(expected, '')
+        actual = self.run_fields(cmd_tshark, capture_file('arp.pcap'), env,
+            ('--only-protocols', 'arp,eth') + options)
+        self.assertEqual(actual, expected)
+
+    def test_tshark_only_protocols_unlisted(self, cmd_tshark, capture_file, base_env):
+        '''Protocols that aren't listed or needed can't be filtered on'''
+        env = base_env
+        env['WIRESHARK_ABORT_ON_DISSECTOR_BUG'] = '1'
+        self.assertRun((cmd_tshark, '-r', capture_file('http.pcap'),
+            '--only-protocols', 'eth', '-Y', 'http'),
+            env=env, expected_return=self.exit_error)
+        self.assertTrue(self.grepOutput('"http" is neither a field nor a protocol name'))
+
+    def test_tshark_startup_profile(self, cmd_tshark, capture_file, base_env):
+        '''--startup-profile reports the startup phases and the slowest routines'''
+        self.assertRun((cmd_tshark, '--startup-profile', '-r', capture_file('http.pcap')), env=base_env)
+        self.assertTrue(self.grepOutput('HEAD.*/v4/iuident.cab'))
+        for pattern in ('^epan_init:$', r'ms  protocol registration and handoffs$',
+                        r'ms  total$', '^Protocol registration and handoffs:$',
+                        r'ms  \d+ built-in registration routines$',
+                        r'ms  proto_register_', '^Startup total'):
+            self.assertEqual(self.countOutput(pattern, count_stdout=False, count_stderr=True) > 0,
+                True, 'No match for ' + pattern)
+
+
 @fixtures.mark_usefixtures('test_env')
 @fixtures.uses_fixtures
 class case_tshark_z_expert(subprocesstest.SubprocessTestCase):
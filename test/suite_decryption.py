@@ -10,6 +10,7 @@
 '''Decryption tests'''
 
 import os.path
+import random
 import shutil
 import subprocess
 import subprocesstest
@@ -528,6 +529,56 @@ class case_decrypt_tls(subprocesstest.SubprocessTestCase):
             r'13||Request for /second, version TLSv1.3, Early data: yes\n',
         ], proc.stdout_str.splitlines())
 
+    def test_tls13_keylog_index(self, cmd_tshark, dirs, features, capture_file):
+        '''TLS 1.3 with the secrets among many others in the keylog file.'''
+        if not features.have_libgcrypt16:
+            self.skipTest('Requires GCrypt 1.6 or later.')
+        with open(os.path.join(dirs.key_dir, 'tls13-rfc8446.keys')) as f:
+            secrets = f.read().splitlines()
+        rng = random.Random(8446)
+        def hexbytes(n):
+            return ''.join('%02x' % rng.randrange(256) for _ in range(n))
+        labels = ('CLIENT_RANDOM', 'PMS_CLIENT_RANDOM', 'CLIENT_EARLY_TRAFFIC_SECRET',
+            'CLIENT_HANDSHAKE_TRAFFIC_SECRET', 'SERVER_HANDSHAKE_TRAFFIC_SECRET',
+            'CLIENT_TRAFFIC_SECRET_0', 'SERVER_TRAFFIC_SECRET_0', 'EXPORTER_SECRET')
+        lines = []
+        for i in range(20000):
+            lines.append('{} {} {}'.format(rng.choice(labels), hexbytes(32), hexbytes(48)))
+            if i % 100 == 0:
+                lines.append('RSA Session-ID:{} Master-Key:{}'.format(hexbytes(32), hexbytes(48)))
+                lines.append('# comment {}'.format(i))
+        # Stale secrets for the same Client Randoms come first, the last
+        # ones win.
+        half = len(lines) // 2
+        for line in secrets:
+            label, client_random, secret = line.split()
+            lines.insert(rng.randrange(half), '{} {} {}'.format(label, client_random, hexbytes(32)))
+        for line in secrets[:-1]:
+            label, client_random, secret = line.split()
+            lines.insert(rng.randrange(half + len(secrets), len(lines)), '{} {} {}'.format(label, client_random.upper(), secret))
+        key_file = self.filename_from_id('tls13-index.keys')
+        with open(key_file, 'w', newline='') as f:
+            # An unterminated last line isn't indexed, it's read as before.
+            f.write('\r\n'.join(lines + [secrets[-1]]))
+        proc = self.assertRun((cmd_tshark,
+                '-r', capture_file('tls13-rfc8446.pcap'),
+                '-otls.keylog_file:{}'.format(key_file),
+                '-Y', 'http',
+                '-Tfields',
+                '-e', 'frame.number',
+                '-e', 'http.request.uri',
+                '-e', 'http.file_data',
+                '-E', 'separator=|',
+            ))
+        self.assertEqual([
+            r'5|/first|',
+            r'6||Request for /first, version TLSv1.3, Early data: no\n',
+            r'8|/early|',
+            r'10||Request for /early, version TLSv1.3, Early data: yes\n',
+            r'12|/second|',
+            r'13||Request for /second, version TLSv1.3, Early data: yes\n',
+        ], proc.stdout_str.splitlines())
+
     def test_tls12_dsb(self, cmd_tshark, capture_file):
         '''TLS 1.2 with master secrets in pcapng Decryption Secrets Blocks.'''
         output = self.assertRun((cmd_tshark,
@@ -3,8 +3,10 @@
 #
 # SPDX-License-Identifier: GPL-2.0-or-later
 
+import struct
 import unittest
 import fixtures
+import subprocesstest
 from suite_dfilter.dfiltertest import *
 
 
@@ -177,3 +179,98 @@ class case_string(unittest.TestCase):
     def test_contains_unicode(self, checkDFilterCount):
         dfilter = 'tcp.flags.str contains "·······AP···"'
         checkDFilterCount(dfilter, 1)
+
+    def test_matches_1(self, checkDFilterCount):
+        dfilter = 'http.user_agent matches "update"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_2(self, checkDFilterCount):
+        dfilter = 'http.user_agent matches "^Industry +Update Control$"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_3(self, checkDFilterCount):
+        dfilter = 'http.user_agent matches "Industrx?y Upd(ate)? Control"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_4(self, checkDFilterCount):
+        dfilter = 'http.user_agent matches "Updatex{0,2} Control"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_5(self, checkDFilterCount):
+        dfilter = 'http.user_agent matches "Nothing|Update"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_6(self, checkDFilterCount):
+        dfilter = 'http.user_agent matches "Update\\\\.? Control"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_7(self, checkDFilterCount):
+        dfilter = 'http matches "industry update"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_fail_1(self, checkDFilterCount):
+        dfilter = 'http.user_agent matches "Update Controller"'
+        checkDFilterCount(dfilter, 0)
+
+    def test_matches_escape_hex(self, checkDFilterCount):
+        dfilter = 'http.user_agent matches "Industry \\\\x55pdate Control"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_escape_hex_braces(self, checkDFilterCount):
+        dfilter = 'http.user_agent matches "Industry \\\\x{55}pdate Control"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_escape_octal(self, checkDFilterCount):
+        dfilter = 'http.user_agent matches "Industry \\\\125pdate Control"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_escape_named_backref(self, checkDFilterCount):
+        dfilter = 'http.user_agent matches "(?<n>t)ry Upda\\\\k<n>e Control"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_escape_relative_backref(self, checkDFilterCount):
+        dfilter = 'http.user_agent matches "(t)ry Upda\\\\g{-1}e Control"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_escape_fail(self, checkDFilterCount):
+        dfilter = 'http.user_agent matches "Industry \\\\x55pdate Controller"'
+        checkDFilterCount(dfilter, 0)
+
+    def test_matches_caseless_unicode(self, checkDFilterCount):
+        dfilter = 'tcp.flags.str matches "·······ap···"'
+        checkDFilterCount(dfilter, 1)
+
+    def test_matches_caseless_unicode_fail(self, checkDFilterCount):
+        dfilter = 'tcp.flags.str matches "·······aps··"'
+        checkDFilterCount(dfilter, 0)
+
+
+def write_udp_capture(filename, payload):
+    '''Writes a capture of one UDP datagram between unregistered ports, so
+    that the payload is dissected as data.'''
+    udp = struct.pack('>HHHH', 40000, 40001, 8 + len(payload), 0) + payload
+    ip = struct.pack('>BBHHHBBH4s4s', 0x45, 0, 20 + len(udp), 0, 0, 64, 17, 0,
+                     b'\x0a\x00\x00\x01', b'\x0a\x00\x00\x02') + udp
+    with open(filename, 'wb') as f:
+        # pcap file header, LINKTYPE_IPV4
+        f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 228))
+        f.write(struct.pack('<IIII', 0, 0, len(ip), len(ip)))
+        f.write(ip)
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_string_utf8(subprocesstest.SubprocessTestCase):
+    def count_matches(self, cmd_tshark, capture_file, pattern):
+        self.assertRun((cmd_tshark, '-n', '-r', capture_file,
+                        '-Y', 'data.data matches "%s"' % pattern))
+        return self.countOutput('UDP')
+
+    def test_matches_caseless_kelvin(self, cmd_tshark):
+        '''A caseless UTF-8 pattern matches "k" to U+212A KELVIN SIGN, which
+        the subject has instead of the "k" of the literal.'''
+        capture_file = self.filename_from_id('kelvin.pcap')
+        write_udp_capture(capture_file, 'Boiling at 373 \u212a'.encode('utf-8'))
+        self.assertEqual(self.count_matches(cmd_tshark, capture_file, '(*UTF8)at 373 k$'), 1)
+        self.assertEqual(self.count_matches(cmd_tshark, capture_file, 'at 373 k$'), 0)
+        self.assertEqual(self.count_matches(cmd_tshark, capture_file, '(*UTF8)at 374 k$'), 0)
@@ -0,0 +1,152 @@
+#
+# -*- coding: utf-8 -*-
+# Wireshark tests
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+'''Export Objects tests'''
+
+import os
+import struct
+import tempfile
+import subprocesstest
+import fixtures
+
+
+def write_tcp_capture(filename, sport, dport, messages):
+    '''Writes a capture of a TCP connection from 10.0.0.1:sport to
+    10.0.0.2:dport. messages is a list of (from_client, payload) pairs,
+    each of which is sent in its own segment.'''
+    seqs = {True: 1000, False: 5000}
+    packets = []
+
+    def add_packet(from_client, flags, payload=b''):
+        src, dst = b'\x0a\x00\x00\x01', b'\x0a\x00\x00\x02'
+        sp, dp = sport, dport
+        if not from_client:
+            src, dst, sp, dp = dst, src, dp, sp
+        ack = seqs[not from_client] if flags & 0x10 else 0
+        tcp = struct.pack('>HHIIBBHHH', sp, dp, seqs[from_client], ack,
+                          5 << 4, flags, 65535, 0, 0)
+        ip = struct.pack('>BBHHHBBH4s4s', 0x45, 0, 20 + len(tcp) + len(payload),
+                         0, 0, 64, 6, 0, src, dst)
+        packets.append(ip + tcp + payload)
+        seqs[from_client] += len(payload) + (1 if flags & 0x02 else 0)
+
+    add_packet(True, 0x02)
+    add_packet(False, 0x12)
+    add_packet(True, 0x10)
+    for from_client, payload in messages:
+        add_packet(from_client, 0x18, payload)
+
+    with open(filename, 'wb') as f:
+        # pcap file header, LINKTYPE_IPV4
+        f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 228))
+        for num, packet in enumerate(packets):
+            f.write(struct.pack('<IIII', num, 0, len(packet), len(packet)))
+            f.write(packet)
+
+
+def http_request(uri):
+    return b'GET ' + uri + b' HTTP/1.1\r\nHost: 10.0.0.2\r\n\r\n'
+
+
+def http_response(body, content_type=b'text/plain'):
+    return (b'HTTP/1.1 200 OK\r\nContent-Type: ' + content_type +
+            b'\r\nContent-Length: %d\r\n\r\n' % len(body) + body)
+
+
+def smb_message(cmd, mid, words, data=b'', response=False):
+    '''Returns an SMB1 message from pid 100 on tid 1 and uid 1, with the
+    NBSS header in front of it. Strings are ASCII.'''
+    header = struct.pack('<4sBIBHH8sHHHHH', b'\xffSMB', cmd, 0,
+                         0x98 if response else 0x18, 0x4001, 0, b'', 0,
+                         1, 100, 1, mid)
+    smb = (header + struct.pack('<B', len(words) // 2) + words +
+           struct.pack('<H', len(data)) + data)
+    return struct.pack('>I', len(smb)) + smb
+
+
+def smb_nt_create(mid, name):
+    name += b'\0'
+    return smb_message(0xa2, mid, struct.pack('<BBHBHIIIQIIIIIB',
+                                              0xff, 0, 0, 0, len(name) - 1,
+                                              0, 0, 0x2019f, 0, 0x80, 0, 5,
+                                              0x40, 2, 0), name)
+
+
+def smb_nt_create_response(mid, fid, end_of_file):
+    return smb_message(0xa2, mid, struct.pack('<BBHBHI32sIQQHHB',
+                                              0xff, 0, 0, 0, fid, 2, b'',
+                                              0x80, 4096, end_of_file,
+                                              0, 0, 0), response=True)
+
+
+def smb_write_andx(mid, fid, offset, data):
+    # The data follows the header, the words and the byte count.
+    return smb_message(0x2f, mid, struct.pack('<BBHHIIHHHHH',
+                                              0xff, 0, 0, fid, offset, 0, 0,
+                                              0, 0, len(data), 32 + 1 + 24 + 2),
+                       data)
+
+
+def read_objects(dirname):
+    '''Returns the name and contents of each file in dirname.'''
+    objects = {}
+    for name in os.listdir(dirname):
+        with open(os.path.join(dirname, name), 'rb') as f:
+            objects[name] = f.read()
+    return objects
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_export_objects(subprocesstest.SubprocessTestCase):
+    def test_export_objects_http(self, cmd_tshark):
+        '''Exports each HTTP body to its own file, including one that's
+        reassembled from several segments and one whose name is taken.'''
+        capture_file = self.filename_from_id('http.pcap')
+        big = bytes(i * 7 % 251 for i in range(3000))
+        big_response = http_response(big, b'application/octet-stream')
+        write_tcp_capture(capture_file, 40000, 80, [
+            (True, http_request(b'/files/hello.txt')),
+            (False, http_response(b'Hello, world\n')),
+            (True, http_request(b'/files/big.bin')),
+            (False, big_response[:1100]),
+            (False, big_response[1100:2100]),
+            (False, big_response[2100:]),
+            (True, http_request(b'/files/hello.txt')),
+            (False, http_response(b'Hello again\n')),
+        ])
+        with tempfile.TemporaryDirectory(prefix='wireshark-tests-eo-') as dirname:
+            self.assertRun((cmd_tshark,
+                            '-r', capture_file,
+                            '-Q',
+                            '--export-objects', 'http,' + dirname,
+                            ))
+            self.assertEqual(read_objects(dirname), {
+                'hello.txt': b'Hello, world\n',
+                'big.bin': big,
+                'hello(1).txt': b'Hello again\n',
+            })
+
+    def test_export_objects_smb(self, cmd_tshark):
+        '''Exports a file written over SMB in two chunks as one file, which
+        is only complete once the last chunk has been added to it.'''
+        capture_file = self.filename_from_id('smb.pcap')
+        data = bytes(i * 13 % 251 for i in range(1500))
+        write_tcp_capture(capture_file, 40000, 445, [
+            (True, smb_nt_create(1, b'\\report.txt')),
+            (False, smb_nt_create_response(1, 0x4000, len(data))),
+            (True, smb_write_andx(2, 0x4000, 0, data[:1000])),
+            (True, smb_write_andx(3, 0x4000, 1000, data[1000:])),
+        ])
+        with tempfile.TemporaryDirectory(prefix='wireshark-tests-eo-') as dirname:
+            self.assertRun((cmd_tshark,
+                            '-r', capture_file,
+                            '-Q',
+                            '--export-objects', 'smb,' + dirname,
+                            ))
+            self.assertEqual(read_objects(dirname), {
+                '%5creport.txt': data,
+            })
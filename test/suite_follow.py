@@ -8,10 +8,67 @@
 #
 '''Follow Stream tests'''
 
+import random
+import struct
 import subprocesstest
 import fixtures
 
 
+def write_lossy_tcp_stream(filename, num_segments=4000, segment_len=100,
+                           window=16, lose_every=10):
+    '''Writes a capture of a TCP stream from 10.0.0.1:40000 to
+    10.0.0.2:40001 whose segments are shuffled within windows of the given
+    size. One in lose_every segments is missing from the capture, but acked
+    by the receiver after its window. Returns the stream that Follow TCP
+    should reconstruct.'''
+    client_isn, server_isn = 1000, 5000
+    rng = random.Random(0)
+    packets = []
+
+    def add_packet(from_client, seq, ack, flags, payload=b''):
+        src, dst = b'\x0a\x00\x00\x01', b'\x0a\x00\x00\x02'
+        sport, dport = 40000, 40001
+        if not from_client:
+            src, dst, sport, dport = dst, src, dport, sport
+        tcp = struct.pack('>HHIIBBHHH', sport, dport, seq, ack, 5 << 4, flags,
+                          65535, 0, 0)
+        ip = struct.pack('>BBHHHBBH4s4s', 0x45, 0, 20 + len(tcp) + len(payload),
+                         0, 0, 64, 6, 0, src, dst)
+        packets.append(ip + tcp + payload)
+
+    def is_lost(i):
+        return i % lose_every == 3
+
+    add_packet(True, client_isn, 0, 0x02)
+    add_packet(False, server_isn, client_isn + 1, 0x12)
+    add_packet(True, client_isn + 1, server_isn + 1, 0x10)
+
+    data = bytes(rng.randrange(256) for _ in range(num_segments * segment_len))
+    expected = b''
+    for start in range(0, num_segments, window):
+        end = min(start + window, num_segments)
+        indexes = list(range(start, end))
+        for i in indexes:
+            if is_lost(i):
+                expected += b'[%d bytes missing in capture file]\0' % segment_len
+            else:
+                expected += data[i * segment_len:(i + 1) * segment_len]
+        rng.shuffle(indexes)
+        for i in indexes:
+            if not is_lost(i):
+                add_packet(True, client_isn + 1 + i * segment_len, server_isn + 1,
+                           0x18, data[i * segment_len:(i + 1) * segment_len])
+        add_packet(False, server_isn + 1, client_isn + 1 + end * segment_len, 0x10)
+
+    with open(filename, 'wb') as f:
+        # pcap file header, LINKTYPE_IPV4
+        f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 228))
+        for num, packet in enumerate(packets):
+            f.write(struct.pack('<IIII', num, 0, len(packet), len(packet)))
+            f.write(packet)
+    return expected
+
+
 @fixtures.mark_usefixtures('test_env')
 @fixtures.uses_fixtures
 class case_follow_tcp(subprocesstest.SubprocessTestCase):
@@ -72,3 +129,17 @@ Node 1: 10.0.0.2:80
 ===================================================================
 """.replace("\r\n", "\n"),
             proc.stdout_str.replace("\r\n", "\n"))
+
+    def test_follow_tcp_lossy_stream(self, cmd_tshark):
+        '''Checks Follow TCP on a long stream with many lost and reordered segments.'''
+        capture_file = self.filename_from_id('lossy-stream.pcap')
+        expected = write_lossy_tcp_stream(capture_file)
+        proc = self.assertRun((cmd_tshark,
+                                '-r', capture_file,
+                                '-qz', 'follow,tcp,raw,0',
+                                ))
+        lines = proc.stdout_str.splitlines()
+        # Skip the separator, "Follow:", "Filter:", "Node 0:" and "Node 1:".
+        start = lines.index('Node 1: 10.0.0.2:40001') + 1
+        end = lines.index('=' * 67, start)
+        self.assertEqual(''.join(lines[start:end]), expected.hex())
@@ -11,6 +11,7 @@
 
 import os.path
 import shutil
+import struct
 import subprocesstest
 import fixtures
 
@@ -129,3 +130,243 @@ class case_name_resolution(subprocesstest.SubprocessTestCase):
                 ))
         self.assertTrue(self.grepOutput('fe80::6233:4bff:fe13:c558\tCrunch.local'))
         self.assertFalse(self.grepOutput('174.137.42.65\twww.wireshark.org'))
+
+
+test_mib = '''\
+TEST-MIB DEFINITIONS ::= BEGIN
+
+IMPORTS
+    MODULE-IDENTITY, OBJECT-TYPE, Counter32, Integer32, enterprises
+        FROM SNMPv2-SMI;
+
+testMIB MODULE-IDENTITY
+    LAST-UPDATED "202010180000Z"
+    ORGANIZATION "Wireshark"
+    CONTACT-INFO "wireshark-dev@wireshark.org"
+    DESCRIPTION  "A module for the SMI cache tests."
+    ::= { enterprises 99999 }
+
+testCounter OBJECT-TYPE
+    SYNTAX      Counter32
+    MAX-ACCESS  read-only
+    STATUS      current
+    DESCRIPTION "A counter."
+    ::= { testMIB 1 }
+
+testState OBJECT-TYPE
+    SYNTAX      INTEGER { up(1), STATE(2) }
+    MAX-ACCESS  read-only
+    STATUS      current
+    DESCRIPTION "An enumerated value."
+    ::= { testMIB 2 }
+
+testTable OBJECT-TYPE
+    SYNTAX      SEQUENCE OF TestEntry
+    MAX-ACCESS  not-accessible
+    STATUS      current
+    DESCRIPTION "A table."
+    ::= { testMIB 3 }
+
+testEntry OBJECT-TYPE
+    SYNTAX      TestEntry
+    MAX-ACCESS  not-accessible
+    STATUS      current
+    DESCRIPTION "A row of the table."
+    INDEX       { testIndex }
+    ::= { testTable 1 }
+
+TestEntry ::= SEQUENCE {
+    testIndex   Integer32,
+    testValue   OCTET STRING
+}
+
+testIndex OBJECT-TYPE
+    SYNTAX      Integer32 (1..100)
+    MAX-ACCESS  not-accessible
+    STATUS      current
+    DESCRIPTION "The index of a row."
+    ::= { testEntry 1 }
+
+testValue OBJECT-TYPE
+    SYNTAX      OCTET STRING (SIZE (0..32))
+    MAX-ACCESS  read-only
+    STATUS      current
+    DESCRIPTION "The value in a row."
+    ::= { testEntry 2 }
+
+END
+'''
+
+
+def ber(tag, content):
+    if len(content) < 0x80:
+        return bytes((tag, len(content))) + content
+    return bytes((tag, 0x81, len(content))) + content
+
+
+def ber_oid(oid):
+    subids = [int(subid) for subid in oid.split('.')]
+    content = bytes((subids[0] * 40 + subids[1],))
+    for subid in subids[2:]:
+        encoded = [subid & 0x7f]
+        subid >>= 7
+        while subid:
+            encoded.insert(0, 0x80 | (subid & 0x7f))
+            subid >>= 7
+        content += bytes(encoded)
+    return ber(0x06, content)
+
+
+def write_snmp_capture(filename):
+    '''Writes a capture of an SNMPv2c response with a value of each of the
+    objects in TEST-MIB.'''
+    varbinds = [
+        ('1.3.6.1.4.1.99999.1.0', ber(0x41, b'\x05')),       # Counter32
+        ('1.3.6.1.4.1.99999.2.0', ber(0x02, b'\x02')),       # INTEGER
+        ('1.3.6.1.4.1.99999.3.1.2.7', ber(0x04, b'seven')),  # row 7
+    ]
+    varbind_list = b''.join(ber(0x30, ber_oid(oid) + value)
+                            for oid, value in varbinds)
+    pdu = ber(0xa2, ber(0x02, b'\x01') + ber(0x02, b'\x00') +
+              ber(0x02, b'\x00') + ber(0x30, varbind_list))
+    snmp = ber(0x30, ber(0x02, b'\x01') + ber(0x04, b'public') + pdu)
+    udp = struct.pack('>HHHH', 161, 40000, 8 + len(snmp), 0) + snmp
+    ip = struct.pack('>BBHHHBBH4s4s', 0x45, 0, 20 + len(udp), 0, 0, 64, 17, 0,
+                     b'\x0a\x00\x00\x02', b'\x0a\x00\x00\x01') + udp
+    with open(filename, 'wb') as f:
+        # pcap file header, LINKTYPE_IPV4
+        f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 228))
+        f.write(struct.pack('<IIII', 0, 0, len(ip), len(ip)))
+        f.write(ip)
+
+
+@fixtures.fixture
+def mib_env(test_env, conf_path):
+    '''Loads TEST-MIB from the mibs directory in the configuration
+    directory, and reports what's done with the SMI cache.'''
+    mib_dir = os.path.join(conf_path, 'mibs')
+    os.makedirs(mib_dir)
+    with open(os.path.join(mib_dir, 'TEST-MIB'), 'w') as f:
+        f.write(test_mib.replace('STATE', 'down'))
+    with open(os.path.join(conf_path, 'preferences'), 'w') as f:
+        f.write('nameres.load_smi_modules: TRUE\n')
+    with open(os.path.join(conf_path, 'smi_modules'), 'w') as f:
+        f.write('"TEST-MIB"\n')
+    # uat.c replaces backslashes...
+    with open(os.path.join(conf_path, 'smi_paths'), 'w') as f:
+        f.write('"%s"\n' % mib_dir.replace('\\', '\\x5c'))
+    env = dict(test_env)
+    env['WIRESHARK_DEBUG_MIBS'] = '1'
+    return env
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_mib_cache(subprocesstest.SubprocessTestCase):
+    def decode_snmp(self, cmd_tshark, capture_file, env):
+        '''Decodes the response. Returns the tree, and the debug messages
+        that say what was done with the SMI cache.'''
+        # This only matches if the fields from the module are there.
+        proc = self.assertRun((cmd_tshark,
+                                '-r', capture_file,
+                                '-Y', 'TEST-MIB.testState == 2 && TEST-MIB.testIndex == 7',
+                                '-V',
+                                ), env=env)
+        if 'errors were found while loading the MIBS' in proc.stderr_str:
+            self.skipTest('libsmi could not load TEST-MIB or SNMPv2-SMI.')
+        # The debug messages come before the tree.
+        start = proc.stdout_str.index('Frame 1:')
+        return proc.stdout_str[start:], proc.stdout_str[:start]
+
+    def test_mib_cache(self, cmd_tshark, conf_path, mib_env, features):
+        '''Nodes and fields from the SMI cache are the same as the ones from
+        the module, until the module changes.'''
+        if not features.have_libsmi:
+            self.skipTest('Requires libsmi.')
+        capture_file = self.filename_from_id('snmp.pcap')
+        write_snmp_capture(capture_file)
+        mib_path = os.path.join(conf_path, 'mibs', 'TEST-MIB')
+        cache_path = os.path.join(conf_path, 'smi_cache')
+        mib_mtime = int(os.stat(mib_path).st_mtime)
+
+        # Loaded from the module, which writes the cache.
+        tree, debug = self.decode_snmp(cmd_tshark, capture_file, mib_env)
+        self.assertIn('Wrote ', debug)
+        self.assertNotIn('Loaded the SMI modules from the cache', debug)
+        self.assertTrue(os.path.isfile(cache_path))
+        for name in ('TEST-MIB::testCounter', 'TEST-MIB::testState',
+                     'TEST-MIB::testIndex', 'TEST-MIB::testValue', 'down'):
+            self.assertIn(name, tree)
+
+        # Loaded from the cache, with the same result.
+        cached_tree, debug = self.decode_snmp(cmd_tshark, capture_file, mib_env)
+        self.assertIn('Loaded the SMI modules from the cache', debug)
+        self.assertNotIn('Wrote ', debug)
+        self.assertEqual(cached_tree, tree)
+
+        # A module that's touched but not changed still hits the cache.
+        os.utime(mib_path, (mib_mtime + 100, mib_mtime + 100))
+        cached_tree, debug = self.decode_snmp(cmd_tshark, capture_file, mib_env)
+        self.assertIn('Loaded the SMI modules from the cache', debug)
+        self.assertNotIn('has changed', debug)
+        self.assertEqual(cached_tree, tree)
+
+        # One that's changed misses it, even with the same size.
+        with open(mib_path, 'w') as f:
+            f.write(test_mib.replace('STATE', 'dead'))
+        os.utime(mib_path, (mib_mtime + 200, mib_mtime + 200))
+        changed_tree, debug = self.decode_snmp(cmd_tshark, capture_file, mib_env)
+        self.assertIn('has changed', debug)
+        self.assertIn('Wrote ', debug)
+        self.assertNotIn('Loaded the SMI modules from the cache', debug)
+        self.assertIn('dead', changed_tree)
+        self.assertNotIn('down', changed_tree)
+
+        # The cache was written again for the changed module.
+        cached_tree, debug = self.decode_snmp(cmd_tshark, capture_file, mib_env)
+        self.assertIn('Loaded the SMI modules from the cache', debug)
+        self.assertEqual(cached_tree, changed_tree)
+
+    def test_mib_cache_folders(self, cmd_tshark, conf_path, mib_env, features):
+        '''The SMI paths are still reported when the modules come from the
+        cache.'''
+        if not features.have_libsmi:
+            self.skipTest('Requires libsmi.')
+        capture_file = self.filename_from_id('snmp.pcap')
+        write_snmp_capture(capture_file)
+        mib_dir = os.path.join(conf_path, 'mibs')
+
+        self.decode_snmp(cmd_tshark, capture_file, mib_env)
+        proc = self.assertRun((cmd_tshark, '-G', 'folders'), env=mib_env)
+        self.assertIn('Loaded the SMI modules from the cache', proc.stdout_str)
+        mib_paths = [line.split('\t', 1)[1] for line in proc.stdout_str.splitlines()
+                     if line.startswith('MIB/PIB path:')]
+        self.assertIn(mib_dir, mib_paths)
+
+    def test_mib_cache_shadowed(self, cmd_tshark, conf_path, mib_env, features):
+        '''A module added to a directory that comes earlier in the SMI path
+        than the one the cached module was loaded from misses the cache.'''
+        if not features.have_libsmi:
+            self.skipTest('Requires libsmi.')
+        capture_file = self.filename_from_id('snmp.pcap')
+        write_snmp_capture(capture_file)
+        first_dir = os.path.join(conf_path, 'mibs-first')
+        os.makedirs(first_dir)
+        with open(os.path.join(conf_path, 'smi_paths'), 'w') as f:
+            for mib_dir in (first_dir, os.path.join(conf_path, 'mibs')):
+                f.write('"%s"\n' % mib_dir.replace('\\', '\\x5c'))
+
+        tree, debug = self.decode_snmp(cmd_tshark, capture_file, mib_env)
+        self.assertIn('Wrote ', debug)
+        self.assertIn('down', tree)
+
+        with open(os.path.join(first_dir, 'TEST-MIB'), 'w') as f:
+            f.write(test_mib.replace('STATE', 'shadow'))
+        # The directory might have been written to in the same second.
+        dir_mtime = int(os.stat(first_dir).st_mtime)
+        os.utime(first_dir, (dir_mtime + 100, dir_mtime + 100))
+        shadowed_tree, debug = self.decode_snmp(cmd_tshark, capture_file, mib_env)
+        self.assertIn('has changed', debug)
+        self.assertNotIn('Loaded the SMI modules from the cache', debug)
+        self.assertIn('shadow', shadowed_tree)
+        self.assertNotIn('down', shadowed_tree)
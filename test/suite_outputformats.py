@@ -93,3 +93,17 @@ class case_outputformats(subprocesstest.SubprocessTestCase):
         ''' Check that the option -j works with -Tek.'''
         check_outputformat("ek", extra_args=['-j', 'dhcp'], expected="dhcp-filter.ek",
             multiline=True)
+
+    def test_outputformat_fields_selective(self, cmd_tshark, capture_file):
+        '''--selective-dissection gives the same fields as a full dissection.'''
+        for fields in (['-e', 'ip.src', '-e', 'udp.srcport'],
+                       ['-e', 'frame.number', '-e', 'dhcp.option.dhcp']):
+            args = ['-r', capture_file('dhcp.pcap'), '-T', 'fields'] + fields
+            full_proc = self.assertRun([cmd_tshark] + args)
+            selective_proc = self.assertRun([cmd_tshark, '--selective-dissection'] + args)
+            self.assertEqual(full_proc.stdout_str, selective_proc.stdout_str)
+
+    def test_outputformat_selective_needs_fields(self, cmd_tshark, capture_file):
+        '''--selective-dissection refuses to print the packet summary.'''
+        self.assertRun([cmd_tshark, '-r', capture_file('dhcp.pcap'),
+                        '--selective-dissection'], expected_return=1)
@@ -20,10 +20,52 @@ import fixtures
 
 @fixtures.uses_fixtures
 class case_unittests(subprocesstest.SubprocessTestCase):
+    def test_unit_capture_queue_test(self, program, base_env):
+        '''capture_queue_test'''
+        self.assertRun(program('capture_queue_test'), env=base_env)
+
+    def test_unit_capture_tpacket_test(self, program, base_env):
+        '''capture_tpacket_test'''
+        self.assertRun(program('capture_tpacket_test'), env=base_env)
+
+    def test_unit_charsets_test(self, program, base_env):
+        '''charsets_test'''
+        self.assertRun(program('charsets_test'), env=base_env)
+
+    def test_unit_decode_cache_test(self, program, base_env):
+        '''decode_cache_test'''
+        self.assertRun(program('decode_cache_test'), env=base_env)
+
+    def test_unit_dissector_table_test(self, program, base_env):
+        '''dissector_table_test'''
+        self.assertRun(program('dissector_table_test'), env=base_env)
+
     def test_unit_exntest(self, program, base_env):
         '''exntest'''
         self.assertRun(program('exntest'), env=base_env)
 
+    def test_unit_export_object_test(self, program, base_env):
+        '''export_object_test'''
+        self.assertRun(program('export_object_test'), env=base_env)
+
+    def test_unit_file_wrappers_test(self, program, base_env):
+        '''file_wrappers_test'''
+        self.assertRun(program('file_wrappers_test'), env=base_env)
+
+    def test_unit_heur_dissector_test(self, program, base_env):
+        '''heur_dissector_test'''
+        self.assertRun(program('heur_dissector_test'), env=base_env)
+
+    def test_unit_label_fmt_test(self, program, base_env):
+        '''label_fmt_test'''
+        self.assertRun(program('label_fmt_test'), env=base_env)
+
+    def test_unit_maxmind_db_reader_test(self, program, base_env, dirs):
+        '''maxmind_db_reader_test'''
+        self.assertRun((program('maxmind_db_reader_test'),
+            os.path.join(dirs.maxmind_dir, 'wireshark-test.mmdb')
+        ), env=base_env)
+
     def test_unit_oids_test(self, program, base_env):
         '''oids_test'''
         self.assertRun(program('oids_test'), env=base_env)
@@ -32,6 +74,18 @@ class case_unittests(subprocesstest.SubprocessTestCase):
         '''reassemble_test'''
         self.assertRun(program('reassemble_test'), env=base_env)
 
+    def test_unit_sequence_analysis_test(self, program, base_env):
+        '''sequence_analysis_test'''
+        self.assertRun(program('sequence_analysis_test'), env=base_env)
+
+    def test_unit_shm_ring_test(self, program, base_env):
+        '''shm_ring_test'''
+        self.assertRun(program('shm_ring_test'), env=base_env)
+
+    def test_unit_tap_test(self, program, base_env):
+        '''tap_test'''
+        self.assertRun(program('tap_test'), env=base_env)
+
     def test_unit_tvbtest(self, program, base_env):
         '''tvbtest'''
         self.assertRun(program('tvbtest'), env=base_env)
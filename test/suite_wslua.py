@@ -130,6 +130,10 @@ class case_wslua(subprocesstest.SubprocessTestCase):
         '''wslua fields'''
         check_lua_script(self, 'field.lua', dhcp_pcap, True)
 
+    def test_wslua_fieldlist(self, check_lua_script):
+        '''wslua field lists'''
+        check_lua_script(self, 'fieldlist.lua', dhcp_pcap, True)
+
     # reader, writer, and acme_reader were all under wslua_step_file_test
     # in the Bash version.
     def test_wslua_file_reader(self, check_lua_script, cmd_tshark, capture_file):
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+# Replay a pcap file into dumpcap through a pipe, writing to a ring buffer,
+# and report how fast dumpcap got the packets onto the disk.
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+'''Benchmark dumpcap's output path.
+
+The packets of a pcap file are fed to "dumpcap -i -" as fast as dumpcap
+reads them, or at a given line rate, as many times as asked, and written to
+a ring buffer in a scratch directory. Run it once with and once without
+--async-write (or use --compare) to see what the writer thread buys.
+
+Example:
+    tools/dumpcap-write-bench.py --dumpcap build/run/dumpcap \\
+        --repeat 200 --filesize 100000 --files 5 --compare capture.pcap
+'''
+
+import argparse
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+PCAP_MAGICS = {
+    b'\xd4\xc3\xb2\xa1': '<',
+    b'\xa1\xb2\xc3\xd4': '>',
+    b'\x4d\x3c\xb2\xa1': '<',
+    b'\xa1\xb2\x3c\x4d': '>',
+}
+
+
+def read_pcap(path):
+    '''Return the file header and a list of (header, data) records.'''
+    with open(path, 'rb') as f:
+        shb = f.read(24)
+        if len(shb) != 24 or shb[:4] not in PCAP_MAGICS:
+            sys.exit('{}: not a pcap file (pcapng is not supported)'.format(path))
+        endian = PCAP_MAGICS[shb[:4]]
+        records = []
+        while True:
+            hdr = f.read(16)
+            if len(hdr) < 16:
+                break
+            incl_len = struct.unpack(endian + 'IIII', hdr)[2]
+            data = f.read(incl_len)
+            if len(data) < incl_len:
+                break
+            records.append((hdr, data))
+    return shb, records
+
+
+def feed(pipe, shb, records, repeat, rate_bps):
+    '''Write the records to pipe, pacing them if rate_bps is set.'''
+    pipe.write(shb)
+    sent_bits = 0
+    start = time.perf_counter()
+    for _ in range(repeat):
+        for hdr, data in records:
+            pipe.write(hdr)
+            pipe.write(data)
+            if rate_bps:
+                # Ethernet preamble and inter-frame gap included.
+                sent_bits += (len(data) + 20) * 8
+                ahead = sent_bits / rate_bps - (time.perf_counter() - start)
+                if ahead > 0.001:
+                    time.sleep(ahead)
+    pipe.close()
+
+
+def run(args, shb, records, async_write):
+    outdir = tempfile.mkdtemp(prefix='dumpcap-bench-', dir=args.dir)
+    try:
+        cmd = [args.dumpcap, '-q', '-i', '-',
+               '-w', os.path.join(outdir, 'bench.pcapng'),
+               '-b', 'filesize:{}'.format(args.filesize),
+               '-b', 'files:{}'.format(args.files)]
+        if async_write:
+            cmd.append('--async-write')
+        start = time.perf_counter()
+        proc = subprocess.Popen(cmd, stdin=subprocess.PIPE, stderr=subprocess.PIPE)
+        feed(proc.stdin, shb, records, args.repeat, args.rate * 1e6 if args.rate else 0)
+        _, stderr = proc.communicate()
+        elapsed = time.perf_counter() - start
+        if proc.returncode != 0:
+            sys.stderr.write(stderr.decode('utf-8', 'replace'))
+            sys.exit('dumpcap failed with exit status {}'.format(proc.returncode))
+        files = os.listdir(outdir)
+    finally:
+        shutil.rmtree(outdir)
+
+    packets = len(records) * args.repeat
+    nbytes = sum(len(data) for _, data in records) * args.repeat
+    print('{:<16} {:8.3f} s {:10.0f} packets/s {:9.1f} MB/s  {} files left'.format(
+        'async write:' if async_write else 'stdio write:',
+        elapsed, packets / elapsed, nbytes / elapsed / 1e6, len(files)))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--dumpcap', default='dumpcap', help='dumpcap to run')
+    parser.add_argument('--dir', help='directory to write the ring buffer in')
+    parser.add_argument('--repeat', type=int, default=100,
+                        help='number of times to replay the file')
+    parser.add_argument('--rate', type=float,
+                        help='line rate to replay at, in Mbit/s (default: as fast as possible)')
+    parser.add_argument('--filesize', type=int, default=100000,
+                        help='ring buffer file size, in kB')
+    parser.add_argument('--files', type=int, default=5,
+                        help='number of ring buffer files')
+    parser.add_argument('--async-write', action='store_true',
+                        help='run dumpcap with --async-write')
+    parser.add_argument('--compare', action='store_true',
+                        help='run dumpcap with and without --async-write')
+    parser.add_argument('pcap', help='pcap file to replay')
+    args = parser.parse_args()
+
+    shb, records = read_pcap(args.pcap)
+    if not records:
+        sys.exit('{}: no packets'.format(args.pcap))
+
+    if args.compare:
+        run(args, shb, records, False)
+        run(args, shb, records, True)
+    else:
+        run(args, shb, records, args.async_write)
+
+
+if __name__ == '__main__':
+    main()
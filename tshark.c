@@ -106,6 +106,8 @@
 #include <capchild/capture_session.h>
 #include <capchild/capture_sync.h>
 #include <ui/capture_info.h>
+#include <wsutil/shm_ring.h>
+#include <wsutil/tempfile.h>
 #endif /* HAVE_LIBPCAP */
 #include "log.h"
 #include <epan/funnel.h>
@@ -137,6 +139,10 @@
 #define LONGOPT_COLOR                   LONGOPT_BASE_APPLICATION+2
 #define LONGOPT_NO_DUPLICATE_KEYS       LONGOPT_BASE_APPLICATION+3
 #define LONGOPT_ELASTIC_MAPPING_FILTER  LONGOPT_BASE_APPLICATION+4
+#define LONGOPT_STARTUP_PROFILE         LONGOPT_BASE_APPLICATION+5
+#define LONGOPT_ONLY_PROTOCOLS          LONGOPT_BASE_APPLICATION+6
+#define LONGOPT_SHM_BUFFER              LONGOPT_BASE_APPLICATION+7
+#define LONGOPT_SELECTIVE_DISSECTION    LONGOPT_BASE_APPLICATION+8
 
 #if 0
 #define tshark_debug(...) g_warning(__VA_ARGS__)
@@ -191,6 +197,14 @@ static pf_flags protocolfilter_flags = PF_NONE;
 static gboolean no_duplicate_keys = FALSE;
 static proto_node_children_grouper_func node_children_grouper = proto_node_group_children_by_unique;
 
+/*
+ * --selective-dissection: only dissect packets up to the protocols that the
+ * filter and the -e fields need, apart from the protocols listed to keep.
+ */
+static gboolean selective_dissection = FALSE;
+static GArray *selective_keep_protos = NULL;
+static GArray *selective_hfids = NULL;
+
 static json_dumper jdumper;
 
 /* The line separator used between packets, changeable via the -S option */
@@ -208,12 +222,20 @@ static capture_options global_capture_opts;
 static capture_session global_capture_session;
 static info_data_t global_info_data;
 
+/*
+ * Size, in MiB, of the shared memory buffer through which dumpcap passes
+ * us what it writes to the capture file, or 0 if we just read the file.
+ */
+static int shm_buffer_size;
+static shm_ring_t *shm_ring;
+
 #ifdef SIGINFO
 static gboolean infodelay;      /* if TRUE, don't print capture info in SIGINFO handler */
 static gboolean infoprint;      /* if TRUE, print capture info after clearing infodelay */
 #endif /* SIGINFO */
 
 static gboolean capture(void);
+static void shm_buffer_close(void);
 static gboolean capture_input_new_file(capture_session *cap_session,
                                        gchar *new_file);
 static void capture_input_new_packets(capture_session *cap_session,
@@ -238,6 +260,7 @@ static void report_counts_siginfo(int);
 #endif /* HAVE_LIBPCAP */
 
 static void reset_epan_mem(capture_file *cf, epan_dissect_t *edt, gboolean tree, gboolean visual);
+static void setup_selective_dissection(epan_dissect_t *edt);
 
 typedef enum {
   PROCESS_FILE_SUCCEEDED,
@@ -469,6 +492,18 @@ print_usage(FILE *output)
   fprintf(output, "                           values\n");
   fprintf(output, "  --elastic-mapping-filter <protocols> If -G elastic-mapping is specified, put only the\n");
   fprintf(output, "                           specified protocols within the mapping file\n");
+  fprintf(output, "  --only-protocols <protocols> only register the specified dissectors, for faster\n");
+  fprintf(output, "                           startup when only a few protocols are needed\n");
+  fprintf(output, "  --selective-dissection[=<protocols>]\n");
+  fprintf(output, "                           stop dissecting packets above the protocols the display\n");
+  fprintf(output, "                           filter and -e fields need, but always dissect the\n");
+  fprintf(output, "                           specified protocols\n");
+  fprintf(output, "  --startup-profile        print how long each part of startup took to the\n");
+  fprintf(output, "                           standard error\n");
+#ifdef HAVE_LIBPCAP
+  fprintf(output, "  --shm-buffer <MiB>       when capturing, have dumpcap pass the packets to us\n");
+  fprintf(output, "                           through a shared memory buffer of this size\n");
+#endif
 
   fprintf(output, "\n");
   fprintf(output, "Miscellaneous:\n");
@@ -706,6 +741,12 @@ main(int argc, char *argv[])
     {"color", no_argument, NULL, LONGOPT_COLOR},
     {"no-duplicate-keys", no_argument, NULL, LONGOPT_NO_DUPLICATE_KEYS},
     {"elastic-mapping-filter", required_argument, NULL, LONGOPT_ELASTIC_MAPPING_FILTER},
+    {"startup-profile", no_argument, NULL, LONGOPT_STARTUP_PROFILE},
+    {"only-protocols", required_argument, NULL, LONGOPT_ONLY_PROTOCOLS},
+    {"selective-dissection", optional_argument, NULL, LONGOPT_SELECTIVE_DISSECTION},
+#ifdef HAVE_LIBPCAP
+    {"shm-buffer", required_argument, NULL, LONGOPT_SHM_BUFFER},
+#endif
     {0, 0, 0, 0 }
   };
   gboolean             arg_error = FALSE;
@@ -740,6 +781,9 @@ main(int argc, char *argv[])
   char                *volatile exp_pdu_filename = NULL;
   exp_pdu_t            exp_pdu_tap_data;
   const gchar*         elastic_mapping_filter = NULL;
+  gboolean             startup_profile = FALSE;
+  gint64               startup_start = 0;
+  gboolean             stats_requested = FALSE;
 
 /*
  * The leading + ensures that getopt_long() does not permute the argv[]
@@ -865,6 +909,15 @@ main(int argc, char *argv[])
     case LONGOPT_ELASTIC_MAPPING_FILTER:
       elastic_mapping_filter = optarg;
       break;
+    case LONGOPT_STARTUP_PROFILE:
+      /* Must be enabled before epan_init() */
+      startup_profile = TRUE;
+      epan_enable_startup_profile();
+      break;
+    case LONGOPT_ONLY_PROTOCOLS:
+      /* Must be set before epan_init() */
+      epan_set_only_protocols(optarg);
+      break;
     default:
       break;
     }
@@ -913,6 +966,7 @@ main(int argc, char *argv[])
   timestamp_set_precision(TS_PREC_AUTO);
   timestamp_set_seconds_type(TS_SECONDS_DEFAULT);
 
+  startup_start = g_get_monotonic_time();
   wtap_init(TRUE);
 
   /* Register all dissectors; we must do this before checking for the
@@ -1427,6 +1481,7 @@ main(int argc, char *argv[])
         exit_status = INVALID_OPTION;
         goto clean_exit;
       }
+      stats_requested = TRUE;
       break;
     case 'd':        /* Decode as rule */
     case 'K':        /* Kerberos keytab file */
@@ -1462,6 +1517,39 @@ main(int argc, char *argv[])
       no_duplicate_keys = TRUE;
       node_children_grouper = proto_node_group_children_by_json_key;
       break;
+    case LONGOPT_STARTUP_PROFILE:
+    case LONGOPT_ONLY_PROTOCOLS:
+      /* Already processed in the first pass */
+      break;
+    case LONGOPT_SELECTIVE_DISSECTION:
+      selective_dissection = TRUE;
+      if (optarg != NULL) {
+        gchar **names = g_strsplit(optarg, ",", -1);
+        int proto_id;
+        guint i;
+
+        if (selective_keep_protos == NULL)
+          selective_keep_protos = g_array_new(FALSE, FALSE, sizeof(int));
+        for (i = 0; names[i] != NULL; i++) {
+          if (names[i][0] == '\0')
+            continue;
+          proto_id = proto_get_id_by_filter_name(names[i]);
+          if (proto_id == -1) {
+            cmdarg_err("\"%s\" isn't a valid protocol for --selective-dissection", names[i]);
+            g_strfreev(names);
+            exit_status = INVALID_OPTION;
+            goto clean_exit;
+          }
+          g_array_append_val(selective_keep_protos, proto_id);
+        }
+        g_strfreev(names);
+      }
+      break;
+#ifdef HAVE_LIBPCAP
+    case LONGOPT_SHM_BUFFER:
+      shm_buffer_size = get_positive_int(optarg, "shared memory buffer size");
+      break;
+#endif
     default:
     case '?':        /* Bad flag - print usage message */
       switch(optopt) {
@@ -1810,6 +1898,12 @@ main(int argc, char *argv[])
      line that their preferences have changed. */
   prefs_apply_all();
 
+  if (startup_profile) {
+    epan_write_startup_profile(stderr);
+    fprintf(stderr, "Startup total (libwiretap, libwireshark, taps and preferences): %.3f ms\n",
+            (g_get_monotonic_time() - startup_start) / 1000.0);
+  }
+
   /* We can also enable specified taps for export object */
   start_exportobjects();
 
@@ -1830,6 +1924,27 @@ main(int argc, char *argv[])
       goto clean_exit;
     }
   }
+
+  if (selective_dissection) {
+    /* Whatever we print or hand to a tap has to come from the needed
+       protocols alone. */
+    if (print_packet_info && (output_action != WRITE_FIELDS || print_hex)) {
+      cmdarg_err("--selective-dissection can only be used with \"-T fields\", or when not printing packets");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+    if (output_fields_has_cols(output_fields) || dissect_color) {
+      cmdarg_err("--selective-dissection can't be used with column fields or --color");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+    if (stats_requested || pdu_export_arg || tap_listeners_require_dissection()) {
+      cmdarg_err("--selective-dissection can't be used with -z, -U or --export-objects");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+    selective_hfids = output_fields_hfids(output_fields);
+  }
 #ifdef HAVE_LIBPCAP
   /* We currently don't support taps, or printing dissected packets,
      if we're writing to a pipe. */
@@ -2232,6 +2347,7 @@ main(int argc, char *argv[])
      */
     capture();
     exit_status = global_capture_session.fork_child_status;
+    shm_buffer_close();
 
     if (print_packet_info) {
       if (!write_finale()) {
@@ -2283,6 +2399,10 @@ clean_exit:
   wtap_cleanup();
   free_progdirs();
   dfilter_free(dfcode);
+  if (selective_keep_protos)
+    g_array_free(selective_keep_protos, TRUE);
+  if (selective_hfids)
+    g_array_free(selective_hfids, TRUE);
   return exit_status;
 }
 
@@ -2428,6 +2548,71 @@ tshark_epan_new(capture_file *cf)
 }
 
 #ifdef HAVE_LIBPCAP
+/*
+ * Create the shared memory buffer, if we were asked for one, and have
+ * dumpcap fill it.  It covers a single capture file, and is only worth
+ * having if we read that file as it's written.
+ */
+static void
+shm_buffer_open(void)
+{
+  gchar  *path = NULL;
+  GError *gerr = NULL;
+  int     fd, err;
+
+  if (shm_buffer_size == 0 || global_capture_opts.multi_files_on ||
+      !do_dissection)
+    return;
+
+  fd = create_tempfile(&path, "wireshark_shm", NULL, &gerr);
+  if (fd == -1) {
+    cmdarg_err("Can't create the shared memory buffer: %s", gerr->message);
+    g_error_free(gerr);
+    return;
+  }
+  ws_close(fd);
+
+  shm_ring = shm_ring_create(path, (size_t)shm_buffer_size * 1024 * 1024, &err);
+  if (shm_ring == NULL) {
+    cmdarg_err("Can't create the shared memory buffer: %s", g_strerror(err));
+    ws_unlink(path);
+    g_free(path);
+    return;
+  }
+  g_free(global_capture_opts.shm_buffer_path);
+  global_capture_opts.shm_buffer_path = path;
+}
+
+static void
+shm_buffer_close(void)
+{
+  shm_ring_stats_t stats;
+
+  if (shm_ring == NULL)
+    return;
+
+  /*
+   * Let the user know if the buffer was too small to keep up, or
+   * dumpcap didn't use it.
+   */
+  shm_ring_get_stats(shm_ring, &stats);
+  if (!really_quiet && (stats.overrun != 0 || stats.file_read != 0)) {
+    fprintf(stderr,
+            "Shared memory buffer: %" G_GINT64_MODIFIER "u bytes read from it, "
+            "%" G_GINT64_MODIFIER "u from the file, "
+            "%" G_GINT64_MODIFIER "u overwritten before they were read\n",
+            stats.ring_read, stats.file_read, stats.overrun);
+  }
+
+  if (cfile.provider.wth != NULL)
+    wtap_set_shm_ring(cfile.provider.wth, NULL);
+  shm_ring_close(shm_ring);
+  shm_ring = NULL;
+  ws_unlink(global_capture_opts.shm_buffer_path);
+  g_free(global_capture_opts.shm_buffer_path);
+  global_capture_opts.shm_buffer_path = NULL;
+}
+
 static gboolean
 capture(void)
 {
@@ -2497,6 +2682,8 @@ capture(void)
   fflush(stderr);
   g_string_free(str, TRUE);
 
+  shm_buffer_open();
+
   ret = sync_pipe_start(&global_capture_opts, &global_capture_session, &global_info_data, NULL);
 
   if (!ret)
@@ -2661,6 +2848,8 @@ capture_input_new_file(capture_session *cap_session, gchar *new_file)
     /* Attempt to open the capture file and set up to read from it. */
     switch(cf_open(cap_session->cf, capture_opts->save_file, WTAP_TYPE_AUTO, is_tempfile, &err)) {
     case CF_OK:
+      if (shm_ring != NULL)
+        wtap_set_shm_ring(cf->provider.wth, shm_ring);
       break;
     case CF_ERROR:
       /* Don't unlink (delete) the save file - leave it around,
@@ -2740,6 +2929,7 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
        ("print_packet_info" is true) and we're in verbose mode
        ("packet_details" is true). */
     edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+    setup_selective_dissection(edt);
 
     wtap_rec_init(&rec);
     ws_buffer_init(&buf, 1514);
@@ -3161,6 +3351,10 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
     if (cf->dfcode)
       epan_dissect_prime_with_dfilter(edt, cf->dfcode);
 
+    /* With --selective-dissection, say which protocols -e needs. */
+    if (selective_hfids)
+      epan_dissect_prime_with_hfid_array(edt, selective_hfids);
+
     col_custom_prime_edt(edt, &cf->cinfo);
 
     /* We only need the columns if either
@@ -3274,6 +3468,7 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
        ("print_packet_info" is true) and we're in verbose mode
        ("packet_details" is true). */
     edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+    setup_selective_dissection(edt);
   }
 
   /*
@@ -3381,6 +3576,7 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
        ("print_packet_info" is true) and we're in verbose mode
        ("packet_details" is true). */
     edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+    setup_selective_dissection(edt);
   }
 
   /*
@@ -3720,6 +3916,10 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
        with the hfids postdissectors want on the first pass. */
     prime_epan_dissect_with_postdissector_wanted_hfids(edt);
 
+    /* With --selective-dissection, say which protocols -e needs. */
+    if (selective_hfids)
+      epan_dissect_prime_with_hfid_array(edt, selective_hfids);
+
     col_custom_prime_edt(edt, &cf->cinfo);
 
     /* We only need the columns if either
@@ -4399,6 +4599,23 @@ write_failure_message(const char *filename, int err)
              filename, g_strerror(err));
 }
 
+/*
+ * Set up an epan_dissect_t for --selective-dissection; the fields it needs
+ * are primed for each packet.
+ */
+static void
+setup_selective_dissection(epan_dissect_t *edt)
+{
+  guint i;
+
+  if (!selective_dissection)
+    return;
+
+  epan_dissect_set_selective(edt, TRUE);
+  for (i = 0; selective_keep_protos != NULL && i < selective_keep_protos->len; i++)
+    epan_dissect_keep_protocol(edt, g_array_index(selective_keep_protos, int, i));
+}
+
 static void reset_epan_mem(capture_file *cf,epan_dissect_t *edt, gboolean tree, gboolean visual)
 {
   if (!epan_auto_reset || (cf->count < epan_auto_reset_count))
@@ -4411,6 +4628,7 @@ static void reset_epan_mem(capture_file *cf,epan_dissect_t *edt, gboolean tree,
 
   cf->epan = tshark_epan_new(cf);
   epan_dissect_init(edt, cf->epan, tree, visual);
+  setup_selective_dissection(edt);
   cf->count = 0;
 }
 
@@ -27,8 +27,11 @@
 #include "tap-exportobject.h"
 
 typedef struct _export_object_list_gui_t {
-    GSList *entries;
+    GSList *entries;            /* entries still growing, saved when drawn */
     register_eo_t* eo;
+    const gchar *save_in_path;
+    gboolean dir_checked;
+    gboolean dir_ok;
 } export_object_list_gui_t;
 
 static GHashTable* eo_opts = NULL;
@@ -82,12 +85,72 @@ gboolean eo_tap_opt_add(const char *option_string)
     return FALSE;
 }
 
+static gboolean
+eo_check_dir(export_object_list_gui_t *object_list)
+{
+    if (object_list->dir_checked)
+        return object_list->dir_ok;
+
+    object_list->dir_checked = TRUE;
+    if (!g_file_test(object_list->save_in_path, G_FILE_TEST_IS_DIR)) {
+        /* If the destination directory (or its parents) do not exist, create them. */
+        if (g_mkdir_with_parents(object_list->save_in_path, 0755) == -1) {
+            fprintf(stderr, "Failed to create export objects output directory \"%s\": %s\n",
+                    object_list->save_in_path, g_strerror(errno));
+            return FALSE;
+        }
+    }
+    object_list->dir_ok = TRUE;
+    return TRUE;
+}
+
+static void
+eo_write_entry(export_object_list_gui_t *object_list, export_object_entry_t *entry)
+{
+    GString *safe_filename = NULL;
+    gchar *save_as_fullpath = NULL;
+    guint count = 0;
+
+    if (!eo_check_dir(object_list))
+        return;
+
+    do {
+        g_free(save_as_fullpath);
+        if (entry->filename) {
+            safe_filename = eo_massage_str(entry->filename,
+                EXPORT_OBJECT_MAXFILELEN, count);
+        } else {
+            char generic_name[EXPORT_OBJECT_MAXFILELEN+1];
+            const char *ext;
+            ext = eo_ct2ext(entry->content_type);
+            g_snprintf(generic_name, sizeof(generic_name),
+                "object%u%s%s", entry->pkt_num, ext ? "." : "", ext ? ext : "");
+            safe_filename = eo_massage_str(generic_name,
+                EXPORT_OBJECT_MAXFILELEN, count);
+        }
+        save_as_fullpath = g_build_filename(object_list->save_in_path, safe_filename->str, NULL);
+        g_string_free(safe_filename, TRUE);
+    } while (g_file_test(save_as_fullpath, G_FILE_TEST_EXISTS) && ++count < prefs.gui_max_export_objects);
+    eo_save_entry(save_as_fullpath, entry);
+    g_free(save_as_fullpath);
+}
+
+/*
+ * Objects are written out as soon as they're complete, so that only
+ * one is in memory at a time; ones that are still growing are kept
+ * until the end.
+ */
 static void
 object_list_add_entry(void *gui_data, export_object_entry_t *entry)
 {
     export_object_list_gui_t *object_list = (export_object_list_gui_t*)gui_data;
 
-    object_list->entries = g_slist_append(object_list->entries, entry);
+    if (entry->payload_growing) {
+        object_list->entries = g_slist_append(object_list->entries, entry);
+    } else {
+        eo_write_entry(object_list, entry);
+        eo_free_entry(entry);
+    }
 }
 
 static export_object_entry_t*
@@ -97,57 +160,21 @@ object_list_get_entry(void *gui_data, int row) {
     return (export_object_entry_t *)g_slist_nth_data(object_list->entries, row);
 }
 
-/* This is just for writing Exported Objects to a file */
+/* This is just for writing the Exported Objects that were still growing to a file */
 static void
 eo_draw(void *tapdata)
 {
     export_object_list_t *tap_object = (export_object_list_t *)tapdata;
     export_object_list_gui_t *object_list = (export_object_list_gui_t*)tap_object->gui_data;
-    GSList *slist = object_list->entries;
-    export_object_entry_t *entry;
-    gchar* save_in_path = (gchar*)g_hash_table_lookup(eo_opts, proto_get_protocol_filter_name(get_eo_proto_id(object_list->eo)));
-    GString *safe_filename = NULL;
-    gchar *save_as_fullpath = NULL;
-    guint count = 0;
-
-    if (!g_file_test(save_in_path, G_FILE_TEST_IS_DIR)) {
-        /* If the destination directory (or its parents) do not exist, create them. */
-        if (g_mkdir_with_parents(save_in_path, 0755) == -1) {
-            fprintf(stderr, "Failed to create export objects output directory \"%s\": %s\n",
-                    save_in_path, g_strerror(errno));
-            return;
-        }
-    }
+    GSList *slist;
 
-    while (slist) {
-        entry = (export_object_entry_t *)slist->data;
-        do {
-            g_free(save_as_fullpath);
-            if (entry->filename) {
-                safe_filename = eo_massage_str(entry->filename,
-                    EXPORT_OBJECT_MAXFILELEN, count);
-            } else {
-                char generic_name[EXPORT_OBJECT_MAXFILELEN+1];
-                const char *ext;
-                ext = eo_ct2ext(entry->content_type);
-                g_snprintf(generic_name, sizeof(generic_name),
-                    "object%u%s%s", entry->pkt_num, ext ? "." : "", ext ? ext : "");
-                safe_filename = eo_massage_str(generic_name,
-                    EXPORT_OBJECT_MAXFILELEN, count);
-            }
-            save_as_fullpath = g_build_filename(save_in_path, safe_filename->str, NULL);
-            g_string_free(safe_filename, TRUE);
-        } while (g_file_test(save_as_fullpath, G_FILE_TEST_EXISTS) && ++count < prefs.gui_max_export_objects);
-        count = 0;
-        eo_save_entry(save_as_fullpath, entry);
-        g_free(save_as_fullpath);
-        save_as_fullpath = NULL;
-        slist = slist->next;
+    for (slist = object_list->entries; slist; slist = slist->next) {
+        eo_write_entry(object_list, (export_object_entry_t *)slist->data);
     }
 }
 
 static void
-exportobject_handler(gpointer key, gpointer value _U_, gpointer user_data _U_)
+exportobject_handler(gpointer key, gpointer value, gpointer user_data _U_)
 {
     GString *error_msg;
     export_object_list_t *tap_data;
@@ -169,6 +196,7 @@ exportobject_handler(gpointer key, gpointer value _U_, gpointer user_data _U_)
     tap_data->gui_data = (void*)object_list;
 
     object_list->eo = eo;
+    object_list->save_in_path = (const gchar*)value;
 
     /* Data will be gathered via a tap callback */
     error_msg = register_tap_listener(get_eo_tap_listener_name(eo), tap_data, NULL, 0,
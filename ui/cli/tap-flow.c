@@ -78,7 +78,7 @@ flow_arg_mode(const char **opt_argp, seq_analysis_info_t *flow_info)
 static void
 flow_init(const char *opt_argp, void *userdata)
 {
-    seq_analysis_info_t *flow_info = g_new0(seq_analysis_info_t, 1);
+    seq_analysis_info_t *flow_info = sequence_analysis_info_new();
     GString  *errp;
     register_analysis_t* analysis = (register_analysis_t*)userdata;
     const char *filter=NULL;
@@ -91,8 +91,6 @@ flow_init(const char *opt_argp, void *userdata)
         filter = opt_argp + 1;
     }
 
-    sequence_analysis_list_free(flow_info);
-
     errp = register_tap_listener(sequence_analysis_get_tap_listener_name(analysis), flow_info, filter, sequence_analysis_get_tap_flags(analysis),
                                 NULL, sequence_analysis_get_packet_func(analysis), flow_draw, NULL);
 
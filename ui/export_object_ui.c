@@ -31,10 +31,13 @@ void
 eo_save_entry(const gchar *save_as_filename, export_object_entry_t *entry)
 {
     int to_fd;
+    gint64 offset;
     gint64 bytes_left;
     int bytes_to_write;
     ssize_t bytes_written;
-    guint8 *ptr;
+    const guint8 *ptr;
+    guint8 *buf = NULL;
+    gssize bytes_read;
     int err;
 
     to_fd = ws_open(save_as_filename, O_WRONLY | O_CREAT | O_EXCL |
@@ -56,27 +59,50 @@ eo_save_entry(const gchar *save_as_filename, export_object_entry_t *entry)
      * In either case, there's no guarantee that a gint64 such as
      * payload_len can be passed to ws_write(), so we write in
      * chunks of, at most 2^31 bytes.
+     *
+     * A payload that's been moved to disk is copied a megabyte at a time.
      */
-    ptr = entry->payload_data;
-    bytes_left = entry->payload_len;
-    while (bytes_left != 0) {
-        if (bytes_left > 0x40000000)
-            bytes_to_write = 0x40000000;
-        else
-            bytes_to_write = (int)bytes_left;
-        bytes_written = ws_write(to_fd, ptr, bytes_to_write);
-        if (bytes_written <= 0) {
-            if (bytes_written < 0)
-                err = errno;
+    if (entry->payload_data == NULL && entry->payload_len != 0)
+        buf = (guint8 *)g_malloc(1024 * 1024);
+    offset = 0;
+    while (offset < entry->payload_len) {
+        if (buf) {
+            bytes_read = eo_entry_read(entry, offset, buf, 1024 * 1024);
+            if (bytes_read <= 0) {
+                report_failure("Couldn't read the object in packet %u from the temporary file: %s",
+                               entry->pkt_num, bytes_read < 0 ? g_strerror(errno) : "it's too short");
+                g_free(buf);
+                ws_close(to_fd);
+                return;
+            }
+            ptr = buf;
+            bytes_left = bytes_read;
+        } else {
+            ptr = entry->payload_data + offset;
+            bytes_left = entry->payload_len - offset;
+        }
+        offset += bytes_left;
+        while (bytes_left != 0) {
+            if (bytes_left > 0x40000000)
+                bytes_to_write = 0x40000000;
             else
-                err = WTAP_ERR_SHORT_WRITE;
-            report_write_failure(save_as_filename, err);
-            ws_close(to_fd);
-            return;
+                bytes_to_write = (int)bytes_left;
+            bytes_written = ws_write(to_fd, ptr, bytes_to_write);
+            if (bytes_written <= 0) {
+                if (bytes_written < 0)
+                    err = errno;
+                else
+                    err = WTAP_ERR_SHORT_WRITE;
+                report_write_failure(save_as_filename, err);
+                g_free(buf);
+                ws_close(to_fd);
+                return;
+            }
+            bytes_left -= bytes_written;
+            ptr += bytes_written;
         }
-        bytes_left -= bytes_written;
-        ptr += bytes_written;
     }
+    g_free(buf);
     if (ws_close(to_fd) < 0)
         report_write_failure(save_as_filename, errno);
 }
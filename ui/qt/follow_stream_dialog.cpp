@@ -461,22 +461,14 @@ void FollowStreamDialog::resetStream()
 
     //Only TCP stream uses fragments
     if (follow_type_ == FOLLOW_TCP) {
-        for (cur = follow_info_.fragments[0]; cur; cur = gxx_list_next(cur)) {
-            follow_record = gxx_list_data(follow_record_t *, cur);
-            if (follow_record->data) {
-                g_byte_array_free(follow_record->data, TRUE);
-            }
-            g_free(follow_record);
+        if (follow_info_.fragments[0]) {
+            g_tree_destroy(follow_info_.fragments[0]);
+            follow_info_.fragments[0] = Q_NULLPTR;
         }
-        follow_info_.fragments[0] = Q_NULLPTR;
-        for (cur = follow_info_.fragments[1]; cur; cur = gxx_list_next(cur)) {
-            follow_record = gxx_list_data(follow_record_t *, cur);
-            if (follow_record->data) {
-                g_byte_array_free(follow_record->data, TRUE);
-            }
-            g_free(follow_record);
+        if (follow_info_.fragments[1]) {
+            g_tree_destroy(follow_info_.fragments[1]);
+            follow_info_.fragments[1] = Q_NULLPTR;
         }
-        follow_info_.fragments[1] = Q_NULLPTR;
     }
 
     follow_info_.payload = Q_NULLPTR;
@@ -53,6 +53,11 @@ ExportObjectModel::ExportObjectModel(register_eo_t* eo, QObject *parent) :
     export_object_list_.gui_data = (void*)&eo_gui_data_;
 }
 
+ExportObjectModel::~ExportObjectModel()
+{
+    freeObjects();
+}
+
 QVariant ExportObjectModel::data(const QModelIndex &index, int role) const
 {
     if ((!index.isValid()) || ((role != Qt::DisplayRole) && (role != Qt::UserRole))) {
@@ -128,6 +133,9 @@ void ExportObjectModel::addObjectEntry(export_object_entry_t *entry)
     if (entry == NULL)
         return;
 
+    // Large captures can have more objects than fit in memory.
+    eo_keep_entry(entry);
+
     int count = objects_.count();
     beginInsertRows(QModelIndex(), count, count);
     objects_.append(VariantPointer<export_object_entry_t>::asQVariant(entry));
@@ -201,13 +209,21 @@ void ExportObjectModel::resetObjects()
     export_object_gui_reset_cb reset_cb = get_eo_reset_func(eo_);
 
     emit beginResetModel();
-    objects_.clear();
+    freeObjects();
     emit endResetModel();
 
     if (reset_cb)
         reset_cb();
 }
 
+void ExportObjectModel::freeObjects()
+{
+    foreach (QVariant object, objects_) {
+        eo_free_entry(VariantPointer<export_object_entry_t>::asPtr(object));
+    }
+    objects_.clear();
+}
+
 // Called by taps
 /* Runs at the beginning of tapping only */
 void ExportObjectModel::resetTap(void *tapdata)
@@ -30,6 +30,7 @@ class ExportObjectModel : public QAbstractTableModel
 
 public:
     ExportObjectModel(register_eo_t* eo, QObject *parent);
+    ~ExportObjectModel();
 
     enum ExportObjectColumn {
         colPacket = 0,
@@ -62,6 +63,8 @@ public:
 private:
     QList<QVariant> objects_;
 
+    void freeObjects();
+
     export_object_list_t export_object_list_;
     export_object_list_gui_t eo_gui_data_;
     register_eo_t* eo_;
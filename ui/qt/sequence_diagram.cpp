@@ -20,22 +20,48 @@
 #include <QPalette>
 #include <QPen>
 #include <QPointF>
+#include <qmath.h>
 
 const int max_comment_em_width_ = 20;
 
 // UML-like network node sequence diagrams.
 // https://developer.ibm.com/articles/the-sequence-diagram/
 
-WSCPSeqData::WSCPSeqData() :
-  key(0),
-  value(NULL)
+SequenceTicker::SequenceTicker(LabelType label_type) :
+    label_type_(label_type),
+    sainfo_(NULL),
+    elide_w_(0)
+{
+}
+
+QString SequenceTicker::getTickLabel(double tick, const QLocale &, QChar, int)
 {
+    seq_analysis_item_t *sai = NULL;
+
+    if (sainfo_ && tick >= 0) {
+        sai = sequence_analysis_get_display_item(sainfo_, qRound(tick));
+    }
+    if (!sai) return QString();
+
+    if (label_type_ == TimeLabel) {
+        return sai->time_str;
+    }
+    return QFontMetrics(elide_font_).elidedText(sai->comment, Qt::ElideRight, elide_w_);
 }
 
-WSCPSeqData::WSCPSeqData(double key, struct _seq_analysis_item *value) :
-  key(key),
-  value(value)
+QVector<double> SequenceTicker::createTickVector(double, const QCPRange &range)
 {
+    QVector<double> ticks;
+
+    if (!sainfo_) return ticks;
+
+    // Like QCPAxisTickerText, give one tick outside of the range.
+    int first_tick = qMax(0, qFloor(range.lower) - 1);
+    int last_tick = qMin(int(sainfo_->display_index->len) - 1, qCeil(range.upper) + 1);
+    for (int tick = first_tick; tick <= last_tick; tick++) {
+        ticks.append(tick);
+    }
+    return ticks;
 }
 
 SequenceDiagram::SequenceDiagram(QCPAxis *keyAxis, QCPAxis *valueAxis, QCPAxis *commentAxis) :
@@ -43,23 +69,26 @@ SequenceDiagram::SequenceDiagram(QCPAxis *keyAxis, QCPAxis *valueAxis, QCPAxis *
     key_axis_(keyAxis),
     value_axis_(valueAxis),
     comment_axis_(commentAxis),
-    data_(NULL),
+    key_ticker_(new SequenceTicker(SequenceTicker::TimeLabel)),
+    comment_ticker_(new SequenceTicker(SequenceTicker::CommentLabel)),
     sainfo_(NULL),
     selected_packet_(0),
     selected_key_(-1.0)
 {
-    data_ = new WSCPSeqDataMap();
     // xaxis (value): Address
     // yaxis (key): Time
     // yaxis2 (comment): Extra info ("Comment" in GTK+)
 
 //    valueAxis->setAutoTickStep(false);
+    QSharedPointer<QCPAxisTicker> value_ticker(new QCPAxisTickerText);
+    value_axis_->setTicker(value_ticker);
+    key_axis_->setTicker(key_ticker_);
+    comment_axis_->setTicker(comment_ticker_);
+
     QList<QCPAxis *> axes;
     axes << value_axis_ << key_axis_ << comment_axis_;
     QPen no_pen(Qt::NoPen);
     foreach (QCPAxis *axis, axes) {
-        QSharedPointer<QCPAxisTicker> ticker(new QCPAxisTickerText);
-        axis->setTicker(ticker);
         axis->setSubTickPen(no_pen);
         axis->setTickPen(no_pen);
         axis->setBasePen(no_pen);
@@ -85,87 +114,68 @@ SequenceDiagram::SequenceDiagram(QCPAxis *keyAxis, QCPAxis *valueAxis, QCPAxis *
     //    valueAxis->setTickLabelRotation(30);
 }
 
-SequenceDiagram::~SequenceDiagram()
+int SequenceDiagram::itemCount() const
 {
-    delete data_;
+    return sainfo_ ? int(sainfo_->display_index->len) : 0;
 }
 
 int SequenceDiagram::adjacentPacket(bool next)
 {
-    int adjacent_packet = -1;
-    WSCPSeqDataMap::const_iterator it;
+    int count = itemCount();
+    int key = -1;
 
-    if (data_->size() < 1) return adjacent_packet;
+    if (count < 1) return -1;
 
     if (selected_packet_ < 1) {
-        if (next) {
-            it = data_->constBegin();
-        } else {
-            it = data_->constEnd();
-            --it;
-        }
-        selected_key_ = it.value().key;
-        return it.value().value->frame_number;
+        key = next ? 0 : count - 1;
+        selected_key_ = key;
+        return sequence_analysis_get_display_item(sainfo_, key)->frame_number;
     }
 
-    if (next) {
-        for (it = data_->constBegin(); it != data_->constEnd(); ++it) {
-            if (it.value().value->frame_number == selected_packet_) {
-                ++it;
-                if (it != data_->constEnd()) {
-                    adjacent_packet = it.value().value->frame_number;
-                    selected_key_ = it.value().key;
-                }
+    // The selected item is usually where we last drew it.
+    if (selected_key_ >= 0 && selected_key_ < count
+            && sequence_analysis_get_display_item(sainfo_, int(selected_key_))->frame_number == selected_packet_) {
+        key = int(selected_key_);
+    } else if (next) {
+        for (int cur_key = 0; cur_key < count; cur_key++) {
+            if (sequence_analysis_get_display_item(sainfo_, cur_key)->frame_number == selected_packet_) {
+                key = cur_key;
                 break;
             }
         }
     } else {
-        it = data_->constEnd();
-        --it;
-        while (it != data_->constBegin()) {
-            guint32 prev_frame = it.value().value->frame_number;
-            --it;
-            if (prev_frame == selected_packet_) {
-                adjacent_packet = it.value().value->frame_number;
-                selected_key_ = it.value().key;
+        for (int cur_key = count - 1; cur_key >= 0; cur_key--) {
+            if (sequence_analysis_get_display_item(sainfo_, cur_key)->frame_number == selected_packet_) {
+                key = cur_key;
                 break;
             }
         }
     }
+    if (key < 0) return -1;
+
+    key += next ? 1 : -1;
+    if (key < 0 || key >= count) return -1;
 
-    return adjacent_packet;
+    selected_key_ = key;
+    return sequence_analysis_get_display_item(sainfo_, key)->frame_number;
 }
 
+// The items are indexed by sainfo->display_index, which is filled in by
+// sequence_analysis_get_nodes or sequence_analysis_get_new_nodes. Call this
+// again after either of them in order to update the nodes.
 void SequenceDiagram::setData(_seq_analysis_info *sainfo)
 {
-    data_->clear();
     sainfo_ = sainfo;
+    key_ticker_->setData(sainfo);
+    comment_ticker_->setData(sainfo);
     if (!sainfo) return;
 
-    double cur_key = 0.0;
-    QVector<double> key_ticks, val_ticks;
-    QVector<QString> key_labels, val_labels, com_labels;
+    QVector<double> val_ticks;
+    QVector<QString> val_labels;
     QFontMetrics com_fm(comment_axis_->tickLabelFont());
-    int elide_w = com_fm.height() * max_comment_em_width_;
     char* addr_str;
 
-    for (GList *cur = g_queue_peek_nth_link(sainfo->items, 0); cur; cur = gxx_list_next(cur)) {
-        seq_analysis_item_t *sai = gxx_list_data(seq_analysis_item_t *, cur);
-        if (sai->display) {
-            WSCPSeqData new_data;
-
-            new_data.key = cur_key;
-            new_data.value = sai;
-            data_->insert(new_data.key, new_data);
-
-            key_ticks.append(cur_key);
-            key_labels.append(sai->time_str);
-
-            com_labels.append(com_fm.elidedText(sai->comment, Qt::ElideRight, elide_w));
-
-            cur_key++;
-        }
-    }
+    comment_ticker_->setElide(comment_axis_->tickLabelFont(), com_fm.height() * max_comment_em_width_);
 
     for (unsigned int i = 0; i < sainfo_->num_nodes; i++) {
         val_ticks.append(i);
@@ -178,12 +188,8 @@ void SequenceDiagram::setData(_seq_analysis_info *sainfo)
         wmem_free(Q_NULLPTR, addr_str);
     }
 
-    QSharedPointer<QCPAxisTickerText> key_ticker = qSharedPointerCast<QCPAxisTickerText>(keyAxis()->ticker());
-    key_ticker->setTicks(key_ticks, key_labels);
     QSharedPointer<QCPAxisTickerText> value_ticker = qSharedPointerCast<QCPAxisTickerText>(valueAxis()->ticker());
     value_ticker->setTicks(val_ticks, val_labels);
-    QSharedPointer<QCPAxisTickerText> comment_ticker = qSharedPointerCast<QCPAxisTickerText>(comment_axis_->ticker());
-    comment_ticker->setTicks(key_ticks, com_labels);
 }
 
 void SequenceDiagram::setSelectedPacket(int selected_packet)
@@ -201,8 +207,8 @@ _seq_analysis_item *SequenceDiagram::itemForPosY(int ypos)
 {
     double key_pos = qRound(key_axis_->pixelToCoord(ypos));
 
-    if (key_pos >= 0 && key_pos < data_->size()) {
-        return data_->value(key_pos).value;
+    if (key_pos >= 0 && key_pos < itemCount()) {
+        return sequence_analysis_get_display_item(sainfo_, int(key_pos));
     }
     return NULL;
 }
@@ -211,7 +217,7 @@ double SequenceDiagram::selectTest(const QPointF &pos, bool, QVariant *) const
 {
     double key_pos = qRound(key_axis_->pixelToCoord(pos.y()));
 
-    if (key_pos >= 0 && key_pos < data_->size()) {
+    if (key_pos >= 0 && key_pos < itemCount()) {
         return 1.0;
     }
 
@@ -239,10 +245,12 @@ void SequenceDiagram::draw(QCPPainter *painter)
     painter->restore();
     fg_pen = pen();
 
-    WSCPSeqDataMap::const_iterator it;
-    for (it = data_->constBegin(); it != data_->constEnd(); ++it) {
-        double cur_key = it.key();
-        seq_analysis_item_t *sai = it.value().value;
+    // Only look at the items in view, which might be a few out of many.
+    int first_key = qMax(0, qFloor(key_axis_->range().lower - 0.5));
+    int last_key = qMin(itemCount() - 1, qCeil(key_axis_->range().upper + 0.5));
+    for (int key = first_key; key <= last_key; key++) {
+        double cur_key = key;
+        seq_analysis_item_t *sai = sequence_analysis_get_display_item(sainfo_, key);
         QColor bg_color;
 
         if (sai->frame_number == selected_packet_) {
@@ -365,18 +373,10 @@ QCPRange SequenceDiagram::getKeyRange(bool &validRange, QCP::SignDomain) const
     QCPRange range;
     bool valid = false;
 
-    WSCPSeqDataMap::const_iterator it = data_->constBegin();
-    while (it != data_->constEnd()) {
-        double cur_key = it.key();
-        if (!valid) {
-            range.lower = range.upper = cur_key;
-            valid = true;
-        } else if (cur_key < range.lower) {
-            range.lower = cur_key;
-        } else if (cur_key > range.upper) {
-            range.upper = cur_key;
-        }
-        ++it;
+    if (itemCount() > 0) {
+        range.lower = 0;
+        range.upper = itemCount() - 1;
+        valid = true;
     }
     validRange = valid;
     return range;
@@ -389,7 +389,7 @@ QCPRange SequenceDiagram::getValueRange(bool &validRange, QCP::SignDomain, const
 
     if (sainfo_) {
         range.lower = 0;
-        range.upper = data_->size();
+        range.upper = itemCount();
         valid = true;
     }
     validRange = valid;
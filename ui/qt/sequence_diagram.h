@@ -17,30 +17,41 @@
 #include <epan/address.h>
 
 #include <QObject>
-#include <QMultiMap>
 #include <ui/qt/widgets/qcustomplot.h>
 
 struct _seq_analysis_info;
 struct _seq_analysis_item;
 
-// Some of this is probably unnecessary
-class WSCPSeqData
+// Labels the time and comment axes. Ticks and labels are created only for
+// the items in view, so that large diagrams don't need a label per item.
+class SequenceTicker : public QCPAxisTicker
 {
 public:
-  WSCPSeqData();
-  WSCPSeqData(double key, _seq_analysis_item *value);
-  double key;
-  struct _seq_analysis_item *value;
-};
+    enum LabelType { TimeLabel, CommentLabel };
+
+    explicit SequenceTicker(LabelType label_type);
 
-typedef QMultiMap<double, WSCPSeqData> WSCPSeqDataMap;
+    void setData(struct _seq_analysis_info *sainfo) { sainfo_ = sainfo; }
+    void setElide(const QFont &font, int width) { elide_font_ = font; elide_w_ = width; }
+
+protected:
+    virtual double getTickStep(const QCPRange &) Q_DECL_OVERRIDE { return 1.0; }
+    virtual int getSubTickCount(double) Q_DECL_OVERRIDE { return 0; }
+    virtual QString getTickLabel(double tick, const QLocale &locale, QChar formatChar, int precision) Q_DECL_OVERRIDE;
+    virtual QVector<double> createTickVector(double tickStep, const QCPRange &range) Q_DECL_OVERRIDE;
+
+private:
+    LabelType label_type_;
+    struct _seq_analysis_info *sainfo_;
+    QFont elide_font_;
+    int elide_w_;
+};
 
 class SequenceDiagram : public QCPAbstractPlottable
 {
     Q_OBJECT
 public:
     explicit SequenceDiagram(QCPAxis *keyAxis, QCPAxis *valueAxis, QCPAxis *commentAxis);
-    virtual ~SequenceDiagram();
 
     // getters:
     // Next / previous packet.
@@ -55,7 +66,7 @@ public:
     struct _seq_analysis_item *itemForPosY(int ypos);
 
     // reimplemented virtual methods:
-    virtual void clearData() { data_->clear(); }
+    virtual void clearData() { setData(NULL); }
     virtual double selectTest(const QPointF &pos, bool onlySelectable, QVariant *details=0) const Q_DECL_OVERRIDE;
 
 public slots:
@@ -71,10 +82,13 @@ private:
     QCPAxis *key_axis_;
     QCPAxis *value_axis_;
     QCPAxis *comment_axis_;
-    WSCPSeqDataMap *data_;
+    QSharedPointer<SequenceTicker> key_ticker_;
+    QSharedPointer<SequenceTicker> comment_ticker_;
     struct _seq_analysis_info *sainfo_;
     guint32 selected_packet_;
     double selected_key_;
+
+    int itemCount() const;
 };
 
 #endif // SEQUENCE_DIAGRAM_H
@@ -17,7 +17,6 @@
 #include "wsutil/nstime.h"
 #include "wsutil/utf8_entities.h"
 #include "wsutil/file_util.h"
-#include <wsutil/report_message.h>
 
 #include <ui/qt/utils/color_utils.h>
 #include "progress_frame.h"
@@ -68,6 +67,7 @@ SequenceDialog::SequenceDialog(QWidget &parent, CaptureFile &cf, SequenceInfo *i
     WiresharkDialog(parent, cf),
     ui(new Ui::SequenceDialog),
     info_(info),
+    analysis_packet_(NULL),
     num_items_(0),
     packet_num_(0),
     sequence_w_(1)
@@ -430,23 +430,26 @@ void SequenceDialog::fillDiagram()
         register_analysis_t* analysis = sequence_analysis_find_by_name(info_->sainfo()->name);
         if (analysis != NULL)
         {
-            GString *error_string;
             const char *filter = NULL;
             if (ui->displayFilterCheckBox->checkState() == Qt::Checked)
                 filter = cap_file_.capFile()->dfilter;
 
-            error_string = register_tap_listener(sequence_analysis_get_tap_listener_name(analysis), info_->sainfo(), filter, sequence_analysis_get_tap_flags(analysis),
-                                       NULL, sequence_analysis_get_packet_func(analysis), NULL, NULL);
-            if (error_string) {
-                report_failure("Sequence dialog - tap registration failed: %s", error_string->str);
-                g_string_free(error_string, TRUE);
-            }
-
-            cf_retap_packets(cap_file_.capFile());
-            remove_tap_listener(info_->sainfo());
-
-            num_items_ = sequence_analysis_get_nodes(info_->sainfo());
+            // We tap on behalf of the analysis so that we can show the items
+            // tapped so far while the packets are being retapped.
+            analysis_packet_ = sequence_analysis_get_packet_func(analysis);
+            num_items_ = 0;
             seq_diagram_->setData(info_->sainfo());
+
+            if (registerTapListener(sequence_analysis_get_tap_listener_name(analysis), this, filter,
+                                    sequence_analysis_get_tap_flags(analysis), NULL, tapPacket, tapDraw)) {
+                ui->controlFrame->setEnabled(false);
+                beginRetapPackets();
+                cf_retap_packets(cap_file_.capFile());
+                removeTapListeners();
+                updateDiagram();
+                ui->controlFrame->setEnabled(true);
+                endRetapPackets();
+            }
         }
     }
 
@@ -459,6 +462,34 @@ void SequenceDialog::fillDiagram()
     sp->setFocus();
 }
 
+// Add the items that have been tapped since the last update.
+void SequenceDialog::updateDiagram()
+{
+    if (!info_->sainfo() || file_closed_) return;
+
+    num_items_ = sequence_analysis_get_new_nodes(info_->sainfo());
+    seq_diagram_->setData(info_->sainfo());
+
+    mouseMoved(NULL);
+    resetAxes(true);
+}
+
+tap_packet_status SequenceDialog::tapPacket(void *sequence_dialog_ptr, packet_info *pinfo, epan_dissect_t *edt, const void *data)
+{
+    SequenceDialog *sequence_dialog = static_cast<SequenceDialog *>(sequence_dialog_ptr);
+    if (!sequence_dialog) return TAP_PACKET_DONT_REDRAW;
+
+    return sequence_dialog->analysis_packet_(sequence_dialog->info_->sainfo(), pinfo, edt, data);
+}
+
+void SequenceDialog::tapDraw(void *sequence_dialog_ptr)
+{
+    SequenceDialog *sequence_dialog = static_cast<SequenceDialog *>(sequence_dialog_ptr);
+    if (!sequence_dialog) return;
+
+    sequence_dialog->updateDiagram();
+}
+
 void SequenceDialog::panAxes(int x_pixels, int y_pixels)
 {
     // We could simplify this quite a bit if we set the scroll bar values instead.
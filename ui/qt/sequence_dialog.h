@@ -91,6 +91,7 @@ private:
     Ui::SequenceDialog *ui;
     SequenceDiagram *seq_diagram_;
     SequenceInfo *info_;
+    tap_packet_cb analysis_packet_;
     int num_items_;
     guint32 packet_num_;
     double one_em_;
@@ -103,6 +104,10 @@ private:
     void panAxes(int x_pixels, int y_pixels);
     void resetAxes(bool keep_lower = false);
     void goToAdjacentPacket(bool next);
+    void updateDiagram();
+
+    static tap_packet_status tapPacket(void *sequence_dialog_ptr, packet_info *pinfo, epan_dissect_t *edt, const void *data);
+    static void tapDraw(void *sequence_dialog_ptr);
 
     static gboolean addFlowSequenceItem(const void *key, void *value, void *userdata);
 };
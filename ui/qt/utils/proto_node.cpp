@@ -46,7 +46,7 @@ QString ProtoNode::labelText() const
 
     QString label;
     /* was a free format label produced? */
-    if (fi->rep) {
+    if (proto_item_get_rep(fi)) {
         label = fi->rep->representation;
     }
     else { /* no, make a generic label */
@@ -21,6 +21,11 @@
 #include "wtap-int.h"
 #include "file_wrappers.h"
 #include <wsutil/file_util.h>
+#include <wsutil/shm_ring.h>
+
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 #ifdef HAVE_ZLIB
 #define ZLIB_CONST
@@ -152,6 +157,26 @@ struct wtap_reader {
     /* fast seeking */
     GPtrArray *fast_seek;
     void *fast_seek_cur;
+    gboolean random_access;     /* TRUE if used for random rather than sequential reads */
+
+#ifdef HAVE_MMAP
+    /* If an uncompressed regular file is opened for random access and is
+       small enough for the buffer offsets, the whole file is mapped and
+       the output buffer points into the mapping, so every seek within
+       the file stays within the buffer and reads are copied straight
+       from the page cache. */
+    guint8 *map;                /* start of the mapping, or NULL */
+    size_t map_size;            /* size of the mapping */
+#endif
+
+    /* If the file is being written by a capture process that also puts
+       what it writes into shared memory, uncompressed data is copied
+       from there rather than read from the file when it's available. */
+    shm_ring_t *shm_ring;
+
+    /* Called with raw data as it's read from the file. */
+    wtap_raw_data_callback_t raw_data_cb;
+    void *raw_data_cb_data;
 };
 
 /* Current read offset within a buffer. */
@@ -215,6 +240,28 @@ buf_read(FILE_T state, struct wtap_reader_buf *buf)
         to_read = space_left;
     }
 
+    if (state->shm_ring != NULL && buf == &state->out) {
+        ret = shm_ring_read(state->shm_ring, (guint64)state->raw_pos,
+                            read_ptr, to_read);
+        if (ret > 0) {
+            if (state->raw_data_cb != NULL)
+                state->raw_data_cb(state->raw_pos, read_ptr, (size_t)ret,
+                                   state->raw_data_cb_data);
+            state->raw_pos += ret;
+            buf->avail += ret;
+            return 0;
+        }
+
+        /* It's not there yet, or it's been overwritten already; read
+           it from the file, whose position we haven't been keeping up
+           to date. */
+        if (ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+            state->err = errno;
+            state->err_info = NULL;
+            return -1;
+        }
+    }
+
     ret = ws_read(state->fd, read_ptr, to_read);
     if (ret < 0) {
         state->err = errno;
@@ -223,6 +270,11 @@ buf_read(FILE_T state, struct wtap_reader_buf *buf)
     }
     if (ret == 0)
         state->eof = TRUE;
+    else if (state->shm_ring != NULL && buf == &state->out)
+        shm_ring_count_file_read(state->shm_ring, (size_t)ret);
+    if (ret > 0 && state->raw_data_cb != NULL)
+        state->raw_data_cb(state->raw_pos, read_ptr, (size_t)ret,
+                           state->raw_data_cb_data);
     state->raw_pos += ret;
     buf->avail += ret;
     return 0;
@@ -642,6 +694,95 @@ DIAG_ON(cast-qual)
 }
 #endif
 
+#ifdef HAVE_MMAP
+/*
+ * Go back to reading the file into a buffer, starting at the current
+ * position.
+ */
+static void
+file_unmap(FILE_T state)
+{
+    munmap(state->map, state->map_size);
+    state->map = NULL;
+    state->map_size = 0;
+
+    state->out.buf = (guint8 *)g_malloc(state->size << 1);
+    buf_reset(&state->out);
+    state->raw_pos = state->start + state->pos;
+    state->eof = FALSE;
+    if (ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+        state->err = errno;
+        state->err_info = NULL;
+    }
+}
+
+/*
+ * Map the file and make the output buffer cover all of it, starting
+ * at the current position.  If the file is already mapped, map it
+ * again if it has grown (e.g., it's a capture file that's still being
+ * written) or if remap is TRUE (the file descriptor has changed).
+ *
+ * Touching a page of the mapping that's past the end of the file raises
+ * SIGBUS, so if the file has been truncated since it was mapped, go back
+ * to reading it, which gets a short read instead.  That's only checked
+ * here, when we've got to the end of the mapping, rather than on every
+ * seek, which would cost as much as the seek and read the mapping saves.
+ * Capture files are appended to or replaced rather than cut short, so
+ * the pages before the end that we've seen are taken to stay there.
+ *
+ * Returns TRUE if the file is mapped.  If it isn't, or a mapping can't
+ * be extended to all of the file (it has grown past what the buffer
+ * offsets can cover, or mmap() fails), it's read from then on.
+ */
+static gboolean
+file_map(FILE_T state, gboolean remap)
+{
+    ws_statb64 st;
+    gint64 data_size;
+    void *map;
+
+    if (state->fd == -1 || ws_fstat64(state->fd, &st) == -1 ||
+        !S_ISREG(st.st_mode))
+        goto fail;
+
+    /* The buffer offsets are unsigned ints, so bigger files are read. */
+    data_size = st.st_size - state->start;
+    if (data_size <= 0 || data_size < state->pos || data_size > G_MAXUINT)
+        goto fail;
+    if (state->map != NULL && (size_t)st.st_size < state->map_size)
+        goto fail;
+    if (state->map != NULL && !remap && (size_t)st.st_size == state->map_size)
+        return TRUE;
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, state->fd, 0);
+    if (map == MAP_FAILED)
+        goto fail;
+
+    if (state->map != NULL)
+        munmap(state->map, state->map_size);
+    else
+        g_free(state->out.buf);
+    state->map = (guint8 *)map;
+    state->map_size = (size_t)st.st_size;
+    if (state->raw_data_cb != NULL)
+        state->raw_data_cb(0, state->map, state->map_size,
+                           state->raw_data_cb_data);
+
+    /* Offset 0 in the buffer is the start of the raw data, which is
+       position 0 in an uncompressed file. */
+    state->out.buf = state->map + state->start;
+    state->out.next = state->out.buf + state->pos;
+    state->out.avail = (guint)(data_size - state->pos);
+    state->raw_pos = state->start + state->pos;
+    return TRUE;
+
+fail:
+    if (state->map != NULL)
+        file_unmap(state);
+    return FALSE;
+}
+#endif
+
 static int
 gz_head(FILE_T state)
 {
@@ -828,6 +969,12 @@ gz_head(FILE_T state)
         buf_reset(&state->in);
     }
     state->compression = UNCOMPRESSED;
+#ifdef HAVE_MMAP
+    /* There's no decompression to do, so read the file in place. */
+    if (state->random_access && state->shm_ring == NULL &&
+        file_map(state, FALSE))
+        state->eof = FALSE;
+#endif
     return 0;
 }
 
@@ -841,6 +988,16 @@ fill_out_buffer(FILE_T state)
             return 0;
     }
     if (state->compression == UNCOMPRESSED) {           /* straight copy */
+#ifdef HAVE_MMAP
+        /* We've delivered everything that was mapped; see whether the
+           file has grown since, and if it hasn't, we're at the end of
+           it. */
+        if (state->map != NULL && file_map(state, FALSE)) {
+            if (state->out.avail == 0)
+                state->eof = TRUE;
+            return 0;
+        }
+#endif
         if (buf_read(state, &state->out) < 0)
             return -1;
     }
@@ -852,6 +1009,40 @@ fill_out_buffer(FILE_T state)
     return 0;
 }
 
+#ifndef S_ISREG
+#define S_ISREG(mode)   (((mode) & S_IFMT) == S_IFREG)
+#endif
+
+/*
+ * Skip over len bytes of an uncompressed file by seeking past them rather
+ * than reading them, if we can seek in the file and they're all in it.
+ * Returns TRUE if that was done.
+ */
+static gboolean
+raw_skip(FILE_T state, gint64 len)
+{
+    ws_statb64 st;
+
+    if (state->compression != UNCOMPRESSED || state->in.avail != 0 ||
+        state->shm_ring != NULL || state->fd == -1)
+        return FALSE;
+#ifdef HAVE_MMAP
+    if (state->map != NULL)
+        return FALSE;
+#endif
+    if (ws_fstat64(state->fd, &st) == -1 || !S_ISREG(st.st_mode) ||
+        state->raw_pos + len > st.st_size)
+        return FALSE;
+    if (ws_lseek64(state->fd, state->raw_pos + len, SEEK_SET) == -1)
+        return FALSE;
+    state->raw_pos += len;
+    state->pos += len;
+    /* What's in the output buffer is from before the bytes we skipped, so
+       a backward seek mustn't find it there. */
+    buf_reset(&state->out);
+    return TRUE;
+}
+
 static int
 gz_skip(FILE_T state, gint64 len)
 {
@@ -878,6 +1069,9 @@ gz_skip(FILE_T state, gint64 len)
             /* We have nothing in the output buffer, and
                we're at the end of the input; just return. */
             break;
+        } else if (len > state->size && raw_skip(state, len)) {
+            /* We skipped the rest without reading it. */
+            break;
         } else {
             /* We have nothing in the output buffer, and
                we can generate more data; get more output,
@@ -1060,9 +1254,40 @@ file_open(const char *path)
 }
 
 void
-file_set_random_access(FILE_T stream, gboolean random_flag _U_, GPtrArray *seek)
+file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek)
 {
     stream->fast_seek = seek;
+    stream->random_access = random_flag;
+#ifdef HAVE_MMAP
+    /* Only random-access handles are mapped, as that's where the
+       mapping saves a seek and a read for every record. */
+    if (!random_flag && stream->map != NULL)
+        file_unmap(stream);
+#endif
+}
+
+void
+file_set_shm_ring(FILE_T stream, shm_ring_t *ring)
+{
+#ifdef HAVE_MMAP
+    /* The mapping would be read instead of the ring. */
+    if (ring != NULL && stream->map != NULL)
+        file_unmap(stream);
+#endif
+    stream->shm_ring = ring;
+}
+
+void
+file_set_raw_data_cb(FILE_T stream, wtap_raw_data_callback_t raw_data_cb,
+                     void *user_data)
+{
+    stream->raw_data_cb = raw_data_cb;
+    stream->raw_data_cb_data = user_data;
+#ifdef HAVE_MMAP
+    /* The mapped data won't be read again. */
+    if (raw_data_cb != NULL && stream->map != NULL)
+        raw_data_cb(0, stream->map, stream->map_size, user_data);
+#endif
 }
 
 gint64
@@ -1169,6 +1394,29 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
         }
     }
 
+#ifdef HAVE_MMAP
+    if (file->map != NULL) {
+        /*
+         * The whole file is in the buffer, so we're seeking to before
+         * the beginning or past the end of it.
+         */
+        if (file->pos + offset < 0) {
+            *err = EINVAL;
+            return -1;
+        }
+        n = file->out.avail;
+        file->out.avail = 0;
+        file->out.next += n;
+        file->pos += n;
+        offset -= n;
+
+        /* Reads will hit the end of the file, unless it grows first. */
+        file->seek_pending = TRUE;
+        file->skip = offset;
+        return file->pos + offset;
+    }
+#endif
+
     /*
      * We're not seeking within the buffer.  Do we have "fast seek" data
      * for the location to which we will be seeking, and is the offset
@@ -1284,8 +1532,12 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
     {
         /*
          * Yes.  Just seek there within the file.
+         *
+         * The buffer ends at raw_pos, which isn't necessarily where
+         * the descriptor is; if the data came from a shared memory
+         * ring, the descriptor hasn't moved.
          */
-        if (ws_lseek64(file->fd, offset - file->out.avail, SEEK_CUR) == -1) {
+        if (ws_lseek64(file->fd, file->raw_pos + (offset - file->out.avail), SEEK_SET) == -1) {
             *err = errno;
             return -1;
         }
@@ -1361,6 +1613,10 @@ file_tell(FILE_T stream)
 gint64
 file_tell_raw(FILE_T stream)
 {
+#ifdef HAVE_MMAP
+    if (stream->map != NULL)
+        return stream->start + stream->pos;
+#endif
     return stream->raw_pos;
 }
 
@@ -1636,6 +1892,12 @@ file_fdreopen(FILE_T file, const char *path)
     if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1)
         return FALSE;
     file->fd = fd;
+#ifdef HAVE_MMAP
+    /* The file might have been replaced, so don't keep reading the old
+       one; if the new one can't be mapped, it's read instead. */
+    if (file->map != NULL)
+        file_map(file, TRUE);
+#endif
     return TRUE;
 }
 
@@ -1649,7 +1911,12 @@ file_close(FILE_T file)
 #ifdef HAVE_ZLIB
         inflateEnd(&(file->strm));
 #endif
-        g_free(file->out.buf);
+#ifdef HAVE_MMAP
+        if (file->map != NULL)
+            munmap(file->map, file->map_size);
+        else
+#endif
+            g_free(file->out.buf);
         g_free(file->in.buf);
     }
     g_free(file->fast_seek_cur);
@@ -12,11 +12,14 @@
 #include <glib.h>
 #include "wtap.h"
 #include <wsutil/file_util.h>
+#include <wsutil/shm_ring.h>
 #include "ws_symbol_export.h"
 
 extern FILE_T file_open(const char *path);
 extern FILE_T file_fdopen(int fildes);
 extern void file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek);
+extern void file_set_shm_ring(FILE_T stream, shm_ring_t *ring);
+extern void file_set_raw_data_cb(FILE_T stream, wtap_raw_data_callback_t raw_data_cb, void *user_data);
 WS_DLL_PUBLIC gint64 file_seek(FILE_T stream, gint64 offset, int whence, int *err);
 WS_DLL_PUBLIC gint64 file_tell(FILE_T stream);
 extern gint64 file_tell_raw(FILE_T stream);
@@ -0,0 +1,364 @@
+/* file_wrappers_test.c
+ * Tests of reading files that change while they're being read
+ *
+ * Wiretap Library
+ * Copyright (c) 1998 by Gilbert Ramirez <gram@alumni.rice.edu>
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <wsutil/file_util.h>
+
+#include "file_wrappers.h"
+
+#define TEST_FILE_SIZE  (64 * 1024)
+
+/* Run the benchmark with "file_wrappers_test -m perf". */
+#define BENCH_FILE_SIZE (64 * 1024 * 1024)
+#define BENCH_RECORD    128
+#define BENCH_READS     200000
+
+static guint8 test_data[TEST_FILE_SIZE];
+
+/* Overwrite the file in place with the first len bytes of the test data,
+ * truncating it, rather than replacing it. */
+static void
+write_test_file(const char *path, size_t len)
+{
+    int fd = ws_open(path, O_WRONLY|O_TRUNC|O_BINARY, 0600);
+
+    g_assert(fd != -1);
+    g_assert_cmpint(ws_write(fd, test_data, (unsigned int)len), ==, (int)len);
+    ws_close(fd);
+}
+
+static void
+append_test_file(const char *path, size_t offset, size_t len)
+{
+    int fd = ws_open(path, O_WRONLY|O_APPEND|O_BINARY, 0600);
+
+    g_assert(fd != -1);
+    g_assert_cmpint(ws_write(fd, test_data + offset, (unsigned int)len), ==, (int)len);
+    ws_close(fd);
+}
+
+static char *
+make_test_file(size_t len)
+{
+    char *path;
+    int fd;
+
+    fd = g_file_open_tmp("file_wrappers_test_XXXXXX", &path, NULL);
+    g_assert(fd != -1);
+    ws_close(fd);
+    write_test_file(path, len);
+    return path;
+}
+
+static void
+check_read_at(FILE_T fh, gint64 offset, unsigned int len)
+{
+    guint8 buf[256];
+    int err = 0;
+
+    g_assert(len <= sizeof buf);
+    g_assert_cmpint(file_seek(fh, offset, SEEK_SET, &err), ==, offset);
+    g_assert_cmpint(err, ==, 0);
+    g_assert_cmpint(file_read(buf, len, fh), ==, (int)len);
+    g_assert(memcmp(buf, test_data + offset, len) == 0);
+}
+
+/* With random access, a file can be read through a memory mapping, where
+ * touching a page that's no longer in the file raises SIGBUS. That's
+ * checked for when the end of the mapping is reached. */
+static void
+file_wrappers_test_random_truncate(void)
+{
+    char *path = make_test_file(TEST_FILE_SIZE);
+    FILE_T fh = file_open(path);
+    guint8 buf[100];
+    int err = 0;
+
+    g_assert_nonnull(fh);
+    file_set_random_access(fh, TRUE, NULL);
+    check_read_at(fh, 0, 100);
+    check_read_at(fh, 40000, 100);
+    check_read_at(fh, 60000, 100);
+
+    write_test_file(path, 8192);
+
+    /* Past the old end, there's nothing to read. */
+    file_seek(fh, TEST_FILE_SIZE + 100, SEEK_SET, &err);
+    g_assert_cmpint(file_read(buf, sizeof buf, fh), ==, 0);
+
+    /* Nor past the new one. */
+    file_clearerr(fh);
+    file_seek(fh, 40000, SEEK_SET, &err);
+    g_assert_cmpint(file_read(buf, sizeof buf, fh), <, (int)sizeof buf);
+
+    /* What's left is still read correctly. */
+    file_clearerr(fh);
+    check_read_at(fh, 100, 100);
+    check_read_at(fh, 8092, 100);
+
+    file_close(fh);
+    g_unlink(path);
+    g_free(path);
+}
+
+/* The file is truncated after some of it has been read sequentially. */
+static void
+file_wrappers_test_sequential_truncate(void)
+{
+    char *path = make_test_file(TEST_FILE_SIZE);
+    FILE_T fh = file_open(path);
+    guint8 buf[100];
+    int total = 0;
+    int ret;
+
+    g_assert_nonnull(fh);
+    g_assert_cmpint(file_read(buf, sizeof buf, fh), ==, (int)sizeof buf);
+    g_assert(memcmp(buf, test_data, sizeof buf) == 0);
+    total += (int)sizeof buf;
+
+    write_test_file(path, 4096);
+
+    while ((ret = file_read(buf, sizeof buf, fh)) > 0) {
+        g_assert(memcmp(buf, test_data + total, ret) == 0);
+        total += ret;
+    }
+    g_assert_cmpint(ret, ==, 0);
+    g_assert_cmpint(total, <, TEST_FILE_SIZE);
+
+    file_close(fh);
+    g_unlink(path);
+    g_free(path);
+}
+
+/* A file that's still being written, such as a live capture file. */
+static void
+file_wrappers_test_random_grow(void)
+{
+    char *path = make_test_file(TEST_FILE_SIZE / 2);
+    FILE_T fh = file_open(path);
+    guint8 buf[100];
+    int err = 0;
+
+    g_assert_nonnull(fh);
+    file_set_random_access(fh, TRUE, NULL);
+    check_read_at(fh, 0, 100);
+    check_read_at(fh, TEST_FILE_SIZE / 2 - 100, 100);
+    g_assert_cmpint(file_read(buf, sizeof buf, fh), ==, 0);
+
+    append_test_file(path, TEST_FILE_SIZE / 2, TEST_FILE_SIZE / 2);
+
+    file_clearerr(fh);
+    check_read_at(fh, TEST_FILE_SIZE / 2 + 10, 100);
+    check_read_at(fh, 10, 100);
+    g_assert_cmpint(file_seek(fh, TEST_FILE_SIZE - 50, SEEK_SET, &err), ==, TEST_FILE_SIZE - 50);
+    g_assert_cmpint(file_read(buf, sizeof buf, fh), ==, 50);
+
+    file_close(fh);
+    g_unlink(path);
+    g_free(path);
+}
+
+/* A sequential read that skips ahead by seeking rather than reading,
+ * after a short first read of a file that's still being written. */
+static void
+file_wrappers_test_sequential_skip(void)
+{
+    char *path = make_test_file(1000);
+    FILE_T fh = file_open(path);
+
+    g_assert_nonnull(fh);
+    check_read_at(fh, 0, 100);
+
+    append_test_file(path, 1000, TEST_FILE_SIZE - 1000);
+
+    check_read_at(fh, 40000, 100);
+    /* Going back to before where the skip ended mustn't find what was
+     * read before the skip. */
+    check_read_at(fh, 39000, 100);
+
+    file_close(fh);
+    g_unlink(path);
+    g_free(path);
+}
+
+/* Read records at random offsets, as wtap_seek_read() does when packets
+ * are selected or the file is rescanned. Returns the time per record in
+ * nanoseconds. */
+static double
+bench_random_reads(const char *path, gboolean mapped)
+{
+    FILE_T fh = file_open(path);
+    GPtrArray *fast_seek = g_ptr_array_new();
+    /* The same offsets each time. */
+    GRand *rand = g_rand_new_with_seed(1);
+    guint8 buf[BENCH_RECORD];
+    gint64 start, offset;
+    int err = 0;
+    guint i;
+
+    g_assert_nonnull(fh);
+    /* A sequential handle with fast seek data seeks and reads the way
+     * random-access handles did before they were mapped. */
+    file_set_random_access(fh, mapped, fast_seek);
+
+    start = g_get_monotonic_time();
+    for (i = 0; i < BENCH_READS; i++) {
+        offset = g_rand_int_range(rand, 0, BENCH_FILE_SIZE - BENCH_RECORD);
+        g_assert_cmpint(file_seek(fh, offset, SEEK_SET, &err), ==, offset);
+        g_assert_cmpint(file_read(buf, BENCH_RECORD, fh), ==, BENCH_RECORD);
+    }
+    start = g_get_monotonic_time() - start;
+
+    file_close(fh);
+    g_ptr_array_free(fast_seek, TRUE);
+    g_rand_free(rand);
+    return start * 1000.0 / BENCH_READS;
+}
+
+static void
+file_wrappers_test_bench(void)
+{
+    char *path = make_test_file(0);
+    double read_ns, mapped_ns;
+    size_t offset;
+
+    for (offset = 0; offset < BENCH_FILE_SIZE; offset += TEST_FILE_SIZE) {
+        append_test_file(path, 0, TEST_FILE_SIZE);
+    }
+
+    /* Once to get the file into the page cache. */
+    bench_random_reads(path, FALSE);
+    read_ns = bench_random_reads(path, FALSE);
+    mapped_ns = bench_random_reads(path, TRUE);
+
+    g_test_minimized_result(mapped_ns,
+            "%6.1f ns per %u byte record with seek and read, %6.1f ns mapped",
+            read_ns, BENCH_RECORD, mapped_ns);
+
+    g_unlink(path);
+    g_free(path);
+}
+
+#ifdef HAVE_MMAP
+/* Read a file sequentially, a record at a time, as TShark does while it
+ * follows a live capture. Returns the time per record in nanoseconds. */
+static double
+bench_sequential_reads(const char *path, shm_ring_t *ring)
+{
+    FILE_T fh = file_open(path);
+    guint8 buf[BENCH_RECORD];
+    gint64 start;
+    guint records = 0;
+
+    g_assert_nonnull(fh);
+    file_set_shm_ring(fh, ring);
+
+    start = g_get_monotonic_time();
+    while (file_read(buf, BENCH_RECORD, fh) == BENCH_RECORD) {
+        records++;
+    }
+    start = g_get_monotonic_time() - start;
+
+    g_assert_cmpuint(records, ==, BENCH_FILE_SIZE / BENCH_RECORD);
+    file_close(fh);
+    return start * 1000.0 / records;
+}
+
+/* What it saves to have dumpcap put what it writes in a shared memory
+ * ring (tshark --shm-buffer) rather than read it back from the file. */
+static void
+file_wrappers_test_bench_shm_ring(void)
+{
+    char *path = make_test_file(0);
+    char *ring_path;
+    shm_ring_t *consumer, *producer;
+    shm_ring_stats_t stats;
+    double file_ns, ring_ns;
+    size_t offset;
+    int fd, err = 0;
+
+    fd = g_file_open_tmp("file_wrappers_test_XXXXXX", &ring_path, NULL);
+    g_assert(fd != -1);
+    ws_close(fd);
+    consumer = shm_ring_create(ring_path, BENCH_FILE_SIZE, &err);
+    g_assert_nonnull(consumer);
+    producer = shm_ring_open(ring_path, &err);
+    g_assert_nonnull(producer);
+
+    for (offset = 0; offset < BENCH_FILE_SIZE; offset += TEST_FILE_SIZE) {
+        append_test_file(path, 0, TEST_FILE_SIZE);
+        shm_ring_write(producer, test_data, TEST_FILE_SIZE);
+    }
+    shm_ring_commit(producer);
+
+    /* Once to get the file into the page cache. */
+    bench_sequential_reads(path, NULL);
+    file_ns = bench_sequential_reads(path, NULL);
+    ring_ns = bench_sequential_reads(path, consumer);
+
+    /* All of it came from the ring. */
+    shm_ring_get_stats(consumer, &stats);
+    g_assert_cmpuint(stats.ring_read, ==, BENCH_FILE_SIZE);
+    g_assert_cmpuint(stats.file_read, ==, 0);
+
+    g_test_minimized_result(ring_ns,
+            "%6.1f ns per %u byte record from the file, %6.1f ns from the ring",
+            file_ns, BENCH_RECORD, ring_ns);
+
+    shm_ring_close(producer);
+    shm_ring_close(consumer);
+    g_unlink(ring_path);
+    g_free(ring_path);
+    g_unlink(path);
+    g_free(path);
+}
+#endif
+
+int
+main(int argc, char **argv)
+{
+    guint i;
+
+    g_test_init(&argc, &argv, NULL);
+
+    for (i = 0; i < TEST_FILE_SIZE; i++) {
+        test_data[i] = (guint8)(i * 7 + i / 251);
+    }
+
+    g_test_add_func("/file_wrappers/random_truncate", file_wrappers_test_random_truncate);
+    g_test_add_func("/file_wrappers/sequential_truncate", file_wrappers_test_sequential_truncate);
+    g_test_add_func("/file_wrappers/random_grow", file_wrappers_test_random_grow);
+    g_test_add_func("/file_wrappers/sequential_skip", file_wrappers_test_sequential_skip);
+    if (g_test_perf()) {
+        g_test_add_func("/file_wrappers/bench", file_wrappers_test_bench);
+#ifdef HAVE_MMAP
+        g_test_add_func("/file_wrappers/bench_shm_ring", file_wrappers_test_bench_shm_ring);
+#endif
+    }
+
+    return g_test_run();
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
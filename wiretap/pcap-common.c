@@ -2335,6 +2335,28 @@ pcap_read_post_process(int file_type, int wtap_encap,
 	}
 }
 
+/*
+ * Returns TRUE if pcap_read_post_process() looks at, or changes, the
+ * packet data for the given encapsulation, so that it can't be called
+ * without reading the data.
+ */
+gboolean
+pcap_read_post_process_uses_data(int wtap_encap)
+{
+	switch (wtap_encap) {
+
+	case WTAP_ENCAP_ATM_PDUS:
+	case WTAP_ENCAP_SLL:
+	case WTAP_ENCAP_USB_LINUX:
+	case WTAP_ENCAP_USB_LINUX_MMAPPED:
+	case WTAP_ENCAP_NFLOG:
+		return TRUE;
+
+	default:
+		return FALSE;
+	}
+}
+
 gboolean
 wtap_encap_requires_phdr(int wtap_encap)
 {
@@ -1127,7 +1127,8 @@ static gboolean
 pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
                          const section_info_t *section_info,
                          wtapng_block_t *wblock,
-                         int *err, gchar **err_info, gboolean enhanced)
+                         int *err, gchar **err_info, gboolean enhanced,
+                         gboolean header_scan)
 {
     int bytes_read;
     guint block_read;
@@ -1321,6 +1322,30 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
     wblock->rec->ts.secs = (time_t)(ts / iface_info.time_units_per_second);
     wblock->rec->ts.nsecs = (int)(((ts % iface_info.time_units_per_second) * 1000000000) / iface_info.time_units_per_second);
 
+    /* Option defaults */
+    g_free(wblock->rec->opt_comment);   /* Free memory from an earlier read. */
+    wblock->rec->opt_comment = NULL;
+    wblock->rec->rec_header.packet_header.drop_count  = -1;
+    wblock->rec->rec_header.packet_header.pack_flags  = 0;
+
+    if (header_scan && !pcap_read_post_process_uses_data(iface_info.wtap_encap)) {
+        /*
+         * Only the metadata is wanted; seek past the packet data, its
+         * padding and the options, to the block trailer.
+         */
+        to_read = block_total_length -
+            (int)sizeof(pcapng_block_header_t) -
+            block_read -
+            (int)sizeof(bh->block_total_length);
+        if (file_seek(fh, to_read, SEEK_CUR, err) == -1)
+            return FALSE;
+        pcap_read_post_process(WTAP_FILE_TYPE_SUBTYPE_PCAPNG, iface_info.wtap_encap,
+                               wblock->rec, NULL, section_info->byte_swapped,
+                               iface_info.fcslen);
+        wblock->internal = FALSE;
+        return TRUE;
+    }
+
     /* "(Enhanced) Packet Block" read capture data */
     if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
                                 packet.cap_len - pseudo_header_len, err, err_info))
@@ -1334,12 +1359,6 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
         block_read += padding;
     }
 
-    /* Option defaults */
-    g_free(wblock->rec->opt_comment);   /* Free memory from an earlier read. */
-    wblock->rec->opt_comment = NULL;
-    wblock->rec->rec_header.packet_header.drop_count  = -1;
-    wblock->rec->rec_header.packet_header.pack_flags  = 0;
-
     /* FCS length default */
     fcslen = iface_info.fcslen;
 
@@ -2505,6 +2524,8 @@ pcapng_read_block(wtap *wth, FILE_T fh, pcapng_t *pn,
     block_return_val ret;
     pcapng_block_header_t bh;
     guint32 block_total_length;
+    /* Packet data can only be skipped when reading sequentially. */
+    gboolean header_scan = wth->header_scan && fh == wth->fh;
 
     wblock->block = NULL;
 
@@ -2610,7 +2631,7 @@ pcapng_read_block(wtap *wth, FILE_T fh, pcapng_t *pn,
                     return PCAPNG_BLOCK_ERROR;
                 break;
             case(BLOCK_TYPE_PB):
-                if (!pcapng_read_packet_block(fh, &bh, section_info, wblock, err, err_info, FALSE))
+                if (!pcapng_read_packet_block(fh, &bh, section_info, wblock, err, err_info, FALSE, header_scan))
                     return PCAPNG_BLOCK_ERROR;
                 break;
             case(BLOCK_TYPE_SPB):
@@ -2618,7 +2639,7 @@ pcapng_read_block(wtap *wth, FILE_T fh, pcapng_t *pn,
                     return PCAPNG_BLOCK_ERROR;
                 break;
             case(BLOCK_TYPE_EPB):
-                if (!pcapng_read_packet_block(fh, &bh, section_info, wblock, err, err_info, TRUE))
+                if (!pcapng_read_packet_block(fh, &bh, section_info, wblock, err, err_info, TRUE, header_scan))
                     return PCAPNG_BLOCK_ERROR;
                 break;
             case(BLOCK_TYPE_NRB):
@@ -70,6 +70,7 @@ struct wtap {
     wtap_new_ipv6_callback_t    add_new_ipv6;
     wtap_new_secrets_callback_t add_new_secrets;
     GPtrArray                   *fast_seek;
+    gboolean                    header_scan;            /**< TRUE if wtap_read() may skip packet data */
 };
 
 struct wtap_dumper;
@@ -1282,6 +1282,21 @@ wtap_cleareof(wtap *wth) {
 	file_clearerr(wth->fh);
 }
 
+void
+wtap_set_shm_ring(wtap *wth, shm_ring_t *ring) {
+	file_set_shm_ring(wth->fh, ring);
+}
+
+void
+wtap_set_cb_raw_data(wtap *wth, wtap_raw_data_callback_t raw_data_cb, void *user_data) {
+	file_set_raw_data_cb(wth->fh, raw_data_cb, user_data);
+}
+
+void
+wtap_set_header_scan(wtap *wth, gboolean header_scan) {
+	wth->header_scan = header_scan;
+}
+
 void wtap_set_cb_new_ipv4(wtap *wth, wtap_new_ipv4_callback_t add_new_ipv4) {
 	if (wth)
 		wth->add_new_ipv4 = add_new_ipv4;
@@ -14,6 +14,7 @@
 #include <wsutil/buffer.h>
 #include <wsutil/nstime.h>
 #include <wsutil/inet_addr.h>
+#include <wsutil/shm_ring.h>
 #include "wtap_opttypes.h"
 #include "ws_symbol_export.h"
 #include "ws_attributes.h"
@@ -1776,6 +1777,40 @@ struct wtap* wtap_open_offline(const char *filename, unsigned int type, int *err
 WS_DLL_PUBLIC
 void wtap_cleareof(wtap *wth);
 
+/**
+ * Copy data from a shared memory buffer, filled by the process that's
+ * writing the file, rather than reading it from the file when it's there.
+ * Only used for sequential reads of uncompressed files.
+ */
+WS_DLL_PUBLIC
+void wtap_set_shm_ring(wtap *wth, shm_ring_t *ring);
+
+/**
+ * Set a callback function that's handed the raw (possibly compressed)
+ * contents of the file as they're read from it, along with their offset
+ * in the file, so that the file can be e.g. hashed without being read a
+ * second time. Data that was read before the callback was set isn't
+ * handed to it; data that's read more than once, because of seeking, is
+ * handed to it more than once; data that's skipped with a seek isn't
+ * handed to it at all. If the whole file is memory-mapped, it's handed
+ * to the callback at once. Only for sequential reads.
+ */
+typedef void (*wtap_raw_data_callback_t)(gint64 offset, const guint8 *data, size_t len, void *user_data);
+WS_DLL_PUBLIC
+void wtap_set_cb_raw_data(wtap *wth, wtap_raw_data_callback_t raw_data_cb, void *user_data);
+
+/**
+ * Set whether wtap_read() is only to fill in the metadata of packet
+ * records - time stamps, lengths, encapsulation and interface ID - in
+ * which case it may seek past the packet data rather than reading it,
+ * leaving the contents of the Buffer unspecified, and may not fill in
+ * per-packet options such as comments, flags and drop counts. Only
+ * some file types can be read that way (currently pcapng); others are
+ * read in full. Doesn't affect wtap_seek_read().
+ */
+WS_DLL_PUBLIC
+void wtap_set_header_scan(wtap *wth, gboolean header_scan);
+
 /**
  * Set callback functions to add new hostnames. Currently pcapng-only.
  * MUST match add_ipv4_name and add_ipv6_name in addr_resolv.c.
@@ -0,0 +1,721 @@
+/* async_writer.c
+ * Writing capture files from a separate thread, in large blocks
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#if defined(HAVE_FOPENCOOKIE)
+#define _GNU_SOURCE /* Otherwise fopencookie() and O_DIRECT won't be defined on Linux */
+#endif
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/file_util.h>
+#include <ws_attributes.h>
+
+#include "async_writer.h"
+
+#if defined(HAVE_FOPENCOOKIE) || defined(HAVE_FUNOPEN)
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+ * Blocks are written at offsets that are multiples of the block size,
+ * which is a multiple of the page size, from buffers that are aligned
+ * on a page boundary, so full blocks can be written with O_DIRECT.
+ */
+typedef struct {
+    guint8 *mem;            /* what g_malloc() returned */
+    guint8 *data;           /* page-aligned start */
+    size_t len;             /* bytes in the block */
+    size_t skip;            /* bytes at the start already written by a flush */
+    gint64 offset;          /* offset of the block in the file */
+} aw_block;
+
+/* An open file; only the writer thread looks at it once it's queued. */
+typedef struct {
+    int fd;
+    int direct_fd;          /* -1 if not opened yet, -2 if it can't be */
+    char *path;
+} aw_file;
+
+typedef enum {
+    AW_WRITE_BLOCK,         /* write a block and put it back on the free list */
+    AW_WRITE_COPY,          /* write a copy of part of a block, and free it */
+    AW_CLOSE,
+    AW_UNLINK,
+    AW_CREATE_SPARE,
+    AW_BARRIER,
+    AW_STOP
+} aw_cmd_type;
+
+typedef struct {
+    aw_cmd_type type;
+    aw_file *file;
+    aw_block *block;
+    guint8 *data;
+    size_t len;
+    gint64 offset;
+    char *path;
+    int mode;
+} aw_cmd;
+
+struct _async_writer {
+    size_t block_size;
+    guint num_blocks;
+    aw_block *blocks;
+    GAsyncQueue *free_blocks;
+    GAsyncQueue *cmds;
+    GThread *thread;
+
+    /* Used only by the thread that writes to the stream. */
+    aw_file *file;          /* NULL if no stream is open */
+    aw_block *cur;          /* block being filled */
+    gint64 next_offset;     /* file offset of the next block */
+    guint64 barriers_sent;
+    guint64 stalls;
+
+    /* Shared; protected by mutex. */
+    GMutex mutex;
+    GCond cond;
+    int err;                /* first error, sticky */
+    guint64 barriers_done;
+    gboolean spare_pending;
+    int spare_fd;
+    int spare_err;
+    char *spare_path;
+    guint64 blocks_written;
+    guint64 direct_blocks;
+    guint64 bytes_written;
+};
+
+static size_t
+aw_page_size(void)
+{
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    return page_size > 0 ? (size_t)page_size : 4096;
+}
+
+static void
+aw_set_error(async_writer_t *writer, int err)
+{
+    g_mutex_lock(&writer->mutex);
+    if (writer->err == 0)
+        writer->err = err != 0 ? err : EIO;
+    g_mutex_unlock(&writer->mutex);
+}
+
+static int
+aw_get_error(async_writer_t *writer)
+{
+    int err;
+
+    g_mutex_lock(&writer->mutex);
+    err = writer->err;
+    g_mutex_unlock(&writer->mutex);
+    return err;
+}
+
+static void
+aw_queue_cmd(async_writer_t *writer, aw_cmd_type type, aw_file *file)
+{
+    aw_cmd *cmd = g_new0(aw_cmd, 1);
+
+    cmd->type = type;
+    cmd->file = file;
+    g_async_queue_push(writer->cmds, cmd);
+}
+
+/* Write all of data at offset, as pwrite() can write less than asked. */
+static gboolean
+aw_pwrite(int fd, const guint8 *data, size_t len, gint64 offset, int *err)
+{
+    ssize_t n;
+
+    while (len != 0) {
+        n = pwrite(fd, data, len, (off_t)offset);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            *err = errno;
+            return FALSE;
+        }
+        data += n;
+        len -= n;
+        offset += n;
+    }
+    return TRUE;
+}
+
+static void
+aw_write_block(async_writer_t *writer, aw_file *file, aw_block *block)
+{
+    gboolean direct = FALSE;
+    int err = 0;
+
+#ifdef O_DIRECT
+    if (block->len == writer->block_size && file->path != NULL) {
+        if (file->direct_fd == -1) {
+            file->direct_fd = ws_open(file->path, O_WRONLY|O_DIRECT, 0);
+            if (file->direct_fd == -1)
+                file->direct_fd = -2;
+        }
+        if (file->direct_fd >= 0) {
+            if (aw_pwrite(file->direct_fd, block->data, block->len,
+                          block->offset, &err)) {
+                direct = TRUE;
+            } else if (err == EINVAL) {
+                /* The file system doesn't do O_DIRECT after all. */
+                ws_close(file->direct_fd);
+                file->direct_fd = -2;
+                err = 0;
+            } else {
+                aw_set_error(writer, err);
+                return;
+            }
+        }
+    }
+#endif
+    if (!direct &&
+        !aw_pwrite(file->fd, block->data + block->skip,
+                   block->len - block->skip, block->offset + block->skip,
+                   &err)) {
+        aw_set_error(writer, err);
+        return;
+    }
+
+    g_mutex_lock(&writer->mutex);
+    if (block->len == writer->block_size)
+        writer->blocks_written++;
+    if (direct)
+        writer->direct_blocks++;
+    writer->bytes_written += block->len - block->skip;
+    g_mutex_unlock(&writer->mutex);
+}
+
+static void
+aw_close_file(async_writer_t *writer, aw_file *file)
+{
+    if (file->direct_fd >= 0)
+        ws_close(file->direct_fd);
+    if (ws_close(file->fd) == -1)
+        aw_set_error(writer, errno);
+    g_free(file->path);
+    g_free(file);
+}
+
+static void
+aw_create_spare(async_writer_t *writer, const char *path, int mode)
+{
+    int fd, err = 0;
+
+    /* It's removed first, as it may be left over from a crashed capture. */
+    ws_unlink(path);
+    fd = ws_open(path, O_RDWR|O_BINARY|O_TRUNC|O_CREAT, mode);
+    if (fd == -1)
+        err = errno;
+
+    g_mutex_lock(&writer->mutex);
+    writer->spare_fd = fd;
+    writer->spare_err = err;
+    writer->spare_pending = FALSE;
+    g_cond_broadcast(&writer->cond);
+    g_mutex_unlock(&writer->mutex);
+}
+
+static gpointer
+aw_thread(gpointer data)
+{
+    async_writer_t *writer = (async_writer_t *)data;
+    aw_cmd *cmd;
+    gboolean stop = FALSE;
+
+    while (!stop) {
+        cmd = (aw_cmd *)g_async_queue_pop(writer->cmds);
+
+        /* After an error, everything queued is thrown away, but files
+           are still closed and unlinked, and the blocks are reused. */
+        switch (cmd->type) {
+
+        case AW_WRITE_BLOCK:
+            if (aw_get_error(writer) == 0)
+                aw_write_block(writer, cmd->file, cmd->block);
+            g_async_queue_push(writer->free_blocks, cmd->block);
+            break;
+
+        case AW_WRITE_COPY:
+            if (aw_get_error(writer) == 0) {
+                int err = 0;
+
+                if (aw_pwrite(cmd->file->fd, cmd->data, cmd->len, cmd->offset, &err)) {
+                    g_mutex_lock(&writer->mutex);
+                    writer->bytes_written += cmd->len;
+                    g_mutex_unlock(&writer->mutex);
+                } else {
+                    aw_set_error(writer, err);
+                }
+            }
+            g_free(cmd->data);
+            break;
+
+        case AW_CLOSE:
+            aw_close_file(writer, cmd->file);
+            break;
+
+        case AW_UNLINK:
+            ws_unlink(cmd->path);
+            break;
+
+        case AW_CREATE_SPARE:
+            aw_create_spare(writer, cmd->path, cmd->mode);
+            break;
+
+        case AW_BARRIER:
+            g_mutex_lock(&writer->mutex);
+            writer->barriers_done++;
+            g_cond_broadcast(&writer->cond);
+            g_mutex_unlock(&writer->mutex);
+            break;
+
+        case AW_STOP:
+            stop = TRUE;
+            break;
+        }
+        g_free(cmd->path);
+        g_free(cmd);
+    }
+    return NULL;
+}
+
+/* Get a block to fill, waiting for the writer thread if there's none. */
+static aw_block *
+aw_get_block(async_writer_t *writer)
+{
+    aw_block *block;
+
+    block = (aw_block *)g_async_queue_try_pop(writer->free_blocks);
+    if (block == NULL) {
+        writer->stalls++;
+        block = (aw_block *)g_async_queue_pop(writer->free_blocks);
+    }
+    block->len = 0;
+    block->skip = 0;
+    block->offset = writer->next_offset;
+    writer->next_offset += writer->block_size;
+    return block;
+}
+
+static void
+aw_queue_block(async_writer_t *writer)
+{
+    aw_cmd *cmd = g_new0(aw_cmd, 1);
+
+    cmd->type = AW_WRITE_BLOCK;
+    cmd->file = writer->file;
+    cmd->block = writer->cur;
+    g_async_queue_push(writer->cmds, cmd);
+    writer->cur = NULL;
+}
+
+static gssize
+aw_stream_write(async_writer_t *writer, const char *buf, size_t size)
+{
+    size_t left = size, chunk;
+    int err;
+
+    err = aw_get_error(writer);
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+
+    while (left != 0) {
+        if (writer->cur == NULL)
+            writer->cur = aw_get_block(writer);
+        chunk = MIN(left, writer->block_size - writer->cur->len);
+        memcpy(writer->cur->data + writer->cur->len, buf, chunk);
+        writer->cur->len += chunk;
+        buf += chunk;
+        left -= chunk;
+        if (writer->cur->len == writer->block_size)
+            aw_queue_block(writer);
+    }
+    return (gssize)size;
+}
+
+static int
+aw_stream_close(async_writer_t *writer)
+{
+    int err;
+
+    if (writer->cur != NULL) {
+        if (writer->cur->len > writer->cur->skip) {
+            aw_queue_block(writer);
+        } else {
+            g_async_queue_push(writer->free_blocks, writer->cur);
+            writer->cur = NULL;
+        }
+    }
+    aw_queue_cmd(writer, AW_CLOSE, writer->file);
+    writer->file = NULL;
+
+    err = aw_get_error(writer);
+    if (err != 0) {
+        errno = err;
+        return EOF;
+    }
+    return 0;
+}
+
+#ifdef HAVE_FOPENCOOKIE
+static ssize_t
+aw_cookie_write(void *cookie, const char *buf, size_t size)
+{
+    gssize n = aw_stream_write((async_writer_t *)cookie, buf, size);
+
+    /* A cookie write function reports an error by returning 0. */
+    return n < 0 ? 0 : (ssize_t)n;
+}
+
+static int
+aw_cookie_close(void *cookie)
+{
+    return aw_stream_close((async_writer_t *)cookie);
+}
+#else
+static int
+aw_cookie_write(void *cookie, const char *buf, int size)
+{
+    return (int)aw_stream_write((async_writer_t *)cookie, buf, (size_t)size);
+}
+
+static int
+aw_cookie_close(void *cookie)
+{
+    return aw_stream_close((async_writer_t *)cookie);
+}
+#endif
+
+gboolean
+async_writer_is_supported(void)
+{
+    return TRUE;
+}
+
+async_writer_t *
+async_writer_new(size_t block_size, guint num_blocks)
+{
+    async_writer_t *writer;
+    size_t page_size = aw_page_size();
+    guint i;
+
+    if (block_size < page_size)
+        block_size = page_size;
+    block_size = (block_size + page_size - 1) & ~(page_size - 1);
+    if (num_blocks < 2)
+        num_blocks = 2;
+
+    writer = g_new0(async_writer_t, 1);
+    writer->block_size = block_size;
+    writer->num_blocks = num_blocks;
+    writer->blocks = g_new0(aw_block, num_blocks);
+    writer->free_blocks = g_async_queue_new();
+    writer->cmds = g_async_queue_new();
+    for (i = 0; i < num_blocks; i++) {
+        aw_block *block = &writer->blocks[i];
+
+        block->mem = (guint8 *)g_malloc(block_size + page_size);
+        block->data = (guint8 *)(((guintptr)block->mem + page_size - 1) & ~(guintptr)(page_size - 1));
+        g_async_queue_push(writer->free_blocks, block);
+    }
+    g_mutex_init(&writer->mutex);
+    g_cond_init(&writer->cond);
+    writer->spare_fd = -1;
+    writer->thread = g_thread_new("Async writer", aw_thread, writer);
+    return writer;
+}
+
+FILE *
+async_writer_fdopen(async_writer_t *writer, int fd, const char *path, int *err)
+{
+    FILE *stream;
+#ifdef HAVE_FOPENCOOKIE
+    cookie_io_functions_t funcs = { NULL, aw_cookie_write, NULL, aw_cookie_close };
+#endif
+
+    if (writer->file != NULL) {
+        *err = EBUSY;
+        return NULL;
+    }
+    *err = aw_get_error(writer);
+    if (*err != 0)
+        return NULL;
+
+#ifdef HAVE_FOPENCOOKIE
+    stream = fopencookie(writer, "wb", funcs);
+#else
+    stream = funopen(writer, NULL, aw_cookie_write, NULL, aw_cookie_close);
+#endif
+    if (stream == NULL) {
+        *err = errno;
+        return NULL;
+    }
+    /* We do our own buffering. */
+    setvbuf(stream, NULL, _IONBF, 0);
+
+    writer->file = g_new0(aw_file, 1);
+    writer->file->fd = fd;
+    writer->file->direct_fd = -1;
+    writer->file->path = g_strdup(path);
+    writer->next_offset = 0;
+    return stream;
+}
+
+gboolean
+async_writer_flush(async_writer_t *writer, gboolean wait, int *err)
+{
+    aw_block *block = writer->cur;
+
+    if (block != NULL && block->len > block->skip) {
+        aw_cmd *cmd = g_new0(aw_cmd, 1);
+
+        /* The block itself is still being filled, so write a copy of
+           what's new in it; the whole block is written again once it's
+           full, so that its write is still aligned. */
+        cmd->type = AW_WRITE_COPY;
+        cmd->file = writer->file;
+        cmd->len = block->len - block->skip;
+        cmd->data = (guint8 *)g_memdup(block->data + block->skip, (guint)cmd->len);
+        cmd->offset = block->offset + block->skip;
+        g_async_queue_push(writer->cmds, cmd);
+        block->skip = block->len;
+    }
+
+    if (wait) {
+        guint64 barrier = ++writer->barriers_sent;
+
+        aw_queue_cmd(writer, AW_BARRIER, NULL);
+        g_mutex_lock(&writer->mutex);
+        while (writer->barriers_done < barrier)
+            g_cond_wait(&writer->cond, &writer->mutex);
+        g_mutex_unlock(&writer->mutex);
+    }
+
+    *err = aw_get_error(writer);
+    return *err == 0;
+}
+
+void
+async_writer_unlink(async_writer_t *writer, const char *path)
+{
+    aw_cmd *cmd = g_new0(aw_cmd, 1);
+
+    cmd->type = AW_UNLINK;
+    cmd->path = g_strdup(path);
+    g_async_queue_push(writer->cmds, cmd);
+}
+
+void
+async_writer_create_spare(async_writer_t *writer, const char *path, int mode)
+{
+    aw_cmd *cmd;
+
+    async_writer_drop_spare(writer);
+
+    cmd = g_new0(aw_cmd, 1);
+    cmd->type = AW_CREATE_SPARE;
+    cmd->path = g_strdup(path);
+    cmd->mode = mode;
+    g_mutex_lock(&writer->mutex);
+    writer->spare_pending = TRUE;
+    writer->spare_path = g_strdup(path);
+    g_mutex_unlock(&writer->mutex);
+    g_async_queue_push(writer->cmds, cmd);
+}
+
+/* Wait for the spare file to be created, and take it from the writer. */
+static int
+aw_claim_spare(async_writer_t *writer, char **path, int *err)
+{
+    int fd;
+
+    g_mutex_lock(&writer->mutex);
+    while (writer->spare_pending)
+        g_cond_wait(&writer->cond, &writer->mutex);
+    fd = writer->spare_fd;
+    *err = writer->spare_err;
+    *path = writer->spare_path;
+    writer->spare_fd = -1;
+    writer->spare_err = 0;
+    writer->spare_path = NULL;
+    g_mutex_unlock(&writer->mutex);
+    return fd;
+}
+
+int
+async_writer_take_spare(async_writer_t *writer, const char *path, int *err)
+{
+    char *spare_path;
+    int fd;
+
+    fd = aw_claim_spare(writer, &spare_path, err);
+    if (spare_path == NULL) {
+        *err = ENOENT;
+        return -1;
+    }
+    if (fd != -1 && ws_rename(spare_path, path) == -1) {
+        *err = errno;
+        ws_close(fd);
+        ws_unlink(spare_path);
+        fd = -1;
+    }
+    g_free(spare_path);
+    return fd;
+}
+
+void
+async_writer_drop_spare(async_writer_t *writer)
+{
+    char *spare_path;
+    int fd, err;
+
+    fd = aw_claim_spare(writer, &spare_path, &err);
+    if (fd != -1) {
+        ws_close(fd);
+        ws_unlink(spare_path);
+    }
+    g_free(spare_path);
+}
+
+void
+async_writer_get_stats(async_writer_t *writer, async_writer_stats_t *stats)
+{
+    g_mutex_lock(&writer->mutex);
+    stats->blocks = writer->blocks_written;
+    stats->direct_blocks = writer->direct_blocks;
+    stats->bytes = writer->bytes_written;
+    g_mutex_unlock(&writer->mutex);
+    stats->stalls = writer->stalls;
+}
+
+gboolean
+async_writer_free(async_writer_t *writer, int *err)
+{
+    guint i;
+
+    if (writer == NULL) {
+        *err = 0;
+        return TRUE;
+    }
+
+    async_writer_drop_spare(writer);
+    aw_queue_cmd(writer, AW_STOP, NULL);
+    g_thread_join(writer->thread);
+
+    *err = writer->err;
+
+    /* Everything else was handled before the thread stopped. */
+    g_async_queue_unref(writer->cmds);
+    g_async_queue_unref(writer->free_blocks);
+    for (i = 0; i < writer->num_blocks; i++)
+        g_free(writer->blocks[i].mem);
+    g_free(writer->blocks);
+    g_mutex_clear(&writer->mutex);
+    g_cond_clear(&writer->cond);
+    g_free(writer);
+    return *err == 0;
+}
+
+#else /* HAVE_FOPENCOOKIE || HAVE_FUNOPEN */
+
+gboolean
+async_writer_is_supported(void)
+{
+    return FALSE;
+}
+
+async_writer_t *
+async_writer_new(size_t block_size _U_, guint num_blocks _U_)
+{
+    return NULL;
+}
+
+FILE *
+async_writer_fdopen(async_writer_t *writer _U_, int fd _U_,
+                    const char *path _U_, int *err)
+{
+    *err = ENOTSUP;
+    return NULL;
+}
+
+gboolean
+async_writer_flush(async_writer_t *writer _U_, gboolean wait _U_, int *err)
+{
+    *err = 0;
+    return TRUE;
+}
+
+void
+async_writer_unlink(async_writer_t *writer _U_, const char *path)
+{
+    ws_unlink(path);
+}
+
+void
+async_writer_create_spare(async_writer_t *writer _U_, const char *path _U_,
+                          int mode _U_)
+{
+}
+
+int
+async_writer_take_spare(async_writer_t *writer _U_, const char *path _U_,
+                        int *err)
+{
+    *err = ENOTSUP;
+    return -1;
+}
+
+void
+async_writer_drop_spare(async_writer_t *writer _U_)
+{
+}
+
+void
+async_writer_get_stats(async_writer_t *writer _U_, async_writer_stats_t *stats)
+{
+    memset(stats, 0, sizeof *stats);
+}
+
+gboolean
+async_writer_free(async_writer_t *writer _U_, int *err)
+{
+    *err = 0;
+    return TRUE;
+}
+
+#endif /* HAVE_FOPENCOOKIE || HAVE_FUNOPEN */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
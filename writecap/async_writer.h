@@ -0,0 +1,122 @@
+/* async_writer.h
+ * Writing capture files from a separate thread, in large blocks
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __ASYNC_WRITER_H__
+#define __ASYNC_WRITER_H__
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * An async writer hands what's written to a capture file over to a thread
+ * of its own, so that the thread that's capturing doesn't wait for the
+ * disk.
+ *
+ * Files are written through a FILE * that copies everything into one of
+ * a fixed number of page-aligned blocks; full blocks are queued for the
+ * writer thread, which writes them with O_DIRECT where that's available.
+ * If all the blocks are queued, writing to the FILE * waits for the
+ * writer thread to finish with one of them.
+ *
+ * Closing the FILE * only queues the rest of the data and the close of
+ * the file descriptor, so an error from writing or closing a file may
+ * be reported by a later call on the same writer, which then keeps
+ * failing with that error.
+ */
+
+typedef struct _async_writer async_writer_t;
+
+typedef struct {
+    guint64 blocks;         /* full blocks written */
+    guint64 direct_blocks;  /* ... of which with O_DIRECT */
+    guint64 bytes;          /* bytes written, including flushes */
+    guint64 stalls;         /* times a write waited for a free block */
+} async_writer_stats_t;
+
+/* TRUE if this platform can write through an async writer. */
+extern gboolean async_writer_is_supported(void);
+
+/*
+ * Start a writer thread with num_blocks blocks of block_size bytes;
+ * block_size is rounded up to a multiple of the page size.
+ */
+extern async_writer_t *async_writer_new(size_t block_size, guint num_blocks);
+
+/*
+ * Open an unbuffered stream that writes to fd, which must be a newly
+ * opened, empty file, through the writer. path is used to open the file
+ * again for O_DIRECT writes; it may be NULL.
+ *
+ * Only one stream can be open at a time. Closing it also closes fd.
+ */
+extern FILE *async_writer_fdopen(async_writer_t *writer, int fd,
+                                 const char *path, int *err);
+
+/*
+ * Queue what has been written to the open stream since the last flush.
+ * If wait is TRUE, also wait until the writer thread is done with
+ * everything queued so far, so that, for instance, other processes can
+ * read it and any file closed before is closed.
+ */
+extern gboolean async_writer_flush(async_writer_t *writer, gboolean wait,
+                                   int *err);
+
+/* Have the writer thread remove a file. */
+extern void async_writer_unlink(async_writer_t *writer, const char *path);
+
+/*
+ * Have the writer thread create an empty file, with the given mode, to
+ * be handed out by the next async_writer_take_spare() call.
+ */
+extern void async_writer_create_spare(async_writer_t *writer,
+                                      const char *path, int mode);
+
+/*
+ * Rename the spare file to path and return a descriptor for it, or -1,
+ * with *err set, if there is none or it couldn't be created or renamed.
+ */
+extern int async_writer_take_spare(async_writer_t *writer, const char *path,
+                                   int *err);
+
+/* Close and remove the spare file, if there is one. */
+extern void async_writer_drop_spare(async_writer_t *writer);
+
+extern void async_writer_get_stats(async_writer_t *writer,
+                                   async_writer_stats_t *stats);
+
+/*
+ * Wait for everything queued to be written, and stop the writer thread.
+ * Returns FALSE, with *err set, if anything couldn't be written.
+ */
+extern gboolean async_writer_free(async_writer_t *writer, int *err);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __ASYNC_WRITER_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
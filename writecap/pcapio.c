@@ -167,6 +167,19 @@ struct option {
 #define ISB_USRDELIV      8
 #define ADD_PADDING(x) ((((x) + 3) >> 2) << 2)
 
+/* File whose contents are also passed to tee_func, if any */
+static FILE *tee_file;
+static pcapio_tee_func tee_func;
+static void *tee_data;
+
+void
+pcapio_set_tee(FILE* pfile, pcapio_tee_func func, void *user_data)
+{
+        tee_file = pfile;
+        tee_func = func;
+        tee_data = user_data;
+}
+
 /* Write to capture file */
 static gboolean
 write_to_file(FILE* pfile, const guint8* data, size_t data_length,
@@ -184,6 +197,9 @@ write_to_file(FILE* pfile, const guint8* data, size_t data_length,
                 return FALSE;
         }
 
+        if (pfile == tee_file && tee_func != NULL)
+                tee_func(data, data_length, tee_data);
+
         (*bytes_written) += data_length;
         return TRUE;
 }
@@ -11,6 +11,14 @@
  * SPDX-License-Identifier: GPL-2.0-or-later
  */
 
+/** Called with everything that's successfully written to a file. */
+typedef void (*pcapio_tee_func)(const guint8 *data, size_t data_length, void *user_data);
+
+/** Pass everything subsequently written to pfile to func as well.
+   Only one file can be teed at a time; a NULL func stops it. */
+extern void
+pcapio_set_tee(FILE* pfile, pcapio_tee_func func, void *user_data);
+
 /* Writing pcap files */
 
 /** Write the file header to a dump file.
@@ -0,0 +1,398 @@
+/* shm_ring.c
+ * Shared memory copy of the most recent part of a byte stream
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "shm_ring.h"
+#include "ws_attributes.h"
+
+#ifdef HAVE_MMAP
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <wsutil/file_util.h>
+
+#define SHM_RING_MAGIC   0x57534852 /* "WSHR" */
+#define SHM_RING_VERSION 2
+
+/*
+ * The values that only the producer changes. All offsets are offsets in
+ * the stream. The producer sets "reserved" to the end of what it's about
+ * to write before overwriting anything, and "committed" to the end of
+ * what it has written once it's done, so a consumer that has copied bytes
+ * starting at offset knows they're intact if offset >= reserved - size
+ * afterwards.
+ */
+typedef struct {
+    guint64 reserved;
+    guint64 committed;
+    guint64 overrun;
+} shm_ring_producer_t;
+
+/*
+ * The start of the shared file.
+ *
+ * Each side's values are guarded by a sequence number that it makes odd
+ * while it changes them; see shm_ring_snapshot(). That way the other side
+ * gets consistent 64-bit values even where those can't be read or written
+ * atomically.
+ */
+typedef struct {
+    gint magic;
+    guint32 version;
+    guint64 size;       /* bytes of stream data after the header */
+    gint producer_seq;
+    guint32 pad1;
+    shm_ring_producer_t producer;
+    gint consumer_seq;
+    guint32 pad2;
+    guint64 consumed;   /* written by the consumer */
+    guint64 pad[2];
+} shm_ring_header_t;
+
+/* How often to try to get a consistent copy of the other side's values
+   before giving up. Changing them takes a few instructions, so this only
+   runs out if the other side died in the middle of doing that. */
+#define SHM_RING_SNAPSHOT_TRIES 1000
+
+struct _shm_ring_t {
+    shm_ring_header_t *hdr;
+    guint8 *data;
+    size_t map_size;
+    guint64 size;
+    guint64 head;       /* producer: end of what's been written */
+    guint64 consumed;   /* producer: last value of hdr->consumed seen */
+    guint64 ring_read;  /* consumer */
+    guint64 file_read;  /* consumer */
+};
+
+/*
+ * Copy len bytes of the other side's values, guarded by seq, to copy.
+ * Every g_atomic_int_* call is a full memory barrier, so if seq is even
+ * and the same before and after the copy, nothing was changed while we
+ * were copying.
+ */
+static gboolean
+shm_ring_snapshot(gint *seq, const void *values, void *copy, size_t len)
+{
+    gint before;
+    int tries;
+
+    for (tries = 0; tries < SHM_RING_SNAPSHOT_TRIES; tries++) {
+        before = g_atomic_int_get(seq);
+        if (before & 1)
+            continue;
+        memcpy(copy, values, len);
+        if (g_atomic_int_get(seq) == before)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static shm_ring_t *
+shm_ring_map(int fd, size_t map_size, int *err)
+{
+    shm_ring_t *ring;
+    void *map;
+
+    map = mmap(NULL, map_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        *err = errno;
+        return NULL;
+    }
+
+    ring = g_new0(shm_ring_t, 1);
+    ring->hdr = (shm_ring_header_t *)map;
+    ring->data = (guint8 *)map + sizeof(shm_ring_header_t);
+    ring->map_size = map_size;
+    return ring;
+}
+
+shm_ring_t *
+shm_ring_create(const char *path, size_t size, int *err)
+{
+    shm_ring_t *ring;
+    size_t map_size = sizeof(shm_ring_header_t) + size;
+    int fd;
+
+    if (size == 0 || map_size < size) {
+        *err = EINVAL;
+        return NULL;
+    }
+
+    fd = ws_open(path, O_RDWR|O_CREAT|O_TRUNC, 0600);
+    if (fd == -1) {
+        *err = errno;
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)map_size) == -1) {
+        *err = errno;
+        ws_close(fd);
+        return NULL;
+    }
+
+    ring = shm_ring_map(fd, map_size, err);
+    ws_close(fd);
+    if (ring == NULL)
+        return NULL;
+
+    /* The file is new, so everything else is already zero. */
+    ring->size = size;
+    ring->hdr->size = size;
+    ring->hdr->version = SHM_RING_VERSION;
+    g_atomic_int_set(&ring->hdr->magic, SHM_RING_MAGIC);
+    return ring;
+}
+
+shm_ring_t *
+shm_ring_open(const char *path, int *err)
+{
+    shm_ring_t *ring;
+    ws_statb64 st;
+    int fd;
+
+    fd = ws_open(path, O_RDWR, 0000);
+    if (fd == -1) {
+        *err = errno;
+        return NULL;
+    }
+    if (ws_fstat64(fd, &st) == -1) {
+        *err = errno;
+        ws_close(fd);
+        return NULL;
+    }
+    if (st.st_size <= (gint64)sizeof(shm_ring_header_t) ||
+        (guint64)st.st_size > G_MAXSIZE) {
+        *err = EINVAL;
+        ws_close(fd);
+        return NULL;
+    }
+
+    ring = shm_ring_map(fd, (size_t)st.st_size, err);
+    ws_close(fd);
+    if (ring == NULL)
+        return NULL;
+
+    if (g_atomic_int_get(&ring->hdr->magic) != SHM_RING_MAGIC ||
+        ring->hdr->version != SHM_RING_VERSION ||
+        ring->hdr->size != ring->map_size - sizeof(shm_ring_header_t)) {
+        shm_ring_close(ring);
+        *err = EINVAL;
+        return NULL;
+    }
+    ring->size = ring->hdr->size;
+    /* We're the only producer, so nothing's changing these. */
+    ring->head = ring->hdr->producer.reserved;
+    ring->consumed = ring->hdr->consumed;
+    return ring;
+}
+
+void
+shm_ring_close(shm_ring_t *ring)
+{
+    if (ring == NULL)
+        return;
+    munmap(ring->hdr, ring->map_size);
+    g_free(ring);
+}
+
+void
+shm_ring_write(shm_ring_t *ring, const void *data, size_t len)
+{
+    shm_ring_header_t *hdr = ring->hdr;
+    const guint8 *src = (const guint8 *)data;
+    guint64 old_head = ring->head;
+    guint64 new_head, lost_from, lost_to, overrun = 0;
+    size_t pos, chunk;
+
+    if (len == 0)
+        return;
+
+    /* Only the last "size" bytes can end up in the ring. */
+    if (len > ring->size) {
+        src += len - ring->size;
+        ring->head += len - ring->size;
+        len = (size_t)ring->size;
+    }
+    new_head = ring->head + len;
+
+    /* Count the bytes that we're about to overwrite that the consumer
+       hasn't read yet. If we can't tell how far it's got, go by what it
+       last told us. */
+    if (new_head > ring->size) {
+        shm_ring_snapshot(&hdr->consumer_seq, &hdr->consumed,
+                          &ring->consumed, sizeof ring->consumed);
+        lost_to = new_head - ring->size;
+        lost_from = old_head > ring->size ? old_head - ring->size : 0;
+        if (ring->consumed > lost_from)
+            lost_from = ring->consumed;
+        if (lost_to > lost_from)
+            overrun = lost_to - lost_from;
+    }
+
+    /* The barrier in the second increment also keeps the new "reserved"
+       ahead of the bytes that overwrite the old ones. */
+    g_atomic_int_inc(&hdr->producer_seq);
+    hdr->producer.reserved = new_head;
+    hdr->producer.overrun += overrun;
+    g_atomic_int_inc(&hdr->producer_seq);
+
+    pos = (size_t)(ring->head % ring->size);
+    chunk = MIN(len, (size_t)ring->size - pos);
+    memcpy(ring->data + pos, src, chunk);
+    memcpy(ring->data, src + chunk, len - chunk);
+
+    ring->head = new_head;
+}
+
+void
+shm_ring_commit(shm_ring_t *ring)
+{
+    shm_ring_header_t *hdr = ring->hdr;
+
+    g_atomic_int_inc(&hdr->producer_seq);
+    hdr->producer.committed = ring->head;
+    g_atomic_int_inc(&hdr->producer_seq);
+}
+
+gssize
+shm_ring_read(shm_ring_t *ring, guint64 offset, void *buf, size_t len)
+{
+    shm_ring_header_t *hdr = ring->hdr;
+    shm_ring_producer_t producer;
+    size_t pos, chunk;
+
+    if (!shm_ring_snapshot(&hdr->producer_seq, &hdr->producer,
+                           &producer, sizeof producer))
+        return -1;
+    if (offset >= producer.committed)
+        return 0;
+    if (producer.committed - offset < len)
+        len = (size_t)(producer.committed - offset);
+    if (len > G_MAXSSIZE)
+        len = G_MAXSSIZE;
+    if (producer.reserved > ring->size &&
+        offset < producer.reserved - ring->size)
+        return -1;
+
+    pos = (size_t)(offset % ring->size);
+    chunk = MIN(len, (size_t)ring->size - pos);
+    memcpy(buf, ring->data + pos, chunk);
+    memcpy((guint8 *)buf + chunk, ring->data, len - chunk);
+
+    /* Make sure the producer didn't start overwriting what we copied
+       while we were copying it. */
+    if (!shm_ring_snapshot(&hdr->producer_seq, &hdr->producer,
+                           &producer, sizeof producer))
+        return -1;
+    if (producer.reserved > ring->size &&
+        offset < producer.reserved - ring->size)
+        return -1;
+
+    g_atomic_int_inc(&hdr->consumer_seq);
+    hdr->consumed = offset + len;
+    g_atomic_int_inc(&hdr->consumer_seq);
+    ring->ring_read += len;
+    return (gssize)len;
+}
+
+void
+shm_ring_count_file_read(shm_ring_t *ring, size_t len)
+{
+    ring->file_read += len;
+}
+
+void
+shm_ring_get_stats(shm_ring_t *ring, shm_ring_stats_t *stats)
+{
+    shm_ring_producer_t producer;
+
+    if (shm_ring_snapshot(&ring->hdr->producer_seq, &ring->hdr->producer,
+                          &producer, sizeof producer)) {
+        stats->committed = producer.committed;
+        stats->overrun = producer.overrun;
+    } else {
+        stats->committed = 0;
+        stats->overrun = 0;
+    }
+    stats->ring_read = ring->ring_read;
+    stats->file_read = ring->file_read;
+}
+
+#else /* HAVE_MMAP */
+
+shm_ring_t *
+shm_ring_create(const char *path _U_, size_t size _U_, int *err)
+{
+    *err = ENOTSUP;
+    return NULL;
+}
+
+shm_ring_t *
+shm_ring_open(const char *path _U_, int *err)
+{
+    *err = ENOTSUP;
+    return NULL;
+}
+
+void
+shm_ring_close(shm_ring_t *ring _U_)
+{
+}
+
+void
+shm_ring_write(shm_ring_t *ring _U_, const void *data _U_, size_t len _U_)
+{
+}
+
+void
+shm_ring_commit(shm_ring_t *ring _U_)
+{
+}
+
+gssize
+shm_ring_read(shm_ring_t *ring _U_, guint64 offset _U_, void *buf _U_, size_t len _U_)
+{
+    return -1;
+}
+
+void
+shm_ring_count_file_read(shm_ring_t *ring _U_, size_t len _U_)
+{
+}
+
+void
+shm_ring_get_stats(shm_ring_t *ring _U_, shm_ring_stats_t *stats)
+{
+    memset(stats, 0, sizeof *stats);
+}
+
+#endif /* HAVE_MMAP */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local Variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * ex: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
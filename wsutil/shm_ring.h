@@ -0,0 +1,117 @@
+/* shm_ring.h
+ * Shared memory copy of the most recent part of a byte stream
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __SHM_RING_H__
+#define __SHM_RING_H__
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @file
+ * A ring of shared memory that holds the last bytes written to a file.
+ *
+ * The producer (dumpcap) appends everything it writes to a capture file
+ * to the ring as well, and the consumer (TShark), which reads the same
+ * file, takes the bytes from the ring rather than reading them back from
+ * the file while they're still there. Offsets in the ring are offsets in
+ * the file.
+ *
+ * The producer never waits for the consumer. If the consumer falls more
+ * than the size of the ring behind, the bytes it hasn't read yet are
+ * overwritten and it has to read them from the file; both sides count how
+ * often that happens.
+ *
+ * The ring is a memory-mapped file, so it's only available on platforms
+ * with mmap().
+ */
+
+typedef struct _shm_ring_t shm_ring_t;
+
+typedef struct {
+    guint64 committed;  /**< Bytes the producer has made available */
+    guint64 overrun;    /**< Bytes overwritten before the consumer read them */
+    guint64 ring_read;  /**< Bytes the consumer read from the ring */
+    guint64 file_read;  /**< Bytes the consumer had to read from the file */
+} shm_ring_stats_t;
+
+/**
+ * Create a ring in a new file. This is done by the consumer, which passes
+ * the path to the producer.
+ *
+ * @param path The file to create.
+ * @param size The number of bytes of the stream to keep.
+ * @param err Set to an errno value on failure.
+ * @return The ring, or NULL on failure.
+ */
+WS_DLL_PUBLIC shm_ring_t *shm_ring_create(const char *path, size_t size, int *err);
+
+/**
+ * Attach to a ring that was created with shm_ring_create.
+ *
+ * @param path The file holding the ring.
+ * @param err Set to an errno value on failure.
+ * @return The ring, or NULL on failure.
+ */
+WS_DLL_PUBLIC shm_ring_t *shm_ring_open(const char *path, int *err);
+
+/** Unmap the ring. This doesn't remove the file. */
+WS_DLL_PUBLIC void shm_ring_close(shm_ring_t *ring);
+
+/**
+ * Append bytes to the ring (producer). They aren't visible to the
+ * consumer until shm_ring_commit is called.
+ */
+WS_DLL_PUBLIC void shm_ring_write(shm_ring_t *ring, const void *data, size_t len);
+
+/**
+ * Make everything written so far visible to the consumer (producer).
+ * This should be done whenever the same data is flushed to the file.
+ */
+WS_DLL_PUBLIC void shm_ring_commit(shm_ring_t *ring);
+
+/**
+ * Copy up to len bytes of the stream, starting at offset, out of the ring
+ * (consumer).
+ *
+ * @return The number of bytes copied; 0 if nothing at or after offset
+ * has been committed yet; -1 if the bytes at offset have been overwritten.
+ * In the last two cases the caller should read the file instead.
+ */
+WS_DLL_PUBLIC gssize shm_ring_read(shm_ring_t *ring, guint64 offset, void *buf, size_t len);
+
+/** Record that the consumer read len bytes from the file instead. */
+WS_DLL_PUBLIC void shm_ring_count_file_read(shm_ring_t *ring, size_t len);
+
+/** Get the ring's counters. */
+WS_DLL_PUBLIC void shm_ring_get_stats(shm_ring_t *ring, shm_ring_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __SHM_RING_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local Variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * ex: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,311 @@
+/* shm_ring_test.c
+ * Tests of the shared memory ring
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <wsutil/file_util.h>
+
+#include "shm_ring.h"
+
+#define RING_SIZE 64
+
+/* The byte at each offset in the stream. */
+static guint8
+stream_byte(guint64 offset)
+{
+    return (guint8)(offset * 7 + offset / 251);
+}
+
+static void
+write_stream(shm_ring_t *ring, guint64 offset, size_t len)
+{
+    guint8 buf[1024];
+    size_t i;
+
+    g_assert(len <= sizeof buf);
+    for (i = 0; i < len; i++)
+        buf[i] = stream_byte(offset + i);
+    shm_ring_write(ring, buf, len);
+}
+
+static void
+check_stream(const guint8 *buf, guint64 offset, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++)
+        g_assert_cmpuint(buf[i], ==, stream_byte(offset + i));
+}
+
+/* The producer and consumer each have their own mapping of the file, as
+   they would in dumpcap and TShark. */
+static char *
+open_rings(shm_ring_t **consumer, shm_ring_t **producer)
+{
+    char *path;
+    int fd;
+    int err = 0;
+
+    fd = g_file_open_tmp("shm_ring_test_XXXXXX", &path, NULL);
+    g_assert(fd != -1);
+    ws_close(fd);
+
+    *consumer = shm_ring_create(path, RING_SIZE, &err);
+    g_assert_nonnull(*consumer);
+    *producer = shm_ring_open(path, &err);
+    g_assert_nonnull(*producer);
+    g_assert_cmpint(err, ==, 0);
+    return path;
+}
+
+static void
+close_rings(char *path, shm_ring_t *consumer, shm_ring_t *producer)
+{
+    shm_ring_close(producer);
+    shm_ring_close(consumer);
+    g_unlink(path);
+    g_free(path);
+}
+
+static void
+shm_ring_test_commit(void)
+{
+    shm_ring_t *consumer, *producer;
+    char *path = open_rings(&consumer, &producer);
+    shm_ring_stats_t stats;
+    guint8 buf[RING_SIZE];
+
+    g_assert_cmpint(shm_ring_read(consumer, 0, buf, sizeof buf), ==, 0);
+
+    /* Nothing's visible until it's committed. */
+    write_stream(producer, 0, 20);
+    g_assert_cmpint(shm_ring_read(consumer, 0, buf, sizeof buf), ==, 0);
+    shm_ring_commit(producer);
+    g_assert_cmpint(shm_ring_read(consumer, 0, buf, sizeof buf), ==, 20);
+    check_stream(buf, 0, 20);
+
+    g_assert_cmpint(shm_ring_read(consumer, 20, buf, sizeof buf), ==, 0);
+    g_assert_cmpint(shm_ring_read(consumer, 5, buf, 10), ==, 10);
+    check_stream(buf, 5, 10);
+
+    shm_ring_count_file_read(consumer, 3);
+    shm_ring_get_stats(consumer, &stats);
+    g_assert_cmpuint(stats.committed, ==, 20);
+    g_assert_cmpuint(stats.overrun, ==, 0);
+    g_assert_cmpuint(stats.ring_read, ==, 30);
+    g_assert_cmpuint(stats.file_read, ==, 3);
+
+    close_rings(path, consumer, producer);
+}
+
+static void
+shm_ring_test_wrap(void)
+{
+    shm_ring_t *consumer, *producer;
+    char *path = open_rings(&consumer, &producer);
+    shm_ring_stats_t stats;
+    guint8 buf[RING_SIZE];
+    guint64 offset;
+
+    /* Read each write as it's committed, with the writes crossing the
+       end of the ring at different places. */
+    for (offset = 0; offset < 10 * RING_SIZE; offset += 23) {
+        write_stream(producer, offset, 23);
+        shm_ring_commit(producer);
+        g_assert_cmpint(shm_ring_read(consumer, offset, buf, sizeof buf), ==, 23);
+        check_stream(buf, offset, 23);
+    }
+
+    /* A read that crosses the end of the ring. */
+    g_assert_cmpint(shm_ring_read(consumer, offset - RING_SIZE, buf, sizeof buf), ==, RING_SIZE);
+    check_stream(buf, offset - RING_SIZE, RING_SIZE);
+
+    shm_ring_get_stats(consumer, &stats);
+    g_assert_cmpuint(stats.committed, ==, offset);
+    g_assert_cmpuint(stats.overrun, ==, 0);
+
+    close_rings(path, consumer, producer);
+}
+
+/* The consumer is behind, but by less than the size of the ring. */
+static void
+shm_ring_test_reader_lagging(void)
+{
+    shm_ring_t *consumer, *producer;
+    char *path = open_rings(&consumer, &producer);
+    shm_ring_stats_t stats;
+    guint8 buf[RING_SIZE];
+
+    write_stream(producer, 0, 50);
+    shm_ring_commit(producer);
+    g_assert_cmpint(shm_ring_read(consumer, 0, buf, 30), ==, 30);
+    check_stream(buf, 0, 30);
+
+    /* Overwrites only bytes that have already been read. */
+    write_stream(producer, 50, 40);
+    shm_ring_commit(producer);
+    g_assert_cmpint(shm_ring_read(consumer, 30, buf, sizeof buf), ==, 60);
+    check_stream(buf, 30, 60);
+
+    shm_ring_get_stats(consumer, &stats);
+    g_assert_cmpuint(stats.overrun, ==, 0);
+
+    close_rings(path, consumer, producer);
+}
+
+/* The consumer is more than the size of the ring behind. */
+static void
+shm_ring_test_writer_overrun(void)
+{
+    shm_ring_t *consumer, *producer;
+    char *path = open_rings(&consumer, &producer);
+    shm_ring_stats_t stats;
+    guint8 buf[RING_SIZE];
+
+    write_stream(producer, 0, 40);
+    shm_ring_commit(producer);
+    g_assert_cmpint(shm_ring_read(consumer, 0, buf, 10), ==, 10);
+
+    /* Bytes 10 through 49 are overwritten without having been read. */
+    write_stream(producer, 40, 50);
+    shm_ring_commit(producer);
+    g_assert_cmpint(shm_ring_read(consumer, 10, buf, sizeof buf), ==, -1);
+    g_assert_cmpint(shm_ring_read(consumer, 25, buf, sizeof buf), ==, -1);
+    shm_ring_get_stats(consumer, &stats);
+    g_assert_cmpuint(stats.overrun, ==, 16);
+
+    /* The consumer reads what it lost from the file, and carries on from
+       the ring. */
+    shm_ring_count_file_read(consumer, 16);
+    g_assert_cmpint(shm_ring_read(consumer, 26, buf, sizeof buf), ==, RING_SIZE);
+    check_stream(buf, 26, RING_SIZE);
+
+    /* A single write that's bigger than the ring. */
+    write_stream(producer, 90, 3 * RING_SIZE);
+    shm_ring_commit(producer);
+    g_assert_cmpint(shm_ring_read(consumer, 90 + 2 * RING_SIZE - 1, buf, sizeof buf), ==, -1);
+    g_assert_cmpint(shm_ring_read(consumer, 90 + 2 * RING_SIZE, buf, sizeof buf), ==, RING_SIZE);
+    check_stream(buf, 90 + 2 * RING_SIZE, RING_SIZE);
+
+    shm_ring_get_stats(consumer, &stats);
+    g_assert_cmpuint(stats.committed, ==, 90 + 3 * RING_SIZE);
+    g_assert_cmpuint(stats.overrun, ==, 16 + 2 * RING_SIZE);
+    g_assert_cmpuint(stats.file_read, ==, 16);
+
+    close_rings(path, consumer, producer);
+}
+
+#define THREADED_STREAM_SIZE (4 * 1024 * 1024)
+
+static gpointer
+producer_thread(gpointer data)
+{
+    shm_ring_t *producer = (shm_ring_t *)data;
+    guint64 offset = 0;
+    size_t len = 1;
+
+    while (offset < THREADED_STREAM_SIZE) {
+        write_stream(producer, offset, len);
+        shm_ring_commit(producer);
+        offset += len;
+        len = len % 97 + 1;
+    }
+    return NULL;
+}
+
+/* Whatever the consumer gets from the ring while the producer is busy
+   overwriting it is intact. */
+static void
+shm_ring_test_threaded(void)
+{
+    shm_ring_t *consumer, *producer;
+    char *path = open_rings(&consumer, &producer);
+    GThread *thread;
+    guint8 buf[RING_SIZE];
+    guint64 offset = 0;
+    gssize ret;
+
+    thread = g_thread_new("shm_ring producer", producer_thread, producer);
+    while (offset < THREADED_STREAM_SIZE) {
+        ret = shm_ring_read(consumer, offset, buf, 17);
+        if (ret > 0) {
+            check_stream(buf, offset, (size_t)ret);
+            offset += ret;
+        } else if (ret < 0) {
+            /* It'd be read from the file. */
+            offset++;
+        }
+    }
+    g_thread_join(thread);
+
+    close_rings(path, consumer, producer);
+}
+
+static void
+shm_ring_test_bad_files(void)
+{
+    char *path;
+    int err = 0;
+    int fd;
+
+    g_assert_null(shm_ring_open("/nonexistent/shm_ring", &err));
+    g_assert_cmpint(err, ==, ENOENT);
+
+    fd = g_file_open_tmp("shm_ring_test_XXXXXX", &path, NULL);
+    g_assert(fd != -1);
+    ws_close(fd);
+
+    err = 0;
+    g_assert_null(shm_ring_create(path, 0, &err));
+    g_assert_cmpint(err, ==, EINVAL);
+
+    err = 0;
+    g_assert(g_file_set_contents(path, "not a ring, but long enough to have a header", -1, NULL));
+    g_assert_null(shm_ring_open(path, &err));
+    g_assert_cmpint(err, ==, EINVAL);
+
+    g_unlink(path);
+    g_free(path);
+}
+
+int
+main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+#ifdef HAVE_MMAP
+    g_test_add_func("/shm_ring/commit", shm_ring_test_commit);
+    g_test_add_func("/shm_ring/wrap", shm_ring_test_wrap);
+    g_test_add_func("/shm_ring/reader_lagging", shm_ring_test_reader_lagging);
+    g_test_add_func("/shm_ring/writer_overrun", shm_ring_test_writer_overrun);
+    g_test_add_func("/shm_ring/threaded", shm_ring_test_threaded);
+    g_test_add_func("/shm_ring/bad_files", shm_ring_test_bad_files);
+#endif
+
+    return g_test_run();
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
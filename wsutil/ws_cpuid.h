@@ -18,11 +18,14 @@
 #include "ws_attributes.h"
 
 #if defined(_MSC_VER)     /* MSVC */
+#include <intrin.h>       /* __cpuidex() and _xgetbv() */
+
 static gboolean
 ws_cpuid(guint32 *CPUInfo, guint32 selector)
 {
 	CPUInfo[0] = CPUInfo[1] = CPUInfo[2] = CPUInfo[3] = 0;
-	__cpuid((int *) CPUInfo, selector);
+	/* subleaf 0, as with GCC below; leaf 7 has more than one */
+	__cpuidex((int *) CPUInfo, selector, 0);
 	/* XXX, how to check if it's supported on MSVC? just in case clear all flags above */
 	return TRUE;
 }
@@ -89,7 +92,7 @@ ws_cpuid(guint32 *CPUInfo _U_, int selector _U_)
 }
 #endif
 
-static int
+static inline int
 ws_cpuid_sse42(void)
 {
 	guint32 CPUInfo[4];
@@ -100,3 +103,55 @@ ws_cpuid_sse42(void)
 	/* in ECX bit 20 toggled on */
 	return (CPUInfo[2] & (1 << 20));
 }
+
+/*
+ * Get the state components that the OS saves on a context switch, from
+ * XCR0; only call this if CPUID says OSXSAVE is set.
+ */
+#if defined(_MSC_VER)
+static inline guint64
+ws_xgetbv0(void)
+{
+	return _xgetbv(0);
+}
+#elif defined(__GNUC__) && defined(__x86_64__)
+static inline guint64
+ws_xgetbv0(void)
+{
+	guint32 eax, edx;
+
+	__asm__ __volatile__(".byte 0x0f, 0x01, 0xd0" /* xgetbv */
+						: "=a" (eax), "=d" (edx)
+						: "c" (0));
+	return ((guint64)edx << 32) | eax;
+}
+#else
+static inline guint64
+ws_xgetbv0(void)
+{
+	return 0;
+}
+#endif
+
+static inline int
+ws_cpuid_avx2(void)
+{
+	guint32 CPUInfo[4];
+
+	if (!ws_cpuid(CPUInfo, 0) || CPUInfo[0] < 7)
+		return 0;
+
+	/* in ECX bit 27 (OSXSAVE) and bit 28 (AVX) toggled on */
+	if (!ws_cpuid(CPUInfo, 1) ||
+	    (CPUInfo[2] & ((1 << 27) | (1 << 28))) != ((1 << 27) | (1 << 28)))
+		return 0;
+
+	/* and the OS saves the XMM and YMM registers */
+	if ((ws_xgetbv0() & 0x6) != 0x6)
+		return 0;
+
+	/* leaf 7, in EBX bit 5 toggled on */
+	if (!ws_cpuid(CPUInfo, 7))
+		return 0;
+	return (CPUInfo[1] & (1 << 5));
+}
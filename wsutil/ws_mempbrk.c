@@ -22,10 +22,13 @@
 #endif
 #endif
 
+#include <string.h>
+
 #include <glib.h>
 #include "ws_symbol_export.h"
 #include "ws_mempbrk.h"
 #include "ws_mempbrk_int.h"
+#include "ws_strscan.h"
 
 void
 ws_mempbrk_compile(ws_mempbrk_pattern* pattern, const gchar *needles)
@@ -36,6 +39,16 @@ ws_mempbrk_compile(ws_mempbrk_pattern* pattern, const gchar *needles)
         n++;
     }
 
+    /*
+     * Up to four needles are searched for with SIMD byte compares,
+     * which don't need SSE4.2 and do more bytes at a time.
+     */
+    pattern->num_needles = 0;
+    if (n - needles <= WS_MEMCHR_ANY_MAX) {
+        memcpy(pattern->needles, needles, n - needles);
+        pattern->num_needles = (guint)(n - needles);
+    }
+
 #ifdef HAVE_SSE4_2
     ws_mempbrk_sse42_compile(pattern, needles);
 #endif
@@ -63,6 +76,14 @@ ws_mempbrk_portable_exec(const guint8* haystack, size_t haystacklen, const ws_me
 WS_DLL_PUBLIC const guint8 *
 ws_mempbrk_exec(const guint8* haystack, size_t haystacklen, const ws_mempbrk_pattern* pattern, guchar *found_needle)
 {
+    if (haystacklen >= 16 && pattern->num_needles != 0) {
+        const guint8 *found = ws_memchr_any(haystack, haystacklen, pattern->needles, pattern->num_needles);
+
+        if (found && found_needle)
+            *found_needle = *found;
+        return found;
+    }
+
 #ifdef HAVE_SSE4_2
     if (haystacklen >= 16 && pattern->use_sse42)
         return ws_mempbrk_sse42_exec(haystack, haystacklen, pattern, found_needle);
@@ -11,6 +11,7 @@
 #define __WS_MEMPBRK_H__
 
 #include "ws_symbol_export.h"
+#include "ws_strscan.h"
 
 #ifdef HAVE_SSE4_2
 #include <emmintrin.h>
@@ -20,6 +21,8 @@
  */
 typedef struct {
     gchar patt[256];
+    guint8 needles[WS_MEMCHR_ANY_MAX];  /* the needles, if there are few... */
+    guint num_needles;                  /* ...or 0 */
 #ifdef HAVE_SSE4_2
     gboolean use_sse42;
     __m128i mask;
@@ -0,0 +1,239 @@
+/* ws_strscan.c
+ * Scanning byte strings, with SIMD where the CPU has it
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include "ws_cpuid.h"
+#include "bits_ctz.h"
+#include "ws_strscan.h"
+#include "ws_strscan_int.h"
+
+/*
+ * SSE2 is part of x86-64, so it needs neither a compiler flag nor a check
+ * of the CPU there; on 32-bit x86 it's used if the compiler was told the
+ * CPU has it.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WS_STRSCAN_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#define ASCII_MASK_64   G_GUINT64_CONSTANT(0x8080808080808080)
+
+size_t
+ws_ascii_span_portable(const guint8 *buf, size_t len)
+{
+    size_t i = 0;
+    guint64 word;
+
+    /* Eight bytes at a time, then the rest one by one. */
+    for (; i + 8 <= len; i += 8) {
+        memcpy(&word, buf + i, 8);
+        if (word & ASCII_MASK_64)
+            break;
+    }
+    while (i < len && buf[i] < 0x80)
+        i++;
+
+    return i;
+}
+
+const guint8 *
+ws_memchr_any_portable(const guint8 *buf, size_t len,
+                       const guint8 *needles, guint num_needles)
+{
+    const guint8 *end = buf + len;
+    guint i;
+
+    if (num_needles == 1)
+        return (const guint8 *)memchr(buf, needles[0], len);
+
+    for (; buf < end; buf++) {
+        for (i = 0; i < num_needles; i++) {
+            if (*buf == needles[i])
+                return buf;
+        }
+    }
+
+    return NULL;
+}
+
+#ifdef WS_STRSCAN_SSE2
+#define cast_m128i(p) ((const __m128i *)(const void *)(p))
+
+static size_t
+ascii_span_sse2(const guint8 *buf, size_t len)
+{
+    size_t i;
+    guint32 mask;
+
+    for (i = 0; i + 16 <= len; i += 16) {
+        mask = (guint32)_mm_movemask_epi8(_mm_loadu_si128(cast_m128i(buf + i)));
+        if (mask != 0)
+            return i + ws_ctz(mask);
+    }
+
+    return i + ws_ascii_span_portable(buf + i, len - i);
+}
+
+static const guint8 *
+memchr_any_sse2(const guint8 *buf, size_t len,
+                const guint8 *needles, guint num_needles)
+{
+    __m128i n0, n1, n2, n3, data, eq;
+    size_t i;
+    guint32 mask;
+
+    /* The C library's memchr() is vectorized already. */
+    if (num_needles == 1)
+        return (const guint8 *)memchr(buf, needles[0], len);
+
+    /* Missing needles repeat the first one. */
+    n0 = _mm_set1_epi8((char)needles[0]);
+    n1 = _mm_set1_epi8((char)needles[1]);
+    n2 = _mm_set1_epi8((char)needles[num_needles > 2 ? 2 : 0]);
+    n3 = _mm_set1_epi8((char)needles[num_needles > 3 ? 3 : 0]);
+
+    for (i = 0; i + 16 <= len; i += 16) {
+        data = _mm_loadu_si128(cast_m128i(buf + i));
+        eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(data, n0), _mm_cmpeq_epi8(data, n1)),
+                          _mm_or_si128(_mm_cmpeq_epi8(data, n2), _mm_cmpeq_epi8(data, n3)));
+        mask = (guint32)_mm_movemask_epi8(eq);
+        if (mask != 0)
+            return buf + i + ws_ctz(mask);
+    }
+
+    return ws_memchr_any_portable(buf + i, len - i, needles, num_needles);
+}
+#endif /* WS_STRSCAN_SSE2 */
+
+static size_t ascii_span_resolve(const guint8 *buf, size_t len);
+static const guint8 *memchr_any_resolve(const guint8 *buf, size_t len,
+                                        const guint8 *needles, guint num_needles);
+
+/*
+ * The routines start out pointing to ones that pick the implementation
+ * and call it. Racing threads pick the same one, so there's no lock.
+ */
+static ws_strscan_level_e strscan_level = WS_STRSCAN_PORTABLE;
+static size_t (*ascii_span_func)(const guint8 *, size_t) = ascii_span_resolve;
+static const guint8 *(*memchr_any_func)(const guint8 *, size_t,
+                                        const guint8 *, guint) = memchr_any_resolve;
+
+ws_strscan_level_e
+ws_strscan_set_level(ws_strscan_level_e max_level)
+{
+    ws_strscan_level_e level = WS_STRSCAN_PORTABLE;
+
+#ifdef WS_STRSCAN_SSE2
+    level = WS_STRSCAN_SSE2;
+#endif
+#ifdef HAVE_AVX2
+    if (ws_cpuid_avx2())
+        level = WS_STRSCAN_AVX2;
+#endif
+    if (level > max_level)
+        level = max_level;
+
+    switch (level) {
+
+#ifdef HAVE_AVX2
+    case WS_STRSCAN_AVX2:
+        ascii_span_func = ws_ascii_span_avx2;
+        memchr_any_func = ws_memchr_any_avx2;
+        break;
+#endif
+
+#ifdef WS_STRSCAN_SSE2
+    case WS_STRSCAN_SSE2:
+        ascii_span_func = ascii_span_sse2;
+        memchr_any_func = memchr_any_sse2;
+        break;
+#endif
+
+    default:
+        level = WS_STRSCAN_PORTABLE;
+        ascii_span_func = ws_ascii_span_portable;
+        memchr_any_func = ws_memchr_any_portable;
+        break;
+    }
+    strscan_level = level;
+
+    return level;
+}
+
+ws_strscan_level_e
+ws_strscan_get_level(void)
+{
+    if (ascii_span_func == ascii_span_resolve)
+        ws_strscan_set_level(WS_STRSCAN_AVX2);
+
+    return strscan_level;
+}
+
+const char *
+ws_strscan_level_name(ws_strscan_level_e level)
+{
+    switch (level) {
+
+    case WS_STRSCAN_AVX2:
+        return "AVX2";
+
+    case WS_STRSCAN_SSE2:
+        return "SSE2";
+
+    default:
+        return "portable";
+    }
+}
+
+static size_t
+ascii_span_resolve(const guint8 *buf, size_t len)
+{
+    ws_strscan_set_level(WS_STRSCAN_AVX2);
+    return ascii_span_func(buf, len);
+}
+
+static const guint8 *
+memchr_any_resolve(const guint8 *buf, size_t len,
+                   const guint8 *needles, guint num_needles)
+{
+    ws_strscan_set_level(WS_STRSCAN_AVX2);
+    return memchr_any_func(buf, len, needles, num_needles);
+}
+
+size_t
+ws_ascii_span(const guint8 *buf, size_t len)
+{
+    return ascii_span_func(buf, len);
+}
+
+const guint8 *
+ws_memchr_any(const guint8 *buf, size_t len,
+              const guint8 *needles, guint num_needles)
+{
+    return memchr_any_func(buf, len, needles, num_needles);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
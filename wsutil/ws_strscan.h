@@ -0,0 +1,73 @@
+/* ws_strscan.h
+ * Scanning byte strings, with SIMD where the CPU has it
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_STRSCAN_H__
+#define __WS_STRSCAN_H__
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * The implementations to choose from, best last. The best one the CPU
+ * supports is picked the first time one of the routines is called.
+ */
+typedef enum {
+    WS_STRSCAN_PORTABLE,
+    WS_STRSCAN_SSE2,
+    WS_STRSCAN_AVX2
+} ws_strscan_level_e;
+
+/** Return the number of bytes at the start of buf, up to len, that are
+ * ASCII, i.e. have the high-order bit clear.
+ */
+WS_DLL_PUBLIC size_t ws_ascii_span(const guint8 *buf, size_t len);
+
+/** Return a pointer to the first byte in buf, up to len, that is equal
+ * to one of the num_needles bytes in needles, or NULL if there isn't
+ * one. num_needles must be between 1 and WS_MEMCHR_ANY_MAX.
+ */
+#define WS_MEMCHR_ANY_MAX 4
+WS_DLL_PUBLIC const guint8 *ws_memchr_any(const guint8 *buf, size_t len,
+                                          const guint8 *needles, guint num_needles);
+
+/** Return the implementation in use. */
+WS_DLL_PUBLIC ws_strscan_level_e ws_strscan_get_level(void);
+
+/** Use the best implementation the CPU supports, but no better than
+ * max_level; for testing and benchmarking. Returns the one now in use.
+ */
+WS_DLL_PUBLIC ws_strscan_level_e ws_strscan_set_level(ws_strscan_level_e max_level);
+
+/** Return the name of an implementation. */
+WS_DLL_PUBLIC const char *ws_strscan_level_name(ws_strscan_level_e level);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WS_STRSCAN_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,84 @@
+/* ws_strscan_avx2.c
+ * AVX2 versions of the ws_strscan.h routines; only called if the CPU
+ * has AVX2, so this is the only file built with AVX2 enabled
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#ifdef HAVE_AVX2
+
+#include <string.h>
+
+#include <glib.h>
+#include <immintrin.h>
+#include "bits_ctz.h"
+#include "ws_strscan.h"
+#include "ws_strscan_int.h"
+
+#define cast_m256i(p) ((const __m256i *)(const void *)(p))
+
+size_t
+ws_ascii_span_avx2(const guint8 *buf, size_t len)
+{
+    size_t i;
+    guint32 mask;
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        mask = (guint32)_mm256_movemask_epi8(_mm256_loadu_si256(cast_m256i(buf + i)));
+        if (mask != 0)
+            return i + ws_ctz(mask);
+    }
+
+    return i + ws_ascii_span_portable(buf + i, len - i);
+}
+
+const guint8 *
+ws_memchr_any_avx2(const guint8 *buf, size_t len,
+                   const guint8 *needles, guint num_needles)
+{
+    __m256i n0, n1, n2, n3, data, eq;
+    size_t i;
+    guint32 mask;
+
+    /* The C library's memchr() is vectorized already. */
+    if (num_needles == 1)
+        return (const guint8 *)memchr(buf, needles[0], len);
+
+    /* Missing needles repeat the first one. */
+    n0 = _mm256_set1_epi8((char)needles[0]);
+    n1 = _mm256_set1_epi8((char)needles[1]);
+    n2 = _mm256_set1_epi8((char)needles[num_needles > 2 ? 2 : 0]);
+    n3 = _mm256_set1_epi8((char)needles[num_needles > 3 ? 3 : 0]);
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        data = _mm256_loadu_si256(cast_m256i(buf + i));
+        eq = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(data, n0), _mm256_cmpeq_epi8(data, n1)),
+                             _mm256_or_si256(_mm256_cmpeq_epi8(data, n2), _mm256_cmpeq_epi8(data, n3)));
+        mask = (guint32)_mm256_movemask_epi8(eq);
+        if (mask != 0)
+            return buf + i + ws_ctz(mask);
+    }
+
+    return ws_memchr_any_portable(buf + i, len - i, needles, num_needles);
+}
+
+#endif /* HAVE_AVX2 */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,24 @@
+/* ws_strscan_int.h
+ * Implementations behind ws_strscan.h
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_STRSCAN_INT_H__
+#define __WS_STRSCAN_INT_H__
+
+size_t ws_ascii_span_portable(const guint8 *buf, size_t len);
+const guint8 *ws_memchr_any_portable(const guint8 *buf, size_t len,
+                                     const guint8 *needles, guint num_needles);
+
+#ifdef HAVE_AVX2
+size_t ws_ascii_span_avx2(const guint8 *buf, size_t len);
+const guint8 *ws_memchr_any_avx2(const guint8 *buf, size_t len,
+                                 const guint8 *needles, guint num_needles);
+#endif
+
+#endif /* __WS_STRSCAN_INT_H__ */